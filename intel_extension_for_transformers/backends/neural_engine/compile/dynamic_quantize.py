@@ -112,7 +112,7 @@ def _insert_quantize(graph: Graph, per_token: bool):
         node.input_tensors.extend(reshape_tensor)
 
 
-def _fuse_quatize(graph: Graph):
+def _fuse_quatize(graph: Graph, per_token: bool):
     pattern = {
         "patterns": {
             'in': [[(0, "ANY"), (1, 'Quantize')]],
@@ -139,7 +139,9 @@ def _fuse_quatize(graph: Graph):
         'returns': [0, 1]
     }
 
-    for any_op in ["InnerProduct", "Matmul", "Softmax", "Convolution"]:  # ,"LayerNorm"
+    # LayerNorm only fuses the per-token s8 Quantize, whose scales it computes row by row
+    fuse_ops = ["InnerProduct", "Matmul", "Softmax", "Convolution"] + (["LayerNorm"] if per_token else [])
+    for any_op in fuse_ops:
         now_pattern = pattern.copy()
         now_pattern["patterns"]["in"][0][0] = (0, any_op)
         now_pattern["patterns"]["out"][0][0] = (0, any_op)
@@ -269,7 +271,7 @@ def _dynamic_quantization(base_model, per_token=True):
         graph.graph_init(base_model + '/conf.yaml', base_model + '/model.bin', load_weight=True)
 
     _insert_quantize(graph, per_token)
-    _fuse_quatize(graph)
+    _fuse_quatize(graph, per_token)
     if per_token:
         _fuse_mha(graph)
     _remove_unused_input(graph)
@@ -563,6 +563,9 @@ class Graph(object):
            len(self._max_input_shapes_list) > 0:
             self._activation_mem_compression(self._max_input_shapes_list)
             self._refresh_max_input_shapes_list = False
+        elif self._do_activation_mem_compression and refresh_model:
+            # plan the activation memory symbolically if the max input shapes are unknown
+            self._engine[0].symbolic_activation_mem_compression()
 
     def inference(self, input_data):
         """The inference API of the neural engine."""
@@ -763,6 +763,15 @@ def pattern_mapping(pattern_name, mapping_dict, graph):
                     if keep_flag:
                         new_in_match_result.append(name_list)
                 in_match_result = new_in_match_result
+            # the fused node replaces the Quantize output, so the quantized tensor must be its only user
+            if num_match > 0 and pattern_name == "fuse_quatize":
+                new_in_match_result = []
+                for name_list in in_match_result:
+                    node = graph.get_node_by_name(name_list[0])
+                    if len(node.output_tensors[0].dest_op) == 1 and \
+                            node.output_tensors[0].name not in graph.output_tensors_name:
+                        new_in_match_result.append(name_list)
+                in_match_result = new_in_match_result
             # MHA 1. matmul maybe fallback to fp32; 2. output dtype may not be u8.
             if num_match > 0 and pattern_name == "MultiHeadAttention":
                 new_in_match_result = []
@@ -48,6 +48,8 @@ class QuantizeFusion(Pattern):
                     is_from_quant = False
             if pre_node.input_tensors[0].name in quant_info and len(pre_node.input_tensors) >= 6 \
                or (pre_node.op_type == "Softmax") \
+               or (pre_node.op_type == "LayerNorm" and len(pre_node.output_tensors[0].dest_op) == 1 \
+                   and len(pre_node.input_tensors) == 3) \
                or (EXECUTOR_TYPE.get(pre_node.op_type, pre_node.op_type) in \
                    ["InnerProduct", "Matmul"] and (not quant_info or is_from_quant)): 
                 return (pre_node, True)
@@ -69,7 +71,13 @@ class QuantizeFusion(Pattern):
                 quant_node, can_fuse = search_quant_fusion(node)
                 if can_fuse:
                     if dtype == 'u8' or dtype == 's8':
-                        if quant_node.op_type == "Softmax":
+                        if quant_node.op_type == "LayerNorm":
+                            # LayerNorm folds the quantization into its gamma and beta, min/max go to
+                            # input[3] and input[4]
+                            model.change_node_input_tensors(quant_node.name, 3, node.input_tensors[1], 'insert')
+                            model.change_node_input_tensors(quant_node.name, 4, node.input_tensors[2], 'insert')
+                            quant_node.attr['output_dtype'] = dtype
+                        elif quant_node.op_type == "Softmax":
                             def is_lat_model(model, p=None):
                                 if p == None:
                                     p = [[(0, 'TopK'),(1, 'GatherElements')]]
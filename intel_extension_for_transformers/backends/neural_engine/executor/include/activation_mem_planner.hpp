@@ -0,0 +1,114 @@
+//  Copyright (c) 2023 Intel Corporation
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#ifndef ENGINE_EXECUTOR_INCLUDE_ACTIVATION_MEM_PLANNER_HPP_
+#define ENGINE_EXECUTOR_INCLUDE_ACTIVATION_MEM_PLANNER_HPP_
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "activation_dag.hpp"
+
+namespace executor {
+
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+/**
+ * @brief Plans the activation memory for input shapes which are only known at run time.
+ *        The model input dims are symbols (symbolic input shape -1 -> symbol 0 (batch), -2 -> symbol 1
+ *        (seq_len), ...). The bytes of each activation tensor are interpolated from the shape inference
+ *        results on a 3-point grid per symbol, which is exact for sizes quadratic in each symbol
+ *        (e.g. [bs, seq, hidden] and [bs, head, seq, seq]). A validation point checks the fitting, the
+ *        tensors which don't fit take their bytes from the real shapes at Plan time (the max observed
+ *        bytes if the caller doesn't know them).
+ *        Build assigns the tensors to shared blocks once with greedy-by-size at the largest probe point
+ *        (the tensors of a block never live at the same time, it holds for any shape). Plan only evaluates
+ *        the block sizes and the offsets for new symbol values, no DAG rebuilding or shape inference.
+ */
+class ActivationMemPlanner {
+ public:
+  explicit ActivationMemPlanner(const int64_t num_symbols, const size_t align_size = 64);
+
+  // the symbol values to run shape inference with, the grid points first and the validation point last
+  vector<vector<int64_t>> ProbePoints() const;
+
+  // record the activation bytes (tensor memory name -> bytes) of a probe point
+  void AddProbe(const vector<int64_t>& symbol_values, const unordered_map<string, size_t>& tensor_bytes);
+
+  // fit the sizes, get the tensor lifetimes from the DAG and lay out the shared blocks
+  void Build(const ActivationDAG& dag);
+
+  // evaluate the offsets of the blocks for the symbol values, the tensors which don't fit take their
+  // bytes from real_bytes (tensor name or inplace alias -> bytes of the shape inference result)
+  void Plan(const vector<int64_t>& symbol_values, const unordered_map<string, size_t>& real_bytes = {});
+
+  // the names (and inplace aliases) of the tensors whose size is not polynomial of the symbols
+  vector<string> UnfittedNames() const;
+
+  // a tensor is larger than planned at run time, keep its bytes from the next Plan
+  void Observe(const string& name, const size_t bytes);
+
+  // the planned bytes of a tensor (memory name)
+  size_t Bytes(const string& name, const vector<int64_t>& symbol_values) const;
+
+  inline int64_t num_symbols() const { return num_symbols_; }
+  inline const vector<int64_t>& planned_values() const { return planned_values_; }
+  inline size_t total_bytes() const { return total_bytes_; }
+  // offsets and block bytes of the memory names and their inplace aliases
+  inline const unordered_map<string, size_t>& offsets() const { return offsets_; }
+  inline const unordered_map<string, size_t>& block_bytes() const { return block_bytes_; }
+
+ protected:
+  struct SymbolicTensor {
+    string name;
+    // bytes on the probe grid, indexed by mixed radix of the grid positions
+    vector<double> grid_bytes;
+    bool fitted = true;
+    size_t max_bytes = 0;
+    int64_t life_begin = -1;
+    int64_t life_end = -1;
+  };
+
+  double Interpolate(const SymbolicTensor& tensor, const vector<int64_t>& symbol_values) const;
+  size_t Bytes(const SymbolicTensor& tensor, const vector<int64_t>& symbol_values) const;
+  SymbolicTensor& FindOrAdd(const string& name);
+
+  int64_t num_symbols_;
+  size_t align_size_;
+  // grid values of each symbol
+  vector<vector<int64_t>> grid_;
+  vector<int64_t> validation_point_;
+  // probes off the grid, checked against the fitting in Build
+  vector<std::pair<vector<int64_t>, unordered_map<string, size_t>>> off_grid_probes_;
+  vector<SymbolicTensor> tensors_;
+  unordered_map<string, int> tensor_index_;
+  // memory name -> inplace alias names, semantic name -> memory name
+  unordered_map<string, vector<string>> inplace_alias_;
+  unordered_map<string, string> alias2memory_;
+  // tensor indices of each shared block
+  vector<vector<int>> blocks_;
+
+  vector<int64_t> planned_values_;
+  size_t total_bytes_ = 0;
+  unordered_map<string, size_t> offsets_;
+  unordered_map<string, size_t> block_bytes_;
+};
+
+}  // namespace executor
+
+#endif  // ENGINE_EXECUTOR_INCLUDE_ACTIVATION_MEM_PLANNER_HPP_
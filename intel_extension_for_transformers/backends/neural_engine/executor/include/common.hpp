@@ -75,6 +75,17 @@ using std::vector;
 NEURALENGINE_API_ void GlobalInit(const char* pname);
 
 extern unordered_map<string, int> type2bytes;
+
+// Tensor data types, in the same order as jd::data_type (plus s64).
+// The dtype strings are only parsed at config load and the python boundary.
+enum class DataType : uint8_t { undef = 0, s4, f8_e4m3, f8_e5m2, u8, s8, u16, s16, fp16, bf16, fp32, s32, s64 };
+
+// bytes of each DataType, 0 for undef and sub-byte types
+constexpr int kDataTypeBytes[] = {0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 4, 4, 8};
+constexpr int DataTypeBytes(const DataType dtype) { return kDataTypeBytes[static_cast<int>(dtype)]; }
+
+// "int8", "int32" and "int64" are aliases of s8, s32 and s64, unknown strings are undef
+NEURALENGINE_API_ DataType StringToDataType(const string& dtype);
 // some kernel may need config to execute when be dispatched
 // write the specific config into dispatch table
 extern unordered_map<string, vector<string>> dispatch_kernel_config;
@@ -132,8 +143,8 @@ enum class Status {
 };
 
 // read weight file to data
-void* read_file_to_type(const string& root, const string& type, const vector<int64_t>& shape,
-                        const vector<int64_t>& location);
+void* read_file_to_type(const string& root, const DataType type, const vector<int64_t>& shape,
+                        const vector<int64_t>& location, const ExecutionOptions& options = ExecutionOptions());
 
 template <typename T>
 void InitVector(T* v, int num_size, float range1 = -10, float range2 = 10, int seed = 5489u);
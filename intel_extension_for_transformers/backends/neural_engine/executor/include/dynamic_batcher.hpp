@@ -0,0 +1,133 @@
+//  Copyright (c) 2023 Intel Corporation
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#ifndef ENGINE_EXECUTOR_INCLUDE_DYNAMIC_BATCHER_HPP_
+#define ENGINE_EXECUTOR_INCLUDE_DYNAMIC_BATCHER_HPP_
+
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "tensor.hpp"
+
+namespace executor {
+
+// batching options of DynamicBatcher.
+struct BatchingOptions {
+  // the max samples of one Forward.
+  int64_t max_batch_size = 1;
+
+  // the latency deadline of a request in microseconds. A bucket is released when it has
+  // max_batch_size requests or when its oldest request has waited max_delay_us.
+  int64_t max_delay_us = 0;
+
+  // ascending upper bounds of the sequence length buckets, e.g. {64, 128, 256, 384}.
+  // Requests longer than the last bound get a bucket of their own length, empty means one bucket.
+  vector<int64_t> seq_len_buckets;
+
+  // round the padded sequence length of a batch up to a multiple of it.
+  int64_t pad_to_multiple = 1;
+
+  // the input index of the attention mask ([1, seq_len], 1 for tokens and 0 for padding), -1 if none.
+  // The mask of a request without data is generated from its sequence length, the mask is
+  // zero padded, so PaddingSequence / SequenceLength see the real length of each sample.
+  int64_t mask_input_index = -1;
+
+  // the padded sequence axis of each model output, Unpack cuts it back to the length of the sample.
+  // -1 (or an output past the end) for an output without a sequence axis, e.g. pooled logits.
+  vector<int64_t> output_seq_axes;
+};
+
+// the output tensors are views of the model output buffers, they are only valid during the callback
+using ServingCallback = std::function<void(int64_t request_id, const vector<Tensor>& outputs)>;
+
+struct ServingRequest {
+  int64_t id;
+  int64_t seq_len;
+  vector<Tensor> inputs;
+  ServingCallback callback;
+  std::chrono::steady_clock::time_point arrival;
+};
+
+/**
+ * @brief Queues the requests (one sample each) in sequence length buckets and forms the batches
+ *        under a latency deadline. Pack concats a batch along dim 0 and pads dim 1 only to the longest
+ *        sample of the batch, so the model runs padding-minimal shapes instead of the max sequence length.
+ *        The requests of one batch must only differ in the sequence dim (dim 1).
+ */
+class NEURALENGINE_API_ DynamicBatcher {
+ public:
+  explicit DynamicBatcher(const BatchingOptions& options = BatchingOptions());
+
+  // queue one sample and return the request id.
+  int64_t Push(const vector<Tensor>& inputs, const ServingCallback& callback);
+
+  // block until a bucket is released and move its batch out. Return false after Stop
+  // when all the requests are taken.
+  bool Pop(vector<ServingRequest>* batch);
+
+  // mark a popped batch as completed.
+  void Done(const int64_t num);
+
+  // block until all pushed requests are done.
+  void Wait();
+
+  // wake up the Pop callers, the queued requests are still handed out.
+  void Stop();
+
+  // the bucket upper bound of a sequence length.
+  int64_t Bucket(const int64_t seq_len) const;
+
+  // the sequence length a batch is padded to.
+  int64_t PaddedLen(const vector<ServingRequest>& batch) const;
+
+  // concat the batch along dim 0 and zero pad dim 1 to PaddedLen, the tensors refer to buffers.
+  vector<Tensor> Pack(const vector<ServingRequest>& batch, vector<vector<char>>* buffers) const;
+
+  // split the batched outputs into the samples and cut the padded sequence axis given by
+  // output_seq_axes, the outputs are views of the batched ones.
+  vector<vector<Tensor>> Unpack(const vector<ServingRequest>& batch, const int64_t padded_len,
+                                vector<Tensor>* outputs) const;
+
+  static int64_t SeqLen(const vector<Tensor>& inputs);
+
+  inline const BatchingOptions& options() const { return options_; }
+
+ protected:
+  using Clock = std::chrono::steady_clock;
+  // pick the released bucket with the oldest request, return the end of buckets_ if none
+  // and update the earliest deadline of the unreleased ones.
+  std::map<int64_t, std::list<ServingRequest>>::iterator ReleasedBucket(const Clock::time_point& now,
+                                                                         Clock::time_point* deadline);
+
+  BatchingOptions options_;
+  std::mutex lock_;
+  std::condition_variable queue_cond_;
+  std::condition_variable done_cond_;
+  // bucket upper bound -> requests in arrival order
+  std::map<int64_t, std::list<ServingRequest>> buckets_;
+  int64_t queued_num_ = 0;
+  int64_t pending_num_ = 0;
+  int64_t next_request_id_ = 0;
+  bool stop_ = false;
+};
+
+}  // namespace executor
+
+#endif  // ENGINE_EXECUTOR_INCLUDE_DYNAMIC_BATCHER_HPP_
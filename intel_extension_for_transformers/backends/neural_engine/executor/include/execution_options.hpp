@@ -63,6 +63,26 @@ struct ExecutionOptions {
   // save the activation DAG to disk or not.
   // worked only when activation_mem_compression == true.
   bool dump_activation_dag = false;
+
+  // if share the weights between model instances through boost interprocess shared memory or not.
+  bool weight_sharing = getenv("WEIGHT_SHARING") != NULL ? true : false;
+
+  // the number of model instances (threads or processes) which share one weight space.
+  // worked only when weight_sharing == true.
+  int64_t shared_instance_num = getenv("INST_NUM") != NULL ? std::atoi(getenv("INST_NUM")) : 1;
+
+  // the NUMA node which the model instance is bound to, -1 means not bound.
+  // the shared weight space is created per NUMA node when it is set, so that the
+  // weights are read from node-local memory.
+  int numa_node = -1;
+
+  // back the weights of 2 MB or more with transparent huge pages, streaming them then takes far fewer dTLB misses.
+  bool weight_huge_pages = getenv("ENGINE_DISABLE_HUGE_PAGES") == NULL;
+
+  // NUMA placement of the weights: "default" (first touch), "local", "interleave" over every node,
+  // or "bind" to numa_node.
+  std::string weight_mem_policy =
+      getenv("ENGINE_WEIGHT_MEM_POLICY") != NULL ? getenv("ENGINE_WEIGHT_MEM_POLICY") : "default";
 };
 
 }  // namespace executor
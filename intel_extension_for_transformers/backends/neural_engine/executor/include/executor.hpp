@@ -21,6 +21,7 @@
 #include "common.hpp"
 #include "dataloader.hpp"
 #include "model.hpp"
+#include "model_server.hpp"
 #include "operator.hpp"
 #include "operator_registry.hpp"
 #include "tensor.hpp"
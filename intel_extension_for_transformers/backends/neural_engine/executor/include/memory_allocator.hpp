@@ -16,12 +16,14 @@
 #define ENGINE_EXECUTOR_INCLUDE_MEMORY_ALLOCATOR_HPP_
 
 #include <stdlib.h>
+#include <atomic>
 #include <cstdlib>
 #include <map>
 #include <memory>
 #include <mutex>  // NOLINT
 #include <string>
 #include <thread>  // NOLINT
+#include <unordered_map>
 #include <vector>
 #include <utility>
 #include <boost/interprocess/allocators/allocator.hpp>
@@ -37,14 +39,48 @@ using std::shared_ptr;
 using std::string;
 using std::vector;
 namespace ipc = boost::interprocess;
+// Activation memory allocator.
+// Each thread owns an arena of buffers (the model instance which allocates a tensor also unrefs it),
+// so getting and unreffing memory take no lock. A buffer is looked up by its pointer in a hash table,
+// and the idle cycle buffers are kept in size-class free lists, so both are O(1). TrimIdleBuffers frees the
+// ones no Forward has taken for kMaxIdlePasses passes, so varying shapes do not pile up buffers.
 class MemoryAllocator {
  public:
-  // vector will contain the used counts and size of a memory
-  typedef std::map<void*, vector<size_t>> MemoryBuffer;
-  typedef std::map<void*, string> BufferName;
   typedef std::map<string, bool> StrategyList;
-  typedef std::map<std::thread::id, std::unique_ptr<MemoryBuffer>> TreadMemory;
-  typedef std::map<std::thread::id, BufferName*> TreadName;
+
+  enum class BufferKind : uint8_t { cycle, direct, unified, compressed };
+
+  // life count and size of a buffer
+  struct BufferInfo {
+    int64_t life;
+    size_t size;
+    BufferKind kind;
+    int16_t size_class;
+    // the buffer is in the free list of its size class, it may have been revived by ResetMemory since
+    bool queued;
+    // the pass of the arena when the buffer went idle
+    uint32_t idle_pass;
+  };
+
+  // sizes are rounded up to size classes, 4 classes per power of two (at most 25% waste),
+  // 256 classes cover any 64-bit size
+  static constexpr size_t kSizeClassUnit = ALIGNMENT;
+  static constexpr int kNumSizeClasses = 256;
+  // a request may reuse an idle buffer up to this number of classes larger
+  static constexpr int kMaxClassSkip = 4;
+  // an idle cycle buffer is freed after this number of passes without being taken
+  static constexpr uint32_t kMaxIdlePasses = 4;
+
+  struct ThreadArena {
+    std::unordered_map<void*, BufferInfo> buffers;
+    vector<void*> free_lists[kNumSizeClasses];
+    std::unordered_map<void*, string> names;
+    uint32_t pass = 0;
+    // bytes of the cycle buffers, in use or idle
+    size_t cycle_bytes = 0;
+    // the static compressed buffer of the model running on this thread
+    std::shared_ptr<StaticCompressedBuffer> compressed_buffer;
+  };
 
   static char* SharedEnv(char* env_name = "WEIGHT_SHARING") {
     static char* shared_env = getenv(env_name);
@@ -57,79 +93,36 @@ class MemoryAllocator {
     return 1;
   }
 
-  static MemoryBuffer& Buffer() {
-    static TreadMemory t_memory;
-    // (TODO) it's not good for each thread to obtain a MemoryBuffer
-    std::thread::id id = std::this_thread::get_id();
-    auto count = t_memory.count(id);
-    if (count == 0) {
-      std::unique_ptr<MemoryBuffer> mu_ptr(new MemoryBuffer());
-      t_memory[id] = std::move(mu_ptr);
-    }
-    return *(t_memory[id]);
-  }
+  // the arena of the calling thread
+  static ThreadArena& Arena();
 
-  static void InitCompressedBufferManager(const ActivationDAG& dag, const bool& debug_mode = false);
-
-  // use another memory buffer which not be freed by memory_allocator
-  static MemoryBuffer& CompressedBuffer() {
-    static TreadMemory scpb_memory;
-    // (TODO) it's not good for each thread to obtain a MemoryBuffer
-    std::thread::id id = std::this_thread::get_id();
-    auto count = scpb_memory.count(id);
-    if (count == 0) {
-      std::unique_ptr<MemoryBuffer> mu_ptr(new MemoryBuffer());
-      scpb_memory[id] = std::move(mu_ptr);
-    }
-    return *(scpb_memory[id]);
-  }
+  static int SizeClass(const size_t size);
+  static size_t SizeClassBytes(const int size_class);
 
-  static BufferName& Name() {
-    static TreadName t_name;
-    // (TODO) it's not good for each thread to obtain a MemoryBuffer
-    std::thread::id id = std::this_thread::get_id();
-    if (t_name.count(id) == 0) {
-      t_name[id] = new BufferName();
-    }
-    return *(t_name[id]);
-  }
+  // the static compressed buffer is owned by one model, its activations are laid out in it. The Init
+  // functions bind the new buffer to the calling thread, BindCompressedBuffer binds it to the thread
+  // a forward of the model runs on.
+  static std::shared_ptr<StaticCompressedBuffer> InitCompressedBufferManager(const ActivationDAG& dag,
+                                                                             const bool& debug_mode = false);
 
-  static void SetName(void* data, const string name) {
-    BufferName& name_buffer = Name();
-    MemoryBuffer& memory_buffer = Buffer();
-    auto iter = memory_buffer.find(data);
-    if (iter != memory_buffer.end()) {
-      name_buffer[iter->first] = name;
-    } else {
-      DLOG(WARNING) << "name a not existing pointer...";
-    }
-  }
+  // static compressed buffer planned by symbolic sizes, the model re-plans it when the input shapes change
+  static std::shared_ptr<StaticCompressedBuffer> InitSymbolicBufferManager(
+      std::shared_ptr<ActivationMemPlanner> planner);
 
-  static int AliveBuffer() {
-    MemoryBuffer& memory_buffer = Buffer();
-    BufferName& name_buffer = Name();
-    int alive = 0;
-    for (auto iter = memory_buffer.begin(); iter != memory_buffer.end(); ++iter) {
-      auto buffer_count = iter->second[0];
-      if (buffer_count != 0) {
-        alive++;
-        DLOG(WARNING) << "have alive buffer name " << name_buffer[iter->first];
-      }
-    }
-    DLOG(WARNING) << "buffer alive count " << alive;
-    return alive;
-  }
+  static void BindCompressedBuffer(std::shared_ptr<StaticCompressedBuffer> buffer);
 
-  static void ReleaseBuffer() {
-    MemoryBuffer& memory_buffer = Buffer();
-    for (auto iter = memory_buffer.begin(); iter != memory_buffer.end(); ++iter) {
-      auto buffer_count = iter->second[0];
-      if (buffer_count != 0) {
-        DLOG(WARNING) << "buffer still have life, force release...";
-        iter->second[0] = 0;
-      }
-    }
-  }
+  static void SetName(void* data, const string name);
+
+  static int AliveBuffer();
+
+  static void ReleaseBuffer();
+
+  // start a new pass of the calling thread's arena (one Forward) and free its cycle buffers that
+  // have been idle for more than kMaxIdlePasses passes.
+  static void TrimIdleBuffers();
+
+  // bytes held by the cycle buffers of the calling thread's arena
+  static size_t CycleBufferBytes();
 
   static StrategyList& Strategy() {
     static StrategyList* m_strategy_ = new StrategyList({{"cycle_buffer", false},
@@ -139,9 +132,23 @@ class MemoryAllocator {
     return *m_strategy_;
   }
 
-  static ipc::managed_shared_memory& ManagedShm(char* space_name = "SharedWeight") {
-    static ipc::managed_shared_memory shm_ptr(ipc::open_only, space_name);
-    return shm_ptr;
+  // shared weight space name, one space per NUMA node if the model instance is bound to a node
+  static string SharedSpaceName(const int numa_node = -1, const string& space_name = "SharedWeight") {
+    if (numa_node < 0) return space_name;
+    return space_name + "_node" + std::to_string(numa_node);
+  }
+
+  static ipc::managed_shared_memory& ManagedShm(const string& space_name = "SharedWeight") {
+    static std::mutex shm_lock;
+    static map<string, std::unique_ptr<ipc::managed_shared_memory>> shm_spaces;
+    std::lock_guard<std::mutex> lock(shm_lock);
+    auto iter = shm_spaces.find(space_name);
+    if (iter == shm_spaces.end()) {
+      std::unique_ptr<ipc::managed_shared_memory> shm_ptr(
+          new ipc::managed_shared_memory(ipc::open_only, space_name.c_str()));
+      iter = shm_spaces.insert({space_name, std::move(shm_ptr)}).first;
+    }
+    return *(iter->second);
   }
 
   static void InitStrategy(const ExecutionOptions& execution_options = ExecutionOptions()) {
@@ -156,170 +163,26 @@ class MemoryAllocator {
     SetStrategy(memory_strategy);
   }
 
-  static void SetStrategy(const string strategy) {
-    CHECK(strategy == "cycle_buffer" || strategy == "direct_buffer" || strategy == "unified_buffer" ||
-          strategy == "static_compressed_buffer")
-        << "only support memory strategy cycle buffer, direct buffer, unified buffer and static compressed buffer";
-    StrategyList& strategy_list = Strategy();
-    strategy_list[strategy] = true;
-    DLOG(INFO) << "strategy list set success " << strategy;
-  }
+  static void SetStrategy(const string strategy);
 
-  static int CheckMemory(void* data) {
-    MemoryBuffer& memory_buffer = Buffer();
-    MemoryBuffer& scpb_mem_buffer = CompressedBuffer();
-    if (memory_buffer.count(data) != 0) {
-      auto iter = memory_buffer.find(data);
-      return iter->second[0];
-    } else if (scpb_mem_buffer.count(data) != 0) {
-      auto iter = scpb_mem_buffer.find(data);
-      return iter->second[0];
-    } else {
-      DLOG(WARNING) << "get life from a not existing memory pointer...";
-      return -1;
-    }
-  }
+  static int CheckMemory(void* data);
 
   // set the data buffer a new life count
-  static void ResetMemory(void* data, const int life_count) {
-    MemoryBuffer& memory_buffer = Buffer();
-    MemoryBuffer& scpb_mem_buffer = CompressedBuffer();
-    StrategyList& strategy_list = Strategy();
-    if (memory_buffer.count(data) != 0) {
-      auto iter = memory_buffer.find(data);
-      iter->second[0] = life_count;
-    } else if (scpb_mem_buffer.count(data) != 0) {
-      auto iter = scpb_mem_buffer.find(data);
-      iter->second[0] = life_count;
-    } else {
-      DLOG(WARNING) << "reset a not existing memory pointer...";
-    }
-  }
+  static void ResetMemory(void* data, const int life_count);
 
   // will return the left count of one tensor
-  static int UnrefMemory(void* data, bool inplace = false) {
-    MemoryBuffer& memory_buffer = Buffer();
-    MemoryBuffer& scpb_mem_buffer = CompressedBuffer();
-    StrategyList& strategy_list = Strategy();
-    std::map<void*, vector<size_t>>::iterator iter;
-    bool in_scpb_mem_buffer = false;
-    bool in_mem_buffer = false;
-    if (scpb_mem_buffer.count(data) != 0) {
-      iter = scpb_mem_buffer.find(data);
-      in_scpb_mem_buffer = true;
-    }
-    if (memory_buffer.count(data) != 0) {
-      iter = memory_buffer.find(data);
-      in_mem_buffer = true;
-    }
-    LOG_IF(FATAL, (in_scpb_mem_buffer && in_mem_buffer))
-        << "Find data ptr " << data << "in static compressed buffer and cycle buffer.";
-    int status = 0;
-    if (in_scpb_mem_buffer || in_mem_buffer) {
-      if (iter->second[0] <= 0) {
-        DLOG(WARNING) << "free a no-used memory...";
-        iter->second[0] = 0;
-        status = 0;
-      } else {
-        (iter->second[0])--;
-        status = iter->second[0];
-      }
-      if (in_mem_buffer && status == 0 && inplace == false) {
-        if (strategy_list["direct_buffer"]) {
-          auto free_ptr = iter->first;
-          aligned_free(free_ptr);
-          memory_buffer.erase(free_ptr);
-        } else if (strategy_list["unified_buffer"]) {
-          auto free_ptr = iter->first;
-          i_free(free_ptr);
-          memory_buffer.erase(free_ptr);
-        }
-      }
-    } else {
-      DLOG(WARNING) << "free not existing memory pointer...";
-      status = -1;
-    }
-    return status;
-  }
+  static int UnrefMemory(void* data, bool inplace = false);
 
-  static void* GetMemory(size_t size, const int life_count, const string& tensor_name = "") {
-    static std::mutex getmem_lock;
-    std::lock_guard<std::mutex> lock(getmem_lock);
-    if (size == 0) {
-      DLOG(INFO) << "please set the tensor size...";
-      return nullptr;
-    }
-    if (life_count <= 0) {
-      DLOG(INFO) << "please set the tensor life...";
-      return nullptr;
-    }
-    StrategyList& strategy_list = Strategy();
-    if (strategy_list["static_compressed_buffer"]) {
-      if (tensor_name != "") {
-        // activation memory allocation
-        return StaticCompressedBufferGetMemory(size, life_count, tensor_name);
-      } else {
-        // workspace and other memory allocation
-        // (TODO) it's not good to use one more memory management tools in one instance
-        return CycleBufferGetMemory(size, life_count);
-      }
-    } else if (strategy_list["direct_buffer"]) {
-      return DirectBufferGetMemory(size, life_count);
-    } else if (strategy_list["cycle_buffer"]) {
-      return CycleBufferGetMemory(size, life_count);
-    } else if (strategy_list["unified_buffer"]) {
-      return UnifiedBufferGetMemory(size, life_count);
-    } else {
-      LOG(ERROR) << "please set the memory strategy";
-      return nullptr;
-    }
-  }
+  static void* GetMemory(size_t size, const int life_count, const string& tensor_name = "");
 
   // Get memory from static compressed buffer manager
   static void* StaticCompressedBufferGetMemory(size_t size, const int life_count, const string& tensor_name = "");
 
-  static void* CycleBufferGetMemory(size_t size, const int life_count) {
-    MemoryBuffer& memory_buffer = Buffer();
-    DLOG(INFO) << "cycle buffer tensor size is " << memory_buffer.size();
-    for (auto iter = memory_buffer.begin(); iter != memory_buffer.end(); ++iter) {
-      auto buffer_count = iter->second[0];
-      auto buffer_size = iter->second[1];
-      if (buffer_count == 0) {
-        if (size > buffer_size) {
-          auto free_ptr = iter->first;
-          aligned_free(free_ptr);
-          memory_buffer.erase(free_ptr);
-          // allocate new buffer
-          void* buf = reinterpret_cast<void*>(aligned_alloc(ALIGNMENT, (size / ALIGNMENT + 1) * ALIGNMENT));
-          memory_buffer.insert({buf, vector<size_t>({static_cast<size_t>(life_count), size})});
-          return buf;
-        } else {
-          memory_buffer[iter->first] = vector<size_t>({static_cast<size_t>(life_count), buffer_size});
-          return iter->first;
-        }
-      }
-    }
-    // allocate new buffer
-    void* buf = reinterpret_cast<void*>(aligned_alloc(ALIGNMENT, (size / ALIGNMENT + 1) * ALIGNMENT));
-    memory_buffer.insert({buf, vector<size_t>({static_cast<size_t>(life_count), size})});
-    return buf;
-  }
+  static void* CycleBufferGetMemory(size_t size, const int life_count);
 
-  static void* DirectBufferGetMemory(size_t size, const int life_count) {
-    MemoryBuffer& memory_buffer = Buffer();
-    DLOG(INFO) << "direct buffer tensor size is " << memory_buffer.size();
-    void* buf = reinterpret_cast<void*>(aligned_alloc(ALIGNMENT, (size / ALIGNMENT + 1) * ALIGNMENT));
-    memory_buffer.insert({buf, vector<size_t>({static_cast<size_t>(life_count), size})});
-    return buf;
-  }
+  static void* DirectBufferGetMemory(size_t size, const int life_count);
 
-  static void* UnifiedBufferGetMemory(size_t size, const int life_count) {
-    MemoryBuffer& memory_buffer = Buffer();
-    DLOG(INFO) << "unified buffer tensor size is " << memory_buffer.size();
-    void* buf = reinterpret_cast<void*>(i_malloc(size));
-    memory_buffer.insert({buf, vector<size_t>({static_cast<size_t>(life_count), size})});
-    return buf;
-  }
+  static void* UnifiedBufferGetMemory(size_t size, const int life_count);
 
   // MemoryAllocator(MemoryAllocator const&)  = delete;
   // void operator=(MemoryAllocator const&)  = delete;
@@ -332,9 +195,8 @@ class MemoryAllocator {
  private:
   // Private constructor to prevent instancing.
   MemoryAllocator() {}
-  // static compressed buffer manager
-  // init by activation dag
-  static std::unique_ptr<StaticCompressedBuffer> scpb_manager_;
+  // the strategy GetMemory uses, resolved from the strategy list by SetStrategy
+  static std::atomic<int> active_strategy_;
 };
 
 }  // namespace executor
@@ -63,11 +63,12 @@ class NEURALENGINE_API_ Model {
   void DeserializeFromFile(const string& file_name);
 
   void Init(const ModelConfig& conf);
-  void RemoveSharedWeight(bool is_begin = false, char* count_space_name = "RemovedCount",
-                          char* count_name = "removed_count", char* count_mtx_name = "removed_count_mtx",
-                          char* space_name = "SharedWeight");
-  void InitSharedWeight(char* space_name = "SharedWeight");
-  ipc::managed_shared_memory::handle_t LoadSharedWeight(const string& root, const string& type,
+  void RemoveSharedWeight(bool is_begin = false, const string& count_space_name = "RemovedCount",
+                          const string& count_name = "removed_count",
+                          const string& count_mtx_name = "removed_count_mtx",
+                          const string& space_name = "SharedWeight");
+  void InitSharedWeight(const string& space_name = "SharedWeight");
+  ipc::managed_shared_memory::handle_t LoadSharedWeight(const string& root, const DataType type,
                                                         const vector<int64_t>& shape, const vector<int64_t>& location);
   vector<Tensor>& Forward(vector<Tensor>& input_data);  // NOLINT
 
@@ -80,6 +81,11 @@ class NEURALENGINE_API_ Model {
   // create the activation DAG and perform the memory analysis
   void ActivationMemCompression(const vector<vector<vector<int64_t>>>& input_shapes_list);
 
+  // plan the activation memory with sizes symbolic in the input dims, so the input shapes needn't be
+  // known ahead. symbolic_input_shapes: -1 -> symbol 0 (batch), -2 -> symbol 1 (seq_len), ..., empty means
+  // dim 0 of the dynamic model input dims is batch and the other dynamic dims are seq_len.
+  void SymbolicActivationMemCompression(const vector<vector<int64_t>>& symbolic_input_shapes = {});
+
   void SetDispatchKernel(const bool& reshape_model);
 
   void ShapeInference(const vector<vector<int64_t>>& input_shapes);
@@ -111,6 +117,7 @@ class NEURALENGINE_API_ Model {
   }
 
   inline const vector<int64_t>& input_shape() const { return input_shape_; }
+  inline const ExecutionOptions& execution_options() const { return execution_options_; }
   inline const bool& has_dispatch_table_file() const { return has_dispatch_table_file_; }
 
   friend class ActivationDAGHandler;
@@ -140,6 +147,9 @@ class NEURALENGINE_API_ Model {
   // for dispatcher
   bool has_dispatch_table_file_ = false;
   ExecutionOptions execution_options_;
+  // for weight sharing, one shared space per NUMA node
+  string shared_space_name_ = "SharedWeight";
+  string removed_count_space_name_ = "RemovedCount";
   // for profiling
   bool engine_profiling_ = false;
   // for onednn graph
@@ -151,6 +161,14 @@ class NEURALENGINE_API_ Model {
   // assume shapes of all input data should be same
   vector<int64_t> input_shape_;
   ActivationDAGHandler act_dag_handler_;
+  // the activation buffer of this model, bound to the threads its forward runs on
+  std::shared_ptr<StaticCompressedBuffer> compressed_buffer_;
+  // for symbolic activation memory compression
+  vector<vector<int64_t>> symbolic_input_shapes_;
+  int64_t activation_symbol_num_ = 0;
+  vector<int64_t> SymbolValues(const vector<vector<int64_t>>& input_shapes) const;
+  // re-plan the symbolic activation buffer after the shape inference of new input shapes
+  void ReplanActivationBuffer(const vector<vector<int64_t>>& input_shapes);
 };
 
 }  // namespace executor
@@ -0,0 +1,111 @@
+//  Copyright (c) 2023 Intel Corporation
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#ifndef ENGINE_EXECUTOR_INCLUDE_MODEL_SERVER_HPP_
+#define ENGINE_EXECUTOR_INCLUDE_MODEL_SERVER_HPP_
+
+#include <condition_variable>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "dynamic_batcher.hpp"
+#include "execution_options.hpp"
+#include "model.hpp"
+#include "numa_topology.hpp"
+#include "tensor.hpp"
+
+namespace executor {
+
+// serving options of ModelServer.
+struct ServingOptions {
+  // the number of model instances, they are spread evenly over the NUMA nodes.
+  int64_t instance_num = 1;
+
+  // the cores of each instance, 0 means dividing the cores of a node evenly
+  // between the instances on it.
+  int64_t cores_per_instance = 0;
+
+  // how the requests are bucketed by sequence length, batched and padded.
+  BatchingOptions batching;
+
+  // pin the instances and their OpenMP threads to the cores of their NUMA node.
+  bool bind_numa = true;
+
+  // use all hyper-threads of a physical core or only the first one.
+  bool use_logical_cores = false;
+
+  // options of each model instance. weight_sharing loads the weights once per NUMA node
+  // into a node-local shared space, numa_node and shared_instance_num are set by ModelServer.
+  ExecutionOptions execution_options;
+};
+
+/**
+ * @brief Serves a model with multiple instances pinned to the NUMA nodes of the machine.
+ *        Each instance owns its Model (so the activation memory is allocated and first touched
+ *        by its pinned thread on the local node), the weights are shared per NUMA node when
+ *        execution_options.weight_sharing is on.
+ *        Requests carry one sample ([1, seq_len, ...] tensors) and are batched by DynamicBatcher,
+ *        the outputs are returned through the completion callback on the instance thread.
+ */
+class NEURALENGINE_API_ ModelServer {
+ public:
+  using Callback = ServingCallback;
+
+  ModelServer(const string& conf_file, const string& weight_root, const ServingOptions& options = ServingOptions());
+  virtual ~ModelServer();
+
+  // submit one sample, the input data must be kept alive until the callback is done.
+  // return the request id.
+  int64_t Submit(const vector<Tensor>& inputs, const Callback& callback);
+
+  // block until all submitted requests are completed
+  void Wait();
+
+  inline int64_t instance_num() const { return instances_.size(); }
+  inline const NumaTopology& topology() const { return topology_; }
+
+ protected:
+  struct Instance {
+    int numa_node;
+    int64_t shared_instance_num;
+    vector<int> cpus;
+    std::thread worker;
+    std::unique_ptr<Model> model;
+    // reused batch input buffers
+    vector<vector<char>> input_buffers;
+  };
+
+  void InstanceLoop(Instance* instance);
+  void RunBatch(Instance* instance, const vector<ServingRequest>& batch);
+
+  string conf_file_;
+  string weight_root_;
+  ServingOptions options_;
+  NumaTopology topology_;
+  vector<std::unique_ptr<Instance>> instances_;
+  DynamicBatcher batcher_;
+
+  // the model instances are constructed one by one, the operator primitive caches
+  // and the shared weight spaces are process-wide.
+  std::mutex init_lock_;
+  std::condition_variable init_cond_;
+  int64_t ready_num_ = 0;
+};
+
+}  // namespace executor
+
+#endif  // ENGINE_EXECUTOR_INCLUDE_MODEL_SERVER_HPP_
@@ -0,0 +1,67 @@
+//  Copyright (c) 2023 Intel Corporation
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#ifndef ENGINE_EXECUTOR_INCLUDE_NUMA_TOPOLOGY_HPP_
+#define ENGINE_EXECUTOR_INCLUDE_NUMA_TOPOLOGY_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace executor {
+
+using std::string;
+using std::vector;
+
+/**
+ * @brief The NUMA nodes and the cpus of each node which the process is allowed to run on.
+ *        The topology is read from sysfs and restricted by the process affinity mask, so
+ *        a process launched by numactl / taskset only sees the cpus it was given.
+ *        Fall back to one node with all the processors if sysfs is not available.
+ */
+class NumaTopology {
+ public:
+  // use_logical_cores == false keeps the first hyper-thread of each physical core only
+  explicit NumaTopology(const bool use_logical_cores = false);
+
+  inline int num_nodes() const { return node_cpus_.size(); }
+  inline const vector<int>& cpus(const int node) const { return node_cpus_[node]; }
+  inline int node_id(const int node) const { return node_ids_[node]; }
+
+  // parse the sysfs cpu list format, e.g. "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}
+  static vector<int> ParseCpuList(const string& cpu_list);
+
+  // pin the calling thread to the cpu set, the OpenMP threads it spawns inherit the mask
+  static bool BindThread(const vector<int>& cpus);
+
+  // set the OpenMP thread number of the calling thread to cpus.size() and
+  // pin each OpenMP thread to one cpu of the set
+  static bool BindOmpThreads(const vector<int>& cpus);
+
+  // set the NUMA policy of the pages of [addr, addr + size) that are not faulted in yet. policy is "default" (first
+  // touch), "local", "interleave" over the nodes of the topology, or "bind" to the sysfs node id node_id.
+  bool SetMemPolicy(void* addr, size_t size, const string& policy, int node_id) const;
+
+  // the size of the transparent huge pages, 0 if they are disabled
+  static size_t HugePageSize();
+
+ private:
+  // sysfs node id (node ids may be sparse) and its allowed cpus
+  vector<int> node_ids_;
+  vector<vector<int>> node_cpus_;
+};
+
+}  // namespace executor
+
+#endif  // ENGINE_EXECUTOR_INCLUDE_NUMA_TOPOLOGY_HPP_
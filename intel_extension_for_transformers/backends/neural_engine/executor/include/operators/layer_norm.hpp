@@ -14,6 +14,7 @@
 
 #ifndef ENGINE_EXECUTOR_INCLUDE_OPERATORS_LAYER_NORM_HPP_
 #define ENGINE_EXECUTOR_INCLUDE_OPERATORS_LAYER_NORM_HPP_
+#include <algorithm>
 #include <cstring>
 #include <string>
 #include <unordered_map>
@@ -52,6 +53,9 @@ class LayerNormOperator : public Operator {
   void ReshapewithTransMode(const vector<Tensor*>& input, const vector<Tensor*>& output);
   void ForwardwithTransMode(const vector<Tensor*>& input, const vector<Tensor*>& output);
 
+  void ReshapewithDynamicQuant(const vector<Tensor*>& input, const vector<Tensor*>& output);
+  void ForwardwithDynamicQuant(const vector<Tensor*>& input, const vector<Tensor*>& output);
+
   void DstReshapeFusion(const vector<Tensor*>& input, const vector<Tensor*>& output);
   vector<vector<string>> InplacePairs(const vector<Tensor*>& input, const vector<Tensor*>& output) override;
 
@@ -69,6 +73,10 @@ class LayerNormOperator : public Operator {
 
   bool transpose_mode_ = false;
   bool quantize_fuse_ = false;
+  // A following Quantize fused into the output: static u8/s8 with dst min/max as input[3]/input[4], or per-token
+  // dynamic s8 with dst min/scale as output[1]/output[2] in the layout dynamic_quant_matmul reads.
+  bool per_token_ = false;
+  bool dynamic_quant_ = false;
 #ifdef WITH_SPARSELIB
   jd::tensor_desc src_desc_;
   jd::tensor_desc dst_desc_;
@@ -22,8 +22,10 @@
 #include <utility>
 #include <string>
 #include <algorithm>
+#include <memory>
 
 #include "activation_dag.hpp"
+#include "activation_mem_planner.hpp"
 
 #ifdef _WIN32
 #include <malloc.h>
@@ -65,8 +67,11 @@ class StaticCompressedBuffer {
       GreedyBySize(dag);
     }
   }
+  // plan the buffer for the input shapes known at run time, see ActivationMemPlanner
+  explicit StaticCompressedBuffer(std::shared_ptr<ActivationMemPlanner> planner) : planner_(planner) {}
   ~StaticCompressedBuffer() {
     if (activation_buffer_ != nullptr) aligned_free(activation_buffer_);
+    if (retired_buffer_ != nullptr) aligned_free(retired_buffer_);
     if (debug_mode_) {
       for (auto&& i : memory_map_) {
         if (i.second != nullptr) aligned_free(i.second);
@@ -74,12 +79,49 @@ class StaticCompressedBuffer {
     }
   }
   void* GetDataByName(const string& name) { return memory_map_[name]; }
+  // the bytes a tensor can use, 0 if it's not planned
+  size_t GetBytesByName(const string& name) const {
+    auto iter = bytes_map_.find(name);
+    return iter == bytes_map_.end() ? 0 : iter->second;
+  }
+  inline bool symbolic() const { return planner_ != nullptr; }
+  inline const std::shared_ptr<ActivationMemPlanner>& planner() const { return planner_; }
+
+  // re-layout the tensors for new symbol values (only between two forwards of the owner model), the buffer
+  // only grows. The previous buffer is kept until the next growth for the tensors which still refer to it.
+  // real_bytes are the bytes of the tensors the planner can't size from the symbols, see UnfittedNames.
+  void Replan(const vector<int64_t>& symbol_values, const unordered_map<string, size_t>& real_bytes = {}) {
+    LOG_IF(FATAL, planner_ == nullptr) << "Only symbolic static compressed buffer can be re-planned.";
+    if (symbol_values == planner_->planned_values()) return;
+    planner_->Plan(symbol_values, real_bytes);
+    if (planner_->total_bytes() > capacity_) {
+      if (retired_buffer_ != nullptr) aligned_free(retired_buffer_);
+      retired_buffer_ = activation_buffer_;
+      capacity_ = planner_->total_bytes();
+      activation_buffer_ = aligned_alloc(align_size, capacity_);
+      LOG(INFO) << "symbolic activation buffer grows to " << capacity_ << " bytes.";
+    }
+    memory_map_.clear();
+    bytes_map_ = planner_->block_bytes();
+    for (auto&& i : planner_->offsets()) {
+      memory_map_[i.first] = static_cast<char*>(activation_buffer_) + i.second;
+    }
+  }
+
+  // a tensor is larger than planned, it's planned from the next re-layout
+  void Observe(const string& name, const size_t bytes) {
+    if (planner_ != nullptr) planner_->Observe(name, bytes);
+  }
 
  private:
   void* activation_buffer_ = nullptr;
+  void* retired_buffer_ = nullptr;
+  size_t capacity_ = 0;
   bool debug_mode_ = false;
   const int align_size = 64;  // TODO(zhe): make it configable based on different arch?
+  std::shared_ptr<ActivationMemPlanner> planner_;
   unordered_map<string, void*> memory_map_;
+  unordered_map<string, size_t> bytes_map_;
   map<string, TensorUsageRecord> tensor_usage_records_;
   size_t low_bound_size_ = 0;
 
@@ -169,6 +211,7 @@ class StaticCompressedBuffer {
           auto allocate_bytes = (output_tensor->alloc_bytes() + align_size - 1) / align_size * align_size;
           total_byte += allocate_bytes;
           memory_map_[output_tensor->name()] = aligned_alloc(align_size, allocate_bytes);
+          bytes_map_[output_tensor->name()] = allocate_bytes;
         }
       }
     }
@@ -218,6 +261,7 @@ class StaticCompressedBuffer {
     for (auto&& i : shared_blocks) {
       for (auto&& j : i.second) {
         memory_map_[j] = static_cast<char*>(activation_buffer_) + offset;
+        bytes_map_[j] = i.first;
       }
       offset += i.first;
     }
@@ -225,6 +269,7 @@ class StaticCompressedBuffer {
     for (auto&& i : dag.inplace_alias_holder()) {
       for (auto&& j : i.second) {
         memory_map_[j] = memory_map_[i.first];
+        bytes_map_[j] = bytes_map_[i.first];
       }
     }
     LOG(INFO) << "activation buffer raw bytes: " << raw_bytes << " compressed bytes: " << compressed_bytes
@@ -120,35 +120,42 @@ class Tensor {
  public:
   Tensor(void* data, const vector<int64_t>& shape, const string& dtype, const vector<int64_t>& strides = {},
          const vector<int64_t>& location = {}, const string& name = "")
-      : name_(name), data_(data), shape_(shape), dtype_(dtype), location_(location), strides_(strides) {}
+      : name_(name),
+        data_(data),
+        shape_(shape),
+        dtype_(dtype),
+        data_type_(StringToDataType(dtype)),
+        location_(location),
+        strides_(strides) {}
 
   // for pybind caster
-  Tensor() : data_(nullptr), shape_({}), dtype_("fp32"), name_("") {}
+  Tensor() : data_(nullptr), shape_({}), dtype_("fp32"), data_type_(DataType::fp32), name_("") {}
 
   explicit Tensor(const TensorConfig& tensor_config) : data_(nullptr) {
     name_ = tensor_config.name();
     shape_ = tensor_config.shape();
     location_ = tensor_config.location();
     dtype_ = tensor_config.dtype();
+    data_type_ = StringToDataType(dtype_);
     strides_ = tensor_config.strides();
   }
   // use data after set_shape
   inline const void* data() {
     if (shm_handle_ != 0) {
-      data_ = MemoryAllocator::ManagedShm().get_address_from_handle(shm_handle_);
+      data_ = shm_space_->get_address_from_handle(shm_handle_);
     }
     if (data_ == nullptr) {
-      data_ = MemoryAllocator::get().GetMemory(this->size() * type2bytes[this->dtype()], this->life(), this->name());
+      data_ = MemoryAllocator::get().GetMemory(this->alloc_bytes(), this->life(), this->name());
       // MemoryAllocator::get().SetName(data_, this->name());
     }
     return data_;
   }
   inline void* mutable_data() {
     if (shm_handle_ != 0) {
-      data_ = MemoryAllocator::ManagedShm().get_address_from_handle(shm_handle_);
+      data_ = shm_space_->get_address_from_handle(shm_handle_);
     }
     if (data_ == nullptr) {
-      data_ = MemoryAllocator::get().GetMemory(this->size() * type2bytes[this->dtype()], this->life(), this->name());
+      data_ = MemoryAllocator::get().GetMemory(this->alloc_bytes(), this->life(), this->name());
       // MemoryAllocator::get().SetName(data_, this->name());
     }
     return data_;
@@ -186,6 +193,7 @@ class Tensor {
 
   void set_dtype(const string& dtype) {
     dtype_ = dtype;
+    data_type_ = StringToDataType(dtype);
     refresh_hash_ = true;
   }
 
@@ -194,7 +202,7 @@ class Tensor {
   size_t get_hash() {
     if (refresh_hash_) {
       vector<int64_t> hash_vec(shape_);
-      hash_vec.push_back(type2bytes[dtype_]);
+      hash_vec.push_back(DataTypeBytes(data_type_));
       size_t seed = hash_vec.size();
       hash_ = get_array_hash(seed, hash_vec, hash_vec.size());
       refresh_hash_ = false;
@@ -244,7 +252,7 @@ class Tensor {
     dnnl::memory::desc dst_md(src_shape, type2mem[this->dtype()], dst_stride);
     static dnnl::engine reorder_eng(dnnl::engine::kind::cpu, 0);
     static dnnl::stream reorder_eng_stream(reorder_eng);
-    size_t data_size = this->size() * type2bytes[this->dtype()];
+    size_t data_size = this->alloc_bytes();
     void* src_ptr = data_;
     void* dst_ptr = MemoryAllocator::get().GetMemory(data_size, this->left_life());
     dnnl::memory src_m(src_md, reorder_eng, src_ptr);
@@ -265,9 +273,18 @@ class Tensor {
   inline size_t size() const {
     return std::accumulate(shape_.begin(), shape_.end(), size_t(1), std::multiplies<size_t>());
   }
-  inline size_t alloc_bytes() const { return this->size() * type2bytes[dtype_]; }
+  inline size_t alloc_bytes() const { return this->size() * DataTypeBytes(data_type_); }
 
-  void set_shm_handle(const ipc::managed_shared_memory::handle_t& h) { shm_handle_ = h; }
+  void set_shm_handle(const ipc::managed_shared_memory::handle_t& h) {
+    if (shm_space_ == nullptr) shm_space_ = &MemoryAllocator::ManagedShm();
+    shm_handle_ = h;
+  }
+  // the shared memory space which the handle belongs to (e.g. one space per NUMA node)
+  void set_shm_space(ipc::managed_shared_memory* space) { shm_space_ = space; }
+  ipc::managed_shared_memory* shm_space() {
+    if (shm_space_ == nullptr) shm_space_ = &MemoryAllocator::ManagedShm();
+    return shm_space_;
+  }
   bool is_shared() { return shm_handle_ != 0; }
 
   inline const string& name() const { return name_; }
@@ -283,6 +300,8 @@ class Tensor {
   inline const vector<int64_t>& shape() const { return shape_; }
   inline const vector<int64_t>& location() const { return location_; }
   inline const string& dtype() const { return dtype_; }
+  // prefer it to dtype() out of config loading, no string comparison
+  inline DataType data_type() const { return data_type_; }
   inline const vector<int64_t>& strides() const { return strides_; }
   inline const bool& is_transposed() const { return is_transposed_; }
   inline const TensorFormat& tensor_format() const { return tensor_format_; }
@@ -294,6 +313,7 @@ class Tensor {
   void* data_;
   vector<int64_t> shape_;
   string dtype_;
+  DataType data_type_ = DataType::undef;
   // for dispatcher, combine shape and dtype
   bool refresh_hash_ = true;
   size_t hash_ = 0;
@@ -311,6 +331,7 @@ class Tensor {
 
   // If shm_handle_ not equal to 0, which means it is on shared memory
   ipc::managed_shared_memory::handle_t shm_handle_ = 0;
+  ipc::managed_shared_memory* shm_space_ = nullptr;
 };  // class Tensor
 }  // namespace executor
 
@@ -32,7 +32,9 @@ PYBIND11_MODULE(neural_engine_py, m) {
       .def(py::init<executor::ModelConfig, std::string, executor::ExecutionOptions>())
       .def(py::init<std::string, std::string, executor::ExecutionOptions>())
       .def("forward", &executor::Model::Forward, py::arg("input"), py::return_value_policy::take_ownership)
-      .def("activation_mem_compression", &executor::Model::ActivationMemCompression, py::arg("input_shapes"));
+      .def("activation_mem_compression", &executor::Model::ActivationMemCompression, py::arg("input_shapes"))
+      .def("symbolic_activation_mem_compression", &executor::Model::SymbolicActivationMemCompression,
+           py::arg("symbolic_input_shapes") = std::vector<std::vector<int64_t>>());
 
   py::class_<executor::TensorConfig, std::shared_ptr<executor::TensorConfig>>(m, "tensor_config")
       .def(py::init<std::string, const std::vector<int64_t>&, std::string, const std::vector<int64_t>&,
@@ -62,5 +64,10 @@ PYBIND11_MODULE(neural_engine_py, m) {
       .def_readwrite("enable_op_tuning", &executor::ExecutionOptions::enable_op_tuning)
       .def_readwrite("execution_mode", &executor::ExecutionOptions::execution_mode)
       .def_readwrite("activation_mem_compression", &executor::ExecutionOptions::activation_mem_compression)
-      .def_readwrite("dump_activation_dag", &executor::ExecutionOptions::dump_activation_dag);
+      .def_readwrite("dump_activation_dag", &executor::ExecutionOptions::dump_activation_dag)
+      .def_readwrite("weight_sharing", &executor::ExecutionOptions::weight_sharing)
+      .def_readwrite("shared_instance_num", &executor::ExecutionOptions::shared_instance_num)
+      .def_readwrite("numa_node", &executor::ExecutionOptions::numa_node)
+      .def_readwrite("weight_huge_pages", &executor::ExecutionOptions::weight_huge_pages)
+      .def_readwrite("weight_mem_policy", &executor::ExecutionOptions::weight_mem_policy);
 }
@@ -81,23 +81,23 @@ struct type_caster<executor::Tensor> {
   // Conversion part 2 (C++ -> Python)
   static py::handle cast(const executor::Tensor& src, py::return_value_policy policy, py::handle parent) {
     py::array a;
-    if (src.dtype() == "fp32") {
+    if (src.data_type() == executor::DataType::fp32) {
       a = py::array(std::move(src.shape()), reinterpret_cast<const float*>(src.raw_data()), py::capsule(
         new auto(&src),  // <- can leak
         [](void* p){ delete reinterpret_cast<decltype(&src)*>(p); }));
-    } else if (src.dtype() == "int32" || src.dtype() == "s32") {
+    } else if (src.data_type() == executor::DataType::s32) {
       a = py::array(std::move(src.shape()), reinterpret_cast<const int32_t*>(src.raw_data()), py::capsule(
         new auto(&src),  // <- can leak
         [](void* p){ delete reinterpret_cast<decltype(&src)*>(p); }));
-    } else if (src.dtype() == "u8") {
+    } else if (src.data_type() == executor::DataType::u8) {
       a = py::array(std::move(src.shape()), reinterpret_cast<const uint8_t*>(src.raw_data()), py::capsule(
         new auto(&src),  // <- can leak
         [](void* p){ delete reinterpret_cast<decltype(&src)*>(p); }));
-    } else if (src.dtype() == "s8") {
+    } else if (src.data_type() == executor::DataType::s8) {
       a = py::array(std::move(src.shape()), reinterpret_cast<const int8_t*>(src.raw_data()), py::capsule(
         new auto(&src),  // <- can leak
         [](void* p){ delete reinterpret_cast<decltype(&src)*>(p); }));
-    } else if (src.dtype() == "bf16") {
+    } else if (src.data_type() == executor::DataType::bf16) {
       a = py::array(std::move(src.shape()), reinterpret_cast<const int16_t*>(src.raw_data()), py::capsule(
         new auto(&src),  // <- can leak
         [](void* p){ delete reinterpret_cast<decltype(&src)*>(p); }));
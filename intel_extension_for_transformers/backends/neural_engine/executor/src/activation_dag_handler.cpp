@@ -242,7 +242,7 @@ Status ActivationDAGHandler::memory_status(shared_ptr<ActivationTensor> tensor)
     return Status::Unknown;
   }
   size_t bytes = std::accumulate(tensor->shape().begin(), tensor->shape().end(), size_t(1), std::multiplies<size_t>()) *
-                 type2bytes[tensor->dtype()];
+                 DataTypeBytes(StringToDataType(tensor->dtype()));
   if (tensor->alloc_bytes() != bytes) {
     LOG(WARNING) << "Activation tensor " << tensor->name() << " has mismatched shape, dtype, alloc_bytes!";
     return Status::OutOfMemory;
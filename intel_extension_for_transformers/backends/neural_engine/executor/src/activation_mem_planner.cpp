@@ -0,0 +1,272 @@
+//  Copyright (c) 2023 Intel Corporation
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#include "activation_mem_planner.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace executor {
+
+namespace {
+
+// the grid of symbol 0 (batch) is {1, 2, 3}, the other symbols (sequence lengths) {16, 32, 48}
+int64_t GridBase(const int64_t symbol) { return symbol == 0 ? 1 : 16; }
+
+// lifetimes are inclusive topological order ranges
+bool Overlap(int64_t begin_a, int64_t end_a, int64_t begin_b, int64_t end_b) {
+  return begin_a <= end_b && begin_b <= end_a;
+}
+
+}  // namespace
+
+ActivationMemPlanner::ActivationMemPlanner(const int64_t num_symbols, const size_t align_size)
+    : num_symbols_(num_symbols), align_size_(align_size) {
+  CHECK_GT(num_symbols_, 0) << "ActivationMemPlanner needs at least one symbol...";
+  LOG_IF(WARNING, num_symbols_ > 3) << "ActivationMemPlanner probes 3^" << num_symbols_
+                                    << " input shapes, too many symbols make the planning slow...";
+  for (int64_t k = 0; k < num_symbols_; ++k) {
+    const int64_t base = GridBase(k);
+    grid_.push_back({base, 2 * base, 3 * base});
+    validation_point_.push_back(5 * base);
+  }
+}
+
+vector<vector<int64_t>> ActivationMemPlanner::ProbePoints() const {
+  vector<vector<int64_t>> points;
+  int64_t grid_size = 1;
+  for (int64_t k = 0; k < num_symbols_; ++k) grid_size *= 3;
+  for (int64_t g = 0; g < grid_size; ++g) {
+    vector<int64_t> point(num_symbols_);
+    for (int64_t k = 0, rest = g; k < num_symbols_; ++k, rest /= 3) point[k] = grid_[k][rest % 3];
+    points.push_back(point);
+  }
+  points.push_back(validation_point_);
+  return points;
+}
+
+ActivationMemPlanner::SymbolicTensor& ActivationMemPlanner::FindOrAdd(const string& name) {
+  auto iter = tensor_index_.find(name);
+  if (iter != tensor_index_.end()) return tensors_[iter->second];
+  int64_t grid_size = 1;
+  for (int64_t k = 0; k < num_symbols_; ++k) grid_size *= 3;
+  SymbolicTensor tensor;
+  tensor.name = name;
+  tensor.grid_bytes.assign(grid_size, 0);
+  tensor_index_[name] = tensors_.size();
+  tensors_.push_back(tensor);
+  return tensors_.back();
+}
+
+void ActivationMemPlanner::AddProbe(const vector<int64_t>& symbol_values,
+                                    const unordered_map<string, size_t>& tensor_bytes) {
+  CHECK_EQ(symbol_values.size(), num_symbols_) << "ActivationMemPlanner probe has wrong symbol number...";
+  // the grid index if the point is on the grid
+  int64_t grid_index = 0;
+  for (int64_t k = num_symbols_ - 1; k >= 0; --k) {
+    auto iter = std::find(grid_[k].begin(), grid_[k].end(), symbol_values[k]);
+    if (iter == grid_[k].end()) {
+      grid_index = -1;
+      break;
+    }
+    grid_index = grid_index * 3 + (iter - grid_[k].begin());
+  }
+  for (const auto& item : tensor_bytes) {
+    SymbolicTensor& tensor = FindOrAdd(item.first);
+    tensor.max_bytes = std::max(tensor.max_bytes, item.second);
+    if (grid_index >= 0) tensor.grid_bytes[grid_index] = item.second;
+  }
+  if (grid_index < 0) off_grid_probes_.push_back({symbol_values, tensor_bytes});
+}
+
+double ActivationMemPlanner::Interpolate(const SymbolicTensor& tensor, const vector<int64_t>& symbol_values) const {
+  // the 1D Lagrange basis of each symbol on its 3 grid values
+  vector<std::array<double, 3>> basis(num_symbols_);
+  for (int64_t k = 0; k < num_symbols_; ++k) {
+    const double x = symbol_values[k];
+    for (int i = 0; i < 3; ++i) {
+      double l = 1.0;
+      for (int j = 0; j < 3; ++j) {
+        if (j != i) l *= (x - grid_[k][j]) / static_cast<double>(grid_[k][i] - grid_[k][j]);
+      }
+      basis[k][i] = l;
+    }
+  }
+  double value = 0;
+  for (int64_t g = 0; g < tensor.grid_bytes.size(); ++g) {
+    if (tensor.grid_bytes[g] == 0) continue;
+    double weight = 1.0;
+    for (int64_t k = 0, rest = g; k < num_symbols_; ++k, rest /= 3) weight *= basis[k][rest % 3];
+    value += weight * tensor.grid_bytes[g];
+  }
+  return value;
+}
+
+size_t ActivationMemPlanner::Bytes(const SymbolicTensor& tensor, const vector<int64_t>& symbol_values) const {
+  if (!tensor.fitted) return tensor.max_bytes;
+  const double value = std::round(Interpolate(tensor, symbol_values));
+  return value > 0 ? static_cast<size_t>(value) : 0;
+}
+
+size_t ActivationMemPlanner::Bytes(const string& name, const vector<int64_t>& symbol_values) const {
+  auto alias = alias2memory_.find(name);
+  auto iter = tensor_index_.find(alias == alias2memory_.end() ? name : alias->second);
+  if (iter == tensor_index_.end()) return 0;
+  return Bytes(tensors_[iter->second], symbol_values);
+}
+
+void ActivationMemPlanner::Build(const ActivationDAG& dag) {
+  // validate the fitting
+  for (const auto& probe : off_grid_probes_) {
+    for (const auto& item : probe.second) {
+      SymbolicTensor& tensor = FindOrAdd(item.first);
+      if (tensor.fitted && std::abs(Interpolate(tensor, probe.first) - item.second) > 0.5) {
+        DLOG(INFO) << "activation tensor " << tensor.name << " size is not polynomial of the input symbols";
+        tensor.fitted = false;
+      }
+    }
+  }
+  // lifetimes, the outputs which are never consumed (model outputs) live until the end
+  int64_t last_order = 0;
+  for (const auto& op : dag.operators()) {
+    const int64_t order = op->topological_order();
+    last_order = std::max(last_order, order);
+    for (const auto& out_tensor : op->output()) {
+      SymbolicTensor& tensor = FindOrAdd(out_tensor->name());
+      if (tensor.life_begin < 0) tensor.life_begin = order;
+    }
+    for (const auto& in_tensor : op->input()) {
+      SymbolicTensor& tensor = FindOrAdd(in_tensor->name());
+      tensor.life_end = std::max(tensor.life_end, order);
+    }
+  }
+  for (auto& tensor : tensors_) {
+    if (tensor.life_begin < 0) tensor.life_begin = 0;
+    if (tensor.life_end < tensor.life_begin) tensor.life_end = last_order;
+  }
+  inplace_alias_ = dag.inplace_alias_holder();
+  alias2memory_.clear();
+  for (const auto& alias : inplace_alias_) {
+    for (const auto& name : alias.second) alias2memory_[name] = alias.first;
+  }
+
+  // greedy by size at the largest probe point
+  vector<size_t> ref_bytes(tensors_.size());
+  vector<int> order(tensors_.size());
+  for (int i = 0; i < tensors_.size(); ++i) ref_bytes[i] = Bytes(tensors_[i], validation_point_);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return ref_bytes[a] > ref_bytes[b]; });
+  blocks_.clear();
+  vector<size_t> block_ref_bytes;
+  for (int t : order) {
+    const auto& tensor = tensors_[t];
+    bool find_suitable_block = false;
+    for (int b = blocks_.size() - 1; b >= 0 && !find_suitable_block; --b) {
+      if (block_ref_bytes[b] < ref_bytes[t]) continue;
+      bool overlap = false;
+      for (int other : blocks_[b]) {
+        if (Overlap(tensor.life_begin, tensor.life_end, tensors_[other].life_begin, tensors_[other].life_end)) {
+          overlap = true;
+          break;
+        }
+      }
+      if (!overlap) {
+        blocks_[b].push_back(t);
+        find_suitable_block = true;
+      }
+    }
+    if (!find_suitable_block) {
+      blocks_.push_back({t});
+      block_ref_bytes.push_back(ref_bytes[t]);
+    }
+  }
+  planned_values_.clear();
+  LOG(INFO) << "symbolic activation planning: " << tensors_.size() << " tensors in " << blocks_.size()
+            << " shared blocks";
+}
+
+vector<string> ActivationMemPlanner::UnfittedNames() const {
+  vector<string> names;
+  for (const auto& tensor : tensors_) {
+    if (tensor.fitted) continue;
+    names.push_back(tensor.name);
+    auto alias = inplace_alias_.find(tensor.name);
+    if (alias != inplace_alias_.end()) names.insert(names.end(), alias->second.begin(), alias->second.end());
+  }
+  return names;
+}
+
+void ActivationMemPlanner::Plan(const vector<int64_t>& symbol_values,
+                                const unordered_map<string, size_t>& real_bytes) {
+  CHECK_EQ(symbol_values.size(), num_symbols_) << "ActivationMemPlanner plan has wrong symbol number...";
+  // the real bytes of the unfitted tensors, the largest one of the inplace aliases
+  unordered_map<int, size_t> unfitted_bytes;
+  for (const auto& item : real_bytes) {
+    auto alias = alias2memory_.find(item.first);
+    auto iter = tensor_index_.find(alias == alias2memory_.end() ? item.first : alias->second);
+    if (iter == tensor_index_.end() || tensors_[iter->second].fitted) continue;
+    unfitted_bytes[iter->second] = std::max(unfitted_bytes[iter->second], item.second);
+  }
+  offsets_.clear();
+  block_bytes_.clear();
+  size_t offset = 0;
+  size_t raw_bytes = 0;
+  for (const auto& block : blocks_) {
+    size_t bytes = 0;
+    for (int t : block) {
+      auto real = unfitted_bytes.find(t);
+      const size_t tensor_bytes = real == unfitted_bytes.end() ? Bytes(tensors_[t], symbol_values) : real->second;
+      raw_bytes += tensor_bytes;
+      bytes = std::max(bytes, tensor_bytes);
+    }
+    bytes = (bytes + align_size_ - 1) / align_size_ * align_size_;
+    for (int t : block) {
+      const string& name = tensors_[t].name;
+      offsets_[name] = offset;
+      block_bytes_[name] = bytes;
+      auto alias = inplace_alias_.find(name);
+      if (alias == inplace_alias_.end()) continue;
+      for (const auto& alias_name : alias->second) {
+        offsets_[alias_name] = offset;
+        block_bytes_[alias_name] = bytes;
+      }
+    }
+    offset += bytes;
+  }
+  total_bytes_ = offset;
+  planned_values_ = symbol_values;
+  DLOG(INFO) << "activation buffer raw bytes: " << raw_bytes << " planned bytes: " << total_bytes_;
+}
+
+void ActivationMemPlanner::Observe(const string& name, const size_t bytes) {
+  auto alias = alias2memory_.find(name);
+  SymbolicTensor& tensor = FindOrAdd(alias == alias2memory_.end() ? name : alias->second);
+  if (tensor.fitted) {
+    LOG(WARNING) << "activation tensor " << tensor.name << " needs " << bytes
+                 << " bytes which is larger than its symbolic size, plan its max bytes instead...";
+  }
+  tensor.fitted = false;
+  tensor.max_bytes = std::max(tensor.max_bytes, bytes);
+  // a new tensor gets a block of its own
+  if (tensor.life_begin < 0) {
+    tensor.life_begin = 0;
+    tensor.life_end = std::numeric_limits<int64_t>::max();
+    blocks_.push_back({tensor_index_[tensor.name]});
+  }
+}
+
+}  // namespace executor
@@ -14,6 +14,11 @@
 #include "common.hpp"
 
 #include "cmath"
+#include "numa_topology.hpp"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 
 namespace executor {
 
@@ -31,6 +36,17 @@ const int ALIGN_NUM = 64;
 const int ALIGN_NUM = 32;
 #endif
 
+DataType StringToDataType(const string& dtype) {
+  static const unordered_map<string, DataType> str2type = {
+      {"s4", DataType::s4},     {"f8_e4m3", DataType::f8_e4m3}, {"f8_e5m2", DataType::f8_e5m2},
+      {"u8", DataType::u8},     {"s8", DataType::s8},           {"int8", DataType::s8},
+      {"u16", DataType::u16},   {"s16", DataType::s16},         {"fp16", DataType::fp16},
+      {"bf16", DataType::bf16}, {"fp32", DataType::fp32},       {"s32", DataType::s32},
+      {"int32", DataType::s32}, {"s64", DataType::s64},         {"int64", DataType::s64}};
+  auto iter = str2type.find(dtype);
+  return iter == str2type.end() ? DataType::undef : iter->second;
+}
+
 void GlobalInit(const char* pname) {
   // Google logging.
   ::google::InitGoogleLogging(pname);
@@ -47,19 +63,37 @@ Args:
     location gives the info of tensor data location in .bin file
       location[0] is the start idx when sotre the data bytes
       location[1] is the data bytes length
+    options gives the huge pages and NUMA policy of the memory
 Return:
     void* ptr, points a consecutive memory that sotres the data
 */
-void* read_file_to_type(const string& root, const string& type, const vector<int64_t>& shape,
-                        const vector<int64_t>& location) {
-  int b = type2bytes[type];
+void* read_file_to_type(const string& root, const DataType type, const vector<int64_t>& shape,
+                        const vector<int64_t>& location, const ExecutionOptions& options) {
+  int b = DataTypeBytes(type);
   if (b == 0) {
-    DLOG(INFO) << type << " not implemented yet...";
+    DLOG(INFO) << static_cast<int>(type) << " not implemented yet...";
   }
 
   int64_t size = Product(shape);
-  // from file tensor will directly malloc memory
-  void* p = reinterpret_cast<void*>(aligned_alloc(ALIGNMENT, (size * b / ALIGNMENT + 1) * ALIGNMENT));
+  // from file tensor will directly malloc memory, the operators may free it so it has to stay a heap block.
+  // a large one is aligned to the huge page size and advised to use huge pages, and its policy is set before the
+  // file read below faults it in.
+  static const NumaTopology topology(true);
+  static const size_t huge_page = NumaTopology::HugePageSize();
+  const bool use_huge_page = options.weight_huge_pages && huge_page > 0 && size * b >= huge_page;
+  const size_t align = use_huge_page ? huge_page : ALIGNMENT;
+  // a huge-page weight is only rounded up to whole pages, the others keep their spare ALIGNMENT tail
+  const size_t bytes = use_huge_page ? (size * b + align - 1) / align * align : (size * b / align + 1) * align;
+  void* p = reinterpret_cast<void*>(aligned_alloc(align, bytes));
+#ifndef _WIN32
+  if (use_huge_page && madvise(p, bytes, MADV_HUGEPAGE) != 0) {
+    LOG_FIRST_N(WARNING, 1) << "madvise(MADV_HUGEPAGE) failed, the weights use normal pages...";
+  }
+#endif
+  topology.SetMemPolicy(p, bytes, options.weight_mem_policy, options.numa_node);
+  LOG_FIRST_N(INFO, 1) << "Weights of " << (huge_page >> 10) << " kB or more use "
+                       << (options.weight_huge_pages && huge_page > 0 ? "transparent huge pages" : "normal pages")
+                       << ", NUMA policy " << options.weight_mem_policy;
 
   std::ifstream inFile(root, std::ios::in | std::ios::binary);
   if (inFile) {
@@ -0,0 +1,276 @@
+//  Copyright (c) 2023 Intel Corporation
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#include "dynamic_batcher.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace executor {
+
+namespace {
+
+int64_t SubProduct(const vector<int64_t>& shape, const int begin) {
+  int64_t product = 1;
+  for (int i = begin; i < shape.size(); ++i) product *= shape[i];
+  return product;
+}
+
+// the input carries the sequence dim if its dim 1 is the sequence length of the request
+bool IsSeqInput(const ServingRequest& request, const int i) {
+  const auto& shape = request.inputs[i].shape();
+  return shape.size() > 1 && shape[1] == request.seq_len;
+}
+
+// requests can be batched together if their inputs only differ in batch and sequence dims
+bool Batchable(const ServingRequest& a, const ServingRequest& b) {
+  if (a.inputs.size() != b.inputs.size()) return false;
+  for (int i = 0; i < a.inputs.size(); ++i) {
+    const auto& a_shape = a.inputs[i].shape();
+    const auto& b_shape = b.inputs[i].shape();
+    if (a.inputs[i].dtype() != b.inputs[i].dtype() || a_shape.size() != b_shape.size()) return false;
+    if (a_shape.size() > 1 && IsSeqInput(a, i) != IsSeqInput(b, i)) return false;
+    if (a_shape.size() > 1 && !IsSeqInput(a, i) && a_shape[1] != b_shape[1]) return false;
+    for (int axis = 2; axis < a_shape.size(); ++axis) {
+      if (a_shape[axis] != b_shape[axis]) return false;
+    }
+  }
+  return true;
+}
+
+// write value 1 of the mask dtype
+void FillOnes(char* dst, const int64_t num, const DataType dtype) {
+  switch (dtype) {
+    case DataType::fp32:
+      std::fill_n(reinterpret_cast<float*>(dst), num, 1.f);
+      break;
+    case DataType::s64:
+      std::fill_n(reinterpret_cast<int64_t*>(dst), num, 1);
+      break;
+    case DataType::s32:
+      std::fill_n(reinterpret_cast<int32_t*>(dst), num, 1);
+      break;
+    case DataType::s8:
+    case DataType::u8:
+      std::fill_n(dst, num, 1);
+      break;
+    default:
+      LOG(FATAL) << "DynamicBatcher can't generate the attention mask of DataType " << static_cast<int>(dtype) << "...";
+  }
+}
+
+}  // namespace
+
+DynamicBatcher::DynamicBatcher(const BatchingOptions& options) : options_(options) {
+  CHECK_GT(options_.max_batch_size, 0) << "DynamicBatcher max batch size should be positive...";
+  CHECK_GE(options_.max_delay_us, 0) << "DynamicBatcher max delay should not be negative...";
+  CHECK_GT(options_.pad_to_multiple, 0) << "DynamicBatcher pad_to_multiple should be positive...";
+  CHECK(std::is_sorted(options_.seq_len_buckets.begin(), options_.seq_len_buckets.end()))
+      << "DynamicBatcher sequence length buckets should be ascending...";
+}
+
+int64_t DynamicBatcher::SeqLen(const vector<Tensor>& inputs) {
+  if (inputs.empty() || inputs[0].shape().size() < 2) return 1;
+  return inputs[0].shape()[1];
+}
+
+int64_t DynamicBatcher::Bucket(const int64_t seq_len) const {
+  const auto& bounds = options_.seq_len_buckets;
+  if (bounds.empty()) return std::numeric_limits<int64_t>::max();
+  auto iter = std::lower_bound(bounds.begin(), bounds.end(), seq_len);
+  return iter == bounds.end() ? seq_len : *iter;
+}
+
+int64_t DynamicBatcher::Push(const vector<Tensor>& inputs, const ServingCallback& callback) {
+  CHECK_EQ(inputs.empty(), false) << "DynamicBatcher request has no input...";
+  for (const auto& input : inputs) {
+    LOG_IF(FATAL, input.shape().empty() || input.shape()[0] != 1)
+        << "DynamicBatcher request should carry one sample, input " << input.name() << " has wrong batch size...";
+  }
+  if (options_.mask_input_index >= 0) {
+    CHECK_LT(options_.mask_input_index, inputs.size()) << "DynamicBatcher request has no attention mask input...";
+  }
+  const int64_t seq_len = SeqLen(inputs);
+  int64_t request_id;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    request_id = next_request_id_++;
+    buckets_[Bucket(seq_len)].push_back({request_id, seq_len, inputs, callback, Clock::now()});
+    queued_num_++;
+    pending_num_++;
+  }
+  // a new request may fill up a bucket or start a deadline, wake up all the waiters to re-check
+  queue_cond_.notify_all();
+  return request_id;
+}
+
+std::map<int64_t, std::list<ServingRequest>>::iterator DynamicBatcher::ReleasedBucket(
+    const Clock::time_point& now, Clock::time_point* deadline) {
+  const auto delay = std::chrono::microseconds(options_.max_delay_us);
+  auto released = buckets_.end();
+  *deadline = Clock::time_point::max();
+  for (auto iter = buckets_.begin(); iter != buckets_.end(); ++iter) {
+    if (iter->second.empty()) continue;
+    const auto& head = iter->second.front();
+    const auto head_deadline = head.arrival + delay;
+    if (stop_ || iter->second.size() >= options_.max_batch_size || now >= head_deadline) {
+      if (released == buckets_.end() || head.arrival < released->second.front().arrival) released = iter;
+    } else {
+      *deadline = std::min(*deadline, head_deadline);
+    }
+  }
+  return released;
+}
+
+bool DynamicBatcher::Pop(vector<ServingRequest>* batch) {
+  batch->clear();
+  std::unique_lock<std::mutex> lock(lock_);
+  auto bucket = buckets_.end();
+  while (true) {
+    Clock::time_point deadline;
+    bucket = ReleasedBucket(Clock::now(), &deadline);
+    if (bucket != buckets_.end()) break;
+    // drain the queue before stop
+    if (queued_num_ == 0 && stop_) return false;
+    if (deadline == Clock::time_point::max()) {
+      queue_cond_.wait(lock);
+    } else {
+      queue_cond_.wait_until(lock, deadline);
+    }
+  }
+  auto& queue = bucket->second;
+  const ServingRequest& head = queue.front();
+  // the nearest sequence length to the oldest request first, then the older one first
+  vector<std::pair<int64_t, std::list<ServingRequest>::iterator>> candidates;
+  for (auto iter = std::next(queue.begin()); iter != queue.end(); ++iter) {
+    if (!Batchable(head, *iter)) continue;
+    candidates.push_back({std::abs(iter->seq_len - head.seq_len), iter});
+  }
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const std::pair<int64_t, std::list<ServingRequest>::iterator>& a,
+                      const std::pair<int64_t, std::list<ServingRequest>::iterator>& b) { return a.first < b.first; });
+  const int64_t num = std::min(static_cast<int64_t>(candidates.size()), options_.max_batch_size - 1);
+  batch->push_back(std::move(queue.front()));
+  queue.pop_front();
+  for (int64_t i = 0; i < num; ++i) {
+    batch->push_back(std::move(*candidates[i].second));
+    queue.erase(candidates[i].second);
+  }
+  if (queue.empty()) buckets_.erase(bucket);
+  queued_num_ -= batch->size();
+  // the rest of the bucket may still be released for another caller
+  if (queued_num_ > 0) queue_cond_.notify_one();
+  return true;
+}
+
+void DynamicBatcher::Done(const int64_t num) {
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    pending_num_ -= num;
+  }
+  done_cond_.notify_all();
+}
+
+void DynamicBatcher::Wait() {
+  std::unique_lock<std::mutex> lock(lock_);
+  done_cond_.wait(lock, [this] { return pending_num_ == 0; });
+}
+
+void DynamicBatcher::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    stop_ = true;
+  }
+  queue_cond_.notify_all();
+}
+
+int64_t DynamicBatcher::PaddedLen(const vector<ServingRequest>& batch) const {
+  int64_t max_len = 0;
+  for (const auto& request : batch) max_len = std::max(max_len, request.seq_len);
+  return (max_len + options_.pad_to_multiple - 1) / options_.pad_to_multiple * options_.pad_to_multiple;
+}
+
+vector<Tensor> DynamicBatcher::Pack(const vector<ServingRequest>& batch, vector<vector<char>>* buffers) const {
+  CHECK_EQ(batch.empty(), false) << "DynamicBatcher can't pack an empty batch...";
+  const int64_t batch_size = batch.size();
+  const int64_t padded_len = PaddedLen(batch);
+  const auto& head = batch[0];
+  vector<Tensor> batch_inputs;
+  buffers->resize(head.inputs.size());
+  for (int i = 0; i < head.inputs.size(); ++i) {
+    const bool is_mask = i == options_.mask_input_index;
+    const bool pad_seq = IsSeqInput(head, i);
+    const string& dtype = head.inputs[i].dtype();
+    // feed the request tensor as it is if there is nothing to concat or pad
+    if (batch_size == 1 && (!pad_seq || padded_len == head.seq_len) &&
+        (!is_mask || head.inputs[i].raw_data() != nullptr)) {
+      batch_inputs.push_back(head.inputs[i]);
+      continue;
+    }
+    vector<int64_t> shape = head.inputs[i].shape();
+    const int64_t type_bytes = DataTypeBytes(head.inputs[i].data_type());
+    shape[0] = batch_size;
+    if (pad_seq) shape[1] = padded_len;
+    const int64_t row_bytes = SubProduct(shape, pad_seq ? 2 : 1) * type_bytes;
+    const int64_t sample_bytes = (pad_seq ? padded_len : 1) * row_bytes;
+    auto& buffer = (*buffers)[i];
+    buffer.resize(batch_size * sample_bytes);
+    for (int64_t b = 0; b < batch_size; ++b) {
+      const Tensor& src = batch[b].inputs[i];
+      const int64_t copy_bytes = (pad_seq ? batch[b].seq_len : 1) * row_bytes;
+      char* dst = buffer.data() + b * sample_bytes;
+      if (is_mask && src.raw_data() == nullptr) {
+        FillOnes(dst, copy_bytes / type_bytes, head.inputs[i].data_type());
+      } else {
+        memcpy(dst, src.raw_data(), copy_bytes);
+      }
+      memset(dst + copy_bytes, 0, sample_bytes - copy_bytes);
+    }
+    batch_inputs.push_back(Tensor(buffer.data(), shape, dtype, {}, {}, head.inputs[i].name()));
+  }
+  return batch_inputs;
+}
+
+vector<vector<Tensor>> DynamicBatcher::Unpack(const vector<ServingRequest>& batch, const int64_t padded_len,
+                                              vector<Tensor>* outputs) const {
+  const int64_t batch_size = batch.size();
+  const auto& seq_axes = options_.output_seq_axes;
+  vector<vector<Tensor>> sample_outputs(batch_size);
+  for (int64_t b = 0; b < batch_size; ++b) {
+    for (int i = 0; i < outputs->size(); ++i) {
+      Tensor& output = (*outputs)[i];
+      vector<int64_t> shape = output.shape();
+      char* data = static_cast<char*>(output.mutable_data());
+      if (!shape.empty() && shape[0] == batch_size) {
+        data += b * SubProduct(shape, 1) * DataTypeBytes(output.data_type());
+        shape[0] = 1;
+        // only the declared sequence axis is cut, a hidden or vocab dim may equal padded_len as well
+        const int64_t seq_axis = i < seq_axes.size() ? seq_axes[i] : -1;
+        if (seq_axis > 0 && seq_axis < shape.size()) {
+          LOG_IF(FATAL, shape[seq_axis] != padded_len)
+              << "DynamicBatcher output " << output.name() << " axis " << seq_axis << " is " << shape[seq_axis]
+              << ", not the padded sequence length " << padded_len << "...";
+          shape[seq_axis] = batch[b].seq_len;
+        }
+      }
+      sample_outputs[b].push_back(Tensor(data, shape, output.dtype(), {}, {}, output.name()));
+    }
+  }
+  return sample_outputs;
+}
+
+}  // namespace executor
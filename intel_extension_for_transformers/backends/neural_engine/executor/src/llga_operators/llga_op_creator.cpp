@@ -446,6 +446,10 @@ bool LLGAOPCreator::CreateLayerNormOp(LLGAINFO* llga_info, const shared_ptr<Oper
     DLOG(INFO) << "transpose_mode attribute of LayerNorm is not supported by llga";
     return false;
   }
+  if (op_conf->input_tensor_size() > 3 || op_conf->output_tensor_size() > 1) {
+    DLOG(INFO) << "LayerNorm with a fused Quantize is not supported by llga";
+    return false;
+  }
 
   llga_op layernorm_op(llga_info->GetOPIndex(), llga_op::kind::LayerNorm, inputs, outputs,
                        "layernorm" + to_string(llga_info->GetOPIndex()));
@@ -697,12 +701,12 @@ bool LLGAOPCreator::CreateDequantizeOp(LLGAINFO* llga_info, const shared_ptr<Ope
     int64_t zps_size = inputs[2].get_dims()[0];
     if (zps_size == 1) {  // llga only supports one element zp
       Tensor* zps = llga_info->GetTensorByID(inputs[2].get_id());
-      if (zps->dtype() == "s8") {
+      if (zps->data_type() == DataType::s8) {
         int8_t* zps_data = static_cast<int8_t*>(zps->mutable_data());
         for (int i = 0; i < zps_size; ++i) {
           zps_vec.emplace_back(static_cast<int64_t>(zps_data[i]));
         }
-      } else if (zps->dtype() == "u8") {
+      } else if (zps->data_type() == DataType::u8) {
         uint8_t* zps_data = static_cast<uint8_t*>(zps->mutable_data());
         for (int i = 0; i < zps_size; ++i) {
           zps_vec.emplace_back(static_cast<int64_t>(zps_data[i]));
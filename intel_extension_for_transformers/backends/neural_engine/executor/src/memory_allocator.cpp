@@ -14,31 +14,307 @@
 
 #include "memory_allocator.hpp"
 
+#include <algorithm>
+
 namespace executor {
 
-std::unique_ptr<StaticCompressedBuffer> MemoryAllocator::scpb_manager_;
+namespace {
+
+enum ActiveStrategy : int {
+  kUndefStrategy = 0,
+  kCycleBuffer,
+  kDirectBuffer,
+  kUnifiedBuffer,
+  kStaticCompressedBuffer,
+};
+
+// idle cycle buffers are handed out again until TrimIdleBuffers frees them
+void Enqueue(MemoryAllocator::ThreadArena* arena, void* data, MemoryAllocator::BufferInfo* info) {
+  if (info->kind != MemoryAllocator::BufferKind::cycle) return;
+  info->idle_pass = arena->pass;
+  if (info->queued) return;
+  arena->free_lists[info->size_class].push_back(data);
+  info->queued = true;
+}
+
+}  // namespace
+
+constexpr size_t MemoryAllocator::kSizeClassUnit;
+constexpr int MemoryAllocator::kNumSizeClasses;
+constexpr int MemoryAllocator::kMaxClassSkip;
+constexpr uint32_t MemoryAllocator::kMaxIdlePasses;
+std::atomic<int> MemoryAllocator::active_strategy_(kUndefStrategy);
+
+MemoryAllocator::ThreadArena& MemoryAllocator::Arena() {
+  // never destroyed, tensors may still be unreffed during static destruction
+  static thread_local ThreadArena* arena = new ThreadArena();
+  return *arena;
+}
+
+int MemoryAllocator::SizeClass(const size_t size) {
+  const size_t units = std::max(size / kSizeClassUnit + (size % kSizeClassUnit != 0), static_cast<size_t>(1));
+  if (units <= 4) return units - 1;
+  // (units - 1) is in [2^p, 2^(p+1)), split the range into 4 classes
+  int p = 0;
+  for (size_t v = units - 1; v > 1; v >>= 1) ++p;
+  return 4 * (p - 2) + ((units - 1) >> (p - 2));
+}
+
+size_t MemoryAllocator::SizeClassBytes(const int size_class) {
+  if (size_class < 4) return (size_class + 1) * kSizeClassUnit;
+  const int p = size_class / 4 + 1;
+  const size_t m = size_class % 4 + 4;
+  return ((m + 1) << (p - 2)) * kSizeClassUnit;
+}
+
+std::shared_ptr<StaticCompressedBuffer> MemoryAllocator::InitCompressedBufferManager(const ActivationDAG& dag,
+                                                                                      const bool& debug_mode) {
+  std::shared_ptr<StaticCompressedBuffer> buffer = std::make_shared<StaticCompressedBuffer>(dag, debug_mode);
+  BindCompressedBuffer(buffer);
+  return buffer;
+}
+
+std::shared_ptr<StaticCompressedBuffer> MemoryAllocator::InitSymbolicBufferManager(
+    std::shared_ptr<ActivationMemPlanner> planner) {
+  std::shared_ptr<StaticCompressedBuffer> buffer = std::make_shared<StaticCompressedBuffer>(planner);
+  BindCompressedBuffer(buffer);
+  return buffer;
+}
 
-void MemoryAllocator::InitCompressedBufferManager(const ActivationDAG& dag, const bool& debug_mode) {
-  std::unique_ptr<StaticCompressedBuffer> scpb_ptr(new StaticCompressedBuffer(dag, debug_mode));
-  scpb_manager_ = std::move(scpb_ptr);
+void MemoryAllocator::BindCompressedBuffer(std::shared_ptr<StaticCompressedBuffer> buffer) {
+  Arena().compressed_buffer = std::move(buffer);
+}
+
+void MemoryAllocator::SetName(void* data, const string name) {
+  ThreadArena& arena = Arena();
+  if (arena.buffers.count(data) != 0) {
+    arena.names[data] = name;
+  } else {
+    DLOG(WARNING) << "name a not existing pointer...";
+  }
+}
+
+int MemoryAllocator::AliveBuffer() {
+  ThreadArena& arena = Arena();
+  int alive = 0;
+  for (const auto& buffer : arena.buffers) {
+    if (buffer.second.life != 0) {
+      alive++;
+      DLOG(WARNING) << "have alive buffer name " << arena.names[buffer.first];
+    }
+  }
+  DLOG(WARNING) << "buffer alive count " << alive;
+  return alive;
+}
+
+void MemoryAllocator::ReleaseBuffer() {
+  ThreadArena& arena = Arena();
+  for (auto& buffer : arena.buffers) {
+    if (buffer.second.life != 0) {
+      DLOG(WARNING) << "buffer still have life, force release...";
+      buffer.second.life = 0;
+      Enqueue(&arena, buffer.first, &buffer.second);
+    }
+  }
+}
+
+void MemoryAllocator::TrimIdleBuffers() {
+  ThreadArena& arena = Arena();
+  arena.pass++;
+  for (auto& free_list : arena.free_lists) {
+    auto kept = free_list.begin();
+    for (void* buf : free_list) {
+      auto iter = arena.buffers.find(buf);
+      BufferInfo& info = iter->second;
+      // revived by ResetMemory after it was queued
+      if (info.life != 0) {
+        info.queued = false;
+      } else if (arena.pass - info.idle_pass > kMaxIdlePasses) {
+        arena.cycle_bytes -= SizeClassBytes(info.size_class);
+        aligned_free(buf);
+        arena.names.erase(buf);
+        arena.buffers.erase(iter);
+      } else {
+        *kept++ = buf;
+      }
+    }
+    free_list.erase(kept, free_list.end());
+  }
+}
+
+size_t MemoryAllocator::CycleBufferBytes() { return Arena().cycle_bytes; }
+
+void MemoryAllocator::SetStrategy(const string strategy) {
+  CHECK(strategy == "cycle_buffer" || strategy == "direct_buffer" || strategy == "unified_buffer" ||
+        strategy == "static_compressed_buffer")
+      << "only support memory strategy cycle buffer, direct buffer, unified buffer and static compressed buffer";
+  StrategyList& strategy_list = Strategy();
+  strategy_list[strategy] = true;
+  // the same priority as before when several strategies are set
+  int active = kUndefStrategy;
+  if (strategy_list["static_compressed_buffer"]) {
+    active = kStaticCompressedBuffer;
+  } else if (strategy_list["direct_buffer"]) {
+    active = kDirectBuffer;
+  } else if (strategy_list["cycle_buffer"]) {
+    active = kCycleBuffer;
+  } else if (strategy_list["unified_buffer"]) {
+    active = kUnifiedBuffer;
+  }
+  active_strategy_.store(active, std::memory_order_release);
+  DLOG(INFO) << "strategy list set success " << strategy;
+}
+
+int MemoryAllocator::CheckMemory(void* data) {
+  ThreadArena& arena = Arena();
+  auto iter = arena.buffers.find(data);
+  if (iter == arena.buffers.end()) {
+    DLOG(WARNING) << "get life from a not existing memory pointer...";
+    return -1;
+  }
+  return iter->second.life;
+}
+
+void MemoryAllocator::ResetMemory(void* data, const int life_count) {
+  ThreadArena& arena = Arena();
+  auto iter = arena.buffers.find(data);
+  if (iter == arena.buffers.end()) {
+    DLOG(WARNING) << "reset a not existing memory pointer...";
+    return;
+  }
+  iter->second.life = life_count;
+  if (life_count == 0) Enqueue(&arena, data, &iter->second);
+}
+
+int MemoryAllocator::UnrefMemory(void* data, bool inplace) {
+  ThreadArena& arena = Arena();
+  auto iter = arena.buffers.find(data);
+  if (iter == arena.buffers.end()) {
+    DLOG(WARNING) << "free not existing memory pointer...";
+    return -1;
+  }
+  BufferInfo& info = iter->second;
+  if (info.life <= 0) {
+    DLOG(WARNING) << "free a no-used memory...";
+    info.life = 0;
+  } else {
+    info.life--;
+  }
+  const int status = info.life;
+  if (status == 0) {
+    if (info.kind == BufferKind::cycle) {
+      Enqueue(&arena, data, &info);
+    } else if (!inplace && info.kind == BufferKind::direct) {
+      aligned_free(data);
+      arena.buffers.erase(iter);
+      arena.names.erase(data);
+    } else if (!inplace && info.kind == BufferKind::unified) {
+      i_free(data);
+      arena.buffers.erase(iter);
+      arena.names.erase(data);
+    }
+  }
+  return status;
+}
+
+void* MemoryAllocator::GetMemory(size_t size, const int life_count, const string& tensor_name) {
+  if (size == 0) {
+    DLOG(INFO) << "please set the tensor size...";
+    return nullptr;
+  }
+  if (life_count <= 0) {
+    DLOG(INFO) << "please set the tensor life...";
+    return nullptr;
+  }
+  switch (active_strategy_.load(std::memory_order_acquire)) {
+    case kStaticCompressedBuffer:
+      if (tensor_name != "") {
+        // activation memory allocation
+        return StaticCompressedBufferGetMemory(size, life_count, tensor_name);
+      }
+      // workspace and other memory allocation
+      // (TODO) it's not good to use one more memory management tools in one instance
+      return CycleBufferGetMemory(size, life_count);
+    case kDirectBuffer:
+      return DirectBufferGetMemory(size, life_count);
+    case kCycleBuffer:
+      return CycleBufferGetMemory(size, life_count);
+    case kUnifiedBuffer:
+      return UnifiedBufferGetMemory(size, life_count);
+    default:
+      LOG(ERROR) << "please set the memory strategy";
+      return nullptr;
+  }
 }
 
 void* MemoryAllocator::StaticCompressedBufferGetMemory(size_t size, const int life_count,
                                                        const string& tensor_name) {
   LOG_IF(FATAL, tensor_name == "") << "Please supply tensor name for StaticCompressedBuffer.";
+  ThreadArena& arena = Arena();
+  StaticCompressedBuffer* scpb_manager = arena.compressed_buffer.get();
+  LOG_IF(FATAL, scpb_manager == nullptr) << "StaticCompressedBuffer is not initialized.";
+  // the input shapes are beyond the planned ones, the planner takes it for the next re-layout
+  if (size > scpb_manager->GetBytesByName(tensor_name)) {
+    LOG(WARNING) << "tensor " << tensor_name << " needs " << size << " bytes, more than "
+                 << scpb_manager->GetBytesByName(tensor_name) << " bytes in static compressed buffer, "
+                 << "use cycle buffer instead...";
+    scpb_manager->Observe(tensor_name, size);
+    return CycleBufferGetMemory(size, life_count);
+  }
   void* buf;
   try {
-    buf = scpb_manager_->GetDataByName(tensor_name);
+    buf = scpb_manager->GetDataByName(tensor_name);
   } catch (...) {
     LOG(FATAL) << "tensor " << tensor_name << " is not in activation dag.";
   }
-  MemoryBuffer& scpb_mem_buffer = CompressedBuffer();
-  DLOG(INFO) << "static compressed buffer tensor size is " << scpb_mem_buffer.size();
-  if (scpb_mem_buffer.count(buf) == 0) {
-    scpb_mem_buffer.insert({buf, vector<size_t>({static_cast<size_t>(life_count), size})});
-  } else {
-    scpb_mem_buffer[buf] = vector<size_t>({static_cast<size_t>(life_count), size});
+  DLOG(INFO) << "static compressed buffer tensor size is " << arena.buffers.size();
+  auto iter = arena.buffers.find(buf);
+  LOG_IF(FATAL, iter != arena.buffers.end() && iter->second.kind != BufferKind::compressed)
+      << "Find data ptr " << buf << " in static compressed buffer and cycle buffer.";
+  arena.buffers[buf] = {life_count, size, BufferKind::compressed, -1, false, 0};
+  return buf;
+}
+
+void* MemoryAllocator::CycleBufferGetMemory(size_t size, const int life_count) {
+  ThreadArena& arena = Arena();
+  DLOG(INFO) << "cycle buffer tensor size is " << arena.buffers.size();
+  const int size_class = SizeClass(size);
+  // reuse an idle buffer of the class or a slightly larger one
+  const int last_class = std::min(size_class + kMaxClassSkip, kNumSizeClasses - 1);
+  for (int c = size_class; c <= last_class; ++c) {
+    auto& free_list = arena.free_lists[c];
+    while (!free_list.empty()) {
+      void* buf = free_list.back();
+      free_list.pop_back();
+      BufferInfo& info = arena.buffers[buf];
+      info.queued = false;
+      // revived by ResetMemory after it was queued
+      if (info.life != 0) continue;
+      info.life = life_count;
+      info.size = size;
+      return buf;
+    }
   }
+  // allocate new buffer
+  void* buf = reinterpret_cast<void*>(aligned_alloc(ALIGNMENT, SizeClassBytes(size_class)));
+  arena.buffers[buf] = {life_count, size, BufferKind::cycle, static_cast<int16_t>(size_class), false, 0};
+  arena.cycle_bytes += SizeClassBytes(size_class);
+  return buf;
+}
+
+void* MemoryAllocator::DirectBufferGetMemory(size_t size, const int life_count) {
+  ThreadArena& arena = Arena();
+  DLOG(INFO) << "direct buffer tensor size is " << arena.buffers.size();
+  void* buf = reinterpret_cast<void*>(aligned_alloc(ALIGNMENT, (size / ALIGNMENT + 1) * ALIGNMENT));
+  arena.buffers[buf] = {life_count, size, BufferKind::direct, -1, false, 0};
+  return buf;
+}
+
+void* MemoryAllocator::UnifiedBufferGetMemory(size_t size, const int life_count) {
+  ThreadArena& arena = Arena();
+  DLOG(INFO) << "unified buffer tensor size is " << arena.buffers.size();
+  void* buf = reinterpret_cast<void*>(i_malloc(size));
+  arena.buffers[buf] = {life_count, size, BufferKind::unified, -1, false, 0};
   return buf;
 }
 
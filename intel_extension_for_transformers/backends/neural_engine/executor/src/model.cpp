@@ -49,8 +49,8 @@ Model::~Model() {
     Profiling_ ProfilingWriter = Profiling_();
     ProfilingWriter.WriteProfiling(operators_, input_vecs_, output_vecs_);
   }
-  if (MemoryAllocator::SharedEnv()) {
-    RemoveSharedWeight(false);
+  if (execution_options_.weight_sharing) {
+    RemoveSharedWeight(false, removed_count_space_name_, "removed_count", "removed_count_mtx", shared_space_name_);
   }
 }
 
@@ -148,7 +148,9 @@ void Model::Init(const ModelConfig& conf) {
   InnerProductPrimitiveFwdFactory::ClearFactory();
   MatMulPrimitiveFwdFactory::ClearFactory();
   ConvolutionPrimitiveFwdFactory::ClearFactory();
-  InitSharedWeight();
+  shared_space_name_ = MemoryAllocator::SharedSpaceName(execution_options_.numa_node);
+  removed_count_space_name_ = MemoryAllocator::SharedSpaceName(execution_options_.numa_node, "RemovedCount");
+  InitSharedWeight(shared_space_name_);
   name_ = conf.name();
   MemoryAllocator::InitStrategy(execution_options_);
 #ifdef WIN32
@@ -245,33 +247,34 @@ void Model::Init(const ModelConfig& conf) {
   engine_profiling_ = (getenv("ENGINE_PROFILING") != NULL);  // profiling env
 }
 
-void Model::RemoveSharedWeight(bool is_begin, char* count_space_name, char* count_name, char* count_mtx_name,
-                               char* space_name) {
-  DLOG(INFO) << "Shared instance number: " << MemoryAllocator::InstNum();
-  ipc::managed_shared_memory count_shm(ipc::open_or_create, count_space_name, 512);
-  int* removed_count = count_shm.find_or_construct<int>(count_name)[sizeof(int)](0);
-  ipc::interprocess_mutex* mtx = count_shm.find_or_construct<ipc::interprocess_mutex>(count_mtx_name)();
+void Model::RemoveSharedWeight(bool is_begin, const string& count_space_name, const string& count_name,
+                               const string& count_mtx_name, const string& space_name) {
+  const int64_t inst_num = execution_options_.shared_instance_num;
+  DLOG(INFO) << "Shared instance number: " << inst_num;
+  ipc::managed_shared_memory count_shm(ipc::open_or_create, count_space_name.c_str(), 512);
+  int* removed_count = count_shm.find_or_construct<int>(count_name.c_str())[sizeof(int)](0);
+  ipc::interprocess_mutex* mtx = count_shm.find_or_construct<ipc::interprocess_mutex>(count_mtx_name.c_str())();
   mtx->lock();
   (*removed_count)++;
   mtx->unlock();
   if (is_begin) {  // In model init, remove shared space at the first thread
     if (*removed_count == 1) {
-      ipc::shared_memory_object::remove(space_name);
+      ipc::shared_memory_object::remove(space_name.c_str());
     }
-    if (*removed_count >= MemoryAllocator::InstNum()) {
-      ipc::shared_memory_object::remove(count_space_name);
+    if (*removed_count >= inst_num) {
+      ipc::shared_memory_object::remove(count_space_name.c_str());
     }
   } else {  // In model release, remove shared space at the last thread
-    if (*removed_count >= MemoryAllocator::InstNum()) {
-      ipc::shared_memory_object::remove(space_name);
-      ipc::shared_memory_object::remove(count_space_name);
+    if (*removed_count >= inst_num) {
+      ipc::shared_memory_object::remove(space_name.c_str());
+      ipc::shared_memory_object::remove(count_space_name.c_str());
     }
   }
 }
 
-void Model::InitSharedWeight(char* space_name) {
-  if (MemoryAllocator::SharedEnv()) {
-    RemoveSharedWeight(true);
+void Model::InitSharedWeight(const string& space_name) {
+  if (execution_options_.weight_sharing) {
+    RemoveSharedWeight(true, removed_count_space_name_, "removed_count", "removed_count_mtx", space_name);
     std::ifstream inFile(weight_root_, std::ios::in | std::ios::binary);
     size_t weight_size =
         inFile ? static_cast<size_t>(inFile.seekg(0, std::ios::end).tellg()) : static_cast<size_t>(weight_root_.size());
@@ -280,18 +283,27 @@ void Model::InitSharedWeight(char* space_name) {
     }
     // 2 * weight_size: an empirical value to check weight buffers could be
     // allocated enough in shared memory
-    static ipc::managed_shared_memory managed_shm(ipc::open_or_create, space_name, 2 * weight_size);
+    // keep one mapping per space alive, instances on different NUMA nodes use different spaces
+    static std::mutex managed_shm_lock;
+    static map<string, std::unique_ptr<ipc::managed_shared_memory>> managed_shms;
+    std::lock_guard<std::mutex> lock(managed_shm_lock);
+    if (managed_shms.count(space_name) == 0) {
+      std::unique_ptr<ipc::managed_shared_memory> managed_shm(
+          new ipc::managed_shared_memory(ipc::open_or_create, space_name.c_str(), 2 * weight_size));
+      managed_shms[space_name] = std::move(managed_shm);
+    }
   }
 }
 
-ipc::managed_shared_memory::handle_t Model::LoadSharedWeight(const string& root, const string& type,
+ipc::managed_shared_memory::handle_t Model::LoadSharedWeight(const string& root, const DataType type,
                                                              const vector<int64_t>& shape,
                                                              const vector<int64_t>& location) {
   int64_t size = Product(shape);
-  int64_t bytes = size * type2bytes[type];
+  int64_t bytes = size * DataTypeBytes(type);
   string weight_name = std::to_string(location[0]) + std::to_string(location[1]);
   std::ifstream inFile(root, std::ios::in | std::ios::binary);
-  void* shm_ptr = MemoryAllocator::ManagedShm().find_or_construct<char>(weight_name.c_str())[bytes](0);
+  auto& managed_shm = MemoryAllocator::ManagedShm(shared_space_name_);
+  void* shm_ptr = managed_shm.find_or_construct<char>(weight_name.c_str())[bytes](0);
   if (inFile) {
     inFile.seekg(location[0], std::ios::beg);
     inFile.read(reinterpret_cast<char*>(shm_ptr), location[1]);
@@ -299,7 +311,7 @@ ipc::managed_shared_memory::handle_t Model::LoadSharedWeight(const string& root,
   } else {
     std::memcpy(shm_ptr, &root[location[0]], location[1]);
   }
-  const auto& handle = MemoryAllocator::ManagedShm().get_handle_from_address(shm_ptr);
+  const auto& handle = managed_shm.get_handle_from_address(shm_ptr);
   return handle;
 }
 
@@ -352,13 +364,15 @@ void Model::SetOutput(const shared_ptr<OperatorConfig>& op_conf, const int opera
   if (op_type == "Input") {
     // parse weight here
     if (tensor_config->location().size() != 0) {
-      if (MemoryAllocator::SharedEnv()) {
+      if (execution_options_.weight_sharing) {
         auto handle =
-            LoadSharedWeight(weight_root_, tensor_config->dtype(), tensor_config->shape(), tensor_config->location());
+            LoadSharedWeight(weight_root_, tensor_ptr->data_type(), tensor_config->shape(), tensor_config->location());
+        tensor_ptr->set_shm_space(&MemoryAllocator::ManagedShm(shared_space_name_));
         tensor_ptr->set_shm_handle(handle);
       } else {
         void* weight_ptr =
-            read_file_to_type(weight_root_, tensor_config->dtype(), tensor_config->shape(), tensor_config->location());
+            read_file_to_type(weight_root_, tensor_ptr->data_type(), tensor_config->shape(), tensor_config->location(),
+                              execution_options_);
         tensor_ptr->set_data(weight_ptr);
       }
       return;
@@ -395,6 +409,7 @@ void Model::ActivationMemCompression(const vector<vector<vector<int64_t>>>& inpu
     DLOG(INFO) << "Skip activation memory compression due to the related flag is off...";
     return;
   }
+  activation_symbol_num_ = 0;
   if (!act_dag_handler_.update()) {
     act_dag_handler_ = ActivationDAGHandler(this);
   }
@@ -414,10 +429,91 @@ void Model::ActivationMemCompression(const vector<vector<vector<int64_t>>>& inpu
   }
   // init static compressed buffer
   bool debug_mode = execution_options_.execution_mode == ExecutionMode::DEBUG ? true : false;
-  MemoryAllocator::InitCompressedBufferManager(dag, debug_mode);
+  compressed_buffer_ = MemoryAllocator::InitCompressedBufferManager(dag, debug_mode);
   DLOG(INFO) << "Finish activation memory compression...";
 }
 
+void Model::SymbolicActivationMemCompression(const vector<vector<int64_t>>& symbolic_input_shapes) {
+  DLOG(INFO) << "Start to implement symbolic activation memory compression...";
+  if (!execution_options_.activation_mem_compression) {
+    DLOG(INFO) << "Skip symbolic activation memory compression due to the related flag is off...";
+    return;
+  }
+  symbolic_input_shapes_ = symbolic_input_shapes;
+  if (symbolic_input_shapes_.empty()) {
+    for (const auto& input_config : model_input_configs_) {
+      vector<int64_t> shape = input_config->shape();
+      for (int axis = 0; axis < shape.size(); ++axis) {
+        if (shape[axis] == -1) shape[axis] = axis == 0 ? -1 : -2;
+      }
+      symbolic_input_shapes_.push_back(shape);
+    }
+  }
+  CHECK_EQ(symbolic_input_shapes_.size(), model_input_tensors_.size())
+      << "symbolic input shapes size not equal with model input tensors size....";
+  activation_symbol_num_ = 0;
+  for (const auto& shape : symbolic_input_shapes_) {
+    for (const auto& dim : shape) activation_symbol_num_ = std::max(activation_symbol_num_, -dim);
+  }
+  if (activation_symbol_num_ == 0) {
+    LOG(WARNING) << "Model has no dynamic input dim, use its static input shapes instead...";
+    ActivationMemCompression({symbolic_input_shapes_});
+    return;
+  }
+  if (!act_dag_handler_.update()) {
+    act_dag_handler_ = ActivationDAGHandler(this);
+  }
+  std::shared_ptr<ActivationMemPlanner> planner = std::make_shared<ActivationMemPlanner>(activation_symbol_num_);
+  ActivationDAG dag;
+  for (const auto& symbol_values : planner->ProbePoints()) {
+    vector<vector<int64_t>> input_shapes = symbolic_input_shapes_;
+    for (auto& shape : input_shapes) {
+      for (auto& dim : shape) {
+        if (dim < 0) dim = symbol_values[-dim - 1];
+      }
+    }
+    ShapeInference(input_shapes);
+    dag = act_dag_handler_.GetDAG(operators_, input_vecs_, output_vecs_);
+    // the DAG keeps the max bytes, take the bytes of this probe from the model tensors
+    unordered_map<string, size_t> tensor_bytes;
+    for (const auto& op : dag.operators()) {
+      for (const auto& dag_tensor : op->output()) {
+        const Tensor* tensor = tensors_[tensor_name_index_[dag_tensor->semantic_alias()]];
+        tensor_bytes[dag_tensor->name()] = std::max(tensor_bytes[dag_tensor->name()], tensor->alloc_bytes());
+      }
+    }
+    planner->AddProbe(symbol_values, tensor_bytes);
+  }
+  if (execution_options_.dump_activation_dag) {
+    dag.Dump("activation_dag.yaml");
+  }
+  planner->Build(dag);
+  compressed_buffer_ = MemoryAllocator::InitSymbolicBufferManager(planner);
+  DLOG(INFO) << "Finish symbolic activation memory compression...";
+}
+
+vector<int64_t> Model::SymbolValues(const vector<vector<int64_t>>& input_shapes) const {
+  vector<int64_t> symbol_values(activation_symbol_num_, 1);
+  for (int i = 0; i < symbolic_input_shapes_.size(); ++i) {
+    for (int axis = 0; axis < symbolic_input_shapes_[i].size() && axis < input_shapes[i].size(); ++axis) {
+      const int64_t dim = symbolic_input_shapes_[i][axis];
+      // take the largest one if inputs disagree on a symbol
+      if (dim < 0) symbol_values[-dim - 1] = std::max(symbol_values[-dim - 1], input_shapes[i][axis]);
+    }
+  }
+  return symbol_values;
+}
+
+void Model::ReplanActivationBuffer(const vector<vector<int64_t>>& input_shapes) {
+  // the tensors whose bytes are not polynomial of the symbols are planned by their inferred shapes
+  unordered_map<string, size_t> real_bytes;
+  for (const auto& name : compressed_buffer_->planner()->UnfittedNames()) {
+    auto iter = tensor_name_index_.find(name);
+    if (iter != tensor_name_index_.end()) real_bytes[name] = tensors_[iter->second]->alloc_bytes();
+  }
+  compressed_buffer_->Replan(SymbolValues(input_shapes), real_bytes);
+}
+
 void Model::SetDispatchKernel(const bool& reshape_model) {
   if (execution_options_.execution_mode == ExecutionMode::TUNING) {
     for (int i = 0; i < operators_.size(); ++i) {
@@ -440,6 +536,10 @@ void Model::SetDispatchKernel(const bool& reshape_model) {
 vector<Tensor>& Model::Forward(vector<Tensor>& input_data) {
   CHECK_EQ(input_data.size(), model_input_tensors_.size())
       << "input data size not equal with model input tensor size....";
+  // free the activation buffers the recent passes have not taken, e.g. those of past input shapes
+  MemoryAllocator::TrimIdleBuffers();
+  // the activations of this model go to its own compressed buffer
+  if (compressed_buffer_ != nullptr) MemoryAllocator::BindCompressedBuffer(compressed_buffer_);
   // if we want use dynamic input data shape at run time, we should check the
   // input data shape and get the output shape, this should be necessary in each
   // Operator's Forward function
@@ -476,6 +576,13 @@ vector<Tensor>& Model::Forward(vector<Tensor>& input_data) {
     model_input_tensors_[i]->set_data(input_data[i].mutable_data());
     model_input_tensors_[i]->set_shape(input_data[i].shape());
   }
+  const bool replan_activation = activation_symbol_num_ > 0 && reshape_model;
+  vector<vector<int64_t>> input_shapes;
+  for (const auto& data : input_data) input_shapes.push_back(data.shape());
+  // the tuning runs the operators inside SetDispatchKernel, before the shape inference below
+  if (replan_activation && execution_options_.execution_mode == ExecutionMode::TUNING) {
+    ReplanActivationBuffer(input_shapes);
+  }
   SetDispatchKernel(reshape_model);
   if (execution_options_.execution_mode != ExecutionMode::TUNING) {
     if (reshape_model && engine_profiling_) {
@@ -524,13 +631,18 @@ vector<Tensor>& Model::Forward(vector<Tensor>& input_data) {
         }
       }
     }
+    if (replan_activation) ReplanActivationBuffer(input_shapes);
     int thread_count = 1;
     if (engine_profiling_) {
       for (int i = 0; i < operators_.size(); ++i) {
         DLOG(INFO) << "operator " << operators_[i]->name() << " gonna forward with type " << operators_[i]->type();
         if (multi_stream_flag && multi_stream_tasks_.find(i) != multi_stream_tasks_.end()) {
           int64_t start = Time();
-          tp.commitTask(std::bind(&executor::Dispatcher::Forward, operators_[i], input_vecs_[i], output_vecs_[i]));
+          tp.commitTask([this, i] {
+            // the pool thread allocates the activations of this model too
+            if (compressed_buffer_ != nullptr) MemoryAllocator::BindCompressedBuffer(compressed_buffer_);
+            operators_[i]->Forward(input_vecs_[i], output_vecs_[i]);
+          });
           int64_t end = Time();
           float forward_time = Duration(start, end);
           operators_[i]->set_latency(forward_time);
@@ -566,7 +678,10 @@ vector<Tensor>& Model::Forward(vector<Tensor>& input_data) {
       for (int i = 0; i < operators_.size(); ++i) {
         DLOG(INFO) << "operator " << operators_[i]->name() << " gonna forward with type " << operators_[i]->type();
         if (multi_stream_flag && multi_stream_tasks_.find(i) != multi_stream_tasks_.end()) {
-          tp.commitTask(std::bind(&executor::Dispatcher::Forward, operators_[i], input_vecs_[i], output_vecs_[i]));
+          tp.commitTask([this, i] {
+            if (compressed_buffer_ != nullptr) MemoryAllocator::BindCompressedBuffer(compressed_buffer_);
+            operators_[i]->Forward(input_vecs_[i], output_vecs_[i]);
+          });
           if (thread_count >= multi_stream_tasks_[i]) {
             tp.waitAllTaskRunOver();
             thread_count = 0;
@@ -664,7 +779,7 @@ void Model::ConstructLLGA(const vector<shared_ptr<OperatorConfig>>& op_configs)
       auto tensor_name = op_conf->input_tensors(0)->name();
       if (tensor_name_index_.count(tensor_name)) {
         auto src0_tensor = tensors_[tensor_name_index_[tensor_name]];
-        if (!src0_tensor->location().empty() && src0_tensor->dtype() == "s8") {
+        if (!src0_tensor->location().empty() && src0_tensor->data_type() == DataType::s8) {
           fallback = true;
         }
       }
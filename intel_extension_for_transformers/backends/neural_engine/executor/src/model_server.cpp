@@ -0,0 +1,125 @@
+//  Copyright (c) 2023 Intel Corporation
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#include "model_server.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace executor {
+
+ModelServer::ModelServer(const string& conf_file, const string& weight_root, const ServingOptions& options)
+    : conf_file_(conf_file),
+      weight_root_(weight_root),
+      options_(options),
+      topology_(options.use_logical_cores),
+      batcher_(options.batching) {
+  CHECK_GT(options_.instance_num, 0) << "ModelServer needs at least one instance...";
+  // use one cpu pool if not bind to NUMA nodes
+  vector<vector<int>> node_cpus;
+  vector<int> node_ids;
+  if (options_.bind_numa) {
+    for (int n = 0; n < topology_.num_nodes(); ++n) {
+      node_cpus.push_back(topology_.cpus(n));
+      node_ids.push_back(topology_.node_id(n));
+    }
+  } else {
+    node_cpus.push_back({});
+    for (int n = 0; n < topology_.num_nodes(); ++n) {
+      node_cpus[0].insert(node_cpus[0].end(), topology_.cpus(n).begin(), topology_.cpus(n).end());
+    }
+    node_ids.push_back(-1);
+  }
+  // spread the instances evenly over the nodes
+  const int64_t used_nodes = std::min(static_cast<int64_t>(node_cpus.size()), options_.instance_num);
+  for (int n = 0; n < used_nodes; ++n) {
+    const int64_t node_inst_num = options_.instance_num / used_nodes + (n < options_.instance_num % used_nodes);
+    const auto& cpus = node_cpus[n];
+    int64_t cores = options_.cores_per_instance > 0 ? options_.cores_per_instance
+                                                     : std::max(static_cast<int64_t>(cpus.size()) / node_inst_num,
+                                                                static_cast<int64_t>(1));
+    LOG_IF(WARNING, cores * node_inst_num > cpus.size())
+        << "NUMA node " << node_ids[n] << " has " << cpus.size() << " cpus, but " << node_inst_num
+        << " instances need " << cores * node_inst_num << " cores, the cores will be oversubscribed...";
+    for (int64_t i = 0; i < node_inst_num; ++i) {
+      std::unique_ptr<Instance> instance(new Instance());
+      instance->numa_node = node_ids[n];
+      instance->shared_instance_num = node_inst_num;
+      for (int64_t c = 0; c < cores; ++c) {
+        instance->cpus.push_back(cpus[(i * cores + c) % cpus.size()]);
+      }
+      instances_.push_back(std::move(instance));
+    }
+  }
+  // construct the model instances one by one
+  for (int i = 0; i < instances_.size(); ++i) {
+    Instance* instance = instances_[i].get();
+    instance->worker = std::thread(&ModelServer::InstanceLoop, this, instance);
+    std::unique_lock<std::mutex> lock(init_lock_);
+    init_cond_.wait(lock, [this, i] { return ready_num_ > i; });
+    DLOG(INFO) << "Model instance " << i << " is ready on NUMA node " << instance->numa_node << " with "
+               << instance->cpus.size() << " cores";
+  }
+}
+
+ModelServer::~ModelServer() {
+  batcher_.Stop();
+  for (auto& instance : instances_) {
+    if (instance->worker.joinable()) instance->worker.join();
+  }
+}
+
+int64_t ModelServer::Submit(const vector<Tensor>& inputs, const Callback& callback) {
+  return batcher_.Push(inputs, callback);
+}
+
+void ModelServer::Wait() { batcher_.Wait(); }
+
+void ModelServer::InstanceLoop(Instance* instance) {
+  // pin before constructing the model, so that the weights and activations are first touched
+  // on the local node
+  if (options_.bind_numa) {
+    NumaTopology::BindOmpThreads(instance->cpus);
+  } else {
+    omp_set_num_threads(instance->cpus.size());
+  }
+  ExecutionOptions execution_options = options_.execution_options;
+  execution_options.numa_node = instance->numa_node;
+  execution_options.shared_instance_num = instance->shared_instance_num;
+  instance->model.reset(new Model(conf_file_, weight_root_, execution_options));
+  {
+    std::lock_guard<std::mutex> lock(init_lock_);
+    ready_num_++;
+  }
+  init_cond_.notify_all();
+
+  vector<ServingRequest> batch;
+  while (batcher_.Pop(&batch)) {
+    RunBatch(instance, batch);
+    batcher_.Done(batch.size());
+  }
+  instance->model.reset();
+}
+
+void ModelServer::RunBatch(Instance* instance, const vector<ServingRequest>& batch) {
+  vector<Tensor> batch_inputs = batcher_.Pack(batch, &instance->input_buffers);
+  vector<Tensor>& outputs = instance->model->Forward(batch_inputs);
+  // split the outputs to samples and cut the padded sequence
+  vector<vector<Tensor>> sample_outputs = batcher_.Unpack(batch, batcher_.PaddedLen(batch), &outputs);
+  for (int64_t b = 0; b < batch.size(); ++b) {
+    if (batch[b].callback) batch[b].callback(batch[b].id, sample_outputs[b]);
+  }
+}
+
+}  // namespace executor
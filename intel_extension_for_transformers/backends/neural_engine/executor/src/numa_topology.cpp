@@ -0,0 +1,213 @@
+//  Copyright (c) 2023 Intel Corporation
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#include "numa_topology.hpp"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <fstream>  // NOLINT(readability/streams)
+#include <numeric>
+#include <set>
+#include <sstream>
+
+#include "glog/logging.h"
+
+#ifndef _WIN32
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace executor {
+
+namespace {
+
+bool ReadLine(const string& file_name, string* line) {
+  std::ifstream in_file(file_name);
+  if (!in_file) return false;
+  std::getline(in_file, *line);
+  return true;
+}
+
+#ifndef _WIN32
+std::set<int> AllowedCpus() {
+  std::set<int> allowed;
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &mask)) allowed.insert(cpu);
+    }
+  }
+  return allowed;
+}
+#endif
+
+}  // namespace
+
+vector<int> NumaTopology::ParseCpuList(const string& cpu_list) {
+  vector<int> cpus;
+  std::stringstream ss(cpu_list);
+  string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty() || range == "\n") continue;
+    auto dash = range.find('-');
+    try {
+      if (dash == string::npos) {
+        cpus.push_back(std::stoi(range));
+      } else {
+        int begin = std::stoi(range.substr(0, dash));
+        int end = std::stoi(range.substr(dash + 1));
+        for (int cpu = begin; cpu <= end; ++cpu) cpus.push_back(cpu);
+      }
+    } catch (...) {
+      LOG(WARNING) << "Invalid cpu list: " << cpu_list;
+      return {};
+    }
+  }
+  return cpus;
+}
+
+NumaTopology::NumaTopology(const bool use_logical_cores) {
+#ifndef _WIN32
+  std::set<int> allowed = AllowedCpus();
+  // node ids may be sparse (e.g. memory-only nodes), probe until a gap of missing nodes
+  const int max_nodes = 1024;
+  for (int node = 0, missing = 0; node < max_nodes && missing < 64; ++node) {
+    string cpu_list;
+    if (!ReadLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist", &cpu_list)) {
+      missing++;
+      continue;
+    }
+    missing = 0;
+    vector<int> cpus;
+    for (int cpu : ParseCpuList(cpu_list)) {
+      if (!allowed.empty() && allowed.count(cpu) == 0) continue;
+      if (!use_logical_cores) {
+        // keep the first sibling of each physical core
+        string siblings;
+        if (ReadLine("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list",
+                     &siblings)) {
+          vector<int> sibling_cpus = ParseCpuList(siblings);
+          bool is_first = true;
+          for (int sibling : sibling_cpus) {
+            if (sibling < cpu && (allowed.empty() || allowed.count(sibling) != 0)) {
+              is_first = false;
+              break;
+            }
+          }
+          if (!is_first) continue;
+        }
+      }
+      cpus.push_back(cpu);
+    }
+    if (cpus.empty()) continue;  // memory-only node or not allowed
+    node_ids_.push_back(node);
+    node_cpus_.push_back(cpus);
+  }
+  if (node_cpus_.empty() && !allowed.empty()) {
+    node_ids_.push_back(0);
+    node_cpus_.push_back(vector<int>(allowed.begin(), allowed.end()));
+  }
+#endif
+  if (node_cpus_.empty()) {
+    vector<int> cpus(omp_get_num_procs());
+    std::iota(cpus.begin(), cpus.end(), 0);
+    node_ids_.push_back(0);
+    node_cpus_.push_back(cpus);
+  }
+  for (int i = 0; i < node_cpus_.size(); ++i) {
+    DLOG(INFO) << "NUMA node " << node_ids_[i] << " has " << node_cpus_[i].size() << " usable cpus";
+  }
+}
+
+bool NumaTopology::BindThread(const vector<int>& cpus) {
+#ifdef _WIN32
+  LOG(WARNING) << "Thread binding is not supported on Windows...";
+  return false;
+#else
+  if (cpus.empty()) return false;
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  for (int cpu : cpus) CPU_SET(cpu, &mask);
+  int ret = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+  LOG_IF(WARNING, ret != 0) << "Fail to bind thread to " << cpus.size() << " cpus, error code " << ret;
+  return ret == 0;
+#endif
+}
+
+bool NumaTopology::BindOmpThreads(const vector<int>& cpus) {
+  if (!BindThread(cpus)) return false;
+  const int num_threads = cpus.size();
+  omp_set_num_threads(num_threads);
+  bool success = true;
+#pragma omp parallel num_threads(num_threads) reduction(&& : success)
+  { success = BindThread({cpus[omp_get_thread_num()]}); }
+  return success;
+}
+
+bool NumaTopology::SetMemPolicy(void* addr, size_t size, const string& policy, int node_id) const {
+  if (policy.empty() || policy == "default") return true;
+#ifdef _WIN32
+  LOG(WARNING) << "NUMA memory policy is not supported on Windows...";
+  return false;
+#else
+  int mode;
+  vector<int> ids;
+  if (policy == "local") {
+    mode = MPOL_LOCAL;
+  } else if (policy == "interleave") {
+    mode = MPOL_INTERLEAVE;
+    ids = node_ids_;
+  } else if (policy == "bind") {
+    if (node_id < 0) return true;  // the instance is not bound to a node
+    mode = MPOL_BIND;
+    ids = {node_id};
+  } else {
+    LOG(WARNING) << "Unknown NUMA memory policy " << policy << "...";
+    return false;
+  }
+  constexpr int kBits = 8 * sizeof(unsigned long);  // NOLINT(runtime/int)
+  vector<unsigned long> mask;                        // NOLINT(runtime/int)
+  for (int id : ids) {
+    if (static_cast<int>(mask.size()) <= id / kBits) mask.resize(id / kBits + 1, 0);
+    mask[id / kBits] |= 1UL << (id % kBits);
+  }
+  // mbind works on whole pages, the partial pages at both ends keep the policy of the process
+  const uintptr_t page = sysconf(_SC_PAGESIZE);
+  uintptr_t begin = (reinterpret_cast<uintptr_t>(addr) + page - 1) / page * page;
+  uintptr_t end = (reinterpret_cast<uintptr_t>(addr) + size) / page * page;
+  if (end <= begin) return true;
+  int ret = syscall(SYS_mbind, begin, end - begin, mode, mask.empty() ? nullptr : mask.data(),
+                    mask.size() * kBits + 1, 0);
+  LOG_IF(WARNING, ret != 0) << "Fail to set NUMA memory policy " << policy << ", error code " << errno;
+  return ret == 0;
+#endif
+}
+
+size_t NumaTopology::HugePageSize() {
+  string enabled, pmd_size;
+  if (!ReadLine("/sys/kernel/mm/transparent_hugepage/enabled", &enabled) ||
+      enabled.find("[never]") != string::npos) {
+    return 0;
+  }
+  if (ReadLine("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", &pmd_size)) return std::stoull(pmd_size);
+  return 2 << 20;
+}
+
+}  // namespace executor
@@ -69,7 +69,7 @@ void OpTuning::BaseTune(std::shared_ptr<Operator> kernel, const vector<Tensor*>&
 void OpTuning::IpToConvTune(std::shared_ptr<Operator> kernel, const vector<Tensor*>& input,
                             const vector<Tensor*>& output, const bool& reshape_model) {
   // only for tuning fp32 and bf16 dtype
-  if (input[1]->dtype() != "fp32"  && input[1]->dtype() != "bf16") {
+  if (input[1]->data_type() != DataType::fp32  && input[1]->data_type() != DataType::bf16) {
     LOG(WARNING) << "Only support fp32 or bf16 dtype when tuning kernel between InnerProduct and Convolution!";
     best_execute_time_ = std::numeric_limits<float>::max();
     kernel_config_.clear();
@@ -138,7 +138,7 @@ void OpTuning::IpToConvTune(std::shared_ptr<Operator> kernel, const vector<Tenso
 void OpTuning::IpToSparseLibTune(std::shared_ptr<Operator> kernel, const vector<Tensor*>& input,
                                  const vector<Tensor*>& output, const bool& reshape_model) {
   // only for tuning int8 dtype
-  if (input[1]->dtype() != "u8") {
+  if (input[1]->data_type() != DataType::u8) {
     LOG(WARNING) << "Only support int8 dtype when tuning InnerProduct kernel with SparseLib!";
     best_execute_time_ = std::numeric_limits<float>::max();
     kernel_config_.clear();
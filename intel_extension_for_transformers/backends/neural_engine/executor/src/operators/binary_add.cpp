@@ -137,10 +137,10 @@ void BinaryAddOperator::Forward(const vector<Tensor*>& input, const vector<Tenso
       inputs = {input[0], input[1]};
     } else {
       int data_size = input[2]->size();
-      string data_type = input[2]->dtype();
+      DataType data_type = input[2]->data_type();
       void* post_data_ptr = const_cast<void*>(input[2]->data());
       void* dst_data = dst_ptr->mutable_data();
-      memcpy(dst_data, post_data_ptr, data_size * type2bytes[data_type]);
+      memcpy(dst_data, post_data_ptr, data_size * DataTypeBytes(data_type));
       LOG(WARNING) << "post tensor will be used by multi node...";
     }
   }
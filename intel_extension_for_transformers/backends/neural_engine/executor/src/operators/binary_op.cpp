@@ -50,7 +50,7 @@ BinaryOpOperator::BinaryOpOperator(const shared_ptr<OperatorConfig>& conf)
 // Different data types will unavoidably lead to correctness issues.
 void BinaryOpOperator::Prepare(const vector<Tensor*>& input, const vector<Tensor*>& output) {
   LOG_IF(FATAL, output_dtype_ == "s32") << "Unsupported dst dtype s32...";
-  if (input[0]->dtype() == "s32" || input[1]->dtype() == "s32") {
+  if (input[0]->data_type() == DataType::s32 || input[1]->data_type() == DataType::s32) {
     LOG(WARNING) << "int32 isn't supported by dnnl, which will be cast to float32.";
   }
   if (output_dtype_.empty()) {
@@ -111,12 +111,12 @@ vector<vector<string>> BinaryOpOperator::InplacePairs(const vector<Tensor*>& inp
   }
   // inplace input[0] -> output[0]
   if (input[0] != nullptr && input[0]->left_life() == 1 && input[0]->size() >= output[0]->size() &&
-      input[0]->dtype() != "s32" && output[0]->dtype() == input[0]->dtype()) {
+      input[0]->data_type() != DataType::s32 && output[0]->dtype() == input[0]->dtype()) {
     inplace_pairs.emplace_back(vector<string>({input[0]->name(), output[0]->name()}));
   } else {
     // inplace input[1] -> output[0]
     if (input[1] != nullptr && input[1]->left_life() == 1 && input[1]->size() >= output[0]->size() &&
-        input[1]->dtype() != "s32" && output[0]->dtype() == input[1]->dtype()) {
+        input[1]->data_type() != DataType::s32 && output[0]->dtype() == input[1]->dtype()) {
       inplace_pairs.emplace_back(vector<string>({input[1]->name(), output[0]->name()}));
     }
   }
@@ -129,14 +129,14 @@ void BinaryOpOperator::Forward(const vector<Tensor*>& input, const vector<Tensor
   void* src1_fp32 = nullptr;
   void* src0_data = const_cast<void*>(input[0]->data());
   void* src1_data = const_cast<void*>(input[1]->data());
-  if (input[0]->dtype() == "s32") {
+  if (input[0]->data_type() == DataType::s32) {
     size_t size = input[0]->size();
     src0_fp32 = new float[size];
     std::copy(static_cast<int32_t*>(src0_data), static_cast<int32_t*>(src0_data) + size,
               static_cast<float*>(src0_fp32));
     src0_data = src0_fp32;
   }
-  if (input[1]->dtype() == "s32") {
+  if (input[1]->data_type() == DataType::s32) {
     size_t size = input[1]->size();
     src1_fp32 = new float[size];
     std::copy(static_cast<int32_t*>(src1_data), static_cast<int32_t*>(src1_data) + size,
@@ -148,13 +148,13 @@ void BinaryOpOperator::Forward(const vector<Tensor*>& input, const vector<Tensor
   src_1_mem_.set_data_handle(src1_data);
 
   if (input[0] != nullptr && input[0]->left_life() == 1 && input[0]->size() >= output[0]->size() &&
-      input[0]->dtype() != "s32" && output[0]->dtype() == input[0]->dtype() &&
+      input[0]->data_type() != DataType::s32 && output[0]->dtype() == input[0]->dtype() &&
       this->get_execution_mode() != ExecutionMode::DEBUG) {
     input[0]->unref_data(true);
     output[0]->set_data(src0_data);
     inputs.push_back(input[1]);
   } else if (input[1] != nullptr && input[1]->left_life() == 1 && input[1]->size() >= output[0]->size() &&
-             input[1]->dtype() != "s32" && output[0]->dtype() == input[1]->dtype() &&
+             input[1]->data_type() != DataType::s32 && output[0]->dtype() == input[1]->dtype() &&
              this->get_execution_mode() != ExecutionMode::DEBUG) {
     input[1]->unref_data(true);
     output[0]->set_data(src1_data);
@@ -49,7 +49,7 @@ void ConcatOperator::Prepare(const vector<Tensor*>& input,
   LOG_IF(FATAL, output_dtype_ == "s32") << "Unsupported dtype s32...";
   bool src_same_dtype = true;
   for (int i = 0; i < input.size(); ++i) {
-    LOG_IF(FATAL, (!input[i]->dtype().empty() && input[i]->dtype() == "s32"))
+    LOG_IF(FATAL, (!input[i]->dtype().empty() && input[i]->data_type() == DataType::s32))
         << "Unsupported dtype s32...";
     src_same_dtype =
         (!input[i]->dtype().empty() && input[i]->dtype() == input[0]->dtype())
@@ -113,7 +113,7 @@ void ConcatOperator::Reshape(const vector<Tensor*>& input,
     if (!need_broadcast) continue;
     vector<int64_t> new_shape(max_dim_sizes);
     new_shape[axis_] = tmp_shape[axis_];
-    size_t type_bytes = type2bytes[input[i]->dtype()];
+    size_t type_bytes = DataTypeBytes(input[i]->data_type());
     // Calculate memory size before and after broadcasting
     size_t old_mem_size =
         std::accumulate(tmp_shape.begin(), tmp_shape.end(), size_t(1),
@@ -214,7 +214,7 @@ void ConcatOperator::Reshape(const vector<Tensor*>& input,
   for (int i = 0; i < num_src; ++i) {
     src_concat_bytes_.emplace_back(input[i]->shape()[axis_] *
                                    size_after_concat_dim *
-                                   type2bytes[input[i]->dtype()]);
+                                   DataTypeBytes(input[i]->data_type()));
   }
   src_concat_bytes_accum_.emplace_back(0);
   for (int i = 1; i < num_src; ++i) {
@@ -222,7 +222,7 @@ void ConcatOperator::Reshape(const vector<Tensor*>& input,
                                          src_concat_bytes_[i - 1]);
   }
   dst_concat_bytes_ =
-      dst_shape[axis_] * size_after_concat_dim * type2bytes[output[0]->dtype()];
+      dst_shape[axis_] * size_after_concat_dim * DataTypeBytes(output[0]->data_type());
 
   // onednn forward results have some issues when src0 tensor has dim 1 at axis
   // for example, (a, b, 1, d) + (a, b, n, d) -> (a, b, n+1, d) gets wrong
@@ -204,7 +204,7 @@ void ConvolutionOperator::MapTensors(const vector<Tensor*>& input, const vector<
 
 void ConvolutionOperator::Prepare(const vector<Tensor*>& input, const vector<Tensor*>& output) {
   // only for dense gemm dispatcher now
-  if (dispatch_from_ == "InnerProduct" && input[0]->dtype() != "fp32") return;
+  if (dispatch_from_ == "InnerProduct" && input[0]->data_type() != DataType::fp32) return;
   if (dispatch_from_ == "InnerProduct" && (input[1]->location().empty() || input[1]->shape().empty())) return;
   MapTensors(input, output);
   is_dynamic_ = src_min_ != nullptr && src_min_->raw_data() == nullptr && !src_min_->is_shared();
@@ -217,7 +217,7 @@ void ConvolutionOperator::Prepare(const vector<Tensor*>& input, const vector<Ten
   if (!is_dynamic_ && weight_min_ != nullptr) {
     src_scales_ = GetScales(src_min_->data(), src_max_->data(), src_min_->size(), src_->dtype());
     weight_scales_ = GetScales(weight_min_->data(), weight_max_->data(), weight_min_->size(), weight_->dtype());
-    if (dst_min_ && (dst_->dtype() == "u8" || dst_->dtype() == "s8")) {
+    if (dst_min_ && (dst_->data_type() == DataType::u8 || dst_->data_type() == DataType::s8)) {
       dst_scales_ = GetScales(dst_min_->data(), dst_max_->data(), dst_min_->size(), dst_->dtype());
       rescales_ = GetRescales(src_scales_, weight_scales_, dst_scales_, dst_->dtype(), append_eltwise_);
       dst_zps_ = GetZeroPoints(dst_min_->data(), dst_scales_, dst_->dtype());
@@ -232,7 +232,7 @@ void ConvolutionOperator::Prepare(const vector<Tensor*>& input, const vector<Ten
     auto src_scales_m = memory(src_scale_md, eng_, reinterpret_cast<void*>(src_scales_.data()));
     memory_args_[DNNL_ARG_ATTR_SCALES | DNNL_ARG_SRC] = src_scales_m;
 
-    if (src_->dtype() == "u8") {
+    if (src_->data_type() == DataType::u8) {
       attr_.set_zero_points_mask(DNNL_ARG_SRC, /* mask */ 0);
       auto src_zps_md = memory::desc({src_zps_.size()}, memory::data_type::s32, memory::format_tag::x);
       auto src_zps_m_ = memory(src_zps_md, eng_, reinterpret_cast<void*>(src_zps_.data()));
@@ -244,12 +244,12 @@ void ConvolutionOperator::Prepare(const vector<Tensor*>& input, const vector<Ten
     auto src1_scales_m = memory(src1_scale_md, eng_, reinterpret_cast<void*>(weight_scales_.data()));
     memory_args_[DNNL_ARG_ATTR_SCALES | DNNL_ARG_WEIGHTS] = src1_scales_m;
 
-    if (dst_min_ && (dst_->dtype() == "u8" || dst_->dtype() == "s8")) {
+    if (dst_min_ && (dst_->data_type() == DataType::u8 || dst_->data_type() == DataType::s8)) {
       attr_.set_scales_mask(DNNL_ARG_DST, /* mask */ 0);
       auto dst_scales_md = memory::desc({dst_scales_.size()}, memory::data_type::f32, memory::format_tag::x);
       auto dst_scales_m = memory(dst_scales_md, eng_, reinterpret_cast<void*>(dst_scales_.data()));
       memory_args_[DNNL_ARG_ATTR_SCALES | DNNL_ARG_DST] = dst_scales_m;
-      if (dst_->dtype() == "u8") {
+      if (dst_->data_type() == DataType::u8) {
         attr_.set_zero_points_mask(DNNL_ARG_DST, /* mask */ 0);
         auto dst_zps_md = memory::desc({dst_zps_.size()}, memory::data_type::s32, memory::format_tag::x);
         auto dst_zps_m_ = memory(dst_zps_md, eng_, reinterpret_cast<void*>(dst_zps_.data()));
@@ -405,7 +405,7 @@ void ConvolutionOperator::Reshape(const vector<Tensor*>& input, const vector<Ten
       int mask = src_min_->size() > 1 ? 2 : 0;
       attr_.set_scales_mask(DNNL_ARG_SRC, mask);
       // need zero point when src0 is u8
-      if (src_->dtype() == "u8") {
+      if (src_->data_type() == DataType::u8) {
         zp_src0_mem_ = memory({{src_min_->size()}, memory::data_type::s32, {1}}, eng_, DNNL_MEMORY_NONE);
         attr_.set_zero_points_mask(DNNL_ARG_SRC, mask);
       }
@@ -650,8 +650,8 @@ void ConvolutionOperator::Forward(const vector<Tensor*>& input, const vector<Ten
     } else {
       void* dst_data_ptr = dst_->mutable_data();
       int data_size = post_->size();
-      string data_type = post_->dtype();
-      memcpy(dst_data_ptr, post_data_ptr, data_size * type2bytes[data_type]);
+      DataType data_type = post_->data_type();
+      memcpy(dst_data_ptr, post_data_ptr, data_size * DataTypeBytes(data_type));
       LOG(WARNING) << "post tensor will be used by multi node...";
     }
   }
@@ -745,7 +745,7 @@ void ConvolutionOperator::DynamicForward(vector<int32_t>* src_zero_points_ptr, v
   scale_weight_mem_.set_data_handle(reinterpret_cast<void*>(src1_scales));
   memory_args_[DNNL_ARG_ATTR_SCALES | DNNL_ARG_WEIGHTS] = scale_weight_mem_;
 
-  if (src_->dtype() == "u8") {
+  if (src_->data_type() == DataType::u8) {
     auto& src_zero_points = *src_zero_points_ptr;
     float tmp = 1.0f / *src0_scales;
     src_zero_points =
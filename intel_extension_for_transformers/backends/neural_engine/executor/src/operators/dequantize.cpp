@@ -83,9 +83,9 @@ void DequantizeLinearOperator::ForwardImpl(const vector<Tensor*>& input, const v
 }
 
 void DequantizeLinearOperator::Forward(const vector<Tensor*>& input, const vector<Tensor*>& output) {
-  if (input[0]->dtype() == "u8") {
+  if (input[0]->data_type() == DataType::u8) {
     ForwardImpl<uint8_t>(input, output);
-  } else if (input[0]->dtype() == "s8") {
+  } else if (input[0]->data_type() == DataType::s8) {
     ForwardImpl<int8_t>(input, output);
   }
   this->unref_tensors(input);
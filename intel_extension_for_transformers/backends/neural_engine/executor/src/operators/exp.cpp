@@ -19,7 +19,7 @@
 namespace executor {
 
 void ExpOperator::Prepare(const vector<Tensor*>& input, const vector<Tensor*>& output) {
-  if (input[0]->dtype() != "fp32") {
+  if (input[0]->data_type() != DataType::fp32) {
     LOG(ERROR) << "dtype " << input[0]->dtype() << " is not supported by exp.";
   }
   output[0]->set_dtype(input[0]->dtype());
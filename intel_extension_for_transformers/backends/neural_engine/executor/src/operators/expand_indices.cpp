@@ -88,8 +88,8 @@ void ExpandIndicesOperator::Forward(const vector<Tensor*>& input, const vector<T
       output[0]->set_data(src_data);
       inputs = {input[1]};
     } else {
-      string data_type = input[0]->dtype();
-      memcpy(dst_data, src_data, old_size * type2bytes[data_type]);
+      DataType data_type = input[0]->data_type();
+      memcpy(dst_data, src_data, old_size * DataTypeBytes(data_type));
       LOG(WARNING) << "post tensor will be used by multi node...";
     }
   } else {
@@ -143,7 +143,7 @@ void GatherOperator::Reshape(const vector<Tensor*>& input, const vector<Tensor*>
   ts_descs[io::IDX] = {idx_->shape(), dt::s32, jd::plain_format(idx_->shape().size())};
   ts_descs[io::DST] = {gather_dst_shape, dt, jd::plain_format(gather_dst_shape.size())};
   if (binary_add_) {
-    LOG_IF(FATAL, append_->dtype() != "fp32") << "Gather only supports fp32 binary_add operation";
+    LOG_IF(FATAL, append_->data_type() != DataType::fp32) << "Gather only supports fp32 binary_add operation";
     attr_map["binaryop_list"] = "binary_add";
     binaryops.push_back({jd::binaryop_alg::add, dt});
     ts_descs[io::BINARY0] = {append_->shape(), dt, jd::plain_format(append_->shape().size())};
@@ -46,7 +46,7 @@ void GatherElementsOperator::Reshape(const vector<Tensor*>& input, const vector<
 
   src_stride_ = GetStrides(input[0]->shape());
   dst_stride_ = GetStrides(dst_shape_);
-  inner_block_size_ = inner_ * type2bytes[input[0]->dtype()];
+  inner_block_size_ = inner_ * DataTypeBytes(input[0]->data_type());
 }
 
 void GatherElementsOperator::Forward(const vector<Tensor*>& input, const vector<Tensor*>& output) {
@@ -59,7 +59,7 @@ void GatherElementsOperator::Forward(const vector<Tensor*>& input, const vector<
       int src_outer = i * src_stride_[axis_ - 1];
       int dst_outer = i * dst_stride_[axis_ - 1];
       if (i + 1 < outer_)
-        _mm_prefetch(old_data + (i + 1) * src_stride_[axis_ - 1] * type2bytes[input[0]->dtype()], _MM_HINT_T0);
+        _mm_prefetch(old_data + (i + 1) * src_stride_[axis_ - 1] * DataTypeBytes(input[0]->data_type()), _MM_HINT_T0);
       int len = 0;
 
 #if __AVX512F__
@@ -67,15 +67,15 @@ void GatherElementsOperator::Forward(const vector<Tensor*>& input, const vector<
 #pragma omp simd
       for (int j = 0; j < len; j += 16) {
         __m512i vidx = _mm512_loadu_si512(idx_data + dst_outer + j);
-        __m512 tmp = _mm512_i32gather_ps(vidx, old_data + src_outer * type2bytes[input[0]->dtype()], 4);
-        _mm512_storeu_ps(new_data + (dst_outer + j) * type2bytes[input[0]->dtype()], tmp);
+        __m512 tmp = _mm512_i32gather_ps(vidx, old_data + src_outer * DataTypeBytes(input[0]->data_type()), 4);
+        _mm512_storeu_ps(new_data + (dst_outer + j) * DataTypeBytes(input[0]->data_type()), tmp);
       }
 #endif
 #pragma omp simd
       for (int j = len; j < dst_shape_[axis_]; j++) {
         int idx = idx_data[dst_outer + j];
-        memcpy(new_data + (dst_outer + j) * type2bytes[input[0]->dtype()],
-               old_data + (src_outer + idx) * type2bytes[input[0]->dtype()], type2bytes[input[0]->dtype()]);
+        memcpy(new_data + (dst_outer + j) * DataTypeBytes(input[0]->data_type()),
+               old_data + (src_outer + idx) * DataTypeBytes(input[0]->data_type()), DataTypeBytes(input[0]->data_type()));
       }
     }
   } else {
@@ -87,10 +87,10 @@ void GatherElementsOperator::Forward(const vector<Tensor*>& input, const vector<
       for (int j = 0; j < dst_shape_[axis_]; j++) {
         if (j + 1 < dst_shape_[axis_])
           _mm_prefetch(
-              old_data + (src_outer + idx_data[dst_outer + (j + 1) * inner_] * inner_) * type2bytes[input[0]->dtype()],
+              old_data + (src_outer + idx_data[dst_outer + (j + 1) * inner_] * inner_) * DataTypeBytes(input[0]->data_type()),
               _MM_HINT_T0);
-        memcpy(new_data + (dst_outer + j * inner_) * type2bytes[input[0]->dtype()],
-               old_data + (src_outer + idx_data[dst_outer + j * inner_] * inner_) * type2bytes[input[0]->dtype()],
+        memcpy(new_data + (dst_outer + j * inner_) * DataTypeBytes(input[0]->data_type()),
+               old_data + (src_outer + idx_data[dst_outer + j * inner_] * inner_) * DataTypeBytes(input[0]->data_type()),
                inner_block_size_);
       }
     }
@@ -36,7 +36,7 @@ GroupNormOperator::GroupNormOperator(const shared_ptr<OperatorConfig>& conf) : O
 
 void GroupNormOperator::Prepare(const vector<Tensor*>& input, const vector<Tensor*>& output) {
   Tensor* src = input[0];
-  assert(src->dtype() == "fp32" || src->dtype() == "bf16");
+  assert(src->data_type() == DataType::fp32 || src->data_type() == DataType::bf16);
   output[0]->set_dtype(src->dtype());
   Tensor* gamma = input[1];
   Tensor* beta = input[2];
@@ -216,26 +216,26 @@ void InnerProductOperator::Prepare(const vector<Tensor*>& input, const vector<Te
   MapTensors(input, output);
   DLOG(INFO) << "inner product has bias add " << has_bias_;
   dst_->set_dtype(output_dtype_);
-  if (src0_->dtype() == "fp32" && src1_->dtype() == "fp32") {
+  if (src0_->data_type() == DataType::fp32 && src1_->data_type() == DataType::fp32) {
     kernel_type_ = Dense;
     weight_zero_ratio_ = GetSparseRatio<float>(static_cast<const float*>(src1_->data()), src1_->shape(), blocksize_);
     if (weight_zero_ratio_ >= sparse_threshold_) kernel_type_ = Dense;
     DLOG(INFO) << "weight zero ratio: " << weight_zero_ratio_;
-  } else if (src1_->dtype() == "s8") {
+  } else if (src1_->data_type() == DataType::s8) {
     kernel_type_ = Dense;
     blocksize_ = {4, 16};
     weight_zero_ratio_ = GetSparseRatio<int8_t>(static_cast<const int8_t*>(src1_->data()), src1_->shape(), blocksize_);
     if (weight_zero_ratio_ >= sparse_threshold_) kernel_type_ = Dense;
     DLOG(INFO) << "weight zero ratio: " << weight_zero_ratio_;
-  } else if (src0_->dtype() == "s8" && src1_->dtype() == "u8") {
+  } else if (src0_->data_type() == DataType::s8 && src1_->data_type() == DataType::u8) {
     blocksize_ = {4, 1};
     weight_zero_ratio_ = GetSparseRatio<int8_t>(static_cast<const int8_t*>(src0_->data()), src0_->shape(), blocksize_);
     if (weight_zero_ratio_ >= sparse_threshold_) kernel_type_ = SparseLib;
     DLOG(INFO) << "weight zero ratio: " << weight_zero_ratio_;
-  } else if (src1_->dtype() == "bf16") {
+  } else if (src1_->data_type() == DataType::bf16) {
     kernel_type_ = Dense;
     auto shape = src1_->shape();
-    if (weight_comp_.enabled() && shape.size() == 2 && dst_->dtype() == "bf16") {
+    if (weight_comp_.enabled() && shape.size() == 2 && dst_->data_type() == DataType::bf16) {
       int _N = shape[0], _K = shape[1];
       auto src_bf16 = reinterpret_cast<const jd::bfloat16_t*>(src1_->data());
       if (_N % 32 == 0 && _K % 32 == 0) {  // this limitation will be removed by kernel updates
@@ -612,8 +612,8 @@ void InnerProductOperator::DynamicForward(const vector<Tensor*>& input, const ve
         dst_data = post_data_ptr;
       } else {
         int data_size = post_->size();
-        string data_type = post_->dtype();
-        memcpy(dst_data, post_data_ptr, data_size * type2bytes[data_type]);
+        DataType data_type = post_->data_type();
+        memcpy(dst_data, post_data_ptr, data_size * DataTypeBytes(data_type));
         DLOG(WARNING) << "post tensor will be used by multi node...";
       }
     }
@@ -771,7 +771,7 @@ void InnerProductOperator::ForwardSparse(const vector<Tensor*>& input, const vec
     const uint8_t* A = static_cast<const uint8_t*>(src0_->data());
     const int8_t* B = static_cast<const int8_t*>(sparse_weight_int8_->data);
     if (src1_->size() > 1) {  // per channel kernel
-      if (output[0]->dtype() == "u8") {
+      if (output[0]->data_type() == DataType::u8) {
         uint8_t* C = static_cast<uint8_t*>(dst_->mutable_data());
         if (has_bias_) {
           const int32_t* bias = static_cast<const int32_t*>(bias_->data());
@@ -780,7 +780,7 @@ void InnerProductOperator::ForwardSparse(const vector<Tensor*>& input, const vec
                                                 M_NBLK_);
           }
         }
-      } else if (output[0]->dtype() == "s8") {
+      } else if (output[0]->data_type() == DataType::s8) {
         int8_t* C = static_cast<int8_t*>(dst_->mutable_data());
         if (has_bias_) {
           const int32_t* bias = static_cast<const int32_t*>(bias_->data());
@@ -791,7 +791,7 @@ void InnerProductOperator::ForwardSparse(const vector<Tensor*>& input, const vec
         }
       }
     } else {  // per tensor kernel
-      if (output[0]->dtype() == "fp32") {
+      if (output[0]->data_type() == DataType::fp32) {
         float* C = static_cast<float*>(dst_->mutable_data());
         if (has_bias_) {
           const int32_t* bias = static_cast<const int32_t*>(bias_->data());
@@ -803,7 +803,7 @@ void InnerProductOperator::ForwardSparse(const vector<Tensor*>& input, const vec
                                               C, M_NBLK_);
           }
         }
-      } else if (output[0]->dtype() == "u8") {
+      } else if (output[0]->data_type() == DataType::u8) {
         uint8_t* C = static_cast<uint8_t*>(dst_->mutable_data());
         if (has_bias_) {
           const int32_t* bias = static_cast<const int32_t*>(bias_->data());
@@ -812,7 +812,7 @@ void InnerProductOperator::ForwardSparse(const vector<Tensor*>& input, const vec
                                              M_NBLK_);
           }
         }
-      } else if (output[0]->dtype() == "s8") {
+      } else if (output[0]->data_type() == DataType::s8) {
         int8_t* C = static_cast<int8_t*>(dst_->mutable_data());
         if (has_bias_) {
           const int32_t* bias = static_cast<const int32_t*>(bias_->data());
@@ -978,7 +978,7 @@ void InnerProductOperator::ReshapeSparseLib(const vector<Tensor*>& input, const
     const float* max_p = static_cast<const float*>(dst_max_->data());
     scale = (max_p[0] - min_p[0]) / 255;
     zp = -min_p[0] / scale;
-    assert(dst_->dtype() == "s8" || dst_->dtype() == "u8");
+    assert(dst_->data_type() == DataType::s8 || dst_->data_type() == DataType::u8);
     jd::postop_attr quantize_attr(type2sparsemem_[dst_->dtype()], jd::postop_type::eltwise, jd::postop_alg::quantize,
                                   zp, 0, scale);
     op_attrs_["postop_list"] +=
@@ -1011,8 +1011,8 @@ void InnerProductOperator::ForwardSparseLib(const vector<Tensor*>& input, const
       dst_data = post_data_ptr;
     } else {
       int data_size = post_->size();
-      string data_type = post_->dtype();
-      memcpy(dst_data, post_data_ptr, data_size * type2bytes[data_type]);
+      DataType data_type = post_->data_type();
+      memcpy(dst_data, post_data_ptr, data_size * DataTypeBytes(data_type));
       LOG(WARNING) << "post tensor will be used by multi node...";
     }
   }
@@ -1138,7 +1138,7 @@ void InnerProductOperator::PrepareDense(const vector<Tensor*>& input, const vect
       src0_zps_ = GetZeroPoints(src0_min_->data(), src0_scales_, src0_->dtype());
       if (dst_min_) dst_scales_ = GetScales(dst_min_->data(), dst_max_->data(), dst_min_->size(), dst_->dtype());
       rescales_ = GetRescales(src0_scales_, src1_scales_, dst_scales_, dst_->dtype(), append_eltwise_);
-      if (dst_min_ != nullptr && (dst_->dtype() == "u8" || dst_->dtype() == "s8")) {
+      if (dst_min_ != nullptr && (dst_->data_type() == DataType::u8 || dst_->data_type() == DataType::s8)) {
         attr_.set_scales_mask(DNNL_ARG_DST, /* mask */ 0);
         dst_zps_ = GetZeroPoints(dst_min_->data(), dst_scales_, dst_->dtype());
 
@@ -1182,7 +1182,7 @@ void InnerProductOperator::PrepareDense(const vector<Tensor*>& input, const vect
   if (!src1_perm_.empty() && src1_perm_ == vector<int64_t>{1, 0}) src1_->set_transpose();
   if (!src0_perm_.empty() && src0_perm_ == vector<int64_t>{1, 0}) src0_->set_transpose();
 
-  if (has_bias_ || (is_dynamic_ && src0_->dtype() == "u8")) {
+  if (has_bias_ || (is_dynamic_ && src0_->data_type() == DataType::u8)) {
     vector<int64_t> bias_shape = {src1_shape[0]};
     vector<int64_t> bias_stride = GetStrides(bias_shape);
     if (has_bias_) {
@@ -1256,7 +1256,7 @@ void InnerProductOperator::ReshapeDense(const vector<Tensor*>& input, const vect
       scale_shape.push_back(src1_min_->size());
       scale_f32_mem_ = memory({scale_shape, memory::data_type::f32, GetStrides(scale_shape)}, eng_, DNNL_MEMORY_NONE);
       // need zero point when src0 is u8
-      if (src0_->dtype() == "u8") {
+      if (src0_->data_type() == DataType::u8) {
         vector<int64_t> zero_point_shape(src1_shape);
         zero_point_shape[src1_shape.size() - 1] = src1_shape[src1_shape.size() - 2];
         zero_point_shape[src1_shape.size() - 2] = 1;
@@ -1308,7 +1308,7 @@ void InnerProductOperator::ReshapeDense(const vector<Tensor*>& input, const vect
     po.append_eltwise(algorithm::eltwise_swish, op_alpha, op_beta);
   }
   // this is to sub zero point in fp32 to make the output u8
-  if (!is_dynamic_ && dst_->dtype() == "u8") {
+  if (!is_dynamic_ && dst_->data_type() == DataType::u8) {
     append_eltwise_ = true;
     float zero_point = dst_zps_[0] * dst_scales_[0];
     po.append_eltwise(algorithm::eltwise_linear, 1., zero_point);
@@ -1318,7 +1318,7 @@ void InnerProductOperator::ReshapeDense(const vector<Tensor*>& input, const vect
   // 1.1 Transpose tensor shape and get it
   // for decoder-only transformers dnnl amx bf16 brgemm weight reorder process
 #if __AMX_BF16__
-  if (src1_->dtype() == "bf16" && model_ != nullptr && model_->input_shape().size() > 1) {
+  if (src1_->data_type() == DataType::bf16 && model_ != nullptr && model_->input_shape().size() > 1) {
     if ((seq_len_ != 0 && seq_len_ > 128 && model_->input_shape()[1] == 1) ||
         (seq_len_ != 0 && seq_len_ == 1 && model_->input_shape()[1] > 128)) {
       weight_cached_ = false;
@@ -1394,7 +1394,7 @@ void InnerProductOperator::ReshapeDense(const vector<Tensor*>& input, const vect
 
   // Create inner product primitive descriptor.
   if (format_any_) {
-    if (has_bias_ || (is_dynamic_ && src0_->dtype() == "u8")) {
+    if (has_bias_ || (is_dynamic_ && src0_->data_type() == DataType::u8)) {
       inner_product_pd_ = dnnl::inner_product_forward::primitive_desc(
           eng_, prop_kind::forward_inference, any_src0_md,
           !weight_reorded_ ? any_src1_md_ : any_src1_m_last_.get_desc(), any_bias_md_, any_dst_md, attr_);
@@ -1404,7 +1404,7 @@ void InnerProductOperator::ReshapeDense(const vector<Tensor*>& input, const vect
           !weight_reorded_ ? any_src1_md_ : any_src1_m_last_.get_desc(), any_dst_md, attr_);
     }
   } else {
-    if (has_bias_ || (is_dynamic_ && src0_->dtype() == "u8")) {
+    if (has_bias_ || (is_dynamic_ && src0_->data_type() == DataType::u8)) {
       inner_product_pd_ = dnnl::inner_product_forward::primitive_desc(eng_, prop_kind::forward_inference, src0_md,
                                                                       src1_md_, bias_md_, dst_md, attr_);
     } else {
@@ -1437,7 +1437,7 @@ void InnerProductOperator::ReshapeDense(const vector<Tensor*>& input, const vect
       if (src1_->is_shared()) {
         int64_t weight_size = any_src1_m.get_desc().get_size();
         void* weight_shm_ptr =
-            MemoryAllocator::ManagedShm().find_or_construct<char>(src1_->name().c_str())[weight_size](0);
+            src1_->shm_space()->find_or_construct<char>(src1_->name().c_str())[weight_size](0);
         any_src1_m.set_data_handle(weight_shm_ptr);
         cached_w_ptr = weight_shm_ptr;
       } else {
@@ -1447,8 +1447,8 @@ void InnerProductOperator::ReshapeDense(const vector<Tensor*>& input, const vect
       }
       dnnl::reorder(any_src1_m_last_, any_src1_m).execute(eng_stream_, any_src1_m_last_, any_src1_m);
       if (src1_->is_shared() && this->get_execution_mode() == ExecutionMode::INFERENCE && src1_->life() <= 1) {
-        MemoryAllocator::ManagedShm().destroy_ptr(src1_->mutable_data());
-        src1_->set_shm_handle(MemoryAllocator::ManagedShm().get_handle_from_address(cached_w_ptr));
+        src1_->shm_space()->destroy_ptr(src1_->mutable_data());
+        src1_->set_shm_handle(src1_->shm_space()->get_handle_from_address(cached_w_ptr));
       } else {
         if (this->get_execution_mode() == ExecutionMode::INFERENCE && src1_->life() <= 1) {
           aligned_free(src1_->mutable_data());
@@ -1467,7 +1467,7 @@ void InnerProductOperator::ReshapeDense(const vector<Tensor*>& input, const vect
         if (bias_->is_shared()) {
           int64_t bias_size = bias_m_.get_desc().get_size();
           void* bias_shm_ptr =
-              MemoryAllocator::ManagedShm().find_or_construct<char>(bias_->name().c_str())[bias_size](0);
+              bias_->shm_space()->find_or_construct<char>(bias_->name().c_str())[bias_size](0);
           any_bias_m.set_data_handle(bias_shm_ptr);
           cached_b_ptr = bias_shm_ptr;
         } else {
@@ -1477,8 +1477,8 @@ void InnerProductOperator::ReshapeDense(const vector<Tensor*>& input, const vect
         }
         dnnl::reorder(any_bias_m_last_, any_bias_m).execute(eng_stream_, any_bias_m_last_, any_bias_m);
         if (bias_->is_shared() && this->get_execution_mode() == ExecutionMode::INFERENCE && bias_->life() <= 1) {
-          MemoryAllocator::ManagedShm().destroy_ptr(bias_->mutable_data());
-          bias_->set_shm_handle(MemoryAllocator::ManagedShm().get_handle_from_address(cached_b_ptr));
+          bias_->shm_space()->destroy_ptr(bias_->mutable_data());
+          bias_->set_shm_handle(bias_->shm_space()->get_handle_from_address(cached_b_ptr));
         } else {
           if (this->get_execution_mode() == ExecutionMode::INFERENCE && bias_->life() <= 1) {
             aligned_free(bias_->mutable_data());
@@ -1546,8 +1546,8 @@ void InnerProductOperator::ForwardDense(const vector<Tensor*>& input, const vect
       dst_data = post_data_ptr;
     } else {
       int data_size = post_->size();
-      string data_type = post_->dtype();
-      memcpy(dst_data, post_data_ptr, data_size * type2bytes[data_type]);
+      DataType data_type = post_->data_type();
+      memcpy(dst_data, post_data_ptr, data_size * DataTypeBytes(data_type));
       DLOG(WARNING) << "post tensor will be used by multi node...";
     }
   }
@@ -1666,9 +1666,9 @@ void InnerProductOperator::RuntimeMemoryArgs(vector<float>* dynamic_bias_ptr, me
   // The bias loaded from file is not scaled. So need rescaled runtime.
   // the compensation is src0_scale*sr0_min*ones_like(src0)*src1. compensation
   // will be add as bias
-  if (has_bias_ || src0_->dtype() == "u8") {
+  if (has_bias_ || src0_->data_type() == DataType::u8) {
     float* bias_data = has_bias_ ? reinterpret_cast<float*>(bias_->mutable_data()) : nullptr;
-    if (src0_->dtype() == "u8") {
+    if (src0_->data_type() == DataType::u8) {
       float src0_min = *(reinterpret_cast<float*>(src0_min_->mutable_data()));
       dynamic_bias.resize(src1_->shape()[0]);
 #pragma omp parallel for
@@ -36,7 +36,7 @@ void LatRangeOperator::Forward(const vector<Tensor*>& input, const vector<Tensor
   auto dst_data = static_cast<int*>(output[0]->mutable_data());
 #pragma omp parallel for
   for (int i = 0; i < shape_[1]; ++i) dst_data[i] = start_ + i * step_;
-  int stride = shape_[1] * type2bytes["int32"];
+  int stride = shape_[1] * DataTypeBytes(DataType::s32);
 #pragma omp parallel for
   for (int i = 1; i < shape_[0]; ++i) memcpy(&dst_data[i * shape_[1]], dst_data, stride);
   // 2. unref tensors
@@ -37,6 +37,10 @@ LayerNormOperator::LayerNormOperator(const shared_ptr<OperatorConfig>& conf) : O
   if (iter != attrs_map.end()) {
     output_dtype_ = attrs_map["output_dtype"];
   }
+  iter = attrs_map.find("per_token");
+  if (iter != attrs_map.end()) {
+    per_token_ = attrs_map["per_token"] == "true" || attrs_map["per_token"] == "True";
+  }
   iter = attrs_map.find("reshape");
   if (iter != attrs_map.end()) {
     StringSplit<int64_t>(&reshape_, attrs_map["reshape"], ",");
@@ -52,7 +56,18 @@ LayerNormOperator::LayerNormOperator(const shared_ptr<OperatorConfig>& conf) : O
 }
 
 void LayerNormOperator::Prepare(const vector<Tensor*>& input, const vector<Tensor*>& output) {
-  if (!transpose_mode_ || input[0]->dtype() != "fp32") {
+  dynamic_quant_ = per_token_ && output.size() == 3;
+  if (dynamic_quant_) {
+    LOG_IF(FATAL, input[0]->data_type() != DataType::fp32 || input[1]->data_type() != DataType::fp32 ||
+                      input[2]->data_type() != DataType::fp32)
+        << "per_token dynamic quantization only supports fp32 src, scale and shift...";
+    output_dtype_ = "s8";
+    output[0]->set_dtype(output_dtype_);
+    output[1]->set_dtype("fp32");
+    output[2]->set_dtype("fp32");
+    return;
+  }
+  if (!transpose_mode_ || input[0]->data_type() != DataType::fp32) {
     PreparewithOnednn(input, output);
   }
 }
@@ -85,7 +100,9 @@ void LayerNormOperator::DstReshapeFusion(const vector<Tensor*>& input, const vec
 }
 
 void LayerNormOperator::Reshape(const vector<Tensor*>& input, const vector<Tensor*>& output) {
-  if (transpose_mode_) {
+  if (dynamic_quant_) {
+    ReshapewithDynamicQuant(input, output);
+  } else if (transpose_mode_) {
     ReshapewithTransMode(input, output);
   } else {
     ReshapewithOnednn(input, output);
@@ -94,7 +111,9 @@ void LayerNormOperator::Reshape(const vector<Tensor*>& input, const vector<Tenso
 }
 
 void LayerNormOperator::Forward(const vector<Tensor*>& input, const vector<Tensor*>& output) {
-  if (transpose_mode_) {
+  if (dynamic_quant_) {
+    ForwardwithDynamicQuant(input, output);
+  } else if (transpose_mode_) {
 #ifdef __AVX512F__
     ForwardwithTransMode(input, output);
 #endif
@@ -108,9 +127,9 @@ void LayerNormOperator::ReshapewithTransMode(const vector<Tensor*>& input, const
   src_desc_ = {src_shape, jd::data_type::fp32, jd::format_type::ba};
   jd::tensor_desc affine_desc = {{}, jd::data_type::fp32, jd::format_type::ba};
   jd::data_type dst_dt;
-  if (output[0]->dtype() == "fp32") dst_dt = jd::data_type::fp32;
-  if (output[0]->dtype() == "s8") dst_dt = jd::data_type::s8;
-  if (output[0]->dtype() == "u8") dst_dt = jd::data_type::u8;
+  if (output[0]->data_type() == DataType::fp32) dst_dt = jd::data_type::fp32;
+  if (output[0]->data_type() == DataType::s8) dst_dt = jd::data_type::s8;
+  if (output[0]->data_type() == DataType::u8) dst_dt = jd::data_type::u8;
   dst_desc_ = {output[0]->shape(), dst_dt, jd::format_type::ba};
 
   vector<jd::tensor_desc> ts_descs = {src_desc_, dst_desc_, affine_desc};
@@ -127,10 +146,17 @@ void LayerNormOperator::ReshapewithTransMode(const vector<Tensor*>& input, const
   }
   op_attrs_["matrix_shape"] = src_shape_str;
   vector<jd::postop_attr> postops;
-  if (quantize_fuse_) {
+  const bool int8_dst = dst_dt == jd::data_type::u8 || dst_dt == jd::data_type::s8;
+  if (quantize_fuse_ || (int8_dst && input.size() == 5)) {
     float zp = 0, scale = 1;
-    jd::postop_attr u8_quantize = {jd::data_type::u8, jd::postop_type::eltwise, jd::postop_alg::quantize, zp, 0, scale};
-    postops.push_back(u8_quantize);
+    if (input.size() == 5) {
+      // the kernel quantizes as x * scale + zp
+      scale = GetScales(input[3]->data(), input[4]->data(), 1, output[0]->dtype())[0];
+      if (dst_dt == jd::data_type::u8) zp = -static_cast<const float*>(input[3]->data())[0] * scale;
+    }
+    jd::postop_attr quantize = {int8_dst ? dst_dt : jd::data_type::u8, jd::postop_type::eltwise,
+                                jd::postop_alg::quantize, zp, 0, scale};
+    postops.push_back(quantize);
     op_attrs_["postop_list"] = "s8quant+" + std::to_string(zp) + "+" + std::to_string(scale);
   }
 
@@ -160,14 +186,68 @@ void LayerNormOperator::ForwardwithTransMode(const vector<Tensor*>& input, const
 }
 #endif
 
+void LayerNormOperator::ReshapewithDynamicQuant(const vector<Tensor*>& input, const vector<Tensor*>& output) {
+  const vector<int64_t>& src_shape = input[0]->shape();
+  const int64_t rows = input[0]->size() / src_shape.back();
+  output[0]->set_shape(src_shape);
+  output[1]->set_shape({rows});
+  output[2]->set_shape({rows});
+}
+
+// Normalizes one row into a cached buffer and quantizes it from there, so the fp32 result is never written out and
+// read back by a Quantize op. Scales follow the dynamic_quant kernel: scale = max(|y|) / 127, q = round(y / scale).
+void LayerNormOperator::ForwardwithDynamicQuant(const vector<Tensor*>& input, const vector<Tensor*>& output) {
+  const float* src_data = static_cast<const float*>(input[0]->data());
+  const float* gamma = static_cast<const float*>(input[1]->data());
+  const float* beta = static_cast<const float*>(input[2]->data());
+  int8_t* dst_data = static_cast<int8_t*>(output[0]->mutable_data());
+  float* dst_min = static_cast<float*>(output[1]->mutable_data());
+  float* dst_scale = static_cast<float*>(output[2]->mutable_data());
+  const int64_t cols = input[0]->shape().back();
+  const int64_t rows = input[0]->size() / cols;
+
+#pragma omp parallel
+  {
+    vector<float> row(cols);
+#pragma omp for
+    for (int64_t i = 0; i < rows; ++i) {
+      const float* src = src_data + i * cols;
+      float sum = 0.f;
+#pragma omp simd reduction(+ : sum)
+      for (int64_t j = 0; j < cols; ++j) sum += src[j];
+      const float mean = sum / cols;
+      float var = 0.f;
+#pragma omp simd reduction(+ : var)
+      for (int64_t j = 0; j < cols; ++j) var += (src[j] - mean) * (src[j] - mean);
+      const float rstd = 1.f / std::sqrt(var / cols + epsilon_);
+
+      float abs_max = 0.f;
+#pragma omp simd reduction(max : abs_max)
+      for (int64_t j = 0; j < cols; ++j) {
+        row[j] = (src[j] - mean) * rstd * gamma[j] + beta[j];
+        abs_max = std::max(abs_max, std::abs(row[j]));
+      }
+      const float scale = abs_max / 127.f;
+      const float rscale = abs_max > 0.f ? 1.f / scale : 0.f;
+      int8_t* dst = dst_data + i * cols;
+      // |row[j] * rscale| <= 127, no saturation needed
+#pragma omp simd
+      for (int64_t j = 0; j < cols; ++j) dst[j] = static_cast<int8_t>(std::nearbyint(row[j] * rscale));
+      dst_min[i] = -abs_max;
+      dst_scale[i] = scale;
+    }
+  }
+  this->unref_tensors(input);
+}
+
 // The ONEDNN layer_norm primitive supports the following combinations of data types:
 // src0 f32, bf16, f16, u8, s8, dst: f32, bf16, f16, u8, s8
 // In-place mode requires the dst and src data types to be the same.
 // Different data types will unavoidably lead to correctness issues.
 // Mean, Variance and ScaleShift data types are always fp32 and independent of src or dst data types.
 void LayerNormOperator::PreparewithOnednn(const vector<Tensor*>& input, const vector<Tensor*>& output) {
-  LOG_IF(FATAL, (output_dtype_ == "s32" || input[0]->dtype() == "s32")) << "Unsupported dtype s32...";
-  LOG_IF(FATAL, (input[1]->dtype() != "fp32" || input[2]->dtype() != "fp32")) <<
+  LOG_IF(FATAL, (output_dtype_ == "s32" || input[0]->data_type() == DataType::s32)) << "Unsupported dtype s32...";
+  LOG_IF(FATAL, (input[1]->data_type() != DataType::fp32 || input[2]->data_type() != DataType::fp32)) <<
         "Onednn only support fp32 scale and shift...";
   if (output_dtype_.empty()) {
     output_dtype_ = input[0]->dtype();
@@ -238,6 +318,19 @@ void LayerNormOperator::ReshapewithOnednn(const vector<Tensor*>& input, const ve
     const auto& beta_data = input[2]->data();
     std::memcpy(shift_buf, beta_data, sizeof(float) * scale_size);
 
+    // fused static Quantize: (y - min) * s for u8 or y * s for s8 equals the affine with gamma * s and (beta - min) * s
+    const string& dst_dtype = output[0]->dtype();
+    if (input.size() == 5 && (dst_dtype == "u8" || dst_dtype == "s8")) {
+      const float scale = GetScales(input[3]->data(), input[4]->data(), 1, dst_dtype)[0];
+      const float min = dst_dtype == "u8" ? static_cast<const float*>(input[3]->data())[0] : 0.f;
+      float* scale_p = static_cast<float*>(scale_buf);
+      float* shift_p = static_cast<float*>(shift_buf);
+      for (int64_t i = 0; i < scale_size; ++i) {
+        scale_p[i] *= scale;
+        shift_p[i] = (shift_p[i] - min) * scale;
+      }
+    }
+
     weight_cached_ = true;
   }
 
@@ -199,11 +199,11 @@ void MatmulOperator::MapTensors(const vector<Tensor*>& input, const vector<Tenso
 
 #if (__AVX512F__ || __AVX2__) && !__AMXINT8__
 void MatmulOperator::SetTransposeMode() {
-  if (dst_->dtype() == "fp32" && binary_add_ && src0_->dtype() == "fp32") {
+  if (dst_->data_type() == DataType::fp32 && binary_add_ && src0_->data_type() == DataType::fp32) {
     vector<int64_t> src0_perm_transpose{2, 0, 3, 1};
     vector<int64_t> src1_perm_transpose{2, 0, 1, 3};
     transpose_mode_ = (src0_perm_ == src0_perm_transpose) && (src1_perm_ == src1_perm_transpose);
-  } else if (dst_->dtype() == "u8") {
+  } else if (dst_->data_type() == DataType::u8) {
     vector<int64_t> dst_perm_transpose{1, 3, 0, 2};
     vector<int64_t> src1_perm_transpose{2, 0, 3, 1};
     transpose_mode_ = (dst_perm_ == dst_perm_transpose) && (src1_perm_ == src1_perm_transpose);
@@ -256,14 +256,14 @@ void MatmulOperator::Prepare(const vector<Tensor*>& input, const vector<Tensor*>
         dst_scales_ = GetScales(dst_min_->data(), dst_max_->data(), dst_min_->size(), dst_->dtype());
         rescales = GetRescales(src0_scales_, src1_scales_, dst_scales_, dst_->dtype(), append_eltwise_);
       }
-      if (dst_min_ != nullptr && (dst_->dtype() == "u8" || dst_->dtype() == "s8")) {
+      if (dst_min_ != nullptr && (dst_->data_type() == DataType::u8 || dst_->data_type() == DataType::s8)) {
         attr_.set_scales_mask(DNNL_ARG_DST, /* mask */ 0);
         dst_zps_ = GetZeroPoints(dst_min_->data(), dst_scales_, dst_->dtype());
         for (int i = 0; i < dst_scales_.size(); i++) dst_scales_[i] = 1.0 / dst_scales_[i];
         auto dst_scale_md = memory::desc({dst_scales_.size()}, memory::data_type::f32, memory::format_tag::x);
         auto dst_scales_m_ = memory(dst_scale_md, eng_, reinterpret_cast<void*>(dst_scales_.data()));
         memory_args_[DNNL_ARG_ATTR_SCALES | DNNL_ARG_DST] = dst_scales_m_;
-        if (dst_->dtype() == "u8") {
+        if (dst_->data_type() == DataType::u8) {
           attr_.set_zero_points_mask(DNNL_ARG_DST, /* mask */ 0);
           auto dst_zps_md = memory::desc({dst_zps_.size()}, memory::data_type::s32, memory::format_tag::x);
           auto dst_zps_m = memory(dst_zps_md, eng_, reinterpret_cast<void*>(dst_zps_.data()));
@@ -279,7 +279,7 @@ void MatmulOperator::Prepare(const vector<Tensor*>& input, const vector<Tensor*>
       auto src_scales_m = memory(src_scale_md, eng_, reinterpret_cast<void*>(src0_scales_.data()));
       memory_args_[DNNL_ARG_ATTR_SCALES | DNNL_ARG_SRC] = src_scales_m;
 
-      if (src0_->dtype() == "u8") {
+      if (src0_->data_type() == DataType::u8) {
         attr_.set_zero_points_mask(DNNL_ARG_SRC, /* mask */ 0);
         auto src_zps_md = memory::desc({src0_zps_.size()}, memory::data_type::s32, memory::format_tag::x);
         auto src_zps_m = memory(src_zps_md, eng_, reinterpret_cast<void*>(src0_zps_.data()));
@@ -351,7 +351,7 @@ void MatmulOperator::ReshapewithTransMode(const vector<Tensor*>& input, const ve
   scale_desc_ = {{static_cast<int64_t>(rescales_.size())}, jd::data_type::fp32, jd::format_type::a};
   zp_desc_ = {{static_cast<int64_t>(dst_scales_.size())}, jd::data_type::fp32, jd::format_type::a};
   vector<jd::tensor_desc> ts_descs;
-  if (dst_->dtype() == "u8") {
+  if (dst_->data_type() == DataType::u8) {
     ts_descs = {src0_desc_, src1_desc_, dst_desc_, binary_desc_, scale_desc_, zp_desc_};
     ouput_zp_ = -1 * static_cast<const float*>(dst_min_->data())[0] * 1.0 / dst_scales_[0];
   } else {
@@ -371,8 +371,8 @@ void MatmulOperator::ForwardwithTransMode(const vector<Tensor*>& input, const ve
                                            src1_->data(),
                                            dst_data,
                                            binary_add_ ? post_->data() : nullptr,
-                                           dst_->dtype() == "u8" ? &rescales_[0] : nullptr,
-                                           dst_->dtype() == "u8" ? &ouput_zp_ : nullptr};
+                                           dst_->data_type() == DataType::u8 ? &rescales_[0] : nullptr,
+                                           dst_->data_type() == DataType::u8 ? &ouput_zp_ : nullptr};
 
   transpose_matmul_.execute(runtime_data);
   this->unref_tensors(input);
@@ -460,7 +460,7 @@ void MatmulOperator::ReshapewithOnednn(const vector<Tensor*>& input, const vecto
       scale_f32_mem_ = memory({{1}, memory::data_type::f32, {1}}, eng_, DNNL_MEMORY_NONE);
       zp_src0_mem_ = memory({{1}, memory::data_type::s32, {1}}, eng_, DNNL_MEMORY_NONE);
       // need zero point when src0 is u8
-      if (src0_->dtype() == "u8") {
+      if (src0_->data_type() == DataType::u8) {
         attr_.set_zero_points_mask(DNNL_ARG_SRC, 0);
       }
     }
@@ -540,7 +540,7 @@ void MatmulOperator::ReshapewithOnednn(const vector<Tensor*>& input, const vecto
       any_bias_m = memory(matmul_pd_.bias_desc(), eng_);
       if (bias_->is_shared()) {
         int64_t bias_size = bias_m_.get_desc().get_size();
-        void* bias_shm_ptr = MemoryAllocator::ManagedShm().find_or_construct<char>(bias_->name().c_str())[bias_size](0);
+        void* bias_shm_ptr = bias_->shm_space()->find_or_construct<char>(bias_->name().c_str())[bias_size](0);
         any_bias_m.set_data_handle(bias_shm_ptr);
       }
       dnnl::reorder(bias_m_, any_bias_m).execute(eng_stream_, bias_m_, any_bias_m);
@@ -556,7 +556,7 @@ void MatmulOperator::ReshapewithOnednn(const vector<Tensor*>& input, const vecto
       if (src1_->is_shared()) {
         int64_t weight_size = any_src1_m_.get_desc().get_size();
         void* weight_shm_ptr =
-            MemoryAllocator::ManagedShm().find_or_construct<char>(src1_->name().c_str())[weight_size](0);
+            src1_->shm_space()->find_or_construct<char>(src1_->name().c_str())[weight_size](0);
         any_src1_m_.set_data_handle(weight_shm_ptr);
       }
       dnnl::reorder(src1_m_, any_src1_m_).execute(eng_stream_, src1_m_, any_src1_m_);
@@ -624,8 +624,8 @@ void MatmulOperator::ForwardwithOnednn(const vector<Tensor*>& input, const vecto
       dst_data = post_data_ptr;
     } else {
       int data_size = post_->size();
-      string data_type = post_->dtype();
-      memcpy(dst_data, post_data_ptr, data_size * type2bytes[data_type]);
+      DataType data_type = post_->data_type();
+      memcpy(dst_data, post_data_ptr, data_size * DataTypeBytes(data_type));
       DLOG(WARNING) << "post tensor will be used by multi node...";
     }
   }
@@ -771,7 +771,7 @@ void MatmulOperator::DynamicForward(vector<int32_t>* src0_zero_points_ptr, vecto
     }
   }
 
-  if (src0_->dtype() == "u8") {
+  if (src0_->data_type() == DataType::u8) {
     auto& src0_zero_points = *src0_zero_points_ptr;
     float tmp = 1.0 / *src0_scales;
     src0_zero_points =
@@ -52,10 +52,10 @@ void MergedEmbeddingbagOperator::Forward(const vector<Tensor*>& input, const vec
   }
 
   vector<void*> weights_ptr;
-  vector<string> dtypes;
+  vector<DataType> dtypes;
   for (auto& w : weights) {
     weights_ptr.emplace_back(w->mutable_data());
-    dtypes.emplace_back(w->dtype());
+    dtypes.emplace_back(w->data_type());
   }
   vector<void*> outs_ptr;
   for (auto& o : output) {
@@ -74,20 +74,27 @@ void MergedEmbeddingbagOperator::Forward(const vector<Tensor*>& input, const vec
       int32_t pool_end = ((offset_idx + 1) % bs == 0) ? (table_id + 1) * indices->shape()[1]
                                                       : offsets_data[offset_idx + 1] + table_id * bs;
       int64_t feature_size = weights[table_id]->shape()[1];
-      if (dtypes[table_id] == "fp32") {
-        float* out_ptr = &((reinterpret_cast<float*>(outs_ptr[table_id]))[n * feature_size]);
-        float* weight_ptr = reinterpret_cast<float*>(weights_ptr[table_id]);
-        emb_pooling_ker<float>(out_ptr, weight_ptr, pool_begin, pool_end, feature_size, indices_data, mode_);
-      } else if (dtypes[table_id] == "bf16") {
-        uint16_t* out_ptr = &((reinterpret_cast<uint16_t*>(outs_ptr[table_id]))[n * feature_size]);
-        uint16_t* weight_ptr = reinterpret_cast<uint16_t*>(weights_ptr[table_id]);
-        emb_pooling_ker<uint16_t>(out_ptr, weight_ptr, pool_begin, pool_end, feature_size, indices_data, mode_);
-      } else if (dtypes[table_id] == "u8") {
-        uint8_t* out_ptr = &((reinterpret_cast<uint8_t*>(outs_ptr[table_id]))[n * feature_size]);
-        uint8_t* weight_ptr = reinterpret_cast<uint8_t*>(weights_ptr[table_id]);
-        emb_pooling_ker<uint8_t>(out_ptr, weight_ptr, pool_begin, pool_end, feature_size, indices_data, mode_);
-      } else {
-        LOG(ERROR) << "Merged embedding can not support dtype: " << dtypes[table_id];
+      switch (dtypes[table_id]) {
+        case DataType::fp32: {
+          float* out_ptr = &((reinterpret_cast<float*>(outs_ptr[table_id]))[n * feature_size]);
+          float* weight_ptr = reinterpret_cast<float*>(weights_ptr[table_id]);
+          emb_pooling_ker<float>(out_ptr, weight_ptr, pool_begin, pool_end, feature_size, indices_data, mode_);
+          break;
+        }
+        case DataType::bf16: {
+          uint16_t* out_ptr = &((reinterpret_cast<uint16_t*>(outs_ptr[table_id]))[n * feature_size]);
+          uint16_t* weight_ptr = reinterpret_cast<uint16_t*>(weights_ptr[table_id]);
+          emb_pooling_ker<uint16_t>(out_ptr, weight_ptr, pool_begin, pool_end, feature_size, indices_data, mode_);
+          break;
+        }
+        case DataType::u8: {
+          uint8_t* out_ptr = &((reinterpret_cast<uint8_t*>(outs_ptr[table_id]))[n * feature_size]);
+          uint8_t* weight_ptr = reinterpret_cast<uint8_t*>(weights_ptr[table_id]);
+          emb_pooling_ker<uint8_t>(out_ptr, weight_ptr, pool_begin, pool_end, feature_size, indices_data, mode_);
+          break;
+        }
+        default:
+          LOG(ERROR) << "Merged embedding can not support dtype: " << weights[table_id]->dtype();
       }
     }
   }
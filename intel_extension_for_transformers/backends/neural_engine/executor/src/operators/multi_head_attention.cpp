@@ -232,7 +232,7 @@ void MultiHeadAttentionOperator::Prepare(const vector<Tensor*>& input, const vec
       if (is_sparse_)
         QKV_zeropoint_ = GetZeroPoints(dst_min_->data(), dst_scales_, dst_->dtype())[0];
       else
-        QKV_zeropoint_ = (dst_->dtype() == "fp32") ? 0 : GetZeroPoints(dst_min_->data(), dst_scales_, dst_->dtype())[0];
+        QKV_zeropoint_ = (dst_->data_type() == DataType::fp32) ? 0 : GetZeroPoints(dst_min_->data(), dst_scales_, dst_->dtype())[0];
 
       for (int i = 0; i < Q_scales_.size(); i++) Q_scales_[i] = 1 / Q_scales_[i];
       for (int i = 0; i < K_scales_.size(); i++) K_scales_[i] = 1 / K_scales_[i];
@@ -349,7 +349,7 @@ void MultiHeadAttentionOperator::ReshapeDense(const vector<Tensor*>& input, cons
   // set kernel attr
   attr_map["approx_exp"] = "True";
   if (stable_softmax_ == false) {
-    attr_map["stable_softmax"] = Q_->dtype() == "s8" ? "True" : "False";
+    attr_map["stable_softmax"] = Q_->data_type() == DataType::s8 ? "True" : "False";
   } else {
     attr_map["stable_softmax"] = "True";
   }
@@ -377,7 +377,7 @@ void MultiHeadAttentionOperator::ReshapeDense(const vector<Tensor*>& input, cons
     const jd::tensor_desc desc_f32_scalar{{1}, dt::fp32, ft::a};
     ts_descs[io::ATT_SCALE] = desc_f32_scalar;
     rt_data_[io::ATT_SCALE] = &output_scale_;
-    if (Q_->dtype() == "s8") {
+    if (Q_->data_type() == DataType::s8) {
       attr_map["softmax_rescale"] = std::to_string(softmax_scales_[0]);
       ts_descs[io::Q_SCALE] = desc_f32_scalar;
       ts_descs[io::K_SCALE] = desc_f32_scalar;
@@ -392,7 +392,7 @@ void MultiHeadAttentionOperator::ReshapeDense(const vector<Tensor*>& input, cons
       rt_data_[io::SRC_DST_ZP] = &QKV_zeropoint_;
     }
     ft qkv_ft = ft::abcd;
-    auto qkv_dtype = (dst_->dtype() == "bf16") ? dt::bf16 : dt::s8;
+    auto qkv_dtype = (dst_->data_type() == DataType::bf16) ? dt::bf16 : dt::s8;
     if (Q_ != nullptr) {
       ts_descs[io::SRC_Q] = {{bs_, seq_len_q_, head_num_, head_size_qk_}, qkv_dtype, qkv_ft};
       ts_descs[io::SRC_K] = {{bs_, seq_len_kv_, head_num_, head_size_qk_}, qkv_dtype, qkv_ft};
@@ -405,7 +405,7 @@ void MultiHeadAttentionOperator::ReshapeDense(const vector<Tensor*>& input, cons
     if (att_mask_ != nullptr) {
       ts_descs[io::MASK] = {{bs_}, dt::s32, ft::a};
     }
-    ts_descs[io::DST] = {attn_shape, (dst_->dtype() == "bf16") ? dt::bf16 : dt::u8, qkv_ft};
+    ts_descs[io::DST] = {attn_shape, (dst_->data_type() == DataType::bf16) ? dt::bf16 : dt::u8, qkv_ft};
 
     if (binary_add_mask_ != nullptr) {
       const auto& badd_mask_size = binary_add_mask_->shape().size();
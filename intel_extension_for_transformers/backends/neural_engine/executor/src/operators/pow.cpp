@@ -19,10 +19,10 @@
 namespace executor {
 
 void PowOperator::Prepare(const vector<Tensor*>& input, const vector<Tensor*>& output) {
-  if (input[0]->dtype() != "fp32") {
+  if (input[0]->data_type() != DataType::fp32) {
     LOG(ERROR) << "dtype " << input[0]->dtype() << " is not supported by pow.";
   }
-  if (input[1]->dtype() != "fp32") {
+  if (input[1]->data_type() != DataType::fp32) {
     LOG(ERROR) << "dtype " << input[1]->dtype() << " is not supported by pow.";
   }
   output[0]->set_dtype(input[0]->dtype());
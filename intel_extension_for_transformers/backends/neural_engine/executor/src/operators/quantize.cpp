@@ -76,7 +76,7 @@ void QuantizeOperator::Reshape(const vector<Tensor*>& input, const vector<Tensor
       std::unordered_map<std::string, std::string> op_attrs;
       dst_min_->set_shape({src_shape[0]});
       dst_max_->set_shape({src_shape[0]});
-      mat_desc_ = {src_->shape(), src_->dtype() == "fp32" ? jd::data_type::fp32 : jd::data_type::bf16,
+      mat_desc_ = {src_->shape(), src_->data_type() == DataType::fp32 ? jd::data_type::fp32 : jd::data_type::bf16,
                    jd::format_type::undef};                                            // fp32
       dst_mat_desc_ = {dst_->shape(), jd::data_type::s8, jd::format_type::undef};      // s8
       scale_desc_ = {dst_max_->shape(), jd::data_type::fp32, jd::format_type::undef};  // fp32
@@ -106,7 +106,7 @@ void QuantizeOperator::Forward(const vector<Tensor*>& input, const vector<Tensor
   } else {
     const float* min_data = src_min_ != nullptr ? static_cast<const float*>(src_min_->data()) : nullptr;
     if (is_dynamic_) {
-      if (src_->dtype() == "fp32") {
+      if (src_->data_type() == DataType::fp32) {
         runtime_minmax(reinterpret_cast<float*>(src_->mutable_data()), src_->size(),
                        reinterpret_cast<float*>(dst_min_->mutable_data()),
                        reinterpret_cast<float*>(dst_max_->mutable_data()));
@@ -120,7 +120,7 @@ void QuantizeOperator::Forward(const vector<Tensor*>& input, const vector<Tensor
       *scale = 1.0f / scales_[0];
     }
     if (min_data == nullptr) {
-      if (dst_->dtype() == "u8") {
+      if (dst_->data_type() == DataType::u8) {
         LOG(ERROR) << "Neither choose dynamic quantization or passed min/max tensor for static ";
         return;
       }
@@ -128,25 +128,25 @@ void QuantizeOperator::Forward(const vector<Tensor*>& input, const vector<Tensor
     // quantize
     if (src_data != nullptr && dst_data != nullptr) {
 #if __AVX512F__
-      if (src_->dtype() == "bf16") {
-        if (dst_->dtype() == "s8") {
+      if (src_->data_type() == DataType::bf16) {
+        if (dst_->data_type() == DataType::s8) {
           Quantize_bf16_s8(src_->size(), src_data, scales_, dst_data);
           this->unref_tensors(input);
-        } else if (dst_->dtype() == "u8") {
+        } else if (dst_->data_type() == DataType::u8) {
           Quantize_bf16_u8(src_->size(), src_data, min_data, scales_, dst_data);
           this->unref_tensors(input);
         }
         return;
       }
-      if (dst_->dtype() == "u8") {
+      if (dst_->data_type() == DataType::u8) {
         Quantize_fp32_u8(src_->size(), src_data, min_data, scales_, dst_data);
-      } else if (dst_->dtype() == "s8") {
+      } else if (dst_->data_type() == DataType::s8) {
         Quantize_fp32_s8(src_->size(), src_data, scales_, dst_data);
       } else {
         Quantize_fp32_bf16(src_->size(), src_data, scales_, dst_data);
       }
 #else
-      if (dst_->dtype() == "u8") {
+      if (dst_->data_type() == DataType::u8) {
         Quantize_u8(src_->size(), src_data, min_data, scales_, dst_data);
       } else {
         Quantize_others(src_->size(), dst_->dtype(), src_data, scales_, dst_data);
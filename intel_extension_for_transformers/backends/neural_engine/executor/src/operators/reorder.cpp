@@ -173,9 +173,9 @@ void ReorderOperator::Forward(const vector<Tensor*>& input, const vector<Tensor*
       dst_->set_data(post_ptr);
     } else {
       int data_size = post_->size();
-      string data_type = post_->dtype();
+      DataType data_type = post_->data_type();
       void* dst_data = dst_->mutable_data();
-      memcpy(dst_data, post_ptr, data_size * type2bytes[data_type]);
+      memcpy(dst_data, post_ptr, data_size * DataTypeBytes(data_type));
       LOG(WARNING) << "post tensor will be used by multi node...";
     }
   }
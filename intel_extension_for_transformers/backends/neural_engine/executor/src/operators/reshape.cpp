@@ -166,8 +166,8 @@ void ReshapeOperator::Forward(const vector<Tensor*>& input,
   } else {
     void* dst_data_ptr = const_cast<void*>(dst_ptr->mutable_data());
     int data_size = dst_ptr->size();
-    string data_type = src_ptr->dtype();
-    memcpy(dst_data_ptr, data, data_size * type2bytes[data_type]);
+    DataType data_type = src_ptr->data_type();
+    memcpy(dst_data_ptr, data, data_size * DataTypeBytes(data_type));
     DLOG(WARNING) << "input tensor" << src_ptr->name()
                  << " will be used by multi node...";
     this->unref_tensors(input);
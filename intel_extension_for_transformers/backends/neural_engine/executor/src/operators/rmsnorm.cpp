@@ -147,8 +147,8 @@ RmsNormOperator::RmsNormOperator(const shared_ptr<OperatorConfig>& conf) : Opera
 
 void RmsNormOperator::Prepare(const vector<Tensor*>& input, const vector<Tensor*>& output) {
   Tensor* src = input[0];
-  assert(src->dtype() == "fp32" || src->dtype() == "bf16");
-  dt_bytewidth_ = src->dtype() == "fp32" ? 4 : 2;
+  assert(src->data_type() == DataType::fp32 || src->data_type() == DataType::bf16);
+  dt_bytewidth_ = src->data_type() == DataType::fp32 ? 4 : 2;
   if (dt_bytewidth_ == 4) {
     parallelB_norm_callback_ = fp32_norm;
   } else {
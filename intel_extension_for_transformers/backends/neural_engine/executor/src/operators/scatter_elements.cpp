@@ -72,7 +72,7 @@ static bool ScatterData(
   const std::vector<int64_t> input_data_shape(data_input->shape());
 
   const auto input_elements = Size(input_data_shape);
-  const auto total_input_bytes = type2bytes[data_input->dtype()] * input_elements;
+  const auto total_input_bytes = DataTypeBytes(data_input->data_type()) * input_elements;
 
   const auto num_indices = indices_data.size();
 
@@ -34,6 +34,8 @@ void SequenceLengthOperator::Forward(const vector<Tensor*>& input, const vector<
   auto dst_data = static_cast<int32_t*>(output[0]->mutable_data());
 #pragma omp parallel for
   for (int i = 0; i < mask_shape_[0]; ++i) {
+    // a fully padded sample has no token
+    dst_data[i] = 0;
     for (int j = mask_shape_[1] - 1; j >= 0; --j) {
       auto idx = i * mask_stride_[0] + j;
       if (mask_data[idx] != 0) {
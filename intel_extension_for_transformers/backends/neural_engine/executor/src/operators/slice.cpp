@@ -238,23 +238,23 @@ void SliceOperator::Forward(const vector<Tensor*>& input, const vector<Tensor*>&
     Tensor* dst = output[0];
     const vector<int64_t>& src_shape = src->shape();
     const vector<int64_t>& dst_shape = dst->shape();
-    if (src->dtype() == "fp32") {
+    if (src->data_type() == DataType::fp32) {
       const float* src_data = static_cast<const float*>(src->data());
       float* dst_data = static_cast<float*>(dst->mutable_data());
       SliceData<float>(src_data, dst_data, src_shape, dst_shape, starts_, ends_, axes_, steps_);
-    } else if (src->dtype() == "s32") {
+    } else if (src->data_type() == DataType::s32) {
       const int32_t* src_data = static_cast<const int32_t*>(src->data());
       int32_t* dst_data = static_cast<int32_t*>(dst->mutable_data());
       SliceData<int32_t>(src_data, dst_data, src_shape, dst_shape, starts_, ends_, axes_, steps_);
-    } else if (src->dtype() == "bf16") {
+    } else if (src->data_type() == DataType::bf16) {
       const uint16_t* src_data = static_cast<const uint16_t*>(src->data());
       uint16_t* dst_data = static_cast<uint16_t*>(dst->mutable_data());
       SliceData<uint16_t>(src_data, dst_data, src_shape, dst_shape, starts_, ends_, axes_, steps_);
-    } else if (src->dtype() == "u8") {
+    } else if (src->data_type() == DataType::u8) {
       const uint8_t* src_data = static_cast<const uint8_t*>(src->data());
       uint8_t* dst_data = static_cast<uint8_t*>(dst->mutable_data());
       SliceData<uint8_t>(src_data, dst_data, src_shape, dst_shape, starts_, ends_, axes_, steps_);
-    } else if (src->dtype() == "s8") {
+    } else if (src->data_type() == DataType::s8) {
       const int8_t* src_data = static_cast<const int8_t*>(src->data());
       int8_t* dst_data = static_cast<int8_t*>(dst->mutable_data());
       SliceData<int8_t>(src_data, dst_data, src_shape, dst_shape, starts_, ends_, axes_, steps_);
@@ -74,9 +74,9 @@ void SliceMaskOperator::Forward(const vector<Tensor*>& input, const vector<Tenso
   }
 
   void* dst_data = output[0]->mutable_data();
-  int64_t slice_bytes = dst_shape[3] * type2bytes[output[0]->dtype()];
+  int64_t slice_bytes = dst_shape[3] * DataTypeBytes(output[0]->data_type());
 
-  int64_t src_bytes = src_shape[3]  * type2bytes[output[0]->dtype()];
+  int64_t src_bytes = src_shape[3]  * DataTypeBytes(output[0]->data_type());
 
 
 #if __AVX512F__
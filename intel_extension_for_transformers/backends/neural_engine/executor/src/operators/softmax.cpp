@@ -255,7 +255,7 @@ void SoftmaxOperator::Reshape(const vector<Tensor*>& input, const vector<Tensor*
     // dynamic quantization will calculate the softmax result with fp32 and then quantization in runtime.
     Reshape_dnnl(input, output);
   } else if (lut_optimization_) {
-    if (input[0]->dtype() != "u8" && input[0]->dtype() != "s8") LOG(ERROR) << "LUT softmax only support int8 input dt.";
+    if (input[0]->data_type() != DataType::u8 && input[0]->data_type() != DataType::s8) LOG(ERROR) << "LUT softmax only support int8 input dt.";
     Reshape_Sparselib(input, output);
   } else if (output_dtype_ == "u8") {
     Reshape_u8(input, output);
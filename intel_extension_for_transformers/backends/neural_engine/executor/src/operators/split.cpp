@@ -75,13 +75,13 @@ void SplitOperator::Forward(const vector<Tensor*>& input, const vector<Tensor*>&
     for (int output_index = 0; output_index < dst_num_; output_index++) {
       vector<int64_t> dst_shape = src_shape_;
       dst_shape[axis_] = split_[output_index];
-      if (input[0]->dtype() == "int32") {
+      if (input[0]->data_type() == DataType::s32) {
         int32_t* dst_data = AddrAddOffset<int32_t>(reinterpret_cast<int32_t*>(src_data), element_offset);
         output[output_index]->set_data(reinterpret_cast<void*>(dst_data));
-      } else if (input[0]->dtype() == "fp32") {
+      } else if (input[0]->data_type() == DataType::fp32) {
         float* dst_data = AddrAddOffset<float>(reinterpret_cast<float*>(src_data), element_offset);
         output[output_index]->set_data(reinterpret_cast<void*>(dst_data));
-      } else if (input[0]->dtype() == "s8") {
+      } else if (input[0]->data_type() == DataType::s8) {
         int8_t* dst_data = AddrAddOffset<int8_t>(reinterpret_cast<int8_t*>(src_data), element_offset);
         output[output_index]->set_data(reinterpret_cast<void*>(dst_data));
       }
@@ -93,13 +93,13 @@ void SplitOperator::Forward(const vector<Tensor*>& input, const vector<Tensor*>&
       dst_shape[axis_] = split_[output_index];
       for (int i = 0; i < dst_shape[0]; i++) {
         for (int j = 0; j < dst_shape[1]; j++) {
-          if (input[0]->dtype() == "fp32") {
+          if (input[0]->data_type() == DataType::fp32) {
             SplitCopy<float>(input[0]->data(), output[output_index]->mutable_data(),
                              i * src_shape_[1] + j + dst_shape[1] * output_index, i * dst_shape[1] + j);
-          } else if (input[0]->dtype() == "int32") {
+          } else if (input[0]->data_type() == DataType::s32) {
             SplitCopy<int32_t>(input[0]->data(), output[output_index]->mutable_data(),
                                i * src_shape_[1] + j + dst_shape[1] * output_index, i * dst_shape[1] + j);
-          } else if (input[0]->dtype() == "s8") {
+          } else if (input[0]->data_type() == DataType::s8) {
             SplitCopy<int8_t>(input[0]->data(), output[output_index]->mutable_data(),
                               i * src_shape_[1] + j + dst_shape[1] * output_index, i * dst_shape[1] + j);
           }
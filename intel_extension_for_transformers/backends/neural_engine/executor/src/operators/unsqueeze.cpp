@@ -71,7 +71,7 @@ void UnsqueezeOperator::Forward(const vector<Tensor*>& input, const vector<Tenso
     dst_ptr->set_data(src_data);
   } else {
     // just copy data
-    memcpy(dst_ptr->mutable_data(), src_data, src_ptr->size() * type2bytes[src_ptr->dtype()]);
+    memcpy(dst_ptr->mutable_data(), src_data, src_ptr->size() * DataTypeBytes(src_ptr->data_type()));
     this->unref_tensors(input);
   }
 }
@@ -350,19 +350,16 @@ int main(int argc, char** argv) {
   while ((n_remain != 0 && !is_antiprompt) || params.interactive) {
     // predict
     if (embd.size() > 0) {
-      // infinite text generation via context swapping
+      // infinite text generation via a rolling KV cache
       // if we run out of context:
-      // - take the n_keep first tokens from the original prompt (via n_past)
-      // - take half of the last (n_ctx - n_keep) tokens and recompute the logits in batches
+      // - keep the n_keep first tokens from the original prompt (via n_past) as attention sinks
+      // - evict the older half of the last (n_ctx - n_keep) tokens from the KV cache, the other half is kept as is
       if (n_past + (int)embd.size() > n_ctx) {
-        const int n_left = n_past - params.n_keep;
-
         // always keep the first token - BOS
-        n_past = std::max(1, params.n_keep);
+        const int n_keep = std::max(1, params.n_keep);
+        const int n_discard = (n_past - n_keep) / 2;
 
-        // insert n_left/2 tokens at the start of embd from last_n_tokens
-        embd.insert(embd.begin(), last_n_tokens.begin() + n_ctx - n_left / 2 - embd.size(),
-                    last_n_tokens.end() - embd.size());
+        n_past = model_kv_cache_shift(ctx, n_past, n_keep, n_discard, params.n_threads);
 
         // stop saving session if we run out of context
         path_session.clear();
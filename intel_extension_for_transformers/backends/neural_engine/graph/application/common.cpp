@@ -685,6 +685,7 @@ void quant_print_usage(int argc, char** argv, const quant_params& params) {
   fprintf(stderr,
           "  --compute_type             Gemm computation data type: int8/fp32/ggml (default: "
           "ggml)\n");
+  fprintf(stderr, "  --weight_dtype dtype  int/fp8_e4m3/fp8_e5m2 type for jblas weights (default: int)\n");
   fprintf(stderr, "\n");
 }
 
@@ -709,6 +710,8 @@ bool quant_params_parse(int argc, char** argv, quant_params& params) {
       params.scale_dtype = argv[++i];
     } else if (arg == "--compute_type") {
       params.compute_type = argv[++i];
+    } else if (arg == "--weight_dtype") {
+      params.weight_dtype = argv[++i];
     } else if (arg == "-h" || arg == "--help") {
       quant_print_usage(argc, argv, params);
       exit(0);
@@ -721,7 +724,7 @@ bool quant_params_parse(int argc, char** argv, quant_params& params) {
 }
 
 ne_ftype quant_params_to_ftype(const quant_params& params) {
-  if (params.compute_type == "ggml") {
+  if (params.compute_type == "ggml" && params.weight_dtype == "int") {
     if (params.bits == 4) {
       if (params.alg == "sym") {
         return NE_FTYPE_MOSTLY_Q4_0;
@@ -744,7 +747,7 @@ ne_ftype quant_params_to_ftype(const quant_params& params) {
 }
 
 ne_type quant_params_to_type(const quant_params& params) {
-  if (params.compute_type == "ggml") {
+  if (params.compute_type == "ggml" && params.weight_dtype == "int") {
     if (params.bits == 4) {
       if (params.alg == "sym") {
         return NE_TYPE_Q4_0;
@@ -770,7 +773,13 @@ size_t jblas_quantize(const float* f32ptr, void* dstpr, const quant_params param
   auto cd = jblas::utils::parallel::CpuDevice::getInstance();
   jblas::prologue::PackedWeight* packedw = NULL;
   auto type = CompType::S4_F32;
-  if (params.bits == 4) {
+  if (params.weight_dtype == "fp8_e4m3") {
+    type = CompType::F8E4M3_F32;
+  } else if (params.weight_dtype == "fp8_e5m2") {
+    type = CompType::F8E5M2_F32;
+  } else if (params.weight_dtype != "int") {
+    return 0;
+  } else if (params.bits == 4) {
     if (params.scale_dtype == "bf16") {
       type = CompType::S4_Bf16;
     } else {
@@ -782,7 +791,12 @@ size_t jblas_quantize(const float* f32ptr, void* dstpr, const quant_params param
     return 0;
   }
   cd->setThreads(params.nthread);
-  if (params.bits == 4) {
+  if (params.weight_dtype != "int") {
+    using GemmKernel = jblas::wrapper::gemm_default::weight_comp::avx512f::GemmKernelF8KBlock;
+    static GemmKernel kernel;
+    assert(cd->AVX512F());
+    packedw = kernel.getWeightPtr()->compressWeightTranspose(n, k, f32ptr, k, params.block_size, type);
+  } else if (params.bits == 4) {
     if (params.compute_type == "int8") {
       using GemmKernel = jblas::wrapper::gemm_default::weight_comp::avx512_vnni::GemmKernelDynamicQuantS4KBlock;
       static GemmKernel kernel;
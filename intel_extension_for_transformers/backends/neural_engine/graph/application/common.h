@@ -150,6 +150,7 @@ struct quant_params {
   int32_t block_size = 32;
   std::string scale_dtype = "fp32";
   std::string compute_type = "ggml";
+  std::string weight_dtype = "int";
 };
 
 ne_ftype quant_params_to_ftype(const quant_params& params);
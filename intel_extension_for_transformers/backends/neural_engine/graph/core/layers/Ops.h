@@ -51,6 +51,7 @@ enum ne_op {
   NE_OP_SCALE,
   NE_OP_SET,
   NE_OP_CPY,
+  NE_OP_CPY_I8_SCALED,
   NE_OP_CONT,
   NE_OP_RESHAPE,
   NE_OP_VIEW,
@@ -75,6 +76,11 @@ enum ne_op {
   NE_OP_MUL_FFN_GELU,
   NE_OP_MUL_FFN_ADD_GELU,
   NE_OP_FLASH_ATTN,
+  NE_OP_FLASH_ATTN_KV,
+  NE_OP_ROPE_KV,
+  NE_OP_KV_SHIFT,
+  NE_OP_NORM_FUSED,
+  NE_OP_SCALE_MASK_SOFT_MAX,
   NE_OP_FLASH_FF,
 
   NE_OP_MAP_UNARY,
@@ -0,0 +1,196 @@
+//  Copyright (c) 2023 Intel Corporation
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// the element-wise helpers are inline in ele_wise.h, this unit only holds their test and micro-benchmark
+#include "layers/ele_wise.h"
+
+#ifdef NE_TESTS
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "layers/ne_test_layers_utils.hpp"
+
+namespace {
+bool return_success = true;
+
+// the ISA the helpers are compiled for, selected at build time by the NE_AVX* options; the f32 helpers use the
+// 256-bit NE_F32_VEC of simd.h from AVX on, the integer ones need AVX2
+const char* simd_isa() {
+#if defined(__AVX2__)
+  return "avx2";
+#elif defined(__AVX__)
+  return "avx";
+#elif defined(__SSE3__)
+  return "sse3";
+#else
+  return "scalar";
+#endif
+}
+
+// scalar references, kept out of the auto-vectorizer to measure what the helpers gain over a plain loop
+#if defined(__GNUC__) && !defined(__clang__)
+#define NE_NO_VECTORIZE __attribute__((optimize("no-tree-vectorize")))
+#else
+#define NE_NO_VECTORIZE
+#endif
+NE_NO_VECTORIZE void ref_add(int n, float* z, const float* x, const float* y) {
+  for (int i = 0; i < n; ++i) z[i] = x[i] + y[i];
+}
+NE_NO_VECTORIZE void ref_add1(int n, float* z, const float* x, float v) {
+  for (int i = 0; i < n; ++i) z[i] = x[i] + v;
+}
+NE_NO_VECTORIZE void ref_acc(int n, float* y, const float* x) {
+  for (int i = 0; i < n; ++i) y[i] += x[i];
+}
+NE_NO_VECTORIZE void ref_sub(int n, float* z, const float* x, const float* y) {
+  for (int i = 0; i < n; ++i) z[i] = x[i] - y[i];
+}
+NE_NO_VECTORIZE void ref_mul(int n, float* z, const float* x, const float* y) {
+  for (int i = 0; i < n; ++i) z[i] = x[i] * y[i];
+}
+NE_NO_VECTORIZE void ref_div(int n, float* z, const float* x, const float* y) {
+  for (int i = 0; i < n; ++i) z[i] = x[i] / y[i];
+}
+NE_NO_VECTORIZE void ref_cpy(int n, float* y, const float* x) {
+  for (int i = 0; i < n; ++i) y[i] = x[i];
+}
+NE_NO_VECTORIZE void ref_neg(int n, float* y, const float* x) {
+  for (int i = 0; i < n; ++i) y[i] = -x[i];
+}
+NE_NO_VECTORIZE void ref_set(int n, float* x, float v) {
+  for (int i = 0; i < n; ++i) x[i] = v;
+}
+NE_NO_VECTORIZE void ref_set_i32(int n, int32_t* x, int32_t v) {
+  for (int i = 0; i < n; ++i) x[i] = v;
+}
+NE_NO_VECTORIZE void ref_srl_i32(int n, int32_t* z, const int32_t* x, int32_t v) {
+  for (int i = 0; i < n; ++i) z[i] = x[i] >> v;
+}
+NE_NO_VECTORIZE void ref_and_i32(int n, int32_t* z, const int32_t* x, const int32_t* y) {
+  for (int i = 0; i < n; ++i) z[i] = x[i] & y[i];
+}
+
+class TestEleWise {
+ public:
+  TestEleWise() {
+    printf("Test suit: %s (%s)\n", __FUNCTION__, simd_isa());
+    // lengths around the SIMD step to cover the leftovers
+    for (int n : {1, 7, 8, 31, 32, 33, 95, 4096, 4099}) return_success &= test_case(n);
+    return_success &= test_inplace(1027);
+    bench(4096, 2000);
+    printf("Test suit done: %s\n", __FUNCTION__);
+  }
+
+  // the helpers do the same IEEE operation per element as the scalar loops, so the results are bit-exact
+  bool test_case(int n) {
+    printf("Test case : n_%d\n", n);
+    std::vector<float> x(n), y(n), dst(n), ref(n);
+    init_vector(&x, -10.f, 10.f, n);
+    init_vector(&y, 0.5f, 10.f, n + 1);
+    bool ok = true;
+    const auto check = [&](const char* name) {
+      if (memcmp(dst.data(), ref.data(), n * sizeof(float)) != 0) {
+        printf("mismatch: %s\n", name);
+        ok = false;
+      }
+    };
+    ne_vec_add_f32(n, dst.data(), x.data(), y.data()), ref_add(n, ref.data(), x.data(), y.data()), check("add");
+    ne_vec_add1_f32(n, dst.data(), x.data(), .3f), ref_add1(n, ref.data(), x.data(), .3f), check("add1");
+    ne_vec_sub_f32(n, dst.data(), x.data(), y.data()), ref_sub(n, ref.data(), x.data(), y.data()), check("sub");
+    ne_vec_mul_f32(n, dst.data(), x.data(), y.data()), ref_mul(n, ref.data(), x.data(), y.data()), check("mul");
+    ne_vec_div_f32(n, dst.data(), x.data(), y.data()), ref_div(n, ref.data(), x.data(), y.data()), check("div");
+    ne_vec_cpy_f32(n, dst.data(), x.data()), ref_cpy(n, ref.data(), x.data()), check("cpy");
+    ne_vec_neg_f32(n, dst.data(), x.data()), ref_neg(n, ref.data(), x.data()), check("neg");
+    ne_vec_set_f32(n, dst.data(), -2.5f), ref_set(n, ref.data(), -2.5f), check("set");
+    ne_vec_acc_f32(n, dst.data(), x.data()), ref_acc(n, ref.data(), x.data()), check("acc");
+    ne_vec_acc1_f32(n, dst.data(), 1.5f), ref_add1(n, ref.data(), ref.data(), 1.5f), check("acc1");
+    // signed zeros must keep their sign through neg
+    x[0] = 0.f;
+    ne_vec_neg_f32(n, dst.data(), x.data()), ref_neg(n, ref.data(), x.data()), check("neg zero");
+
+    std::vector<int32_t> xi(n), yi(n), dsti(n), refi(n);
+    for (int i = 0; i < n; ++i) xi[i] = static_cast<int32_t>(x[i] * 1e6f), yi[i] = static_cast<int32_t>(y[i] * 1e6f);
+    const auto check_i = [&](const char* name) {
+      if (memcmp(dsti.data(), refi.data(), n * sizeof(int32_t)) != 0) {
+        printf("mismatch: %s\n", name);
+        ok = false;
+      }
+    };
+    ne_vec_srl_i32(n, dsti.data(), xi.data(), 3), ref_srl_i32(n, refi.data(), xi.data(), 3), check_i("srl_i32");
+    ne_vec_and_i32(n, dsti.data(), xi.data(), yi.data()), ref_and_i32(n, refi.data(), xi.data(), yi.data());
+    check_i("and_i32");
+    ne_vec_set_i32(n, dsti.data(), -7), ref_set_i32(n, refi.data(), -7), check_i("set_i32");
+
+    std::vector<int16_t> dst16(n + 1, 0x5a5a);
+    ne_vec_set_i16(n, dst16.data(), -3);
+    for (int i = 0; i < n; ++i) ok &= dst16[i] == -3;
+    ok &= dst16[n] == 0x5a5a;  // no write past the end
+    std::vector<int8_t> dst8(n + 1, 0x5a);
+    ne_vec_set_i8(n, dst8.data(), -3);
+    for (int i = 0; i < n; ++i) ok &= dst8[i] == -3;
+    ok &= dst8[n] == 0x5a;
+    return ok;
+  }
+
+  // the graph calls add/mul with dst == src0 for in-place ops
+  bool test_inplace(int n) {
+    printf("Test case : inplace n_%d\n", n);
+    std::vector<float> x(n), y(n), ref(n);
+    init_vector(&x, -10.f, 10.f, 1);
+    init_vector(&y, -10.f, 10.f, 2);
+    ref_add(n, ref.data(), x.data(), y.data());
+    ne_vec_add_f32(n, x.data(), x.data(), y.data());
+    return memcmp(x.data(), ref.data(), n * sizeof(float)) == 0;
+  }
+
+  static double time_us(int n_iter, const std::function<void()>& f) {
+    f();  // warm up
+    const auto t0 = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < n_iter; ++i) f();
+    const auto t1 = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::micro>(t1 - t0).count() / n_iter;
+  }
+
+  // scalar reference vs helper, the timings are only informative (sanitizers are on in the test builds)
+  void bench(int n, int n_iter) {
+    std::vector<float> x(n), y(n), z(n);
+    init_vector(&x, -10.f, 10.f, 3);
+    init_vector(&y, 0.5f, 10.f, 4);
+    float *px = x.data(), *py = y.data(), *pz = z.data();
+    const auto row = [&](const char* name, const std::function<void()>& ref, const std::function<void()>& vec) {
+      const double t_ref = time_us(n_iter, ref), t_vec = time_us(n_iter, vec);
+      printf("  %-6s scalar %8.3f us  %s %8.3f us  x%.2f\n", name, t_ref, simd_isa(), t_vec, t_ref / t_vec);
+    };
+    printf("Bench n_%d:\n", n);
+    row("add", [&] { ref_add(n, pz, px, py); }, [&] { ne_vec_add_f32(n, pz, px, py); });
+    row("acc", [&] { ref_acc(n, pz, px); }, [&] { ne_vec_acc_f32(n, pz, px); });
+    row("sub", [&] { ref_sub(n, pz, px, py); }, [&] { ne_vec_sub_f32(n, pz, px, py); });
+    row("mul", [&] { ref_mul(n, pz, px, py); }, [&] { ne_vec_mul_f32(n, pz, px, py); });
+    row("div", [&] { ref_div(n, pz, px, py); }, [&] { ne_vec_div_f32(n, pz, px, py); });
+    row("cpy", [&] { ref_cpy(n, pz, px); }, [&] { ne_vec_cpy_f32(n, pz, px); });
+    row("neg", [&] { ref_neg(n, pz, px); }, [&] { ne_vec_neg_f32(n, pz, px); });
+    row("set", [&] { ref_set(n, pz, 1.f); }, [&] { ne_vec_set_f32(n, pz, 1.f); });
+  }
+};
+static const TestEleWise inst_;
+
+}  // namespace
+
+int main() {
+  printf("NE_TESTS: ele_wise ");
+  printf(return_success ? "OK\n" : "FAILED\n");
+  return return_success ? 0 : -1;
+}
+#endif
@@ -14,6 +14,7 @@
 #pragma once
 
 #include <math.h>
+#include <string.h>
 #include "core/data_types.h"
 #include "vectors/cpu/simd.h"
 
@@ -24,61 +25,134 @@ extern "C" {
 // fundamental operations
 //
 
-inline static void ne_vec_set_i8(const int n, int8_t* x, const int8_t v) {
-  for (int i = 0; i < n; ++i) x[i] = v;
-}
+#if defined(NE_SIMD)
+// one step of NE_F32_STEP elements, the leftovers are done by the scalar loop of the caller
+#define NE_F32_STEP_UNARY(y, x, OP)                                                         \
+  for (int j = 0; j < NE_F32_ARR; j++) {                                                    \
+    NE_F32_VEC_STORE((y) + j * NE_F32_EPR, OP(NE_F32_VEC_LOAD((x) + j * NE_F32_EPR)));      \
+  }
+#define NE_F32_STEP_BINARY(z, x, y, OP)                                                     \
+  for (int j = 0; j < NE_F32_ARR; j++) {                                                    \
+    const NE_F32_VEC ax = NE_F32_VEC_LOAD((x) + j * NE_F32_EPR);                            \
+    const NE_F32_VEC ay = NE_F32_VEC_LOAD((y) + j * NE_F32_EPR);                            \
+    NE_F32_VEC_STORE((z) + j * NE_F32_EPR, OP(ax, ay));                                     \
+  }
+#define NE_F32_STEP_BINARY1(z, x, vv, OP)                                                   \
+  for (int j = 0; j < NE_F32_ARR; j++) {                                                    \
+    NE_F32_VEC_STORE((z) + j * NE_F32_EPR, OP(NE_F32_VEC_LOAD((x) + j * NE_F32_EPR), (vv))); \
+  }
+#define NE_F32_VEC_IDENTITY(x) (x)
+#define NE_F32_VEC_NEG(x) NE_F32_VEC_MUL((x), NE_F32_VEC_SET1(-1.0f))
+#endif
+
+inline static void ne_vec_set_i8(const int n, int8_t* x, const int8_t v) { memset(x, v, n); }
 
 inline static void ne_vec_set_i16(const int n, int16_t* x, const int16_t v) {
-  for (int i = 0; i < n; ++i) x[i] = v;
+  int i = 0;
+#if defined(__AVX__)
+  const __m256i vv = _mm256_set1_epi16(v);
+  for (; i + 16 <= n; i += 16) _mm256_storeu_si256((__m256i*)(x + i), vv);
+#endif
+  for (; i < n; ++i) x[i] = v;
 }
 
 inline static void ne_vec_set_i32(const int n, int32_t* x, const int32_t v) {
-  for (int i = 0; i < n; ++i) x[i] = v;
+  int i = 0;
+#if defined(__AVX__)
+  const __m256i vv = _mm256_set1_epi32(v);
+  for (; i + 8 <= n; i += 8) _mm256_storeu_si256((__m256i*)(x + i), vv);
+#endif
+  for (; i < n; ++i) x[i] = v;
 }
 
+// v is the raw fp16 bits
 inline static void ne_vec_set_f16(const int n, ne_fp16_t* x, const int32_t v) {
-  for (int i = 0; i < n; ++i) x[i] = v;
+  ne_vec_set_i16(n, (int16_t*)x, (int16_t)v);
 }
 
 inline static void ne_vec_srl_i32(const int n, int32_t* z, const int32_t* x, int32_t v) {
-  for (int i = 0; i < n; ++i) z[i] = x[i] >> v;
+  int i = 0;
+#if defined(__AVX2__)
+  const __m128i vv = _mm_cvtsi32_si128(v);
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_si256((__m256i*)(z + i), _mm256_sra_epi32(_mm256_loadu_si256((const __m256i*)(x + i)), vv));
+  }
+#endif
+  for (; i < n; ++i) z[i] = x[i] >> v;
 }
 
 inline static void ne_vec_and_i32(const int n, int32_t* z, const int32_t* x, const int32_t* y) {
-  for (int i = 0; i < n; ++i) z[i] = x[i] & y[i];
+  int i = 0;
+#if defined(__AVX2__)
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_si256((__m256i*)(z + i), _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(x + i)),
+                                                            _mm256_loadu_si256((const __m256i*)(y + i))));
+  }
+#endif
+  for (; i < n; ++i) z[i] = x[i] & y[i];
 }
 
 inline static void ne_vec_add_f32(const int n, float* z, const float* x, const float* y) {
-  for (int i = 0; i < n; ++i) z[i] = x[i] + y[i];
+  int i = 0;
+#if defined(NE_SIMD)
+  for (; i + NE_F32_STEP <= n; i += NE_F32_STEP) NE_F32_STEP_BINARY(z + i, x + i, y + i, NE_F32_VEC_ADD);
+#endif
+  for (; i < n; ++i) z[i] = x[i] + y[i];
 }
 inline static void ne_vec_add1_f32(const int n, float* z, const float* x, const float v) {
-  for (int i = 0; i < n; ++i) z[i] = x[i] + v;
-}
-inline static void ne_vec_acc_f32(const int n, float* y, const float* x) {
-  for (int i = 0; i < n; ++i) y[i] += x[i];
-}
-inline static void ne_vec_acc1_f32(const int n, float* y, const float v) {
-  for (int i = 0; i < n; ++i) y[i] += v;
+  int i = 0;
+#if defined(NE_SIMD)
+  const NE_F32_VEC vv = NE_F32_VEC_SET1(v);
+  for (; i + NE_F32_STEP <= n; i += NE_F32_STEP) NE_F32_STEP_BINARY1(z + i, x + i, vv, NE_F32_VEC_ADD);
+#endif
+  for (; i < n; ++i) z[i] = x[i] + v;
 }
+inline static void ne_vec_acc_f32(const int n, float* y, const float* x) { ne_vec_add_f32(n, y, y, x); }
+inline static void ne_vec_acc1_f32(const int n, float* y, const float v) { ne_vec_add1_f32(n, y, y, v); }
 inline static void ne_vec_sub_f32(const int n, float* z, const float* x, const float* y) {
-  for (int i = 0; i < n; ++i) z[i] = x[i] - y[i];
+  int i = 0;
+#if defined(NE_SIMD)
+  for (; i + NE_F32_STEP <= n; i += NE_F32_STEP) NE_F32_STEP_BINARY(z + i, x + i, y + i, NE_F32_VEC_SUB);
+#endif
+  for (; i < n; ++i) z[i] = x[i] - y[i];
 }
 
 inline static void ne_vec_set_f32(const int n, float* x, const float v) {
-  for (int i = 0; i < n; ++i) x[i] = v;
+  int i = 0;
+#if defined(NE_SIMD)
+  const NE_F32_VEC vv = NE_F32_VEC_SET1(v);
+  for (; i + NE_F32_EPR <= n; i += NE_F32_EPR) NE_F32_VEC_STORE(x + i, vv);
+#endif
+  for (; i < n; ++i) x[i] = v;
 }
 
 inline static void ne_vec_cpy_f32(const int n, float* y, const float* x) {
-  for (int i = 0; i < n; ++i) y[i] = x[i];
+  int i = 0;
+#if defined(NE_SIMD)
+  for (; i + NE_F32_STEP <= n; i += NE_F32_STEP) NE_F32_STEP_UNARY(y + i, x + i, NE_F32_VEC_IDENTITY);
+#endif
+  for (; i < n; ++i) y[i] = x[i];
 }
 inline static void ne_vec_neg_f32(const int n, float* y, const float* x) {
-  for (int i = 0; i < n; ++i) y[i] = -x[i];
+  int i = 0;
+#if defined(NE_SIMD)
+  for (; i + NE_F32_STEP <= n; i += NE_F32_STEP) NE_F32_STEP_UNARY(y + i, x + i, NE_F32_VEC_NEG);
+#endif
+  for (; i < n; ++i) y[i] = -x[i];
 }
 inline static void ne_vec_mul_f32(const int n, float* z, const float* x, const float* y) {
-  for (int i = 0; i < n; ++i) z[i] = x[i] * y[i];
+  int i = 0;
+#if defined(NE_SIMD)
+  for (; i + NE_F32_STEP <= n; i += NE_F32_STEP) NE_F32_STEP_BINARY(z + i, x + i, y + i, NE_F32_VEC_MUL);
+#endif
+  for (; i < n; ++i) z[i] = x[i] * y[i];
 }
 inline static void ne_vec_div_f32(const int n, float* z, const float* x, const float* y) {
-  for (int i = 0; i < n; ++i) z[i] = x[i] / y[i];
+  int i = 0;
+#if defined(NE_SIMD)
+  for (; i + NE_F32_STEP <= n; i += NE_F32_STEP) NE_F32_STEP_BINARY(z + i, x + i, y + i, NE_F32_VEC_DIV);
+#endif
+  for (; i < n; ++i) z[i] = x[i] / y[i];
 }
 
 inline static void ne_vec_mad_f32(const int n, float* __restrict y, const float* __restrict x, const float v) {
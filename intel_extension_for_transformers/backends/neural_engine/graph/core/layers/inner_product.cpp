@@ -13,10 +13,16 @@
 //  limitations under the License.
 #include "layers/inner_product.h"
 #include "layers/ele_wise.h"
+#include "layers/numa.h"
 #include "jblas/jit_blas_weight_compression.h"
 #include "jblas/jit_blas_transformer.h"
 
 using namespace jblas;
+static inline bool jblas_is_f8_weight(const prologue::PackedWeight* ptr) {
+  return ptr->mType == static_cast<int>(prologue::weight_comp::gemm::WeightCompType::F8E4M3_F32) ||
+         ptr->mType == static_cast<int>(prologue::weight_comp::gemm::WeightCompType::F8E5M2_F32);
+}
+
 void jblas_init() {
   GetCPUDevice();
   if (_cd->AMX_BF16() || _cd->AMX_INT8()) {
@@ -43,17 +49,30 @@ void jblas_weights4block_f32_forward(float* activation, void* weiptr, float* out
       ret = kernel.compute({_m, _n, _k, activation, lda, wtmp, output, ldo});
     }
   } else if (wtmp->mCoreType == jblas::gemm::GemmCoreType::AVX512F_8X48) {
-    using GemmKernel = jblas::wrapper::gemm_default::weight_comp::avx512f::GemmKernelS4KBlock;
-    float alpha = 1.f, beta = 0.f;
-    static GemmKernel kernel;
     if (_cd->AVX512F()) {
-      ret = kernel.compute({_m, _n, _k, activation, lda, wtmp, output, output, ldo, ldo, alpha, beta});
+      if (jblas_is_f8_weight(wtmp)) {
+        using GemmKernel = jblas::wrapper::gemm_default::weight_comp::avx512f::GemmKernelF8KBlock;
+        float alpha = 1.f, beta = 0.f;
+        static GemmKernel kernel;
+        ret = kernel.compute({_m, _n, _k, activation, lda, wtmp, output, output, ldo, ldo, alpha, beta});
+      } else {
+        using GemmKernel = jblas::wrapper::gemm_default::weight_comp::avx512f::GemmKernelS4KBlock;
+        float alpha = 1.f, beta = 0.f;
+        static GemmKernel kernel;
+        ret = kernel.compute({_m, _n, _k, activation, lda, wtmp, output, output, ldo, ldo, alpha, beta});
+      }
     }
   } else if (wtmp->mCoreType == jblas::gemm::GemmCoreType::AMX_BF16_16x64) {
-    using GemmKernel = jblas::wrapper::gemm_default::weight_comp::amx_bf16::GemmKernelS4KBlock;
-    static GemmKernel kernel;
     if (_cd->AMX_BF16()) {
-      ret = kernel.compute({_m, _n, _k, activation, lda, wtmp, output, ldo});
+      if (jblas_is_f8_weight(wtmp)) {
+        using GemmKernel = jblas::wrapper::gemm_default::weight_comp::amx_bf16::GemmKernelF8KBlock;
+        static GemmKernel kernel;
+        ret = kernel.compute({_m, _n, _k, activation, lda, wtmp, output, ldo});
+      } else {
+        using GemmKernel = jblas::wrapper::gemm_default::weight_comp::amx_bf16::GemmKernelS4KBlock;
+        static GemmKernel kernel;
+        ret = kernel.compute({_m, _n, _k, activation, lda, wtmp, output, ldo});
+      }
     }
   }
   assert(ret == JblasSuccess);
@@ -73,19 +92,10 @@ class Silu {
   template <JBLAS_ISA ISA_T>
   JBLAS_CODE forward(const float* cacheptr, const int cachestep, const int M_offset, const int N_offset, const int M,
                      const int N, const Param& _param) {
-    auto COffset = M_offset * _param.ldc + N_offset;
-    auto cptr = _param.C + COffset;
-#if __AVX512F__
-    if (jblas::utils::isa_base<ISA_T>::avx512f) {
-      // TODO
-    }
-#endif
-    for (int i = 0; i < M; i++) {
-      for (int j = 0; j < N; j++) {
-        cptr[i * _param.ldc + j] = ne_silu_f32(cacheptr[i * cachestep + j]);
-      }
-    }
-    return JblasSuccess;
+    static_assert(std::is_same<_T, float>::value, "Silu epilogue only supports float output now.");
+    auto cptr = _param.C + M_offset * _param.ldc + N_offset;
+    return kernel::wrapper::BiasActF32F32<SWISH>::template forward<ISA_T>(cacheptr, cachestep, NULL, 0, cptr,
+                                                                          _param.ldc, M, N);
   }
 };
 
@@ -100,17 +110,10 @@ class Gelu {
   template <JBLAS_ISA ISA_T>
   JBLAS_CODE forward(const float* cacheptr, const int cachestep, const int M_offset, const int N_offset, const int M,
                      const int N, const Param& _param) {
-    auto COffset = M_offset * _param.ldc + N_offset;
-    auto cptr = _param.C + COffset;
-    // for (int i = 0; i < M; i++) {
-    //   ne_vec_gelu_f32(N, cptr + i * _param.ldc, cacheptr + i * cachestep);
-    // }
-    for (int i = 0; i < M; i++) {
-      for (int j = 0; j < N; j++) {
-        cptr[i * _param.ldc + j] = ne_gelu_f32(cacheptr[i * cachestep + j]);
-      }
-    }
-    return JblasSuccess;
+    static_assert(std::is_same<_T, float>::value, "Gelu epilogue only supports float output now.");
+    auto cptr = _param.C + M_offset * _param.ldc + N_offset;
+    return kernel::wrapper::BiasActF32F32<GELU>::template forward<ISA_T>(cacheptr, cachestep, NULL, 0, cptr,
+                                                                         _param.ldc, M, N);
   }
 };
 
@@ -125,19 +128,11 @@ class Add {
   template <JBLAS_ISA ISA_T>
   JBLAS_CODE forward(const float* cacheptr, const int cachestep, const int M_offset, const int N_offset, const int M,
                      const int N, const Param& _param) {
-    auto COffset = M_offset * _param.ldc + N_offset;
-    auto DOffset = M_offset * _param.ldd + N_offset;
-    auto cptr = _param.C + COffset;
-    auto dptr = _param.D + DOffset;
-    // for (int i = 0; i < M; i++) {
-    //   ne_vec_add_f32(N, cptr + i * _param.ldc,dptr + i * _param.ldd, cacheptr + i * cachestep);
-    // }
-    for (int i = 0; i < M; i++) {
-      for (int j = 0; j < N; j++) {
-        cptr[i * _param.ldc + j] = dptr[i * _param.ldd + j] + cacheptr[i * cachestep + j];
-      }
-    }
-    return JblasSuccess;
+    static_assert(std::is_same<_T, float>::value, "Add epilogue only supports float output now.");
+    auto cptr = _param.C + M_offset * _param.ldc + N_offset;
+    auto dptr = _param.D + M_offset * _param.ldd + N_offset;
+    return kernel::wrapper::AlphaBetaF32F32::template forward<ISA_T>(1.f, cacheptr, cachestep, 1.f, dptr, _param.ldd,
+                                                                     cptr, _param.ldc, M, N);
   }
 };
 
@@ -152,24 +147,11 @@ class Add_Gelu {
   template <JBLAS_ISA ISA_T>
   JBLAS_CODE forward(const float* cacheptr, const int cachestep, const int M_offset, const int N_offset, const int M,
                      const int N, const Param& _param) {
-    auto COffset = M_offset * _param.ldc + N_offset;
-    auto DOffset = M_offset * _param.ldd + N_offset;
-    auto cptr = _param.C + COffset;
-    auto dptr = _param.D + DOffset;
-    for (int i = 0; i < M; i++) {
-      ne_vec_add_f32(N, cptr + i * _param.ldc, dptr + i * _param.ldd, cacheptr + i * cachestep);
-      // ne_vec_gelu_f32(N, cptr + i * _param.ldc, cptr + i * _param.ldc);
-    }
-    jblas::epilogue::gemm::AccumulatorWriteBackWithGelu<float, float> ker;
-    jblas::epilogue::gemm::AccumulatorWriteBackWithGelu<float, float>::Param param{_param.C, _param.ldc};
-    ker.forward<JblasAVX512F>(cptr, _param.ldc, M_offset, N_offset, M, N, param);
-    /*for (int i = 0; i < M; i++) {
-      for (int j = 0; j < N; j++) {
-        cptr[i * _param.ldc + j] = dptr[i * _param.ldd + j] + cacheptr[i * cachestep + j];
-        cptr[i * _param.ldc + j] = ne_gelu_f32(cptr[i * _param.ldc + j]);
-      }
-    }*/
-    return JblasSuccess;
+    static_assert(std::is_same<_T, float>::value, "Add_Gelu epilogue only supports float output now.");
+    auto cptr = _param.C + M_offset * _param.ldc + N_offset;
+    auto dptr = _param.D + M_offset * _param.ldd + N_offset;
+    return kernel::wrapper::BiasActF32F32<GELU>::template forward<ISA_T>(cacheptr, cachestep, dptr, _param.ldd, cptr,
+                                                                         _param.ldc, M, N);
   }
 };
 
@@ -238,12 +220,9 @@ class FFNFusedInterface {
           int row_r = jblas::utils::remainsize(rowidx, _paral.mRows, rowsize);
           int col_r = jblas::utils::remainsize(colidx, _paral.mCols, colsize);
 
-          // TODO(Yu): replace the naive inplace eltwise mul
           for (int i = 0; i < row_r; i++) {
-            for (int j = 0; j < col_r; j++) {
-              _param.param1.C[(rowidx + i) * _param.param1.ldc + colidx + j] *=
-                  _param.param3.C[(rowidx + i) * _param.param3.ldc + colidx + j];
-            }
+            auto c1ptr = _param.param1.C + (rowidx + i) * _param.param1.ldc + colidx;
+            ne_vec_mul_f32(col_r, c1ptr, c1ptr, _param.param3.C + (rowidx + i) * _param.param3.ldc + colidx);
           }
         }
       }
@@ -272,6 +251,83 @@ class FFNFusedInterface {
   _SiluLauncher_T mActLauncher;
 };
 
+template <class _SiluLauncher_T, class _Launcher_T>
+class FpFFNFusedInterface {
+ public:
+  struct Arguments {
+    const int Seq, Fin, FMid, FOut;
+    const typename _SiluLauncher_T::AParam paramA;
+    const typename _SiluLauncher_T::BParam paramW1;
+    const typename _Launcher_T::BParam paramW2, paramW3;
+    const typename _SiluLauncher_T::EpiParam param1;
+    const typename _Launcher_T::EpiParam param2, param3;
+  };
+  using Config = typename _Launcher_T::ParallelConfig;
+  using ActConfig = typename _SiluLauncher_T::ParallelConfig;
+  using GemmCore = typename _Launcher_T::GemmCore;
+  using Parallel = jblas::utils::parallel::Parallel2DGemmKBlockFixed<GemmCore>;
+
+  JBLAS_CODE compute(const Arguments& _param) {
+    auto bptr = dynamic_cast<const prologue::weight_comp::PackedWeightKBlock*>(_param.paramW1.packedW);
+    if (bptr == nullptr) {
+      return JblasInvalidParam;
+    }
+    auto cb = utils::CpuBase();
+    Parallel _paral = Parallel();   // w1&w3 from Seq* Fin=>FMid
+    Parallel _paral2 = Parallel();  // w2 from Seq* FMid=>Fout
+    _paral.update(_param.Seq, _param.FMid, _param.Fin, bptr->mBlockSize, cb.mNumThreads);
+    _paral2.update(_param.Seq, _param.FOut, _param.FMid, bptr->mBlockSize, cb.mNumThreads);
+
+    omp_set_num_threads(cb.mNumThreads);
+#pragma omp parallel
+    {
+      int tidx = omp_get_thread_num();
+      {
+        int colidx, rowidx, rowsize, colsize;
+        _paral.getIndex(tidx, &rowidx, &colidx, &rowsize, &colsize);
+        if (rowsize > 0 && colsize > 0) {
+          ActConfig _actconfig{
+              rowidx, colidx, rowsize, colsize, _paral.getMStep(), _paral.getNStep(), _paral.getKStep(), cb.mL2Cache};
+          Config _config{rowidx,     colidx, rowsize, colsize, _paral.getMStep(), _paral.getNStep(), _paral.getKStep(),
+                         cb.mL2Cache};
+          mActLauncher.launch(
+              _actconfig, {_param.Seq, _param.FMid, _param.Fin, _param.paramA, _param.paramW1, _param.param1, NULL});
+          mLauncher.launch(_config, {_param.Seq, _param.FMid, _param.Fin, _param.paramA, _param.paramW3,
+                                     _param.param3, NULL});
+          int row_r = jblas::utils::remainsize(rowidx, _paral.mRows, rowsize);
+          int col_r = jblas::utils::remainsize(colidx, _paral.mCols, colsize);
+          for (int i = 0; i < row_r; i++) {
+            auto c1ptr = _param.param1.C + (rowidx + i) * _param.param1.ldc + colidx;
+            ne_vec_mul_f32(col_r, c1ptr, c1ptr, _param.param3.C + (rowidx + i) * _param.param3.ldc + colidx);
+          }
+        }
+      }
+#pragma omp barrier
+      {
+        int colidx, rowidx, rowsize, colsize;
+        _paral2.getIndex(tidx, &rowidx, &colidx, &rowsize, &colsize);
+        if (rowsize > 0 && colsize > 0) {
+          Config _config{
+              rowidx,     colidx, rowsize, colsize, _paral2.getMStep(), _paral2.getNStep(), _paral2.getKStep(),
+              cb.mL2Cache};
+          mLauncher.launch(_config, {_param.Seq,
+                                     _param.FOut,
+                                     _param.FMid,
+                                     {_param.param1.C, _param.param1.ldc},
+                                     _param.paramW2,
+                                     _param.param2,
+                                     NULL});
+        }
+      }
+    }
+    return JblasSuccess;
+  }
+
+ protected:
+  _Launcher_T mLauncher;
+  _SiluLauncher_T mActLauncher;
+};
+
 template <class _GeluLauncher_T, class _Launcher_T>
 class GeluFusedInterface {
  public:
@@ -481,7 +537,54 @@ using AddGeluGemmKernelS4KBlock = jblas::wrapper::gemm_pack_weight::GemmLauncher
 using AddGemmKernelS4KBlock = jblas::wrapper::gemm_pack_weight::GemmLauncherPackWeight<
     JblasAMX_BF16, jblas::gemm::GemmCore_Row_NN_16x64_AMX_BF16, jblas::prologue::gemm::ActivationConverterFp32,
     jblas::prologue::weight_comp::gemm::WeightS4_KBlock, custom::epilogue::Add<float>>;
+using GemmKernelF8KBlock = jblas::wrapper::gemm_pack_weight::GemmLauncherPackWeight<
+    JblasAMX_BF16, jblas::gemm::GemmCore_Row_NN_16x64_AMX_BF16, jblas::prologue::gemm::ActivationConverterFp32,
+    jblas::prologue::weight_comp::gemm::WeightF8_KBlock, jblas::epilogue::gemm::AccumulatorWriteBack<float, float>>;
+using SiluGemmKernelF8KBlock = jblas::wrapper::gemm_pack_weight::GemmLauncherPackWeight<
+    JblasAMX_BF16, jblas::gemm::GemmCore_Row_NN_16x64_AMX_BF16, jblas::prologue::gemm::ActivationConverterFp32,
+    jblas::prologue::weight_comp::gemm::WeightF8_KBlock, custom::epilogue::Silu<float>>;
+using GeluGemmKernelF8KBlock = jblas::wrapper::gemm_pack_weight::GemmLauncherPackWeight<
+    JblasAMX_BF16, jblas::gemm::GemmCore_Row_NN_16x64_AMX_BF16, jblas::prologue::gemm::ActivationConverterFp32,
+    jblas::prologue::weight_comp::gemm::WeightF8_KBlock, custom::epilogue::Gelu<float>>;
+using AddGeluGemmKernelF8KBlock = jblas::wrapper::gemm_pack_weight::GemmLauncherPackWeight<
+    JblasAMX_BF16, jblas::gemm::GemmCore_Row_NN_16x64_AMX_BF16, jblas::prologue::gemm::ActivationConverterFp32,
+    jblas::prologue::weight_comp::gemm::WeightF8_KBlock, custom::epilogue::Add_Gelu<float>>;
+using AddGemmKernelF8KBlock = jblas::wrapper::gemm_pack_weight::GemmLauncherPackWeight<
+    JblasAMX_BF16, jblas::gemm::GemmCore_Row_NN_16x64_AMX_BF16, jblas::prologue::gemm::ActivationConverterFp32,
+    jblas::prologue::weight_comp::gemm::WeightF8_KBlock, custom::epilogue::Add<float>>;
 }  // namespace amx_bf16
+namespace avx512f {
+using GemmKernelS4KBlock = jblas::wrapper::gemm_pack_weight::GemmLauncherPackWeight<
+    JblasAVX512F, jblas::gemm::GemmCore_Row_NN_8x48_AVX512F, jblas::prologue::gemm::ActivationBase,
+    jblas::prologue::weight_comp::gemm::WeightS4_KBlock, jblas::epilogue::gemm::AccumulatorWriteBack<float, float>>;
+using SiluGemmKernelS4KBlock = jblas::wrapper::gemm_pack_weight::GemmLauncherPackWeight<
+    JblasAVX512F, jblas::gemm::GemmCore_Row_NN_8x48_AVX512F, jblas::prologue::gemm::ActivationBase,
+    jblas::prologue::weight_comp::gemm::WeightS4_KBlock, custom::epilogue::Silu<float>>;
+using GeluGemmKernelS4KBlock = jblas::wrapper::gemm_pack_weight::GemmLauncherPackWeight<
+    JblasAVX512F, jblas::gemm::GemmCore_Row_NN_8x48_AVX512F, jblas::prologue::gemm::ActivationBase,
+    jblas::prologue::weight_comp::gemm::WeightS4_KBlock, custom::epilogue::Gelu<float>>;
+using AddGeluGemmKernelS4KBlock = jblas::wrapper::gemm_pack_weight::GemmLauncherPackWeight<
+    JblasAVX512F, jblas::gemm::GemmCore_Row_NN_8x48_AVX512F, jblas::prologue::gemm::ActivationBase,
+    jblas::prologue::weight_comp::gemm::WeightS4_KBlock, custom::epilogue::Add_Gelu<float>>;
+using AddGemmKernelS4KBlock = jblas::wrapper::gemm_pack_weight::GemmLauncherPackWeight<
+    JblasAVX512F, jblas::gemm::GemmCore_Row_NN_8x48_AVX512F, jblas::prologue::gemm::ActivationBase,
+    jblas::prologue::weight_comp::gemm::WeightS4_KBlock, custom::epilogue::Add<float>>;
+using GemmKernelF8KBlock = jblas::wrapper::gemm_pack_weight::GemmLauncherPackWeight<
+    JblasAVX512F, jblas::gemm::GemmCore_Row_NN_8x48_AVX512F, jblas::prologue::gemm::ActivationBase,
+    jblas::prologue::weight_comp::gemm::WeightF8_KBlock, jblas::epilogue::gemm::AccumulatorWriteBack<float, float>>;
+using SiluGemmKernelF8KBlock = jblas::wrapper::gemm_pack_weight::GemmLauncherPackWeight<
+    JblasAVX512F, jblas::gemm::GemmCore_Row_NN_8x48_AVX512F, jblas::prologue::gemm::ActivationBase,
+    jblas::prologue::weight_comp::gemm::WeightF8_KBlock, custom::epilogue::Silu<float>>;
+using GeluGemmKernelF8KBlock = jblas::wrapper::gemm_pack_weight::GemmLauncherPackWeight<
+    JblasAVX512F, jblas::gemm::GemmCore_Row_NN_8x48_AVX512F, jblas::prologue::gemm::ActivationBase,
+    jblas::prologue::weight_comp::gemm::WeightF8_KBlock, custom::epilogue::Gelu<float>>;
+using AddGeluGemmKernelF8KBlock = jblas::wrapper::gemm_pack_weight::GemmLauncherPackWeight<
+    JblasAVX512F, jblas::gemm::GemmCore_Row_NN_8x48_AVX512F, jblas::prologue::gemm::ActivationBase,
+    jblas::prologue::weight_comp::gemm::WeightF8_KBlock, custom::epilogue::Add_Gelu<float>>;
+using AddGemmKernelF8KBlock = jblas::wrapper::gemm_pack_weight::GemmLauncherPackWeight<
+    JblasAVX512F, jblas::gemm::GemmCore_Row_NN_8x48_AVX512F, jblas::prologue::gemm::ActivationBase,
+    jblas::prologue::weight_comp::gemm::WeightF8_KBlock, custom::epilogue::Add<float>>;
+}  // namespace avx512f
 }  // namespace kblock
 }  // namespace wrapper
 }  // namespace custom
@@ -528,36 +631,68 @@ void jblas_weightcomp_QKV_f32_forward(float* activation, void* wqptr, void* wkpt
       ret = kernel.compute2({_m, _n, _k, 3, activation, lda, wparams, oparams, NULL});
     }
   } else if (wqtmp->mCoreType == jblas::gemm::GemmCoreType::AMX_BF16_16x64) {
-    using GemmKernel = jblas::wrapper::transformer_default::weight_comp::amx_bf16::QKVGemm;
-    static GemmKernel kernel;
-    GemmKernel::WeightType::Param wparams[3]{
-        wqtmp,
-        wktmp,
-        wvtmp,
-    };
-    GemmKernel::CParam oparams[3]{
-        {output, ldo},
-        {output + _m * _n, ldo},
-        {output + 2 * _m * _n, ldo},
-    };
     if (_cd->AMX_BF16()) {
-      ret = kernel.compute({_m, _n, _k, 3, activation, lda, wparams, oparams, NULL});
+      if (jblas_is_f8_weight(wqtmp)) {
+        using GemmKernel = jblas::wrapper::transformer_default::weight_comp::amx_bf16::QKVGemmF8;
+        static GemmKernel kernel;
+        GemmKernel::WeightType::Param wparams[3]{
+            wqtmp,
+            wktmp,
+            wvtmp,
+        };
+        GemmKernel::CParam oparams[3]{
+            {output, ldo},
+            {output + _m * _n, ldo},
+            {output + 2 * _m * _n, ldo},
+        };
+        ret = kernel.compute({_m, _n, _k, 3, activation, lda, wparams, oparams, NULL});
+      } else {
+        using GemmKernel = jblas::wrapper::transformer_default::weight_comp::amx_bf16::QKVGemm;
+        static GemmKernel kernel;
+        GemmKernel::WeightType::Param wparams[3]{
+            wqtmp,
+            wktmp,
+            wvtmp,
+        };
+        GemmKernel::CParam oparams[3]{
+            {output, ldo},
+            {output + _m * _n, ldo},
+            {output + 2 * _m * _n, ldo},
+        };
+        ret = kernel.compute({_m, _n, _k, 3, activation, lda, wparams, oparams, NULL});
+      }
     }
   } else if (wqtmp->mCoreType == jblas::gemm::GemmCoreType::AVX512F_8X48) {
-    using GemmKernel = jblas::wrapper::transformer_default::weight_comp::avx512_f::QKVGemm;
-    static GemmKernel kernel;
-    GemmKernel::WeightType::Param wparams[3]{
-        wqtmp,
-        wktmp,
-        wvtmp,
-    };
-    GemmKernel::CParam oparams[3]{
-        {output, ldo},
-        {output + _m * _n, ldo},
-        {output + 2 * _m * _n, ldo},
-    };
     if (_cd->AVX512F()) {
-      ret = kernel.compute({_m, _n, _k, 3, activation, lda, wparams, oparams, NULL});
+      if (jblas_is_f8_weight(wqtmp)) {
+        using GemmKernel = jblas::wrapper::transformer_default::weight_comp::avx512_f::QKVGemmF8;
+        static GemmKernel kernel;
+        GemmKernel::WeightType::Param wparams[3]{
+            wqtmp,
+            wktmp,
+            wvtmp,
+        };
+        GemmKernel::CParam oparams[3]{
+            {output, ldo},
+            {output + _m * _n, ldo},
+            {output + 2 * _m * _n, ldo},
+        };
+        ret = kernel.compute({_m, _n, _k, 3, activation, lda, wparams, oparams, NULL});
+      } else {
+        using GemmKernel = jblas::wrapper::transformer_default::weight_comp::avx512_f::QKVGemm;
+        static GemmKernel kernel;
+        GemmKernel::WeightType::Param wparams[3]{
+            wqtmp,
+            wktmp,
+            wvtmp,
+        };
+        GemmKernel::CParam oparams[3]{
+            {output, ldo},
+            {output + _m * _n, ldo},
+            {output + 2 * _m * _n, ldo},
+        };
+        ret = kernel.compute({_m, _n, _k, 3, activation, lda, wparams, oparams, NULL});
+      }
     }
   }
   assert(ret == JblasSuccess);
@@ -589,11 +724,32 @@ void jblas_weights4block_add_f32_forward(float* activation, void* weiptr, float*
       ret = kernel.compute({_m, _n, _k, activation, lda, wtmp, output, bias, ldo, boardcast_bias ? 0 : ldo});
     }
   } else if (wtmp->mCoreType == jblas::gemm::GemmCoreType::AMX_BF16_16x64) {
-    using GemmKernel = jblas::wrapper::gemm_pack_weight::GemmInterfacePackWeight<
-        custom::wrapper::kblock::amx_bf16::AddGemmKernelS4KBlock, jblas::wrapper::gemm_default::DefaultParallel>;
-    static GemmKernel kernel;
     if (_cd->AMX_BF16()) {
-      ret = kernel.compute({_m, _n, _k, activation, lda, wtmp, output, bias, ldo, boardcast_bias ? 0 : ldo});
+      if (jblas_is_f8_weight(wtmp)) {
+        using GemmKernel = jblas::wrapper::gemm_pack_weight::GemmInterfacePackWeight<
+            custom::wrapper::kblock::amx_bf16::AddGemmKernelF8KBlock, jblas::wrapper::gemm_default::DefaultParallel>;
+        static GemmKernel kernel;
+        ret = kernel.compute({_m, _n, _k, activation, lda, wtmp, output, bias, ldo, boardcast_bias ? 0 : ldo});
+      } else {
+        using GemmKernel = jblas::wrapper::gemm_pack_weight::GemmInterfacePackWeight<
+            custom::wrapper::kblock::amx_bf16::AddGemmKernelS4KBlock, jblas::wrapper::gemm_default::DefaultParallel>;
+        static GemmKernel kernel;
+        ret = kernel.compute({_m, _n, _k, activation, lda, wtmp, output, bias, ldo, boardcast_bias ? 0 : ldo});
+      }
+    }
+  } else if (wtmp->mCoreType == jblas::gemm::GemmCoreType::AVX512F_8X48) {
+    if (_cd->AVX512F()) {
+      if (jblas_is_f8_weight(wtmp)) {
+        using GemmKernel = jblas::wrapper::gemm_pack_weight::GemmInterfacePackWeight<
+            custom::wrapper::kblock::avx512f::AddGemmKernelF8KBlock, jblas::wrapper::gemm_default::DefaultParallel>;
+        static GemmKernel kernel;
+        ret = kernel.compute({_m, _n, _k, activation, lda, wtmp, output, bias, ldo, boardcast_bias ? 0 : ldo});
+      } else {
+        using GemmKernel = jblas::wrapper::gemm_pack_weight::GemmInterfacePackWeight<
+            custom::wrapper::kblock::avx512f::AddGemmKernelS4KBlock, jblas::wrapper::gemm_default::DefaultParallel>;
+        static GemmKernel kernel;
+        ret = kernel.compute({_m, _n, _k, activation, lda, wtmp, output, bias, ldo, boardcast_bias ? 0 : ldo});
+      }
     }
   }
   assert(ret == JblasSuccess);
@@ -602,22 +758,72 @@ void jblas_weights4block_add_f32_forward(float* activation, void* weiptr, float*
 
 void jblas_weightcomp_FFN_SiLu_f32_forward(float* activation, void* w1ptr, void* w2ptr, void* w3ptr, float* tmp1,
                                            float* tmp2, float* output, int seq, int fin, int fmid, int fout) {
+  GetCPUDevice();
+  auto ret = JblasRuntimeError;
   auto w1tmp = prologue::weight_comp::gemm::CompressedPackedWeight::deserialBuffer(w1ptr, 0);
   auto w2tmp = prologue::weight_comp::gemm::CompressedPackedWeight::deserialBuffer(w2ptr, 0);
   auto w3tmp = prologue::weight_comp::gemm::CompressedPackedWeight::deserialBuffer(w3ptr, 0);
-  if (w1tmp->mCoreType == jblas::gemm::GemmCoreType::AVX512_VNNI_3X48_KBLOCK ||
+  int lda = fin;
+  int ldtmp1 = fmid;
+  int ldtmp2 = fmid;
+  int ldo = fout;
+  if (w1tmp->mCoreType == jblas::gemm::GemmCoreType::AMX_INT8_16X48_KBLOCK ||
+      w1tmp->mCoreType == jblas::gemm::GemmCoreType::AVX512_VNNI_3X48_KBLOCK ||
       w1tmp->mCoreType == jblas::gemm::GemmCoreType::AVX512_VNNI_8X48) {
-    using GemmKernel = custom::wrapper::kblock::avx512_vnni::GemmSKernelDynamicS4KBlock;
-    using SiluGemmKernel = custom::wrapper::kblock::avx512_vnni::SiluGemmSKernelDynamicS4KBlock;
-    using FusedInter = custom::wrapper::transformer::FFNFusedInterface<SiluGemmKernel, GemmKernel>;
-    static FusedInter finter;
-    int lda = fin;
-    int ldtmp1 = fmid;
-    int ldtmp2 = fmid;
-    int ldo = fout;
-    finter.compute(
-        {seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, w3tmp, tmp1, ldtmp1, output, ldo, tmp2, ldtmp2});
+    auto wbtmp = dynamic_cast<prologue::weight_comp::PackedWeightKBlock*>(w1tmp);
+    if (_cd->AMX_INT8() && wbtmp->mBlockSize % 128 == 0) {
+      using GemmKernel = custom::wrapper::kblock::amx_int8::GemmSKernelDynamicS4KBlock;
+      using SiluGemmKernel = custom::wrapper::kblock::amx_int8::SiluGemmSKernelDynamicS4KBlock;
+      using FusedInter = custom::wrapper::transformer::FFNFusedInterface<SiluGemmKernel, GemmKernel>;
+      static FusedInter finter;
+      ret = finter.compute(
+          {seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, w3tmp, tmp1, ldtmp1, output, ldo, tmp2, ldtmp2});
+    } else if (_cd->AVX512_VNNI()) {
+      using GemmKernel = custom::wrapper::kblock::avx512_vnni::GemmSKernelDynamicS4KBlock;
+      using SiluGemmKernel = custom::wrapper::kblock::avx512_vnni::SiluGemmSKernelDynamicS4KBlock;
+      using FusedInter = custom::wrapper::transformer::FFNFusedInterface<SiluGemmKernel, GemmKernel>;
+      static FusedInter finter;
+      ret = finter.compute(
+          {seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, w3tmp, tmp1, ldtmp1, output, ldo, tmp2, ldtmp2});
+    }
+  } else if (w1tmp->mCoreType == jblas::gemm::GemmCoreType::AMX_BF16_16x64) {
+    if (_cd->AMX_BF16()) {
+      if (jblas_is_f8_weight(w1tmp)) {
+        using GemmKernel = custom::wrapper::kblock::amx_bf16::GemmKernelF8KBlock;
+        using SiluGemmKernel = custom::wrapper::kblock::amx_bf16::SiluGemmKernelF8KBlock;
+        using FusedInter = custom::wrapper::transformer::FpFFNFusedInterface<SiluGemmKernel, GemmKernel>;
+        static FusedInter finter;
+        ret = finter.compute(
+            {seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, w3tmp, tmp1, ldtmp1, output, ldo, tmp2, ldtmp2});
+      } else {
+        using GemmKernel = custom::wrapper::kblock::amx_bf16::GemmKernelS4KBlock;
+        using SiluGemmKernel = custom::wrapper::kblock::amx_bf16::SiluGemmKernelS4KBlock;
+        using FusedInter = custom::wrapper::transformer::FpFFNFusedInterface<SiluGemmKernel, GemmKernel>;
+        static FusedInter finter;
+        ret = finter.compute(
+            {seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, w3tmp, tmp1, ldtmp1, output, ldo, tmp2, ldtmp2});
+      }
+    }
+  } else if (w1tmp->mCoreType == jblas::gemm::GemmCoreType::AVX512F_8X48) {
+    if (_cd->AVX512F()) {
+      if (jblas_is_f8_weight(w1tmp)) {
+        using GemmKernel = custom::wrapper::kblock::avx512f::GemmKernelF8KBlock;
+        using SiluGemmKernel = custom::wrapper::kblock::avx512f::SiluGemmKernelF8KBlock;
+        using FusedInter = custom::wrapper::transformer::FpFFNFusedInterface<SiluGemmKernel, GemmKernel>;
+        static FusedInter finter;
+        ret = finter.compute(
+            {seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, w3tmp, tmp1, ldtmp1, output, ldo, tmp2, ldtmp2});
+      } else {
+        using GemmKernel = custom::wrapper::kblock::avx512f::GemmKernelS4KBlock;
+        using SiluGemmKernel = custom::wrapper::kblock::avx512f::SiluGemmKernelS4KBlock;
+        using FusedInter = custom::wrapper::transformer::FpFFNFusedInterface<SiluGemmKernel, GemmKernel>;
+        static FusedInter finter;
+        ret = finter.compute(
+            {seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, w3tmp, tmp1, ldtmp1, output, ldo, tmp2, ldtmp2});
+      }
+    }
   }
+  assert(ret == JblasSuccess);
   delete w1tmp;
   delete w2tmp;
   delete w3tmp;
@@ -625,19 +831,64 @@ void jblas_weightcomp_FFN_SiLu_f32_forward(float* activation, void* w1ptr, void*
 
 void jblas_weightcomp_FFN_GeLu_f32_forward(float* activation, void* w1ptr, void* w2ptr, float* tmp1, float* output,
                                            int seq, int fin, int fmid, int fout) {
+  GetCPUDevice();
+  auto ret = JblasRuntimeError;
   auto w1tmp = prologue::weight_comp::gemm::CompressedPackedWeight::deserialBuffer(w1ptr, 0);
   auto w2tmp = prologue::weight_comp::gemm::CompressedPackedWeight::deserialBuffer(w2ptr, 0);
-  if (w1tmp->mCoreType == jblas::gemm::GemmCoreType::AVX512_VNNI_8X48 ||
+  int lda = fin;
+  int ldtmp1 = fmid;
+  int ldo = fout;
+  if (w1tmp->mCoreType == jblas::gemm::GemmCoreType::AMX_INT8_16X48_KBLOCK ||
+      w1tmp->mCoreType == jblas::gemm::GemmCoreType::AVX512_VNNI_8X48 ||
       w1tmp->mCoreType == jblas::gemm::GemmCoreType::AVX512_VNNI_3X48_KBLOCK) {
-    using GemmKernel = custom::wrapper::kblock::avx512_vnni::GemmSKernelDynamicS4KBlock;
-    using GeluGemmKernel = custom::wrapper::kblock::avx512_vnni::GeluGemmSKernelDynamicS4KBlock;
-    using FusedInter = custom::wrapper::transformer::GeluFusedInterface<GeluGemmKernel, GemmKernel>;
-    static FusedInter finter;
-    int lda = fin;
-    int ldtmp1 = fmid;
-    int ldo = fout;
-    finter.compute({seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, tmp1, ldtmp1, output, ldo});
+    auto wbtmp = dynamic_cast<prologue::weight_comp::PackedWeightKBlock*>(w1tmp);
+    if (_cd->AMX_INT8() && wbtmp->mBlockSize % 128 == 0) {
+      using GemmKernel = custom::wrapper::kblock::amx_int8::GemmSKernelDynamicS4KBlock;
+      using GeluGemmKernel = custom::wrapper::kblock::amx_int8::GeluGemmSKernelDynamicS4KBlock;
+      using FusedInter = custom::wrapper::transformer::GeluFusedInterface<GeluGemmKernel, GemmKernel>;
+      static FusedInter finter;
+      ret = finter.compute({seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, tmp1, ldtmp1, output, ldo});
+    } else if (_cd->AVX512_VNNI()) {
+      using GemmKernel = custom::wrapper::kblock::avx512_vnni::GemmSKernelDynamicS4KBlock;
+      using GeluGemmKernel = custom::wrapper::kblock::avx512_vnni::GeluGemmSKernelDynamicS4KBlock;
+      using FusedInter = custom::wrapper::transformer::GeluFusedInterface<GeluGemmKernel, GemmKernel>;
+      static FusedInter finter;
+      ret = finter.compute({seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, tmp1, ldtmp1, output, ldo});
+    }
+  } else if (w1tmp->mCoreType == jblas::gemm::GemmCoreType::AMX_BF16_16x64) {
+    if (_cd->AMX_BF16()) {
+      if (jblas_is_f8_weight(w1tmp)) {
+        using GemmKernel = custom::wrapper::kblock::amx_bf16::GemmKernelF8KBlock;
+        using GeluGemmKernel = custom::wrapper::kblock::amx_bf16::GeluGemmKernelF8KBlock;
+        using FusedInter = custom::wrapper::transformer::FpGeluFusedInterface<GeluGemmKernel, GemmKernel>;
+        static FusedInter finter;
+        ret = finter.compute({seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, tmp1, ldtmp1, output, ldo});
+      } else {
+        using GemmKernel = custom::wrapper::kblock::amx_bf16::GemmKernelS4KBlock;
+        using GeluGemmKernel = custom::wrapper::kblock::amx_bf16::GeluGemmKernelS4KBlock;
+        using FusedInter = custom::wrapper::transformer::FpGeluFusedInterface<GeluGemmKernel, GemmKernel>;
+        static FusedInter finter;
+        ret = finter.compute({seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, tmp1, ldtmp1, output, ldo});
+      }
+    }
+  } else if (w1tmp->mCoreType == jblas::gemm::GemmCoreType::AVX512F_8X48) {
+    if (_cd->AVX512F()) {
+      if (jblas_is_f8_weight(w1tmp)) {
+        using GemmKernel = custom::wrapper::kblock::avx512f::GemmKernelF8KBlock;
+        using GeluGemmKernel = custom::wrapper::kblock::avx512f::GeluGemmKernelF8KBlock;
+        using FusedInter = custom::wrapper::transformer::FpGeluFusedInterface<GeluGemmKernel, GemmKernel>;
+        static FusedInter finter;
+        ret = finter.compute({seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, tmp1, ldtmp1, output, ldo});
+      } else {
+        using GemmKernel = custom::wrapper::kblock::avx512f::GemmKernelS4KBlock;
+        using GeluGemmKernel = custom::wrapper::kblock::avx512f::GeluGemmKernelS4KBlock;
+        using FusedInter = custom::wrapper::transformer::FpGeluFusedInterface<GeluGemmKernel, GemmKernel>;
+        static FusedInter finter;
+        ret = finter.compute({seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, tmp1, ldtmp1, output, ldo});
+      }
+    }
   }
+  assert(ret == JblasSuccess);
   delete w1tmp;
   delete w2tmp;
 }
@@ -649,7 +900,11 @@ void jblas_weightcomp_FFN_Add_GeLu_f32_forward(float* activation, void* w1ptr, v
   auto ret = JblasRuntimeError;
   auto w1tmp = prologue::weight_comp::gemm::CompressedPackedWeight::deserialBuffer(w1ptr, 0);
   auto w2tmp = prologue::weight_comp::gemm::CompressedPackedWeight::deserialBuffer(w2ptr, 0);
-  if (w1tmp->mCoreType == jblas::gemm::GemmCoreType::AVX512_VNNI_8X48 ||
+  int lda = fin;
+  int ldtmp1 = fmid;
+  int ldo = fout;
+  if (w1tmp->mCoreType == jblas::gemm::GemmCoreType::AMX_INT8_16X48_KBLOCK ||
+      w1tmp->mCoreType == jblas::gemm::GemmCoreType::AVX512_VNNI_8X48 ||
       w1tmp->mCoreType == jblas::gemm::GemmCoreType::AVX512_VNNI_3X48_KBLOCK) {
     auto wbtmp = dynamic_cast<prologue::weight_comp::PackedWeightKBlock*>(w1tmp);
     if (_cd->AMX_INT8() && wbtmp->mBlockSize % 128 == 0) {
@@ -657,13 +912,6 @@ void jblas_weightcomp_FFN_Add_GeLu_f32_forward(float* activation, void* w1ptr, v
       using GeluGemmKernel = custom::wrapper::kblock::amx_int8::AddGeluGemmSKernelDynamicS4KBlock;
       using FusedInter = custom::wrapper::transformer::GeluFusedInterface<GeluGemmKernel, GemmKernel>;
       static FusedInter finter;
-      int lda = fin;
-      int ldtmp1 = fmid;
-      int ldo = fout;
-      // FusedInter::Arguments::paramA paramA={activation, lda};
-      // FusedInter::Arguments::paramW1 paramW1={w1tmp};
-      // FusedInter::Arguments::paramW2 paramW2={w2tmp};
-      // FusedInter::Arguments::param1 param1={tmp1, b1ptr, ldtmp1, ldtmp1};
       ret = finter.compute({seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, tmp1, b1ptr, ldtmp1,
                             boardcast_bias ? 0 : ldtmp1, output, b2ptr, ldo, boardcast_bias ? 0 : ldo});
     } else if (_cd->AVX512_VNNI()) {
@@ -671,33 +919,44 @@ void jblas_weightcomp_FFN_Add_GeLu_f32_forward(float* activation, void* w1ptr, v
       using GeluGemmKernel = custom::wrapper::kblock::avx512_vnni::AddGeluGemmSKernelDynamicS4KBlock;
       using FusedInter = custom::wrapper::transformer::GeluFusedInterface<GeluGemmKernel, GemmKernel>;
       static FusedInter finter;
-      int lda = fin;
-      int ldtmp1 = fmid;
-      int ldo = fout;
-      // FusedInter::Arguments::paramA paramA={activation, lda};
-      // FusedInter::Arguments::paramW1 paramW1={w1tmp};
-      // FusedInter::Arguments::paramW2 paramW2={w2tmp};
-      // FusedInter::Arguments::param1 param1={tmp1, b1ptr, ldtmp1, ldtmp1};
       ret = finter.compute({seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, tmp1, b1ptr, ldtmp1,
                             boardcast_bias ? 0 : ldtmp1, output, b2ptr, ldo, boardcast_bias ? 0 : ldo});
     }
   } else if (w1tmp->mCoreType == jblas::gemm::GemmCoreType::AMX_BF16_16x64) {
     if (_cd->AMX_BF16()) {
-      using GemmKernel = custom::wrapper::kblock::amx_bf16::AddGemmKernelS4KBlock;
-      using GeluGemmKernel = custom::wrapper::kblock::amx_bf16::AddGeluGemmKernelS4KBlock;
-      using FusedInter = custom::wrapper::transformer::FpGeluFusedInterface<GeluGemmKernel, GemmKernel>;
-      static FusedInter finter;
-      int lda = fin;
-      int ldtmp1 = fmid;
-      int ldo = fout;
-      // FusedInter::Arguments::paramA paramA={activation, lda};
-      // FusedInter::Arguments::paramW1 paramW1={w1tmp};
-      // FusedInter::Arguments::paramW2 paramW2={w2tmp};
-      // FusedInter::Arguments::param1 param1={tmp1, b1ptr, ldtmp1, ldtmp1};
-      ret = finter.compute({seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, tmp1, b1ptr, ldtmp1,
-                            boardcast_bias ? 0 : ldtmp1, output, b2ptr, ldo, boardcast_bias ? 0 : ldo});
-    } else {
-      assert(false);
+      if (jblas_is_f8_weight(w1tmp)) {
+        using GemmKernel = custom::wrapper::kblock::amx_bf16::AddGemmKernelF8KBlock;
+        using GeluGemmKernel = custom::wrapper::kblock::amx_bf16::AddGeluGemmKernelF8KBlock;
+        using FusedInter = custom::wrapper::transformer::FpGeluFusedInterface<GeluGemmKernel, GemmKernel>;
+        static FusedInter finter;
+        ret = finter.compute({seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, tmp1, b1ptr, ldtmp1,
+                              boardcast_bias ? 0 : ldtmp1, output, b2ptr, ldo, boardcast_bias ? 0 : ldo});
+      } else {
+        using GemmKernel = custom::wrapper::kblock::amx_bf16::AddGemmKernelS4KBlock;
+        using GeluGemmKernel = custom::wrapper::kblock::amx_bf16::AddGeluGemmKernelS4KBlock;
+        using FusedInter = custom::wrapper::transformer::FpGeluFusedInterface<GeluGemmKernel, GemmKernel>;
+        static FusedInter finter;
+        ret = finter.compute({seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, tmp1, b1ptr, ldtmp1,
+                              boardcast_bias ? 0 : ldtmp1, output, b2ptr, ldo, boardcast_bias ? 0 : ldo});
+      }
+    }
+  } else if (w1tmp->mCoreType == jblas::gemm::GemmCoreType::AVX512F_8X48) {
+    if (_cd->AVX512F()) {
+      if (jblas_is_f8_weight(w1tmp)) {
+        using GemmKernel = custom::wrapper::kblock::avx512f::AddGemmKernelF8KBlock;
+        using GeluGemmKernel = custom::wrapper::kblock::avx512f::AddGeluGemmKernelF8KBlock;
+        using FusedInter = custom::wrapper::transformer::FpGeluFusedInterface<GeluGemmKernel, GemmKernel>;
+        static FusedInter finter;
+        ret = finter.compute({seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, tmp1, b1ptr, ldtmp1,
+                              boardcast_bias ? 0 : ldtmp1, output, b2ptr, ldo, boardcast_bias ? 0 : ldo});
+      } else {
+        using GemmKernel = custom::wrapper::kblock::avx512f::AddGemmKernelS4KBlock;
+        using GeluGemmKernel = custom::wrapper::kblock::avx512f::AddGeluGemmKernelS4KBlock;
+        using FusedInter = custom::wrapper::transformer::FpGeluFusedInterface<GeluGemmKernel, GemmKernel>;
+        static FusedInter finter;
+        ret = finter.compute({seq, fin, fmid, fout, activation, lda, w1tmp, w2tmp, tmp1, b1ptr, ldtmp1,
+                              boardcast_bias ? 0 : ldtmp1, output, b2ptr, ldo, boardcast_bias ? 0 : ldo});
+      }
     }
   }
   assert(ret == JblasSuccess);
@@ -713,7 +972,272 @@ void jblas_timer(bool _init) {
     printf("time :%f us\n", tr.stop());
 }
 
+static int jblas_numa_nodes = 1;
+static int jblas_numa_pinned_threads = 0;
+
+// the thread group of node is [jblas_numa_group(node, nth), jblas_numa_group(node + 1, nth))
+static inline int jblas_numa_group(int node, int nth) { return nth * node / jblas_numa_nodes; }
+
 int jblas_set_threads(int _nth) {
-  jblas::utils::parallel::CpuDevice::getInstance()->setThreads(_nth);
-  return jblas::utils::parallel::CpuDevice::getInstance()->getThreads();
+  auto cd = jblas::utils::parallel::CpuDevice::getInstance();
+  cd->setThreads(_nth);
+  int nth = cd->getThreads();
+  if (jblas_numa_nodes > 1 && nth != jblas_numa_pinned_threads) {
+    // the OpenMP runtime keeps handing the same team index to the same pool thread, so pinning once is enough
+#pragma omp parallel num_threads(nth)
+    {
+      int tidx = omp_get_thread_num();
+      int node = jblas_numa_nodes - 1;
+      while (node > 0 && tidx < jblas_numa_group(node, nth)) node--;
+      ne_numa_bind_thread(node);
+    }
+    jblas_numa_pinned_threads = nth;
+  }
+  return nth;
+}
+
+int jblas_set_numa_nodes(int n_nodes) {
+  int avail = ne_numa_num_nodes();
+  jblas_numa_nodes = n_nodes <= 0 ? avail : std::min(n_nodes, avail);
+  jblas_numa_pinned_threads = 0;
+  return jblas_numa_nodes;
 }
+
+template <class _Weight_T>
+static bool jblas_weight_data(prologue::PackedWeight* ptr, int8_t** data, size_t* size) {
+  auto wptr = dynamic_cast<_Weight_T*>(ptr);
+  if (wptr == nullptr) {
+    return false;
+  }
+  *data = reinterpret_cast<int8_t*>(wptr->mWPtr);
+  *size = wptr->mWSize * sizeof(wptr->mWPtr[0]);
+  return true;
+}
+
+int jblas_weights_numa_distribute(void* weiptr, size_t page_size) {
+  if (jblas_numa_nodes <= 1) {
+    return 0;
+  }
+  auto wtmp = prologue::weight_comp::gemm::CompressedPackedWeight::deserialBuffer(weiptr, 0);
+  if (wtmp == nullptr) {
+    return 0;
+  }
+  // the packed data is N/NTILE panels of KPad x NTILE one after the other, so a column range of the weight is a byte
+  // range of it. The scales are stored by row of N and stay where they are, they are a small part of the traffic.
+  int8_t* data = nullptr;
+  size_t size = 0;
+  int n_moved = 0;
+  if (jblas_weight_data<prologue::weight_comp::gemm::PackedWeightS4F32>(wtmp, &data, &size) ||
+      jblas_weight_data<prologue::weight_comp::gemm::PackedWeightS4Bf16>(wtmp, &data, &size) ||
+      jblas_weight_data<prologue::weight_comp::gemm::PackedWeightS8F32>(wtmp, &data, &size) ||
+      jblas_weight_data<prologue::weight_comp::gemm::PackedWeightF8F32>(wtmp, &data, &size)) {
+    // the shard bounds go to the nearest huge page boundary, the huge pages at both ends that the weight shares with
+    // its neighbours stay where they are. ne_numa_bind_memory rounds to normal pages itself.
+    const uintptr_t page = page_size == 0 ? 1 : page_size;
+    const uintptr_t first = reinterpret_cast<uintptr_t>(data);
+    auto bound = [&](int node) {
+      if (node == 0) return (first + page - 1) / page * page;
+      if (node == jblas_numa_nodes) return (first + size) / page * page;
+      return (first + size * node / jblas_numa_nodes + page / 2) / page * page;
+    };
+    for (int node = 0; node < jblas_numa_nodes; node++) {
+      uintptr_t begin = bound(node);
+      uintptr_t end = std::max(begin, bound(node + 1));
+      if (end > begin && ne_numa_bind_memory(reinterpret_cast<void*>(begin), end - begin, node)) {
+        n_moved++;
+      }
+    }
+  }
+  delete wtmp;
+  return n_moved;
+}
+
+#ifdef NE_TESTS
+#include <cmath>
+#include <memory>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "layers/ne_test_layers_utils.hpp"
+
+namespace {
+bool return_success = true;
+
+class TestFp8Weight {
+ public:
+  TestFp8Weight() {
+    printf("Test suit: %s\n", __FUNCTION__);
+    return_success &= test_codes<utils::fp8_e4m3>("e4m3", 0x7e, 448.f, 0x1p-9f);
+    return_success &= test_codes<utils::fp8_e5m2>("e5m2", 0x7b, 57344.f, 0x1p-16f);
+    return_success &= test_round_trip<utils::fp8_e4m3>("e4m3");
+    return_success &= test_round_trip<utils::fp8_e5m2>("e5m2");
+    GetCPUDevice();
+    if (_cd->AVX512F()) {
+      return_success &= test_decompress<utils::fp8_e4m3>({64, 48, 32, 0});
+      return_success &= test_decompress<utils::fp8_e5m2>({64, 48, 32, 0});
+      return_success &= test_decompress<utils::fp8_e4m3>({256, 96, 128, 64});
+      return_success &= test_decompress<utils::fp8_e5m2>({256, 96, 128, 64});
+      using AVX512FKernel = jblas::wrapper::gemm_default::weight_comp::avx512f::GemmKernelF8KBlock;
+      return_success &= test_gemm<AVX512FKernel>({1, 48, 128, 32}, WeightCompType::F8E4M3_F32);
+      return_success &= test_gemm<AVX512FKernel>({8, 96, 256, 64}, WeightCompType::F8E5M2_F32);
+      return_success &= test_gemm<AVX512FKernel>({33, 144, 512, 128}, WeightCompType::F8E4M3_F32);
+      return_success &= test_gemm<AVX512FKernel>({5, 100, 256, 128}, WeightCompType::F8E5M2_F32);
+    }
+    if (_cd->AMX_BF16()) {
+      jblas::utils::request_perm_xtile_data();
+      using AMXBF16Kernel = jblas::wrapper::gemm_default::weight_comp::amx_bf16::GemmKernelF8KBlock;
+      return_success &= test_gemm<AMXBF16Kernel>({1, 64, 128, 32}, WeightCompType::F8E4M3_F32);
+      return_success &= test_gemm<AMXBF16Kernel>({33, 128, 512, 128}, WeightCompType::F8E5M2_F32);
+    }
+    printf("Test suit done: %s\n", __FUNCTION__);
+  }
+
+ private:
+  using WeightCompType = prologue::weight_comp::gemm::WeightCompType;
+  struct decompress_shape_t {
+    int K, N, blocksize, k_offset;
+  };
+  struct gemm_shape_t {
+    int M, N, K, blocksize;
+  };
+
+  // every finite code decodes to the value of its format and encodes back to itself
+  template <typename F8_T>
+  bool test_codes(const char* name, uint8_t max_code, float max, float min_subnormal) {
+    printf("Test case : %s codes\n", name);
+    bool ok = F8_T::max() == max && F8_T::decode(1) == min_subnormal && F8_T::decode(0x81) == -min_subnormal;
+    for (int c = 0; c < 256; c++) {
+      if ((c & 0x7f) > max_code) continue;  // NaN / inf codes
+      ok &= F8_T::encode(F8_T::decode(c)) == c;
+    }
+    // saturation at the max finite value instead of inf / NaN
+    ok &= F8_T::encode(max * 1.5f) == max_code;
+    ok &= F8_T::encode(1e30f) == max_code;
+    ok &= F8_T::encode(-1e30f) == (0x80 | max_code);
+    ok &= F8_T::encode(INFINITY) == max_code;
+    // subnormals round to nearest even: half of the smallest one flushes to 0, one and a half rounds up to 2
+    ok &= F8_T::encode(min_subnormal * 0.5f) == 0;
+    ok &= F8_T::encode(min_subnormal * 0.75f) == 1;
+    ok &= F8_T::encode(min_subnormal * 1.5f) == 2;
+    ok &= F8_T::encode(-min_subnormal * 2.5f) == 0x82;
+    if (!ok) printf("%s codes mismatch\n", name);
+    return ok;
+  }
+
+  // random values over the whole range, subnormals included, come back within half a step of the format
+  template <typename F8_T>
+  bool test_round_trip(const char* name) {
+    printf("Test case : %s round trip\n", name);
+    constexpr int MBits = 23 - F8_T::Shift;
+    const float min_subnormal = F8_T::decode(1);
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> mantissa(-1.f, 1.f);
+    std::uniform_int_distribution<int> exponent(std::ilogb(min_subnormal) - 2, std::ilogb(F8_T::max()));
+    for (int i = 0; i < 100000; i++) {
+      float v = std::min(std::ldexp(mantissa(rng), exponent(rng)), F8_T::max());
+      v = std::max(v, -F8_T::max());
+      float r = F8_T::decode(F8_T::encode(v));
+      float step = v == 0.f ? min_subnormal : std::max(std::ldexp(1.f, std::ilogb(v) - MBits), min_subnormal);
+      if (std::abs(r - v) > step / 2 || std::signbit(r) != std::signbit(v)) {
+        printf("%s round trip: %g -> %g\n", name, v, r);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // the AVX512F decode matches the reference, for the fp32 and the bf16 (row pack 2) destination
+  template <typename F8_T>
+  bool test_decompress(const decompress_shape_t& s) {
+    printf("Test case : %s decompress K_%d N_%d blocksize_%d k_offset_%d\n",
+           std::is_same<F8_T, utils::fp8_e4m3>::value ? "e4m3" : "e5m2", s.K, s.N, s.blocksize, s.k_offset);
+    std::vector<float> src(s.K * s.N);
+    std::vector<uint8_t> codes(s.K * s.N);
+    std::vector<float> scales(s.K / s.blocksize * s.N);
+    init_vector(&src, -2.f, 2.f);
+    kernel::wrapper::QuantizeF8RowBlock<F8_T>::template forward<JblasAVX512F>(
+        src.data(), codes.data(), s.K, s.N, s.N, s.N, scales.data(), s.blocksize);
+
+    const int row = s.K - s.k_offset;
+    uint8_t* srcptr = codes.data() + s.k_offset * s.N;
+    std::vector<float> dst(row * s.N), ref(row * s.N);
+    kernel::wrapper::DecompressKBlockF8FP<float>::template forward<JblasAVX512F, F8_T>(
+        srcptr, dst.data(), row, s.N, s.N, s.N, scales.data(), s.k_offset, s.blocksize, s.N);
+    kernel::ref::decompress_kblock_f8_fp<F8_T>(srcptr, ref.data(), row, s.N, s.N, s.N, scales.data(), s.k_offset,
+                                               s.blocksize, s.N);
+    bool ok = compare_data(dst.data(), ref.data(), dst.size(), 0.f);
+
+    // bf16: K/2 rows of interleaved column pairs, each pair shares the scale of its column
+    std::vector<utils::bf16> dst_bf16(row * s.N), ref_bf16(row * s.N);
+    kernel::wrapper::DecompressKBlockF8FP<utils::bf16>::template forward<JblasAVX512F, F8_T>(
+        srcptr, dst_bf16.data(), row / 2, s.N * 2, s.N * 2, s.N * 2, scales.data(), s.k_offset / 2,
+        s.blocksize / 2, s.N);
+    kernel::ref::decompress_kblock_f8_fp<F8_T>(srcptr, ref_bf16.data(), row / 2, s.N * 2, s.N * 2, s.N * 2,
+                                               scales.data(), s.k_offset / 2, s.blocksize / 2, s.N);
+    // the kernel truncates to bf16 where the reference rounds
+    ok &= compare_data(dst_bf16.data(), ref_bf16.data(), dst_bf16.size(), 1.f / 128);
+    return ok;
+  }
+
+  // the packed fp8 gemm against an fp32 gemm on the dequantized weight
+  template <typename GemmKernel>
+  bool test_gemm(const gemm_shape_t& s, WeightCompType type, float eps = 1e-4f) {
+    printf("Test case : %s gemm M_%d N_%d K_%d blocksize_%d\n", type == WeightCompType::F8E4M3_F32 ? "e4m3" : "e5m2",
+           s.M, s.N, s.K, s.blocksize);
+    std::vector<float> A(s.M * s.K), B(s.K * s.N), dst(s.M * s.N), ref(s.M * s.N, 0.f);
+    init_vector(&A, -1.f, 1.f, 1);
+    init_vector(&B, -1.f, 1.f, 2);
+
+    std::vector<uint8_t> codes(s.K * s.N);
+    std::vector<float> scales(s.K / s.blocksize * s.N), deq(s.K * s.N);
+    if (type == WeightCompType::F8E4M3_F32) {
+      kernel::ref::quantize_f32_f8_rowblock<utils::fp8_e4m3>(B.data(), codes.data(), s.K, s.N, s.N, s.N,
+                                                              scales.data(), s.blocksize);
+      kernel::ref::decompress_kblock_f8_fp<utils::fp8_e4m3>(codes.data(), deq.data(), s.K, s.N, s.N, s.N,
+                                                             scales.data(), 0, s.blocksize, s.N);
+    } else {
+      kernel::ref::quantize_f32_f8_rowblock<utils::fp8_e5m2>(B.data(), codes.data(), s.K, s.N, s.N, s.N,
+                                                              scales.data(), s.blocksize);
+      kernel::ref::decompress_kblock_f8_fp<utils::fp8_e5m2>(codes.data(), deq.data(), s.K, s.N, s.N, s.N,
+                                                             scales.data(), 0, s.blocksize, s.N);
+    }
+    if (std::is_same<typename GemmKernel::GemmCore::BType, utils::bf16>::value) {
+      // the activation is converted to bf16 and the weight decoded into bf16 by truncation
+      for (auto& a : A) a = utils::bf16(a).tofloat();
+      for (auto& w : deq) w = utils::bit_cast<float>(utils::bit_cast<uint32_t>(w) & 0xffff0000u);
+    }
+    for (int i = 0; i < s.M; i++) {
+      for (int k = 0; k < s.K; k++) {
+        for (int j = 0; j < s.N; j++) ref[i * s.N + j] += A[i * s.K + k] * deq[k * s.N + j];
+      }
+    }
+
+    GemmKernel kernel;
+    std::unique_ptr<prologue::PackedWeight> packedw(
+        kernel.getWeightPtr()->compressWeight(s.N, s.K, B.data(), s.N, s.blocksize, type));
+    compute(&kernel, s, A.data(), packedw.get(), dst.data());
+    return compare_data(dst.data(), ref.data(), dst.size(), eps);
+  }
+
+  // the fp32 kernel ends with alpha / beta, the bf16 one writes the accumulator back
+  template <typename GemmKernel>
+  void compute(GemmKernel* kernel, const gemm_shape_t& s, float* A, prologue::PackedWeight* w, float* C) {
+    using AVX512FKernel = jblas::wrapper::gemm_default::weight_comp::avx512f::GemmKernelF8KBlock;
+    if constexpr (std::is_same<GemmKernel, AVX512FKernel>::value) {
+      kernel->compute({s.M, s.N, s.K, A, s.K, w, C, C, s.N, s.N, 1.f, 0.f});
+    } else {
+      kernel->compute({s.M, s.N, s.K, A, s.K, w, C, s.N});
+    }
+  }
+};
+static const TestFp8Weight inst_;
+
+}  // namespace
+
+int main() {
+  printf("NE_TESTS: inner_product ");
+  printf(return_success ? "OK\n" : "FAILED\n");
+  return return_success ? 0 : -1;
+}
+#endif
@@ -14,6 +14,8 @@
 #ifndef NE_CORE_GRAPH_INNER_PRODUCT_H
 #define NE_CORE_GRAPH_INNER_PRODUCT_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -40,6 +42,18 @@ void jblas_timer(bool _init);
 
 int jblas_set_threads(int _nth);
 
+// Split the jblas thread team into one group of consecutive threads per NUMA node and pin each group to its node.
+// The gemms hand the columns of N out to consecutive threads, so with the weights placed by
+// jblas_weights_numa_distribute each group streams its part of every weight from the memory of its own node and
+// writes its columns of the shared output. n_nodes <= 0 takes every node of the host, 1 turns the split off.
+// Returns the number of nodes in use.
+int jblas_set_numa_nodes(int n_nodes);
+
+// column-split a packed weight over the nodes of jblas_set_numa_nodes, in the proportion of their thread groups.
+// page_size is the page size of the memory holding the weight (0 for normal pages), the shards are rounded to it so
+// that no huge page gets split. Returns how many shards were moved to their node, jblas_set_numa_nodes ones if all.
+int jblas_weights_numa_distribute(void* weiptr, size_t page_size);
+
 void jblas_init();
 
 #ifdef __cplusplus
@@ -0,0 +1,389 @@
+//  Copyright (c) 2023 Intel Corporation
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+#include "layers/mha_decode.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#ifdef NE_TESTS
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "layers/ne_test_layers_utils.hpp"
+#endif
+
+namespace {
+// KV positions scored at once, the scores of a block stay on the stack
+constexpr int kBlockKV = 256;
+// at least this many tasks per thread to balance the rows of causal queries
+constexpr int kTasksPerThread = 4;
+
+inline float fp16_to_fp32(ne_fp16_t x) { return NE_COMPUTE_FP16_TO_FP32(x); }
+
+// sum(x[i] * y[i]), x is float
+template <typename T>
+inline float dot(const float* x, const T* y, int n);
+
+template <>
+inline float dot<ne_fp16_t>(const float* x, const ne_fp16_t* y, int n) {
+  int i = 0;
+  float sum = 0.f;
+#if defined(__AVX512F__)
+  __m512 vsum = _mm512_setzero_ps();
+  for (; i + 16 <= n; i += 16) {
+    const __m512 vy = _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + i)));
+    vsum = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), vy, vsum);
+  }
+  sum = _mm512_reduce_add_ps(vsum);
+#endif
+  for (; i < n; ++i) sum += x[i] * fp16_to_fp32(y[i]);
+  return sum;
+}
+
+template <>
+inline float dot<int8_t>(const float* x, const int8_t* y, int n) {
+  int i = 0;
+  float sum = 0.f;
+#if defined(__AVX512F__)
+  __m512 vsum = _mm512_setzero_ps();
+  for (; i + 16 <= n; i += 16) {
+    const __m512 vy =
+        _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i))));
+    vsum = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), vy, vsum);
+  }
+  sum = _mm512_reduce_add_ps(vsum);
+#endif
+  for (; i < n; ++i) sum += x[i] * y[i];
+  return sum;
+}
+
+// y[i] += a * x[i]
+template <typename T>
+inline void axpy(float* y, const T* x, float a, int n);
+
+template <>
+inline void axpy<ne_fp16_t>(float* y, const ne_fp16_t* x, float a, int n) {
+  int i = 0;
+#if defined(__AVX512F__)
+  const __m512 va = _mm512_set1_ps(a);
+  for (; i + 16 <= n; i += 16) {
+    const __m512 vx = _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i)));
+    _mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, vx, _mm512_loadu_ps(y + i)));
+  }
+#endif
+  for (; i < n; ++i) y[i] += a * fp16_to_fp32(x[i]);
+}
+
+template <>
+inline void axpy<int8_t>(float* y, const int8_t* x, float a, int n) {
+  int i = 0;
+#if defined(__AVX512F__)
+  const __m512 va = _mm512_set1_ps(a);
+  for (; i + 16 <= n; i += 16) {
+    const __m512 vx =
+        _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i))));
+    _mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, vx, _mm512_loadu_ps(y + i)));
+  }
+#endif
+  for (; i < n; ++i) y[i] += a * x[i];
+}
+
+inline int rows_of(const attn_shape_t& s) { return s.batch_size * s.head_num * s.sl_q; }
+
+// the slope of the ALiBi bias of head h, as ne_alibi
+inline float alibi_slope(int h, int head_num, float max_bias) {
+  const int n_heads_log2_floor = 1 << static_cast<int>(std::floor(std::log2(head_num)));
+  if (h < n_heads_log2_floor) {
+    return std::pow(std::pow(2.0f, -max_bias / n_heads_log2_floor), static_cast<float>(h + 1));
+  }
+  return std::pow(std::pow(2.0f, -(max_bias / 2.0f) / n_heads_log2_floor),
+                  static_cast<float>(2 * (h - n_heads_log2_floor) + 1));
+}
+
+// the partial of a task: running max, running sum and head_size accumulators
+inline float* partial_of(const attn_decode_fwd_args_t& p, int row, int chunk, int n_chunks) {
+  return p.tmp + static_cast<size_t>(row * n_chunks + chunk) * (p.head_size + 2);
+}
+
+template <typename KV_T>
+void attn_decode_task(const attn_decode_fwd_args_t& p, int row, int chunk, int n_chunks) {
+  const int ibs = row / (p.head_num * p.sl_q);
+  const int ihn = row / p.sl_q % p.head_num;
+  const int iq = row % p.sl_q;
+  const int ihn_kv = ihn / (p.head_num / p.head_num_kv);
+  // the last query token sees all the cache, the previous ones stop earlier
+  const int kv_end = p.is_causal ? p.sl_kv - p.sl_q + iq + 1 : p.sl_kv;
+  const int chunk_size = (p.sl_kv + n_chunks - 1) / n_chunks;
+  const int j_begin = std::min(chunk * chunk_size, kv_end);
+  const int j_end = std::min(j_begin + chunk_size, kv_end);
+
+  const float* q = p.Q + ibs * p.step_q_bs + ihn * p.step_q_head_num + iq * p.step_q_sl;
+  const KV_T* k = static_cast<const KV_T*>(p.K) + ibs * p.step_k_bs + ihn_kv * p.step_k_head_num;
+  const KV_T* v = static_cast<const KV_T*>(p.V) + ibs * p.step_v_bs + ihn_kv * p.step_v_head_num;
+  const float* k_scale = p.K_scale ? p.K_scale + ibs * p.step_ks_bs + ihn_kv * p.step_ks_head_num : nullptr;
+  const float* v_scale = p.V_scale ? p.V_scale + ibs * p.step_vs_bs + ihn_kv * p.step_vs_head_num : nullptr;
+  // the ALiBi bias of KV position j is slope * (j - (sl_kv - 1)), the same for all the queries
+  const bool alibi = p.alibi_max_bias > 0;
+  const float slope = alibi ? alibi_slope(ihn, p.head_num, p.alibi_max_bias) : 0.f;
+
+  float* partial = partial_of(p, row, chunk, n_chunks);
+  float& m = partial[0];
+  float& l = partial[1];
+  float* acc = partial + 2;
+  m = -std::numeric_limits<float>::infinity();
+  l = 0.f;
+  std::fill_n(acc, p.head_size, 0.f);
+
+  alignas(64) float s[kBlockKV];
+  for (int j0 = j_begin; j0 < j_end; j0 += kBlockKV) {
+    const int len = std::min(kBlockKV, j_end - j0);
+    float m_block = m;
+    for (int j = 0; j < len; ++j) {
+      float qk = dot(q, k + (j0 + j) * p.step_k_sl, p.head_size);
+      if (k_scale) qk *= k_scale[(j0 + j) * p.step_ks_sl];
+      s[j] = qk * p.QK_scale;
+      if (alibi) s[j] += (j0 + j - p.sl_kv + 1) * slope;
+      m_block = std::max(m_block, s[j]);
+    }
+    // rescale what is accumulated to the new max
+    const float rescale = std::exp(m - m_block);
+    l *= rescale;
+    for (int d = 0; d < p.head_size; ++d) acc[d] *= rescale;
+    m = m_block;
+    for (int j = 0; j < len; ++j) {
+      s[j] = std::exp(s[j] - m);
+      l += s[j];
+      // fold the V scale into the probability
+      if (v_scale) s[j] *= v_scale[(j0 + j) * p.step_vs_sl];
+    }
+    if (p.step_v_hs == 1) {
+      for (int j = 0; j < len; ++j) axpy(acc, v + (j0 + j) * p.step_v_sl, s[j], p.head_size);
+    } else if (p.step_v_sl == 1) {
+      for (int d = 0; d < p.head_size; ++d) acc[d] += dot(s, v + d * p.step_v_hs + j0, len);
+    } else {
+      for (int d = 0; d < p.head_size; ++d) {
+        for (int j = 0; j < len; ++j) {
+          const KV_T x = v[d * p.step_v_hs + (j0 + j) * p.step_v_sl];
+          acc[d] += s[j] * (std::is_same<KV_T, ne_fp16_t>::value ? fp16_to_fp32(x) : static_cast<float>(x));
+        }
+      }
+    }
+  }
+}
+}  // namespace
+
+int ne_attn_decode_chunks(const attn_shape_t* params, int nth) {
+  const int rows = rows_of(*params);
+  const int max_chunks = std::max((params->sl_kv + kBlockKV - 1) / kBlockKV, 1);
+  const int chunks = (kTasksPerThread * nth + rows - 1) / rows;
+  return std::max(std::min(chunks, max_chunks), 1);
+}
+
+size_t ne_attn_decode_workspace_size(const attn_shape_t* params, int nth) {
+  return sizeof(float) * rows_of(*params) * ne_attn_decode_chunks(params, nth) * (params->head_size + 2);
+}
+
+void ne_attn_decode_forward(const attn_decode_fwd_args_t* params, int ith, int nth) {
+  const attn_decode_fwd_args_t& p = *params;
+  const attn_shape_t shape = {p.batch_size, p.head_num, p.head_size, p.sl_q, p.sl_kv};
+  const int n_chunks = ne_attn_decode_chunks(&shape, nth);
+  const int n_tasks = rows_of(shape) * n_chunks;
+  // consecutive tasks share the row, the query stays in cache
+  for (int task = ith; task < n_tasks; task += nth) {
+    if (p.kv_type == NE_TYPE_I8) {
+      attn_decode_task<int8_t>(p, task / n_chunks, task % n_chunks, n_chunks);
+    } else {
+      attn_decode_task<ne_fp16_t>(p, task / n_chunks, task % n_chunks, n_chunks);
+    }
+  }
+}
+
+void ne_attn_decode_reduce(const attn_decode_fwd_args_t* params, int ith, int nth) {
+  const attn_decode_fwd_args_t& p = *params;
+  const attn_shape_t shape = {p.batch_size, p.head_num, p.head_size, p.sl_q, p.sl_kv};
+  const int n_chunks = ne_attn_decode_chunks(&shape, nth);
+  for (int row = ith; row < rows_of(shape); row += nth) {
+    const int ibs = row / (p.head_num * p.sl_q);
+    const int ihn = row / p.sl_q % p.head_num;
+    const int iq = row % p.sl_q;
+    float* dst = p.dst + ibs * p.step_dst_bs + ihn * p.step_dst_head_num + iq * p.step_dst_sl;
+    float m = -std::numeric_limits<float>::infinity();
+    for (int c = 0; c < n_chunks; ++c) m = std::max(m, partial_of(p, row, c, n_chunks)[0]);
+    float l = 0.f;
+    std::fill_n(dst, p.head_size, 0.f);
+    for (int c = 0; c < n_chunks; ++c) {
+      const float* partial = partial_of(p, row, c, n_chunks);
+      // empty chunks of causal queries
+      if (partial[1] == 0.f) continue;
+      const float rescale = std::exp(partial[0] - m);
+      l += partial[1] * rescale;
+      for (int d = 0; d < p.head_size; ++d) dst[d] += partial[2 + d] * rescale;
+    }
+    const float inv_l = l > 0.f ? 1.f / l : 0.f;
+    for (int d = 0; d < p.head_size; ++d) dst[d] *= inv_l;
+  }
+}
+
+#ifdef NE_TESTS
+namespace {
+bool return_success = true;
+
+class TestMhaDecode {
+ public:
+  TestMhaDecode() {
+    printf("Test suit: %s\n", __FUNCTION__);
+    return_success &= test_case({1, 32, 128, 1, 2048}, NE_TYPE_F16, true);
+    return_success &= test_case({1, 32, 128, 1, 2048}, NE_TYPE_I8, true);
+    return_success &= test_case({4, 16, 64, 1, 77}, NE_TYPE_F16, false);
+    return_success &= test_case({2, 8, 80, 3, 300}, NE_TYPE_I8, true);
+    return_success &= test_case({2, 8, 80, 3, 300}, NE_TYPE_F16, true, true);
+    return_success &= test_case({1, 4, 256, 1, 1}, NE_TYPE_I8, false, true);
+    return_success &= test_case({2, 16, 64, 1, 129}, NE_TYPE_F16, true, false, 1);
+    return_success &= test_case({1, 32, 128, 2, 500}, NE_TYPE_I8, true, false, 8);
+    return_success &= test_case({2, 8, 64, 1, 300}, NE_TYPE_F16, true, false, 0, 8.f);
+    return_success &= test_case({1, 12, 64, 7, 96}, NE_TYPE_I8, true, false, 0, 8.f);
+    printf("Test suit done: %s\n", __FUNCTION__);
+  }
+
+  // K is [bs, sl_kv, hn_kv, head_size], V is transposed [bs, hn_kv, head_size, sl_kv] or per token as K, the
+  // scales are [bs, sl_kv, hn_kv] as the int8 KV cache
+  bool test_case(const attn_shape_t& s, ne_type kv_type, bool is_causal, bool v_per_token = false, int hn_kv = 0,
+                 float alibi_max_bias = 0.f) {
+    const int bs = s.batch_size, hn = s.head_num, hs = s.head_size, sl_q = s.sl_q, sl_kv = s.sl_kv;
+    if (hn_kv == 0) hn_kv = hn;
+    printf("Test case : bs_%d hn_%d hn_kv_%d hs_%d sl_q_%d sl_kv_%d %s %s %s %s\n", bs, hn, hn_kv, hs, sl_q, sl_kv,
+           kv_type == NE_TYPE_I8 ? "int8" : "fp16", is_causal ? "causal" : "", v_per_token ? "v_per_token" : "",
+           alibi_max_bias > 0 ? "alibi" : "");
+    std::vector<float> q(bs * sl_q * hn * hs), k(bs * sl_kv * hn_kv * hs), v(bs * sl_kv * hn_kv * hs);
+    std::vector<float> k_scale(bs * sl_kv * hn_kv, 1.f), v_scale(bs * sl_kv * hn_kv, 1.f);
+    static std::mt19937 rng(1);
+    std::uniform_int_distribution<> dist;
+    init_vector(&q, -1.f, 1.f, dist(rng));
+    init_vector(&k, -1.f, 1.f, dist(rng));
+    init_vector(&v, -1.f, 1.f, dist(rng));
+
+    // quantize as the KV cache, index of K (and of per token V) is [b][j][h][d]
+    std::vector<ne_fp16_t> k16(k.size()), v16(v.size());
+    std::vector<int8_t> k8(k.size()), v8(v.size());
+    for (int b = 0; b < bs; ++b) {
+      for (int j = 0; j < sl_kv; ++j) {
+        for (int h = 0; h < hn_kv; ++h) {
+          const int base = ((b * sl_kv + j) * hn_kv + h) * hs;
+          const int sidx = (b * sl_kv + j) * hn_kv + h;
+          if (kv_type == NE_TYPE_I8) {
+            float kmax = 0.f, vmax = 0.f;
+            for (int d = 0; d < hs; ++d) kmax = std::max(kmax, std::abs(k[base + d]));
+            for (int d = 0; d < hs; ++d) vmax = std::max(vmax, std::abs(v[base + d]));
+            k_scale[sidx] = kmax / 127.f;
+            v_scale[sidx] = vmax / 127.f;
+          }
+          for (int d = 0; d < hs; ++d) {
+            const int vidx = v_per_token ? base + d : ((b * hn_kv + h) * hs + d) * sl_kv + j;
+            k8[base + d] = static_cast<int8_t>(std::round(k[base + d] / k_scale[sidx]));
+            v8[vidx] = static_cast<int8_t>(std::round(v[base + d] / v_scale[sidx]));
+            k16[base + d] = NE_COMPUTE_FP32_TO_FP16(k[base + d]);
+            v16[vidx] = NE_COMPUTE_FP32_TO_FP16(v[base + d]);
+            // the reference uses the stored values
+            k[base + d] = kv_type == NE_TYPE_I8 ? k8[base + d] * k_scale[sidx] : fp16_to_fp32(k16[base + d]);
+            v[base + d] = kv_type == NE_TYPE_I8 ? v8[vidx] * v_scale[sidx] : fp16_to_fp32(v16[vidx]);
+          }
+        }
+      }
+    }
+
+    // reference: plain softmax attention, dst is [bs, sl_q, hn, hs]
+    const float qk_scale = 1.f / sqrtf(static_cast<float>(hs));
+    std::vector<float> ref(bs * sl_q * hn * hs), dst(ref.size());
+    std::vector<float> score(sl_kv);
+    const int n_heads_log2_floor = 1 << static_cast<int>(floor(log2(hn)));
+    for (int b = 0; b < bs; ++b) {
+      for (int h = 0; h < hn; ++h) {
+        const int h_kv = h / (hn / hn_kv);
+        // the slope of ne_alibi
+        const float slope = h < n_heads_log2_floor
+                                ? powf(powf(2.f, -alibi_max_bias / n_heads_log2_floor), h + 1)
+                                : powf(powf(2.f, -alibi_max_bias / 2.f / n_heads_log2_floor),
+                                       2 * (h - n_heads_log2_floor) + 1);
+        for (int i = 0; i < sl_q; ++i) {
+          const int kv_end = is_causal ? sl_kv - sl_q + i + 1 : sl_kv;
+          const float* qi = &q[((b * sl_q + i) * hn + h) * hs];
+          float smax = -std::numeric_limits<float>::infinity(), ssum = 0.f;
+          for (int j = 0; j < kv_end; ++j) {
+            score[j] = 0.f;
+            for (int d = 0; d < hs; ++d) score[j] += qi[d] * k[((b * sl_kv + j) * hn_kv + h_kv) * hs + d];
+            score[j] *= qk_scale;
+            if (alibi_max_bias > 0) score[j] += (j - sl_kv + 1) * slope;
+            smax = std::max(smax, score[j]);
+          }
+          for (int j = 0; j < kv_end; ++j) ssum += (score[j] = std::exp(score[j] - smax));
+          float* out = &ref[((b * sl_q + i) * hn + h) * hs];
+          for (int d = 0; d < hs; ++d) {
+            out[d] = 0.f;
+            for (int j = 0; j < kv_end; ++j) out[d] += score[j] / ssum * v[((b * sl_kv + j) * hn_kv + h_kv) * hs + d];
+          }
+        }
+      }
+    }
+
+    attn_decode_fwd_args_t args = {};
+    args.Q = q.data();
+    args.K = kv_type == NE_TYPE_I8 ? static_cast<const void*>(k8.data()) : k16.data();
+    args.V = kv_type == NE_TYPE_I8 ? static_cast<const void*>(v8.data()) : v16.data();
+    args.K_scale = kv_type == NE_TYPE_I8 ? k_scale.data() : nullptr;
+    args.V_scale = kv_type == NE_TYPE_I8 ? v_scale.data() : nullptr;
+    args.dst = dst.data();
+    args.QK_scale = qk_scale;
+    args.is_causal = is_causal;
+    args.alibi_max_bias = alibi_max_bias;
+    args.kv_type = kv_type;
+    args.batch_size = bs, args.head_num = hn, args.head_size = hs, args.sl_q = sl_q, args.sl_kv = sl_kv;
+    args.head_num_kv = hn_kv;
+    args.step_q_bs = sl_q * hn * hs, args.step_q_head_num = hs, args.step_q_sl = hn * hs;
+    args.step_k_bs = sl_kv * hn_kv * hs, args.step_k_head_num = hs, args.step_k_sl = hn_kv * hs;
+    if (v_per_token) {
+      args.step_v_bs = sl_kv * hn_kv * hs, args.step_v_head_num = hs, args.step_v_sl = hn_kv * hs, args.step_v_hs = 1;
+    } else {
+      args.step_v_bs = hn_kv * hs * sl_kv, args.step_v_head_num = hs * sl_kv, args.step_v_sl = 1;
+      args.step_v_hs = sl_kv;
+    }
+    args.step_ks_bs = sl_kv * hn_kv, args.step_ks_head_num = 1, args.step_ks_sl = hn_kv;
+    args.step_vs_bs = sl_kv * hn_kv, args.step_vs_head_num = 1, args.step_vs_sl = hn_kv;
+    args.step_dst_bs = sl_q * hn * hs, args.step_dst_head_num = hs, args.step_dst_sl = hn * hs;
+
+    bool ok = true;
+    for (int nth : {1, 7, 56}) {
+      std::vector<float> tmp(ne_attn_decode_workspace_size(&s, nth) / sizeof(float));
+      args.tmp = tmp.data();
+      // run the threads one after another, the reduction after all of them as the graph FINALIZE
+      for (int ith = 0; ith < nth; ++ith) ne_attn_decode_forward(&args, ith, nth);
+      for (int ith = 0; ith < nth; ++ith) ne_attn_decode_reduce(&args, ith, nth);
+      ok &= compare_data(dst.data(), ref.data(), dst.size(), 1e-3f);
+    }
+    return ok;
+  }
+};
+static const TestMhaDecode inst_;
+
+}  // namespace
+
+int main() {
+  printf("NE_TESTS: mha_decode ");
+  printf(return_success ? "OK\n" : "FAILED\n");
+  return return_success ? 0 : -1;
+}
+#endif
@@ -0,0 +1,64 @@
+//  Copyright (c) 2023 Intel Corporation
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+#ifndef NE_CORE_GRAPH_MHA_DECODE_H
+#define NE_CORE_GRAPH_MHA_DECODE_H
+
+#include "core/data_types.h"
+#include "layers/mha_dense.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Attention of a few query tokens over the whole KV cache (the next-token phase). The KV cache is streamed once with
+// online softmax. The work is split over (batch, head, query) rows and KV chunks, and each task writes a partial
+// (max, sum, acc) that the reduction merges. K and V are fp16, or int8 with a float scale per token and head.
+// All steps are in elements. V may be stored transposed (step_v_sl == 1) or per token (step_v_hs == 1).
+typedef struct attn_decode_fwd_args_t {
+  const float* Q;
+  const void* K;
+  const void* V;
+  const float* K_scale;  // NULL if K is not int8
+  const float* V_scale;  // NULL if V is not int8
+  float* dst;
+  float* tmp;  // workspace of ne_attn_decode_workspace_size bytes
+  float QK_scale;
+  bool is_causal;
+  float alibi_max_bias;  // > 0 to add the ALiBi bias of each head to the scores, as ne_alibi
+  enum ne_type kv_type;  // NE_TYPE_F16 or NE_TYPE_I8
+  int batch_size, head_num, head_size, sl_q, sl_kv;
+  int head_num_kv;  // divides head_num, query heads share the KV heads in groups (multi-query / grouped-query)
+  int step_q_bs, step_q_head_num, step_q_sl;
+  int step_k_bs, step_k_head_num, step_k_sl;
+  int step_v_bs, step_v_head_num, step_v_sl, step_v_hs;
+  int step_ks_bs, step_ks_head_num, step_ks_sl;
+  int step_vs_bs, step_vs_head_num, step_vs_sl;
+  int step_dst_bs, step_dst_head_num, step_dst_sl;
+} attn_decode_fwd_args_t;
+
+// number of KV chunks of each row when running with nth threads
+int ne_attn_decode_chunks(const attn_shape_t* params, int nth);
+
+size_t ne_attn_decode_workspace_size(const attn_shape_t* params, int nth);
+
+// the partial attention of the tasks of thread ith
+void ne_attn_decode_forward(const attn_decode_fwd_args_t* params, int ith, int nth);
+
+// merge the partials of the rows of thread ith into dst, after all threads finished ne_attn_decode_forward
+void ne_attn_decode_reduce(const attn_decode_fwd_args_t* params, int ith, int nth);
+
+#ifdef __cplusplus
+}
+#endif
+#endif  // NE_CORE_GRAPH_MHA_DECODE_H
@@ -0,0 +1,327 @@
+//  Copyright (c) 2023 Intel Corporation
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+#include "layers/numa.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct numa_topology {
+  std::vector<int> node_ids;            // sysfs id of each node
+  std::vector<std::vector<int>> cpus;  // CPUs of each node
+};
+
+// parse a sysfs list such as "0-3,8,10-11"
+std::vector<int> parse_list(const std::string& s) {
+  std::vector<int> ret;
+  size_t pos = 0;
+  while (pos < s.size()) {
+    size_t end = s.find(',', pos);
+    if (end == std::string::npos) end = s.size();
+    std::string range = s.substr(pos, end - pos);
+    pos = end + 1;
+    if (range.empty() || range[0] < '0' || range[0] > '9') continue;
+    size_t dash = range.find('-');
+    int lo = std::stoi(range.substr(0, dash));
+    int hi = dash == std::string::npos ? lo : std::stoi(range.substr(dash + 1));
+    for (int i = lo; i <= hi; i++) ret.push_back(i);
+  }
+  return ret;
+}
+
+bool read_line(const std::string& path, std::string* line) {
+  FILE* fp = fopen(path.c_str(), "r");
+  if (fp == nullptr) return false;
+  char buf[4096];
+  bool ok = fgets(buf, sizeof(buf), fp) != nullptr;
+  fclose(fp);
+  if (ok) {
+    *line = buf;
+    while (!line->empty() && (line->back() == '\n' || line->back() == ' ')) line->pop_back();
+  }
+  return ok;
+}
+
+numa_topology detect_topology() {
+  numa_topology topo;
+#ifdef __linux__
+  std::string line;
+  if (read_line("/sys/devices/system/node/online", &line)) {
+    for (int id : parse_list(line)) {
+      std::string cpulist;
+      if (!read_line("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist", &cpulist)) continue;
+      auto cpus = parse_list(cpulist);
+      if (cpus.empty()) continue;  // memory-only node
+      topo.node_ids.push_back(id);
+      topo.cpus.push_back(cpus);
+    }
+  }
+#endif
+  if (topo.node_ids.empty()) {
+    topo.node_ids.push_back(-1);
+    topo.cpus.emplace_back();
+  }
+  return topo;
+}
+
+const numa_topology& topology() {
+  static const numa_topology topo = detect_topology();
+  return topo;
+}
+
+struct mem_config {
+  bool huge_pages = true;
+  bool hugetlb = true;
+  ne_mem_policy policy = NE_MEM_POLICY_DEFAULT;
+  int node = 0;
+};
+
+mem_config& mem_conf() {
+  static mem_config conf;
+  return conf;
+}
+
+#ifdef __linux__
+constexpr size_t kMinHugeAlloc = size_t(2) << 20;
+
+inline size_t pad_to(size_t size, size_t page) { return (size + page - 1) / page * page; }
+
+size_t base_page_size() { return static_cast<size_t>(sysconf(_SC_PAGESIZE)); }
+
+// size of the default reserved huge pages, 0 if there are none
+size_t hugetlb_page_size() {
+  static const size_t page = [] {
+    std::string line;
+    if (!read_line("/proc/sys/vm/nr_hugepages", &line) || std::atol(line.c_str()) <= 0) return size_t(0);
+    FILE* fp = fopen("/proc/meminfo", "r");
+    if (fp == nullptr) return size_t(0);
+    char buf[256];
+    size_t kb = 0;
+    while (fgets(buf, sizeof(buf), fp) != nullptr) {
+      if (sscanf(buf, "Hugepagesize: %zu kB", &kb) == 1) break;
+    }
+    fclose(fp);
+    return kb * 1024;
+  }();
+  return page;
+}
+
+// size of the transparent huge pages, 0 if they are disabled
+size_t thp_page_size() {
+  static const size_t page = [] {
+    std::string line;
+    if (!read_line("/sys/kernel/mm/transparent_hugepage/enabled", &line) ||
+        line.find("[never]") != std::string::npos) {
+      return size_t(0);
+    }
+    if (read_line("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", &line)) {
+      return static_cast<size_t>(std::atol(line.c_str()));
+    }
+    return kMinHugeAlloc;
+  }();
+  return page;
+}
+
+// the mode and node mask of the configured policy, false if there is nothing to set
+bool policy_args(const mem_config& conf, int* mode, std::vector<unsigned long>* mask) {
+  const auto& topo = topology();
+  if (conf.policy == NE_MEM_POLICY_DEFAULT || topo.node_ids[0] < 0) return false;
+  constexpr int kBits = 8 * sizeof(unsigned long);
+  auto set_node = [&](int id) {
+    if (static_cast<int>(mask->size()) <= id / kBits) mask->resize(id / kBits + 1, 0);
+    (*mask)[id / kBits] |= 1UL << (id % kBits);
+  };
+  if (conf.policy == NE_MEM_POLICY_LOCAL) {
+    *mode = MPOL_LOCAL;
+  } else if (conf.policy == NE_MEM_POLICY_INTERLEAVE) {
+    *mode = MPOL_INTERLEAVE;
+    for (int id : topo.node_ids) set_node(id);
+  } else {
+    if (conf.node < 0 || conf.node >= static_cast<int>(topo.node_ids.size())) return false;
+    *mode = MPOL_BIND;
+    set_node(topo.node_ids[conf.node]);
+  }
+  return true;
+}
+
+void* map_anonymous(size_t size, int extra_flags) {
+  return mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extra_flags, -1, 0);
+}
+#endif
+
+}  // namespace
+
+int ne_numa_num_nodes(void) { return static_cast<int>(topology().node_ids.size()); }
+
+int ne_numa_node_cpus(int node, int* cpus, int max_cpus) {
+  const auto& topo = topology();
+  if (node < 0 || node >= static_cast<int>(topo.cpus.size())) return 0;
+  int n = std::min(max_cpus, static_cast<int>(topo.cpus[node].size()));
+  std::copy(topo.cpus[node].begin(), topo.cpus[node].begin() + n, cpus);
+  return n;
+}
+
+bool ne_numa_bind_thread(int node) {
+  const auto& topo = topology();
+  if (node < 0 || node >= static_cast<int>(topo.node_ids.size())) return false;
+  if (topo.node_ids[node] < 0) return true;
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : topo.cpus[node]) {
+    if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+  }
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+  return true;
+#endif
+}
+
+bool ne_numa_bind_memory(void* addr, size_t size, int node) {
+  const auto& topo = topology();
+  if (node < 0 || node >= static_cast<int>(topo.node_ids.size())) return false;
+  if (topo.node_ids[node] < 0) return true;
+#ifdef __linux__
+  const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  uintptr_t begin = (reinterpret_cast<uintptr_t>(addr) + page - 1) / page * page;
+  uintptr_t end = (reinterpret_cast<uintptr_t>(addr) + size) / page * page;
+  if (end <= begin) return true;  // smaller than a page, leave it where it is
+  const int id = topo.node_ids[node];
+  constexpr int kBits = 8 * sizeof(unsigned long);
+  std::vector<unsigned long> mask(id / kBits + 1, 0);
+  mask[id / kBits] |= 1UL << (id % kBits);
+  return syscall(SYS_mbind, begin, end - begin, MPOL_BIND, mask.data(), mask.size() * kBits + 1, MPOL_MF_MOVE) == 0;
+#else
+  return true;
+#endif
+}
+
+void ne_mem_configure(bool huge_pages, enum ne_mem_policy policy, int node) {
+  auto& conf = mem_conf();
+  conf.huge_pages = huge_pages;
+  conf.policy = policy;
+  conf.node = node;
+}
+
+void ne_mem_allow_hugetlb(bool allow) { mem_conf().hugetlb = allow; }
+
+void* ne_mem_alloc(size_t size, size_t* page_size) {
+#ifdef __linux__
+  const auto& conf = mem_conf();
+  if (size >= kMinHugeAlloc) {
+    void* addr = MAP_FAILED;
+    size_t page = 0;
+    if (conf.huge_pages && conf.hugetlb) {
+      // reserved huge pages need no compaction and are never split, try them before the transparent ones
+      constexpr size_t k1G = size_t(1) << 30;
+      if (size >= k1G) {
+        addr = map_anonymous(pad_to(size, k1G), MAP_HUGETLB | (30 << MAP_HUGE_SHIFT));
+        page = k1G;
+      }
+      if (addr == MAP_FAILED && hugetlb_page_size() > 0) {
+        page = hugetlb_page_size();
+        addr = map_anonymous(pad_to(size, page), MAP_HUGETLB);
+      }
+    }
+    if (addr == MAP_FAILED) {
+      page = conf.huge_pages && thp_page_size() > 0 ? thp_page_size() : base_page_size();
+      addr = map_anonymous(pad_to(size, page), 0);
+      if (addr != MAP_FAILED && page != base_page_size() && madvise(addr, pad_to(size, page), MADV_HUGEPAGE) != 0) {
+        // ne_mem_free unmaps the size padded to the page size it is given, map it again with normal pages
+        page = base_page_size();
+        munmap(addr, pad_to(size, thp_page_size()));
+        addr = map_anonymous(pad_to(size, page), 0);
+      }
+    }
+    if (addr != MAP_FAILED) {
+      int mode = 0;
+      std::vector<unsigned long> mask;
+      if (policy_args(conf, &mode, &mask)) {
+        syscall(SYS_mbind, addr, pad_to(size, page), mode, mask.empty() ? nullptr : mask.data(),
+                mask.size() * 8 * sizeof(unsigned long) + 1, 0);
+      }
+      *page_size = page;
+      return addr;
+    }
+  }
+#endif
+  *page_size = 0;
+  return malloc(size);
+}
+
+void ne_mem_free(void* addr, size_t size, size_t page_size) {
+  if (addr == nullptr) return;
+  if (page_size == 0) {
+    free(addr);
+    return;
+  }
+#ifdef __linux__
+  munmap(addr, pad_to(size, page_size));
+#endif
+}
+
+bool ne_mem_thread_policy(bool enable) {
+#ifdef __linux__
+  int mode = MPOL_DEFAULT;
+  std::vector<unsigned long> mask;
+  if (enable && !policy_args(mem_conf(), &mode, &mask)) return true;
+  return syscall(SYS_set_mempolicy, mode, mask.empty() ? nullptr : mask.data(),
+                 mask.size() * 8 * sizeof(unsigned long) + 1) == 0;
+#else
+  return true;
+#endif
+}
+
+size_t ne_mem_advised_page_size(void) {
+#ifdef __linux__
+  return mem_conf().huge_pages ? thp_page_size() : 0;
+#else
+  return 0;
+#endif
+}
+
+bool ne_mem_advise_huge_pages(void* addr, size_t size) {
+#ifdef __linux__
+  if (!mem_conf().huge_pages || thp_page_size() == 0) return false;
+  return madvise(addr, size, MADV_HUGEPAGE) == 0;
+#else
+  return false;
+#endif
+}
+
+const char* ne_mem_policy_name(enum ne_mem_policy policy) {
+  switch (policy) {
+    case NE_MEM_POLICY_LOCAL:
+      return "local";
+    case NE_MEM_POLICY_INTERLEAVE:
+      return "interleave";
+    case NE_MEM_POLICY_BIND:
+      return "bind";
+    default:
+      return "default";
+  }
+}
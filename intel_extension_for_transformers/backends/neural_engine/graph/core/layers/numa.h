@@ -0,0 +1,73 @@
+//  Copyright (c) 2023 Intel Corporation
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+#ifndef NE_CORE_GRAPH_NUMA_H
+#define NE_CORE_GRAPH_NUMA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// NUMA topology of the host, read from sysfs so that no libnuma is needed. Nodes are numbered 0..n-1 in the order of
+// the online nodes of the system. A host without NUMA support (or a non-Linux one) reports a single node holding
+// every CPU, and binding to it is a no-op that succeeds.
+int ne_numa_num_nodes(void);
+
+// the CPUs of a node, returns how many were written to cpus (at most max_cpus)
+int ne_numa_node_cpus(int node, int* cpus, int max_cpus);
+
+// pin the calling thread to the CPUs of a node
+bool ne_numa_bind_thread(int node);
+
+// place the pages fully inside [addr, addr + size) on a node, moving the ones already faulted in
+bool ne_numa_bind_memory(void* addr, size_t size, int node);
+
+// placement of the pages of a buffer when they are faulted in
+enum ne_mem_policy {
+  NE_MEM_POLICY_DEFAULT,     // the policy of the process, first touch unless it runs under numactl
+  NE_MEM_POLICY_LOCAL,       // the node of the thread touching the page first
+  NE_MEM_POLICY_INTERLEAVE,  // round-robin over every node
+  NE_MEM_POLICY_BIND,        // a single node
+};
+
+// the page size and NUMA policy of the buffers from ne_mem_alloc, and of the file pages faulted in by a thread
+// between ne_mem_thread_policy(true) and ne_mem_thread_policy(false)
+void ne_mem_configure(bool huge_pages, enum ne_mem_policy policy, int node);
+
+// whether ne_mem_alloc may take reserved huge pages (the default). Buffers that are bound to nodes in parts later on,
+// as the NUMA split of the weights does, must not: mbind fails on a part of a reserved huge page.
+void ne_mem_allow_hugetlb(bool allow);
+
+// An anonymous buffer with the configured policy. Buffers of 2 MB or more are backed by reserved huge pages
+// (MAP_HUGETLB, 1 GB ones from 1 GB up) when the system has them and they are allowed, else by transparent huge pages, else by normal
+// pages. page_size is set to the page size in use, 0 for small buffers that come from the heap.
+void* ne_mem_alloc(size_t size, size_t* page_size);
+void ne_mem_free(void* addr, size_t size, size_t page_size);
+
+// set (or reset to the default) the configured policy as the policy of the calling thread
+bool ne_mem_thread_policy(bool enable);
+
+// ask for transparent huge pages on a file mapping if huge pages are configured, the kernel may ignore it
+bool ne_mem_advise_huge_pages(void* addr, size_t size);
+// the page size ne_mem_advise_huge_pages asks for, 0 if it doesn't
+size_t ne_mem_advised_page_size(void);
+
+const char* ne_mem_policy_name(enum ne_mem_policy policy);
+
+#ifdef __cplusplus
+}
+#endif
+#endif  // NE_CORE_GRAPH_NUMA_H
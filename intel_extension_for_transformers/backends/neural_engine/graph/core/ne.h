@@ -40,7 +40,7 @@
 #define NE_MAX_NODES 4096
 #define NE_MAX_PARAMS 256
 #define NE_MAX_CONTEXTS 64
-#define NE_MAX_OPT 4
+#define NE_MAX_OPT 6
 #define NE_DEFAULT_N_THREADS 4
 
 #define NE_SIZE_CALC -1
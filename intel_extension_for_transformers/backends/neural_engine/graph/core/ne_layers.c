@@ -49,6 +49,7 @@
 #include "layers/ele_reduce.h"
 #include "layers/ele_wise.h"
 #include "layers/mha_dense.h"
+#include "layers/mha_decode.h"
 #include "ne.h"
 
 // if C99 - static_assert is noop
@@ -416,6 +417,7 @@ static const char* NE_OP_LABEL[NE_OP_COUNT] = {
     "SCALE",
     "SET",
     "CPY",
+    "CPY_I8_SCALED",
     "CONT",
     "RESHAPE",
     "VIEW",
@@ -439,13 +441,18 @@ static const char* NE_OP_LABEL[NE_OP_COUNT] = {
     "FFN_GeLU",
     "FFN_ADD_GeLU",
     "FLASH_ATTN",
+    "FLASH_ATTN_KV",
+    "ROPE_KV",
+    "KV_SHIFT",
+    "NORM_FUSED",
+    "SCALE_MASK_SOFT_MAX",
     "FLASH_FF",
 
     "MAP_UNARY",
     "MAP_BINARY",
 };
 
-static_assert(NE_OP_COUNT == 56, "NE_OP_COUNT != 56");
+static_assert(NE_OP_COUNT == 62, "NE_OP_COUNT != 62");
 
 static const char* NE_OP_SYMBOL[NE_OP_COUNT] = {
     "none",
@@ -481,6 +488,7 @@ static const char* NE_OP_SYMBOL[NE_OP_COUNT] = {
     "x*v",
     "y-\\>view(x)",
     "x-\\>y",
+    "q8(x)-\\>y",
     "cont(x)",
     "reshape(x)",
     "view(x)",
@@ -504,6 +512,11 @@ static const char* NE_OP_SYMBOL[NE_OP_COUNT] = {
     "ffn_gelu(x)",
     "ffn_gelu_with_bias(x)",
     "flash_attn(x)",
+    "flash_attn_kv(x)",
+    "rope_kv(x)",
+    "kv_shift(x)",
+    "norm(x+y)*w+b",
+    "soft_max(mask(x*v))",
     "flash_ff(x)",
 
     "f(x)",
@@ -2265,6 +2278,30 @@ struct ne_tensor* ne_cpy_inplace(struct ne_context* ctx, struct ne_tensor* a, st
   return ne_cpy_impl(ctx, a, b, true);
 }
 
+// ne_cpy_i8_scaled
+
+struct ne_tensor* ne_cpy_i8_scaled(struct ne_context* ctx, struct ne_tensor* a, struct ne_tensor* b,
+                                   struct ne_tensor* b_scale) {
+  NE_ASSERT(a->type == NE_TYPE_F32 && b->type == NE_TYPE_I8 && b_scale->type == NE_TYPE_F32);
+  NE_ASSERT(ne_are_same_shape(a, b));
+  NE_ASSERT(b_scale->ne[0] == a->ne[1] && b_scale->ne[1] == a->ne[2] && b_scale->ne[2] == a->ne[3]);
+
+  if (a->grad || b->grad) {
+    NE_ASSERT(false);  // TODO: implement backward
+  }
+
+  // make a view of the destination
+  struct ne_tensor* result = ne_view_tensor(ctx, b);
+
+  result->op = NE_OP_CPY_I8_SCALED;
+  result->grad = NULL;
+  result->src0 = a;
+  result->src1 = b;
+  result->opt[0] = b_scale;
+
+  return result;
+}
+
 // ne_cont
 
 struct ne_tensor* ne_cont_impl(struct ne_context* ctx, struct ne_tensor* a, bool inplace) {
@@ -2813,6 +2850,103 @@ struct ne_tensor* ne_rope_inplace(struct ne_context* ctx, struct ne_tensor* a, i
   return ne_rope_impl(ctx, a, n_past, n_dims, mode, true);
 }
 
+// ne_rope_kv
+
+struct ne_tensor* ne_rope_kv(struct ne_context* ctx, struct ne_tensor* q, struct ne_tensor* k, struct ne_tensor* v,
+                             struct ne_tensor* k_cache, struct ne_tensor* v_cache, struct ne_tensor* k_scale,
+                             struct ne_tensor* v_scale, int n_past, int n_dims, int mode) {
+  const int64_t head_size = q->ne[0];
+  const int64_t seq_cur = q->ne[2];
+  const int64_t batch = q->ne[3];
+  NE_ASSERT(n_past >= 0 && (mode & 1) == 0);
+  NE_ASSERT(n_dims >= 0 && n_dims <= head_size && n_dims % 2 == 0);
+  NE_ASSERT(q->type == NE_TYPE_F32 && k->type == NE_TYPE_F32 && v->type == NE_TYPE_F32);
+  NE_ASSERT(q->nb[0] == sizeof(float) && k->nb[0] == sizeof(float) && v->nb[0] == sizeof(float));
+  NE_ASSERT(ne_are_same_shape(k, v) && k->ne[0] == head_size && q->ne[1] % k->ne[1] == 0);
+  NE_ASSERT(k->ne[2] == seq_cur && k->ne[3] == batch);
+  NE_ASSERT(ne_are_same_shape(k, k_cache) && k_cache->nb[0] == ne_element_size(k_cache));
+  NE_ASSERT(v_cache->ne[0] == seq_cur && v_cache->ne[1] == head_size && v_cache->ne[2] == k->ne[1] &&
+            v_cache->ne[3] == batch);
+  NE_ASSERT(k_cache->type == v_cache->type);
+  NE_ASSERT((k_cache->type == NE_TYPE_I8) == (k_scale != NULL) && (v_cache->type == NE_TYPE_I8) == (v_scale != NULL));
+  NE_ASSERT(k_scale == NULL || (k_scale->ne[0] == k->ne[1] && k_scale->ne[1] == seq_cur && k_scale->ne[2] == batch));
+  NE_ASSERT(v_scale == NULL || (v_scale->ne[0] == k->ne[1] && v_scale->ne[1] == seq_cur && v_scale->ne[2] == batch));
+
+  if (q->grad || k->grad || v->grad) {
+    NE_ASSERT(false);  // TODO: implement backward
+  }
+
+  // q is rotated in place
+  struct ne_tensor* result = ne_view_tensor(ctx, q);
+
+  ne_scratch_save(ctx);
+
+  struct ne_tensor* b = ne_new_tensor_1d(ctx, NE_TYPE_I32, 3, NE_SIZE_CALC);
+
+  ((int32_t*)b->data)[0] = n_past;
+  ((int32_t*)b->data)[1] = n_dims;
+  ((int32_t*)b->data)[2] = mode;
+
+  ne_scratch_load(ctx);
+
+  result->op = NE_OP_ROPE_KV;
+  result->grad = NULL;
+  result->src0 = q;
+  result->src1 = k;
+  result->opt[0] = v;
+  result->opt[1] = k_cache;
+  result->opt[2] = v_cache;
+  result->opt[3] = k_scale;
+  result->opt[4] = v_scale;
+  result->opt[5] = b;
+
+  return result;
+}
+
+// ne_kv_shift
+
+struct ne_tensor* ne_kv_shift(struct ne_context* ctx, struct ne_tensor* k_cache, struct ne_tensor* v_cache,
+                              struct ne_tensor* k_scale, struct ne_tensor* v_scale, int n_past, int n_keep,
+                              int n_discard, int n_dims, int mode) {
+  const int64_t head_size = k_cache->ne[0];
+  const int64_t n_head_kv = k_cache->ne[1];
+  const int64_t n_ctx = k_cache->ne[2];
+  const int64_t n_seq = k_cache->ne[3];
+  NE_ASSERT(n_keep >= 0 && n_discard >= 0 && n_keep + n_discard <= n_past && n_past <= n_ctx);
+  NE_ASSERT((mode & 1) == 0 && n_dims >= 0 && n_dims <= head_size && n_dims % 2 == 0);
+  NE_ASSERT(k_cache->type == v_cache->type && k_cache->nb[0] == ne_element_size(k_cache));
+  NE_ASSERT(v_cache->ne[0] == n_ctx && v_cache->ne[1] == head_size && v_cache->ne[2] == n_head_kv &&
+            v_cache->ne[3] == n_seq && v_cache->nb[0] == ne_element_size(v_cache));
+  NE_ASSERT((k_cache->type == NE_TYPE_I8) == (k_scale != NULL) && (v_cache->type == NE_TYPE_I8) == (v_scale != NULL));
+  NE_ASSERT(k_scale == NULL || (k_scale->ne[0] == n_head_kv && k_scale->ne[1] == n_ctx && k_scale->ne[2] == n_seq));
+  NE_ASSERT(v_scale == NULL || (v_scale->ne[0] == n_head_kv && v_scale->ne[1] == n_ctx && v_scale->ne[2] == n_seq));
+
+  // the cache is updated in place
+  struct ne_tensor* result = ne_view_tensor(ctx, k_cache);
+
+  ne_scratch_save(ctx);
+
+  struct ne_tensor* b = ne_new_tensor_1d(ctx, NE_TYPE_I32, 5, NE_SIZE_CALC);
+
+  ((int32_t*)b->data)[0] = n_past;
+  ((int32_t*)b->data)[1] = n_keep;
+  ((int32_t*)b->data)[2] = n_discard;
+  ((int32_t*)b->data)[3] = n_dims;
+  ((int32_t*)b->data)[4] = mode;
+
+  ne_scratch_load(ctx);
+
+  result->op = NE_OP_KV_SHIFT;
+  result->grad = NULL;
+  result->src0 = k_cache;
+  result->src1 = v_cache;
+  result->opt[0] = k_scale;
+  result->opt[1] = v_scale;
+  result->opt[2] = b;
+
+  return result;
+}
+
 // ne_rope_back
 
 struct ne_tensor* ne_rope_back(struct ne_context* ctx, struct ne_tensor* a, int n_past, int n_dims, int mode) {
@@ -2999,6 +3133,44 @@ struct ne_tensor* ne_flash_attn(struct ne_context* ctx, struct ne_tensor* q, str
   return result;
 }
 
+// ne_flash_attn_kv
+
+struct ne_tensor* ne_flash_attn_kv(struct ne_context* ctx, struct ne_tensor* q, struct ne_tensor* k,
+                                   struct ne_tensor* v, struct ne_tensor* k_scale, struct ne_tensor* v_scale,
+                                   float scale, bool masked, float alibi_max_bias) {
+  const int batch = q->ne[3];
+  const int headsize = q->ne[0];
+  const int headnum = q->ne[2];
+  const int seq_cur = q->ne[1];
+  const int seq_all = k->ne[1];
+  NE_ASSERT(q->type == NE_TYPE_F32);
+  NE_ASSERT(k->type == v->type && (k->type == NE_TYPE_F16 || k->type == NE_TYPE_I8));
+  NE_ASSERT((k->type == NE_TYPE_I8) == (k_scale != NULL) && (v->type == NE_TYPE_I8) == (v_scale != NULL));
+  NE_ASSERT(k_scale == NULL || (k_scale->ne[0] == k->ne[2] && k_scale->ne[1] == seq_all));
+  NE_ASSERT(v_scale == NULL || (v_scale->ne[0] == v->ne[2] && v_scale->ne[1] == seq_all));
+  // K and V may have fewer heads than Q (multi-query / grouped-query)
+  NE_ASSERT(headsize == k->ne[0] && headnum % k->ne[2] == 0 && batch == k->ne[3]);
+  NE_ASSERT(headsize == v->ne[1] && seq_all == v->ne[0] && k->ne[2] == v->ne[2] && batch == v->ne[3]);
+  NE_ASSERT(seq_cur <= seq_all);
+  struct ne_tensor* result = ne_new_tensor_4d(ctx, NE_TYPE_F32, headsize, headnum, seq_cur, batch, NE_SIZE_CALC);
+  result->op = NE_OP_FLASH_ATTN_KV;
+  result->grad = NULL;
+  result->src0 = q;
+  result->src1 = k;
+  result->opt[0] = v;
+  result->opt[1] = k_scale;
+  result->opt[2] = v_scale;
+  *(float*)result->padding = scale;
+  *(bool*)&result->padding[sizeof(scale)] = masked;
+  if (alibi_max_bias > 0) {
+    ne_scratch_save(ctx);
+    result->opt[3] = ne_new_f32(ctx, alibi_max_bias);
+    ne_scratch_load(ctx);
+  }
+
+  return result;
+}
+
 // ne_flash_ff
 
 struct ne_tensor* ne_flash_ff(struct ne_context* ctx, struct ne_tensor* a, struct ne_tensor* b0, struct ne_tensor* b1,
@@ -3129,6 +3301,46 @@ static void ne_compute_forward_dup_same_cont(const struct ne_compute_params* par
     memcpy(((char*)dst->data + ie0 * nb0), ((char*)src0->data + ie0 * nb00), (ie1 - ie0) * NE_TYPE_SIZE[src0->type]);
   }
 }
+// element-wise copy of non-contiguous tensors of the same shape and type, e.g. views of an int8 KV cache
+static void ne_compute_forward_dup_same_type(const struct ne_compute_params* params, const struct ne_tensor* src0,
+                                             struct ne_tensor* dst) {
+  NE_ASSERT(ne_are_same_shape(src0, dst));
+  NE_ASSERT(src0->type == dst->type && !ne_is_quantized(src0->type));
+
+  if (params->type == NE_TASK_INIT || params->type == NE_TASK_FINALIZE) {
+    return;
+  }
+
+  const size_t type_size = NE_TYPE_SIZE[src0->type];
+  const int64_t ne0 = dst->ne[0];
+  const int64_t ne1 = dst->ne[1];
+  const int64_t ne2 = dst->ne[2];
+  const int64_t nr = ne_nrows(dst);
+
+  const int ith = params->ith;  // thread index
+  const int nth = params->nth;  // number of threads
+
+  // parallelize by rows
+  const int64_t dr = (nr + nth - 1) / nth;
+  const int64_t ir0 = dr * ith;
+  const int64_t ir1 = MIN(ir0 + dr, nr);
+
+  for (int64_t ir = ir0; ir < ir1; ++ir) {
+    const int64_t i3 = ir / (ne2 * ne1);
+    const int64_t i2 = (ir - i3 * ne2 * ne1) / ne1;
+    const int64_t i1 = ir - i3 * ne2 * ne1 - i2 * ne1;
+    const char* x = (const char*)src0->data + i1 * src0->nb[1] + i2 * src0->nb[2] + i3 * src0->nb[3];
+    char* y = (char*)dst->data + i1 * dst->nb[1] + i2 * dst->nb[2] + i3 * dst->nb[3];
+    if (src0->nb[0] == type_size && dst->nb[0] == type_size) {
+      memcpy(y, x, ne0 * type_size);
+    } else {
+      for (int64_t i0 = 0; i0 < ne0; ++i0) {
+        memcpy(y + i0 * dst->nb[0], x + i0 * src0->nb[0], type_size);
+      }
+    }
+  }
+}
+
 static void ne_compute_forward_dup_f16(const struct ne_compute_params* params, const struct ne_tensor* src0,
                                        struct ne_tensor* dst) {
   NE_ASSERT(ne_nelements(dst) == ne_nelements(src0));
@@ -3654,8 +3866,9 @@ static void ne_compute_forward_dup_f32(const struct ne_compute_params* params, c
       }
     }
   } else if (dst->type == NE_TYPE_F16) {
-    bool dst_contiguous = nb0 < nb1 && nb1 < nb2 && nb2 < nb3;
-    bool src_perm1203 = nb01 < nb02 && nb02 < nb00 && nb00 < nb03;
+    // the rows of dims 1 and 2 are indexed as one, so they must be dense in both
+    bool dst_contiguous = nb0 < nb1 && nb1 < nb2 && nb2 < nb3 && nb2 == ne1 * nb1;
+    bool src_perm1203 = nb01 < nb02 && nb02 < nb00 && nb00 < nb03 && nb01 == sizeof(float) && nb02 == ne01 * nb01;
     if (dst_contiguous && src_perm1203) {  // number of rows per thread
       int nele = ne1 * ne2;
       int dn = (nele + nth - 1) / nth;
@@ -3745,7 +3958,7 @@ static void ne_compute_forward_dup(const struct ne_compute_params* params, const
       ne_compute_forward_dup_f32(params, src0, dst);
     } break;
     default: {
-      NE_ASSERT(false);
+      ne_compute_forward_dup_same_type(params, src0, dst);
     } break;
   }
 }
@@ -5703,6 +5916,103 @@ static void ne_compute_forward_rms_norm_back(const struct ne_compute_params* par
   }
 }
 
+// ne_compute_forward_norm_fused
+
+static void ne_compute_forward_norm_fused_f32(const struct ne_compute_params* params, const struct ne_tensor* src0,
+                                              const struct ne_tensor* src1, const struct ne_tensor* w,
+                                              const struct ne_tensor* b, struct ne_tensor* sum, struct ne_tensor* dst) {
+  NE_ASSERT(ne_are_same_shape(src0, dst));
+
+  if (params->type == NE_TASK_INIT || params->type == NE_TASK_FINALIZE) {
+    return;
+  }
+
+  NE_ASSERT(src0->nb[0] == sizeof(float));
+
+  const bool rms = dst->padding[0];
+
+  const int ith = params->ith;
+  const int nth = params->nth;
+
+  const int64_t ne00 = src0->ne[0];
+  const int64_t ne01 = src0->ne[1];
+  const int64_t ne02 = src0->ne[2];
+  const int64_t nr = ne_nrows(src0);
+
+  // rows per thread
+  const int64_t dr = (nr + nth - 1) / nth;
+  const int64_t ir0 = dr * ith;
+  const int64_t ir1 = MIN(ir0 + dr, nr);
+
+  // the same arithmetic as ne_add, ne_norm / ne_rms_norm, ne_mul and ne_add one after another, row by row
+  const float eps = rms ? 1e-6f : 1e-5f;
+
+  for (int64_t ir = ir0; ir < ir1; ir++) {
+    const int64_t i03 = ir / (ne02 * ne01);
+    const int64_t i02 = (ir - i03 * ne02 * ne01) / ne01;
+    const int64_t i01 = ir - i03 * ne02 * ne01 - i02 * ne01;
+
+    const float* x = (float*)((char*)src0->data + i01 * src0->nb[1] + i02 * src0->nb[2] + i03 * src0->nb[3]);
+    float* y = (float*)((char*)dst->data + i01 * dst->nb[1] + i02 * dst->nb[2] + i03 * dst->nb[3]);
+
+    if (src1) {
+      // the residual: x + src1 is an output too
+      float* s = (float*)((char*)sum->data + i01 * sum->nb[1] + i02 * sum->nb[2] + i03 * sum->nb[3]);
+      ne_vec_add_f32(ne00, s, x,
+                     (float*)((char*)src1->data + i01 * src1->nb[1] + i02 * src1->nb[2] + i03 * src1->nb[3]));
+      x = s;
+    }
+
+    float scale;
+    if (rms) {
+      ne_float sum2 = 0.0;
+      for (int64_t i00 = 0; i00 < ne00; i00++) {
+        sum2 += (ne_float)(x[i00] * x[i00]);
+      }
+      const float mean = sum2 / ne00;
+
+      memcpy(y, x, ne00 * sizeof(float));
+      scale = 1.0f / sqrtf(mean + eps);
+    } else {
+      ne_float sum1 = 0.0;
+      for (int64_t i00 = 0; i00 < ne00; i00++) {
+        sum1 += (ne_float)x[i00];
+      }
+      const float mean = sum1 / ne00;
+
+      ne_float sum2 = 0.0;
+      for (int64_t i00 = 0; i00 < ne00; i00++) {
+        float v = x[i00] - mean;
+        y[i00] = v;
+        sum2 += (ne_float)(v * v);
+      }
+      const float variance = sum2 / ne00;
+      scale = 1.0f / sqrtf(variance + eps);
+    }
+    ne_vec_scale_f32(ne00, y, scale);
+
+    if (w) {
+      ne_vec_mul_f32(ne00, y, y, (float*)w->data);
+    }
+    if (b) {
+      ne_vec_add_f32(ne00, y, y, (float*)b->data);
+    }
+  }
+}
+
+static void ne_compute_forward_norm_fused(const struct ne_compute_params* params, const struct ne_tensor* src0,
+                                          const struct ne_tensor* src1, const struct ne_tensor* w,
+                                          const struct ne_tensor* b, struct ne_tensor* sum, struct ne_tensor* dst) {
+  switch (src0->type) {
+    case NE_TYPE_F32: {
+      ne_compute_forward_norm_fused_f32(params, src0, src1, w, b, sum, dst);
+    } break;
+    default: {
+      NE_ASSERT(false);
+    } break;
+  }
+}
+
 static void ne_compute_forward_mul_mat_f32(const struct ne_compute_params* params, const struct ne_tensor* src0,
                                            const struct ne_tensor* src1, struct ne_tensor* dst) {
   int64_t t0 = ne_perf_time_us();
@@ -5786,9 +6096,9 @@ static void ne_compute_forward_mul_mat_f32(const struct ne_compute_params* param
     const int64_t i12 = (ir1 - i13 * ne12 * ne11) / ne11;
     const int64_t i11 = (ir1 - i13 * ne12 * ne11 - i12 * ne11);
 
-    const int64_t ir0 = (ir1 / ne11) % (ne02 * ne03);
-    const int64_t i03 = (ir0 / (ne02));
-    const int64_t i02 = (ir0 - i03 * ne02);
+    // src0 is shared by groups of consecutive src1 matrices, e.g. a KV head by the query heads of its group
+    const int64_t i03 = i13 / (ne13 / ne03);
+    const int64_t i02 = i12 / (ne12 / ne02);
 
     const int64_t i1 = i11;
     const int64_t i2 = i12;
@@ -5906,9 +6216,9 @@ static void ne_compute_forward_mul_mat_f16_f32(const struct ne_compute_params* p
     const int64_t i12 = (ir1 - i13 * ne12 * ne11) / ne11;
     const int64_t i11 = (ir1 - i13 * ne12 * ne11 - i12 * ne11);
 
-    const int64_t ir0 = (ir1 / ne11) % (ne02 * ne03);
-    const int64_t i03 = (ir0 / (ne02));
-    const int64_t i02 = (ir0 - i03 * ne02);
+    // src0 is shared by groups of consecutive src1 matrices, e.g. a KV head by the query heads of its group
+    const int64_t i03 = i13 / (ne13 / ne03);
+    const int64_t i02 = i12 / (ne12 / ne02);
 
     const int64_t i1 = i11;
     const int64_t i2 = i12;
@@ -6036,9 +6346,9 @@ static void ne_compute_forward_mul_mat_q_f32(const struct ne_compute_params* par
     const int64_t i12 = (ir1 - i13 * ne12 * ne11) / ne11;
     const int64_t i11 = (ir1 - i13 * ne12 * ne11 - i12 * ne11);
 
-    const int64_t ir0 = (ir1 / ne11) % (ne02 * ne03);
-    const int64_t i03 = (ir0 / (ne02));
-    const int64_t i02 = (ir0 - i03 * ne02);
+    // src0 is shared by groups of consecutive src1 matrices, e.g. a KV head by the query heads of its group
+    const int64_t i03 = i13 / (ne13 / ne03);
+    const int64_t i02 = i12 / (ne12 / ne02);
 
     const int64_t i1 = i11;
     const int64_t i2 = i12;
@@ -6490,6 +6800,57 @@ static void ne_compute_forward_cpy(const struct ne_compute_params* params, const
   ne_compute_forward_dup(params, src0, dst);
 }
 
+// ne_compute_forward_cpy_i8_scaled
+
+static void ne_compute_forward_cpy_i8_scaled(const struct ne_compute_params* params, const struct ne_tensor* src0,
+                                             const struct ne_tensor* scale, struct ne_tensor* dst) {
+  if (params->type == NE_TASK_INIT || params->type == NE_TASK_FINALIZE) {
+    return;
+  }
+  NE_ASSERT(src0->nb[0] == sizeof(float));
+
+  const int ith = params->ith;
+  const int nth = params->nth;
+
+  const int64_t ne0 = src0->ne[0];
+  const int64_t ne1 = src0->ne[1];
+  const int64_t ne2 = src0->ne[2];
+  const int64_t nr = ne_nrows(src0);
+
+  // rows per thread
+  const int64_t dr = (nr + nth - 1) / nth;
+  const int64_t ir0 = dr * ith;
+  const int64_t ir1 = MIN(ir0 + dr, nr);
+
+  for (int64_t ir = ir0; ir < ir1; ++ir) {
+    const int64_t i3 = ir / (ne2 * ne1);
+    const int64_t i2 = (ir - i3 * ne2 * ne1) / ne1;
+    const int64_t i1 = ir - i3 * ne2 * ne1 - i2 * ne1;
+
+    const float* x = (const float*)((char*)src0->data + i1 * src0->nb[1] + i2 * src0->nb[2] + i3 * src0->nb[3]);
+    char* y = (char*)dst->data + i1 * dst->nb[1] + i2 * dst->nb[2] + i3 * dst->nb[3];
+
+    float amax = 0.0f;
+    for (int64_t i0 = 0; i0 < ne0; ++i0) {
+      amax = MAX(amax, fabsf(x[i0]));
+    }
+    const float d = amax / 127.0f;
+    const float id = d ? 1.0f / d : 0.0f;
+    *(float*)((char*)scale->data + i1 * scale->nb[0] + i2 * scale->nb[1] + i3 * scale->nb[2]) = d;
+
+    if (dst->nb[0] == sizeof(int8_t)) {
+      for (int64_t i0 = 0; i0 < ne0; ++i0) {
+        ((int8_t*)y)[i0] = (int8_t)roundf(x[i0] * id);
+      }
+    } else {
+      // transposed destination
+      for (int64_t i0 = 0; i0 < ne0; ++i0) {
+        *(int8_t*)(y + i0 * dst->nb[0]) = (int8_t)roundf(x[i0] * id);
+      }
+    }
+  }
+}
+
 // ne_compute_forward_cont
 
 static void ne_compute_forward_cont(const struct ne_compute_params* params, const struct ne_tensor* src0,
@@ -6962,6 +7323,88 @@ static void ne_compute_forward_soft_max(const struct ne_compute_params* params,
   }
 }
 
+// ne_compute_forward_scale_mask_soft_max
+
+static void ne_compute_forward_scale_mask_soft_max_f32(const struct ne_compute_params* params,
+                                                       const struct ne_tensor* src0, const struct ne_tensor* src1,
+                                                       struct ne_tensor* dst) {
+  NE_ASSERT(ne_is_contiguous(src0));
+  NE_ASSERT(ne_is_contiguous(dst));
+  NE_ASSERT(ne_are_same_shape(src0, dst));
+
+  if (params->type == NE_TASK_INIT || params->type == NE_TASK_FINALIZE) {
+    return;
+  }
+
+  // the scale factor if any, and n_past of the causal mask or -1
+  const float v = src1 ? *(float*)src1->data : 1.0f;
+  const int32_t n_past = *(int32_t*)dst->padding;
+
+  const int ith = params->ith;
+  const int nth = params->nth;
+
+  const int nc = src0->ne[0];
+  const int ne1 = src0->ne[1];
+  const int nr = ne_nrows(src0);
+
+  // rows per thread
+  const int dr = (nr + nth - 1) / nth;
+
+  // row range for this thread
+  const int ir0 = dr * ith;
+  const int ir1 = MIN(ir0 + dr, nr);
+
+  for (int i1 = ir0; i1 < ir1; i1++) {
+    const float* sp = (float*)((char*)src0->data + i1 * src0->nb[1]);
+    float* dp = (float*)((char*)dst->data + i1 * dst->nb[1]);
+
+    // the columns past n_past + row are masked
+    const int n_valid = n_past < 0 ? nc : MIN(nc, n_past + i1 % ne1 + 1);
+    for (int i = 0; i < n_valid; i++) {
+      dp[i] = src1 ? sp[i] * v : sp[i];
+    }
+
+    float max = -INFINITY;
+    ne_vec_max_f32(n_valid, &max, dp);
+
+    // the same arithmetic as ne_soft_max
+    ne_float sum = 0.0;
+    uint16_t scvt;
+    for (int i = 0; i < n_valid; i++) {
+      if (dp[i] == -INFINITY) {
+        dp[i] = 0.0f;
+      } else {
+        ne_fp16_t s = NE_FP32_TO_FP16(dp[i] - max);
+        memcpy(&scvt, &s, sizeof(scvt));
+        const float val = NE_FP16_TO_FP32(table_exp_f16[scvt]);
+        sum += (ne_float)val;
+        dp[i] = val;
+      }
+    }
+    for (int i = n_valid; i < nc; i++) {
+      dp[i] = 0.0f;
+    }
+
+    assert(sum > 0.0);
+
+    sum = 1.0 / sum;
+    ne_vec_scale_f32(n_valid, dp, sum);
+  }
+}
+
+static void ne_compute_forward_scale_mask_soft_max(const struct ne_compute_params* params,
+                                                   const struct ne_tensor* src0, const struct ne_tensor* src1,
+                                                   struct ne_tensor* dst) {
+  switch (src0->type) {
+    case NE_TYPE_F32: {
+      ne_compute_forward_scale_mask_soft_max_f32(params, src0, src1, dst);
+    } break;
+    default: {
+      NE_ASSERT(false);
+    } break;
+  }
+}
+
 // ne_compute_forward_alibi
 
 static void ne_compute_forward_alibi_f32(const struct ne_compute_params* params, const struct ne_tensor* src0,
@@ -6982,8 +7425,8 @@ static void ne_compute_forward_alibi_f32(const struct ne_compute_params* params,
 
   const int ne0 = src0->ne[0];  // all_seq_len = n_past + ne1
   const int ne1 = src0->ne[1];  // seq_len_without_past
-  // const int ne2 = src0->ne[2]; // n_head -> this is k
-  // const int ne3 = src0->ne[3]; // 1 -> bsz
+  const int ne2 = src0->ne[2];  // n_head
+  // const int ne3 = src0->ne[3]; // bsz
 
   const int n = ne_nrows(src0);
   const int ne2_ne3 = n / ne1;  // ne2*ne3
@@ -7009,14 +7452,14 @@ static void ne_compute_forward_alibi_f32(const struct ne_compute_params* params,
         float* const src = (float*)((char*)src0->data + i * nb0 + j * nb1 + k * nb2);
         float* pdst = (float*)((char*)dst->data + i * nb0 + j * nb1 + k * nb2);
 
-        // TODO: k*nb2 or k*nb3
-
+        // the rows of the batch are contiguous after the heads, the slope only depends on the head
+        const int h = k % ne2;
         float m_k;
 
-        if (k < n_heads_log2_floor) {
-          m_k = powf(m0, k + 1);
+        if (h < n_heads_log2_floor) {
+          m_k = powf(m0, h + 1);
         } else {
-          m_k = powf(m1, 2 * (k - n_heads_log2_floor) + 1);
+          m_k = powf(m1, 2 * (h - n_heads_log2_floor) + 1);
         }
 
         pdst[0] = (i - ne0 + 1) * m_k + src[0];
@@ -7043,8 +7486,8 @@ static void ne_compute_forward_alibi_f16(const struct ne_compute_params* params,
 
   const int ne0 = src0->ne[0];  // all_seq_len = n_past + ne1
   const int ne1 = src0->ne[1];  // seq_len_without_past
-  // const int ne2 = src0->ne[2]; // n_head -> this is k
-  // const int ne3 = src0->ne[3]; // 1 -> bsz
+  const int ne2 = src0->ne[2];  // n_head
+  // const int ne3 = src0->ne[3]; // bsz
 
   const int n = ne_nrows(src0);
   const int ne2_ne3 = n / ne1;  // ne2*ne3
@@ -7070,14 +7513,14 @@ static void ne_compute_forward_alibi_f16(const struct ne_compute_params* params,
         ne_fp16_t* const src = (ne_fp16_t*)((char*)src0->data + i * nb0 + j * nb1 + k * nb2);
         float* pdst = (float*)((char*)dst->data + i * nb0 + j * nb1 + k * nb2);
 
-        // TODO: k*nb2 or k*nb3
-
+        // the rows of the batch are contiguous after the heads, the slope only depends on the head
+        const int h = k % ne2;
         float m_k;
 
-        if (k < n_heads_log2_floor) {
-          m_k = powf(m0, k + 1);
+        if (h < n_heads_log2_floor) {
+          m_k = powf(m0, h + 1);
         } else {
-          m_k = powf(m1, 2 * (k - n_heads_log2_floor) + 1);
+          m_k = powf(m1, 2 * (h - n_heads_log2_floor) + 1);
         }
 
         // we return F32
@@ -7414,36 +7857,314 @@ static void ne_compute_forward_rope(const struct ne_compute_params* params, cons
   }
 }
 
-// ne_compute_forward_rope_back
+// ne_compute_forward_rope_kv
 
-static void ne_compute_forward_rope_back_f32(const struct ne_compute_params* params, const struct ne_tensor* src0,
-                                             const struct ne_tensor* src1, struct ne_tensor* dst) {
-  assert(src1->type == NE_TYPE_I32);
-  assert(ne_nelements(src1) == 3);
+// the cos and sin of the pairs of a row at position p, in the order ne_compute_forward_rope_f32 rotates them
+static void ne_rope_kv_table(float* cos_t, float* sin_t, int64_t n_pairs, int64_t p, float theta_scale) {
+  float theta = (float)p;
+  for (int64_t i = 0; i < n_pairs; ++i) {
+    cos_t[i] = cosf(theta);
+    sin_t[i] = sinf(theta);
+    theta *= theta_scale;
+  }
+}
 
-  if (params->type == NE_TASK_INIT || params->type == NE_TASK_FINALIZE) {
+// y = rope(x) of a row of ne0 values, y may be x
+static void ne_rope_kv_rotate(float* y, const float* x, int64_t ne0, int n_dims, bool is_neox, const float* cos_t,
+                              const float* sin_t) {
+  if (n_dims == 0) {
+    if (y != x) {
+      memcpy(y, x, ne0 * sizeof(float));
+    }
     return;
   }
+  if (!is_neox) {
+    for (int64_t i = 0; i < ne0 / 2; ++i) {
+      const float x0 = x[2 * i];
+      const float x1 = x[2 * i + 1];
+      y[2 * i] = x0 * cos_t[i] - x1 * sin_t[i];
+      y[2 * i + 1] = x0 * sin_t[i] + x1 * cos_t[i];
+    }
+    return;
+  }
+  // GPT-NeoX: rotate the two halves of each block of n_dims values
+  const int64_t half = n_dims / 2;
+  const int64_t n_blocks = ne0 / n_dims;
+  for (int64_t ib = 0; ib < n_blocks; ++ib) {
+    const float* xb = x + ib * n_dims;
+    float* yb = y + ib * n_dims;
+    const float* c = cos_t + ib * half;
+    const float* s = sin_t + ib * half;
+    for (int64_t i = 0; i < half; ++i) {
+      const float x0 = xb[i];
+      const float x1 = xb[i + half];
+      yb[i] = x0 * c[i] - x1 * s[i];
+      yb[i + half] = x0 * s[i] + x1 * c[i];
+    }
+  }
+  if (y != x) {
+    // the tail of the row out of the blocks is not rotated
+    memcpy(y + n_blocks * n_dims, x + n_blocks * n_dims, (ne0 - n_blocks * n_dims) * sizeof(float));
+  }
+}
 
-  // y = rope(x, src1)
-  // dx = rope_back(dy, src1)
-  // src0 is dy, src1 contains options
-
-  const int n_past = ((int32_t*)src1->data)[0];
-  const int n_dims = ((int32_t*)src1->data)[1];
-  const int mode = ((int32_t*)src1->data)[2];
-
-  assert(n_past >= 0);
-
-  const size_t nb00 = src0->nb[0];
-  const size_t nb01 = src0->nb[1];
-  const size_t nb02 = src0->nb[2];
-  const size_t nb03 = src0->nb[3];
-
-  const int64_t ne0 = dst->ne[0];
-  const int64_t ne1 = dst->ne[1];
-  const int64_t ne2 = dst->ne[2];
-  const int64_t ne3 = dst->ne[3];
+// store a row of n values to y of the given type, whose values are step bytes apart
+static void ne_rope_kv_store(char* y, size_t step, enum ne_type type, const float* x, int64_t n, float* scale) {
+  switch (type) {
+    case NE_TYPE_F32: {
+      for (int64_t i = 0; i < n; ++i) {
+        *(float*)(y + i * step) = x[i];
+      }
+    } break;
+    case NE_TYPE_F16: {
+      if (step == sizeof(ne_fp16_t)) {
+        ne_fp32_to_fp16_row(x, (ne_fp16_t*)y, n);
+      } else {
+        for (int64_t i = 0; i < n; ++i) {
+          *(ne_fp16_t*)(y + i * step) = NE_FP32_TO_FP16(x[i]);
+        }
+      }
+    } break;
+    case NE_TYPE_I8: {
+      // absmax scale of the row, as ne_cpy_i8_scaled
+      float amax = 0.0f;
+      for (int64_t i = 0; i < n; ++i) {
+        amax = MAX(amax, fabsf(x[i]));
+      }
+      const float d = amax / 127.0f;
+      const float id = d ? 1.0f / d : 0.0f;
+      *scale = d;
+      for (int64_t i = 0; i < n; ++i) {
+        *(int8_t*)(y + i * step) = (int8_t)roundf(x[i] * id);
+      }
+    } break;
+    default: {
+      NE_ASSERT(false);
+    } break;
+  }
+}
+
+static void ne_compute_forward_rope_kv(const struct ne_compute_params* params, const struct ne_tensor* q,
+                                       const struct ne_tensor* k, const struct ne_tensor* v,
+                                       const struct ne_tensor* k_cache, const struct ne_tensor* v_cache,
+                                       const struct ne_tensor* k_scale, const struct ne_tensor* v_scale,
+                                       const struct ne_tensor* src1, struct ne_tensor* dst) {
+  NE_ASSERT(src1->type == NE_TYPE_I32);
+  NE_ASSERT(ne_nelements(src1) == 3);
+
+  if (params->type == NE_TASK_INIT || params->type == NE_TASK_FINALIZE) {
+    return;
+  }
+
+  const int n_past = ((int32_t*)src1->data)[0];
+  const int n_dims = ((int32_t*)src1->data)[1];
+  const int mode = ((int32_t*)src1->data)[2];
+  const bool is_neox = mode & 2;
+
+  const int64_t head_size = q->ne[0];
+  const int64_t n_head = q->ne[1];
+  const int64_t n_head_kv = k->ne[1];
+  const int64_t seq_cur = q->ne[2];
+  const int64_t batch = q->ne[3];
+  const int64_t n_pairs = head_size / 2;
+
+  // the rows of each token are its heads of Q, then of K, then of V
+  const int64_t rows_per_token = n_head + 2 * n_head_kv;
+  const int64_t nr = batch * seq_cur * rows_per_token;
+
+  const int ith = params->ith;
+  const int nth = params->nth;
+
+  // rows per thread
+  const int64_t dr = (nr + nth - 1) / nth;
+  const int64_t ir0 = dr * ith;
+  const int64_t ir1 = MIN(ir0 + dr, nr);
+
+  float* cos_t = (float*)params->wdata + ith * (2 * head_size + CACHE_LINE_SIZE_F32);
+  float* sin_t = cos_t + n_pairs;
+  float* tmp = sin_t + n_pairs;
+
+  const float theta_scale = n_dims ? powf(10000.0, -2.0f / n_dims) : 0.0f;
+  // the table is shared by all the heads of a token
+  int64_t p_table = -1;
+
+  for (int64_t ir = ir0; ir < ir1; ++ir) {
+    const int64_t i3 = ir / (seq_cur * rows_per_token);
+    const int64_t i2 = ir / rows_per_token % seq_cur;
+    int64_t h = ir % rows_per_token;
+    const int64_t p = n_past + i2;
+    if (n_dims && h < n_head + n_head_kv && p != p_table) {
+      ne_rope_kv_table(cos_t, sin_t, n_pairs, p, theta_scale);
+      p_table = p;
+    }
+
+    if (h < n_head) {
+      float* x = (float*)((char*)dst->data + h * dst->nb[1] + i2 * dst->nb[2] + i3 * dst->nb[3]);
+      ne_rope_kv_rotate(x, x, head_size, n_dims, is_neox, cos_t, sin_t);
+      continue;
+    }
+    h -= n_head;
+
+    if (h < n_head_kv) {
+      const float* x = (const float*)((char*)k->data + h * k->nb[1] + i2 * k->nb[2] + i3 * k->nb[3]);
+      ne_rope_kv_rotate(tmp, x, head_size, n_dims, is_neox, cos_t, sin_t);
+      char* y = (char*)k_cache->data + h * k_cache->nb[1] + i2 * k_cache->nb[2] + i3 * k_cache->nb[3];
+      float* scale = k_scale ? (float*)((char*)k_scale->data + h * k_scale->nb[0] + i2 * k_scale->nb[1] +
+                                        i3 * k_scale->nb[2])
+                             : NULL;
+      ne_rope_kv_store(y, k_cache->nb[0], k_cache->type, tmp, head_size, scale);
+    } else {
+      h -= n_head_kv;
+      const float* x = (const float*)((char*)v->data + h * v->nb[1] + i2 * v->nb[2] + i3 * v->nb[3]);
+      // the V cache is transposed, the values of a row are v_cache->nb[1] apart
+      char* y = (char*)v_cache->data + i2 * v_cache->nb[0] + h * v_cache->nb[2] + i3 * v_cache->nb[3];
+      float* scale = v_scale ? (float*)((char*)v_scale->data + h * v_scale->nb[0] + i2 * v_scale->nb[1] +
+                                        i3 * v_scale->nb[2])
+                             : NULL;
+      ne_rope_kv_store(y, v_cache->nb[1], v_cache->type, x, head_size, scale);
+    }
+  }
+}
+
+// ne_compute_forward_kv_shift
+
+// load a row of n values of the given type, whose values are contiguous, as ne_rope_kv_store stored it
+static void ne_kv_shift_load(float* y, const char* x, enum ne_type type, int64_t n, float scale) {
+  switch (type) {
+    case NE_TYPE_F32: {
+      memcpy(y, x, n * sizeof(float));
+    } break;
+    case NE_TYPE_F16: {
+      ne_fp16_to_fp32_row((const ne_fp16_t*)x, y, n);
+    } break;
+    case NE_TYPE_I8: {
+      for (int64_t i = 0; i < n; ++i) {
+        y[i] = ((const int8_t*)x)[i] * scale;
+      }
+    } break;
+    default: {
+      NE_ASSERT(false);
+    } break;
+  }
+}
+
+static void ne_compute_forward_kv_shift(const struct ne_compute_params* params, const struct ne_tensor* k_cache,
+                                        const struct ne_tensor* v_cache, const struct ne_tensor* k_scale,
+                                        const struct ne_tensor* v_scale, const struct ne_tensor* src1) {
+  NE_ASSERT(src1->type == NE_TYPE_I32);
+  NE_ASSERT(ne_nelements(src1) == 5);
+
+  if (params->type == NE_TASK_INIT || params->type == NE_TASK_FINALIZE) {
+    return;
+  }
+
+  const int n_past = ((int32_t*)src1->data)[0];
+  const int n_keep = ((int32_t*)src1->data)[1];
+  const int n_discard = ((int32_t*)src1->data)[2];
+  const int n_dims = ((int32_t*)src1->data)[3];
+  const int mode = ((int32_t*)src1->data)[4];
+  const bool is_neox = mode & 2;
+
+  const int64_t head_size = k_cache->ne[0];
+  const int64_t n_head_kv = k_cache->ne[1];
+  const int64_t n_seq = k_cache->ne[3];
+  const int64_t n_pairs = head_size / 2;
+  const size_t es = ne_element_size(k_cache);
+  // the tokens after the discarded ones move n_discard positions down
+  const int64_t t0 = n_keep + n_discard;
+  const int64_t n_move = n_past - t0;
+
+  // each (sequence, KV head) is moved by one thread, so that the tokens are moved in order in place
+  const int64_t nr = n_seq * n_head_kv;
+
+  const int ith = params->ith;
+  const int nth = params->nth;
+
+  // rows per thread
+  const int64_t dr = (nr + nth - 1) / nth;
+  const int64_t ir0 = dr * ith;
+  const int64_t ir1 = MIN(ir0 + dr, nr);
+
+  if (n_discard == 0 || n_move <= 0 || ir0 >= ir1) {
+    return;
+  }
+
+  float* cos_t = (float*)params->wdata + ith * (2 * head_size + CACHE_LINE_SIZE_F32);
+  float* sin_t = cos_t + n_pairs;
+  float* tmp = sin_t + n_pairs;
+
+  // rotating by the position -n_discard moves a rotated K from position p to p - n_discard
+  if (n_dims) {
+    ne_rope_kv_table(cos_t, sin_t, n_pairs, -n_discard, powf(10000.0, -2.0f / n_dims));
+  }
+
+  for (int64_t ir = ir0; ir < ir1; ++ir) {
+    const int64_t is = ir / n_head_kv;
+    const int64_t h = ir % n_head_kv;
+
+    for (int64_t t = t0; t < n_past; ++t) {
+      const char* x = (const char*)k_cache->data + h * k_cache->nb[1] + t * k_cache->nb[2] + is * k_cache->nb[3];
+      char* y = (char*)k_cache->data + h * k_cache->nb[1] + (t - n_discard) * k_cache->nb[2] + is * k_cache->nb[3];
+      float* x_scale = k_scale ? (float*)((char*)k_scale->data + h * k_scale->nb[0] + t * k_scale->nb[1] +
+                                          is * k_scale->nb[2])
+                               : NULL;
+      float* y_scale = k_scale ? (float*)((char*)x_scale - n_discard * k_scale->nb[1]) : NULL;
+      if (n_dims == 0) {
+        memcpy(y, x, head_size * es);
+        if (k_scale) {
+          *y_scale = *x_scale;
+        }
+        continue;
+      }
+      ne_kv_shift_load(tmp, x, k_cache->type, head_size, x_scale ? *x_scale : 0.0f);
+      ne_rope_kv_rotate(tmp, tmp, head_size, n_dims, is_neox, cos_t, sin_t);
+      ne_rope_kv_store(y, es, k_cache->type, tmp, head_size, y_scale);
+    }
+
+    // the V cache is transposed, each of its rows of n_ctx values moves as a whole
+    for (int64_t i = 0; i < head_size; ++i) {
+      char* row = (char*)v_cache->data + i * v_cache->nb[1] + h * v_cache->nb[2] + is * v_cache->nb[3];
+      memmove(row + (t0 - n_discard) * es, row + t0 * es, n_move * es);
+    }
+    if (v_scale) {
+      for (int64_t t = t0; t < n_past; ++t) {
+        char* s = (char*)v_scale->data + h * v_scale->nb[0] + is * v_scale->nb[2];
+        *(float*)(s + (t - n_discard) * v_scale->nb[1]) = *(float*)(s + t * v_scale->nb[1]);
+      }
+    }
+  }
+}
+
+// ne_compute_forward_rope_back
+
+static void ne_compute_forward_rope_back_f32(const struct ne_compute_params* params, const struct ne_tensor* src0,
+                                             const struct ne_tensor* src1, struct ne_tensor* dst) {
+  assert(src1->type == NE_TYPE_I32);
+  assert(ne_nelements(src1) == 3);
+
+  if (params->type == NE_TASK_INIT || params->type == NE_TASK_FINALIZE) {
+    return;
+  }
+
+  // y = rope(x, src1)
+  // dx = rope_back(dy, src1)
+  // src0 is dy, src1 contains options
+
+  const int n_past = ((int32_t*)src1->data)[0];
+  const int n_dims = ((int32_t*)src1->data)[1];
+  const int mode = ((int32_t*)src1->data)[2];
+
+  assert(n_past >= 0);
+
+  const size_t nb00 = src0->nb[0];
+  const size_t nb01 = src0->nb[1];
+  const size_t nb02 = src0->nb[2];
+  const size_t nb03 = src0->nb[3];
+
+  const int64_t ne0 = dst->ne[0];
+  const int64_t ne1 = dst->ne[1];
+  const int64_t ne2 = dst->ne[2];
+  const int64_t ne3 = dst->ne[3];
 
   const size_t nb0 = dst->nb[0];
   const size_t nb1 = dst->nb[1];
@@ -8395,8 +9116,9 @@ static void ne_compute_forward_flash_attn_f32_f16_f16(const struct ne_compute_pa
   const int64_t seq_past = seq_all - seq_cur;
   const int64_t batch = neq3;
 
-  const int step_k_bs = k->nb[3] / sizeof(float);
-  const int step_v_bs = v->nb[3] / sizeof(float);
+  // in elements of K and V
+  const int step_k_bs = k->nb[3] / sizeof(ne_fp16_t);
+  const int step_v_bs = v->nb[3] / sizeof(ne_fp16_t);
 
   if (params->type == NE_TASK_INIT) {
     return;
@@ -8680,6 +9402,64 @@ static void ne_compute_forward_flash_attn(const struct ne_compute_params* params
   }
 }
 
+// ne_compute_forward_flash_attn_kv
+
+static void ne_compute_forward_flash_attn_kv(const struct ne_compute_params* params, const struct ne_tensor* q,
+                                             const struct ne_tensor* k, const struct ne_tensor* v,
+                                             const struct ne_tensor* k_scale, const struct ne_tensor* v_scale,
+                                             const struct ne_tensor* alibi, struct ne_tensor* dst) {
+  if (params->type == NE_TASK_INIT) {
+    return;
+  }
+  const size_t esq = ne_element_size(q);
+  const size_t eskv = ne_element_size(k);
+  NE_ASSERT(q->nb[0] == esq && k->nb[0] == eskv);
+  attn_decode_fwd_args_t args = {
+      .Q = (const float*)q->data,
+      .K = k->data,
+      .V = v->data,
+      .K_scale = k_scale ? (const float*)k_scale->data : NULL,
+      .V_scale = v_scale ? (const float*)v_scale->data : NULL,
+      .dst = (float*)dst->data,
+      .tmp = (float*)params->wdata,
+      .QK_scale = *(float*)dst->padding,
+      .is_causal = *(bool*)&dst->padding[sizeof(float)],
+      .alibi_max_bias = alibi ? *(const float*)alibi->data : 0.0f,
+      .kv_type = k->type,
+      .batch_size = q->ne[3],
+      .head_num = q->ne[2],
+      .head_size = q->ne[0],
+      .sl_q = q->ne[1],
+      .sl_kv = k->ne[1],
+      .head_num_kv = k->ne[2],
+      .step_q_bs = q->nb[3] / esq,
+      .step_q_head_num = q->nb[2] / esq,
+      .step_q_sl = q->nb[1] / esq,
+      .step_k_bs = k->nb[3] / eskv,
+      .step_k_head_num = k->nb[2] / eskv,
+      .step_k_sl = k->nb[1] / eskv,
+      .step_v_bs = v->nb[3] / eskv,
+      .step_v_head_num = v->nb[2] / eskv,
+      .step_v_sl = v->nb[0] / eskv,
+      .step_v_hs = v->nb[1] / eskv,
+      .step_ks_bs = k_scale ? k_scale->nb[2] / sizeof(float) : 0,
+      .step_ks_head_num = k_scale ? k_scale->nb[0] / sizeof(float) : 0,
+      .step_ks_sl = k_scale ? k_scale->nb[1] / sizeof(float) : 0,
+      .step_vs_bs = v_scale ? v_scale->nb[2] / sizeof(float) : 0,
+      .step_vs_head_num = v_scale ? v_scale->nb[0] / sizeof(float) : 0,
+      .step_vs_sl = v_scale ? v_scale->nb[1] / sizeof(float) : 0,
+      .step_dst_bs = dst->nb[3] / sizeof(float),
+      .step_dst_head_num = dst->nb[1] / sizeof(float),
+      .step_dst_sl = dst->nb[2] / sizeof(float),
+  };
+  // every thread writes the partials of its KV chunks, then the partials of a row are merged by one thread
+  if (params->type == NE_TASK_COMPUTE) {
+    ne_attn_decode_forward(&args, params->ith, params->nth);
+  } else {
+    ne_attn_decode_reduce(&args, params->ith, params->nth);
+  }
+}
+
 // ne_compute_forward_flash_ff
 
 static void ne_compute_forward_flash_ff_f16(const struct ne_compute_params* params,
@@ -9051,6 +9831,9 @@ static void ne_compute_forward(struct ne_compute_params* params, struct ne_tenso
     case NE_OP_CPY: {
       ne_compute_forward_cpy(params, tensor->src0, tensor);
     } break;
+    case NE_OP_CPY_I8_SCALED: {
+      ne_compute_forward_cpy_i8_scaled(params, tensor->src0, tensor->opt[0], tensor);
+    } break;
     case NE_OP_CONT: {
       ne_compute_forward_cont(params, tensor->src0, tensor);
     } break;
@@ -9105,6 +9888,24 @@ static void ne_compute_forward(struct ne_compute_params* params, struct ne_tenso
     case NE_OP_FLASH_ATTN: {
       ne_compute_forward_flash_attn(params, tensor->src0, tensor->src1, tensor->opt[0], tensor->opt[1], tensor);
     } break;
+    case NE_OP_FLASH_ATTN_KV: {
+      ne_compute_forward_flash_attn_kv(params, tensor->src0, tensor->src1, tensor->opt[0], tensor->opt[1],
+                                       tensor->opt[2], tensor->opt[3], tensor);
+    } break;
+    case NE_OP_ROPE_KV: {
+      ne_compute_forward_rope_kv(params, tensor->src0, tensor->src1, tensor->opt[0], tensor->opt[1], tensor->opt[2],
+                                 tensor->opt[3], tensor->opt[4], tensor->opt[5], tensor);
+    } break;
+    case NE_OP_KV_SHIFT: {
+      ne_compute_forward_kv_shift(params, tensor->src0, tensor->src1, tensor->opt[0], tensor->opt[1], tensor->opt[2]);
+    } break;
+    case NE_OP_NORM_FUSED: {
+      ne_compute_forward_norm_fused(params, tensor->src0, tensor->src1, tensor->opt[0], tensor->opt[1], tensor->opt[2],
+                                    tensor);
+    } break;
+    case NE_OP_SCALE_MASK_SOFT_MAX: {
+      ne_compute_forward_scale_mask_soft_max(params, tensor->src0, tensor->src1, tensor);
+    } break;
     case NE_OP_FLASH_FF: {
       ne_compute_forward_flash_ff(params, tensor->src0, tensor->src1, tensor->opt[0], tensor->opt[1], tensor->opt[2],
                                   tensor);
@@ -9600,6 +10401,22 @@ static void ne_compute_backward(struct ne_context* ctx, struct ne_tensor* tensor
     case NE_OP_FLASH_ATTN: {
       NE_ASSERT(false);  // not supported
     } break;
+    case NE_OP_CPY_I8_SCALED: {
+      NE_ASSERT(false);  // not supported
+    } break;
+    case NE_OP_FLASH_ATTN_KV: {
+      NE_ASSERT(false);  // not supported
+    } break;
+    case NE_OP_ROPE_KV: {
+      NE_ASSERT(false);  // not supported
+    } break;
+    case NE_OP_KV_SHIFT: {
+      NE_ASSERT(false);  // not supported
+    } break;
+    case NE_OP_NORM_FUSED:
+    case NE_OP_SCALE_MASK_SOFT_MAX: {
+      NE_ASSERT(false);  // not supported
+    } break;
     case NE_OP_FLASH_FF: {
       NE_ASSERT(false);  // not supported
     } break;
@@ -9711,6 +10528,184 @@ struct ne_cgraph ne_build_forward(struct ne_tensor* tensor) {
   return result;
 }
 
+// ne_graph_fuse
+
+// the number of nodes after node i with t as a source, other than except, and the first of them in *first
+static int ne_graph_uses(const struct ne_cgraph* cgraph, int i, const struct ne_tensor* t,
+                         const struct ne_tensor* except, int* first) {
+  int n = 0;
+  *first = cgraph->n_nodes;
+  for (int j = i + 1; j < cgraph->n_nodes; j++) {
+    const struct ne_tensor* node = cgraph->nodes[j];
+    if (node == NULL || node == except) {
+      continue;
+    }
+    bool uses = node->src0 == t || node->src1 == t;
+    for (int k = 0; k < NE_MAX_OPT; k++) {
+      uses = uses || node->opt[k] == t;
+    }
+    if (uses) {
+      *first = MIN(*first, j);
+      n++;
+    }
+  }
+  return n;
+}
+
+// the index of the node t before node i, or -1
+static int ne_graph_index(const struct ne_cgraph* cgraph, int i, const struct ne_tensor* t) {
+  for (int j = i - 1; j >= 0; j--) {
+    if (cgraph->nodes[j] == t) {
+      return j;
+    }
+  }
+  return -1;
+}
+
+// node j is an op of the chain ending at node i, used by node i only
+static bool ne_graph_is_chained(const struct ne_cgraph* cgraph, int j, int i, enum ne_op op) {
+  int first;
+  return j >= 0 && cgraph->nodes[j]->op == op && cgraph->grads[j] == NULL &&
+         ne_graph_uses(cgraph, j, cgraph->nodes[j], NULL, &first) == 1 && first == i;
+}
+
+static bool ne_graph_is_norm(const struct ne_cgraph* cgraph, int j, int i) {
+  return ne_graph_is_chained(cgraph, j, i, NE_OP_NORM) || ne_graph_is_chained(cgraph, j, i, NE_OP_RMS_NORM);
+}
+
+// an f32 vector of a row of t, for the gain and bias of a norm
+static bool ne_is_row_of(const struct ne_tensor* v, const struct ne_tensor* t) {
+  return v->type == NE_TYPE_F32 && ne_is_contiguous(v) && v->ne[0] == t->ne[0] && ne_nelements(v) == t->ne[0];
+}
+
+static bool ne_is_f32_rows(const struct ne_tensor* t) { return t->type == NE_TYPE_F32 && t->nb[0] == sizeof(float); }
+
+// [add(a, b) ->] norm / rms_norm [-> mul(w)] [-> add(b)] into one NE_OP_NORM_FUSED in place of node i, the last one
+static bool ne_graph_fuse_norm(struct ne_cgraph* cgraph, int i) {
+  struct ne_tensor* node = cgraph->nodes[i];
+  int i_norm = i;
+  int i_mul = -1;
+  int i_add = -1;
+  int i_sum = -1;
+
+  if (node->op == NE_OP_ADD && ne_is_row_of(node->src1, node)) {
+    const int j = ne_graph_index(cgraph, i_norm, node->src0);
+    if (ne_graph_is_chained(cgraph, j, i_norm, NE_OP_MUL) || ne_graph_is_norm(cgraph, j, i_norm)) {
+      i_add = i_norm;
+      i_norm = j;
+    }
+  }
+  if (cgraph->nodes[i_norm]->op == NE_OP_MUL && ne_is_row_of(cgraph->nodes[i_norm]->src1, cgraph->nodes[i_norm])) {
+    const int j = ne_graph_index(cgraph, i_norm, cgraph->nodes[i_norm]->src0);
+    if (ne_graph_is_norm(cgraph, j, i_norm)) {
+      i_mul = i_norm;
+      i_norm = j;
+    }
+  }
+  struct ne_tensor* norm = cgraph->nodes[i_norm];
+  if ((norm->op != NE_OP_NORM && norm->op != NE_OP_RMS_NORM) || !ne_is_f32_rows(norm->src0)) {
+    return false;
+  }
+
+  // the residual add in front, when its other users all come after the fused node
+  struct ne_tensor* x = norm->src0;
+  const int j = ne_graph_index(cgraph, i_norm, x);
+  if (j >= 0 && x->op == NE_OP_ADD && cgraph->grads[j] == NULL && ne_is_f32_rows(x->src0) &&
+      ne_is_f32_rows(x->src1) && ne_are_same_shape(x->src0, x->src1)) {
+    int first;
+    ne_graph_uses(cgraph, j, x, norm, &first);
+    if (first > i) {
+      i_sum = j;
+    }
+  }
+  if (i_mul < 0 && i_add < 0 && i_sum < 0) {
+    return false;
+  }
+
+  // node is one of the chain
+  const bool rms = norm->op == NE_OP_RMS_NORM;
+  struct ne_tensor* w = i_mul >= 0 ? cgraph->nodes[i_mul]->src1 : NULL;
+  struct ne_tensor* b = i_add >= 0 ? cgraph->nodes[i_add]->src1 : NULL;
+  node->op = NE_OP_NORM_FUSED;
+  node->src0 = i_sum >= 0 ? x->src0 : x;
+  node->src1 = i_sum >= 0 ? x->src1 : NULL;
+  node->opt[0] = w;
+  node->opt[1] = b;
+  node->opt[2] = i_sum >= 0 ? x : NULL;
+  node->padding[0] = rms;
+
+  const int fused[] = {i_sum, i_norm, i_mul};
+  for (int k = 0; k < 3; k++) {
+    if (fused[k] >= 0 && fused[k] != i) {
+      cgraph->nodes[fused[k]] = NULL;
+    }
+  }
+  return true;
+}
+
+// [scale ->] [diag_mask_inf ->] soft_max into one NE_OP_SCALE_MASK_SOFT_MAX in place of the soft_max node i
+static bool ne_graph_fuse_soft_max(struct ne_cgraph* cgraph, int i) {
+  struct ne_tensor* node = cgraph->nodes[i];
+  int i_first = i;
+  int i_mask = -1;
+  int i_scale = -1;
+
+  int j = ne_graph_index(cgraph, i_first, node->src0);
+  if (ne_graph_is_chained(cgraph, j, i_first, NE_OP_DIAG_MASK_INF)) {
+    i_mask = i_first = j;
+    j = ne_graph_index(cgraph, i_first, cgraph->nodes[i_first]->src0);
+  }
+  if (ne_graph_is_chained(cgraph, j, i_first, NE_OP_SCALE)) {
+    i_scale = i_first = j;
+  }
+  struct ne_tensor* x = cgraph->nodes[i_first]->src0;
+  if (i_first == i || x->type != NE_TYPE_F32 || !ne_is_contiguous(x) || !ne_is_contiguous(node)) {
+    return false;
+  }
+
+  const int32_t n_past = i_mask >= 0 ? ((int32_t*)cgraph->nodes[i_mask]->src1->data)[0] : -1;
+  node->op = NE_OP_SCALE_MASK_SOFT_MAX;
+  node->src0 = x;
+  node->src1 = i_scale >= 0 ? cgraph->nodes[i_scale]->src1 : NULL;
+  memcpy(node->padding, &n_past, sizeof(n_past));
+
+  if (i_mask >= 0) {
+    cgraph->nodes[i_mask] = NULL;
+  }
+  if (i_scale >= 0) {
+    cgraph->nodes[i_scale] = NULL;
+  }
+  return true;
+}
+
+void ne_graph_fuse(struct ne_cgraph* cgraph) {
+  int n_fused = 0;
+  // from the end, so that a chain is matched from its last node
+  for (int i = cgraph->n_nodes - 1; i >= 0; i--) {
+    struct ne_tensor* node = cgraph->nodes[i];
+    if (node == NULL || cgraph->grads[i] != NULL) {
+      continue;
+    }
+    if (node->op == NE_OP_ADD || node->op == NE_OP_MUL || node->op == NE_OP_NORM || node->op == NE_OP_RMS_NORM) {
+      n_fused += ne_graph_fuse_norm(cgraph, i);
+    } else if (node->op == NE_OP_SOFT_MAX) {
+      n_fused += ne_graph_fuse_soft_max(cgraph, i);
+    }
+  }
+
+  // drop the nodes fused into others
+  int n = 0;
+  for (int i = 0; i < cgraph->n_nodes; i++) {
+    if (cgraph->nodes[i] != NULL) {
+      cgraph->nodes[n] = cgraph->nodes[i];
+      cgraph->grads[n] = cgraph->grads[i];
+      n++;
+    }
+  }
+  NE_PRINT_DEBUG("%s: fused %d chains, %d -> %d nodes\n", __func__, n_fused, cgraph->n_nodes, n);
+  cgraph->n_nodes = n;
+}
+
 struct ne_cgraph ne_build_backward(struct ne_context* ctx, struct ne_cgraph* gf, bool keep) {
   struct ne_cgraph result = *gf;
 
@@ -9812,6 +10807,176 @@ typedef pthread_t ne_thread_t;
 
 #endif
 
+//
+// graph trace
+//
+// chrome trace (chrome://tracing) of ne_graph_compute: one event per graph and per node on the main thread, with
+// nested events for the INIT / COMPUTE / FINALIZE phases and the barrier spin-waits on the thread that ran them.
+// enable by set env NE_TRACE=<file> or call ne_graph_trace_begin; the file is closed at exit or by ne_graph_trace_end.
+//
+
+enum ne_trace_phase {
+  NE_TRACE_INIT = NE_TASK_INIT,
+  NE_TRACE_COMPUTE = NE_TASK_COMPUTE,
+  NE_TRACE_FINALIZE = NE_TASK_FINALIZE,
+  NE_TRACE_WAIT,
+  NE_TRACE_NODE,
+};
+
+struct ne_trace_event {
+  const struct ne_tensor* node;
+  int i_node;  // only for NE_TRACE_NODE
+  int ith;
+  enum ne_trace_phase phase;
+  int64_t t_begin;
+  int64_t t_end;
+};
+
+// the events of one ne_graph_compute call, written to the file when it returns
+struct ne_trace_buffer {
+  struct ne_trace_event* events;
+  int n_max;
+  atomic_int n;
+};
+
+static struct {
+  FILE* file;
+  int64_t t_start;
+  int n_graphs;
+  bool has_events;
+  bool started;  // by ne_graph_trace_begin or NE_TRACE
+} g_trace = {NULL, 0, 0, false, false};
+
+void ne_graph_trace_end(void) {
+  ne_critical_section_start();
+  if (g_trace.file) {
+    fprintf(g_trace.file, "\n]}\n");
+    fclose(g_trace.file);
+    g_trace.file = NULL;
+  }
+  ne_critical_section_end();
+}
+
+bool ne_graph_trace_begin(const char* filename) {
+  ne_graph_trace_end();
+
+  FILE* file = fopen(filename, "w");
+  if (!file) {
+    NE_PRINT("%s: failed to open %s\n", __func__, filename);
+    return false;
+  }
+  fprintf(file, "{\"otherData\": {}, \"traceEvents\": [");
+
+  ne_critical_section_start();
+  static bool registered = false;
+  if (!registered) {
+    atexit(ne_graph_trace_end);
+    registered = true;
+  }
+  g_trace.file = file;
+  g_trace.t_start = ne_time_us();
+  g_trace.n_graphs = 0;
+  g_trace.has_events = false;
+  g_trace.started = true;
+  ne_critical_section_end();
+  return true;
+}
+
+static struct ne_trace_buffer* ne_trace_buffer_new(const struct ne_cgraph* cgraph, int n_threads) {
+  if (!g_trace.started) {
+    g_trace.started = true;
+    const char* filename = getenv("NE_TRACE");
+    if (filename) {
+      ne_graph_trace_begin(filename);
+    }
+  }
+  if (!g_trace.file) {
+    return NULL;
+  }
+  struct ne_trace_buffer* tb = malloc(sizeof(struct ne_trace_buffer));
+  // per node: the node, 3 phases and 4 barriers on the main thread, 2 phases and 2 waits on the others
+  tb->n_max = cgraph->n_nodes * (8 + 4 * (n_threads - 1));
+  tb->events = malloc(sizeof(struct ne_trace_event) * tb->n_max);
+  atomic_store(&tb->n, 0);
+  return tb;
+}
+
+static inline int64_t ne_trace_time(const struct ne_trace_buffer* tb) { return tb ? ne_time_us() : 0; }
+
+// record an event from t_begin to now, safe to call from any thread
+static inline void ne_trace_record(struct ne_trace_buffer* tb, const struct ne_tensor* node, int i_node, int ith,
+                                   enum ne_trace_phase phase, int64_t t_begin) {
+  if (!tb) {
+    return;
+  }
+  const int64_t t_end = ne_time_us();
+  const int i = atomic_fetch_add(&tb->n, 1);
+  if (i < tb->n_max) {
+    tb->events[i] = (struct ne_trace_event){node, i_node, ith, phase, t_begin, t_end};
+  }
+}
+
+// write the common fields of an event, the caller adds the args and closes it
+static void ne_trace_write(const char* name, const char* cat, int ith, int64_t t_begin, int64_t t_end) {
+  fprintf(g_trace.file,
+          "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%" PRId64 ",\"dur\":%" PRId64,
+          g_trace.has_events ? "," : "", name, cat, ith, t_begin - g_trace.t_start, t_end - t_begin);
+  g_trace.has_events = true;
+}
+
+static void ne_trace_buffer_flush(struct ne_trace_buffer* tb, const struct ne_cgraph* cgraph, int n_threads,
+                                  int64_t t_begin) {
+  static const char* phase_name[] = {"INIT", "COMPUTE", "FINALIZE", "spin_wait"};
+  const int64_t t_end = ne_time_us();
+
+  ne_critical_section_start();
+  if (g_trace.file) {
+    ne_trace_write("graph", "graph", 0, t_begin, t_end);
+    fprintf(g_trace.file, ",\"args\":{\"graph\":%d,\"n_nodes\":%d,\"n_threads\":%d}}", g_trace.n_graphs++,
+            cgraph->n_nodes, n_threads);
+
+    const int n = MIN(atomic_load(&tb->n), tb->n_max);
+    for (int i = 0; i < n; i++) {
+      const struct ne_trace_event* e = &tb->events[i];
+      const struct ne_tensor* node = e->node;
+      if (e->phase != NE_TRACE_NODE && e->phase != NE_TRACE_COMPUTE && e->t_end == e->t_begin) {
+        continue;  // no-op INIT / FINALIZE or a barrier that did not spin
+      }
+      if (e->phase != NE_TRACE_NODE) {
+        ne_trace_write(phase_name[e->phase], e->phase == NE_TRACE_WAIT ? "wait" : "phase", e->ith, e->t_begin,
+                       e->t_end);
+        fprintf(g_trace.file, ",\"args\":{\"op\":\"%s\"}}", NE_OP_LABEL[node->op]);
+        continue;
+      }
+
+      // bytes of the result and all sources
+      size_t bytes = ne_nbytes(node);
+      bytes += node->src0 ? ne_nbytes(node->src0) : 0;
+      bytes += node->src1 ? ne_nbytes(node->src1) : 0;
+      for (int k = 0; k < NE_MAX_OPT; k++) {
+        bytes += node->opt[k] ? ne_nbytes(node->opt[k]) : 0;
+      }
+      ne_trace_write(NE_OP_LABEL[node->op], "node", 0, e->t_begin, e->t_end);
+      fprintf(g_trace.file, ",\"args\":{\"node\":%d,\"name\":\"", e->i_node);
+      for (const char* c = node->name; *c && c < node->name + sizeof(node->name); c++) {
+        if (*c >= ' ' && *c != '"' && *c != '\\') {
+          fputc(*c, g_trace.file);
+        }
+      }
+      fprintf(g_trace.file, "\",\"type\":\"%s\",\"ne\":[%" PRId64 ",%" PRId64 ",%" PRId64 ",%" PRId64
+              "],\"n_tasks\":%d,\"bytes\":%zu}}",
+              NE_TYPE_NAME[node->type], node->ne[0], node->ne[1], node->ne[2], node->ne[3], node->n_tasks, bytes);
+    }
+    if (atomic_load(&tb->n) > tb->n_max) {
+      NE_PRINT("%s: %d trace events dropped\n", __func__, atomic_load(&tb->n) - tb->n_max);
+    }
+  }
+  ne_critical_section_end();
+
+  free(tb->events);
+  free(tb);
+}
+
 struct ne_compute_state_shared {
   ne_lock_t spin;
 
@@ -9821,6 +10986,8 @@ struct ne_compute_state_shared {
   atomic_int n_ready;
   atomic_bool has_work;
   atomic_bool stop;  // stop all threads
+
+  struct ne_trace_buffer* trace;  // NULL unless tracing
 };
 
 struct ne_compute_state {
@@ -9836,8 +11003,11 @@ static thread_ret_t ne_graph_compute_thread(void* data) {
   struct ne_compute_state* state = (struct ne_compute_state*)data;
 
   const int n_threads = state->shared->n_threads;
+  struct ne_trace_buffer* trace = state->shared->trace;
 
   while (true) {
+    const int64_t t_wait = ne_trace_time(trace);
+
     if (atomic_fetch_add(&state->shared->n_ready, 1) == n_threads - 1) {
       atomic_store(&state->shared->has_work, false);
     } else {
@@ -9867,8 +11037,11 @@ static thread_ret_t ne_graph_compute_thread(void* data) {
     }
 
     if (state->node) {
+      ne_trace_record(trace, state->node, -1, state->params.ith, NE_TRACE_WAIT, t_wait);
       if (state->params.ith < state->params.nth) {
+        const int64_t t_begin = ne_trace_time(trace);
         ne_compute_forward(&state->params, state->node);
+        ne_trace_record(trace, state->node, -1, state->params.ith, (enum ne_trace_phase)state->params.type, t_begin);
       }
 
       state->node = NULL;
@@ -9880,6 +11053,20 @@ static thread_ret_t ne_graph_compute_thread(void* data) {
   return 0;
 }
 
+// minimum cost of the share of a row-parallel op of each thread, with the cost of a plain elementwise op as 1 per
+// element. a smaller op does not pay for the barriers of the thread pool around it, so most ops at decode run on the
+// main thread alone, back to back without any barrier in between. That is all there is to the fused execution of
+// small nodes: it covers the nodes that end up with n_tasks == 1, consecutive nodes with more tasks are not batched
+// and each still has its own wakeup and barriers.
+#define NE_TASK_MIN_COST (16 * 1024)
+
+// the number of threads for a node whose kernel splits the rows of src0, costing cost_per_element per element
+static int ne_graph_n_tasks(const struct ne_tensor* node, int n_threads, int cost_per_element) {
+  const int64_t cost = ne_nelements(node->src0) * cost_per_element;
+  const int64_t n_tasks = MIN(MIN(n_threads, ne_nrows(node->src0)), cost / NE_TASK_MIN_COST);
+  return (int)MAX(1, n_tasks);
+}
+
 void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph) {
   int n_threads = cgraph->n_threads;
 
@@ -9889,6 +11076,7 @@ void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph) {
       /*.n_ready   =*/0,
       /*.has_work  =*/false,
       /*.stop      =*/false,
+      /*.trace     =*/ne_trace_buffer_new(cgraph, n_threads),
   };
   struct ne_compute_state* workers = n_threads > 1 ? alloca(sizeof(struct ne_compute_state) * (n_threads - 1)) : NULL;
 #ifndef _OPENMP
@@ -9919,7 +11107,7 @@ void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph) {
     }
   }
 #else
-  n_threads = jblas_set_threads(n_threads);  // prevent from using two sockets
+  n_threads = jblas_set_threads(n_threads);  // the jblas thread team, pinned by NUMA node when the gemms are split
   omp_set_num_threads(n_threads);
 #endif
   // initialize tasks + work buffer
@@ -9931,8 +11119,11 @@ void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph) {
       struct ne_tensor* node = cgraph->nodes[i];
 
       switch (node->op) {
+        case NE_OP_CPY_I8_SCALED: {
+          node->n_tasks = ne_graph_n_tasks(node, n_threads, 2);
+        } break;
         case NE_OP_CPY: {
-          node->n_tasks = n_threads;  // node->ne[0] == 1 ? n_threads : 1;
+          node->n_tasks = ne_graph_n_tasks(node, n_threads, 1);
           size_t cur = 0;
           if (ne_is_quantized(node->type)) {
             cur = NE_TYPE_SIZE[NE_TYPE_F32] * node->ne[0] * n_threads;
@@ -9940,7 +11131,7 @@ void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph) {
           work_size = MAX(work_size, cur);
         } break;
         case NE_OP_DUP: {
-          node->n_tasks = n_threads;
+          node->n_tasks = ne_graph_n_tasks(node, n_threads, 1);
 
           size_t cur = 0;
           if (ne_is_quantized(node->type)) {
@@ -9951,11 +11142,7 @@ void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph) {
         } break;
         case NE_OP_ADD:
         case NE_OP_ADD1: {
-          if (node->src0->ne[1] > 4) {
-            node->n_tasks = n_threads;
-          } else {
-            node->n_tasks = 1;
-          }
+          node->n_tasks = ne_graph_n_tasks(node, n_threads, 1);
 
           size_t cur = 0;
 
@@ -9989,19 +11176,20 @@ void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph) {
         case NE_OP_SGN:
         case NE_OP_NEG:
         case NE_OP_STEP:
-        case NE_OP_MUL:
-        case NE_OP_RMS_NORM:
         case NE_OP_RELU: {
-          if (node->src0->ne[1] > 4) {
-            node->n_tasks = n_threads;
-          } else {
-            node->n_tasks = 1;
-          }
+          // single threaded kernels
+          node->n_tasks = 1;
+        } break;
+        case NE_OP_MUL: {
+          node->n_tasks = ne_graph_n_tasks(node, n_threads, 1);
         } break;
         case NE_OP_GELU:
         case NE_OP_SILU:
-        case NE_OP_SILU_BACK:
         case NE_OP_NORM:
+        case NE_OP_RMS_NORM: {
+          node->n_tasks = ne_graph_n_tasks(node, n_threads, 4);
+        } break;
+        case NE_OP_SILU_BACK:
         case NE_OP_RMS_NORM_BACK: {
           node->n_tasks = n_threads;
         } break;
@@ -10042,7 +11230,7 @@ void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph) {
           node->n_tasks = 1;
         } break;
         case NE_OP_SCALE: {
-          node->n_tasks = 1;
+          node->n_tasks = ne_graph_n_tasks(node, n_threads, 1);
         } break;
         case NE_OP_SET:
         case NE_OP_CONT:
@@ -10056,17 +11244,14 @@ void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph) {
         case NE_OP_DIAG_MASK_ZERO: {
           node->n_tasks = 1;
         } break;
-        case NE_OP_DIAG_MASK_INF:
-        case NE_OP_ROPE:
-          if (node->src0->ne[1] > 4) {
-            node->n_tasks = n_threads;
-          } else {
-            node->n_tasks = 1;
-          }
-          break;
+        case NE_OP_DIAG_MASK_INF: {
+          node->n_tasks = ne_graph_n_tasks(node, n_threads, 1);
+        } break;
+        case NE_OP_ROPE: {
+          node->n_tasks = ne_graph_n_tasks(node, n_threads, 8);
+        } break;
         case NE_OP_SOFT_MAX: {
-          size_t rows = ne_nrows(node->src0);
-          node->n_tasks = rows > 1 ? n_threads : 1;
+          node->n_tasks = ne_graph_n_tasks(node, n_threads, 4);
         } break;
         case NE_OP_ROPE_BACK: {
           node->n_tasks = n_threads;
@@ -10101,8 +11286,31 @@ void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph) {
           work_size = MAX(work_size, cur);
         } break;
         case NE_OP_FLASH_ATTN: {
+          // the workspace is a tensor of the node
           node->n_tasks = 1;
-          work_size = 0LL;
+        } break;
+        case NE_OP_FLASH_ATTN_KV: {
+          node->n_tasks = n_threads;
+          const struct ne_tensor* q = node->src0;
+          attn_shape_t atte_shape = {q->ne[3], q->ne[2], q->ne[0], q->ne[1], node->src1->ne[1]};
+          work_size = MAX(work_size, ne_attn_decode_workspace_size(&atte_shape, node->n_tasks));
+        } break;
+        case NE_OP_ROPE_KV: {
+          // rotates Q and K and stores K and V, counted on Q
+          node->n_tasks = ne_graph_n_tasks(node, n_threads, 16);
+          // the cos/sin table and a row of K of each thread
+          const size_t cur = sizeof(float) * (2 * node->src0->ne[0] + CACHE_LINE_SIZE_F32) * node->n_tasks;
+          work_size = MAX(work_size, cur);
+        } break;
+        case NE_OP_KV_SHIFT: {
+          node->n_tasks = n_threads;
+          // the cos/sin table and a row of K of each thread
+          const size_t cur = sizeof(float) * (2 * node->src0->ne[0] + CACHE_LINE_SIZE_F32) * node->n_tasks;
+          work_size = MAX(work_size, cur);
+        } break;
+        case NE_OP_NORM_FUSED:
+        case NE_OP_SCALE_MASK_SOFT_MAX: {
+          node->n_tasks = ne_graph_n_tasks(node, n_threads, 6);
         } break;
         case NE_OP_FLASH_FF: {
           node->n_tasks = n_threads;
@@ -10148,6 +11356,8 @@ void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph) {
 
   const int64_t perf_start_cycles = ne_perf_cycles();
   const int64_t perf_start_time_us = ne_perf_time_us();
+  struct ne_trace_buffer* trace = state_shared.trace;
+  const int64_t trace_start = ne_trace_time(trace);
 
   for (int i = 0; i < cgraph->n_nodes; i++) {
     NE_PRINT_DEBUG_5("%s: %d/%d\n", __func__, i, cgraph->n_nodes);
@@ -10161,6 +11371,8 @@ void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph) {
 
     const int64_t perf_node_start_cycles = ne_perf_cycles();
     const int64_t perf_node_start_time_us = ne_perf_time_us();
+    const int64_t trace_node_start = ne_trace_time(trace);
+    int64_t t_trace = trace_node_start;
 #if NE_DEBUG
     jblas_timer(true);
 #endif
@@ -10175,9 +11387,11 @@ void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph) {
     };
 
     ne_compute_forward(&params, node);
+    ne_trace_record(trace, node, -1, 0, NE_TRACE_INIT, t_trace);
 
     // COMPUTE
     if (node->n_tasks > 1) {
+      t_trace = ne_trace_time(trace);
       if (atomic_fetch_add(&state_shared.n_ready, 1) == n_threads - 1) {
         atomic_store(&state_shared.has_work, false);
       }
@@ -10207,13 +11421,17 @@ void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph) {
       }
 
       atomic_store(&state_shared.has_work, true);
+      ne_trace_record(trace, node, -1, 0, NE_TRACE_WAIT, t_trace);
     }
 
     params.type = NE_TASK_COMPUTE;
+    t_trace = ne_trace_time(trace);
     ne_compute_forward(&params, node);
+    ne_trace_record(trace, node, -1, 0, NE_TRACE_COMPUTE, t_trace);
 
     // wait for thread pool
     if (node->n_tasks > 1) {
+      t_trace = ne_trace_time(trace);
       if (atomic_fetch_add(&state_shared.n_ready, 1) == n_threads - 1) {
         atomic_store(&state_shared.has_work, false);
       }
@@ -10229,9 +11447,11 @@ void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph) {
         ne_lock_lock(&state_shared.spin);
         ne_lock_unlock(&state_shared.spin);
       }
+      ne_trace_record(trace, node, -1, 0, NE_TRACE_WAIT, t_trace);
     }
     // FINALIZE
     if (node->n_tasks > 1) {
+      t_trace = ne_trace_time(trace);
       if (atomic_fetch_add(&state_shared.n_ready, 1) == n_threads - 1) {
         atomic_store(&state_shared.has_work, false);
       }
@@ -10261,13 +11481,17 @@ void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph) {
       }
 
       atomic_store(&state_shared.has_work, true);
+      ne_trace_record(trace, node, -1, 0, NE_TRACE_WAIT, t_trace);
     }
 
     params.type = NE_TASK_FINALIZE;
+    t_trace = ne_trace_time(trace);
     ne_compute_forward(&params, node);
+    ne_trace_record(trace, node, -1, 0, NE_TRACE_FINALIZE, t_trace);
 
     // wait for thread pool
     if (node->n_tasks > 1) {
+      t_trace = ne_trace_time(trace);
       if (atomic_fetch_add(&state_shared.n_ready, 1) == n_threads - 1) {
         atomic_store(&state_shared.has_work, false);
       }
@@ -10283,6 +11507,7 @@ void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph) {
         ne_lock_lock(&state_shared.spin);
         ne_lock_unlock(&state_shared.spin);
       }
+      ne_trace_record(trace, node, -1, 0, NE_TRACE_WAIT, t_trace);
     }
 #else
     // INIT
@@ -10294,30 +11519,45 @@ void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph) {
         /*.wdata =*/cgraph->work ? cgraph->work->data : NULL,
     };
     ne_compute_forward(&params, node);
+    ne_trace_record(trace, node, -1, 0, NE_TRACE_INIT, t_trace);
     if (node->n_tasks == 1) {
       params.type = NE_TASK_COMPUTE;
+      t_trace = ne_trace_time(trace);
       ne_compute_forward(&params, node);
+      ne_trace_record(trace, node, -1, 0, NE_TRACE_COMPUTE, t_trace);
       params.type = NE_TASK_FINALIZE;
+      t_trace = ne_trace_time(trace);
       ne_compute_forward(&params, node);
+      ne_trace_record(trace, node, -1, 0, NE_TRACE_FINALIZE, t_trace);
 
     } else {
-#pragma omp parallel
+      // only the n_tasks threads of the node join the region, the runtime may still hand out fewer of them, then a
+      // thread takes several of the tasks
+#pragma omp parallel num_threads(node->n_tasks)
       {
+        const int tid = omp_get_thread_num();
+        const int n_team = omp_get_num_threads();
         struct ne_compute_params params = {
             /*.type  =*/NE_TASK_COMPUTE,
-            /*.ith   =*/omp_get_thread_num(),
+            /*.ith   =*/tid,
             /*.nth   =*/node->n_tasks,
             /*.wsize =*/cgraph->work ? ne_nbytes(cgraph->work) : 0,
             /*.wdata =*/cgraph->work ? cgraph->work->data : NULL,
         };
-        if (params.ith < node->n_tasks) {
+        int64_t t_phase = ne_trace_time(trace);
+        for (params.ith = tid; params.ith < node->n_tasks; params.ith += n_team) {
           ne_compute_forward(&params, node);
         }
+        ne_trace_record(trace, node, -1, tid, NE_TRACE_COMPUTE, t_phase);
+        t_phase = ne_trace_time(trace);
 #pragma omp barrier
+        ne_trace_record(trace, node, -1, tid, NE_TRACE_WAIT, t_phase);
         params.type = NE_TASK_FINALIZE;
-        if (params.ith < node->n_tasks) {
+        t_phase = ne_trace_time(trace);
+        for (params.ith = tid; params.ith < node->n_tasks; params.ith += n_team) {
           ne_compute_forward(&params, node);
         }
+        ne_trace_record(trace, node, -1, tid, NE_TRACE_FINALIZE, t_phase);
       }
     }
 
@@ -10335,6 +11575,7 @@ void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph) {
       node->perf_cycles += perf_cycles_cur;
       node->perf_time_us += perf_time_us_cur;
     }
+    ne_trace_record(trace, node, i, 0, NE_TRACE_NODE, trace_node_start);
   }
 
   // join thread pool
@@ -10352,6 +11593,9 @@ void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph) {
     ne_lock_destroy(&state_shared.spin);
   }
 #endif
+  if (trace) {
+    ne_trace_buffer_flush(trace, cgraph, n_threads, trace_start);
+  }
 
   // performance stats (graph)
   {
@@ -11477,3 +12721,118 @@ int ne_cpu_has_sse3(void) {
 int ne_cpu_has_vsx(void) { return 0; }
 
 ////////////////////////////////////////////////////////////////////////////////
+
+#ifdef NE_TESTS
+// ne_graph_fuse: every chain is computed with and without the pass, the fused nodes must give the same bits
+
+static bool return_success = true;
+
+// deterministic values in [-1, 1)
+static void ne_test_fill(struct ne_tensor* t, uint32_t seed) {
+  float* data = (float*)t->data;
+  for (int64_t i = 0; i < ne_nelements(t); i++) {
+    seed = seed * 1664525u + 1013904223u;
+    data[i] = (float)(seed >> 8) / (float)(1 << 23) - 1.f;
+  }
+}
+
+static struct ne_tensor* ne_test_new_f32(struct ne_context* ctx, int64_t ne0, int64_t ne1, uint32_t seed) {
+  struct ne_tensor* t = ne_new_tensor_2d(ctx, NE_TYPE_F32, ne0, ne1, NE_SIZE_CALC);
+  ne_test_fill(t, seed);
+  return t;
+}
+
+// norm -> mul -> add
+static struct ne_tensor* ne_test_norm_mul_add(struct ne_context* ctx) {
+  struct ne_tensor* x = ne_test_new_f32(ctx, 100, 7, 1);
+  struct ne_tensor* w = ne_test_new_f32(ctx, 100, 1, 2);
+  struct ne_tensor* b = ne_test_new_f32(ctx, 100, 1, 3);
+  return ne_add(ctx, ne_mul(ctx, ne_norm(ctx, x), w), b);
+}
+
+// rms_norm -> mul
+static struct ne_tensor* ne_test_rms_norm_mul(struct ne_context* ctx) {
+  struct ne_tensor* x = ne_test_new_f32(ctx, 100, 7, 4);
+  struct ne_tensor* w = ne_test_new_f32(ctx, 100, 1, 5);
+  return ne_mul(ctx, ne_rms_norm(ctx, x), w);
+}
+
+// add -> rms_norm, the residual sum has no other user
+static struct ne_tensor* ne_test_add_rms_norm(struct ne_context* ctx) {
+  struct ne_tensor* x = ne_test_new_f32(ctx, 100, 7, 6);
+  struct ne_tensor* y = ne_test_new_f32(ctx, 100, 7, 7);
+  return ne_rms_norm(ctx, ne_add(ctx, x, y));
+}
+
+// add -> norm -> mul -> add, the residual sum is also added to the output so the fused node must still store it
+static struct ne_tensor* ne_test_residual(struct ne_context* ctx) {
+  struct ne_tensor* x = ne_test_new_f32(ctx, 100, 7, 8);
+  struct ne_tensor* y = ne_test_new_f32(ctx, 100, 7, 9);
+  struct ne_tensor* w = ne_test_new_f32(ctx, 100, 1, 10);
+  struct ne_tensor* b = ne_test_new_f32(ctx, 100, 1, 11);
+  struct ne_tensor* sum = ne_add(ctx, x, y);
+  return ne_add(ctx, sum, ne_add(ctx, ne_mul(ctx, ne_norm(ctx, sum), w), b));
+}
+
+// scale -> diag_mask_inf -> soft_max
+static struct ne_tensor* ne_test_scale_mask_soft_max(struct ne_context* ctx) {
+  struct ne_tensor* kq = ne_new_tensor_3d(ctx, NE_TYPE_F32, 37, 5, 3, NE_SIZE_CALC);
+  ne_test_fill(kq, 12);
+  return ne_soft_max(ctx, ne_diag_mask_inf(ctx, ne_scale(ctx, kq, ne_new_f32(ctx, 0.125f)), 32));
+}
+
+// scale -> soft_max
+static struct ne_tensor* ne_test_scale_soft_max(struct ne_context* ctx) {
+  struct ne_tensor* kq = ne_test_new_f32(ctx, 37, 15, 13);
+  return ne_soft_max(ctx, ne_scale(ctx, kq, ne_new_f32(ctx, 0.125f)));
+}
+
+// n_fused is the number of nodes left by the pass
+static bool ne_test_fuse(const char* name, struct ne_tensor* (*build)(struct ne_context*), int n_fused, int n_threads) {
+  printf("Test case : %s n_threads_%d\n", name, n_threads);
+  void* out[2] = {NULL, NULL};
+  int n_nodes[2] = {0, 0};
+  size_t size = 0;
+  for (int fuse = 0; fuse < 2; fuse++) {
+    struct ne_init_params params = {/*.mem_size =*/16 * 1024 * 1024, /*.mem_buffer =*/NULL, /*.no_alloc =*/false};
+    struct ne_context* ctx = ne_init(params);
+    struct ne_tensor* y = build(ctx);
+    struct ne_cgraph gf = ne_build_forward(y);
+    gf.n_threads = n_threads;
+    if (fuse) {
+      ne_graph_fuse(&gf);
+    }
+    n_nodes[fuse] = gf.n_nodes;
+    ne_graph_compute(ctx, &gf);
+    size = ne_nbytes(y);
+    out[fuse] = malloc(size);
+    memcpy(out[fuse], y->data, size);
+    ne_free(ctx);
+  }
+  bool ok = n_nodes[1] == n_fused;
+  if (!ok) {
+    printf("%d nodes fused into %d, expected %d\n", n_nodes[0], n_nodes[1], n_fused);
+  } else if (memcmp(out[0], out[1], size) != 0) {
+    printf("mismatch of the fused graph\n");
+    ok = false;
+  }
+  free(out[0]);
+  free(out[1]);
+  return ok;
+}
+
+int main() {
+  printf("Test suit: ne_graph_fuse\n");
+  for (int n_threads = 1; n_threads <= 4; n_threads += 3) {
+    return_success &= ne_test_fuse("norm_mul_add", ne_test_norm_mul_add, 1, n_threads);
+    return_success &= ne_test_fuse("rms_norm_mul", ne_test_rms_norm_mul, 1, n_threads);
+    return_success &= ne_test_fuse("add_rms_norm", ne_test_add_rms_norm, 1, n_threads);
+    return_success &= ne_test_fuse("residual_with_other_user", ne_test_residual, 2, n_threads);
+    return_success &= ne_test_fuse("scale_mask_soft_max", ne_test_scale_mask_soft_max, 1, n_threads);
+    return_success &= ne_test_fuse("scale_soft_max", ne_test_scale_soft_max, 1, n_threads);
+  }
+  printf("NE_TESTS: ne_layers ");
+  printf(return_success ? "OK\n" : "FAILED\n");
+  return return_success ? 0 : -1;
+}
+#endif
@@ -47,7 +47,7 @@
 #define NE_MAX_NODES 4096
 #define NE_MAX_PARAMS 256
 #define NE_MAX_CONTEXTS 64
-#define NE_MAX_OPT 4
+#define NE_MAX_OPT 6
 #define NE_DEFAULT_N_THREADS 4
 
 #define NE_ASSERT(x)                                                     \
@@ -276,6 +276,13 @@ NE_API struct ne_tensor* ne_set_2d_inplace(struct ne_context* ctx, struct ne_ten
 // a -> b, return view(b)
 NE_API struct ne_tensor* ne_cpy(struct ne_context* ctx, struct ne_tensor* a, struct ne_tensor* b);
 
+// quantize(a) -> b, return view(b)
+// a is f32 and b is i8 of the same shape, each row of a (ne[0] values, e.g. a head of a token) is quantized with
+// its own absmax scale, written to b_scale, an f32 tensor of shape [a->ne[1], a->ne[2], a->ne[3]]
+// b and b_scale may be non-contiguous views, e.g. of a transposed KV cache
+NE_API struct ne_tensor* ne_cpy_i8_scaled(struct ne_context* ctx, struct ne_tensor* a, struct ne_tensor* b,
+                                          struct ne_tensor* b_scale);
+
 // make contiguous
 NE_API struct ne_tensor* ne_cont(struct ne_context* ctx, struct ne_tensor* a);
 
@@ -354,6 +361,26 @@ NE_API struct ne_tensor* ne_rope(struct ne_context* ctx, struct ne_tensor* a, in
 // in-place, returns view(a)
 NE_API struct ne_tensor* ne_rope_inplace(struct ne_context* ctx, struct ne_tensor* a, int n_past, int n_dims, int mode);
 
+// rotary position embedding of q and k as ne_rope_inplace (no rotation if n_dims is 0), and k and v stored into the
+// KV cache in one pass, returns view(q)
+// q: [head_size, n_head, N, batch], k and v: [head_size, n_head_kv, N, batch], all f32
+// k_cache: the destination of k, of the same shape; v_cache: the transposed destination of v, [N, head_size,
+// n_head_kv, batch]; both f32, f16 or i8 views of the cache with any strides
+// k_scale, v_scale: [n_head_kv, N, batch] f32 scales of the i8 rows as ne_cpy_i8_scaled, NULL otherwise
+NE_API struct ne_tensor* ne_rope_kv(struct ne_context* ctx, struct ne_tensor* q, struct ne_tensor* k,
+                                    struct ne_tensor* v, struct ne_tensor* k_cache, struct ne_tensor* v_cache,
+                                    struct ne_tensor* k_scale, struct ne_tensor* v_scale, int n_past, int n_dims,
+                                    int mode);
+
+// evicts the tokens [n_keep, n_keep + n_discard) of the first n_past tokens of a KV cache, the tokens after them move
+// n_discard positions down and their K, rotated by ne_rope_kv with n_dims and mode, are rotated to the new positions;
+// updates the cache in place and returns view(k_cache)
+// k_cache: [head_size, n_head_kv, n_ctx, n_seq], v_cache: the transposed [n_ctx, head_size, n_head_kv, n_seq] with
+// contiguous rows, f32, f16 or i8; k_scale, v_scale: [n_head_kv, n_ctx, n_seq] f32 scales of an i8 cache, or NULL
+NE_API struct ne_tensor* ne_kv_shift(struct ne_context* ctx, struct ne_tensor* k_cache, struct ne_tensor* v_cache,
+                                     struct ne_tensor* k_scale, struct ne_tensor* v_scale, int n_past, int n_keep,
+                                     int n_discard, int n_dims, int mode);
+
 // rotary position embedding backward, i.e compute dx from dy
 // a - dy
 NE_API struct ne_tensor* ne_rope_back(struct ne_context* ctx, struct ne_tensor* a, int n_past, int n_dims, int mode);
@@ -377,6 +404,17 @@ NE_API struct ne_tensor* ne_conv_1d_2s(struct ne_context* ctx, struct ne_tensor*
 NE_API struct ne_tensor* ne_flash_attn(struct ne_context* ctx, struct ne_tensor* q, struct ne_tensor* k,
                                        struct ne_tensor* v, float scale, bool masked);
 
+// attention of the current tokens over the KV cache, for the next-token phase
+// q: [head_size, seq_cur, head_num, batch] f32, k: [head_size, seq_all, head_num_kv, batch] f16 / i8
+// v: [seq_all, head_size, head_num_kv, batch] f16 / i8, either dimension may be the contiguous one
+// head_num_kv divides head_num, query heads share the KV heads in groups
+// k_scale / v_scale: [head_num_kv, seq_all, batch] f32 scales of i8 K / V, NULL for f16
+// alibi_max_bias: the ALiBi biases of ne_alibi are added to the scores if > 0, without a score tensor
+// the result is [head_size, head_num, seq_cur, batch] f32
+NE_API struct ne_tensor* ne_flash_attn_kv(struct ne_context* ctx, struct ne_tensor* q, struct ne_tensor* k,
+                                          struct ne_tensor* v, struct ne_tensor* k_scale, struct ne_tensor* v_scale,
+                                          float scale, bool masked, float alibi_max_bias);
+
 NE_API struct ne_tensor* ne_flash_ff(struct ne_context* ctx, struct ne_tensor* a, struct ne_tensor* b0,
                                      struct ne_tensor* b1, struct ne_tensor* c0, struct ne_tensor* c1);
 
@@ -401,6 +439,10 @@ NE_API struct ne_cgraph ne_build_forward(struct ne_tensor* tensor);
 NE_API struct ne_cgraph ne_build_backward(struct ne_context* ctx, struct ne_cgraph* gf, bool keep);
 
 NE_API void ne_graph_compute(struct ne_context* ctx, struct ne_cgraph* cgraph);
+
+// rewrite the chains of small ops of a forward graph into single nodes with one pass over the data:
+// [x + y ->] norm / rms_norm [-> * w] [-> + b] and [scale ->] [diag_mask_inf ->] soft_max
+NE_API void ne_graph_fuse(struct ne_cgraph* cgraph);
 NE_API void ne_graph_reset(struct ne_cgraph* cgraph);
 
 // print info and performance information for the graph
@@ -409,6 +451,12 @@ NE_API void ne_graph_print(const struct ne_cgraph* cgraph);
 // profiling the performance information for each kernel in graph, enable by set env ENGINE_PROFILING = 1
 NE_API void ne_graph_profiling(const struct ne_cgraph* cgraph);
 
+// write a chrome trace (chrome://tracing) of every following ne_graph_compute into filename: per node and thread the
+// INIT / COMPUTE / FINALIZE phases, the spin-wait at the barriers and the bytes of the node and its sources.
+// enable without code changes by set env NE_TRACE=<file>, the file is completed at exit or by ne_graph_trace_end.
+NE_API bool ne_graph_trace_begin(const char* filename);
+NE_API void ne_graph_trace_end(void);
+
 // dump the graph into a file using the dot format
 NE_API void ne_graph_dump_dot(const struct ne_cgraph* gb, const struct ne_cgraph* gf, const char* filename);
 
@@ -57,6 +57,7 @@ enum JBLAS_ELTWISEOP {
   LOW_PRECISION_EXP,
   RELU,
   LINEAR,
+  GELU_ERF,
 };
 
 void jblas_sgemm(const JBLAS_LAYOUT Layout, const JBLAS_TRANSPOSE TransA, const JBLAS_TRANSPOSE TransB, const int M,
@@ -68,6 +68,43 @@ class AccumulatorWriteBackWithGelu {
   }
 };
 
+// C = act(acc)
+template <JBLAS_ELTWISEOP OP>
+class AccumulatorWriteBackActFp32 {
+ public:
+  struct Param {
+    float* C;
+    int ldc;
+  };
+
+  template <JBLAS_ISA ISA_T>
+  JBLAS_CODE forward(const float* cacheptr, const int cachestep, const int M_offset, const int N_offset, const int M,
+                     const int N, const Param& _param) {
+    auto cptr = _param.C + M_offset * _param.ldc + N_offset;
+    return kernel::wrapper::BiasActF32F32<OP>::template forward<ISA_T>(cacheptr, cachestep, nullptr, 0, cptr,
+                                                                       _param.ldc, M, N);
+  }
+};
+
+// C = act(acc + D), D is a bias row if ldd is 0
+template <JBLAS_ELTWISEOP OP>
+class AddActProcessFp32 {
+ public:
+  struct Param {
+    float *C, *D;
+    int ldc, ldd;
+  };
+
+  template <JBLAS_ISA ISA_T>
+  JBLAS_CODE forward(const float* cacheptr, const int cachestep, const int M_offset, const int N_offset, const int M,
+                     const int N, const Param& _param) {
+    auto cptr = _param.C + M_offset * _param.ldc + N_offset;
+    auto dptr = _param.D + M_offset * _param.ldd + N_offset;
+    return kernel::wrapper::BiasActF32F32<OP>::template forward<ISA_T>(cacheptr, cachestep, dptr, _param.ldd, cptr,
+                                                                       _param.ldc, M, N);
+  }
+};
+
 class AlphaBetaProcessFp32 {
  public:
   struct Param {
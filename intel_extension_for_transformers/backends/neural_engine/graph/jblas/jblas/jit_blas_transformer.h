@@ -229,6 +229,12 @@ using QKVGemm = jblas::wrapper::transformer::QKVGemmInterfacePackWeight<
         jblas::prologue::gemm::ActivationBase,  // activation fp32->bf16
         jblas::prologue::weight_comp::gemm::WeightS4_KBlock, jblas::epilogue::gemm::AccumulatorWriteBack<float, float>>,
     jblas::utils::parallel::Parallel2DGemm>;
+using QKVGemmF8 = jblas::wrapper::transformer::QKVGemmInterfacePackWeight<
+    jblas::wrapper::gemm_pack_weight::GemmLauncherPackWeight<
+        DefaultISA, jblas::gemm::GemmCore_Row_NN_8x48_AVX512F,
+        jblas::prologue::gemm::ActivationBase,  // activation fp32->bf16
+        jblas::prologue::weight_comp::gemm::WeightF8_KBlock, jblas::epilogue::gemm::AccumulatorWriteBack<float, float>>,
+    jblas::utils::parallel::Parallel2DGemm>;
 }  // namespace avx512_f
 namespace amx_bf16 {
 static JBLAS_ISA constexpr DefaultISA = JblasAMX_BF16;
@@ -238,6 +244,12 @@ using QKVGemm = jblas::wrapper::transformer::QKVGemmInterfacePackWeight<
         jblas::prologue::gemm::ActivationConverterFp32,  // activation fp32->bf16
         jblas::prologue::weight_comp::gemm::WeightS4_KBlock, jblas::epilogue::gemm::AccumulatorWriteBack<float, float>>,
     jblas::utils::parallel::Parallel2DGemm>;
+using QKVGemmF8 = jblas::wrapper::transformer::QKVGemmInterfacePackWeight<
+    jblas::wrapper::gemm_pack_weight::GemmLauncherPackWeight<
+        DefaultISA, jblas::gemm::GemmCore_Row_NN_16x64_AMX_BF16,
+        jblas::prologue::gemm::ActivationConverterFp32,  // activation fp32->bf16
+        jblas::prologue::weight_comp::gemm::WeightF8_KBlock, jblas::epilogue::gemm::AccumulatorWriteBack<float, float>>,
+    jblas::utils::parallel::Parallel2DGemm>;
 }  // namespace amx_bf16
 }  // namespace weight_comp
 }  // namespace transformer_default
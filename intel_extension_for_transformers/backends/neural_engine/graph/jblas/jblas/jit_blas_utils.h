@@ -192,6 +192,30 @@ struct fp4x2 : bit4x2 {
   fp4x2() : bit4x2() {}
 };
 
+// 8-bit float without inf, 1 sign bit : EBits exponent : MBits mantissa. The code shifted into the fp32 bit
+// positions is a valid fp32 (subnormals included) scaled by 2^(Bias - 127), so decoding is a shift and a multiply.
+template <int EBits, int MBits, uint8_t MaxCode>
+struct fp8_base {
+  static int constexpr Shift = 23 - MBits;
+  static int constexpr Rebias = 127 - ((1 << (EBits - 1)) - 1);
+  static inline float rebias() { return bit_cast<float>(uint32_t(127 + Rebias) << 23); }
+  static inline float max() { return decode(MaxCode); }
+
+  static inline float decode(uint8_t v) {
+    return bit_cast<float>(uint32_t(v & 0x80) << 24 | uint32_t(v & 0x7f) << Shift) * rebias();
+  }
+
+  // round-to-nearest-even, saturate to the max finite value
+  static inline uint8_t encode(float v) {
+    const uint32_t sign = bit_cast<uint32_t>(v) >> 24 & 0x80;
+    uint32_t u = bit_cast<uint32_t>(std::abs(v) * bit_cast<float>(uint32_t(127 - Rebias) << 23));
+    u = (u + (1u << (Shift - 1)) - 1 + (u >> Shift & 1)) >> Shift;
+    return uint8_t(sign | (u > MaxCode ? MaxCode : u));
+  }
+};
+using fp8_e4m3 = fp8_base<4, 3, 0x7e>;  // max 448, 0x7f is NaN
+using fp8_e5m2 = fp8_base<5, 2, 0x7b>;  // max 57344, 0x7c is inf
+
 #ifndef _WIN32
 #include <err.h>
 #include <errno.h>
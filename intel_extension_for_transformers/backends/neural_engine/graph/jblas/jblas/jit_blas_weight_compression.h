@@ -29,6 +29,8 @@ enum class WeightCompType : int {
   S8_F32,
   S4_F32,
   S4_Bf16,
+  F8E4M3_F32,
+  F8E5M2_F32,
 };
 
 class PackedWeightS4F32 : public prologue::weight_comp::PackedWeightKBlock {
@@ -275,6 +277,88 @@ class PackedWeightS8F32 : public prologue::weight_comp::PackedWeightKBlock {
   utils::aligned_vector<float> mScales;
 };
 
+// fp8 weight (E4M3 or E5M2 by mType) with f32 per-block scales
+class PackedWeightF8F32 : public prologue::weight_comp::PackedWeightKBlock {
+ public:
+  PackedWeightF8F32(jblas::gemm::GemmCoreType _type, WeightCompType _wtype) : PackedWeightKBlock(_type) {
+    mWPtr = NULL;
+    mWSize = 0;
+    mSPtr = NULL;
+    mSSize = 0;
+    mBlockSize = 0;
+    mType = static_cast<int>(_wtype);
+  }
+
+  void resize(int NPad, int KPad, int Block) {
+    mNPad = NPad;
+    mKPad = KPad;
+    mWeights.resize((size_t)NPad * KPad);
+    mBlockSize = Block;
+    int nk_scale = utils::updiv(KPad, Block);
+    mScales.resize(nk_scale * NPad);
+    mWPtr = mWeights.data();
+    mWSize = mWeights.size();
+    mSPtr = mScales.data();
+    mSSize = mScales.size();
+  }
+
+  uint8_t* mWPtr;
+  size_t mWSize;
+  float* mSPtr;
+  size_t mSSize;
+
+ protected:
+  virtual size_t getDataSerializedSize() override {
+    size_t totalsize = 0;
+    totalsize += sizeof(mBlockSize);
+    totalsize += sizeof(mWSize);
+    totalsize += mWSize * sizeof(mWPtr[0]);
+    totalsize += sizeof(mSSize);
+    totalsize += mSSize * sizeof(mSPtr[0]);
+    return totalsize;
+  }
+  virtual void serializeDataToBuffer(void* buf) override {
+    auto wptr = reinterpret_cast<int8_t*>(buf);
+    utils::serialize(wptr, mBlockSize);
+    utils::serialize(wptr, mWSize);
+    for (size_t i = 0; i < mWSize; i++) {
+      utils::serialize(wptr, mWPtr[i]);
+    }
+    utils::serialize(wptr, mSSize);
+    for (size_t i = 0; i < mSSize; i++) {
+      utils::serialize(wptr, mSPtr[i]);
+    }
+  }
+  virtual void deserializeDataBuffer(void* buf, int memalloc) override {
+    auto rptr = reinterpret_cast<int8_t*>(buf);
+    mBlockSize = utils::deserialize<int>(rptr);
+    size_t rsize = utils::deserialize<size_t>(rptr);
+    if (memalloc) {
+      mWeights.resize(rsize);
+      std::memcpy(mWeights.data(), rptr, rsize * sizeof(mWeights[0]));
+      mWPtr = mWeights.data();
+      mWSize = mWeights.size();
+    } else {
+      mWPtr = (uint8_t*)rptr;
+      mWSize = rsize;
+    }
+    rptr += rsize * sizeof(mWeights[0]);
+    rsize = utils::deserialize<size_t>(rptr);
+    if (memalloc) {
+      mScales.resize(rsize);
+      std::memcpy(mScales.data(), rptr, rsize * sizeof(mScales[0]));
+      mSPtr = mScales.data();
+      mSSize = mScales.size();
+    } else {
+      mSPtr = (float*)rptr;
+      mSSize = rsize;
+    }
+    rptr += rsize * sizeof(mScales[0]);
+  }
+  utils::aligned_vector<uint8_t> mWeights;
+  utils::aligned_vector<float> mScales;
+};
+
 template <class _GemmCore_T, JBLAS_ISA ISA_T>
 class WeightS8_KBlock {
  public:
@@ -442,6 +526,11 @@ class CompressedPackedWeight {
       ptr->deserializeBuffer(rptr, memalloc);
       return ptr;
     }
+    if (type == WeightCompType::F8E4M3_F32 || type == WeightCompType::F8E5M2_F32) {
+      auto ptr = new PackedWeightF8F32(jblas::gemm::GemmCoreType::Undef, type);
+      ptr->deserializeBuffer(rptr, memalloc);
+      return ptr;
+    }
     return NULL;
   }
 };
@@ -758,6 +847,63 @@ class WeightS4_KBlock : public WeightBit4_KBlock<_GemmCore_T, ISA_T> {
     kernel::wrapper::QuantizeS8RowBlock::forward<ISA_T>(srcptr, dstptr, row, col, ld_src, ld_dst, scales, blocksize);
   }
 
+  // from packed int4 weight of _SrcCore_T to KxN int8 weight(int4 value<<4) and nk_scale x N f32 scales
+  template <class _SrcCore_T>
+  JBLAS_CODE unpackWeight(const int N, const int K, const PackedWeight* ptr, int8_t* B, const int ldb,
+                          float* scales) {
+    auto kptr = dynamic_cast<const PackedWeightKBlock*>(ptr);
+    if (kptr == NULL || kptr->mNPad < N || kptr->mKPad < K) {
+      return JblasInvalidParam;
+    }
+    const utils::int4x2* wptr = NULL;
+    int nk_scale = utils::updiv(K, kptr->mBlockSize);
+    if (auto f32ptr = dynamic_cast<const PackedWeightS4F32*>(ptr)) {
+      wptr = f32ptr->mWPtr;
+      for (int i = 0; i < nk_scale; i++) {
+        std::memcpy(scales + i * N, f32ptr->mSPtr + i * f32ptr->mNPad, N * sizeof(scales[0]));
+      }
+    } else if (auto bf16ptr = dynamic_cast<const PackedWeightS4Bf16*>(ptr)) {
+      wptr = bf16ptr->mWPtr;
+      for (int i = 0; i < nk_scale; i++) {
+        for (int j = 0; j < N; j++) {
+          scales[i * N + j] = bf16ptr->mSPtr[i * bf16ptr->mNPad + j].tofloat();
+        }
+      }
+    } else {
+      return JblasInvalidParam;
+    }
+    constexpr int NTile = _SrcCore_T::NTILE, PackRow = _SrcCore_T::PACK_ROW;
+    const int KPad = kptr->mKPad;
+#pragma omp parallel for
+    for (int in = 0; in < N; in += NTile) {
+      for (int k = 0; k < K; k++) {
+        for (int jn = in; jn < N && jn < in + NTile; jn++) {
+          // N/NTile x KPad/PackRow x NTile x PackRow
+          size_t idx = (size_t)in * KPad + k / PackRow * NTile * PackRow + (jn - in) * PackRow + k % PackRow;
+          auto tmp = wptr[idx / 2];
+          B[k * ldb + jn] = (idx % 2 == 0 ? tmp.x : tmp.y) << 4;
+        }
+      }
+    }
+    return JblasSuccess;
+  }
+
+  // re-layout an int4 weight packed for _SrcCore_T to this gemm core, the int4 values and scales are unchanged
+  template <class _SrcCore_T>
+  PackedWeight* repackWeight(const int N, const int K, const PackedWeight* ptr, WeightCompType type) {
+    auto kptr = dynamic_cast<const PackedWeightKBlock*>(ptr);
+    if (kptr == NULL) {
+      return NULL;
+    }
+    int blocksize = kptr->mBlockSize;
+    utils::aligned_vector<int8_t> quanW((size_t)N * K);
+    utils::aligned_vector<float> scales((size_t)utils::updiv(K, blocksize) * N);
+    if (unpackWeight<_SrcCore_T>(N, K, ptr, quanW.data(), N, scales.data()) != JblasSuccess) {
+      return NULL;
+    }
+    return this->compressWeight(N, K, quanW.data(), N, scales.data(), blocksize, type);
+  }
+
   void DecompressKblockF32DstF32Scale(utils::bit4x2* srcptr, float* dstptr, int row, int col, int ld_src, int ld_dst,
                                       float* scales, int k_offset, int kblock, int NPad) override {
     kernel::wrapper::DecompressKBlockS4FP<float>::forward<ISA_T, float>(
@@ -823,6 +969,172 @@ class WeightFp4_KBlock : public WeightBit4_KBlock<_GemmCore_T, ISA_T> {
   }
 };
 
+template <class _GemmCore_T, JBLAS_ISA ISA_T>
+class WeightF8_KBlock {
+ public:
+  struct Param {
+    const prologue::PackedWeight* packedW;
+  };
+
+  void quantizeWeight(const int N, const int K, const float* B, const int ldb, int blocksize, uint8_t* qB,
+                      float* scales, WeightCompType type) {
+    utils::parallel::Parallel2DRowMajor _para;
+    utils::CpuBase cb;
+    _para.update(K, N, blocksize, 16, cb.mNumThreads);
+    omp_set_num_threads(cb.mNumThreads);
+#pragma omp parallel
+    {
+      int tidx = omp_get_thread_num();
+      int colidx, rowidx, rowsize, colsize;
+      _para.getIndex(tidx, &rowidx, &colidx, &rowsize, &colsize);
+      if (rowsize > 0 && colsize > 0) {
+        int rowremain = utils::remainsize(rowidx, K,
+                                          rowsize);  // rowremain: src valid size. rowsize: padded size
+        int colremain = utils::remainsize(colidx, N, colsize);
+        if (type == WeightCompType::F8E5M2_F32) {
+          kernel::wrapper::QuantizeF8RowBlock<utils::fp8_e5m2>::template forward<ISA_T>(
+              B + rowidx * ldb + colidx, qB + rowidx * N + colidx, rowremain, colremain, ldb, N,
+              scales + rowidx / blocksize * N + colidx, blocksize);
+        } else {
+          kernel::wrapper::QuantizeF8RowBlock<utils::fp8_e4m3>::template forward<ISA_T>(
+              B + rowidx * ldb + colidx, qB + rowidx * N + colidx, rowremain, colremain, ldb, N,
+              scales + rowidx / blocksize * N + colidx, blocksize);
+        }
+      }
+    }
+  }
+
+  void transposeWeight(const int N, const int K, const float* src, const int ld_src, float* dst, const int ld_dst) {
+    utils::parallel::Parallel2DRowMajor _para;
+    utils::CpuBase cb;
+    _para.update(N, K, 16, 16, cb.mNumThreads);
+    omp_set_num_threads(cb.mNumThreads);
+#pragma omp parallel
+    {
+      int tidx = omp_get_thread_num();
+      int colidx, rowidx, rowsize, colsize;
+      _para.getIndex(tidx, &rowidx, &colidx, &rowsize, &colsize);
+      if (rowsize > 0 && colsize > 0) {
+        int rowremain = utils::remainsize(rowidx, N,
+                                          rowsize);  // rowremain: src valid size. rowsize: padded size
+        int colremain = utils::remainsize(colidx, K, colsize);
+        kernel::wrapper::Transpose2D<float>::forward<ISA_T>(
+            src + rowidx * ld_src + colidx, dst + rowidx + colidx * ld_dst, rowremain, colremain, ld_src, ld_dst);
+      }
+    }
+  }
+
+  // from KxN fp8 codes to packed N//NtilexKPadxNTile fp8 weight
+  PackedWeight* compressWeight(const int N, const int K, const uint8_t* B, const int ldb, const float* scales,
+                               int blocksize, WeightCompType type) {
+    if (type != WeightCompType::F8E4M3_F32 && type != WeightCompType::F8E5M2_F32) {
+      return NULL;
+    }
+    int KPad = utils::padto(K, _GemmCore_T::KTILE);
+    int NPad = utils::padto(N, _GemmCore_T::NTILE);
+    int nk_scale = utils::updiv(KPad, blocksize);
+    auto ptr = new PackedWeightF8F32(_GemmCore_T::TYPE, type);
+    ptr->resize(NPad, KPad, blocksize);
+#pragma omp parallel for
+    for (int i = 0; i < nk_scale; i++) {
+      std::memcpy(ptr->mSPtr + i * NPad, scales + i * N, N * sizeof(scales[0]));
+    }
+    reorderCompress(N, K, B, ldb, scales, ptr->mWPtr, blocksize);
+    return ptr;
+  }
+
+  void reorderCompress(const int N, const int K, const uint8_t* B, const int ldb, const float* scales, uint8_t* dstptr,
+                       int blocksize) {
+    utils::parallel::Parallel2DRowMajor _para;
+    utils::CpuBase cb;
+    _para.update(K, N, _GemmCore_T::KTILE, _GemmCore_T::NTILE, cb.mNumThreads);
+    int KPad = utils::padto(K, _GemmCore_T::KTILE);
+    omp_set_num_threads(cb.mNumThreads);
+#pragma omp parallel
+    {
+      int tidx = omp_get_thread_num();
+      int colidx, rowidx, rowsize, colsize;
+      _para.getIndex(tidx, &rowidx, &colidx, &rowsize, &colsize);
+      if (rowsize > 0 && colsize > 0) {
+        int rowremain = utils::remainsize(rowidx, K,
+                                          rowsize);  // rowremain: src valid size. rowsize: padded size
+        int colremain = utils::remainsize(colidx, N, colsize);
+        auto ret = kernel::wrapper::PaddingInterleaveMN<_GemmCore_T::NTILE, sizeof(B[0]), _GemmCore_T::PACK_ROW>::
+            template forward<ISA_T>((void*)(B + rowidx * ldb + colidx),
+                                    dstptr + rowidx * _GemmCore_T::NTILE + colidx * KPad, rowremain, colremain, rowsize,
+                                    colsize, ldb * sizeof(B[0]), KPad * sizeof(dstptr[0]));
+        assert(ret == JblasSuccess);
+      }
+    }
+  }
+
+  PackedWeight* compressWeightTranspose(const int N, const int K, const float* B, const int ldb, int blocksize,
+                                        WeightCompType type) {
+    utils::aligned_vector<float> B_NT(N * K);
+    transposeWeight(N, K, B, ldb, B_NT.data(), N);
+    return compressWeight(N, K, B_NT.data(), N, blocksize, type);
+  }
+
+  PackedWeight* compressWeight(const int N, const int K, const float* B, const int ldb, int blocksize,
+                               WeightCompType type) {
+    int nk_scale = utils::updiv(K, blocksize);
+    utils::aligned_vector<uint8_t> quanW(N * K);
+    utils::aligned_vector<float> scales(nk_scale * N);
+    quantizeWeight(N, K, B, ldb, blocksize, quanW.data(), scales.data(), type);
+    return compressWeight(N, K, quanW.data(), N, scales.data(), blocksize, type);
+  }
+
+  template <typename _T>
+  inline JBLAS_CODE getWeight(_T** dstptr, int* dststep, int k_size, int n_size, int k_offset, int n_offset,
+                              const PackedWeight* ptr) {
+    return JblasNotSupport;
+  }
+
+  inline JBLAS_CODE getWeight(float** dstptr, int* dststep, int k_size, int n_size, int k_offset, int n_offset,
+                              const PackedWeight* ptr) {
+    static_assert(_GemmCore_T::PACK_ROW == 1);  // float PackRow==1
+    return decompressWeight(*dstptr, dststep, k_size, n_size, k_offset, n_offset, ptr);
+  }
+
+  inline JBLAS_CODE getWeight(utils::bf16** dstptr, int* dststep, int k_size, int n_size, int k_offset, int n_offset,
+                              const PackedWeight* ptr) {
+    static_assert(_GemmCore_T::PACK_ROW == 2);  // bf16 PackRow==2
+    return decompressWeight(*dstptr, dststep, k_size, n_size, k_offset, n_offset, ptr);
+  }
+
+ protected:
+  // decode in registers straight into the gemm's B cache, the weight stays 1 byte per element in memory
+  template <typename _DST_T>
+  JBLAS_CODE decompressWeight(_DST_T* dstptr, int* dststep, int k_size, int n_size, int k_offset, int n_offset,
+                              const PackedWeight* ptr) {
+    auto wptr = dynamic_cast<const PackedWeightF8F32*>(ptr);
+    if (wptr == NULL) {
+      return JblasInvalidParam;
+    }
+    constexpr int NTile = _GemmCore_T::NTILE, PackRow = _GemmCore_T::PACK_ROW;
+    auto NPad = wptr->mNPad;
+    auto KPad = wptr->mKPad;
+    auto bptr = wptr->mWPtr + n_offset * KPad + k_offset * NTile;
+    for (int i = 0; i < n_size; i += NTile) {
+      JBLAS_CODE ret;
+      if (wptr->mType == static_cast<int>(WeightCompType::F8E5M2_F32)) {
+        ret = kernel::wrapper::DecompressKBlockF8FP<_DST_T>::template forward<ISA_T, utils::fp8_e5m2>(
+            bptr + i * KPad, dstptr + i * k_size, k_size / PackRow, NTile * PackRow, NTile * PackRow,
+            NTile * PackRow, wptr->mSPtr + n_offset + i, k_offset / PackRow, wptr->mBlockSize / PackRow, NPad);
+      } else {
+        ret = kernel::wrapper::DecompressKBlockF8FP<_DST_T>::template forward<ISA_T, utils::fp8_e4m3>(
+            bptr + i * KPad, dstptr + i * k_size, k_size / PackRow, NTile * PackRow, NTile * PackRow,
+            NTile * PackRow, wptr->mSPtr + n_offset + i, k_offset / PackRow, wptr->mBlockSize / PackRow, NPad);
+      }
+      if (ret != JblasSuccess) {
+        return ret;
+      }
+    }
+    *dststep = k_size;
+    return JblasSuccess;
+  }
+};
+
 }  // namespace gemm
 }  // namespace weight_comp
 }  // namespace prologue
@@ -1115,6 +1427,11 @@ using GemmKernelS8KBlock = jblas::wrapper::gemm_pack_weight::GemmInterfacePackWe
         DefaultISA, jblas::gemm::GemmCore_Row_NN_8x48_AVX512F, jblas::prologue::gemm::ActivationBase,
         jblas::prologue::weight_comp::gemm::WeightS8_KBlock, jblas::epilogue::gemm::AlphaBetaProcessFp32>,
     DefaultParallel>;
+using GemmKernelF8KBlock = jblas::wrapper::gemm_pack_weight::GemmInterfacePackWeight<
+    jblas::wrapper::gemm_pack_weight::GemmLauncherPackWeight<
+        DefaultISA, jblas::gemm::GemmCore_Row_NN_8x48_AVX512F, jblas::prologue::gemm::ActivationBase,
+        jblas::prologue::weight_comp::gemm::WeightF8_KBlock, jblas::epilogue::gemm::AlphaBetaProcessFp32>,
+    DefaultParallel>;
 }  // namespace avx512f
 namespace avx512_vnni {
 JBLAS_ISA constexpr DefaultISA = JblasAVX512_VNNI;
@@ -1153,6 +1470,13 @@ using GemmKernelFp4KBlock = jblas::wrapper::gemm_pack_weight::GemmInterfacePackW
         jblas::prologue::weight_comp::gemm::WeightFp4_KBlock,
         jblas::epilogue::gemm::AccumulatorWriteBack<float, float>>,  // output fp32->fp32
     DefaultParallel>;
+using GemmKernelF8KBlock = jblas::wrapper::gemm_pack_weight::GemmInterfacePackWeight<
+    jblas::wrapper::gemm_pack_weight::GemmLauncherPackWeight<
+        DefaultISA, jblas::gemm::GemmCore_Row_NN_16x64_AMX_BF16,
+        jblas::prologue::gemm::ActivationConverterFp32,  // activation fp32->bf16
+        jblas::prologue::weight_comp::gemm::WeightF8_KBlock,
+        jblas::epilogue::gemm::AccumulatorWriteBack<float, float>>,  // output fp32->fp32
+    DefaultParallel>;
 }  // namespace amx_bf16
 namespace amx_int8 {
 JBLAS_ISA constexpr DefaultISA = JblasAMX_INT8;
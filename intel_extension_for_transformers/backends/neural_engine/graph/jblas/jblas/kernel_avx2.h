@@ -178,6 +178,89 @@ static inline JBLAS_CODE alphabeta_f32_f32(const float alpha, const float* srcpt
   }
   return JblasSuccess;
 }
+
+// exp with the cephes polynomial, max relative error ~2e-7
+static inline __m256 exp_ps(__m256 x) {
+  x = _mm256_min_ps(x, _mm256_set1_ps(88.f));
+  x = _mm256_max_ps(x, _mm256_set1_ps(-87.3365478515625f));
+  auto fx = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504088896341f)),
+                            _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  x = _mm256_fnmadd_ps(fx, _mm256_set1_ps(0.693359375f), x);
+  x = _mm256_fnmadd_ps(fx, _mm256_set1_ps(-2.12194440e-4f), x);
+  auto y = _mm256_set1_ps(1.9875691500E-4f);
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.3981999507E-3f));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(8.3334519073E-3f));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(4.1665795894E-2f));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.6666665459E-1f));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(5.0000001201E-1f));
+  y = _mm256_fmadd_ps(y, _mm256_mul_ps(x, x), _mm256_add_ps(x, _mm256_set1_ps(1.f)));
+  // 2^n, n is in [-126, 127]
+  auto pow2n = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(fx), _mm256_set1_epi32(127)), 23);
+  return _mm256_mul_ps(y, _mm256_castsi256_ps(pow2n));
+}
+
+// erf by Abramowitz-Stegun 7.1.26, max absolute error 1.5e-7
+static inline __m256 erf_ps(__m256 x) {
+  auto vsign = _mm256_and_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(0x80000000)));
+  auto vabs = _mm256_andnot_ps(vsign, x);
+  auto t = _mm256_div_ps(_mm256_set1_ps(1.f), _mm256_fmadd_ps(vabs, _mm256_set1_ps(0.3275911f), _mm256_set1_ps(1.f)));
+  auto y = _mm256_set1_ps(1.061405429f);
+  y = _mm256_fmadd_ps(y, t, _mm256_set1_ps(-1.453152027f));
+  y = _mm256_fmadd_ps(y, t, _mm256_set1_ps(1.421413741f));
+  y = _mm256_fmadd_ps(y, t, _mm256_set1_ps(-0.284496736f));
+  y = _mm256_fmadd_ps(y, t, _mm256_set1_ps(0.254829592f));
+  y = _mm256_mul_ps(y, t);
+  auto e = exp_ps(_mm256_mul_ps(vabs, _mm256_sub_ps(_mm256_setzero_ps(), vabs)));
+  y = _mm256_fnmadd_ps(y, e, _mm256_set1_ps(1.f));
+  return _mm256_or_ps(y, vsign);
+}
+
+template <JBLAS_ELTWISEOP OP>
+static inline __m256 eltwise_ps(__m256 x) {
+  static_assert(OP == GELU || OP == GELU_ERF || OP == SWISH, "Unsupported eltwise op.");
+  if (OP == SWISH) {
+    // x * sigmoid(x)
+    auto e = exp_ps(_mm256_sub_ps(_mm256_setzero_ps(), x));
+    return _mm256_div_ps(x, _mm256_add_ps(e, _mm256_set1_ps(1.f)));
+  }
+  if (OP == GELU) {
+    // 0.5x(1+tanh(z)) == x * sigmoid(2z), z = sqrt(2/pi)(x+0.044715x^3)
+    auto x2 = _mm256_mul_ps(x, x);
+    auto z = _mm256_fmadd_ps(x2, _mm256_set1_ps(-0.0713548162726f), _mm256_set1_ps(-1.59576912161f));
+    auto e = exp_ps(_mm256_mul_ps(z, x));
+    return _mm256_div_ps(x, _mm256_add_ps(e, _mm256_set1_ps(1.f)));
+  }
+  // 0.5x(1+erf(x/sqrt(2)))
+  auto y = erf_ps(_mm256_mul_ps(x, _mm256_set1_ps(0.707106781186547524f)));
+  return _mm256_mul_ps(_mm256_mul_ps(x, _mm256_set1_ps(0.5f)), _mm256_add_ps(y, _mm256_set1_ps(1.f)));
+}
+
+template <JBLAS_ELTWISEOP OP>
+static inline JBLAS_CODE bias_act_f32_f32(const float* srcptr, const int srcstep, const float* biasptr,
+                                          const int biasstep, float* dstptr, const int dststep, const int M,
+                                          const int N) {
+  int constexpr Vlen = 8;
+  auto vN = utils::padto_le(N, Vlen);
+  auto tailmask = _mm256_cmpgt_epi32(_mm256_set1_epi32(N - vN), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+  for (int i = 0; i < M; i++) {
+    int j = 0;
+    for (; j < vN; j += Vlen) {
+      auto vsrc = _mm256_loadu_ps(srcptr + i * srcstep + j);
+      if (biasptr != nullptr) {
+        vsrc = _mm256_add_ps(vsrc, _mm256_loadu_ps(biasptr + i * biasstep + j));
+      }
+      _mm256_storeu_ps(dstptr + i * dststep + j, eltwise_ps<OP>(vsrc));
+    }
+    if (j < N) {
+      auto vsrc = _mm256_maskload_ps(srcptr + i * srcstep + j, tailmask);
+      if (biasptr != nullptr) {
+        vsrc = _mm256_add_ps(vsrc, _mm256_maskload_ps(biasptr + i * biasstep + j, tailmask));
+      }
+      _mm256_maskstore_ps(dstptr + i * dststep + j, tailmask, eltwise_ps<OP>(vsrc));
+    }
+  }
+  return JblasSuccess;
+}
 #endif
 }  // namespace avx2
 }  // namespace kernel
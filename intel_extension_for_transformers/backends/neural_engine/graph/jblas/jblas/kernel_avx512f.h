@@ -331,6 +331,44 @@ static inline JBLAS_CODE decompress_kblock_fp4_fp(utils::fp4x2* srcptr, _DST_T*
   return JblasNotSupport;
 }
 
+template <typename _F8_T, typename _DST_T>
+static inline JBLAS_CODE decompress_kblock_f8_fp(uint8_t* srcptr, _DST_T* dstptr, int row, int col, int ld_src,
+                                                 int ld_dst, float* scales, int k_offset, int kblock, int NPad) {
+  int constexpr VLen = 16;
+  // float rowpack==1, bf16 rowpack==2: a column pair shares one scale
+  int constexpr PackRow = std::is_same<_DST_T, utils::bf16>::value ? 2 : 1;
+  if (col % VLen != 0) {
+    return JblasNotSupport;
+  }
+  auto vsign = _mm512_set1_epi32(0x80);
+  auto vmag = _mm512_set1_epi32(0x7f);
+  auto vrebias = _mm512_set1_ps(_F8_T::rebias());
+  auto vdupidx = _mm512_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7);
+  for (int i = 0; i < row; i++) {
+    auto sptr = scales + (k_offset + i) / kblock * NPad;
+    for (int j = 0; j < col; j += VLen) {
+      __m512 vscale;
+      if (PackRow == 1) {
+        vscale = _mm512_loadu_ps(sptr + j);
+      } else {
+        vscale = _mm512_permutexvar_ps(vdupidx, _mm512_castps256_ps512(_mm256_loadu_ps(sptr + j / 2)));
+      }
+      // fp8 sign and exponent:mantissa moved to the fp32 bit positions, then rebias the exponent by the multiply
+      auto vsrc = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(srcptr + i * ld_src + j)));
+      auto vbits = _mm512_or_si512(_mm512_slli_epi32(_mm512_and_si512(vsrc, vsign), 24),
+                                   _mm512_slli_epi32(_mm512_and_si512(vsrc, vmag), _F8_T::Shift));
+      auto fzmm = _mm512_mul_ps(_mm512_castsi512_ps(vbits), _mm512_mul_ps(vscale, vrebias));
+      if (std::is_same<_DST_T, float>::value) {
+        _mm512_storeu_ps((float*)dstptr + i * ld_dst + j, fzmm);
+      } else {
+        auto bf16_v = _mm512_cvtepi32_epi16(_mm512_bsrli_epi128(_mm512_castps_si512(fzmm), 2));
+        _mm256_storeu_si256((__m256i*)(dstptr + i * ld_dst + j), bf16_v);
+      }
+    }
+  }
+  return JblasSuccess;
+}
+
 static inline JBLAS_CODE decompress_s4_s8(utils::int4x2* srcptr, int8_t* dstptr, int row, int col, int ld_src,
                                           int ld_dst) {
   uint32_t mask = 0xf0f0f0f0;
@@ -520,6 +558,80 @@ static inline JBLAS_CODE alphabeta_f32_f32(const float alpha, const float* srcpt
   return JblasSuccess;
 }
 
+// exp with the cephes polynomial, max relative error ~2e-7
+static inline __m512 exp_ps(__m512 x) {
+  x = _mm512_min_ps(x, _mm512_set1_ps(88.3762626647949f));
+  x = _mm512_max_ps(x, _mm512_set1_ps(-88.3762626647949f));
+  auto fx = _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(1.44269504088896341f)),
+                                 _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  x = _mm512_fnmadd_ps(fx, _mm512_set1_ps(0.693359375f), x);
+  x = _mm512_fnmadd_ps(fx, _mm512_set1_ps(-2.12194440e-4f), x);
+  auto y = _mm512_set1_ps(1.9875691500E-4f);
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(1.3981999507E-3f));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(8.3334519073E-3f));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(4.1665795894E-2f));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(1.6666665459E-1f));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(5.0000001201E-1f));
+  y = _mm512_fmadd_ps(y, _mm512_mul_ps(x, x), _mm512_add_ps(x, _mm512_set1_ps(1.f)));
+  return _mm512_scalef_ps(y, fx);
+}
+
+// erf by Abramowitz-Stegun 7.1.26, max absolute error 1.5e-7
+static inline __m512 erf_ps(__m512 x) {
+  auto vsign = _mm512_and_epi32(_mm512_castps_si512(x), _mm512_set1_epi32(0x80000000));
+  auto vabs = _mm512_abs_ps(x);
+  auto t = _mm512_div_ps(_mm512_set1_ps(1.f), _mm512_fmadd_ps(vabs, _mm512_set1_ps(0.3275911f), _mm512_set1_ps(1.f)));
+  auto y = _mm512_set1_ps(1.061405429f);
+  y = _mm512_fmadd_ps(y, t, _mm512_set1_ps(-1.453152027f));
+  y = _mm512_fmadd_ps(y, t, _mm512_set1_ps(1.421413741f));
+  y = _mm512_fmadd_ps(y, t, _mm512_set1_ps(-0.284496736f));
+  y = _mm512_fmadd_ps(y, t, _mm512_set1_ps(0.254829592f));
+  y = _mm512_mul_ps(y, t);
+  auto e = exp_ps(_mm512_mul_ps(vabs, _mm512_sub_ps(_mm512_setzero_ps(), vabs)));
+  y = _mm512_fnmadd_ps(y, e, _mm512_set1_ps(1.f));
+  return _mm512_castsi512_ps(_mm512_or_epi32(_mm512_castps_si512(y), vsign));
+}
+
+template <JBLAS_ELTWISEOP OP>
+static inline __m512 eltwise_ps(__m512 x) {
+  static_assert(OP == GELU || OP == GELU_ERF || OP == SWISH, "Unsupported eltwise op.");
+  if (OP == SWISH) {
+    // x * sigmoid(x)
+    auto e = exp_ps(_mm512_sub_ps(_mm512_setzero_ps(), x));
+    return _mm512_div_ps(x, _mm512_add_ps(e, _mm512_set1_ps(1.f)));
+  }
+  if (OP == GELU) {
+    // 0.5x(1+tanh(z)) == x * sigmoid(2z), z = sqrt(2/pi)(x+0.044715x^3)
+    auto x2 = _mm512_mul_ps(x, x);
+    auto z = _mm512_fmadd_ps(x2, _mm512_set1_ps(-0.0713548162726f), _mm512_set1_ps(-1.59576912161f));
+    auto e = exp_ps(_mm512_mul_ps(z, x));
+    return _mm512_div_ps(x, _mm512_add_ps(e, _mm512_set1_ps(1.f)));
+  }
+  // 0.5x(1+erf(x/sqrt(2)))
+  auto y = erf_ps(_mm512_mul_ps(x, _mm512_set1_ps(0.707106781186547524f)));
+  return _mm512_mul_ps(_mm512_mul_ps(x, _mm512_set1_ps(0.5f)), _mm512_add_ps(y, _mm512_set1_ps(1.f)));
+}
+
+template <JBLAS_ELTWISEOP OP>
+static inline JBLAS_CODE bias_act_f32_f32(const float* srcptr, const int srcstep, const float* biasptr,
+                                          const int biasstep, float* dstptr, const int dststep, const int M,
+                                          const int N) {
+  int constexpr Vlen = 16;
+  auto vN = utils::padto_le(N, Vlen);
+  __mmask16 tailmask = (1 << (N - vN)) - 1;
+  for (int i = 0; i < M; i++) {
+    for (int j = 0; j < N; j += Vlen) {
+      __mmask16 mask = j < vN ? __mmask16(0xffff) : tailmask;
+      auto vsrc = _mm512_maskz_loadu_ps(mask, srcptr + i * srcstep + j);
+      if (biasptr != nullptr) {
+        vsrc = _mm512_add_ps(vsrc, _mm512_maskz_loadu_ps(mask, biasptr + i * biasstep + j));
+      }
+      _mm512_mask_storeu_ps(dstptr + i * dststep + j, mask, eltwise_ps<OP>(vsrc));
+    }
+  }
+  return JblasSuccess;
+}
+
 static inline void vec_quanout_s32_u32_v16(const int32_t* srcptr, __m512& vfactor, __m512i& vzp, __m512i& vzeros,
                                            __m512i& v255, uint8_t* dstptr) {
   auto vsrcd = _mm512_loadu_si512(srcptr);
@@ -442,6 +442,57 @@ inline JBLAS_CODE quantize_f32_fp4_rowblock(const float* srcptr, int8_t* dstptr,
   return JblasSuccess;
 }
 
+template <typename _F8_T>
+inline JBLAS_CODE quantize_f32_f8_rowblock(const float* srcptr, uint8_t* dstptr, int row, int col, int ld_src,
+                                           int ld_dst, float* scales, int blocksize) {
+  const float f8max = _F8_T::max();
+  for (int i = 0; i < col; i++) {
+    for (size_t j = 0; j < row; j += blocksize) {
+      float absmax = std::numeric_limits<float>::min();
+      for (size_t ij = 0; ij < blocksize; ij++) {
+        absmax = std::max(absmax, std::abs(srcptr[(j + ij) * ld_src + i]));
+      }
+      float scale = absmax / f8max;
+      float rscale = 1.f / scale;
+      scales[j / blocksize * ld_dst + i] = scale;
+      for (size_t ij = 0; ij < blocksize; ij++) {
+        dstptr[(j + ij) * ld_dst + i] = _F8_T::encode(srcptr[(j + ij) * ld_src + i] * rscale);
+      }
+    }
+  }
+  return JblasSuccess;
+}
+
+template <typename _F8_T>
+inline JBLAS_CODE decompress_kblock_f8_fp(uint8_t* srcptr, float* dstptr, int row, int col, int ld_src, int ld_dst,
+                                          float* scales, int k_offset, int kblock, int NPad) {
+  // float fixed rowpack==1
+  for (int i = 0; i < row; i++) {
+    int kpos = (k_offset + i) / kblock;
+    auto sptr = scales + kpos * NPad;
+    for (int j = 0; j < col; j += 1) {
+      dstptr[i * ld_dst + j] = _F8_T::decode(srcptr[i * ld_src + j]) * sptr[j];
+    }
+  }
+  return JblasSuccess;
+}
+
+template <typename _F8_T>
+inline JBLAS_CODE decompress_kblock_f8_fp(uint8_t* srcptr, utils::bf16* dstptr, int row, int col, int ld_src,
+                                          int ld_dst, float* scales, int k_offset, int kblock, int NPad) {
+  // bf16 fixed rowpack==2
+  for (int i = 0; i < row; i++) {
+    int kpos = (k_offset + i) / kblock;
+    auto sptr = scales + kpos * NPad;
+    for (int j = 0; j < col; j += 1) {
+      utils::bf16 bf16_ret;
+      bf16_ret.fromfloat(_F8_T::decode(srcptr[i * ld_src + j]) * sptr[j / 2]);  // interleave with the same scale
+      dstptr[i * ld_dst + j] = bf16_ret;
+    }
+  }
+  return JblasSuccess;
+}
+
 inline JBLAS_CODE quantize_f32_u8_colblock(int row, int col, const float* srcptr, int ld_src, uint8_t* dstptr,
                                            int ld_dst, float* scales, int ld_scale, uint8_t* zps, int blocksize) {
   for (int i = 0; i < row; i++) {
@@ -506,6 +557,32 @@ static inline JBLAS_CODE alphabeta_f32_f32(const float alpha, const float* srcpt
   return JblasSuccess;
 }
 
+template <JBLAS_ELTWISEOP OP>
+static inline float eltwise_f32(float x) {
+  static_assert(OP == GELU || OP == GELU_ERF || OP == SWISH, "Unsupported eltwise op.");
+  if (OP == SWISH) {
+    return x / (1.f + std::exp(-x));
+  }
+  if (OP == GELU) {
+    return 0.5f * x * (1.f + std::tanh(0.7978845608f * (x + 0.044715f * x * x * x)));
+  }
+  return 0.5f * x * (1.f + std::erf(x * 0.707106781186547524f));
+}
+
+template <JBLAS_ELTWISEOP OP>
+static inline JBLAS_CODE bias_act_f32_f32(const float* srcptr, const int srcstep, const float* biasptr,
+                                          const int biasstep, float* dstptr, const int dststep, const int M,
+                                          const int N) {
+  for (int i = 0; i < M; i++) {
+    for (int j = 0; j < N; j++) {
+      auto x = srcptr[i * srcstep + j];
+      if (biasptr != nullptr) x += biasptr[i * biasstep + j];
+      dstptr[i * dststep + j] = eltwise_f32<OP>(x);
+    }
+  }
+  return JblasSuccess;
+}
+
 static inline JBLAS_CODE quanout_s32_u32(const float alpha, const int32_t* srcptr, const int srcstep, uint8_t* dstptr,
                                          const int dststep, const int M, const int N, float scaleSrc, float scaleDst,
                                          int zpDst) {
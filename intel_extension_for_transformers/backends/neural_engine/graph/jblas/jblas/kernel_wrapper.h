@@ -421,9 +421,21 @@ class Memcpy2D {
 
   template <JBLAS_ISA ISA_T>
   static JBLAS_CODE forward_with_gelu(void* srcptr, void* dstptr, int row, int col, int srcstride, int dststride) {
+#if CompileAVX512F()
     if (utils::isa_base<ISA_T>::avx512f) {
       return kernel::jit::JitMemcpy2DAvx512f::forward_with_gelu(srcptr, dstptr, row, col, srcstride, dststride);
     }
+#endif
+    // float only
+    auto fsrc = reinterpret_cast<const float*>(srcptr);
+    auto fdst = reinterpret_cast<float*>(dstptr);
+    int ncol = col / sizeof(float), srcstep = srcstride / sizeof(float), dststep = dststride / sizeof(float);
+#if CompileAVX2()
+    if (utils::isa_base<ISA_T>::avx2) {
+      return avx2::bias_act_f32_f32<GELU>(fsrc, srcstep, nullptr, 0, fdst, dststep, row, ncol);
+    }
+#endif
+    return ref::bias_act_f32_f32<GELU>(fsrc, srcstep, nullptr, 0, fdst, dststep, row, ncol);
   }
 };
 
@@ -506,6 +518,19 @@ class QuantizeFp4RowBlock {
     return ref::quantize_f32_fp4_rowblock(srcptr, dstptr, row, col, ld_src, ld_dst, scales, blocksize);
   }
 };
+
+template <typename _F8_T>
+class QuantizeF8RowBlock {
+ public:
+  template <JBLAS_ISA ISA_T>
+  static inline JBLAS_CODE forward(const float* srcptr, uint8_t* dstptr, int row, int col, int ld_src, int ld_dst,
+                                   float* scales, int blocksize) {
+    if (row % blocksize != 0) {
+      return JblasNotSupport;
+    }
+    return ref::quantize_f32_f8_rowblock<_F8_T>(srcptr, dstptr, row, col, ld_src, ld_dst, scales, blocksize);
+  }
+};
 class QuantizeU8ColBlock {
  public:
   template <JBLAS_ISA ISA_T>
@@ -595,6 +620,23 @@ class DecompressKBlockFp4Fp {
   }
 };
 
+template <typename _DST_T>
+class DecompressKBlockF8FP {
+ public:
+  template <JBLAS_ISA ISA_T, typename _F8_T>
+  static inline JBLAS_CODE forward(uint8_t* srcptr, _DST_T* dstptr, int row, int col, int ld_src, int ld_dst,
+                                   float* scales, int k_offset, int kblock, int NPad) {
+#if CompileAVX512F()
+    if (utils::isa_base<ISA_T>::avx512f) {
+      return avx512f::decompress_kblock_f8_fp<_F8_T>(srcptr, dstptr, row, col, ld_src, ld_dst, scales, k_offset,
+                                                     kblock, NPad);
+    }
+#endif
+    return ref::decompress_kblock_f8_fp<_F8_T>(srcptr, dstptr, row, col, ld_src, ld_dst, scales, k_offset, kblock,
+                                               NPad);
+  }
+};
+
 class DecompressKBlockS4S8 {
  public:
   template <JBLAS_ISA ISA_T>
@@ -646,6 +688,27 @@ class AlphaBetaF32F32 {
   }
 };
 
+// dst = act(src + bias), bias can be NULL, or a row with biasstep 0. OP: GELU(tanh), GELU_ERF or SWISH(alpha=1)
+template <JBLAS_ELTWISEOP OP>
+class BiasActF32F32 {
+ public:
+  template <JBLAS_ISA ISA_T>
+  static JBLAS_CODE forward(const float* srcptr, const int srcstep, const float* biasptr, const int biasstep,
+                            float* dstptr, const int dststep, const int M, const int N) {
+#if CompileAVX512F()
+    if (utils::isa_base<ISA_T>::avx512f) {
+      return avx512f::bias_act_f32_f32<OP>(srcptr, srcstep, biasptr, biasstep, dstptr, dststep, M, N);
+    }
+#endif
+#if CompileAVX2()
+    if (utils::isa_base<ISA_T>::avx2) {
+      return avx2::bias_act_f32_f32<OP>(srcptr, srcstep, biasptr, biasstep, dstptr, dststep, M, N);
+    }
+#endif
+    return ref::bias_act_f32_f32<OP>(srcptr, srcstep, biasptr, biasstep, dstptr, dststep, M, N);
+  }
+};
+
 class QuanOutS32U32 {
  public:
   template <JBLAS_ISA ISA_T>
@@ -31,6 +31,7 @@
 #include "core/data_types.h"
 #include "core/ne.h"
 #include "core/ne_layers.h"
+#include "models/model_utils/model_block.h"
 #include "models/model_utils/model_config.h"
 #include "models/model_utils/model_utils.h"
 #include "models/model_utils/util.h"
@@ -44,245 +45,64 @@
 //
 
 static bool falcon_model_eval_internal(model_context& lctx, const model_token* tokens, const int n_tokens,
-                                     const int n_past, const int n_threads) {
+                                       const int n_past, const int n_threads) {
   // // enforce that the first token is BOS
   // if (n_past == 0 && tokens[0] != model_token_bos()) {
   //   fprintf(stderr, "%s: first token must be BOS\n", __func__);
   //   return false;
   // }
 
-  const int64_t t_start_us = ne_time_us();
-
-  const int N = n_tokens;
-
   const auto& model = lctx.model;
   const auto& hparams = model.hparams;
 
-  const auto& kv_self = model.kv_self;
-
-  MODEL_ASSERT(!!kv_self.ctx);
-
-  const int n_embd = hparams.n_embd;
   const int n_layer = hparams.n_layer;
-  const int n_ctx = hparams.n_ctx;
-  const int n_head = hparams.n_head;
-  const int n_vocab = hparams.n_vocab;
-  const int n_rot = hparams.n_rot;
-  const int head_dim = hparams.n_embd / hparams.n_head;
-
-  auto& mem_per_token = lctx.mem_per_token;
-  auto& buf_compute = lctx.buf_compute;
-
-  struct ne_init_params params = {
-      /*.mem_size   =*/buf_compute.size,
-      /*.mem_buffer =*/buf_compute.addr,
-      /*.no_alloc   =*/false,
-  };
-
-  struct ne_context* ctx0 = ne_init(params);
-
-  // for big profalcons, if BLAS is enabled, it is better to use only one thread
-  // otherwise, the threads are spin-lock waiting for the BLAS calls and are degrading the performance
-  ne_cgraph gf = {};
-  gf.n_threads = N >= 32 && ne_cpu_has_blas() ? 1 : n_threads;
 
-  struct ne_tensor* embd = d_ne_new_tensor_1d(ctx0, NE_TYPE_I32, N);
-  ne_set_name(embd, "embd");
-  memcpy(embd->data, tokens, N * ne_element_size(embd));
+  model_block_config config;
+  config.norm = MODEL_NORM_LAYER;
+  // using mode = 2 for neox mode
+  config.pos = MODEL_POS_ROPE_NEOX;
+  config.n_rot = hparams.n_embd / hparams.n_head;
+  // multi-query attention, wqkv rows are [q | k | v] with a single KV head
+  config.qkv = MODEL_QKV_FUSED;
+  config.n_head_kv = hparams.n_head_kv;
+  // attention and FFN share the input layernorm
+  config.parallel_residual = true;
+  config.ffn = MODEL_FFN_GELU;
+
+  model_graph g;
+  model_graph_init(&g, lctx, tokens, n_tokens, n_past, n_threads);
+  struct ne_context* ctx0 = g.ctx0;
 
   // wte
-  struct ne_tensor* inpL = ne_get_rows(ctx0, model.others[0], embd);
+  struct ne_tensor* inpL = ne_get_rows(ctx0, model.others[0], g.embd);
 
   for (int il = 0; il < n_layer; ++il) {
-    struct ne_tensor* cur;
-    struct ne_tensor* layernorm_output;
-
-    lctx.use_buf(ctx0, 0);
-
-    // self-attention
-    {
-      {
-        cur = ne_norm(ctx0, inpL);
-
-        cur = ne_add(ctx0, ne_mul(ctx0, ne_repeat(ctx0, model.layers[il].norm[0], cur), cur),
-                     ne_repeat(ctx0, model.layers[il].norm[1], cur));
-      }
-      layernorm_output = cur;
-
-      // compute QKV
-      cur = ne_mul_mat(ctx0, model.layers[il].attn[0], cur);
-
-      size_t fused_qkv_row_nb = (n_embd + 2 * (n_embd / n_head)) * sizeof(float);
-
-      struct ne_tensor* Qcur =
-          ne_view_3d(ctx0, cur, head_dim, n_head, N, head_dim * sizeof(float), fused_qkv_row_nb, 0);
-
-      struct ne_tensor* Kcur =
-          ne_view_3d(ctx0, cur, head_dim, 1, N, head_dim * sizeof(float), fused_qkv_row_nb, n_embd * sizeof(float));
-
-      struct ne_tensor* Vcur = ne_view_3d(ctx0, cur, head_dim, 1, N, head_dim * sizeof(float), fused_qkv_row_nb,
-                                          (n_embd + head_dim) * sizeof(float));
-
-      // using mode = 2 for neox mode
-      Qcur = ne_rope_inplace(ctx0, Qcur, n_past, head_dim, 2);
-      Kcur = ne_rope_inplace(ctx0, Kcur, n_past, head_dim, 2);
-
-      // store key and value to memory
-      {
-        // head_dim, 1 (head_num), N --> head_dim, N, 1 (head_num)
-        struct ne_tensor* Kcur_permuted = ne_permute(ctx0, Kcur, 0, 2, 1, 3);
-        // head_dim, 1 (head_num), N --> N, head_dim, 1 (head_num)
-        struct ne_tensor* Vcur_permuted = ne_permute(ctx0, Vcur, 1, 2, 0, 3);
-
-        struct ne_tensor* k =
-            ne_view_3d(ctx0, kv_self.k, head_dim, N, 1, ne_element_size(kv_self.k) * head_dim,
-                       ne_element_size(kv_self.k) * head_dim * n_ctx,
-                       il * n_ctx * ne_element_size(kv_self.k) * head_dim +
-                           n_past * ne_element_size(kv_self.k) * head_dim);
-        struct ne_tensor* v = ne_view_3d(
-            ctx0, kv_self.v, N, head_dim, 1, n_ctx * ne_element_size(kv_self.v),
-            n_ctx * ne_element_size(kv_self.v) * head_dim,
-            il * n_ctx * ne_element_size(kv_self.v) * head_dim + n_past * ne_element_size(kv_self.v));
-
-        ne_build_forward_expand(&gf, ne_cpy(ctx0, Kcur_permuted, k));
-        ne_build_forward_expand(&gf, ne_cpy(ctx0, Vcur_permuted, v));
-      }
-
-      // Q = Qcur.contiguous().view(n_embd/n_head, n_head, N).permute(0, 2, 1, 3)
-      struct ne_tensor* Q = ne_permute(ctx0, Qcur, 0, 2, 1, 3);
-
-      struct ne_tensor* K =
-          ne_view_3d(ctx0, kv_self.k, head_dim, N + n_past, 1, ne_element_size(kv_self.k) * head_dim,
-                     ne_element_size(kv_self.k) * head_dim * n_ctx,
-                     il * n_ctx * ne_element_size(kv_self.k) * head_dim * 1);
-
-      // K * Q
-      struct ne_tensor* KQ = ne_mul_mat(ctx0, K, Q);
-
-      // KQ_scaled = KQ / sqrt(n_embd/n_head)
-      struct ne_tensor* KQ_scaled = ne_scale_inplace(ctx0, KQ, ne_new_f32(ctx0, 1.0f / sqrt(float(n_embd) / n_head)));
-
-      // KQ_masked = mask_past(KQ_scaled)
-      struct ne_tensor* KQ_masked = ne_diag_mask_inf_inplace(ctx0, KQ_scaled, n_past);
-
-      // KQ = soft_max(KQ_masked)
-      struct ne_tensor* KQ_soft_max = ne_soft_max_inplace(ctx0, KQ_masked);
-
-      // V_trans = Vmem.view(n_embd/n_head, n_head, n_past + N).permute(1, 2, 0, 3).contiguous()
-      struct ne_tensor* V =
-          ne_view_3d(ctx0, kv_self.v, N + n_past, head_dim, 1, ne_element_size(kv_self.v) * n_ctx,
-                     ne_element_size(kv_self.v) * n_ctx * head_dim,
-                     il * n_ctx * ne_element_size(kv_self.v) * head_dim * 1);
-
-      // KQV = transpose(V) * KQ_soft_max
-      struct ne_tensor* KQV = ne_mul_mat(ctx0, V, KQ_soft_max);
-
-      // KQV_merged = KQV.permute(0, 2, 1, 3)
-      struct ne_tensor* KQV_merged = ne_permute(ctx0, KQV, 0, 2, 1, 3);
-
-      // cur = KQV_merged.contiguous().view(n_embd, N)
-      cur = ne_cpy(ctx0, KQV_merged, ne_new_tensor_2d(ctx0, NE_TYPE_F32, n_embd, N, NE_SIZE_CALC));
-
-      // projection
-      { cur = ne_mul_mat(ctx0, model.layers[il].attn[1], cur); }
-    }
-
-    lctx.use_buf(ctx0, 1);
-
-    struct ne_tensor* inpFF = layernorm_output;
-    struct ne_tensor* attn_out = ne_cpy(ctx0, cur, ne_new_tensor_2d(ctx0, NE_TYPE_F32, n_embd, N, NE_SIZE_CALC));
-
-    // FFN (pre_layer_norm output)
-    {
-      cur = ne_mul_mat(ctx0, model.layers[il].ffn[0], inpFF);
-      cur = ne_gelu(ctx0, cur);
-      cur = ne_mul_mat(ctx0, model.layers[il].ffn[1], cur);
-    }
-
-    cur = ne_add(ctx0, cur, attn_out);
-    cur = ne_add(ctx0, cur, inpL);
-    // input for next layer
-    inpL = cur;
+    const model_layer& layer = model.layers[il];
+    model_block_weights weights = {};
+    weights.attn_norm_w = layer.norm[0];
+    weights.attn_norm_b = layer.norm[1];
+    weights.wqkv = layer.attn[0];
+    weights.wo = layer.attn[1];
+    weights.ffn_up = layer.ffn[0];
+    weights.ffn_down = layer.ffn[1];
+
+    inpL = model_block_forward(&g, config, weights, il, inpL);
   }
 
   lctx.use_buf(ctx0, 0);
-  // used at the end to optionally extract the embeddings
-  struct ne_tensor* embeddings = NULL;
-  // norm
-  {
-    inpL = ne_norm(ctx0, inpL);
 
-    // inpL = ln_f_g*inpL + ln_f_b
-    inpL = ne_add(ctx0, ne_mul(ctx0, ne_repeat(ctx0, model.others[1], inpL), inpL),
-                  ne_repeat(ctx0, model.others[2], inpL));
-  }
+  // norm, used at the end to optionally extract the embeddings
+  struct ne_tensor* embeddings = model_norm(ctx0, MODEL_NORM_LAYER, inpL, model.others[1], model.others[2]);
+
   lctx.use_buf(ctx0, -1);
-  // lm_head
-  {
-    inpL = ne_mul_mat(ctx0, model.others[3], inpL);
 
-    // inpL = ne_add(ctx0,
-    //         ne_repeat(ctx0, model.lmh_b, inpL),
-    //         inpL);
-  }
+  // lm_head
+  inpL = ne_mul_mat(ctx0, model.others[3], embeddings);
 
   // logits -> probs
   // inpL = ne_soft_max_inplace(ctx0, inpL);
 
-  // run the computation
-  ne_build_forward_expand(&gf, inpL);
-  ne_graph_compute(ctx0, &gf);
-
-#ifdef NE_PERF
-  bool engine_profiling_ = (getenv("ENGINE_PROFILING") != NULL);
-  if (engine_profiling_) {
-    ne_graph_profiling(&gf);
-  }
-#endif
-
-  // update kv token count
-  lctx.model.kv_self.n = n_past + N;
-
-  // extract logits
-  {
-    auto& logits_out = lctx.logits;
-
-    if (lctx.logits_all) {
-      logits_out.resize(n_vocab * N);
-      memcpy(logits_out.data(), (float*)ne_get_data(inpL), sizeof(float) * n_vocab * N);
-    } else {
-      // return result for just the last token
-      logits_out.resize(n_vocab);
-      memcpy(logits_out.data(), (float*)ne_get_data(inpL) + (n_vocab * (N - 1)), sizeof(float) * n_vocab);
-    }
-  }
-
-  // extract embeddings
-  if (!lctx.embedding.empty()) {
-    auto& embedding_out = lctx.embedding;
-
-    embedding_out.resize(n_embd);
-    memcpy(embedding_out.data(), (float*)ne_get_data(embeddings) + (n_embd * (N - 1)), sizeof(float) * n_embd);
-  }
-
-  if (mem_per_token == 0) {
-    mem_per_token = ne_used_mem(ctx0) / N;
-  }
-
-  ne_free(ctx0);
-
-  // measure the performance only for the single-token evals
-  int64_t time_interval = ne_time_us() - t_start_us;
-  if (N == 1) {
-    lctx.t_eval_us += time_interval;
-    lctx.n_eval++;
-  } else if (N > 1) {
-    lctx.t_p_eval_us += time_interval;
-    lctx.n_p_eval += N;
-  }
-  lctx.eval_times.push_back(time_interval);
-
-  return true;
+  return model_graph_compute(&g, inpL, embeddings);
 }
 
 int model_eval(struct model_context* ctx, const model_token* tokens, int n_tokens, int n_past, int n_threads) {
@@ -320,10 +140,12 @@ struct model_context* model_init_from_gpt_params(const gpt_params& params) {
   lparams.n_gpu_layers = params.n_gpu_layers;
   lparams.seed = params.seed;
   lparams.f16_kv = params.memory_f16;
+  lparams.i8_kv = params.memory_i8;
   lparams.use_mmap = params.use_mmap;
   lparams.use_mlock = params.use_mlock;
   lparams.logits_all = params.perplexity;
   lparams.embedding = params.embedding;
+  model_context_params_from_gpt_params(params, &lparams);
 
   model_context* lctx = model_init_from_file(params.model.c_str(), lparams);
 
@@ -67,11 +67,19 @@ void FALCON::init(const char* path_model, model_context& lctx, int n_ctx_, int n
   auto& hparams = model.hparams;
   n_ff = 4 * hparams.n_embd;
   hparams.n_ctx = n_ctx;
+  // the fused QKV has n_head query heads and n_head_kv (1 for the multi-query attention of Falcon-7B) K and V heads
+  const uint32_t head_dim = hparams.n_embd / hparams.n_head;
+  const uint32_t n_qkv = ml->get_tensor_ne("transformer.h.0.self_attention.query_key_value.weight").at(1);
+  hparams.n_head_kv = (n_qkv - hparams.n_embd) / (2 * head_dim);
+  if (hparams.n_head_kv != 1) {
+    throw format("falcon: the QKV of each group of grouped-query attention (Falcon-40B) is not supported");
+  }
   fprintf(stderr, "%s: n_vocab    = %u\n", __func__, hparams.n_vocab);
   fprintf(stderr, "%s: n_ctx      = %u\n", __func__, hparams.n_ctx);
   fprintf(stderr, "%s: n_embd     = %u\n", __func__, hparams.n_embd);
   fprintf(stderr, "%s: n_mult     = %u\n", __func__, hparams.n_mult);
   fprintf(stderr, "%s: n_head     = %u\n", __func__, hparams.n_head);
+  fprintf(stderr, "%s: n_head_kv  = %u\n", __func__, hparams.n_head_kv);
   fprintf(stderr, "%s: n_layer    = %u\n", __func__, hparams.n_layer);
   fprintf(stderr, "%s: n_rot      = %u\n", __func__, hparams.n_rot);
   fprintf(stderr, "%s: n_ff       = %u\n", __func__, n_ff);
@@ -113,6 +121,8 @@ void FALCON::load(model_context& lctx, model_progress_callback progress_callback
 
   ml->ne_ctx = ctx;
 
+  const uint32_t n_embd_kv = model.hparams.n_head_kv * (n_embd / model.hparams.n_head);
+
   model.others[0] = ml->get_tensor("transformer.word_embeddings.weight", {n_embd, n_vocab}, NE_BACKEND_CPU);
   model.others[1] = ml->get_tensor("transformer.ln_f.weight", {n_embd}, NE_BACKEND_CPU);
   model.others[2] = ml->get_tensor("transformer.ln_f.bias", {n_embd}, NE_BACKEND_CPU);
@@ -131,7 +141,8 @@ void FALCON::load(model_context& lctx, model_progress_callback progress_callback
     layer.norm[1] = ml->get_tensor(layers_i + ".input_layernorm.bias", {n_embd}, backend);
   
     // qkv GEMM
-    layer.attn[0] = ml->get_tensor(layers_i + ".self_attention.query_key_value.weight", {n_embd, n_embd + 2 * (n_embd / model.hparams.n_head)}, backend);
+    layer.attn[0] =
+        ml->get_tensor(layers_i + ".self_attention.query_key_value.weight", {n_embd, n_embd + 2 * n_embd_kv}, backend);
     layer.attn[1] = ml->get_tensor(layers_i + ".self_attention.dense.weight", {n_embd, n_embd}, backend);
 
     // ffn GEMM
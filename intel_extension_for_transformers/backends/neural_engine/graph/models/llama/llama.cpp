@@ -33,6 +33,7 @@
 #include "core/data_types.h"
 #include "core/ne.h"
 #include "core/ne_layers.h"
+#include "models/model_utils/model_block.h"
 #include "models/model_utils/model_config.h"
 #include "models/model_utils/model_files.h"
 #include "models/model_utils/model_types.h"
@@ -55,270 +56,55 @@ static bool llama_model_eval_internal(model_context& lctx, const model_token* to
     return false;
   }
 
-  const int64_t t_start_us = ne_time_us();
-
-  const int N = n_tokens;
-
   const auto& model = lctx.model;
   const auto& hparams = model.hparams;
 
-  const auto& kv_self = model.kv_self;
-
-  MODEL_ASSERT(!!kv_self.ctx);
-
-  const int n_embd = hparams.n_embd;
   const int n_layer = hparams.n_layer;
-  const int n_ctx = hparams.n_ctx;
-  const int n_head = hparams.n_head;
-  const int n_vocab = hparams.n_vocab;
-  const int n_rot = hparams.n_embd / hparams.n_head;
 
-  auto& mem_per_token = lctx.mem_per_token;
-  auto& buf_compute = lctx.buf_compute;
+  model_block_config config;
+  config.norm = MODEL_NORM_RMS;
+  config.pos = MODEL_POS_ROPE;
+  config.n_rot = hparams.n_embd / hparams.n_head;
+  config.qkv = MODEL_QKV_SEPARATE;
+  config.n_head_kv = hparams.n_head_kv;
+  config.ffn = MODEL_FFN_SILU_GATED;
 
-  struct ne_init_params params = {
-      /*.mem_size   =*/buf_compute.size,
-      /*.mem_buffer =*/buf_compute.addr,
-      /*.no_alloc   =*/false,
-  };
+  model_graph g;
+  model_graph_init(&g, lctx, tokens, n_tokens, n_past, n_threads);
+  struct ne_context* ctx0 = g.ctx0;
 
-  struct ne_context* ctx0 = ne_init(params);
-
-  // for big prompts, if BLAS is enabled, it is better to use only one thread
-  // otherwise, the threads are spin-lock waiting for the BLAS calls and are degrading the performance
-  ne_cgraph gf = {};
-  gf.n_threads = N >= 32 && ne_cpu_has_blas() ? 1 : n_threads;
-
-  struct ne_tensor* embd = ne_new_tensor_1d(ctx0, NE_TYPE_I32, N, NE_SIZE_CALC);
-  ne_set_name(embd, "embd");
-  memcpy(embd->data, tokens, N * ne_element_size(embd));
-
-  struct ne_tensor* inpL = ne_get_rows(ctx0, model.others[0], embd);
+  struct ne_tensor* inpL = ne_get_rows(ctx0, model.others[0], g.embd);
 
   for (int il = 0; il < n_layer; ++il) {
-    struct ne_tensor* inpSA = inpL;
-
-    struct ne_tensor* cur;
-
-    lctx.use_buf(ctx0, 0);
-
-    // norm
-    {
-      cur = ne_rms_norm(ctx0, inpL);
-
-      // cur = cur*attention_norm(broadcasted)
-      cur = ne_mul(ctx0, cur, model.layers[il].norm[0]);
-    }
-    ne_tensor *Qcur, *Kcur, *Vcur;
-    if (model.layers[il].attn[0]->type == NE_TYPE_JBLAS) {  // fused execution of QKV
-      struct ne_tensor* QKVcur =
-          ne_mul_qkv(ctx0, model.layers[il].attn[0], model.layers[il].attn[1], model.layers[il].attn[2], cur);
-      Qcur = ne_rope_inplace(
-          ctx0,
-          ne_reshape_3d(ctx0, ne_view_1d(ctx0, QKVcur, N * n_embd, 0 * N * n_embd * ne_element_size(QKVcur)),
-                        n_embd / n_head, n_head, N),
-          n_past, n_rot, 0);
-      Kcur = ne_rope_inplace(
-          ctx0,
-          ne_reshape_3d(ctx0, ne_view_1d(ctx0, QKVcur, N * n_embd, 1 * N * n_embd * ne_element_size(QKVcur)),
-                        n_embd / n_head, n_head, N),
-          n_past, n_rot, 0);
-      Vcur = ne_transpose(
-          ctx0, ne_reshape_2d(ctx0, ne_view_1d(ctx0, QKVcur, N * n_embd, 2 * N * n_embd * ne_element_size(QKVcur)),
-                              n_embd, N));
-
-    } else {
-      Qcur = ne_rope_inplace(
-          ctx0, ne_reshape_3d(ctx0, ne_mul_mat(ctx0, model.layers[il].attn[0], cur), n_embd / n_head, n_head, N),
-          n_past, n_rot, 0);
-      Kcur = ne_rope_inplace(
-          ctx0, ne_reshape_3d(ctx0, ne_mul_mat(ctx0, model.layers[il].attn[1], cur), n_embd / n_head, n_head, N),
-          n_past, n_rot, 0);
-      Vcur = ne_transpose(ctx0, ne_reshape_2d(ctx0, ne_mul_mat(ctx0, model.layers[il].attn[2], cur), n_embd, N));
-    }
-    ne_set_name(Qcur, "Qcur");
-    ne_set_name(Kcur, "Kcur");
-    ne_set_name(Vcur, "Vcur");
-    // self-attention
-    {
-      // store key and value to memory
-      {
-        struct ne_tensor* k =
-            ne_view_1d(ctx0, kv_self.k, N * n_embd, (ne_element_size(kv_self.k) * n_embd) * (il * n_ctx + n_past));
-        struct ne_tensor* v =
-            ne_view_2d(ctx0, kv_self.v, N, n_embd, (n_ctx)*ne_element_size(kv_self.v),
-                       (il * n_ctx) * ne_element_size(kv_self.v) * n_embd + n_past * ne_element_size(kv_self.v));
-
-        // important: storing RoPE-ed version of K in the KV cache!
-        ne_build_forward_expand(&gf, ne_cpy(ctx0, Kcur, k));
-        ne_build_forward_expand(&gf, ne_cpy(ctx0, Vcur, v));
-      }
-
-      struct ne_tensor* Q = ne_permute(ctx0, Qcur, 0, 2, 1, 3);
-      ne_set_name(Q, "Q");
-
-      struct ne_tensor* K = ne_permute(ctx0,
-                                       ne_reshape_3d(ctx0,
-                                                     ne_view_1d(ctx0, kv_self.k, (n_past + N) * n_embd,
-                                                                il * n_ctx * ne_element_size(kv_self.k) * n_embd),
-                                                     n_embd / n_head, n_head, n_past + N),
-                                       0, 2, 1, 3);
-      ne_set_name(K, "K");
-
-      // K * Q
-      struct ne_tensor* KQ = ne_mul_mat(ctx0, K, Q);
-      ne_set_name(KQ, "KQ");
-
-      // KQ_scaled = KQ / sqrt(n_embd/n_head)
-      struct ne_tensor* KQ_scale = ne_new_f32(ctx0, 1.0f / sqrtf(float(n_embd) / n_head));
-      ne_set_name(KQ_scale, "1/sqrt(n_embd/n_head)");
-
-      // KQ_scaled shape [n_past + N, N, n_head, 1]
-      struct ne_tensor* KQ_scaled = ne_scale_inplace(ctx0, KQ, KQ_scale);
-      ne_set_name(KQ_scaled, "KQ_scaled");
-
-      // KQ_masked = mask_past(KQ_scaled)
-      struct ne_tensor* KQ_masked = ne_diag_mask_inf_inplace(ctx0, KQ_scaled, n_past);
-      ne_set_name(KQ_masked, "KQ_masked");
-
-      // KQ = soft_max(KQ_masked)
-      struct ne_tensor* KQ_soft_max = ne_soft_max_inplace(ctx0, KQ_masked);
-      ne_set_name(KQ_soft_max, "KQ_soft_max");
-
-      // split cached V into n_head heads
-      struct ne_tensor* V = ne_view_3d(
-          ctx0, kv_self.v, n_past + N, n_embd / n_head, n_head, n_ctx * ne_element_size(kv_self.v),
-          n_ctx * ne_element_size(kv_self.v) * n_embd / n_head, il * n_ctx * ne_element_size(kv_self.v) * n_embd);
-      ne_set_name(V, "V");
-
-      struct ne_tensor* KQV = ne_mul_mat(ctx0, V, KQ_soft_max);
-      ne_set_name(KQV, "KQV");
-
-      // KQV_merged = KQV.permute(0, 2, 1, 3)
-      struct ne_tensor* KQV_merged = ne_permute(ctx0, KQV, 0, 2, 1, 3);
-      ne_set_name(KQV_merged, "KQV_merged");
-
-      // cur = KQV_merged.contiguous().view(n_embd, N)
-      cur = ne_cpy(ctx0, KQV_merged, ne_new_tensor_2d(ctx0, NE_TYPE_F32, n_embd, N, NE_SIZE_CALC));
-      ne_set_name(cur, "KQV_merged_contiguous");
-
-      // projection (no bias)
-      cur = ne_mul_mat(ctx0, model.layers[il].attn[3], cur);
-    }
-
-    lctx.use_buf(ctx0, 1);
-
-    struct ne_tensor* inpFF = ne_add(ctx0, cur, inpSA);
-
-    // feed-forward network
-    {
-      // norm
-      {
-        cur = ne_rms_norm(ctx0, inpFF);
-
-        // cur = cur*ffn_norm(broadcasted)
-        cur = ne_mul(ctx0, cur, model.layers[il].norm[1]);
-      }
-
-      if (model.layers[il].ffn[0]->type == NE_TYPE_JBLAS) {
-        cur = ne_ffn_silu(ctx0, model.layers[il].ffn[0], model.layers[il].ffn[1], model.layers[il].ffn[2], cur);
-      } else {
-        struct ne_tensor* tmp = ne_mul_mat(ctx0, model.layers[il].ffn[2], cur);
-
-        cur = ne_mul_mat(ctx0, model.layers[il].ffn[0], cur);
-
-        // SILU activation
-        cur = ne_silu(ctx0, cur);
-
-        cur = ne_mul(ctx0, cur, tmp);
-
-        cur = ne_mul_mat(ctx0, model.layers[il].ffn[1], cur);
-      }
-    }
-
-    cur = ne_add(ctx0, cur, inpFF);
-
-    // input for next layer
-    inpL = cur;
+    const model_layer& layer = model.layers[il];
+    model_block_weights weights = {};
+    weights.attn_norm_w = layer.norm[0];
+    weights.wq = layer.attn[0];
+    weights.wk = layer.attn[1];
+    weights.wv = layer.attn[2];
+    weights.wo = layer.attn[3];
+    weights.ffn_norm_w = layer.norm[1];
+    weights.ffn_gate = layer.ffn[0];
+    weights.ffn_down = layer.ffn[1];
+    weights.ffn_up = layer.ffn[2];
+
+    inpL = model_block_forward(&g, config, weights, il, inpL);
   }
 
   lctx.use_buf(ctx0, 0);
 
-  // used at the end to optionally extract the embeddings
-  struct ne_tensor* embeddings = NULL;
-
-  // norm
-  {
-    inpL = ne_rms_norm(ctx0, inpL);
+  // norm, used at the end to optionally extract the embeddings
+  struct ne_tensor* embeddings = model_norm(ctx0, MODEL_NORM_RMS, inpL, model.others[1], NULL);
 
-    // inpL = inpL*norm(broadcasted)
-    inpL = ne_mul(ctx0, inpL, model.others[1]);
-
-    embeddings = inpL;
-  }
+  lctx.use_buf(ctx0, -1);
 
   // lm_head
-  inpL = ne_mul_mat(ctx0, model.others[2], inpL);
-
-  lctx.use_buf(ctx0, -1);
+  inpL = ne_mul_mat(ctx0, model.others[2], embeddings);
 
   // logits -> probs
   // inpL = ne_soft_max_inplace(ctx0, inpL);
 
-  // run the computation
-  ne_build_forward_expand(&gf, inpL);
-  ne_graph_compute(ctx0, &gf);
-
-#ifdef NE_PERF
-  bool engine_profiling_ = (getenv("ENGINE_PROFILING") != NULL);
-  if (engine_profiling_) {
-    ne_graph_profiling(&gf);
-  }
-#endif
-
-  // update kv token count
-  lctx.model.kv_self.n = n_past + N;
-
-  // extract logits
-  {
-    auto& logits_out = lctx.logits;
-
-    if (lctx.logits_all) {
-      logits_out.resize(n_vocab * N);
-      memcpy(logits_out.data(), (float*)ne_get_data(inpL), sizeof(float) * n_vocab * N);
-    } else {
-      // return result for just the last token
-      logits_out.resize(n_vocab);
-      memcpy(logits_out.data(), (float*)ne_get_data(inpL) + (n_vocab * (N - 1)), sizeof(float) * n_vocab);
-    }
-  }
-
-  // extract embeddings
-  if (!lctx.embedding.empty()) {
-    auto& embedding_out = lctx.embedding;
-
-    embedding_out.resize(n_embd);
-    memcpy(embedding_out.data(), (float*)ne_get_data(embeddings) + (n_embd * (N - 1)), sizeof(float) * n_embd);
-  }
-
-  if (mem_per_token == 0) {
-    mem_per_token = ne_used_mem(ctx0) / N;
-  }
-
-  ne_free(ctx0);
-
-  // measure the performance only for the single-token evals
-  int64_t time_interval = ne_time_us() - t_start_us;
-  if (N == 1) {
-    lctx.t_eval_us += time_interval;
-    lctx.n_eval++;
-  } else if (N > 1) {
-    lctx.t_p_eval_us += time_interval;
-    lctx.n_p_eval += N;
-  }
-  lctx.eval_times.push_back(time_interval);
-
-  return true;
+  return model_graph_compute(&g, inpL, embeddings);
 }
 
 int model_eval(struct model_context* ctx, const model_token* tokens, int n_tokens, int n_past, int n_threads) {
@@ -356,10 +142,12 @@ struct model_context* model_init_from_gpt_params(const gpt_params& params) {
   lparams.n_gpu_layers = params.n_gpu_layers;
   lparams.seed = params.seed;
   lparams.f16_kv = params.memory_f16;
+  lparams.i8_kv = params.memory_i8;
   lparams.use_mmap = params.use_mmap;
   lparams.use_mlock = params.use_mlock;
   lparams.logits_all = params.perplexity;
   lparams.embedding = params.embedding;
+  model_context_params_from_gpt_params(params, &lparams);
 
   model_context* lctx = model_init_from_file(params.model.c_str(), lparams);
 
@@ -162,6 +162,8 @@ bool gpt_params_parse(int argc, char** argv, gpt_params& params) {
       params.n_ctx = std::stoi(argv[i]);
     } else if (arg == "--memory-f32") {
       params.memory_f16 = false;
+    } else if (arg == "--memory-i8") {
+      params.memory_i8 = true;
     } else if (arg == "--top-p") {
       if (++i >= argc) {
         invalid_param = true;
@@ -347,6 +349,53 @@ bool gpt_params_parse(int argc, char** argv, gpt_params& params) {
         break;
       }
       params.beam_size = std::stoi(argv[i]);
+    } else if (arg == "--compute_type") {
+      if (++i >= argc) {
+        invalid_param = true;
+        break;
+      }
+      std::string type = argv[i];
+      if (type == "fp32") {
+        params.compute_type = MODEL_COMPUTE_FP32;
+      } else if (type == "bf16") {
+        params.compute_type = MODEL_COMPUTE_BF16;
+      } else if (type == "int8") {
+        params.compute_type = MODEL_COMPUTE_INT8;
+      } else if (type == "auto") {
+        params.compute_type = MODEL_COMPUTE_AUTO;
+      } else {
+        invalid_param = true;
+        break;
+      }
+    } else if (arg == "--numa_nodes") {
+      if (++i >= argc) {
+        invalid_param = true;
+        break;
+      }
+      params.numa_nodes = std::stoi(argv[i]);
+    } else if (arg == "--no_huge_pages") {
+      params.huge_pages = false;
+    } else if (arg == "--compress_session") {
+      params.compress_session = true;
+    } else if (arg == "--mem_policy") {
+      if (++i >= argc) {
+        invalid_param = true;
+        break;
+      }
+      std::string policy = argv[i];
+      if (policy == "default") {
+        params.mem_policy = NE_MEM_POLICY_DEFAULT;
+      } else if (policy == "local") {
+        params.mem_policy = NE_MEM_POLICY_LOCAL;
+      } else if (policy == "interleave") {
+        params.mem_policy = NE_MEM_POLICY_INTERLEAVE;
+      } else if (policy.rfind("bind:", 0) == 0) {
+        params.mem_policy = NE_MEM_POLICY_BIND;
+        params.mem_node = std::stoi(policy.substr(5));
+      } else {
+        invalid_param = true;
+        break;
+      }
     } else {
       fprintf(stderr, "error: unknown argument: %s\n", arg.c_str());
       gpt_print_usage(argc, argv, default_params);
@@ -434,6 +483,7 @@ void gpt_print_usage(int /*argc*/, char** argv, const gpt_params& params) {
           "  --ignore-eos          ignore end of stream token and continue generating (implies --logit-bias 2-inf)\n");
   fprintf(stderr, "  --no-penalize-nl      do not penalize newline token\n");
   fprintf(stderr, "  --memory-f32          use f32 instead of f16 for memory key+value\n");
+  fprintf(stderr, "  --memory-i8           use int8 instead of f16 for memory key+value, halves the cache size\n");
   fprintf(stderr, "  --temp N              temperature (default: %.1f)\n", (double)params.temp);
   fprintf(stderr, "  -b N, --batch-size N  batch size for prompt processing (default: %d)\n", params.n_batch);
   fprintf(stderr, "  --perplexity          compute perplexity over the prompt\n");
@@ -459,5 +509,10 @@ void gpt_print_usage(int /*argc*/, char** argv, const gpt_params& params) {
   fprintf(stderr, "  --batch_size 2        number batch of prompt\n");
   fprintf(stderr, "  --beam_search         use beam search for text generation\n");
   fprintf(stderr, "  --beam_size 4         number of beams for beam_search, only valid after --beam_search\n");
+  fprintf(stderr, "  --compute_type TYPE   gemm type of jblas weights: fp32/bf16/int8 (default: auto, as quantized)\n");
+  fprintf(stderr, "  --numa_nodes N        split the jblas gemms over N NUMA nodes, 0 for all (default: 1)\n");
+  fprintf(stderr, "  --no_huge_pages       back the weights, KV cache and scratch buffers with normal pages only\n");
+  fprintf(stderr, "  --mem_policy POLICY   NUMA placement of those buffers: default/local/interleave/bind:NODE\n");
+  fprintf(stderr, "  --compress_session    deflate the KV cache of the saved prompt cache (needs a NE_ZLIB build)\n");
   fprintf(stderr, "\n");
 }
@@ -0,0 +1,370 @@
+//  Copyright (c) 2023 Intel Corporation
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+#include "models/model_utils/model_block.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cstring>
+#include <vector>
+
+#include "core/data_types.h"
+#include "core/ne.h"
+#include "core/ne_layers.h"
+#include "models/model_utils/model_utils.h"
+#include "models/model_utils/util.h"
+
+void model_graph_init(model_graph* g, model_context& lctx, const model_token* tokens, const int n_tokens,
+                      const int n_past, const int n_threads) {
+  MODEL_ASSERT(!!lctx.model.kv_self.ctx);
+  // the sequences of a batch are the blocks of the KV cache
+  MODEL_ASSERT(lctx.batch_size <= lctx.kv_n_ctx_block);
+
+  g->lctx = &lctx;
+  g->t_start_us = ne_time_us();
+  g->n_tokens = n_tokens;
+  g->n_past = n_past;
+  g->batch_size = lctx.batch_size;
+
+  struct ne_init_params params = {
+      /*.mem_size   =*/lctx.buf_compute.size,
+      /*.mem_buffer =*/lctx.buf_compute.addr,
+      /*.no_alloc   =*/false,
+  };
+
+  g->ctx0 = ne_init(params);
+
+  // for big prompts, if BLAS is enabled, it is better to use only one thread
+  // otherwise, the threads are spin-lock waiting for the BLAS calls and are degrading the performance
+  memset(&g->gf, 0, sizeof(g->gf));
+  g->gf.n_threads = n_tokens >= 32 && ne_cpu_has_blas() ? 1 : n_threads;
+
+  // the tokens of the sequences one after another
+  g->embd = d_ne_new_tensor_1d(g->ctx0, NE_TYPE_I32, n_tokens * g->batch_size);
+  ne_set_name(g->embd, "embd");
+  memcpy(g->embd->data, tokens, n_tokens * g->batch_size * ne_element_size(g->embd));
+}
+
+bool model_graph_compute(model_graph* g, struct ne_tensor* logits, struct ne_tensor* embeddings) {
+  model_context& lctx = *g->lctx;
+  struct ne_context* ctx0 = g->ctx0;
+  const int N = g->n_tokens;
+  const int batch_size = g->batch_size;
+  const int n_vocab = lctx.model.hparams.n_vocab;
+  const int n_embd = lctx.model.hparams.n_embd;
+
+  // run the computation
+  ne_build_forward_expand(&g->gf, logits);
+  ne_graph_fuse(&g->gf);
+  ne_graph_compute(ctx0, &g->gf);
+
+#ifdef NE_PERF
+  bool engine_profiling_ = (getenv("ENGINE_PROFILING") != NULL);
+  if (engine_profiling_) {
+    ne_graph_profiling(&g->gf);
+  }
+#endif
+
+  // update kv token count
+  lctx.model.kv_self.n = g->n_past + N;
+
+  // extract logits
+  {
+    auto& logits_out = lctx.logits;
+
+    const size_t bs_stride = n_vocab * N;
+    if (lctx.logits_all) {
+      logits_out.resize(n_vocab * N * batch_size);
+      memcpy(logits_out.data(), (float*)ne_get_data(logits), sizeof(float) * n_vocab * N * batch_size);
+    } else {
+      // return result for just the last token
+      logits_out.resize(n_vocab * batch_size);
+      for (int i = 0; i < batch_size; ++i) {
+        memcpy(logits_out.data() + (i * n_vocab), (float*)ne_get_data(logits) + (i * bs_stride) + (n_vocab * (N - 1)),
+               sizeof(float) * n_vocab);
+      }
+    }
+  }
+
+  // extract embeddings
+  if (!lctx.embedding.empty()) {
+    auto& embedding_out = lctx.embedding;
+
+    embedding_out.resize(n_embd);
+    memcpy(embedding_out.data(), (float*)ne_get_data(embeddings) + (n_embd * (N - 1)), sizeof(float) * n_embd);
+  }
+
+  if (lctx.mem_per_token == 0) {
+    lctx.mem_per_token = ne_used_mem(ctx0) / N;
+  }
+
+  ne_free(ctx0);
+
+  // measure the performance only for the single-token evals
+  int64_t time_interval = ne_time_us() - g->t_start_us;
+  if (N == 1) {
+    lctx.t_eval_us += time_interval;
+    lctx.n_eval++;
+  } else if (N > 1) {
+    lctx.t_p_eval_us += time_interval;
+    lctx.n_p_eval += N;
+  }
+  lctx.eval_times.push_back(time_interval);
+
+  return true;
+}
+
+struct ne_tensor* model_norm(struct ne_context* ctx, const model_norm_type type, struct ne_tensor* x,
+                             struct ne_tensor* w, struct ne_tensor* b) {
+  struct ne_tensor* cur = type == MODEL_NORM_RMS ? ne_rms_norm(ctx, x) : ne_norm(ctx, x);
+  if (w != NULL) {
+    cur = ne_mul(ctx, cur, w);
+  }
+  if (b != NULL) {
+    cur = ne_add(ctx, cur, b);
+  }
+  return cur;
+}
+
+struct ne_tensor* model_linear(struct ne_context* ctx, struct ne_tensor* w, struct ne_tensor* b, struct ne_tensor* x) {
+  if (b == NULL) {
+    return ne_mul_mat(ctx, w, x);
+  }
+  if (w->type == NE_TYPE_JBLAS) {
+    // bias added in the epilogue of the GEMM
+    return ne_mul_mat_with_bias(ctx, w, b, x);
+  }
+  return ne_add(ctx, ne_mul_mat(ctx, w, x), b);
+}
+
+static struct ne_tensor* model_ffn(struct ne_context* ctx, const model_block_config& config,
+                                   const model_block_weights& weights, struct ne_tensor* x) {
+  const bool jblas = weights.ffn_up->type == NE_TYPE_JBLAS && weights.ffn_down->type == NE_TYPE_JBLAS;
+  if (config.ffn == MODEL_FFN_SILU_GATED) {
+    if (jblas && weights.ffn_gate->type == NE_TYPE_JBLAS) {
+      return ne_ffn_silu(ctx, weights.ffn_gate, weights.ffn_down, weights.ffn_up, x);
+    }
+    struct ne_tensor* up = ne_mul_mat(ctx, weights.ffn_up, x);
+    struct ne_tensor* cur = ne_silu(ctx, ne_mul_mat(ctx, weights.ffn_gate, x));
+    cur = ne_mul(ctx, cur, up);
+    return ne_mul_mat(ctx, weights.ffn_down, cur);
+  }
+
+  if (jblas && weights.ffn_up_b != NULL && weights.ffn_down_b != NULL) {
+    return ne_ffn_add_gelu(ctx, weights.ffn_up, weights.ffn_down, weights.ffn_up_b, weights.ffn_down_b, x);
+  }
+  if (jblas && weights.ffn_up_b == NULL && weights.ffn_down_b == NULL) {
+    return ne_ffn_gelu(ctx, weights.ffn_up, weights.ffn_down, x);
+  }
+  struct ne_tensor* cur = ne_gelu(ctx, model_linear(ctx, weights.ffn_up, weights.ffn_up_b, x));
+  return model_linear(ctx, weights.ffn_down, weights.ffn_down_b, cur);
+}
+
+struct ne_tensor* model_block_forward(model_graph* g, const model_block_config& config,
+                                      const model_block_weights& weights, const int il, struct ne_tensor* x) {
+  model_context& lctx = *g->lctx;
+  struct ne_context* ctx0 = g->ctx0;
+  const auto& hparams = lctx.model.hparams;
+  const auto& kv_self = lctx.model.kv_self;
+
+  const int N = g->n_tokens;
+  const int n_past = g->n_past;
+  const int batch_size = g->batch_size;
+  const int n_embd = hparams.n_embd;
+  const int n_ctx = hparams.n_ctx;
+  const int n_head = hparams.n_head;
+  const int head_dim = n_embd / n_head;
+  const int n_head_kv = config.n_head_kv > 0 ? config.n_head_kv : n_head;
+  const int n_embd_kv = n_head_kv * head_dim;
+  const int kv_n_ctx_block = lctx.kv_n_ctx_block;
+  const float attn_scale = 1.0f / sqrtf(static_cast<float>(head_dim));
+  const bool alibi = config.pos == MODEL_POS_ALIBI;
+  MODEL_ASSERT(n_head % n_head_kv == 0);
+
+  lctx.use_buf(ctx0, 0);
+
+  struct ne_tensor* attn_in = model_norm(ctx0, config.norm, x, weights.attn_norm_w, weights.attn_norm_b);
+
+  // Q, K and V of the new tokens, [head_dim, n_head or n_head_kv, N, batch_size]
+  struct ne_tensor *Qcur, *Kcur, *Vcur;
+  if (config.qkv == MODEL_QKV_SEPARATE) {
+    if (weights.wq->type == NE_TYPE_JBLAS && weights.wk->type == NE_TYPE_JBLAS && weights.wv->type == NE_TYPE_JBLAS &&
+        n_head_kv == n_head) {
+      // fused execution of QKV
+      struct ne_tensor* QKVcur = ne_mul_qkv(ctx0, weights.wq, weights.wk, weights.wv, attn_in);
+      if (config.clip_qkv > 0) {
+        QKVcur = ne_clamp(ctx0, QKVcur, -config.clip_qkv, config.clip_qkv);
+      }
+      const int64_t n_elements = N * batch_size * n_embd;
+      const size_t nb = n_elements * ne_element_size(QKVcur);
+      Qcur = ne_reshape_4d(ctx0, ne_view_1d(ctx0, QKVcur, n_elements, 0 * nb), head_dim, n_head, N, batch_size);
+      Kcur = ne_reshape_4d(ctx0, ne_view_1d(ctx0, QKVcur, n_elements, 1 * nb), head_dim, n_head, N, batch_size);
+      Vcur = ne_reshape_4d(ctx0, ne_view_1d(ctx0, QKVcur, n_elements, 2 * nb), head_dim, n_head, N, batch_size);
+    } else {
+      struct ne_tensor* cur[3] = {ne_mul_mat(ctx0, weights.wq, attn_in), ne_mul_mat(ctx0, weights.wk, attn_in),
+                                  ne_mul_mat(ctx0, weights.wv, attn_in)};
+      for (int i = 0; i < 3 && config.clip_qkv > 0; ++i) {
+        cur[i] = ne_clamp(ctx0, cur[i], -config.clip_qkv, config.clip_qkv);
+      }
+      Qcur = ne_reshape_4d(ctx0, cur[0], head_dim, n_head, N, batch_size);
+      Kcur = ne_reshape_4d(ctx0, cur[1], head_dim, n_head_kv, N, batch_size);
+      Vcur = ne_reshape_4d(ctx0, cur[2], head_dim, n_head_kv, N, batch_size);
+    }
+  } else {
+    struct ne_tensor* QKVcur = model_linear(ctx0, weights.wqkv, weights.bqkv, attn_in);
+    if (config.clip_qkv > 0) {
+      QKVcur = ne_clamp(ctx0, QKVcur, -config.clip_qkv, config.clip_qkv);
+    }
+    // views of the rows of the fused QKV
+    const bool per_head = config.qkv == MODEL_QKV_FUSED_PER_HEAD;
+    MODEL_ASSERT(!per_head || n_head_kv == n_head);
+    const size_t es = ne_element_size(QKVcur);
+    const size_t row_nb = QKVcur->nb[1];
+    const size_t head_nb = (per_head ? 3 : 1) * head_dim * es;
+    const size_t k_offset = (per_head ? head_dim : n_embd) * es;
+    const size_t v_offset = (per_head ? 2 * head_dim : n_embd + n_embd_kv) * es;
+    Qcur = ne_view_4d(ctx0, QKVcur, head_dim, n_head, N, batch_size, head_nb, row_nb, N * row_nb, 0);
+    Kcur = ne_view_4d(ctx0, QKVcur, head_dim, n_head_kv, N, batch_size, head_nb, row_nb, N * row_nb, k_offset);
+    Vcur = ne_view_4d(ctx0, QKVcur, head_dim, n_head_kv, N, batch_size, head_nb, row_nb, N * row_nb, v_offset);
+  }
+
+  ne_set_name(Qcur, "Qcur");
+  ne_set_name(Kcur, "Kcur");
+  ne_set_name(Vcur, "Vcur");
+
+  // RoPE of Q and K, and K and V of the new tokens stored to memory, in one pass
+  // important: storing RoPE-ed version of K in the KV cache!
+  const size_t k_es = ne_element_size(kv_self.k);
+  const size_t v_es = ne_element_size(kv_self.v);
+  // the sequences of the batch are the blocks of the KV cache of layer il
+  const size_t block_offset = il * kv_n_ctx_block * n_ctx + n_past;
+  struct ne_tensor* k = ne_view_4d(ctx0, kv_self.k, head_dim, n_head_kv, N, batch_size, k_es * head_dim,
+                                   k_es * n_embd_kv, k_es * n_embd_kv * n_ctx, k_es * n_embd_kv * block_offset);
+  // [N, head_dim, n_head_kv, batch_size] of the transposed cache
+  struct ne_tensor* v = ne_view_4d(ctx0, kv_self.v, N, head_dim, n_head_kv, batch_size, v_es * n_ctx,
+                                   v_es * n_ctx * head_dim, v_es * n_ctx * n_embd_kv,
+                                   v_es * (il * kv_n_ctx_block * n_ctx * n_embd_kv + n_past));
+  struct ne_tensor *k_scale = NULL, *v_scale = NULL;
+  if (kv_self.k->type == NE_TYPE_I8) {
+    // quantize per token and head
+    const size_t scale_nb1 = sizeof(float) * n_head_kv;
+    k_scale = ne_view_3d(ctx0, kv_self.k_scale, n_head_kv, N, batch_size, scale_nb1, scale_nb1 * n_ctx,
+                         scale_nb1 * block_offset);
+    v_scale = ne_view_3d(ctx0, kv_self.v_scale, n_head_kv, N, batch_size, scale_nb1, scale_nb1 * n_ctx,
+                         scale_nb1 * block_offset);
+  }
+  const bool rope = config.pos == MODEL_POS_ROPE || config.pos == MODEL_POS_ROPE_NEOX;
+  const int rope_mode = config.pos == MODEL_POS_ROPE_NEOX ? 2 : 0;
+  Qcur = ne_rope_kv(ctx0, Qcur, Kcur, Vcur, k, v, k_scale, v_scale, n_past, rope ? config.n_rot : 0, rope_mode);
+
+  // [head_dim, N, n_head, batch_size]
+  struct ne_tensor* Q = ne_permute(ctx0, Qcur, 0, 2, 1, 3);
+  ne_set_name(Q, "Q");
+
+  // the cached K and V of the layer, [head_dim, n_past + N, n_head_kv, batch_size]
+  // and [n_past + N, head_dim, n_head_kv, batch_size]
+  const int n_all = n_past + N;
+  const size_t layer_offset = il * kv_n_ctx_block * n_ctx * n_embd_kv;
+  struct ne_tensor* K = ne_permute(
+      ctx0,
+      ne_view_4d(ctx0, kv_self.k, head_dim, n_head_kv, n_all, batch_size, k_es * head_dim, k_es * n_embd_kv,
+                 k_es * n_embd_kv * n_ctx, k_es * layer_offset),
+      0, 2, 1, 3);
+  ne_set_name(K, "K");
+  struct ne_tensor* V = ne_view_4d(ctx0, kv_self.v, n_all, head_dim, n_head_kv, batch_size, v_es * n_ctx,
+                                   v_es * n_ctx * head_dim, v_es * n_ctx * n_embd_kv, v_es * layer_offset);
+  ne_set_name(V, "V");
+
+  // the fused attention adds the ALiBi biases and masks on the fly
+  const float alibi_max_bias = alibi ? config.alibi_bias_max : 0.f;
+  struct ne_tensor* cur;
+  if (kv_self.k->type == NE_TYPE_I8) {
+    // the int8 cache is only read by the fused attention, for the prompt too
+    const size_t scale_offset = sizeof(float) * n_head_kv * n_ctx * il * kv_n_ctx_block;
+    struct ne_tensor* K_scale = ne_view_3d(ctx0, kv_self.k_scale, n_head_kv, n_all, batch_size,
+                                           sizeof(float) * n_head_kv, sizeof(float) * n_head_kv * n_ctx, scale_offset);
+    struct ne_tensor* V_scale = ne_view_3d(ctx0, kv_self.v_scale, n_head_kv, n_all, batch_size,
+                                           sizeof(float) * n_head_kv, sizeof(float) * n_head_kv * n_ctx, scale_offset);
+    struct ne_tensor* KQV = ne_flash_attn_kv(ctx0, Q, K, V, K_scale, V_scale, attn_scale, true, alibi_max_bias);
+    cur = ne_view_2d(ctx0, KQV, n_embd, N * batch_size, n_embd * ne_element_size(KQV), 0);
+  } else if ((alibi || n_past > 0) && kv_self.k->type == NE_TYPE_F16) {
+    // next tokens, and the prompt of ALiBi: read the KV cache once, without the KQ matrix
+    struct ne_tensor* KQV = ne_flash_attn_kv(ctx0, Q, K, V, NULL, NULL, attn_scale, true, alibi_max_bias);
+    cur = ne_view_2d(ctx0, KQV, n_embd, N * batch_size, n_embd * ne_element_size(KQV), 0);
+  } else if (config.prompt_flash_attn && n_past == 0 && kv_self.k->type == NE_TYPE_F16 &&
+             n_head_kv == n_head) {
+    // the prompt: the dense flash attention reads V per token, in f16
+    struct ne_tensor* Vtmp =
+        ne_cpy(ctx0, Vcur, ne_new_tensor_4d(ctx0, NE_TYPE_F16, head_dim, n_head, N, batch_size, NE_SIZE_CALC));
+    Vtmp = ne_permute(ctx0, Vtmp, 1, 2, 0, 3);
+    struct ne_tensor* KQV = ne_flash_attn(ctx0, Q, K, Vtmp, attn_scale, true);
+    cur = ne_view_2d(ctx0, KQV, n_embd, N * batch_size, n_embd * ne_element_size(KQV), 0);
+  } else {
+    // K * Q
+    struct ne_tensor* KQ = ne_mul_mat(ctx0, K, Q);
+    ne_set_name(KQ, "KQ");
+
+    // KQ_scaled = KQ / sqrt(head_dim)
+    struct ne_tensor* KQ_scale = ne_new_f32(ctx0, attn_scale);
+    ne_set_name(KQ_scale, "1/sqrt(n_embd/n_head)");
+
+    // KQ_scaled shape [n_past + N, N, n_head, batch_size]
+    struct ne_tensor* KQ_scaled = ne_scale_inplace(ctx0, KQ, KQ_scale);
+    ne_set_name(KQ_scaled, "KQ_scaled");
+
+    if (alibi) {
+      KQ_scaled = ne_alibi(ctx0, KQ_scaled, n_past, n_head, config.alibi_bias_max);
+    }
+
+    // KQ_masked = mask_past(KQ_scaled)
+    struct ne_tensor* KQ_masked = ne_diag_mask_inf_inplace(ctx0, KQ_scaled, n_past);
+    ne_set_name(KQ_masked, "KQ_masked");
+
+    // KQ = soft_max(KQ_masked)
+    struct ne_tensor* KQ_soft_max = ne_soft_max_inplace(ctx0, KQ_masked);
+    ne_set_name(KQ_soft_max, "KQ_soft_max");
+
+    struct ne_tensor* KQV = ne_mul_mat(ctx0, V, KQ_soft_max);
+    ne_set_name(KQV, "KQV");
+
+    // KQV_merged = KQV.permute(0, 2, 1, 3)
+    struct ne_tensor* KQV_merged = ne_permute(ctx0, KQV, 0, 2, 1, 3);
+    ne_set_name(KQV_merged, "KQV_merged");
+
+    // cur = KQV_merged.contiguous().view(n_embd, N * batch_size)
+    cur = ne_cpy(ctx0, KQV_merged, ne_new_tensor_2d(ctx0, NE_TYPE_F32, n_embd, N * batch_size, NE_SIZE_CALC));
+  }
+  ne_set_name(cur, "KQV_merged_contiguous");
+
+  // projection
+  struct ne_tensor* attn_out = model_linear(ctx0, weights.wo, weights.bo, cur);
+  ne_set_name(attn_out, "KQV_out");
+
+  lctx.use_buf(ctx0, 1);
+
+  if (config.parallel_residual) {
+    // the FFN is independent of the self-attention result
+    struct ne_tensor* ffn_in = weights.ffn_norm_w == NULL
+                                   ? attn_in
+                                   : model_norm(ctx0, config.norm, x, weights.ffn_norm_w, weights.ffn_norm_b);
+    cur = model_ffn(ctx0, config, weights, ffn_in);
+    cur = ne_add(ctx0, cur, attn_out);
+    return ne_add(ctx0, cur, x);
+  }
+
+  struct ne_tensor* inpFF = ne_add(ctx0, attn_out, x);
+  cur = model_ffn(ctx0, config, weights, model_norm(ctx0, config.norm, inpFF, weights.ffn_norm_w, weights.ffn_norm_b));
+  return ne_add(ctx0, cur, inpFF);
+}
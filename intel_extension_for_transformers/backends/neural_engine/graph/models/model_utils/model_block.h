@@ -0,0 +1,104 @@
+//  Copyright (c) 2023 Intel Corporation
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+#ifndef MODEL_BLOCK_H
+#define MODEL_BLOCK_H
+
+#include "core/ne_layers.h"
+#include "models/model_utils/model_types.h"
+
+// A decoder block is described by a model_block_config and built by model_block_forward, so that all the models share
+// the same graph of QKV, positional encoding, KV cache, attention and FFN, with the same fusions.
+//
+// The KV cache of all the models has one layout, with n_embd_kv = n_head_kv * head_dim:
+//   K:     [n_layer, kv_n_ctx_block, n_ctx, n_embd_kv]                 (token-major, head_dim is contiguous)
+//   V:     [n_layer, kv_n_ctx_block, n_head_kv, head_dim, n_ctx]       (transposed, n_ctx is contiguous)
+//   scale: [n_layer, kv_n_ctx_block, n_ctx, n_head_kv]                 (int8 cache only, for both K and V)
+
+enum model_norm_type {
+  MODEL_NORM_LAYER,  // (x - mean) / std * w + b
+  MODEL_NORM_RMS,    // x / rms * w
+};
+
+enum model_pos_type {
+  MODEL_POS_NONE,       // no positional encoding in the block (e.g. learned position embedding)
+  MODEL_POS_ROPE,       // rotary embedding of GPT-J, rotate interleaved pairs
+  MODEL_POS_ROPE_NEOX,  // rotary embedding of GPT-NeoX, rotate the two halves
+  MODEL_POS_ALIBI,      // linear biases of the attention scores
+};
+
+enum model_qkv_type {
+  MODEL_QKV_SEPARATE,        // wq, wk, wv
+  MODEL_QKV_FUSED,           // wqkv rows are [q | k | v]
+  MODEL_QKV_FUSED_PER_HEAD,  // wqkv rows are [q k v] of each head in turn (GPT-NeoX)
+};
+
+enum model_ffn_type {
+  MODEL_FFN_GELU,        // down(gelu(up(x)))
+  MODEL_FFN_SILU_GATED,  // down(silu(gate(x)) * up(x))
+};
+
+struct model_block_config {
+  model_norm_type norm = MODEL_NORM_LAYER;
+  model_pos_type pos = MODEL_POS_NONE;
+  int n_rot = 0;                   // rotary dims
+  float alibi_bias_max = 0;        // MODEL_POS_ALIBI
+  float clip_qkv = 0;              // clamp QKV to [-clip_qkv, clip_qkv] if > 0
+  model_qkv_type qkv = MODEL_QKV_SEPARATE;
+  int n_head_kv = 0;               // heads of K and V, 0 for n_head (multi-query / grouped-query if fewer)
+  bool parallel_residual = false;  // x + attn(norm(x)) + ffn(norm(x)), the FFN norm is shared if it has no weight
+  model_ffn_type ffn = MODEL_FFN_GELU;
+  bool prompt_flash_attn = false;  // bf16 (AMX) flash attention for the prompt of a f16 cache
+};
+
+// weights of a block, NULL for the unused ones
+struct model_block_weights {
+  struct ne_tensor *attn_norm_w, *attn_norm_b;
+  struct ne_tensor *ffn_norm_w, *ffn_norm_b;
+  struct ne_tensor *wq, *wk, *wv;  // MODEL_QKV_SEPARATE
+  struct ne_tensor *wqkv, *bqkv;   // MODEL_QKV_FUSED / MODEL_QKV_FUSED_PER_HEAD
+  struct ne_tensor *wo, *bo;
+  struct ne_tensor *ffn_up, *ffn_up_b;
+  struct ne_tensor* ffn_gate;  // MODEL_FFN_SILU_GATED
+  struct ne_tensor *ffn_down, *ffn_down_b;
+};
+
+// the graph of one model_eval call over n_tokens tokens of each of the lctx.batch_size sequences
+struct model_graph {
+  model_context* lctx;
+  struct ne_context* ctx0;
+  ne_cgraph gf;
+  struct ne_tensor* embd;  // token ids, [n_tokens * batch_size] I32
+  int n_tokens;
+  int n_past;
+  int batch_size;
+  int64_t t_start_us;
+};
+
+void model_graph_init(model_graph* g, model_context& lctx, const model_token* tokens, int n_tokens, int n_past,
+                      int n_threads);
+
+// computes the graph of the logits [n_vocab, n_tokens * batch_size] and extracts the logits and the embeddings
+bool model_graph_compute(model_graph* g, struct ne_tensor* logits, struct ne_tensor* embeddings);
+
+struct ne_tensor* model_norm(struct ne_context* ctx, model_norm_type type, struct ne_tensor* x, struct ne_tensor* w,
+                             struct ne_tensor* b);
+
+// w * x + b, b may be NULL
+struct ne_tensor* model_linear(struct ne_context* ctx, struct ne_tensor* w, struct ne_tensor* b, struct ne_tensor* x);
+
+// the output of block il, x is [n_embd, n_tokens * batch_size]
+struct ne_tensor* model_block_forward(model_graph* g, const model_block_config& config,
+                                      const model_block_weights& weights, int il, struct ne_tensor* x);
+
+#endif  // MODEL_BLOCK_H
@@ -70,6 +70,7 @@ struct gpt_params {
   std::string lora_base = "";     // base model path for the lora adapter
 
   bool memory_f16 = true;         // use f16 instead of f32 for memory kv
+  bool memory_i8 = false;         // use int8 with per token and head scales for memory kv, over memory_f16
   bool random_prompt = false;     // do not randomize prompt if none provided
   bool use_color = false;         // use color to distinguish generations and inputs
   bool interactive = false;       // interactive mode
@@ -89,6 +90,12 @@ struct gpt_params {
   int batch_size = 1;           // number batch of prompt
   bool beam_search = false;     // use beam_search or not
   int beam_size = 1;            // only valid if use beam search
+  enum model_compute_type compute_type = MODEL_COMPUTE_AUTO;  // gemm computation type of jblas weights
+  int numa_nodes = 1;           // NUMA nodes to split the jblas gemms over, 0 for all of them
+  bool huge_pages = true;       // back the weights, KV cache and scratch buffers with huge pages if possible
+  enum ne_mem_policy mem_policy = NE_MEM_POLICY_DEFAULT;  // NUMA placement of those buffers
+  int mem_node = 0;             // node of NE_MEM_POLICY_BIND
+  bool compress_session = false;  // deflate the KV cache of saved session files, needs NE_ZLIB
 };
 
 bool gpt_params_parse(int argc, char** argv, gpt_params& params);
@@ -203,6 +203,7 @@ struct model_file_loader {
     hparams.n_embd = file.read_u32();
     hparams.n_mult = file.read_u32();
     hparams.n_head = file.read_u32();
+    hparams.n_head_kv = hparams.n_head;  // not in the file, the model loader infers it from the K and V weights
     hparams.n_layer = file.read_u32();
     hparams.n_rot = file.read_u32();
     hparams.ftype = (enum ne_ftype)file.read_u32();
@@ -440,6 +441,15 @@ struct model_model_loader {
     return get_tensor_for(lt, backend);
   }
 
+  // the shape of a tensor before it is created, to infer the hparams that are not in the file header
+  const std::vector<uint32_t>& get_tensor_ne(const std::string& name) const {
+    auto it = tensors_map.name_to_idx.find(name);
+    if (it == tensors_map.name_to_idx.end()) {
+      throw format("model.cpp: tensor '%s' is missing from model", name.c_str());
+    }
+    return tensors_map.tensors.at(it->second).ne;
+  }
+
   struct ne_tensor* get_tensor_for(model_load_tensor& lt, ne_backend backend) {
     struct ne_tensor* tensor;
     if (lt.ne.size() == 2) {
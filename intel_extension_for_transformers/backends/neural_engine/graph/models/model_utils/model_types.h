@@ -59,13 +59,21 @@
 #define MODEL_FILE_MAGIC MODEL_FILE_MAGIC_GGJT
 #define MODEL_FILE_MAGIC_UNVERSIONED MODEL_FILE_MAGIC_NE
 #define MODEL_SESSION_MAGIC MODEL_FILE_MAGIC_GGSN
-#define MODEL_SESSION_VERSION 1
+#define MODEL_SESSION_VERSION 3
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 enum model_name { MODEL_UNKNOWN, MODEL_LLAMA, MODEL_GPTJ, MODEL_MPT, MODEL_GPTNEOX, MODEL_STARCODER, MODEL_FALCON };
 
+// gemm computation type of the jblas weights, the weights are repacked at load time if it differs from the file
+enum model_compute_type {
+  MODEL_COMPUTE_AUTO,  // as packed by the quantization
+  MODEL_COMPUTE_FP32,
+  MODEL_COMPUTE_BF16,
+  MODEL_COMPUTE_INT8,  // activations quantized dynamically per token and k-block
+};
+
 static const size_t MB = 1024 * 1024;
 
 struct model_scratch {
@@ -96,6 +104,7 @@ struct model_hparams {
   uint32_t n_embd = 4096;
   uint32_t n_mult = 256;
   uint32_t n_head = 32;
+  uint32_t n_head_kv = 32;  // heads of K and V, fewer than n_head for multi-query / grouped-query attention
   uint32_t n_layer = 32;
   uint32_t n_rot = 64;
   enum ne_ftype ftype = NE_FTYPE_MOSTLY_F16;
@@ -105,7 +114,10 @@ struct model_hparams {
   int32_t par_res = 1;       // for neox 1 = true, 0 = false
 
   bool operator!=(const model_hparams& other) const {
-    return static_cast<bool>(memcmp(this, &other, sizeof(model_hparams)));
+    return n_vocab != other.n_vocab || n_ctx != other.n_ctx || n_embd != other.n_embd || n_mult != other.n_mult ||
+           n_head != other.n_head || n_head_kv != other.n_head_kv || n_layer != other.n_layer ||
+           n_rot != other.n_rot || ftype != other.ftype || max_seq_len != other.max_seq_len ||
+           alibi_bias_max != other.alibi_bias_max || clip_qkv != other.clip_qkv || par_res != other.par_res;
   }
 };
 
@@ -123,6 +135,9 @@ struct model_layer {
 struct model_kv_cache {
   struct ne_tensor* k;
   struct ne_tensor* v;
+  // f32 scales of the int8 K and V, one per token and head, NULL if the cache is not int8
+  struct ne_tensor* k_scale = NULL;
+  struct ne_tensor* v_scale = NULL;
 
   struct ne_context* ctx = NULL;
 
@@ -130,6 +145,10 @@ struct model_kv_cache {
 
   int n;  // number of tokens currently in the cache
 
+  // the rotary embedding of the cached K (rotary dims, 0 if K is not rotated, and ne_rope mode), set at load
+  int rope_dims = 0;
+  int rope_mode = 0;
+
   ~model_kv_cache() {
     if (ctx) {
       ne_free(ctx);
@@ -159,6 +178,9 @@ struct model_struct {
   // model memory mapped file
   std::unique_ptr<model_mmap> mapping;
 
+  // jblas weights repacked for another compute type than the one of the model file
+  std::vector<std::unique_ptr<model_buffer>> repacked_bufs;
+
   // objects representing data potentially being locked in memory
   model_mlock mlock_buf;
   model_mlock mlock_mmap;
@@ -208,6 +230,7 @@ struct model_context {
   bool beam_search = false;
   int beam_size = 1;
   int kv_n_ctx_block = 1;
+  bool compress_session = false;
   std::vector<std::vector<std::string>> tensors_name;
 
   size_t mem_per_token = 0;
@@ -289,6 +312,7 @@ struct model_context_params {
   int n_gpu_layers;  // number of layers to store in VRAM
   int seed;          // RNG seed, -1 for random
   bool f16_kv;       // use fp16 for KV cache
+  bool i8_kv;        // use int8 with per token and head scales for KV cache, over f16_kv
   bool logits_all;   // the model_eval() call computes all logits, not just the last one
   bool vocab_only;   // only load the vocabulary, no weights
   bool use_mmap;     // use mmap if possible
@@ -297,6 +321,12 @@ struct model_context_params {
   int batch_size;    // batch_size of prompt
   bool beam_search;  // beam search or not
   int beam_size;     // number of beams for beam search
+  enum model_compute_type compute_type;  // gemm computation type of the jblas weights
+  int numa_nodes;                        // NUMA nodes to split the jblas gemms over, 0 for all, 1 to not split
+  bool huge_pages;                       // back the weights, KV cache and scratch buffers with huge pages if possible
+  enum ne_mem_policy mem_policy;         // NUMA placement of those buffers
+  int mem_node;                          // node of NE_MEM_POLICY_BIND
+  bool compress_session;                 // deflate the KV cache of saved session files, needs NE_ZLIB
 
   // called with a progress value between 0 and 1, pass NULL to disable
   model_progress_callback progress_callback;
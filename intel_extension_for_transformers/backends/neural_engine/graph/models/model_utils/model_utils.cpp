@@ -41,8 +41,13 @@
 #include <iostream>
 
 #include "core/ne_layers.h"
+#include "core/layers/inner_product.h"
+#ifdef NE_USE_ZLIB
+#include <zlib.h>
+#endif
 #include "application/common.h"
 #include "jblas/jblas/jit_blas_weight_compression.h"
+#include "models/model_utils/model_config.h"
 #include "models/model_utils/model_files.h"
 #include "models/model_utils/model_utils.h"
 #include "models/model_utils/util.h"
@@ -53,13 +58,18 @@
 //
 
 static bool kv_cache_init(const struct model_hparams& hparams, struct model_kv_cache& cache, ne_type wtype, int n_ctx) {
-  const int n_embd = hparams.n_embd;
   const int n_layer = hparams.n_layer;
 
+  // K and V are cached per KV head only, the query heads of a group share them
+  const int n_head_kv = hparams.n_head_kv;
+  const int n_embd_kv = n_head_kv * (hparams.n_embd / hparams.n_head);
+
   const int64_t n_mem = n_layer * n_ctx;
-  const int64_t n_elements = n_embd * n_mem;
+  const int64_t n_elements = n_embd_kv * n_mem;
+  // int8 K and V have a scale per token and KV head
+  const int64_t n_scales = wtype == NE_TYPE_I8 ? n_head_kv * n_mem : 0;
 
-  cache.buf.resize(2u * n_elements * ne_type_size(wtype) + 2u * MB);
+  cache.buf.resize(2u * n_elements * ne_type_size(wtype) + 2u * n_scales * sizeof(float) + 2u * MB);
 
   struct ne_init_params params;
   params.mem_size = cache.buf.size;
@@ -77,10 +87,54 @@ static bool kv_cache_init(const struct model_hparams& hparams, struct model_kv_c
   cache.v = ne_new_tensor_1d(cache.ctx, wtype, n_elements, NE_SIZE_CALC);
   ne_set_name(cache.k, "cache_k");
   ne_set_name(cache.v, "cache_v");
+  if (n_scales != 0) {
+    cache.k_scale = ne_new_tensor_1d(cache.ctx, NE_TYPE_F32, n_scales, NE_SIZE_CALC);
+    cache.v_scale = ne_new_tensor_1d(cache.ctx, NE_TYPE_F32, n_scales, NE_SIZE_CALC);
+    ne_set_name(cache.k_scale, "cache_k_scale");
+    ne_set_name(cache.v_scale, "cache_v_scale");
+  }
 
   return true;
 }
 
+// the rotary embedding the model graph applies to K before caching it, model_kv_cache_shift re-rotates the cached K
+// with it. It matches the MODEL_POS_* and n_rot of the block config of each model.
+static void kv_cache_rope_init(const model_name name, const struct model_hparams& hparams,
+                               struct model_kv_cache& cache) {
+  switch (name) {
+    case MODEL_LLAMA:
+      cache.rope_dims = hparams.n_embd / hparams.n_head;
+      cache.rope_mode = 0;
+      break;
+    case MODEL_GPTJ:
+      cache.rope_dims = hparams.n_rot;
+      cache.rope_mode = 0;
+      break;
+    case MODEL_GPTNEOX:
+      cache.rope_dims = hparams.n_rot;
+      cache.rope_mode = 2;
+      break;
+    case MODEL_FALCON:
+      cache.rope_dims = hparams.n_embd / hparams.n_head;
+      cache.rope_mode = 2;
+      break;
+    default:
+      // ALiBi or learned positions, K is cached as is
+      cache.rope_dims = 0;
+      cache.rope_mode = 0;
+      break;
+  }
+}
+
+void model_context_params_from_gpt_params(const gpt_params& params, struct model_context_params* lparams) {
+  lparams->compute_type = params.compute_type;
+  lparams->numa_nodes = params.numa_nodes;
+  lparams->huge_pages = params.huge_pages;
+  lparams->mem_policy = params.mem_policy;
+  lparams->mem_node = params.mem_node;
+  lparams->compress_session = params.compress_session;
+}
+
 struct model_context_params model_context_default_params() {
   struct model_context_params result = {
       /*name                         =*/MODEL_LLAMA,
@@ -88,6 +142,7 @@ struct model_context_params model_context_default_params() {
       /*.gpu_layers                  =*/0,
       /*.seed                        =*/-1,
       /*.f16_kv                      =*/true,
+      /*.i8_kv                       =*/false,
       /*.logits_all                  =*/false,
       /*.vocab_only                  =*/false,
       /*.use_mmap                    =*/true,
@@ -96,6 +151,12 @@ struct model_context_params model_context_default_params() {
       /*.batch_size                  =*/1,
       /*.beam_search                 =*/false,
       /*.beam_size                   =*/1,
+      /*.compute_type                =*/MODEL_COMPUTE_AUTO,
+      /*.numa_nodes                  =*/1,
+      /*.huge_pages                  =*/true,
+      /*.mem_policy                  =*/NE_MEM_POLICY_DEFAULT,
+      /*.mem_node                    =*/0,
+      /*.compress_session            =*/false,
       /*.progress_callback           =*/nullptr,
       /*.progress_callback_user_data =*/nullptr,
   };
@@ -137,6 +198,158 @@ static bool model_load(const std::string& fname, model_name name, model_context&
   }
 }
 
+//
+// jblas weight repacking
+//
+
+// the int8 gemm cores all read the 48x4 interleaved layout of AVX512_VNNI_8X48
+static jblas::gemm::GemmCoreType jblas_layout_core(jblas::gemm::GemmCoreType type) {
+  using CoreType = jblas::gemm::GemmCoreType;
+  if (type == CoreType::AVX512_VNNI_3X48_KBLOCK || type == CoreType::AMX_INT8_16X48_KBLOCK) {
+    return CoreType::AVX512_VNNI_8X48;
+  }
+  return type;
+}
+
+template <class _Weight_T>
+static jblas::prologue::PackedWeight* jblas_repack_to(_Weight_T* weight, const jblas::prologue::PackedWeight* src,
+                                                      int n, int k,
+                                                      jblas::prologue::weight_comp::gemm::WeightCompType type) {
+  using CoreType = jblas::gemm::GemmCoreType;
+  switch (jblas_layout_core(src->mCoreType)) {
+    case CoreType::AVX512F_8X48:
+      return weight->template repackWeight<jblas::gemm::GemmCore_Row_NN_8x48_AVX512F>(n, k, src, type);
+    case CoreType::AVX512_VNNI_8X48:
+      return weight->template repackWeight<jblas::gemm::GemmCore_Row_NN_8x48_AVX512_VNNI>(n, k, src, type);
+    case CoreType::AMX_BF16_16x64:
+      return weight->template repackWeight<jblas::gemm::GemmCore_Row_NN_16x64_AMX_BF16>(n, k, src, type);
+    default:
+      return NULL;
+  }
+}
+
+// repack a jblas int4 weight of n x k for the gemm core of compute_type, NULL if it is packed for it already or if
+// its block size does not fit the core
+static jblas::prologue::PackedWeight* jblas_repack(void* data, int n, int k, model_compute_type compute_type) {
+  using CompType = jblas::prologue::weight_comp::gemm::WeightCompType;
+  using CoreType = jblas::gemm::GemmCoreType;
+  auto src = jblas::prologue::weight_comp::gemm::CompressedPackedWeight::deserialBuffer(data, 0);
+  if (src == NULL) {
+    return NULL;
+  }
+  jblas::prologue::PackedWeight* dst = NULL;
+  auto type = static_cast<CompType>(src->mType);
+  auto layout = jblas_layout_core(src->mCoreType);
+  int blocksize = dynamic_cast<jblas::prologue::weight_comp::PackedWeightKBlock*>(src)->mBlockSize;
+  if (type == CompType::S4_F32 || type == CompType::S4_Bf16) {
+    if (compute_type == MODEL_COMPUTE_INT8 && layout != CoreType::AVX512_VNNI_8X48 &&
+        blocksize % jblas::gemm::GemmCore_Row_NN_8x48_AVX512_VNNI::KTILE == 0) {
+      using GemmKernel = jblas::wrapper::gemm_default::weight_comp::avx512_vnni::GemmKernelDynamicQuantS4KBlock;
+      static GemmKernel kernel;
+      // the int8 kernels only read f32 scales
+      dst = jblas_repack_to(kernel.getWeightPtr(), src, n, k, CompType::S4_F32);
+    } else if (compute_type == MODEL_COMPUTE_BF16 && layout != CoreType::AMX_BF16_16x64 &&
+               blocksize % jblas::gemm::GemmCore_Row_NN_16x64_AMX_BF16::KTILE == 0) {
+      using GemmKernel = jblas::wrapper::gemm_default::weight_comp::amx_bf16::GemmKernelS4KBlock;
+      static GemmKernel kernel;
+      dst = jblas_repack_to(kernel.getWeightPtr(), src, n, k, type);
+    } else if (compute_type == MODEL_COMPUTE_FP32 && layout != CoreType::AVX512F_8X48) {
+      using GemmKernel = jblas::wrapper::gemm_default::weight_comp::avx512f::GemmKernelS4KBlock;
+      static GemmKernel kernel;
+      dst = jblas_repack_to(kernel.getWeightPtr(), src, n, k, type);
+    }
+  }
+  delete src;
+  return dst;
+}
+
+// switch the jblas weights of a loaded model to the gemm of compute_type, so one quantized file serves every ISA
+static void model_repack_weights(model_struct& model, model_compute_type compute_type) {
+  auto cd = jblas::utils::parallel::CpuDevice::getInstance();
+  const char* name = NULL;
+  bool supported = false;
+  if (compute_type == MODEL_COMPUTE_INT8) {
+    name = "int8";
+    supported = cd->AVX512_VNNI();
+  } else if (compute_type == MODEL_COMPUTE_BF16) {
+    name = "bf16";
+    supported = cd->AMX_BF16();
+  } else if (compute_type == MODEL_COMPUTE_FP32) {
+    name = "fp32";
+    supported = cd->AVX512F();
+  } else {
+    return;
+  }
+  if (!supported) {
+    fprintf(stderr, "%s: %s gemm is not supported by this CPU, keeping the compute type of the model file\n",
+            __func__, name);
+    return;
+  }
+
+  const int64_t t_start_us = ne_time_us();
+  size_t n_repacked = 0;
+  size_t size_repacked = 0;
+  for (auto& kv : model.tensors_by_name) {
+    struct ne_tensor* tensor = kv.second;
+    if (tensor->type != NE_TYPE_JBLAS) {
+      continue;
+    }
+    auto packedw = jblas_repack(tensor->data, tensor->ne[1], tensor->ne[0], compute_type);
+    if (packedw == NULL) {
+      continue;
+    }
+    model.repacked_bufs.emplace_back(new model_buffer);
+    auto& buf = *model.repacked_bufs.back();
+    buf.resize(packedw->getSerializedSize());
+    packedw->serializeToBuffer(buf.addr);
+    tensor->data = buf.addr;
+    n_repacked++;
+    size_repacked += buf.size;
+    delete packedw;
+  }
+  if (n_repacked > 0) {
+    fprintf(stderr, "%s: repacked %zu weights for %s gemm = %7.2f MB in %.2f s\n", __func__, n_repacked, name,
+            size_repacked / 1024.0 / 1024.0, (ne_time_us() - t_start_us) / 1e6);
+  }
+}
+
+// the page size of the memory a weight lives in, the shards of the NUMA split are rounded to it
+static size_t model_weight_page_size(const model_struct& model, const void* data) {
+  auto inside = [data](const void* addr, size_t size) {
+    return data >= addr && data < static_cast<const uint8_t*>(addr) + size;
+  };
+  for (const auto& buf : model.repacked_bufs) {
+    if (inside(buf->addr, buf->size)) return buf->page_size;
+  }
+  if (inside(model.buf.addr, model.buf.size)) return model.buf.page_size;
+  if (model.mapping && inside(model.mapping->addr, model.mapping->size)) return ne_mem_advised_page_size();
+  return 0;
+}
+
+// column-split the jblas weights over the NUMA nodes, each node's thread group then reads its part from local memory
+static void model_numa_distribute(model_struct& model, int numa_nodes) {
+  const int n_nodes = jblas_set_numa_nodes(numa_nodes);
+  if (n_nodes <= 1) {
+    return;
+  }
+  const int64_t t_start_us = ne_time_us();
+  size_t n_weights = 0, n_split = 0, n_shards = 0;
+  for (auto& kv : model.tensors_by_name) {
+    struct ne_tensor* tensor = kv.second;
+    if (tensor->type != NE_TYPE_JBLAS) {
+      continue;
+    }
+    const int n_moved = jblas_weights_numa_distribute(tensor->data, model_weight_page_size(model, tensor->data));
+    n_weights++;
+    n_shards += n_moved;
+    if (n_moved == n_nodes) {
+      n_split++;
+    }
+  }
+  fprintf(stderr, "%s: split %zu of %zu weights over %d NUMA nodes (%zu of %zu shards moved) in %.2f s\n", __func__,
+          n_split, n_weights, n_nodes, n_shards, n_weights * n_nodes, (ne_time_us() - t_start_us) / 1e6);
+}
+
 //
 // tokenizer
 //
@@ -764,8 +977,12 @@ model_token model_sample_token(struct model_context* ctx, model_token_data_array
 // quantization
 //
 quant_params_internal quant_params_to_internal(const quant_params& params) {
-  return quant_params_internal{parse_bits(params.bits), parse_alg(params.alg), params.block_size,
-                               parse_scale_dtype(params.scale_dtype), parse_compute_type(params.compute_type)};
+  return quant_params_internal{parse_bits(params.bits),
+                               parse_alg(params.alg),
+                               params.block_size,
+                               parse_scale_dtype(params.scale_dtype),
+                               parse_compute_type(params.compute_type),
+                               parse_weight_dtype(params.weight_dtype)};
 }
 
 size_t jblas_quantize(const float* f32ptr, void* dstpr, const quant_params_internal params, int nthread, int n, int k) {
@@ -773,7 +990,11 @@ size_t jblas_quantize(const float* f32ptr, void* dstpr, const quant_params_inter
   auto cd = jblas::utils::parallel::CpuDevice::getInstance();
   jblas::prologue::PackedWeight* packedw = NULL;
   auto type = CompType::S4_F32;
-  if (params.bits == quant_bits::q4) {
+  if (params.weight_dtype == quant_wdtype::fp8_e4m3) {
+    type = CompType::F8E4M3_F32;
+  } else if (params.weight_dtype == quant_wdtype::fp8_e5m2) {
+    type = CompType::F8E5M2_F32;
+  } else if (params.bits == quant_bits::q4) {
     if (params.scale_dtype == quant_sdtype::bf16) {
       type = CompType::S4_Bf16;
     } else {
@@ -785,7 +1006,18 @@ size_t jblas_quantize(const float* f32ptr, void* dstpr, const quant_params_inter
     return 0;
   }
   cd->setThreads(nthread);
-  if (params.bits == quant_bits::q4) {
+  if (params.weight_dtype != quant_wdtype::integer) {
+    // fp8 weight with f32 block scales, the gemm runs in bf16 on AMX or else in fp32
+    if (params.compute_type == quant_comp::bf16) {
+      using GemmKernel = jblas::wrapper::gemm_default::weight_comp::amx_bf16::GemmKernelF8KBlock;
+      static GemmKernel kernel;
+      packedw = kernel.getWeightPtr()->compressWeightTranspose(n, k, f32ptr, k, params.block_size, type);
+    } else {
+      using GemmKernel = jblas::wrapper::gemm_default::weight_comp::avx512f::GemmKernelF8KBlock;
+      static GemmKernel kernel;
+      packedw = kernel.getWeightPtr()->compressWeightTranspose(n, k, f32ptr, k, params.block_size, type);
+    }
+  } else if (params.bits == quant_bits::q4) {
     if (params.compute_type == quant_comp::int8) {
       using GemmKernel = jblas::wrapper::gemm_default::weight_comp::avx512_vnni::GemmKernelDynamicQuantS4KBlock;
       static GemmKernel kernel;
@@ -979,34 +1211,50 @@ struct model_context* model_init_from_file(const char* path_model, struct model_
   ctx->rng = std::mt19937(params.seed);
   ctx->logits_all = params.logits_all;
   ctx->batch_size = params.batch_size;
+  ctx->compress_session = params.compress_session;
 
-  ne_type memory_type = params.f16_kv ? NE_TYPE_F16 : NE_TYPE_F32;
+  ne_type memory_type = params.i8_kv ? NE_TYPE_I8 : params.f16_kv ? NE_TYPE_F16 : NE_TYPE_F32;
   model_name name = params.name;
 
+  ne_mem_configure(params.huge_pages, params.mem_policy, params.mem_node);
+  // the NUMA split binds parts of the weights to nodes, which can't be done on reserved huge pages
+  ne_mem_allow_hugetlb(params.numa_nodes == 1 || ne_numa_num_nodes() == 1);
   if (!model_load(path_model, name, *ctx, params.n_ctx, params.n_gpu_layers, memory_type, params.use_mmap,
                   params.use_mlock, params.vocab_only, params.progress_callback, params.progress_callback_user_data)) {
     fprintf(stderr, "%s: failed to load model\n", __func__);
+    ne_mem_allow_hugetlb(true);
     model_free(ctx);
     return nullptr;
   }
 
+  if (!params.vocab_only) {
+    model_repack_weights(ctx->model, params.compute_type);
+    model_numa_distribute(ctx->model, params.numa_nodes);
+  }
+  ne_mem_allow_hugetlb(true);
+
   // reserve memory for context buffers
   if (!params.vocab_only) {
-    int kv_ctx = ctx->model.hparams.n_ctx;
+    // a block of n_ctx tokens of the KV cache for each sequence of the batch (and each beam)
+    ctx->kv_n_ctx_block = ctx->batch_size;
     if (params.beam_search) {
       ctx->beam_search = true;
       ctx->beam_size = params.beam_size;
       ctx->kv_n_ctx_block = ctx->batch_size * ctx->beam_size;
-      kv_ctx *= ctx->kv_n_ctx_block;
     }
+    const int kv_ctx = ctx->model.hparams.n_ctx * ctx->kv_n_ctx_block;
     if (!kv_cache_init(ctx->model.hparams, ctx->model.kv_self, memory_type, kv_ctx)) {
       fprintf(stderr, "%s: kv_cache_init() failed for self-attention cache\n", __func__);
       model_free(ctx);
       return nullptr;
     }
+    kv_cache_rope_init(name, ctx->model.hparams, ctx->model.kv_self);
 
     {
-      const size_t memory_size = ne_nbytes(ctx->model.kv_self.k) + ne_nbytes(ctx->model.kv_self.v);
+      size_t memory_size = ne_nbytes(ctx->model.kv_self.k) + ne_nbytes(ctx->model.kv_self.v);
+      if (ctx->model.kv_self.k_scale) {
+        memory_size += ne_nbytes(ctx->model.kv_self.k_scale) + ne_nbytes(ctx->model.kv_self.v_scale);
+      }
       fprintf(stderr, "%s: kv self size  = %7.2f MB\n", __func__, memory_size / 1024.0 / 1024.0);
     }
 
@@ -1027,6 +1275,13 @@ struct model_context* model_init_from_file(const char* path_model, struct model_
 
     ctx->buf_scratch[0].resize(ctx->model.scratchs.scratch0);
     ctx->buf_scratch[1].resize(ctx->model.scratchs.scratch1);
+
+    auto page_str = [](const model_buffer& buf) {
+      return buf.page_size == 0 ? std::string("heap") : std::to_string(buf.page_size / 1024) + " kB";
+    };
+    fprintf(stderr, "%s: pages: weights %s, kv cache %s, compute %s, NUMA policy %s\n", __func__,
+            ctx->model.mapping ? "mmap" : page_str(ctx->model.buf).c_str(), page_str(ctx->model.kv_self.buf).c_str(),
+            page_str(ctx->buf_compute).c_str(), ne_mem_policy_name(params.mem_policy));
   }
 
   return ctx;
@@ -1304,6 +1559,50 @@ int model_apply_lora_from_file(struct model_context* ctx, const char* path_lora,
 
 int model_get_kv_cache_token_count(const struct model_context* ctx) { return ctx->model.kv_self.n; }
 
+int model_kv_cache_shift(struct model_context* ctx, int n_past, int n_keep, int n_discard, int n_threads) {
+  auto& kv_self = ctx->model.kv_self;
+  const auto& hparams = ctx->model.hparams;
+  const int n_ctx = hparams.n_ctx;
+  const int head_dim = hparams.n_embd / hparams.n_head;
+  const int n_head_kv = hparams.n_head_kv;
+  const int n_embd_kv = n_head_kv * head_dim;
+  // all the blocks of all the layers are shifted the same way
+  const int n_seq = hparams.n_layer * ctx->kv_n_ctx_block;
+  MODEL_ASSERT(n_keep >= 0 && n_discard >= 0 && n_keep + n_discard <= n_past && n_past <= n_ctx);
+  if (n_discard == 0) {
+    return n_past;
+  }
+
+  struct ne_init_params params = {
+      /*.mem_size   =*/ctx->buf_compute.size,
+      /*.mem_buffer =*/ctx->buf_compute.addr,
+      /*.no_alloc   =*/false,
+  };
+  struct ne_context* ctx0 = ne_init(params);
+  ne_cgraph gf = {};
+  gf.n_threads = n_threads;
+
+  const size_t k_es = ne_element_size(kv_self.k);
+  const size_t v_es = ne_element_size(kv_self.v);
+  struct ne_tensor* k = ne_view_4d(ctx0, kv_self.k, head_dim, n_head_kv, n_ctx, n_seq, k_es * head_dim,
+                                   k_es * n_embd_kv, k_es * n_embd_kv * n_ctx, 0);
+  struct ne_tensor* v = ne_view_4d(ctx0, kv_self.v, n_ctx, head_dim, n_head_kv, n_seq, v_es * n_ctx,
+                                   v_es * n_ctx * head_dim, v_es * n_ctx * n_embd_kv, 0);
+  struct ne_tensor *k_scale = NULL, *v_scale = NULL;
+  if (kv_self.k_scale) {
+    const size_t scale_nb1 = sizeof(float) * n_head_kv;
+    k_scale = ne_view_3d(ctx0, kv_self.k_scale, n_head_kv, n_ctx, n_seq, scale_nb1, scale_nb1 * n_ctx, 0);
+    v_scale = ne_view_3d(ctx0, kv_self.v_scale, n_head_kv, n_ctx, n_seq, scale_nb1, scale_nb1 * n_ctx, 0);
+  }
+  ne_build_forward_expand(&gf, ne_kv_shift(ctx0, k, v, k_scale, v_scale, n_past, n_keep, n_discard,
+                                           kv_self.rope_dims, kv_self.rope_mode));
+  ne_graph_compute(ctx0, &gf);
+  ne_free(ctx0);
+
+  kv_self.n = n_past - n_discard;
+  return n_past - n_discard;
+}
+
 #define MODEL_MAX_RNG_STATE (64 * 1024)
 
 void model_set_rng_seed(struct model_context* ctx, int seed) {
@@ -1313,6 +1612,43 @@ void model_set_rng_seed(struct model_context* ctx, int seed) {
   ctx->rng.seed(seed);
 }
 
+// Calls f(ptr, size) on the used part of the KV cache in the order it is serialized: K of the first n_tok tokens of
+// each layer, then their V layer by layer and row by row (V is stored transposed), then the K and V scales of an int8
+// cache, n_head_kv per token, layer by layer. Only the first sequence is visited, the layers are kv_n_ctx_block
+// sequences apart. whole_scales visits the whole scale tensors instead, as the model_copy_state_data blob keeps them.
+template <class F>
+static void model_kv_cache_chunks(const struct model_context* ctx, int n_tok, F&& f, bool whole_scales = false) {
+  const auto& kv_self = ctx->model.kv_self;
+  const auto& hparams = ctx->model.hparams;
+  const int n_layer = hparams.n_layer;
+  const int n_embd_kv = hparams.n_head_kv * (hparams.n_embd / hparams.n_head);
+  const int n_ctx = hparams.n_ctx;
+  const size_t elt_size = ne_element_size(kv_self.k);
+  const size_t layer_nb = elt_size * n_embd_kv * n_ctx * ctx->kv_n_ctx_block;
+
+  auto k = static_cast<uint8_t*>(kv_self.k->data);
+  auto v = static_cast<uint8_t*>(kv_self.v->data);
+  for (int il = 0; il < n_layer; ++il) {
+    f(k + il * layer_nb, elt_size * n_embd_kv * n_tok);
+  }
+  for (int il = 0; il < n_layer; ++il) {
+    for (int ie = 0; ie < n_embd_kv; ++ie) {
+      f(v + il * layer_nb + ie * elt_size * n_ctx, elt_size * n_tok);
+    }
+  }
+  if (kv_self.k_scale && whole_scales) {
+    f(kv_self.k_scale->data, ne_nbytes(kv_self.k_scale));
+    f(kv_self.v_scale->data, ne_nbytes(kv_self.v_scale));
+  } else if (kv_self.k_scale) {
+    const size_t scale_layer_nb = sizeof(float) * hparams.n_head_kv * n_ctx * ctx->kv_n_ctx_block;
+    for (const ne_tensor* scale : {kv_self.k_scale, kv_self.v_scale}) {
+      for (int il = 0; il < n_layer; ++il) {
+        f(static_cast<uint8_t*>(scale->data) + il * scale_layer_nb, sizeof(float) * hparams.n_head_kv * n_tok);
+      }
+    }
+  }
+}
+
 // Returns the *maximum* size of the state
 size_t model_get_state_size(const struct model_context* ctx) {
   // we don't know size of rng until we actually serialize it. so reserve more than enough memory for its serialized
@@ -1387,13 +1723,7 @@ size_t model_copy_state_data(struct model_context* ctx, uint8_t* dst) {
 
   // copy kv cache
   {
-    const auto& kv_self = ctx->model.kv_self;
-    const auto& hparams = ctx->model.hparams;
-    const int n_layer = hparams.n_layer;
-    const int n_embd = hparams.n_embd;
-    const int n_ctx = hparams.n_ctx;
-
-    const size_t kv_size = kv_self.buf.size;
+    const size_t kv_size = ctx->model.kv_self.buf.size;
     const int kv_ntok = model_get_kv_cache_token_count(ctx);
 
     memcpy(out, &kv_size, sizeof(kv_size));
@@ -1402,33 +1732,13 @@ size_t model_copy_state_data(struct model_context* ctx, uint8_t* dst) {
     out += sizeof(kv_ntok);
 
     if (kv_size) {
-      const size_t elt_size = ne_element_size(kv_self.k);
-
-      char buffer[4096];
-
-      ne_context* cpy_ctx = ne_init({sizeof(buffer), buffer, /* no_alloc */ true});
-      ne_cgraph gf{};
-      gf.n_threads = 1;
-
-      ne_tensor* kout3d = ne_new_tensor_3d(cpy_ctx, kv_self.k->type, n_embd, kv_ntok, n_layer, NE_SIZE_CALC);
-      kout3d->data = out;
-      out += ne_nbytes(kout3d);
-
-      ne_tensor* vout3d = ne_new_tensor_3d(cpy_ctx, kv_self.v->type, kv_ntok, n_embd, n_layer, NE_SIZE_CALC);
-      vout3d->data = out;
-      out += ne_nbytes(vout3d);
-
-      ne_tensor* k3d =
-          ne_view_3d(cpy_ctx, kv_self.k, n_embd, kv_ntok, n_layer, elt_size * n_embd, elt_size * n_embd * n_ctx, 0);
-
-      ne_tensor* v3d =
-          ne_view_3d(cpy_ctx, kv_self.v, kv_ntok, n_embd, n_layer, elt_size * n_ctx, elt_size * n_ctx * n_embd, 0);
-
-      ne_build_forward_expand(&gf, ne_cpy(cpy_ctx, k3d, kout3d));
-      ne_build_forward_expand(&gf, ne_cpy(cpy_ctx, v3d, vout3d));
-      ne_graph_compute(cpy_ctx, &gf);
-
-      ne_free(cpy_ctx);
+      model_kv_cache_chunks(
+          ctx, kv_ntok,
+          [&out](void* ptr, size_t size) {
+            memcpy(out, ptr, size);
+            out += size;
+          },
+          true);
     }
   }
 
@@ -1498,12 +1808,6 @@ size_t model_set_state_data(struct model_context* ctx, uint8_t* src) {
 
   // set kv cache
   {
-    const auto& kv_self = ctx->model.kv_self;
-    const auto& hparams = ctx->model.hparams;
-    const int n_layer = hparams.n_layer;
-    const int n_embd = hparams.n_embd;
-    const int n_ctx = hparams.n_ctx;
-
     size_t kv_size;
     int kv_ntok;
 
@@ -1513,35 +1817,15 @@ size_t model_set_state_data(struct model_context* ctx, uint8_t* src) {
     inp += sizeof(kv_ntok);
 
     if (kv_size) {
-      MODEL_ASSERT(kv_self.buf.size == kv_size);
-
-      const size_t elt_size = ne_element_size(kv_self.k);
-
-      char buffer[4096];
-
-      ne_context* cpy_ctx = ne_init({sizeof(buffer), buffer, /* no_alloc */ true});
-      ne_cgraph gf{};
-      gf.n_threads = 1;
-
-      ne_tensor* kin3d = ne_new_tensor_3d(cpy_ctx, kv_self.k->type, n_embd, kv_ntok, n_layer, NE_SIZE_CALC);
-      kin3d->data = (void*)inp;
-      inp += ne_nbytes(kin3d);
-
-      ne_tensor* vin3d = ne_new_tensor_3d(cpy_ctx, kv_self.v->type, kv_ntok, n_embd, n_layer, NE_SIZE_CALC);
-      vin3d->data = (void*)inp;
-      inp += ne_nbytes(vin3d);
-
-      ne_tensor* k3d =
-          ne_view_3d(cpy_ctx, kv_self.k, n_embd, kv_ntok, n_layer, elt_size * n_embd, elt_size * n_embd * n_ctx, 0);
-
-      ne_tensor* v3d =
-          ne_view_3d(cpy_ctx, kv_self.v, kv_ntok, n_embd, n_layer, elt_size * n_ctx, elt_size * n_ctx * n_embd, 0);
-
-      ne_build_forward_expand(&gf, ne_cpy(cpy_ctx, kin3d, k3d));
-      ne_build_forward_expand(&gf, ne_cpy(cpy_ctx, vin3d, v3d));
-      ne_graph_compute(cpy_ctx, &gf);
-
-      ne_free(cpy_ctx);
+      MODEL_ASSERT(ctx->model.kv_self.buf.size == kv_size);
+
+      model_kv_cache_chunks(
+          ctx, kv_ntok,
+          [&inp](void* ptr, size_t size) {
+            memcpy(ptr, inp, size);
+            inp += size;
+          },
+          true);
     }
 
     ctx->model.kv_self.n = kv_ntok;
@@ -1555,22 +1839,177 @@ size_t model_set_state_data(struct model_context* ctx, uint8_t* src) {
   return nread;
 }
 
+// Session files from version 3 on keep the small state (rng, logits, embedding) in the header and store the KV cache
+// of the n_past tokens only, in the chunk order of model_kv_cache_chunks, from a page-aligned offset:
+//   magic, version, hparams (field by field), n_token, tokens, flags,
+//   rng size + rng, logits size + logits, embedding size + embedding,
+//   kv_ntok, kv_offset, kv_size (in the file), kv_raw_size (once inflated), zero padding, KV region at kv_offset
+// The KV region is read from a mapping of the file straight into the cache and written from the cache with no
+// staging copy. It is deflated with MODEL_SESSION_FLAG_DEFLATE.
+#define MODEL_SESSION_FLAG_DEFLATE 1u
+#define MODEL_SESSION_KV_ALIGN 4096u
+
+// version 1 files hold the raw model_hparams of their time, it had no n_head_kv (the KV cache had all the heads)
+struct model_session_hparams_v1 {
+  uint32_t n_vocab;
+  uint32_t n_ctx;
+  uint32_t n_embd;
+  uint32_t n_mult;
+  uint32_t n_head;
+  uint32_t n_layer;
+  uint32_t n_rot;
+  uint32_t ftype;
+  int32_t max_seq_len;
+  float alibi_bias_max;
+  float clip_qkv;
+  int32_t par_res;
+};
+static_assert(sizeof(model_session_hparams_v1) == 48, "model_session_hparams_v1 is not the version 1 layout");
+
+// the hparams are written field by field from version 2 on, a new field takes a new version
+static void model_session_write_hparams(model_file& file, const model_hparams& hparams) {
+  file.write_u32(hparams.n_vocab);
+  file.write_u32(hparams.n_ctx);
+  file.write_u32(hparams.n_embd);
+  file.write_u32(hparams.n_mult);
+  file.write_u32(hparams.n_head);
+  file.write_u32(hparams.n_head_kv);
+  file.write_u32(hparams.n_layer);
+  file.write_u32(hparams.n_rot);
+  file.write_u32(hparams.ftype);
+  file.write_raw(&hparams.max_seq_len, sizeof(int32_t));
+  file.write_raw(&hparams.alibi_bias_max, sizeof(float));
+  file.write_raw(&hparams.clip_qkv, sizeof(float));
+  file.write_raw(&hparams.par_res, sizeof(int32_t));
+}
+
+static model_hparams model_session_read_hparams(model_file& file, uint32_t version) {
+  model_hparams hparams;
+  if (version == 1) {
+    model_session_hparams_v1 v1;
+    file.read_raw(&v1, sizeof(v1));
+    hparams.n_vocab = v1.n_vocab;
+    hparams.n_ctx = v1.n_ctx;
+    hparams.n_embd = v1.n_embd;
+    hparams.n_mult = v1.n_mult;
+    hparams.n_head = v1.n_head;
+    hparams.n_head_kv = v1.n_head;
+    hparams.n_layer = v1.n_layer;
+    hparams.n_rot = v1.n_rot;
+    hparams.ftype = (enum ne_ftype)v1.ftype;
+    hparams.max_seq_len = v1.max_seq_len;
+    hparams.alibi_bias_max = v1.alibi_bias_max;
+    hparams.clip_qkv = v1.clip_qkv;
+    hparams.par_res = v1.par_res;
+    return hparams;
+  }
+  hparams.n_vocab = file.read_u32();
+  hparams.n_ctx = file.read_u32();
+  hparams.n_embd = file.read_u32();
+  hparams.n_mult = file.read_u32();
+  hparams.n_head = file.read_u32();
+  hparams.n_head_kv = file.read_u32();
+  hparams.n_layer = file.read_u32();
+  hparams.n_rot = file.read_u32();
+  hparams.ftype = (enum ne_ftype)file.read_u32();
+  file.read_raw(&hparams.max_seq_len, sizeof(int32_t));
+  file.read_raw(&hparams.alibi_bias_max, sizeof(float));
+  file.read_raw(&hparams.clip_qkv, sizeof(float));
+  file.read_raw(&hparams.par_res, sizeof(int32_t));
+  return hparams;
+}
+
+#ifdef NE_USE_ZLIB
+// zlib counts in uInt, feed it at most this much at once
+static constexpr size_t kZlibStep = size_t(1) << 30;
+
+static bool model_session_deflate_kv(const struct model_context* ctx, int n_tok, const model_file& file) {
+  z_stream zs = {};
+  if (deflateInit(&zs, Z_BEST_SPEED) != Z_OK) {
+    return false;
+  }
+  std::vector<uint8_t> out(4 * MB);
+  bool ok = true;
+  auto pump = [&](const uint8_t* ptr, size_t size, int flush) {
+    do {
+      const size_t step = std::min(size, kZlibStep);
+      zs.next_in = const_cast<Bytef*>(ptr);
+      zs.avail_in = static_cast<uInt>(step);
+      const int step_flush = step == size ? flush : Z_NO_FLUSH;
+      do {
+        zs.next_out = out.data();
+        zs.avail_out = static_cast<uInt>(out.size());
+        if (deflate(&zs, step_flush) == Z_STREAM_ERROR) {
+          ok = false;
+          return;
+        }
+        file.write_raw(out.data(), out.size() - zs.avail_out);
+      } while (zs.avail_out == 0);
+      ptr += step;
+      size -= step;
+    } while (size > 0);
+  };
+  model_kv_cache_chunks(ctx, n_tok, [&](void* ptr, size_t size) {
+    if (ok && size > 0) pump(static_cast<const uint8_t*>(ptr), size, Z_NO_FLUSH);
+  });
+  if (ok) {
+    pump(nullptr, 0, Z_FINISH);
+  }
+  deflateEnd(&zs);
+  return ok;
+}
+
+static bool model_session_inflate_kv(const struct model_context* ctx, int n_tok, const uint8_t* src, size_t src_size) {
+  z_stream zs = {};
+  if (inflateInit(&zs) != Z_OK) {
+    return false;
+  }
+  bool ok = true;
+  model_kv_cache_chunks(ctx, n_tok, [&](void* ptr, size_t size) {
+    auto dst = static_cast<uint8_t*>(ptr);
+    while (ok && size > 0) {
+      if (zs.avail_in == 0) {
+        const size_t step = std::min(src_size, kZlibStep);
+        zs.next_in = const_cast<Bytef*>(src);
+        zs.avail_in = static_cast<uInt>(step);
+        src += step;
+        src_size -= step;
+      }
+      const size_t step = std::min(size, kZlibStep);
+      zs.next_out = dst;
+      zs.avail_out = static_cast<uInt>(step);
+      const int ret = inflate(&zs, Z_NO_FLUSH);
+      const size_t done = step - zs.avail_out;
+      if (ret != Z_OK && !(ret == Z_STREAM_END && zs.avail_out == 0)) {
+        ok = false;
+      } else if (done == 0 && zs.avail_in == 0 && src_size == 0) {
+        ok = false;  // truncated
+      }
+      dst += done;
+      size -= done;
+    }
+  });
+  inflateEnd(&zs);
+  return ok;
+}
+#endif
+
 bool model_load_session_file(struct model_context* ctx, const char* path_session, model_token* tokens_out,
                              size_t n_token_capacity, size_t* n_token_count_out) {
   model_file file(path_session, "rb");
 
   // sanity checks
+  uint32_t version;
   {
     const uint32_t magic = file.read_u32();
-    const uint32_t version = file.read_u32();
+    version = file.read_u32();
 
-    if (magic != MODEL_SESSION_MAGIC || version != MODEL_SESSION_VERSION) {
+    if (magic != MODEL_SESSION_MAGIC || version < 1 || version > MODEL_SESSION_VERSION) {
       fprintf(stderr, "%s : unknown (magic, version) for session file: %08x, %08x\n", __func__, magic, version);
       return false;
     }
 
-    model_hparams session_hparams;
-    file.read_raw(&session_hparams, sizeof(model_hparams));
+    const model_hparams session_hparams = model_session_read_hparams(file, version);
 
     if (session_hparams != ctx->model.hparams) {
       fprintf(stderr, "%s : model hparams didn't match from session file!\n", __func__);
@@ -1592,8 +2031,8 @@ bool model_load_session_file(struct model_context* ctx, const char* path_session
     *n_token_count_out = n_token_count;
   }
 
-  // restore the context state
-  {
+  // restore the context state of a version 1 or 2 file, a model_copy_state_data dump
+  if (version < 3) {
     const size_t n_state_size_cur = file.size - file.tell();
     const size_t n_state_size_max = model_get_state_size(ctx);
 
@@ -1607,6 +2046,94 @@ bool model_load_session_file(struct model_context* ctx, const char* path_session
     file.read_raw(state_data.data(), n_state_size_cur);
 
     model_set_state_data(ctx, state_data.data());
+    return true;
+  }
+
+  const uint32_t flags = file.read_u32();
+
+  // restore the rng, logits and embedding
+  {
+    uint64_t rng_size;
+    file.read_raw(&rng_size, sizeof(rng_size));
+    if (rng_size > MODEL_MAX_RNG_STATE) {
+      fprintf(stderr, "%s : invalid rng state in session file\n", __func__);
+      return false;
+    }
+    std::string rng_str(rng_size, '\0');
+    file.read_raw(&rng_str[0], rng_size);
+    std::stringstream rng_ss(rng_str);
+    rng_ss >> ctx->rng;
+    MODEL_ASSERT(rng_ss.fail() == false);
+
+    uint64_t logits_size;
+    file.read_raw(&logits_size, sizeof(logits_size));
+    if (logits_size > ctx->logits.capacity()) {
+      fprintf(stderr, "%s : logits size in session file exceeded capacity! %zu > %zu\n", __func__,
+              (size_t)logits_size, ctx->logits.capacity());
+      return false;
+    }
+    ctx->logits.resize(logits_size);
+    file.read_raw(ctx->logits.data(), logits_size * sizeof(float));
+
+    uint64_t embedding_size;
+    file.read_raw(&embedding_size, sizeof(embedding_size));
+    if (embedding_size != ctx->embedding.size()) {
+      fprintf(stderr, "%s : embedding size didn't match from session file!\n", __func__);
+      return false;
+    }
+    file.read_raw(ctx->embedding.data(), embedding_size * sizeof(float));
+  }
+
+  // restore the KV cache
+  {
+    int32_t kv_ntok;
+    uint64_t kv_offset, kv_size, kv_raw_size;
+    file.read_raw(&kv_ntok, sizeof(kv_ntok));
+    file.read_raw(&kv_offset, sizeof(kv_offset));
+    file.read_raw(&kv_size, sizeof(kv_size));
+    file.read_raw(&kv_raw_size, sizeof(kv_raw_size));
+
+    size_t expected_size = 0;
+    if (kv_ntok >= 0 && kv_ntok <= static_cast<int32_t>(ctx->model.hparams.n_ctx)) {
+      model_kv_cache_chunks(ctx, kv_ntok, [&](void*, size_t size) { expected_size += size; });
+    }
+    if (expected_size != kv_raw_size || kv_offset + kv_size > file.size ||
+        (!(flags & MODEL_SESSION_FLAG_DEFLATE) && kv_size != kv_raw_size)) {
+      fprintf(stderr, "%s : the KV cache in session file is corrupted!\n", __func__);
+      return false;
+    }
+
+    // read the KV region from the page cache through a mapping, or into a buffer where mmap is missing
+    std::unique_ptr<model_mmap> mapping;
+    std::vector<uint8_t> region;
+    const uint8_t* src = nullptr;
+    if (model_mmap::SUPPORTED) {
+      mapping.reset(new model_mmap(&file, 0));
+      src = static_cast<const uint8_t*>(mapping->addr) + kv_offset;
+    } else {
+      region.resize(kv_size);
+      file.seek(kv_offset, SEEK_SET);
+      file.read_raw(region.data(), kv_size);
+      src = region.data();
+    }
+
+    if (flags & MODEL_SESSION_FLAG_DEFLATE) {
+#ifdef NE_USE_ZLIB
+      if (!model_session_inflate_kv(ctx, kv_ntok, src, kv_size)) {
+        fprintf(stderr, "%s : failed to inflate the KV cache of session file!\n", __func__);
+        return false;
+      }
+#else
+      fprintf(stderr, "%s : the KV cache of session file is deflated, rebuild with NE_ZLIB to load it\n", __func__);
+      return false;
+#endif
+    } else {
+      model_kv_cache_chunks(ctx, kv_ntok, [&src](void* ptr, size_t size) {
+        memcpy(ptr, src, size);
+        src += size;
+      });
+    }
+    ctx->model.kv_self.n = kv_ntok;
   }
 
   return true;
@@ -1619,20 +2146,70 @@ bool model_save_session_file(struct model_context* ctx, const char* path_session
   file.write_u32(MODEL_SESSION_MAGIC);
   file.write_u32(MODEL_SESSION_VERSION);
 
-  file.write_raw(&ctx->model.hparams, sizeof(model_hparams));
+  model_session_write_hparams(file, ctx->model.hparams);
 
   // save the prompt
   file.write_u32((uint32_t)n_token_count);
   file.write_raw(tokens, sizeof(model_token) * n_token_count);
 
-  // save the context state
+  uint32_t flags = 0;
+  if (ctx->compress_session) {
+#ifdef NE_USE_ZLIB
+    flags |= MODEL_SESSION_FLAG_DEFLATE;
+#else
+    fprintf(stderr, "%s : built without NE_ZLIB, the KV cache is saved uncompressed\n", __func__);
+#endif
+  }
+  file.write_u32(flags);
+
+  // save the rng, logits and embedding
   {
-    const size_t n_state_size_max = model_get_state_size(ctx);
+    std::stringstream rng_ss;
+    rng_ss << ctx->rng;
+    const std::string rng_str = rng_ss.str();
+    const uint64_t rng_size = rng_str.size();
+    file.write_raw(&rng_size, sizeof(rng_size));
+    file.write_raw(rng_str.data(), rng_size);
 
-    std::vector<uint8_t> state_data(n_state_size_max);
-    const size_t n_state_size_cur = model_copy_state_data(ctx, state_data.data());
+    const uint64_t logits_size = ctx->logits.size();
+    file.write_raw(&logits_size, sizeof(logits_size));
+    file.write_raw(ctx->logits.data(), logits_size * sizeof(float));
 
-    file.write_raw(state_data.data(), n_state_size_cur);
+    const uint64_t embedding_size = ctx->embedding.size();
+    file.write_raw(&embedding_size, sizeof(embedding_size));
+    file.write_raw(ctx->embedding.data(), embedding_size * sizeof(float));
+  }
+
+  // save the KV cache of the used tokens
+  {
+    const int32_t kv_ntok = model_get_kv_cache_token_count(ctx);
+    uint64_t kv_raw_size = 0;
+    model_kv_cache_chunks(ctx, kv_ntok, [&](void*, size_t size) { kv_raw_size += size; });
+
+    const size_t header_end = file.tell() + sizeof(kv_ntok) + 3 * sizeof(uint64_t);
+    const uint64_t kv_offset = (header_end + MODEL_SESSION_KV_ALIGN - 1) / MODEL_SESSION_KV_ALIGN * MODEL_SESSION_KV_ALIGN;
+    uint64_t kv_size = kv_raw_size;
+    file.write_raw(&kv_ntok, sizeof(kv_ntok));
+    file.write_raw(&kv_offset, sizeof(kv_offset));
+    const size_t kv_size_pos = file.tell();
+    file.write_raw(&kv_size, sizeof(kv_size));
+    file.write_raw(&kv_raw_size, sizeof(kv_raw_size));
+    const std::vector<uint8_t> padding(kv_offset - header_end, 0);
+    file.write_raw(padding.data(), padding.size());
+
+    if (flags & MODEL_SESSION_FLAG_DEFLATE) {
+#ifdef NE_USE_ZLIB
+      if (!model_session_deflate_kv(ctx, kv_ntok, file)) {
+        fprintf(stderr, "%s : failed to deflate the KV cache\n", __func__);
+        return false;
+      }
+      kv_size = file.tell() - kv_offset;
+      file.seek(kv_size_pos, SEEK_SET);
+      file.write_raw(&kv_size, sizeof(kv_size));
+#endif
+    } else {
+      model_kv_cache_chunks(ctx, kv_ntok, [&file](void* ptr, size_t size) { file.write_raw(ptr, size); });
+    }
   }
 
   return true;
@@ -1958,8 +2535,21 @@ std::vector<model_token> beam_search(const int& beam_size, const int& n_predict,
   // beam probabilities can only decrease.
   auto const eos = [](const beam& b) { return b.eos(); };
   int n_ctx = lctx->model.hparams.n_ctx;
-  int n_embd = lctx->model.hparams.n_embd;
+  const auto& hparams = lctx->model.hparams;
+  int n_embd_kv = hparams.n_head_kv * (hparams.n_embd / hparams.n_head);
   int kv_n_ctx_block = lctx->kv_n_ctx_block;
+  // the int8 cache keeps a scale per token and KV head, [n_layer, kv_n_ctx_block, n_ctx, n_head_kv], that has to
+  // follow the K/V rows of a sequence
+  auto copy_kv_scales = [&](int il, int dst_seq, int src_seq, int tok, int n_tok) {
+    const auto& kv_self = lctx->model.kv_self;
+    if (!kv_self.k_scale) return;
+    const size_t dst_off = (size_t(il * kv_n_ctx_block + dst_seq) * n_ctx + tok) * hparams.n_head_kv;
+    const size_t src_off = (size_t(il * kv_n_ctx_block + src_seq) * n_ctx + tok) * hparams.n_head_kv;
+    for (const ne_tensor* scale : {kv_self.k_scale, kv_self.v_scale}) {
+      float* data = static_cast<float*>(scale->data);
+      memcpy(data + dst_off, data + src_off, sizeof(float) * hparams.n_head_kv * n_tok);
+    }
+  };
   for (int n = 0; n < n_predict && !eos(top_beam(beams)) && !std::all_of(beams.begin(), beams.end(), eos); ++n) {
     // first step
     if (n_past == 0) {
@@ -1970,49 +2560,50 @@ std::vector<model_token> beam_search(const int& beam_size, const int& n_predict,
 #pragma omp parallel for
       for (int i = 0; i < lctx->model.layers.size(); ++i) {
         for (int j = 1; j < kv_n_ctx_block; ++j) {
-          // [n_embd, N]
+          // [n_embd_kv, N]
           memcpy(static_cast<char*>(lctx->model.kv_self.k->data) +
-                     (i * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd * kv_n_ctx_block +
-                      j * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd),
+                     (i * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd_kv * kv_n_ctx_block +
+                      j * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd_kv),
                  static_cast<char*>(lctx->model.kv_self.k->data) +
-                     i * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd * kv_n_ctx_block,
-                 ne_element_size(lctx->model.kv_self.k) * n_embd * n_tokens);
+                     i * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd_kv * kv_n_ctx_block,
+                 ne_element_size(lctx->model.kv_self.k) * n_embd_kv * n_tokens);
           // memcpy(static_cast<char*>(lctx->model.kv_self.v->data) +
-          //            (i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd * kv_n_ctx_block +
-          //             j * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd),
+          //            (i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd_kv * kv_n_ctx_block +
+          //             j * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd_kv),
           //        static_cast<char*>(lctx->model.kv_self.v->data) +
-          //            i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd * kv_n_ctx_block,
-          //        ne_element_size(lctx->model.kv_self.v) * n_embd * (n_tokens));
-          // [N, n_embd]
+          //            i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd_kv * kv_n_ctx_block,
+          //        ne_element_size(lctx->model.kv_self.v) * n_embd_kv * (n_tokens));
+          // [N, n_embd_kv]
           // TODO MHA_V_ORIGIN_LAYOUT
-          for (int k = 0; k < n_embd; ++k) {
+          for (int k = 0; k < n_embd_kv; ++k) {
             memcpy(static_cast<char*>(lctx->model.kv_self.v->data) +
-                       (i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd * kv_n_ctx_block +
-                        j * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd +
+                       (i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd_kv * kv_n_ctx_block +
+                        j * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd_kv +
                         n_ctx * k * ne_element_size(lctx->model.kv_self.v)),
                    static_cast<char*>(lctx->model.kv_self.v->data) +
-                       (i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd * kv_n_ctx_block +
+                       (i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd_kv * kv_n_ctx_block +
                         n_ctx * k * ne_element_size(lctx->model.kv_self.v)),
                    ne_element_size(lctx->model.kv_self.v) * n_tokens);
           }
+          copy_kv_scales(i, j, 0, 0, n_tokens);
 
           // memcpy(static_cast<char*>(lctx->model.kv_self.k->data) +
-          //            (i * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd * kv_n_ctx_block +
-          //             j * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd)
+          //            (i * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd_kv * kv_n_ctx_block +
+          //             j * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd_kv)
           //       ,
           //        static_cast<char*>(lctx->model.kv_self.k->data) +
-          //            i * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd * kv_n_ctx_block +
-          //            0 * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd ,
-          //        ne_element_size(lctx->model.kv_self.k) * n_embd * n_ctx);
-          // // [N, n_embd]
-          // // for (int k = 0; k < n_embd; ++k) {
+          //            i * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd_kv * kv_n_ctx_block +
+          //            0 * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd_kv ,
+          //        ne_element_size(lctx->model.kv_self.k) * n_embd_kv * n_ctx);
+          // // [N, n_embd_kv]
+          // // for (int k = 0; k < n_embd_kv; ++k) {
           // memcpy(static_cast<char*>(lctx->model.kv_self.v->data) +
-          //            (i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd * kv_n_ctx_block +
-          //             j * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd ),
+          //            (i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd_kv * kv_n_ctx_block +
+          //             j * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd_kv ),
           //        static_cast<char*>(lctx->model.kv_self.v->data) +
-          //            (i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd * kv_n_ctx_block +
-          //             0* n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd ),
-          //        ne_element_size(lctx->model.kv_self.v) * n_ctx*n_embd);
+          //            (i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd_kv * kv_n_ctx_block +
+          //             0* n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd_kv ),
+          //        ne_element_size(lctx->model.kv_self.v) * n_ctx*n_embd_kv);
         }
       }
 
@@ -2036,65 +2627,68 @@ std::vector<model_token> beam_search(const int& beam_size, const int& n_predict,
       for (auto it : kv_reorder_indices) {
         if (it.first != it.second) {
           int len = next_beams[it.first].token_ids.size() - 1;
-          size_t input_token_offset_k = n_tokens * ne_element_size(lctx->model.kv_self.k) * n_embd;
+          size_t input_token_offset_k = n_tokens * ne_element_size(lctx->model.kv_self.k) * n_embd_kv;
           size_t input_token_offset_v = n_tokens * ne_element_size(lctx->model.kv_self.v);
+          int input_token_offset_scale = n_tokens;
 
           // std::cout << "here is first " << it.first << " " <<it.second << std::endl;
           if (len + n_tokens > n_ctx) {
             // all token hidden states cache should be updated
             input_token_offset_k = 0;
             input_token_offset_v = 0;
+            input_token_offset_scale = 0;
             len = n_ctx;
           }
 #pragma omp parallel for
           for (int i = 0; i < lctx->model.layers.size(); ++i) {
-            // [n_embd, N]
+            // [n_embd_kv, N]
             memcpy(static_cast<char*>(lctx->model.kv_self.k->data) +
-                       (i * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd * kv_n_ctx_block +
-                        it.first * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd) +
+                       (i * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd_kv * kv_n_ctx_block +
+                        it.first * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd_kv) +
                        input_token_offset_k,
                    static_cast<char*>(lctx->model.kv_self.k->data) +
-                       i * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd * kv_n_ctx_block +
-                       it.second * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd + input_token_offset_k,
-                   ne_element_size(lctx->model.kv_self.k) * n_embd * (n_past - n_tokens));
-            // [N, n_embd]
+                       i * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd_kv * kv_n_ctx_block +
+                       it.second * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd_kv + input_token_offset_k,
+                   ne_element_size(lctx->model.kv_self.k) * n_embd_kv * (n_past - n_tokens));
+            // [N, n_embd_kv]
             memcpy(static_cast<char*>(lctx->model.kv_self.v->data) +
-                       (i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd * kv_n_ctx_block +
-                        it.first * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd) +
+                       (i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd_kv * kv_n_ctx_block +
+                        it.first * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd_kv) +
                        input_token_offset_k,
                    static_cast<char*>(lctx->model.kv_self.v->data) +
-                       i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd * kv_n_ctx_block +
-                       it.second * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd + input_token_offset_k,
-                   ne_element_size(lctx->model.kv_self.v) * n_embd * (n_past - n_tokens));
+                       i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd_kv * kv_n_ctx_block +
+                       it.second * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd_kv + input_token_offset_k,
+                   ne_element_size(lctx->model.kv_self.v) * n_embd_kv * (n_past - n_tokens));
+            copy_kv_scales(i, it.first, it.second, input_token_offset_scale, n_past - n_tokens);
 
-            // for (int k = 0; k < n_embd; ++k) {
+            // for (int k = 0; k < n_embd_kv; ++k) {
             //   memcpy(static_cast<char*>(lctx->model.kv_self.v->data) +
-            //              (i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd * kv_n_ctx_block +
-            //               it.first * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd +
+            //              (i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd_kv * kv_n_ctx_block +
+            //               it.first * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd_kv +
             //               n_ctx * ne_element_size(lctx->model.kv_self.v) * k + input_token_offset_v),
             //          static_cast<char*>(lctx->model.kv_self.v->data) +
-            //              (i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd * kv_n_ctx_block +
-            //               it.second * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd +
+            //              (i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd_kv * kv_n_ctx_block +
+            //               it.second * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd_kv +
             //               n_ctx * ne_element_size(lctx->model.kv_self.v) + input_token_offset_v),
             //          ne_element_size(lctx->model.kv_self.v) * len);
             // }
             // memcpy(static_cast<char*>(lctx->model.kv_self.k->data) +
-            //            (i * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd * kv_n_ctx_block +
-            //             it.first * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd)
+            //            (i * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd_kv * kv_n_ctx_block +
+            //             it.first * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd_kv)
             //       ,
             //        static_cast<char*>(lctx->model.kv_self.k->data) +
-            //            i * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd * kv_n_ctx_block +
-            //            it.second * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd ,
-            //        ne_element_size(lctx->model.kv_self.k) * n_embd * n_ctx);
-            // // [N, n_embd]
-            // // for (int k = 0; k < n_embd; ++k) {
+            //            i * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd_kv * kv_n_ctx_block +
+            //            it.second * n_ctx * ne_element_size(lctx->model.kv_self.k) * n_embd_kv ,
+            //        ne_element_size(lctx->model.kv_self.k) * n_embd_kv * n_ctx);
+            // // [N, n_embd_kv]
+            // // for (int k = 0; k < n_embd_kv; ++k) {
             //   memcpy(static_cast<char*>(lctx->model.kv_self.v->data) +
-            //              (i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd * kv_n_ctx_block +
-            //               it.first * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd ),
+            //              (i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd_kv * kv_n_ctx_block +
+            //               it.first * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd_kv ),
             //          static_cast<char*>(lctx->model.kv_self.v->data) +
-            //              (i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd * kv_n_ctx_block +
-            //               it.second * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd ),
-            //          ne_element_size(lctx->model.kv_self.v) * n_ctx*n_embd);
+            //              (i * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd_kv * kv_n_ctx_block +
+            //               it.second * n_ctx * ne_element_size(lctx->model.kv_self.v) * n_embd_kv ),
+            //          ne_element_size(lctx->model.kv_self.v) * n_ctx*n_embd_kv);
 
             // }
           }
@@ -2139,3 +2733,127 @@ std::vector<model_token> beam_search(const int& beam_size, const int& n_predict,
   // printf("%s: beam_search time   = %8.2f ms\n", __func__, t_search_us / 1000.0f);
   return beam_search_response;
 }
+
+#ifdef NE_TESTS
+namespace {
+bool return_success = true;
+
+class TestSessionFile {
+ public:
+  TestSessionFile() {
+    printf("Test suit: %s\n", __FUNCTION__);
+    return_success &= test_case(NE_TYPE_F16, 4, 2, false);
+    return_success &= test_case(NE_TYPE_I8, 4, 4, false);
+    return_success &= test_case(NE_TYPE_F16, 4, 4, false, true);
+#ifdef NE_USE_ZLIB
+    return_success &= test_case(NE_TYPE_F16, 4, 2, true);
+    return_success &= test_case(NE_TYPE_I8, 8, 1, true);
+#endif
+    printf("Test suit done: %s\n", __FUNCTION__);
+  }
+
+  static void init_context(model_context* ctx, ne_type type, int n_head, int n_head_kv) {
+    auto& hparams = ctx->model.hparams;
+    hparams.n_vocab = 100;
+    hparams.n_ctx = 128;
+    hparams.n_embd = 64;
+    hparams.n_head = n_head;
+    hparams.n_head_kv = n_head_kv;
+    hparams.n_layer = 3;
+    kv_cache_init(hparams, ctx->model.kv_self, type, hparams.n_ctx);
+    ctx->logits.reserve(hparams.n_vocab);
+    ctx->embedding.resize(hparams.n_embd);
+  }
+
+  static std::vector<uint8_t> kv_bytes(model_context* ctx, int n_tok) {
+    std::vector<uint8_t> bytes;
+    model_kv_cache_chunks(ctx, n_tok, [&](void* ptr, size_t size) {
+      bytes.insert(bytes.end(), static_cast<uint8_t*>(ptr), static_cast<uint8_t*>(ptr) + size);
+    });
+    return bytes;
+  }
+
+  // a version 1 file as the baseline wrote it: raw pre-n_head_kv hparams, tokens and a model_copy_state_data dump
+  static void save_v1(model_context* ctx, const char* path, const std::vector<model_token>& tokens) {
+    const auto& hparams = ctx->model.hparams;
+    model_session_hparams_v1 hparams_v1;
+    hparams_v1.n_vocab = hparams.n_vocab;
+    hparams_v1.n_ctx = hparams.n_ctx;
+    hparams_v1.n_embd = hparams.n_embd;
+    hparams_v1.n_mult = hparams.n_mult;
+    hparams_v1.n_head = hparams.n_head;
+    hparams_v1.n_layer = hparams.n_layer;
+    hparams_v1.n_rot = hparams.n_rot;
+    hparams_v1.ftype = hparams.ftype;
+    hparams_v1.max_seq_len = hparams.max_seq_len;
+    hparams_v1.alibi_bias_max = hparams.alibi_bias_max;
+    hparams_v1.clip_qkv = hparams.clip_qkv;
+    hparams_v1.par_res = hparams.par_res;
+    std::vector<uint8_t> state(model_get_state_size(ctx));
+    const size_t state_size = model_copy_state_data(ctx, state.data());
+    model_file file(path, "wb");
+    file.write_u32(MODEL_SESSION_MAGIC);
+    file.write_u32(1);
+    file.write_raw(&hparams_v1, sizeof(hparams_v1));
+    file.write_u32((uint32_t)tokens.size());
+    file.write_raw(tokens.data(), sizeof(model_token) * tokens.size());
+    file.write_raw(state.data(), state_size);
+  }
+
+  bool test_case(ne_type type, int n_head, int n_head_kv, bool compress, bool v1 = false) {
+    const char* path = "test_model_session.bin";
+    const int n_tok = 37;
+    model_context src, dst;
+    init_context(&src, type, n_head, n_head_kv);
+    init_context(&dst, type, n_head, n_head_kv);
+    src.compress_session = compress;
+    src.model.kv_self.n = n_tok;
+    int seed = 1;
+    model_kv_cache_chunks(&src, n_tok, [&](void* ptr, size_t size) {
+      auto bytes = static_cast<uint8_t*>(ptr);
+      for (size_t i = 0; i < size; ++i) bytes[i] = uint8_t((i * 31 + seed++) % 7);
+    });
+    src.logits.assign(50, 1.5f);
+    src.embedding.assign(src.embedding.size(), 2.5f);
+    src.rng.seed(42);
+    std::vector<model_token> tokens(n_tok);
+    for (int i = 0; i < n_tok; ++i) tokens[i] = i * 3;
+
+    if (v1) {
+      save_v1(&src, path, tokens);
+    } else if (!model_save_session_file(&src, path, tokens.data(), tokens.size())) {
+      return false;
+    }
+    std::vector<model_token> tokens_out(64);
+    size_t n_token_out = 0;
+    bool ok = model_load_session_file(&dst, path, tokens_out.data(), tokens_out.size(), &n_token_out);
+    tokens_out.resize(n_token_out);
+    ok = ok && tokens_out == tokens && dst.model.kv_self.n == n_tok && dst.logits == src.logits &&
+         dst.embedding == src.embedding && dst.rng() == src.rng() && kv_bytes(&dst, n_tok) == kv_bytes(&src, n_tok);
+    // the KV region holds the n_tok tokens only, scales included
+    const auto& hparams = src.model.hparams;
+    const size_t n_embd_kv = hparams.n_head_kv * (hparams.n_embd / hparams.n_head);
+    const size_t scale_size = type == NE_TYPE_I8 ? sizeof(float) * hparams.n_head_kv : 0;
+    ok = ok && kv_bytes(&src, n_tok).size() ==
+                   hparams.n_layer * n_tok * 2 * (n_embd_kv * ne_type_size(type) + scale_size);
+
+    // a model with other KV heads doesn't take the file
+    model_context other;
+    init_context(&other, type, n_head, n_head_kv == n_head ? n_head / 2 : n_head);
+    ok = ok && !model_load_session_file(&other, path, tokens_out.data(), tokens_out.size(), &n_token_out);
+    remove(path);
+    printf("type %d n_head_kv %d %s%s: %s\n", type, n_head_kv, v1 ? "version 1" : "version 3",
+           compress ? " deflated" : "", ok ? "OK" : "FAILED");
+    return ok;
+  }
+};
+static const TestSessionFile inst_;
+
+}  // namespace
+
+int main() {
+  printf("NE_TESTS: model_utils ");
+  printf(return_success ? "OK\n" : "FAILED\n");
+  return return_success ? 0 : -1;
+}
+#endif
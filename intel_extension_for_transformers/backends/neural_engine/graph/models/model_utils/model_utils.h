@@ -46,12 +46,18 @@
 #define MODEL_FILE_MAGIC MODEL_FILE_MAGIC_GGJT
 #define MODEL_FILE_MAGIC_UNVERSIONED MODEL_FILE_MAGIC_NE
 #define MODEL_SESSION_MAGIC MODEL_FILE_MAGIC_GGSN
-#define MODEL_SESSION_VERSION 1
+#define MODEL_SESSION_VERSION 3
 
 void model_load_internal(const std::string& fname, model_name name, model_context& lctx, int n_ctx, int n_gpu_layers,
                          ne_type memory_type, bool use_mmap, bool use_mlock, bool vocab_only,
                          model_progress_callback progress_callback, void* progress_callback_user_data);
 
+struct gpt_params;
+
+// copy the options every model takes the same way from the command line: the gemm compute type, the NUMA split,
+// the huge pages and memory policy of the buffers and the session file compression
+void model_context_params_from_gpt_params(const gpt_params& params, struct model_context_params* lparams);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -94,6 +100,12 @@ MODEL_API int model_apply_lora_from_file(struct model_context* ctx, const char*
 // Returns the number of tokens in the KV cache
 MODEL_API int model_get_kv_cache_token_count(const struct model_context* ctx);
 
+// Evicts n_discard tokens of the KV cache after its first n_keep tokens (the attention sinks), the tokens after them
+// are moved down and re-positioned without recomputation, so that the generation goes on in a rolling window.
+// Their rotary K is rotated to the new positions, ALiBi and learned position embeddings need no update.
+// Returns the new n_past, n_past - n_discard
+MODEL_API int model_kv_cache_shift(struct model_context* ctx, int n_past, int n_keep, int n_discard, int n_threads);
+
 // Sets the current rng seed.
 MODEL_API void model_set_rng_seed(struct model_context* ctx, int seed);
 
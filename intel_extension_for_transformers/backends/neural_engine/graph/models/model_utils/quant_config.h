@@ -84,24 +84,45 @@ static inline quant_comp parse_compute_type(std::string arg) {
   return quant_comp::count;
 }
 
+enum class quant_wdtype : int {
+  integer = 0,  // int4/int8 by quant_bits
+  fp8_e4m3,     // jblas fp8 weight, 1:4:3
+  fp8_e5m2,     // jblas fp8 weight, 1:5:2
+  count,
+};
+static inline quant_wdtype parse_weight_dtype(std::string arg) {
+  if (arg == "int") {
+    return quant_wdtype::integer;
+  }
+  if (arg == "fp8_e4m3") {
+    return quant_wdtype::fp8_e4m3;
+  }
+  if (arg == "fp8_e5m2") {
+    return quant_wdtype::fp8_e5m2;
+  }
+  return quant_wdtype::count;
+}
+
 struct quant_params_internal {
   quant_bits bits = quant_bits::q4;
   quant_alg alg = quant_alg::sym;
   int32_t block_size = 32;
   quant_sdtype scale_dtype = quant_sdtype::fp16;
   quant_comp compute_type = quant_comp::ggml;
+  quant_wdtype weight_dtype = quant_wdtype::integer;
   bool valid() const {
     return bits != quant_bits::count && alg != quant_alg::count && scale_dtype != quant_sdtype::count &&
-           compute_type != quant_comp::count && block_size > 0;
+           compute_type != quant_comp::count && weight_dtype != quant_wdtype::count && block_size > 0;
   }
   std::string getstr() {
     return std::to_string(int(bits)) + "_" + std::to_string(int(alg)) + "_" + std::to_string(block_size) + "_" +
-           std::to_string(int(scale_dtype)) + "_" + std::to_string(int(compute_type));
+           std::to_string(int(scale_dtype)) + "_" + std::to_string(int(compute_type)) + "_" +
+           std::to_string(int(weight_dtype));
   }
 };
 
 static inline ne_type quant_params_to_type(const quant_params_internal& params) {
-  if (params.compute_type == quant_comp::ggml) {
+  if (params.compute_type == quant_comp::ggml && params.weight_dtype == quant_wdtype::integer) {
     if (params.bits == quant_bits::q4) {
       if (params.alg == quant_alg::sym) {
         return NE_TYPE_Q4_0;
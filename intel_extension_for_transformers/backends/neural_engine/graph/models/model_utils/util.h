@@ -53,6 +53,8 @@
 #include <windows.h>
 #endif
 
+#include "core/layers/numa.h"
+
 #define MODEL_ASSERT(x)                                                     \
   do {                                                                      \
     if (!(x)) {                                                             \
@@ -195,10 +197,14 @@ struct model_mmap {
 #ifdef __linux__
     flags |= MAP_POPULATE;
 #endif
+    // the page cache is filled under the policy of the faulting thread, not the one of the mapping
+    ne_mem_thread_policy(true);
     addr = mmap(NULL, file->size, PROT_READ, flags, fd, 0);
+    ne_mem_thread_policy(false);
     if (addr == MAP_FAILED) {
       throw std::runtime_error(format("mmap failed: %s", strerror(errno)));
     }
+    ne_mem_advise_huge_pages(addr, file->size);
 
     if (prefetch > 0) {
       // Advise the kernel to preload the mapped memory
@@ -402,16 +408,17 @@ struct model_mlock {
 struct model_buffer {
   uint8_t* addr = NULL;
   size_t size = 0;
+  size_t page_size = 0;  // 0 if it is on the heap
 
   model_buffer() = default;
 
   void resize(size_t len) {
-    delete[] addr;
-    addr = new uint8_t[len];
+    ne_mem_free(addr, size, page_size);
+    addr = reinterpret_cast<uint8_t*>(ne_mem_alloc(len, &page_size));
     size = len;
   }
 
-  ~model_buffer() { delete[] addr; }
+  ~model_buffer() { ne_mem_free(addr, size, page_size); }
 
   // disable copy and move
   model_buffer(const model_buffer&) = delete;
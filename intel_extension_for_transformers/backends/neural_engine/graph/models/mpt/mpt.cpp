@@ -31,6 +31,7 @@
 #include "core/data_types.h"
 #include "core/ne.h"
 #include "core/ne_layers.h"
+#include "models/model_utils/model_block.h"
 #include "models/model_utils/model_config.h"
 #include "models/model_utils/model_utils.h"
 #include "models/model_utils/util.h"
@@ -50,228 +51,53 @@ static bool mpt_model_eval_internal(model_context& lctx, const model_token* toke
   //   return false;
   // }
 
-  const int64_t t_start_us = ne_time_us();
-
-  const int N = n_tokens;
-
   const auto& model = lctx.model;
   const auto& hparams = model.hparams;
 
-  const auto& kv_self = model.kv_self;
-
-  MODEL_ASSERT(!!kv_self.ctx);
-
-  const int n_embd = hparams.n_embd;
   const int n_layer = hparams.n_layer;
-  const int n_ctx = hparams.n_ctx;
-  const int n_head = hparams.n_head;
-  const int n_vocab = hparams.n_vocab;
-  // const int n_rot = hparams.n_embd / hparams.n_head;
-
-  auto& mem_per_token = lctx.mem_per_token;
-  auto& buf_compute = lctx.buf_compute;
-
-  struct ne_init_params params = {
-      /*.mem_size   =*/buf_compute.size,
-      /*.mem_buffer =*/buf_compute.addr,
-      /*.no_alloc   =*/false,
-  };
-
-  struct ne_context* ctx0 = ne_init(params);
 
-  // for big prompts, if BLAS is enabled, it is better to use only one thread
-  // otherwise, the threads are spin-lock waiting for the BLAS calls and are degrading the performance
-  ne_cgraph gf = {};
-  gf.n_threads = N >= 32 && ne_cpu_has_blas() ? 1 : n_threads;
+  model_block_config config;
+  config.norm = MODEL_NORM_LAYER;
+  config.pos = MODEL_POS_ALIBI;
+  config.alibi_bias_max = hparams.alibi_bias_max;
+  config.clip_qkv = hparams.clip_qkv;
+  config.qkv = MODEL_QKV_FUSED;
+  config.ffn = MODEL_FFN_GELU;
 
-  struct ne_tensor* embd = d_ne_new_tensor_1d(ctx0, NE_TYPE_I32, N);
-  ne_set_name(embd, "embd");
-  memcpy(embd->data, tokens, N * ne_element_size(embd));
+  model_graph g;
+  model_graph_init(&g, lctx, tokens, n_tokens, n_past, n_threads);
+  struct ne_context* ctx0 = g.ctx0;
 
-  struct ne_tensor* inpL = ne_get_rows(ctx0, model.others[0], embd);
+  struct ne_tensor* inpL = ne_get_rows(ctx0, model.others[0], g.embd);
 
   for (int il = 0; il < n_layer; ++il) {
-    struct ne_tensor* cur;
-
-    lctx.use_buf(ctx0, 0);
-
-    // norm
-    {
-      cur = ne_norm(ctx0, inpL);
-
-      cur = ne_mul(ctx0, ne_repeat(ctx0, model.layers[il].norm[0], cur), cur);
-    }
-
-    {
-      cur = ne_mul_mat(ctx0, model.layers[il].attn[0], cur);
-
-      if (model.hparams.clip_qkv > 0.0f) {
-        cur = ne_clamp(ctx0, cur, -model.hparams.clip_qkv, model.hparams.clip_qkv);
-      }
-
-      struct ne_tensor* Qcur = ne_view_2d(ctx0, cur, n_embd, N, cur->nb[1], 0 * sizeof(float) * n_embd);
-      struct ne_tensor* Kcur = ne_view_2d(ctx0, cur, n_embd, N, cur->nb[1], 1 * sizeof(float) * n_embd);
-
-      // store key and value to memory
-      {
-        struct ne_tensor* Vcur =
-            ne_transpose(ctx0, ne_view_2d(ctx0, cur, n_embd, N, cur->nb[1], 2 * sizeof(float) * n_embd));
-        struct ne_tensor* k =
-            ne_view_1d(ctx0, kv_self.k, N * n_embd, (ne_element_size(kv_self.k) * n_embd) * (il * n_ctx + n_past));
-        struct ne_tensor* v =
-            ne_view_2d(ctx0, kv_self.v, N, n_embd, (n_ctx)*ne_element_size(kv_self.v),
-                       (il * n_ctx) * ne_element_size(kv_self.v) * n_embd + n_past * ne_element_size(kv_self.v));
-        // important: storing RoPE-ed version of K in the KV cache!
-        ne_build_forward_expand(&gf, ne_cpy(ctx0, Kcur, k));
-        ne_build_forward_expand(&gf, ne_cpy(ctx0, Vcur, v));
-      }
-
-      // Q = Qcur.contiguous().view(n_embd/n_head, n_head, N).permute(0,
-      // 2, 1, 3) [64, N, 12]
-      struct ne_tensor* Q = ne_permute(
-          ctx0, ne_cpy(ctx0, Qcur, ne_new_tensor_3d(ctx0, NE_TYPE_F32, n_embd / n_head, n_head, N, NE_SIZE_CALC)), 0, 2,
-          1, 3);
-
-      // K = Kmem.view(n_embd/n_head, n_head, n_past + N).permute(0, 2, 1,
-      // 3) [64, n_past + N, 12]
-      struct ne_tensor* K = ne_permute(ctx0,
-                                       ne_reshape_3d(ctx0,
-                                                     ne_view_1d(ctx0, kv_self.k, (n_past + N) * n_embd,
-                                                                il * n_ctx * ne_element_size(kv_self.k) * n_embd),
-                                                     n_embd / n_head, n_head, n_past + N),
-                                       0, 2, 1, 3);
-      // K * Q
-      struct ne_tensor* KQ = ne_mul_mat(ctx0, K, Q);
-
-      // KQ_scaled = KQ / sqrt(n_embd/n_head)
-      struct ne_tensor* KQ_scaled = ne_scale(ctx0, KQ, ne_new_f32(ctx0, 1.0f / sqrt(float(n_embd) / n_head)));
-
-      struct ne_tensor* KQ_scaled_alibi = ne_alibi(ctx0, KQ_scaled, n_past, n_head, model.hparams.alibi_bias_max);
-
-      // KQ_masked = mask_past(KQ_scaled)
-      struct ne_tensor* KQ_masked = ne_diag_mask_inf(ctx0, KQ_scaled_alibi, n_past);
-
-      // KQ = soft_max(KQ_masked)
-      struct ne_tensor* KQ_soft_max = ne_soft_max(ctx0, KQ_masked);
-
-      // V_trans = Vmem.view(n_embd/n_head, n_head, n_past + N).permute(1,
-      // 2, 0, 3).contiguous() [n_past + N, 64, 12]
-      struct ne_tensor* V_trans = ne_view_3d(
-          ctx0, kv_self.v, n_past + N, n_embd / n_head, n_head, n_ctx * ne_element_size(kv_self.v),
-          n_ctx * ne_element_size(kv_self.v) * n_embd / n_head, il * n_ctx * ne_element_size(kv_self.v) * n_embd);
-
-      // KQV = transpose(V) * KQ_soft_max
-      struct ne_tensor* KQV = ne_mul_mat(ctx0, V_trans, KQ_soft_max);
-
-      // KQV_merged = KQV.permute(0, 2, 1, 3)
-      struct ne_tensor* KQV_merged = ne_permute(ctx0, KQV, 0, 2, 1, 3);
-
-      // cur = KQV_merged.contiguous().view(n_embd, N)
-      cur = ne_cpy(ctx0, KQV_merged, ne_new_tensor_2d(ctx0, NE_TYPE_F32, n_embd, N, NE_SIZE_CALC));
-
-      // projection
-      { cur = ne_mul_mat(ctx0, model.layers[il].attn[1], cur); }
-    }
-    inpL = ne_add(ctx0, inpL, cur);
-
-    lctx.use_buf(ctx0, 1);
-
-    // m = self.ln_2(x)
-    {
-      cur = ne_norm(ctx0, inpL);
-
-      cur = ne_mul(ctx0, ne_repeat(ctx0, model.layers[il].norm[1], cur), cur);
-    }
-
-    // n = self.mlp(m)
-    {
-      cur = ne_mul_mat(ctx0, model.layers[il].ffn[0], cur);
-
-      // GELU activation
-      cur = ne_gelu(ctx0, cur);
-
-      // projection
-      // cur = proj_w*cur + proj_b
-      cur = ne_mul_mat(ctx0, model.layers[il].ffn[1], cur);
-    }
-
-    // x = x + n
-    inpL = ne_add(ctx0, inpL, cur);
+    const model_layer& layer = model.layers[il];
+    // no biases
+    model_block_weights weights = {};
+    weights.attn_norm_w = layer.norm[0];
+    weights.ffn_norm_w = layer.norm[1];
+    weights.wqkv = layer.attn[0];
+    weights.wo = layer.attn[1];
+    weights.ffn_up = layer.ffn[0];
+    weights.ffn_down = layer.ffn[1];
+
+    inpL = model_block_forward(&g, config, weights, il, inpL);
   }
 
   lctx.use_buf(ctx0, 0);
-  // used at the end to optionally extract the embeddings
-  struct ne_tensor* embeddings = NULL;
 
-  // norm
-  {
-    inpL = ne_norm(ctx0, inpL);
-    // inpL = ln_f_g*inpL
-    inpL = ne_mul(ctx0, ne_repeat(ctx0, model.others[1], inpL), inpL);
-  }
+  // norm, used at the end to optionally extract the embeddings
+  struct ne_tensor* embeddings = model_norm(ctx0, MODEL_NORM_LAYER, inpL, model.others[1], NULL);
 
   lctx.use_buf(ctx0, -1);
 
   // output embedding weight tied to input embedding
-  inpL = ne_mul_mat(ctx0, model.others[0], inpL);
+  inpL = ne_mul_mat(ctx0, model.others[0], embeddings);
 
   // logits -> probs
   // inpL = ne_soft_max(ctx0, inpL);
 
-  // run the computation
-  ne_build_forward_expand(&gf, inpL);
-  ne_graph_compute(ctx0, &gf);
-
-#ifdef NE_PERF
-  bool engine_profiling_ = (getenv("ENGINE_PROFILING") != NULL);
-  if (engine_profiling_) {
-    ne_graph_profiling(&gf);
-  }
-#endif
-
-  // update kv token count
-  lctx.model.kv_self.n = n_past + N;
-
-  // extract logits
-  {
-    auto& logits_out = lctx.logits;
-
-    if (lctx.logits_all) {
-      logits_out.resize(n_vocab * N);
-      memcpy(logits_out.data(), (float*)ne_get_data(inpL), sizeof(float) * n_vocab * N);
-    } else {
-      // return result for just the last token
-      logits_out.resize(n_vocab);
-      memcpy(logits_out.data(), (float*)ne_get_data(inpL) + (n_vocab * (N - 1)), sizeof(float) * n_vocab);
-    }
-  }
-
-  // extract embeddings
-  if (!lctx.embedding.empty()) {
-    auto& embedding_out = lctx.embedding;
-
-    embedding_out.resize(n_embd);
-    memcpy(embedding_out.data(), (float*)ne_get_data(embeddings) + (n_embd * (N - 1)), sizeof(float) * n_embd);
-  }
-
-  if (mem_per_token == 0) {
-    mem_per_token = ne_used_mem(ctx0) / N;
-  }
-
-  ne_free(ctx0);
-
-  // measure the performance only for the single-token evals
-  int64_t time_interval = ne_time_us() - t_start_us;
-  if (N == 1) {
-    lctx.t_eval_us += time_interval;
-    lctx.n_eval++;
-  } else if (N > 1) {
-    lctx.t_p_eval_us += time_interval;
-    lctx.n_p_eval += N;
-  }
-  lctx.eval_times.push_back(time_interval);
-
-  return true;
+  return model_graph_compute(&g, inpL, embeddings);
 }
 
 int model_eval(struct model_context* ctx, const model_token* tokens, int n_tokens, int n_past, int n_threads) {
@@ -313,6 +139,7 @@ struct model_context* model_init_from_gpt_params(const gpt_params& params) {
   lparams.use_mlock = params.use_mlock;
   lparams.logits_all = params.perplexity;
   lparams.embedding = params.embedding;
+  model_context_params_from_gpt_params(params, &lparams);
 
   model_context* lctx = model_init_from_file(params.model.c_str(), lparams);
 
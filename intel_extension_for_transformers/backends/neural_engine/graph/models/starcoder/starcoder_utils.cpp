@@ -67,11 +67,15 @@ void STARCODER::init(const char* path_model, model_context& lctx, int n_ctx_, in
   auto& hparams = model.hparams;
   n_ff = 4 * hparams.n_embd;
   hparams.n_ctx = n_ctx;
+  // multi-query attention has a single K and V head in c_attn, older conversions repeat it n_head times
+  const uint32_t head_dim = hparams.n_embd / hparams.n_head;
+  hparams.n_head_kv = (ml->get_tensor_ne("model/h0/attn/c_attn/w").at(1) - hparams.n_embd) / (2 * head_dim);
   fprintf(stderr, "%s: n_vocab    = %u\n", __func__, hparams.n_vocab);
   fprintf(stderr, "%s: n_ctx      = %u\n", __func__, hparams.n_ctx);
   fprintf(stderr, "%s: n_embd     = %u\n", __func__, hparams.n_embd);
   fprintf(stderr, "%s: n_mult     = %u\n", __func__, hparams.n_mult);
   fprintf(stderr, "%s: n_head     = %u\n", __func__, hparams.n_head);
+  fprintf(stderr, "%s: n_head_kv  = %u\n", __func__, hparams.n_head_kv);
   fprintf(stderr, "%s: n_layer    = %u\n", __func__, hparams.n_layer);
   fprintf(stderr, "%s: n_rot      = %u\n", __func__, hparams.n_rot);
   fprintf(stderr, "%s: n_ff       = %u\n", __func__, n_ff);
@@ -115,7 +119,7 @@ void STARCODER::load(model_context& lctx, model_progress_callback progress_callb
 
   const auto& hparams = model.hparams;
   const int head_dim = n_embd / hparams.n_head;
-  const int kv_heads = hparams.n_head;  // 1 if MQA else hparams.n_head
+  const int kv_heads = hparams.n_head_kv;
   const int kv_dim = kv_heads * head_dim;
 
   model.others[0] = ml->get_tensor("model/ln_f/g", {n_embd}, NE_BACKEND_CPU);
@@ -613,11 +613,13 @@ def convert_transformers_to_orig(model: LazyModel) -> LazyModel:
     out["output.weight"] = model["lm_head.weight"]
 
     n_head = model["model.layers.0.self_attn.q_proj.weight"].shape[1] // 128
+    # grouped-query attention (e.g. Llama-2-70B) has fewer K and V heads, which are kept as is
+    n_head_kv = model["model.layers.0.self_attn.k_proj.weight"].shape[0] // 128
     for i in itertools.count():
         if f"model.layers.{i}.self_attn.q_proj.weight" not in model:
             break
         out[f"layers.{i}.attention.wq.weight"] = permute_lazy(model[f"model.layers.{i}.self_attn.q_proj.weight"], n_head)
-        out[f"layers.{i}.attention.wk.weight"] = permute_lazy(model[f"model.layers.{i}.self_attn.k_proj.weight"], n_head)
+        out[f"layers.{i}.attention.wk.weight"] = permute_lazy(model[f"model.layers.{i}.self_attn.k_proj.weight"], n_head_kv)
         out[f"layers.{i}.attention.wv.weight"] = model[f"model.layers.{i}.self_attn.v_proj.weight"]
         out[f"layers.{i}.attention.wo.weight"] = model[f"model.layers.{i}.self_attn.o_proj.weight"]
 
@@ -187,28 +187,6 @@ def main(args_in: Optional[List[str]] = None) -> None:
                 data = data.astype(np.float32)
                 ftype = 0
 
-        # TODO NE MHA kernel without kv broadcast or repeat (when multi_query == True)
-        if name[-14:] == "/attn/c_attn/w" or name[-14:] == "/attn/c_attn/b":
-            print("  Duplicate K,V heads to use MHA instead of MQA")
-
-            embed_dim = hparams["n_embd"]
-            head_dim = embed_dim // hparams["n_head"]
-
-            # ((n_heads + 2) * head_dim, hidden_dim) -> (3 * n_heads * head_dim, hidden_dim)
-            q, k ,v = np.split(data, (hparams["n_head"] * head_dim,
-                                    (hparams["n_head"] + 1) * head_dim), axis=0)
-            # duplicate k, v along the first axis (head_dim, hidden_dim) ->
-            #                                     (n_heads * head_dim, hidden_dim)
-            if len(k.shape) == 2:
-                k = np.tile(k, (hparams["n_head"], 1))
-                v = np.tile(v, (hparams["n_head"], 1))
-            elif len(k.shape) == 1:
-                k = np.tile(k, (hparams["n_head"]))
-                v = np.tile(v, (hparams["n_head"]))
-            # concat q, k, v along the first axis (n_heads * head_dim, hidden_dim) ->
-            #                                     (3 * n_heads * head_dim, hidden_dim)
-            data = np.concatenate((q, k, v), axis=0)
-
         # header
         str = name.encode('utf-8')
         fout.write(struct.pack("iii", n_dims, len(str), ftype))
@@ -55,6 +55,8 @@
 #endif
 #define NE_F32x8_ADD _mm256_add_ps
 #define NE_F32x8_MUL _mm256_mul_ps
+#define NE_F32x8_SUB _mm256_sub_ps
+#define NE_F32x8_DIV _mm256_div_ps
 #define NE_F32x8_REDUCE(res, x)                                                                 \
   {                                                                                             \
     for (int i = 0; i < NE_F32_ARR / 2; ++i) {                                                  \
@@ -80,6 +82,8 @@
 #define NE_F32_VEC_FMA NE_F32x8_FMA
 #define NE_F32_VEC_ADD NE_F32x8_ADD
 #define NE_F32_VEC_MUL NE_F32x8_MUL
+#define NE_F32_VEC_SUB NE_F32x8_SUB
+#define NE_F32_VEC_DIV NE_F32x8_DIV
 #define NE_F32_VEC_REDUCE NE_F32x8_REDUCE
 
 // F16 AVX
@@ -155,6 +159,8 @@ static inline void __avx_f32cx8_store(ne_fp16_t* x, __m256 y) {
 #endif
 #define NE_F32x4_ADD _mm_add_ps
 #define NE_F32x4_MUL _mm_mul_ps
+#define NE_F32x4_SUB _mm_sub_ps
+#define NE_F32x4_DIV _mm_div_ps
 #define NE_F32x4_REDUCE(res, x)                      \
   {                                                  \
     for (int i = 0; i < NE_F32_ARR / 2; ++i) {       \
@@ -179,6 +185,8 @@ static inline void __avx_f32cx8_store(ne_fp16_t* x, __m256 y) {
 #define NE_F32_VEC_FMA NE_F32x4_FMA
 #define NE_F32_VEC_ADD NE_F32x4_ADD
 #define NE_F32_VEC_MUL NE_F32x4_MUL
+#define NE_F32_VEC_SUB NE_F32x4_SUB
+#define NE_F32_VEC_DIV NE_F32x4_DIV
 #define NE_F32_VEC_REDUCE NE_F32x4_REDUCE
 
 // F16 SSE
@@ -23,6 +23,7 @@
 namespace jd {
 namespace ssd {
 struct eltwiseop_param_t {
+  bool use_avx512 = true;
   size_t element_num;
   data_type in_dt;
   data_type out_dt;
@@ -23,6 +23,7 @@ namespace ssd {
 enum spec_translnorm_type { normal, direct };
 
 struct layernorm_ba_param_t {
+  bool use_avx512 = true;
   data_type input_dt;
   data_type output_dt;
   data_type output2_dt;
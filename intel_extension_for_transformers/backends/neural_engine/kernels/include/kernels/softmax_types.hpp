@@ -25,6 +25,7 @@ namespace ssd {
 enum spec_softmax_type { lut };
 
 struct softmax_param_t {
+  bool use_avx512 = true;
   spec_softmax_type sepc_type;
   data_type input_dt;
   data_type output_dt;
@@ -13,6 +13,9 @@
 //  limitations under the License.
 
 #include "src/cpu/cpu_isa.hpp"
+
+#include <cstdlib>
+#include <cstring>
 #ifdef __linux__
 #include <sys/syscall.h>
 #endif  // __linux__
@@ -56,4 +59,12 @@ set_once_before_first_get_setting_t<bool>& amx_setting() {
   return setting;
 }
 
+cpu_isa_t& max_isa() {
+  static cpu_isa_t isa = [] {
+    const char* val = std::getenv("SPARSE_LIB_MAX_ISA");
+    return val != nullptr && strcmp(val, "avx2") == 0 ? avx2 : isa_any;
+  }();
+  return isa;
+}
+
 }  // namespace jd
@@ -25,9 +25,10 @@ static constexpr int cpu_isa_total_bits = sizeof(unsigned) * 8;
 
 enum cpu_isa_bit_t : unsigned {
   // Fill in features from least significant bit to most significant bit
-  // begin from avx512, isa < avx512 will be dsiptached to reference
+  // begin from avx2, isa < avx2 will be dsiptached to reference
   // for more details abount AVX512-ISA supported status in different architectures, pls refer to this
   // page:https://en.wikipedia.org/wiki/AVX-512#CPUs_with_AVX-512
+  avx2_bit = 1u << 4,
   avx512_vbmi = 1u << 5,
   avx512_core_bit = 1u << 6,
   avx512_core_vnni_bit = 1u << 7,
@@ -41,6 +42,7 @@ enum cpu_isa_bit_t : unsigned {
 
 enum cpu_isa_t : unsigned {
   isa_any = 0u,
+  avx2 = avx2_bit,
   avx512_core = avx512_core_bit,
   avx512_core_vnni = avx512_core_vnni_bit | avx512_core,
   avx512_core_bf16 = avx512_core_bf16_bit | avx512_core_vnni,
@@ -63,10 +65,17 @@ inline const Xbyak::util::Cpu& cpu() {
 
 set_once_before_first_get_setting_t<bool>& amx_setting();
 
+// The highest ISA kernels may dispatch to: isa_any for no limit, or avx2 to hide every AVX512/AMX feature. It is read
+// from SPARSE_LIB_MAX_ISA=avx2 at startup, and tests lower it to run the AVX2 fallbacks on AVX512 machines.
+cpu_isa_t& max_isa();
+
 static inline bool isa_available(const cpu_isa_t cpu_isa) {
   using Cpu = Xbyak::util::Cpu;
 
+  if (max_isa() == avx2 && cpu_isa != avx2 && cpu_isa != isa_any) return false;
   switch (cpu_isa) {
+    case avx2:
+      return cpu().has(Cpu::tAVX2) && cpu().has(Cpu::tFMA);
     case avx512_core:
       return cpu().has(Cpu::tAVX512F) && cpu().has(Cpu::tAVX512BW) && cpu().has(Cpu::tAVX512VL) &&
              cpu().has(Cpu::tAVX512DQ);
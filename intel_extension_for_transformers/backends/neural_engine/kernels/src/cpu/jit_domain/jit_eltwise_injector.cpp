@@ -50,6 +50,11 @@ void jit_eltwise_injector::assert_check(const std::vector<postop_attr>& postop_a
       int_lut_flag = true;
     }
 
+    if (!avx512_) {
+      SPARSE_LOG_IF(FATAL, cur_alg == postop_alg::eltop_int_lut) << "eltop_int_lut needs avx512";
+      SPARSE_LOG_IF(FATAL, cur_dt == data_type::bf16) << "bf16 postop needs avx512";
+    }
+
     if (cur_alg == postop_alg::quantize || cur_attr.op_alg == postop_alg::dequantize) {
       quant_flag = true;
       SPARSE_LOG_IF(FATAL, !(cur_dt == data_type::s8 || cur_dt == data_type::u8)) << "should quantize to s8/u8";
@@ -70,8 +75,10 @@ void jit_eltwise_injector::assert_check(const std::vector<postop_attr>& postop_a
   }
 }
 
-void jit_eltwise_injector::vector_compute(const Xbyak::Zmm& zmm_src, const std::vector<postop_attr>& postop_attrs,
+void jit_eltwise_injector::vector_compute(const Xbyak::Xmm& zmm_src, const std::vector<postop_attr>& postop_attrs,
                                           std::vector<int> postop_idxs) {
+  SPARSE_LOG_IF(FATAL, !zmm_src.isZMM() && !zmm_src.isYMM()) << "eltwise_injector computes on zmm or ymm";
+  avx512_ = zmm_src.isZMM();
   if (postop_idxs.size() == 0) {
     for (std::size_t i = 0; i < postop_attrs.size(); i++) postop_idxs.push_back(i);
   }
@@ -81,7 +88,7 @@ void jit_eltwise_injector::vector_compute(const Xbyak::Zmm& zmm_src, const std::
   assign_regs();
   load_table_addr();
 
-  auto task_dispatch = [&](const Xbyak::Zmm& zmm_src) {
+  auto task_dispatch = [&](const Xbyak::Xmm& zmm_src) {
     switch (cur_postop_attr_.op_alg) {
       case postop_alg::exp:
         exp_compute_vector_fwd(zmm_src);
@@ -132,7 +139,7 @@ void jit_eltwise_injector::vector_compute(const Xbyak::Zmm& zmm_src, const std::
       h->vcvtneps2bf16(ymm_src, zmm_src);  // 0-255bit of zmm_src compute ans store in ymm_src.
 
       ymm_tmp = Ymm(zmm_tmp.getIdx());
-      h->vextractf32x8(ymm_tmp, zmm_tmp, 1);  // shuffle the high 256bit to the low 256 bit.
+      h->vextractf32x8(ymm_tmp, Zmm(zmm_tmp.getIdx()), 1);  // shuffle the high 256bit to the low 256 bit.
       h->vpmovzxwd(zmm_tmp, ymm_tmp);
       h->vpslld(zmm_tmp, zmm_tmp, 16);
       task_dispatch(zmm_tmp);
@@ -150,9 +157,9 @@ void jit_eltwise_injector::vector_compute(const Xbyak::Zmm& zmm_src, const std::
   }
 }
 
-void jit_eltwise_injector::bit8_lut_compute_vector_fwd(const Zmm& zmm_src) {
+void jit_eltwise_injector::bit8_lut_compute_vector_fwd(const Xmm& zmm_src) {
   // regs renaming.
-  Zmm zmm_bk = zmm_aux0;
+  Xmm zmm_bk = zmm_aux0;
   h->vmovups(zmm_bk, zmm_src);
   // zmm can store 64 byte data, the size of our bit8-lut is 256 byte, so we need to loop 4 times so that we can search
   // all terms
@@ -165,9 +172,9 @@ void jit_eltwise_injector::bit8_lut_compute_vector_fwd(const Zmm& zmm_src) {
   }
 }
 
-void jit_eltwise_injector::bit16_lut_compute_vector_fwd(const Zmm& zmm_src) {
+void jit_eltwise_injector::bit16_lut_compute_vector_fwd(const Xmm& zmm_src) {
   // regs renaming.
-  Zmm zmm_bk = zmm_aux0;
+  Xmm zmm_bk = zmm_aux0;
   if (cur_postop_attr_.dt == data_type::u8 || cur_postop_attr_.dt == data_type::s8)
     h->vpmovzxbw(zmm_src, Ymm(zmm_src.getIdx()));  // zeropadding
   h->vmovups(zmm_bk, zmm_src);
@@ -184,34 +191,57 @@ void jit_eltwise_injector::bit16_lut_compute_vector_fwd(const Zmm& zmm_src) {
   }
 }
 
-void jit_eltwise_injector::linear_compute_vector_fwd(const Zmm& zmm_src) {
+void jit_eltwise_injector::linear_compute_vector_fwd(const Xmm& zmm_src) {
   auto key = get_attr_idx_key(cur_postop_attr_);
   h->vmovups(zmm_aux0, table_val(alpha, alpha_idx_map[key]));
   h->vfmadd213ps(zmm_src, zmm_aux0, table_val(beta, beta_idx_map[key]));
 }
 
-void jit_eltwise_injector::low_precision_exp_compute_vector_fwd(const Zmm& zmm_src) {
-  h->exp_approx_f32(zmm_src, zmm_src, table_val(exp_log2ef), table_val(ln2f),  //
-                    table_val(low_precision_exp_const_v0), table_val(low_precision_exp_const_v1),
-                    table_val(low_precision_exp_const_v2), {zmm_aux1, zmm_aux2});
+void jit_eltwise_injector::low_precision_exp_compute_vector_fwd(const Xmm& zmm_src) {
+  if (avx512_) {
+    h->exp_approx_f32(Zmm(zmm_src.getIdx()), Zmm(zmm_src.getIdx()), table_val(exp_log2ef), table_val(ln2f),  //
+                      table_val(low_precision_exp_const_v0), table_val(low_precision_exp_const_v1),
+                      table_val(low_precision_exp_const_v2), {Zmm(zmm_aux1.getIdx()), Zmm(zmm_aux2.getIdx())});
+    return;
+  }
+  // exp_approx_f32 without vscalefps: clamp x so that 2^z is built from the exponent bits without wrapping around
+  h->vminps(zmm_src, zmm_src, table_val(exp_ln_flt_max_f));
+  h->vmaxps(zmm_src, zmm_src, table_val(exp_ln_flt_min_f));
+  h->vmulps(zmm_aux1, zmm_src, table_val(exp_log2ef));  // x / ln2
+  h->vroundps(zmm_aux1, zmm_aux1, 0x2);                 // round up
+  h->vmulps(zmm_aux2, zmm_aux1, table_val(ln2f));
+  h->vsubps(zmm_aux2, zmm_src, zmm_aux2);  // x mod ln2
+  h->vmovups(zmm_src, table_val(low_precision_exp_const_v1));
+  h->vfmadd231ps(zmm_src, zmm_aux2, table_val(low_precision_exp_const_v0));  // f * c0 + c1
+  h->vfmadd213ps(zmm_src, zmm_aux2, table_val(low_precision_exp_const_v2));  // (f * c0 + c1) * f + c2
+  h->vcvtps2dq(zmm_aux1, zmm_aux1);
+  h->vpaddd(zmm_aux1, zmm_aux1, table_val(exponent_bias));
+  h->vpslld(zmm_aux1, zmm_aux1, n_mantissa_bits);
+  h->vmulps(zmm_src, zmm_src, zmm_aux1);  // exp(f) * 2^z
 }
 
-void jit_eltwise_injector::swish_compute_vector_fwd(const Zmm& zmm_src) {
+void jit_eltwise_injector::swish_compute_vector_fwd(const Xmm& zmm_src) {
   auto key = get_attr_idx_key(cur_postop_attr_);
   h->vmovups(zmm_aux0, zmm_src);
   h->vmulps(zmm_aux0, zmm_aux0, table_val(alpha, alpha_idx_map[key]));
   low_precision_exp_compute_vector_fwd(zmm_aux0);
   h->vaddps(zmm_aux0, zmm_aux0, table_val(one));
-  h->vrcp14ps(zmm_aux0, zmm_aux0);
+  if (avx512_)
+    h->vrcp14ps(zmm_aux0, zmm_aux0);
+  else
+    h->vrcpps(zmm_aux0, zmm_aux0);
   h->vmulps(zmm_src, zmm_src, zmm_aux0);
 }
 
-void jit_eltwise_injector::quantize_compute_vector_fwd(const Zmm& zmm_src) {
+void jit_eltwise_injector::quantize_compute_vector_fwd(const Xmm& zmm_src) {
   auto key = get_attr_idx_key(cur_postop_attr_);
   h->vmovups(zmm_aux0, table_val(scale, scale_idx_map[key]));
   h->vfmadd213ps(zmm_src, zmm_aux0, table_val(alpha, alpha_idx_map[key]));
   if (cur_postop_attr_.dt == data_type::u8) {
-    h->vcvtps2udq(zmm_src, zmm_src);  // fp32->u32
+    if (avx512_)
+      h->vcvtps2udq(zmm_src, zmm_src);  // fp32->u32
+    else
+      h->vcvtps2dq(zmm_src, zmm_src);  // fp32->s32, negatives are cleared below
     h->vpmaxsd(zmm_src, zmm_src, table_val(zero));
   } else if (cur_postop_attr_.dt == data_type::s8) {
     h->vcvtps2dq(zmm_src, zmm_src);  // fp32->s32
@@ -220,7 +250,7 @@ void jit_eltwise_injector::quantize_compute_vector_fwd(const Zmm& zmm_src) {
   }
 }
 
-void jit_eltwise_injector::dequantize_compute_vector_fwd(const Zmm& zmm_src) {
+void jit_eltwise_injector::dequantize_compute_vector_fwd(const Xmm& zmm_src) {
   if (cur_postop_attr_.dt == data_type::u8)
     h->vpmovzxbd(zmm_src, Xmm(zmm_src.getIdx()));  // u8->s32
   else
@@ -231,9 +261,9 @@ void jit_eltwise_injector::dequantize_compute_vector_fwd(const Zmm& zmm_src) {
   h->vmulps(zmm_src, zmm_src, table_val(scale, scale_idx_map[key]));
 }
 
-void jit_eltwise_injector::tanh_compute_vector_fwd(const Zmm& zmm_src) {
+void jit_eltwise_injector::tanh_compute_vector_fwd(const Xmm& zmm_src) {
   // register mapping
-  Zmm zmm_dst = zmm_aux1, zmm_src_shift = zmm_aux1, zmm_coeff = zmm_aux1, zmm_pol = zmm_aux2, zmm_indices = zmm_aux3,
+  Xmm zmm_dst = zmm_aux1, zmm_src_shift = zmm_aux1, zmm_coeff = zmm_aux1, zmm_pol = zmm_aux2, zmm_indices = zmm_aux3,
       zmm_src_original = zmm_aux4, zmm_sign = zmm_aux4;
 
   const int tanh_n_polynomials = 32;
@@ -252,27 +282,43 @@ void jit_eltwise_injector::tanh_compute_vector_fwd(const Zmm& zmm_src) {
   auto coeffs_address = [&](int coeff_off, int off = 0) {
     return table_val(tanh_pol_table, coeff_off * tanh_n_polynomials + off);
   };
-  auto gather_coefficient = [&](Zmm vmm_coeff, int coeff_idx, Zmm vmm_pol_idx) {
-    Zmm zmm_coeff(vmm_coeff.getIdx());
-    Zmm zmm_pol_idx(vmm_pol_idx.getIdx());
-    h->vmovups(zmm_coeff, coeffs_address(coeff_idx, 0));
-    h->vpermt2ps(zmm_coeff, zmm_pol_idx, coeffs_address(coeff_idx, 16));
+  auto gather_coefficient = [&](const Xmm& vmm_coeff, int coeff_idx, const Xmm& vmm_pol_idx) {
+    if (avx512_) {
+      h->vmovups(vmm_coeff, coeffs_address(coeff_idx, 0));
+      h->vpermt2ps(vmm_coeff, vmm_pol_idx, coeffs_address(coeff_idx, 16));
+    } else {  // no 32-entry permutation without EVEX, gather from the table instead
+      h->vpcmpeqd(zmm_mask, zmm_mask, zmm_mask);
+      const auto off = table_off(tanh_pol_table, coeff_idx * tanh_n_polynomials);
+      h->vgatherdps(vmm_coeff, h->ptr[p_table + vmm_pol_idx * 4 + off], zmm_mask);
+    }
+  };
+  auto vand = [&](const Xmm& dst, const Xmm& src, const Xbyak::Operand& op) {
+    avx512_ ? h->vpandd(dst, src, op) : h->vpand(dst, src, op);
+  };
+  auto blend = [&](const Xmm& dst, const Xmm& src) {  // dst = src where zmm_mask > zmm_src
+    if (avx512_) {
+      h->vcmpps(k_mask, zmm_mask, zmm_src, _cmp_nle_us);
+      h->vblendmps(dst | k_mask, dst, src);
+    } else {
+      h->vcmpps(zmm_mask, zmm_mask, zmm_src, _cmp_nle_us);
+      h->vblendvps(dst, dst, src, zmm_mask);
+    }
   };
 
   // because tanh(x) = -tanh(-x), we extract sign to make x postive
   // and reapply sign at the end
   h->vmovups(zmm_src_original, zmm_src);
-  h->vpandd(zmm_src, zmm_src, table_val(positive_mask));
+  vand(zmm_src, zmm_src, table_val(positive_mask));
 
   // We compute the indices for the table lookup
   h->vmovups(zmm_indices, zmm_src);
   h->vpsubd(zmm_indices, zmm_indices, table_val(tanh_idx_bias));
-  h->vpandd(zmm_indices, zmm_indices, table_val(tanh_idx_mask));
+  vand(zmm_indices, zmm_indices, table_val(tanh_idx_mask));
   h->vpsrld(zmm_indices, zmm_indices, 22);
 
   // we do the argument reduction
   h->vmovups(zmm_src_shift, zmm_src);
-  h->vpandd(zmm_src_shift, zmm_src_shift, table_val(tanh_idx_mask));
+  vand(zmm_src_shift, zmm_src_shift, table_val(tanh_idx_mask));
   h->vsubps(zmm_src, zmm_src, zmm_src_shift);
 
   // we gather and evaluate the polynonials
@@ -284,27 +330,25 @@ void jit_eltwise_injector::tanh_compute_vector_fwd(const Zmm& zmm_src) {
 
   // we restore src with cleared sign, and keep sign
   h->vmovups(zmm_src, zmm_src_original);
-  h->vpandd(zmm_sign, zmm_sign, table_val(sign_mask));
-  h->vpandd(zmm_src, zmm_src, table_val(positive_mask));
+  vand(zmm_sign, zmm_sign, table_val(sign_mask));
+  vand(zmm_src, zmm_src, table_val(positive_mask));
 
   // Now we blend the results
   // [saturation_ubound; +inf[ : we return +/- 1
   h->vmovups(zmm_dst, table_val(one));
   // [linear_ubound; saturation_lbound] : we return +/- P(x)
   h->vmovups(zmm_mask, table_val(tanh_saturation_lbound));
-  h->vcmpps(k_mask, zmm_mask, zmm_src, _cmp_nle_us);
-  h->vblendmps(zmm_dst | k_mask, zmm_dst, zmm_pol);
+  blend(zmm_dst, zmm_pol);
   // [0; linear_ubound]  : we return x
   h->vmovups(zmm_mask, table_val(tanh_linear_ubound));
-  h->vcmpps(k_mask, zmm_mask, zmm_src, _cmp_nle_us);
-  h->vblendmps(zmm_dst | k_mask, zmm_dst, zmm_src);
+  blend(zmm_dst, zmm_src);
 
   // We reapply the sign and return
-  h->vpxord(zmm_dst, zmm_dst, zmm_sign);
+  avx512_ ? h->vpxord(zmm_dst, zmm_dst, zmm_sign) : h->vpxor(zmm_dst, zmm_dst, zmm_sign);
   h->vmovups(zmm_src, zmm_dst);
 }
 
-void jit_eltwise_injector::gelu_compute_vector_fwd(const Zmm& zmm_src) {
+void jit_eltwise_injector::gelu_compute_vector_fwd(const Xmm& zmm_src) {
   h->vmovups(zmm_aux0, zmm_src);
 
   // compute G(x) = sqrt_root_two_over_pi * x * (1 + fitting_const * x * x)
@@ -323,15 +367,21 @@ void jit_eltwise_injector::gelu_compute_vector_fwd(const Zmm& zmm_src) {
   h->vmulps(zmm_src, zmm_src, zmm_aux0);
 }
 
-void jit_eltwise_injector::exp_compute_vector_fwd(const Zmm& zmm_src) {
+void jit_eltwise_injector::exp_compute_vector_fwd(const Xmm& zmm_src) {
   /* exp code */
-  h->vcmpps(k_mask, zmm_src, table_val(exp_ln_flt_min_f), _cmp_lt_os);
+  if (avx512_)
+    h->vcmpps(k_mask, zmm_src, table_val(exp_ln_flt_min_f), _cmp_lt_os);
+  else
+    h->vcmpps(zmm_mask, zmm_src, table_val(exp_ln_flt_min_f), _cmp_lt_os);
   h->vminps(zmm_src, zmm_src, table_val(exp_ln_flt_max_f));
   h->vmaxps(zmm_src, zmm_src, table_val(exp_ln_flt_min_f));
   h->vmovups(zmm_aux1, zmm_src);
   h->vmulps(zmm_src, zmm_src, table_val(exp_log2ef));
   h->vaddps(zmm_src, zmm_src, table_val(half));
-  h->vrndscaleps(zmm_aux2, zmm_src, _op_floor & 0x3);
+  if (avx512_)
+    h->vrndscaleps(zmm_aux2, zmm_src, _op_floor & 0x3);
+  else
+    h->vroundps(zmm_aux2, zmm_src, _op_floor & 0x3);
 
   // keep zmm_src = fx for further computations
   h->vmovups(zmm_src, zmm_aux2);
@@ -354,7 +404,10 @@ void jit_eltwise_injector::exp_compute_vector_fwd(const Zmm& zmm_src) {
   h->vxorps(zmm_src, zmm_src, zmm_src);
 
   // set zeroes at those points which were < log(FLT_MIN)
-  h->vblendmps(zmm_aux2 | k_mask, zmm_aux2, zmm_src);
+  if (avx512_)
+    h->vblendmps(zmm_aux2 | k_mask, zmm_aux2, zmm_src);
+  else
+    h->vblendvps(zmm_aux2, zmm_aux2, zmm_src, zmm_mask);
 
   // compute polynomial
   h->vmovups(zmm_src, table_val(exp_pol, 4));
@@ -370,12 +423,18 @@ void jit_eltwise_injector::exp_compute_vector_fwd(const Zmm& zmm_src) {
   h->vmulps(zmm_src, zmm_src, table_val(two));
 }
 
-void jit_eltwise_injector::relu_compute_vector_fwd(const Zmm& zmm_src) {
+void jit_eltwise_injector::relu_compute_vector_fwd(const Xmm& zmm_src) {
   auto key = get_attr_idx_key(cur_postop_attr_);
   h->vmovups(zmm_aux1, zmm_src);
-  h->vcmpps(k_mask, zmm_src, table_val(zero), _cmp_nle_us);
+  if (avx512_)
+    h->vcmpps(k_mask, zmm_src, table_val(zero), _cmp_nle_us);
+  else
+    h->vcmpps(zmm_mask, zmm_src, table_val(zero), _cmp_nle_us);
   h->vmulps(zmm_src, zmm_src, table_val(alpha, alpha_idx_map[key]));  // alpha=0 by default.
-  h->vblendmps(zmm_src | k_mask, zmm_src, zmm_aux1);
+  if (avx512_)
+    h->vblendmps(zmm_src | k_mask, zmm_src, zmm_aux1);
+  else
+    h->vblendvps(zmm_src, zmm_src, zmm_aux1, zmm_mask);
 }
 
 void jit_eltwise_injector::escape_regs(reg_type type, int reg_idx) {
@@ -420,6 +479,7 @@ void jit_eltwise_injector::init_tb_allocate_set(const std::vector<postop_attr>&
 
     if (i.op_alg == postop_alg::exp) {
       mask_tb_allocate.insert(&k_mask);
+      if (!avx512_) zmm_tb_allocate.insert(&zmm_mask);
       zmm_tb_allocate.insert(&zmm_aux1);
       zmm_tb_allocate.insert(&zmm_aux2);
     }
@@ -446,6 +506,7 @@ void jit_eltwise_injector::init_tb_allocate_set(const std::vector<postop_attr>&
     if (i.op_alg == postop_alg::relu) {
       zmm_tb_allocate.insert(&zmm_aux1);
       mask_tb_allocate.insert(&k_mask);
+      if (!avx512_) zmm_tb_allocate.insert(&zmm_mask);
     }
 
     if (i.op_alg == postop_alg::linear) {
@@ -505,7 +566,7 @@ void jit_eltwise_injector::assign_regs() {
         }
         *reg = Xbyak::Opmask(allocate_idx);
       } else if (reg_type == reg_type::zmm) {
-        *reg = Zmm(allocate_idx);
+        *reg = avx512_ ? Xmm(Zmm(allocate_idx)) : Xmm(Ymm(allocate_idx));
       } else if (reg_type == reg_type::reg64) {
         // avoid allocate special usage registers such as rsp.front op dose not need to tell injector the usage
         // information of these regs.
@@ -523,7 +584,7 @@ void jit_eltwise_injector::assign_regs() {
   };
   allocate_regs(reg_type::reg64, max_reg64_idx, used_regs.find(reg_type::reg64), reg64_allocate_vec);
   allocate_regs(reg_type::mask, max_mask_idx, used_regs.find(reg_type::mask), mask_allocate_vec);
-  allocate_regs(reg_type::zmm, max_zmm_idx, used_regs.find(reg_type::zmm), zmm_allocate_vec);
+  allocate_regs(reg_type::zmm, avx512_ ? max_zmm_idx : max_ymm_idx, used_regs.find(reg_type::zmm), zmm_allocate_vec);
 }
 
 void jit_eltwise_injector::prepare_table() {
@@ -34,7 +34,8 @@ class jit_eltwise_injector {
   virtual ~jit_eltwise_injector() {}
 
   void eltwise_injector_init(jit_generator* ptr, const std::vector<postop_attr>& postop_attrs);
-  void vector_compute(const Xbyak::Zmm& zmm_src, const std::vector<postop_attr>& postop_attrs,
+  // zmm_src can be a Zmm, or a Ymm to compute with AVX2 instructions only (fp32 postops without bit8/16-lut)
+  void vector_compute(const Xbyak::Xmm& zmm_src, const std::vector<postop_attr>& postop_attrs,
                       std::vector<int> postop_idxs = {});
   void escape_regs(reg_type type, int reg_idx);
   template <typename reg_t>
@@ -62,17 +63,17 @@ class jit_eltwise_injector {
 
  private:
   void assign_regs();
-  void exp_compute_vector_fwd(const Xbyak::Zmm& zmm_src);
-  void low_precision_exp_compute_vector_fwd(const Xbyak::Zmm& zmm_src);
-  void swish_compute_vector_fwd(const Xbyak::Zmm& zmm_src);
-  void tanh_compute_vector_fwd(const Xbyak::Zmm& zmm_src);
-  void gelu_compute_vector_fwd(const Xbyak::Zmm& zmm_src);
-  void relu_compute_vector_fwd(const Xbyak::Zmm& zmm_src);
-  void quantize_compute_vector_fwd(const Xbyak::Zmm& zmm_src);
-  void dequantize_compute_vector_fwd(const Xbyak::Zmm& zmm_src);
-  void linear_compute_vector_fwd(const Xbyak::Zmm& zmm_src);
-  void bit8_lut_compute_vector_fwd(const Xbyak::Zmm& zmm_src);
-  void bit16_lut_compute_vector_fwd(const Xbyak::Zmm& zmm_src);
+  void exp_compute_vector_fwd(const Xbyak::Xmm& zmm_src);
+  void low_precision_exp_compute_vector_fwd(const Xbyak::Xmm& zmm_src);
+  void swish_compute_vector_fwd(const Xbyak::Xmm& zmm_src);
+  void tanh_compute_vector_fwd(const Xbyak::Xmm& zmm_src);
+  void gelu_compute_vector_fwd(const Xbyak::Xmm& zmm_src);
+  void relu_compute_vector_fwd(const Xbyak::Xmm& zmm_src);
+  void quantize_compute_vector_fwd(const Xbyak::Xmm& zmm_src);
+  void dequantize_compute_vector_fwd(const Xbyak::Xmm& zmm_src);
+  void linear_compute_vector_fwd(const Xbyak::Xmm& zmm_src);
+  void bit8_lut_compute_vector_fwd(const Xbyak::Xmm& zmm_src);
+  void bit16_lut_compute_vector_fwd(const Xbyak::Xmm& zmm_src);
   void register_table_entries(const std::vector<postop_attr>& postop_attrs);
   void assert_check(const std::vector<postop_attr>& postop_attrs);
   template <typename REG_TYPE>
@@ -102,13 +103,16 @@ class jit_eltwise_injector {
   Xbyak::Reg64 p_table;
   Xbyak::Reg64 reg64_tmp;
 
-  Zmm zmm_mask, zmm_aux0, zmm_aux1, zmm_aux2, zmm_aux3, zmm_aux4, zmm_tmp;
+  // Zmm, or Ymm when computing on Ymm sources
+  Xmm zmm_mask, zmm_aux0, zmm_aux1, zmm_aux2, zmm_aux3, zmm_aux4, zmm_tmp;
   Ymm ymm_tmp;
   Xmm xmm_tmp;
   Xbyak::Opmask k_mask;
+  bool avx512_ = true;
   static constexpr int n_mantissa_bits = 23;
   static constexpr int max_mask_idx = 7;
   static constexpr int max_zmm_idx = 31;
+  static constexpr int max_ymm_idx = 15;  // without EVEX encoding
   static constexpr int max_reg64_idx = 15;
 
   enum {
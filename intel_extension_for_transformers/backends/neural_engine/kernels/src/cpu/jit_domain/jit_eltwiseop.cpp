@@ -54,38 +54,48 @@ void jit_eltwiseop_t::generate() {
 void jit_eltwiseop_t::assign_regs() {
   remain_task_mask = Xbyak::Opmask(6);
   scratch_ = Xbyak::Reg64(r10);
-  reg_src = Zmm(6);
+  reg_src = param_.use_avx512 ? Xmm(Zmm(6)) : Xmm(Ymm(6));
+  xmm_pack = Xmm(7);
 
   eltwise_injector.escape_regs(reg_type::mask, remain_task_mask.getIdx());
   eltwise_injector.escape_regs(reg_type::reg64, scratch_.getIdx());
   eltwise_injector.escape_regs(reg_type::zmm, reg_src.getIdx());
+  eltwise_injector.escape_regs(reg_type::zmm, xmm_pack.getIdx());
   eltwise_injector.escape_regs(reg_type::zmm, addr_src.getIdx());
   eltwise_injector.escape_regs(reg_type::zmm, addr_dst.getIdx());
 }
 
 void jit_eltwiseop_t::prepare_mask() {
+  if (!param_.use_avx512) return;  // AVX2 tails are moved with scalar loads/stores
   mov(scratch_.cvt32(), 0x1);
   kmovd(remain_task_mask, scratch_.cvt32());
 }
 
-void jit_eltwiseop_t::store_dst(Xbyak::Zmm reg_src, Xbyak::Reg64 addr_dst) {
+void jit_eltwiseop_t::store_dst(Xbyak::Xmm reg_src, Xbyak::Reg64 addr_dst) {
   auto last_attr = param_.postop_attrs.back();
   auto first_attr = param_.postop_attrs.front();
   if (last_attr.op_alg == postop_alg::quantize &&
       !(first_attr.op_alg == postop_alg::eltop_int_lut && first_attr.alpha == 8)) {
-    if (last_attr.dt == data_type::s8)
+    if (!param_.use_avx512) {
+      vpack_s32_8bit_avx2(Ymm(reg_src.getIdx()), xmm_pack, last_attr.dt == data_type::s8);
+      vmovq(ptr[addr_dst], Xmm(reg_src.getIdx()));
+    } else if (last_attr.dt == data_type::s8) {
       vpmovsdb(ptr[addr_dst], reg_src);
-    else
+    } else {
       vpmovusdb(ptr[addr_dst], reg_src);
+    }
   } else {
     vmovups(ptr[addr_dst], reg_src);
   }
 }
 
-void jit_eltwiseop_t::load_src(Xbyak::Zmm reg_src, Xbyak::Reg64 addr_src) {
+void jit_eltwiseop_t::load_src(Xbyak::Xmm reg_src, Xbyak::Reg64 addr_src) {
   auto first_attr = param_.postop_attrs.front();
   if (first_attr.op_alg == postop_alg::dequantize) {
-    vmovups(Xmm(reg_src.getIdx()), ptr[addr_src]);
+    if (param_.use_avx512)
+      vmovups(Xmm(reg_src.getIdx()), ptr[addr_src]);
+    else
+      vmovq(Xmm(reg_src.getIdx()), ptr[addr_src]);
   } else if (first_attr.op_alg == postop_alg::eltop_int_lut && first_attr.alpha == 16) {
     vmovups(Ymm(reg_src.getIdx()), ptr[addr_src]);  // we will process 32 element in int16_lut ker.
   } else {
@@ -93,9 +103,14 @@ void jit_eltwiseop_t::load_src(Xbyak::Zmm reg_src, Xbyak::Reg64 addr_src) {
   }
 }
 
-void jit_eltwiseop_t::load_tail(Xbyak::Zmm reg_src, Xbyak::Reg64 addr_src) {
+void jit_eltwiseop_t::load_tail(Xbyak::Xmm reg_src, Xbyak::Reg64 addr_src) {
   if (param_.in_dt == data_type::u8 || param_.in_dt == data_type::s8) {
-    vmovdqu8(Xmm(reg_src.getIdx()), ptr[addr_src]);
+    if (param_.use_avx512) {
+      vmovdqu8(Xmm(reg_src.getIdx()), ptr[addr_src]);
+    } else {
+      movzx(scratch_.cvt32(), byte[addr_src]);
+      vmovd(Xmm(reg_src.getIdx()), scratch_.cvt32());
+    }
   } else if (param_.in_dt == data_type::fp32) {
     vmovss(Xmm(reg_src.getIdx()), ptr[addr_src]);
   } else if (param_.in_dt == data_type::bf16) {
@@ -103,19 +118,27 @@ void jit_eltwiseop_t::load_tail(Xbyak::Zmm reg_src, Xbyak::Reg64 addr_src) {
   }
 }
 
-void jit_eltwiseop_t::store_tail(Xbyak::Zmm reg_src, Xbyak::Reg64 addr_dst) {
+void jit_eltwiseop_t::store_tail(Xbyak::Xmm reg_src, Xbyak::Reg64 addr_dst) {
   auto last_attr = param_.postop_attrs.back();
   auto first_attr = param_.postop_attrs.front();
   if (param_.out_dt == data_type::u8 || param_.out_dt == data_type::s8) {
     if (last_attr.op_alg == postop_alg::quantize && !(first_attr.op_alg == postop_alg::eltop_int_lut)) {
-      if (last_attr.dt == data_type::s8)
+      if (!param_.use_avx512)
+        vpack_s32_8bit_avx2(Ymm(reg_src.getIdx()), xmm_pack, last_attr.dt == data_type::s8);
+      else if (last_attr.dt == data_type::s8)
         vpmovsdb(Xmm(reg_src.getIdx()), reg_src);
       else
         vpmovusdb(Xmm(reg_src.getIdx()), reg_src);
     }
-    vmovdqu8(ptr[addr_dst] | remain_task_mask, Xmm(reg_src.getIdx()));
+    if (param_.use_avx512)
+      vmovdqu8(ptr[addr_dst] | remain_task_mask, Xmm(reg_src.getIdx()));
+    else
+      vpextrb(ptr[addr_dst], Xmm(reg_src.getIdx()), 0);
   } else if (param_.out_dt == data_type::fp32) {
-    vmovss(ptr[addr_dst] | remain_task_mask, Xmm(reg_src.getIdx()));
+    if (param_.use_avx512)
+      vmovss(ptr[addr_dst] | remain_task_mask, Xmm(reg_src.getIdx()));
+    else
+      vmovss(ptr[addr_dst], Xmm(reg_src.getIdx()));
   } else if (param_.out_dt == data_type::bf16) {
     Ymm ymm_bf16 = Ymm(reg_src.getIdx());
     vmovdqu16(ptr[addr_dst] | remain_task_mask, ymm_bf16);
@@ -39,10 +39,10 @@ class jit_eltwiseop_t : public jit_generator {
  private:
   void generate() override;
   void assign_regs();
-  void store_dst(Xbyak::Zmm reg_src, Xbyak::Reg64 dst_addr);
-  void store_tail(Xbyak::Zmm reg_src, Xbyak::Reg64 dst_addr);
-  void load_src(Xbyak::Zmm reg_src, Xbyak::Reg64 src_addr);
-  void load_tail(Xbyak::Zmm reg_src, Xbyak::Reg64 src_addr);
+  void store_dst(Xbyak::Xmm reg_src, Xbyak::Reg64 dst_addr);
+  void store_tail(Xbyak::Xmm reg_src, Xbyak::Reg64 dst_addr);
+  void load_src(Xbyak::Xmm reg_src, Xbyak::Reg64 src_addr);
+  void load_tail(Xbyak::Xmm reg_src, Xbyak::Reg64 src_addr);
   void prepare_mask();
 
  private:
@@ -61,7 +61,8 @@ class jit_eltwiseop_t : public jit_generator {
 #else
   Xbyak::Reg64 reg_param = rdi;
 #endif
-  Zmm reg_src;
+  Xmm reg_src;  // Zmm, or Ymm without AVX512
+  Xmm xmm_pack;  // AVX2 only: high 128 bits of reg_src when packing s32 to 8 bits
   Xbyak::Reg64 addr_src = r15;
   Xbyak::Reg64 addr_dst = r14;
   Xbyak::Reg64 remain_element_num = rsi;
@@ -70,6 +71,9 @@ class jit_eltwiseop_t : public jit_generator {
   Xbyak::Opmask remain_task_mask;
   Xbyak::Reg64 scratch_;
 
+  // offsets and element counts of one Zmm; a Ymm holds half of them
+  size_t vec_scale(size_t zmm_val) { return param_.use_avx512 ? zmm_val : zmm_val / 2; }
+
   size_t load_offset() {
     if (param_.postop_attrs[0].op_alg == postop_alg::eltop_int_lut && param_.postop_attrs[0].alpha == 8) {
       return 64u;  // special case:bit8_lut
@@ -78,16 +82,16 @@ class jit_eltwiseop_t : public jit_generator {
       return 32u;  // special case:bit16_lut
     }
     if (param_.postop_attrs[0].op_alg == postop_alg::quantize) {
-      return 64u;  // special case:direct quantize
+      return vec_scale(64u);  // special case:direct quantize
     }
     auto head_dt = param_.postop_attrs.front().dt;
     switch (head_dt) {
       case data_type::fp32:
       case data_type::bf16:
-        return 64u;
+        return vec_scale(64u);
       case data_type::u8:  // dequantize case
       case data_type::s8:
-        return 16u;
+        return vec_scale(16u);
       default:
         SPARSE_LOG(ERROR) << "wrong head data type, expect fp32/bf16/u8" << std::endl;
         return 0u;
@@ -97,12 +101,12 @@ class jit_eltwiseop_t : public jit_generator {
   size_t store_offset() {
     // todo:except dequantize case, our zmm always full of result data and needs to be stored.
     if (param_.postop_attrs.front().op_alg == postop_alg::eltop_int_lut) return 64u;  // lut case;
-    if (param_.postop_attrs.back().op_alg == postop_alg::quantize) return 16u;        // quantize case.
-    if (param_.postop_attrs.back().op_alg == postop_alg::dequantize) return 64u;      // dequantize case.
+    if (param_.postop_attrs.back().op_alg == postop_alg::quantize) return vec_scale(16u);    // quantize case.
+    if (param_.postop_attrs.back().op_alg == postop_alg::dequantize) return vec_scale(64u);  // dequantize case.
     switch (param_.out_dt) {
       case data_type::fp32:
       case data_type::bf16:
-        return 64u;
+        return vec_scale(64u);
       default:
         SPARSE_LOG(ERROR) << "wrong output data type, expect fp32/bf16" << std::endl;
         return 0u;
@@ -115,12 +119,12 @@ class jit_eltwiseop_t : public jit_generator {
     if (front_attr.op_alg == postop_alg::eltop_int_lut && front_attr.alpha == 16) return 32;  // sepcial case:bit16_lut
     switch (param_.in_dt) {
       case data_type::fp32:
-        return 16;
+        return vec_scale(16);
       case data_type::bf16:
         return 32;
       case data_type::u8:  // dequantize case
       case data_type::s8:
-        return 16;
+        return vec_scale(16);
       default:
         SPARSE_LOG(ERROR) << "wrong input data type, expect fp32/bf16/u8" << std::endl;
         return 0u;
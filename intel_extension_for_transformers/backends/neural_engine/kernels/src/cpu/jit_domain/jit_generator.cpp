@@ -190,4 +190,14 @@ void jit_generator::vmov_avx2(const RegExp& dst, const RegExp& src, const int by
   }
 }
 
+void jit_generator::vpack_s32_8bit_avx2(const Ymm& src, const Xmm& tmp_xmm, bool is_signed) {
+  const Xmm xmm_src(src.getIdx());
+  vextracti128(tmp_xmm, src, 1);
+  vpackssdw(xmm_src, xmm_src, tmp_xmm);
+  if (is_signed)
+    vpacksswb(xmm_src, xmm_src, xmm_src);
+  else
+    vpackuswb(xmm_src, xmm_src, xmm_src);
+}
+
 }  // namespace jd
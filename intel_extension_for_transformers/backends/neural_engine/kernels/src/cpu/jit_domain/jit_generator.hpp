@@ -197,7 +197,10 @@ class jit_generator : public Xbyak::CodeGenerator {
       vshuff32x4(tmp, src, src, 0x4E);  // 256-bit shuffle
       inst(src, src, tmp);
     }
-    vshuff32x4(tmp, src, src, 0xB1);  // 128/256-bit shuffle
+    if (src.isYMM() && src.getIdx() < 16 && tmp.getIdx() < 16)
+      vperm2f128(tmp, src, src, 0x01);  // 128-bit shuffle, VEX encoded so that it also runs on AVX2
+    else
+      vshuff32x4(tmp, src, src, 0xB1);  // 128/256-bit shuffle
     inst(src, src, tmp);
     vshufps(tmp, src, src, 0x4E);  // 64/128-bit shuffle
     inst(src, src, tmp);
@@ -318,6 +321,16 @@ class jit_generator : public Xbyak::CodeGenerator {
    */
   void vmov_avx2(const RegExp& dst, const RegExp& src, const int bytes, const Xmm& tmp_xmm, const Reg64& tmp_r64);
 
+  /**
+   * @brief Saturate the 8 S32 of a YMM to 8-bit integers in the low 8 bytes of its XMM, which vpmov(u)sdb does with
+   * AVX512
+   *
+   * @param src the YMM to pack, its low 8 bytes hold the result
+   * @param tmp_xmm a volatile XMM register for intermediate use
+   * @param is_signed saturate to s8, or else to u8
+   */
+  void vpack_s32_8bit_avx2(const Ymm& src, const Xmm& tmp_xmm, bool is_signed);
+
   const uint8_t* jit_ker_ = nullptr;
   static constexpr uint64_t MAX_CODE_SIZE = 128 * 1024;
   static constexpr uint64_t BYTES_ZMM = 64;
@@ -15,280 +15,258 @@
 #include "jit_groupnorm.hpp"
 namespace jd {
 
-#define GET_OFF(field) offsetof(groupnorm_data_t, field)
+#define GET_OFF(field) offsetof(groupnorm_stats_data_t, field)
+#define GET_NORM_OFF(field) offsetof(groupnorm_norm_data_t, field)
 
-#define DEF_AND_LOAD_ALL_PARAM                                 \
-  const auto reg_param = rp.p[0];                              \
-  const auto reg_src = rp.reg<Reg64>();                        \
-  const auto reg_dst = rp.reg<Reg64>();                        \
-  const auto reg_sum_x = rp.reg<Reg64>();                      \
-  const auto reg_sum_powx = rp.reg<Reg64>();                   \
-  const auto reg_gamma = rp.reg<Reg64>();                      \
-  const auto reg_beta = rp.reg<Reg64>();                       \
-  auto load_params = [&] {                                     \
-    mov(reg_src, ptr[reg_param + GET_OFF(src)]);               \
-    mov(reg_dst, ptr[reg_param + GET_OFF(dst)]);               \
-    mov(reg_sum_x, ptr[reg_param + GET_OFF(sum_x_ptr)]);       \
-    mov(reg_sum_powx, ptr[reg_param + GET_OFF(sum_powx_ptr)]); \
-    mov(reg_gamma, ptr[reg_param + GET_OFF(gamma)]);           \
-    mov(reg_beta, ptr[reg_param + GET_OFF(beta)]);             \
-  };
-
-#define DEF_BF16_ONE_CONST(label)            \
-  L(label);                                  \
-  bfloat16_t bf16_one[] = {bfloat16_t(1.f)}; \
-  db(reinterpret_cast<uint8_t*>(bf16_one), sizeof(bf16_one));
-
-#define DEF_DIV_COSNT(label, norm_dim)   \
-  L(label);                              \
-  float div_const[] = {1.0f / norm_dim}; \
-  db(reinterpret_cast<uint8_t*>(div_const), sizeof(div_const));
-
-#define DEF_EPS_CONST(label, eps) \
-  L(label);                       \
-  float eps_const[] = {eps};      \
-  db(reinterpret_cast<uint8_t*>(eps_const), sizeof(eps_const));
-
-void jit_groupnorm_t::sum_code_gen(regs_pool* rp, Reg64 reg_src, Reg64 reg_sum_x, Reg64 reg_sum_powx,
-                                   Opmask sum_write_mask, const Xbyak::Label& data_label, size_t sum_dim) {
-  const auto reg_loop = rp->reg<Reg64>();
-  auto zmm_sum_x = rp->regs<Zmm, 8>();
-  auto zmm_sum_powx = rp->regs<Zmm, 8>();
-  auto zmm_x = rp->regs<Zmm, 8>();
-  auto zmm_bf16_one = rp->reg<Zmm>();
-  auto zmm_tmp = rp->reg<Zmm>();
-
-  auto sum_func = [&](std::function<void(int, int, Opmask, bool)> sum) {
-    // determine unroll
-    unroll = 8;
-    for (int i = 0; i < unroll; i++) {
-      vxorps(zmm_sum_powx[i], zmm_sum_powx[i], zmm_sum_powx[i]);
-      vxorps(zmm_sum_x[i], zmm_sum_x[i], zmm_sum_x[i]);
-    }
-    int process_simd_byte = jit_generator::BYTES_ZMM;
-    if (!isa_available(avx512_core_bf16) && param_.dt == data_type::bf16) process_simd_byte = jit_generator::BYTES_YMM;
-    auto elt_num_per_zmm = process_simd_byte / get_data_size(param_.dt);
-    auto tail_dim = sum_dim % (elt_num_per_zmm);
-    auto sum_tail_mask = rp->reg<Opmask>();
-    auto align_dim = sum_dim - tail_dim;
-    while (align_dim % (unroll * elt_num_per_zmm) != 0) unroll /= 2;
-    auto loop_num = align_dim / (unroll * elt_num_per_zmm);
-    xor_(reg_loop, reg_loop);
-    vpbroadcastw(zmm_bf16_one, ptr[rip + data_label]);
-    L(".sum_loop");
-    for (int i = 0; i < unroll; i++) sum(i, process_simd_byte, Opmask(0), false);
-    add(reg_src, unroll * process_simd_byte);
-    inc(reg_loop);
-    cmp(reg_loop, loop_num);
-    jl(".sum_loop");
-    if (tail_dim != 0) {
-      // prepare mask
-      if (param_.dt == data_type::bf16 && tail_dim >= 16) {
-        sum(0, jit_generator::BYTES_YMM, Opmask(0), true);
-        add(reg_src, jit_generator::BYTES_YMM);
-        tail_dim -= 16;
-      }
-      if (tail_dim != 0) {
-        Reg64 reg_tmp(reg_tmp_idx);
-        uint64_t mask_value = 0xffff;
-        mov(reg_tmp.cvt32(), mask_value >> (16 - tail_dim));
-        kmovd(sum_tail_mask, reg_tmp.cvt32());
-        sum(0, jit_generator::BYTES_YMM, sum_tail_mask, true);
-      }
-    }
-    // log2n reduce
-    jit_generator::reduce_vmms(zmm_sum_x, &CodeGenerator::vaddps);
-    jit_generator::reduce_vmms(zmm_sum_powx, &CodeGenerator::vaddps);
-    reduce_dwords(zmm_sum_x[0], zmm_tmp, &CodeGenerator::vaddps);
-    reduce_dwords(zmm_sum_powx[0], zmm_tmp, &CodeGenerator::vaddps);
-    vmovups(ptr[reg_sum_x] | sum_write_mask, zmm_sum_x[0]);
-    vmovups(ptr[reg_sum_powx] | sum_write_mask, zmm_sum_powx[0]);
-  };
+#define DEF_FP32_CONST(label, value)                               \
+  L(label);                                                        \
+  {                                                                \
+    float fp32_const[] = {value};                                  \
+    db(reinterpret_cast<uint8_t*>(fp32_const), sizeof(fp32_const)); \
+  }
 
-  std::function<void(int, int, Opmask, bool)> bf16_sum = [&](int i, int process_simd_byte, Opmask mask, bool tail) {
-    if (isa_available(avx512_core_bf16) && !tail) {
-      vmovups(zmm_x[i] | mask, ptr[reg_src + (i * process_simd_byte)]);
-      vdpbf16ps(zmm_sum_x[i] | mask, zmm_x[i], zmm_bf16_one);
-      vdpbf16ps(zmm_sum_powx[i] | mask, zmm_x[i], zmm_x[i]);
+void jit_groupnorm_t::load_fp32(const Zmm& dst, const Xbyak::Address& addr, const Opmask& mask) {
+  if (param_.dt == data_type::bf16) {
+    if (mask.getIdx() != 0) {
+      vmovdqu16(Ymm(dst.getIdx()) | mask | T_z, addr);
+      bf16_cvt_fp32(dst);
     } else {
-      vmovups(Ymm(zmm_x[i].getIdx()), ptr[reg_src + (i * process_simd_byte)]);
-      bf16_cvt_fp32(zmm_x[i]);
-      vaddps(zmm_sum_x[i] | mask, zmm_sum_x[i], zmm_x[i]);
-      vmulps(zmm_x[i] | mask, zmm_x[i], zmm_x[i]);
-      vaddps(zmm_sum_powx[i] | mask, zmm_sum_powx[i], zmm_x[i]);
+      vpmovzxwd(dst, addr);
+      vpslld(dst, dst, 0x10);
     }
-  };
-
-  std::function<void(int, int, Opmask, bool)> fp32_sum = [&](int i, int process_simd_byte, Opmask mask, bool) {
-    vmovups(zmm_x[i], ptr[reg_src + (i * process_simd_byte)]);
-    vaddps(zmm_sum_x[i] | mask, zmm_sum_x[i], zmm_x[i]);
-    vmulps(zmm_x[i] | mask, zmm_x[i], zmm_x[i]);
-    vaddps(zmm_sum_powx[i] | mask, zmm_sum_powx[i], zmm_x[i]);
-  };
-
-  switch (param_.dt) {
-    case data_type::bf16:
-      sum_func(bf16_sum);
-      break;
-    case data_type::fp32:
-      sum_func(fp32_sum);
-      break;
-    default:
-      SPARSE_LOG(FATAL) << "unsupported src data type.";
-      break;
+  } else {
+    vmovups(dst | mask | T_z, addr);
   }
 }
 
-void jit_groupnorm_t::calc_scale_and_norm(regs_pool* rp, Reg64 reg_src, Reg64 reg_dst, Reg64 reg_sum_x,
-                                          Reg64 reg_sum_powx, Reg64 reg_gamma, Reg64 reg_beta,
-                                          const Xbyak::Label& div_const_label, const Xbyak::Label& eps_label,
-                                          size_t channels_per_group) {
-  const auto reg_norm_loop = rp->reg<Reg64>();
-  const auto reg_channel_loop = rp->reg<Reg64>();
-  auto zmm_x_mean = rp->reg<Zmm>();
-  auto zmm_tmp = rp->reg<Zmm>();
-  auto zmm_alpha = rp->reg<Zmm>();
-  auto zmm_powx_mean = rp->reg<Zmm>();
-  auto zmm_powmean = rp->reg<Zmm>();
-  // calculate norm param
-  vbroadcastss(zmm_x_mean, dword[reg_sum_x]);
-  vbroadcastss(zmm_powx_mean, dword[reg_sum_powx]);
-  vmulps(zmm_x_mean, zmm_x_mean, zword_b[rip + div_const_label]);
-  vmulps(zmm_powmean, zmm_x_mean, zmm_x_mean);
-  vmulps(zmm_powx_mean, zmm_powx_mean, zword_b[rip + div_const_label]);
-  vsubps(zmm_tmp, zmm_powx_mean, zmm_powmean);
-  vaddps(zmm_tmp, zmm_tmp, zword_b[rip + eps_label]);
-  vrsqrt14ps(zmm_tmp, zmm_tmp);
+void jit_groupnorm_stats_t::generate() { param_.use_avx512 ? generate_<true>() : generate_<false>(); }
 
-  int unroll = 16;
-  auto tail_elt_num = param_.HW % 16;
-  auto align_elt_num = param_.HW - tail_elt_num;
-  while (align_elt_num % (unroll * 16) != 0) unroll -= 1;
-  auto zmms = rp->regs<Zmm, 16>();
-  auto loop_num = align_elt_num / (unroll * 16);
-
-  auto norm_mask = rp->reg<Opmask>();
-  if (tail_elt_num != 0) {
-    Reg64 reg_tmp(reg_tmp_idx);
-    mov(reg_tmp.cvt32(), 0xffff >> (16 - tail_elt_num));
-    kmovd(norm_mask, reg_tmp.cvt32());
-  }
+template <bool USE_AVX512>
+void jit_groupnorm_stats_t::generate_() {
+  using VMM = std::conditional_t<USE_AVX512, Zmm, Ymm>;
+  constexpr int VLEN = USE_AVX512 ? 16 : 8;
+  // with AVX2 the 16 registers hold half the lanes, they see the STEP_ELTS elements of a step in SUB_STEPS updates
+  constexpr int LANES = USE_AVX512 ? UNROLL : UNROLL / 2;
+  constexpr int SUB_STEPS = STEP_ELTS / (LANES * VLEN);
+  const auto rp_flags = USE_AVX512 ? regs_pool::DefaultFlags : regs_pool::DisableEvex;
+  Xbyak::Label one_label, rlanes_label;
+  const int dt_bytes = get_data_size(param_.dt);
+  inLocalLabel();
+  {
+    regs_pool rp(this, 1, {4, 3 * LANES + 3, 0}, 0, rp_flags);
+    const auto reg_param = rp.p[0];
+    const auto reg_src = rp.reg<Reg64>();
+    const auto reg_mean = rp.reg<Reg64>();
+    const auto reg_m2 = rp.reg<Reg64>();
+    const auto reg_steps = rp.reg<Reg64>();
+    const auto vmm_mean = rp.regs<VMM, LANES>();
+    const auto vmm_m2 = rp.regs<VMM, LANES>();
+    // the updates of the unrolled lanes are independent, half of them in flight is enough
+    const auto vmm_x = rp.regs<VMM, LANES / 2>();
+    const auto vmm_delta = rp.regs<VMM, LANES / 2>();
+    const auto vmm_n = rp.reg<VMM>();
+    const auto vmm_rn = rp.reg<VMM>();
+    const auto vmm_one = rp.reg<VMM>();
 
-  xor_(reg_channel_loop, reg_channel_loop);
-  L(".channel_loop");
-  xor_(reg_norm_loop, reg_norm_loop);
-  L(".align_norm_loop");
-  vmulps(zmm_alpha, zmm_tmp, zword_b[reg_gamma + 4 * reg_channel_loop]);
-  auto norm = [&](int unroll, Opmask mask = Opmask(0)) {
-    for (int i = 0; i < unroll; i++) {
-      if (param_.dt == data_type::bf16) {
-        vmovups(Ymm(zmms[i].getIdx()), ptr[reg_src + i * 32]);
-        bf16_cvt_fp32(zmms[i]);
-      } else {
-        vmovups(zmms[i], ptr[reg_src + i * 64]);
-      }
-      vsubps(zmms[i], zmms[i], zmm_x_mean);
-      vfmadd213ps(zmms[i], zmm_alpha, zword_b[reg_beta + 4 * reg_channel_loop]);
-      if (param_.postop_attrs.size() != 0) {
-        eltwise_injector_.escape_rp_all_type(rp);
-        eltwise_injector_.vector_compute(zmms[i], param_.postop_attrs);
-      }
-      if (param_.dt == data_type::bf16) {
-        fp32_cvt_bf16(zmms[i]);
-        vmovdqu16(ptr[reg_dst + i * 32] | mask, Ymm(zmms[i].getIdx()));
-      } else {
-        vmovups(ptr[reg_dst + i * 64] | mask, zmms[i]);
+    mov(reg_src, ptr[reg_param + GET_OFF(src)]);
+    mov(reg_mean, ptr[reg_param + GET_OFF(mean)]);
+    mov(reg_m2, ptr[reg_param + GET_OFF(m2)]);
+    mov(reg_steps, ptr[reg_param + GET_OFF(steps)]);
+    vbroadcastss(vmm_one, dword[rip + one_label]);
+    vxorps(vmm_n, vmm_n, vmm_n);
+    for (int i = 0; i < LANES; i++) {
+      vxorps(vmm_mean[i], vmm_mean[i], vmm_mean[i]);
+      vxorps(vmm_m2[i], vmm_m2[i], vmm_m2[i]);
+    }
+    test(reg_steps, reg_steps);
+    jz(".merge", T_NEAR);
+    L(".welford_loop");
+    for (int j = 0; j < SUB_STEPS; j++) {
+      // all the lanes have seen the same count, one division serves the whole update
+      vaddps(vmm_n, vmm_n, vmm_one);
+      vdivps(vmm_rn, vmm_one, vmm_n);
+      for (int i = 0; i < LANES; i++) {
+        const auto& x = vmm_x[i % (LANES / 2)];
+        const auto& delta = vmm_delta[i % (LANES / 2)];
+        load_fp32(x, ptr[reg_src + (j * LANES + i) * VLEN * dt_bytes]);
+        vsubps(delta, x, vmm_mean[i]);            // x - mean_{n-1}
+        vfmadd231ps(vmm_mean[i], delta, vmm_rn);  // mean_n = mean_{n-1} + delta / n
+        vsubps(x, x, vmm_mean[i]);                // x - mean_n
+        vfmadd231ps(vmm_m2[i], delta, x);         // m2_n = m2_{n-1} + (x - mean_{n-1}) * (x - mean_n)
       }
     }
-  };
-  norm(unroll);
-  add(reg_src, unroll * 16 * get_data_size(param_.dt));
-  add(reg_dst, unroll * 16 * get_data_size(param_.dt));
-  inc(reg_norm_loop);
-  cmp(reg_norm_loop, loop_num);
-  jl(".align_norm_loop");
-  if (tail_elt_num != 0) {
-    norm(1, norm_mask);
-    add(reg_src, tail_elt_num * get_data_size(param_.dt));
-    add(reg_dst, tail_elt_num * get_data_size(param_.dt));
+    add(reg_src, STEP_ELTS * dt_bytes);
+    dec(reg_steps);
+    jnz(".welford_loop", T_NEAR);
+    L(".merge");
+    // every lane has seen n elements: the mean is the mean of the lanes, and the spread of the lane means adds
+    // n * (mean_i - mean)^2 to the sum of their m2
+    const auto& vmm_mu = vmm_x[0];
+    const auto& vmm_tmp = vmm_delta[0];
+    vmovaps(vmm_mu, vmm_mean[0]);
+    for (int i = 1; i < LANES; i++) vaddps(vmm_mu, vmm_mu, vmm_mean[i]);
+    reduce_dwords(vmm_mu, vmm_tmp, &CodeGenerator::vaddps);
+    vbroadcastss(vmm_tmp, dword[rip + rlanes_label]);
+    vmulps(vmm_mu, vmm_mu, vmm_tmp);
+    for (int i = 0; i < LANES; i++) {
+      const auto& delta = vmm_delta[i % (LANES / 2)];
+      vsubps(delta, vmm_mean[i], vmm_mu);
+      vmulps(delta, delta, delta);
+      vfmadd231ps(vmm_m2[i], delta, vmm_n);
+    }
+    reduce_vmms(vmm_m2, &CodeGenerator::vaddps);
+    reduce_dwords(vmm_m2[0], vmm_tmp, &CodeGenerator::vaddps);
+    vmovss(dword[reg_mean], Xmm(vmm_mu.getIdx()));
+    vmovss(dword[reg_m2], Xmm(vmm_m2[0].getIdx()));
   }
-  inc(reg_channel_loop);
-  cmp(reg_channel_loop, channels_per_group);
-  jl(".channel_loop");
+  outLocalLabel();
+  DEF_FP32_CONST(one_label, 1.f)
+  DEF_FP32_CONST(rlanes_label, 1.f / (LANES * VLEN))
 }
 
-void jit_groupnorm_t::prepare_mask(Reg64 reg_tmp, Opmask sum_write_mask) {
-  mov(reg_tmp.cvt32(), 0xffff >> 15);
-  kmovd(sum_write_mask, reg_tmp.cvt32());
-}
+void jit_groupnorm_norm_t::generate() { param_.use_avx512 ? generate_<true>() : generate_<false>(); }
 
-void jit_channelwise_sum_t::generate() {
-  Xbyak::Label data_label;
+template <bool USE_AVX512>
+void jit_groupnorm_norm_t::generate_() {
+  using VMM = std::conditional_t<USE_AVX512, Zmm, Ymm>;
+  constexpr int VLEN = USE_AVX512 ? 16 : 8;
+  // mean, rstd, alpha and beta, and the vector tail mask of AVX2
+  constexpr int N_CONST_VMM = USE_AVX512 ? 4 : 5;
+  const auto rp_flags = USE_AVX512 ? regs_pool::DefaultFlags : regs_pool::DisableEvex;
+  // the postops share the 16 registers of AVX2 with the rows
+  int unroll = 8;
+  while (!USE_AVX512 && unroll > 1 && unroll + N_CONST_VMM + injector_vmm_num_ > 16) unroll /= 2;
+  int step_shift = 0;  // log2(unroll * VLEN)
+  while ((1 << step_shift) < unroll * VLEN) step_shift++;
+  const int dt_bytes = get_data_size(param_.dt);
+  Xbyak::Label tail_label;
   inLocalLabel();
   {
-    regs_pool rp(this, 1, {5, 26, 2});
+    regs_pool rp(this, 1, {9, unroll + N_CONST_VMM, 1}, 0, rp_flags);
     const auto reg_param = rp.p[0];
     const auto reg_src = rp.reg<Reg64>();
-    const auto reg_sum_x = rp.reg<Reg64>();
-    const auto reg_sum_powx = rp.reg<Reg64>();
+    const auto reg_dst = rp.reg<Reg64>();
+    const auto reg_gamma = rp.reg<Reg64>();
+    const auto reg_beta = rp.reg<Reg64>();
+    const auto reg_len = rp.reg<Reg64>();
+    const auto reg_channels = rp.reg<Reg64>();
+    const auto reg_skip = rp.reg<Reg64>();
+    const auto reg_loop = rp.reg<Reg64>();
     const auto reg_tmp = rp.reg<Reg64>();
-    reg_tmp_idx = reg_tmp.getIdx();
-    auto sum_write_mask = rp.reg<Opmask>();
+    const auto vmms = rp.regs<VMM>(unroll);
+    const auto vmm_consts = rp.regs<VMM>(N_CONST_VMM);
+    const auto& vmm_mean = vmm_consts[0];
+    const auto& vmm_rstd = vmm_consts[1];
+    const auto& vmm_alpha = vmm_consts[2];
+    const auto& vmm_beta = vmm_consts[3];
+    const auto vmm_tail_mask = USE_AVX512 ? VMM() : vmm_consts[N_CONST_VMM - 1];
+    const auto tail_mask = rp.reg<Opmask>();
+    eltwise_injector_.escape_rp_all_type(&rp);
 
-    auto load_params = [&] {
-      mov(reg_src, ptr[reg_param + GET_OFF(src)]);
-      mov(reg_sum_x, ptr[reg_param + GET_OFF(sum_x_ptr)]);
-      mov(reg_sum_powx, ptr[reg_param + GET_OFF(sum_powx_ptr)]);
+    auto norm = [&](int n, bool tail = false) {
+      const Opmask mask = tail ? Opmask(tail_mask) : Opmask(0);
+      for (int i = 0; i < n; i++) {
+        const auto addr = ptr[reg_src + i * VLEN * dt_bytes];
+        if (USE_AVX512)
+          load_fp32(Zmm(vmms[i].getIdx()), addr, mask);
+        else if (tail)
+          vmaskmovps(vmms[i], vmm_tail_mask, addr);
+        else
+          load_fp32(vmms[i], addr);
+      }
+      for (int i = 0; i < n; i++) {
+        const auto addr = ptr[reg_dst + i * VLEN * dt_bytes];
+        vfmadd213ps(vmms[i], vmm_alpha, vmm_beta);
+        if (!param_.postop_attrs.empty()) eltwise_injector_.vector_compute(vmms[i], param_.postop_attrs);
+        if (param_.dt == data_type::bf16) {
+          fp32_cvt_bf16(Zmm(vmms[i].getIdx()));
+          vmovdqu16(addr | mask, Ymm(vmms[i].getIdx()));
+        } else if (USE_AVX512) {
+          vmovups(addr | mask, vmms[i]);
+        } else if (tail) {
+          vmaskmovps(addr, vmm_tail_mask, vmms[i]);
+        } else {
+          vmovups(addr, vmms[i]);
+        }
+      }
+      add(reg_src, n * VLEN * dt_bytes);
+      add(reg_dst, n * VLEN * dt_bytes);
     };
 
-    prepare_mask(reg_tmp, sum_write_mask);
-    load_params();
-    sum_code_gen(&rp, reg_src, reg_sum_x, reg_sum_powx, sum_write_mask, data_label, param_.HW);
-  }
-  outLocalLabel();
-  DEF_BF16_ONE_CONST(data_label)
-}
+    mov(reg_src, ptr[reg_param + GET_NORM_OFF(src)]);
+    mov(reg_dst, ptr[reg_param + GET_NORM_OFF(dst)]);
+    mov(reg_gamma, ptr[reg_param + GET_NORM_OFF(gamma)]);
+    mov(reg_beta, ptr[reg_param + GET_NORM_OFF(beta)]);
+    mov(reg_len, ptr[reg_param + GET_NORM_OFF(len)]);
+    mov(reg_channels, ptr[reg_param + GET_NORM_OFF(channels)]);
+    vbroadcastss(vmm_mean, dword[reg_param + GET_NORM_OFF(mean)]);
+    vbroadcastss(vmm_rstd, dword[reg_param + GET_NORM_OFF(rstd)]);
+    // bytes from the end of the processed elements of a channel to the start of the next one
+    mov(reg_skip, param_.HW);
+    sub(reg_skip, reg_len);
+    imul(reg_skip, reg_skip, dt_bytes);
+    mov(reg_tmp, reg_len);
+    and_(reg_tmp, VLEN - 1);
+    if (USE_AVX512) {
+      mov(reg_loop.cvt32(), 0xffff);
+      bzhi(reg_loop.cvt32(), reg_loop.cvt32(), reg_tmp.cvt32());
+      kmovd(tail_mask, reg_loop.cvt32());
+    } else {
+      // the table holds 8 set lanes then 8 clear ones, the mask of t lanes starts 8 - t lanes in
+      neg(reg_tmp);
+      lea(reg_loop, ptr[rip + tail_label]);
+      vmovups(vmm_tail_mask, ptr[reg_loop + reg_tmp * 4 + VLEN * 4]);
+    }
 
-void jit_channelwise_norm_t::generate() {
-  Xbyak::Label div_const_label, eps_label;
-  inLocalLabel();
-  {
-    regs_pool rp(this, 1, {9, 21, 1});
-    const auto reg_tmp = rp.reg<Reg64>();
-    reg_tmp_idx = reg_tmp.getIdx();
-    DEF_AND_LOAD_ALL_PARAM
-    load_params();
-    calc_scale_and_norm(&rp, reg_src, reg_dst, reg_sum_x, reg_sum_powx, reg_gamma, reg_beta, div_const_label,
-                        eps_label);
-  }
-  outLocalLabel();
-  auto norm_elt = param_.HW * (param_.channels / param_.groups);
-  DEF_DIV_COSNT(div_const_label, norm_elt)
-  DEF_EPS_CONST(eps_label, param_.eps)
-  eltwise_injector_.prepare_table();
-}
+    L(".channel_loop");
+    // alpha = rstd * gamma, beta' = beta - mean * alpha
+    vbroadcastss(vmm_alpha, dword[reg_gamma]);
+    vmulps(vmm_alpha, vmm_alpha, vmm_rstd);
+    vbroadcastss(vmm_beta, dword[reg_beta]);
+    vfnmadd231ps(vmm_beta, vmm_alpha, vmm_mean);
 
-void jit_groupnorm_t::generate() {
-  Xbyak::Label bf16_one_label, div_const_label, eps_label;
-  auto norm_elt = param_.HW * (param_.channels / param_.groups);
-  inLocalLabel();
-  {
-    regs_pool rp(this, 1, {9, 26, 2});
-    const auto reg_tmp = rp.reg<Reg64>();
-    reg_tmp_idx = reg_tmp.getIdx();
-    auto sum_write_mask = rp.reg<Opmask>();
-    DEF_AND_LOAD_ALL_PARAM
-    load_params();
-    prepare_mask(reg_tmp, sum_write_mask);
-    sum_code_gen(&rp, reg_src, reg_sum_x, reg_sum_powx, sum_write_mask, bf16_one_label, norm_elt);
-    mov(reg_src, ptr[reg_param + GET_OFF(src)]);
-    calc_scale_and_norm(&rp, reg_src, reg_dst, reg_sum_x, reg_sum_powx, reg_gamma, reg_beta, div_const_label, eps_label,
-                        param_.channels / param_.groups);
+    mov(reg_loop, reg_len);
+    shr(reg_loop, step_shift);  // / (unroll * VLEN)
+    jz(".vec", T_NEAR);
+    L(".unroll_loop");
+    norm(unroll);
+    dec(reg_loop);
+    jnz(".unroll_loop", T_NEAR);
+
+    L(".vec");
+    mov(reg_loop, reg_len);
+    and_(reg_loop, unroll * VLEN - 1);
+    shr(reg_loop, USE_AVX512 ? 4 : 3);  // / VLEN
+    jz(".tail", T_NEAR);
+    L(".vec_loop");
+    norm(1);
+    dec(reg_loop);
+    jnz(".vec_loop", T_NEAR);
+
+    L(".tail");
+    test(reg_len, VLEN - 1);
+    jz(".next_channel", T_NEAR);
+    norm(1, true);
+    mov(reg_tmp, reg_len);
+    and_(reg_tmp, VLEN - 1);
+    sub(reg_tmp, VLEN);  // norm(1) advanced a whole vector
+    imul(reg_tmp, reg_tmp, dt_bytes);
+    add(reg_src, reg_tmp);
+    add(reg_dst, reg_tmp);
+
+    L(".next_channel");
+    add(reg_src, reg_skip);
+    add(reg_dst, reg_skip);
+    add(reg_gamma, sizeof(float));
+    add(reg_beta, sizeof(float));
+    dec(reg_channels);
+    jnz(".channel_loop", T_NEAR);
   }
   outLocalLabel();
-  DEF_BF16_ONE_CONST(bf16_one_label)
-  DEF_DIV_COSNT(div_const_label, norm_elt)
-  DEF_EPS_CONST(eps_label, param_.eps)
+  if (!USE_AVX512) {
+    L(tail_label);
+    for (int i = 0; i < 2 * VLEN; i++) dd(i < VLEN ? 0xffffffff : 0);
+  }
   eltwise_injector_.prepare_table();
 }
 
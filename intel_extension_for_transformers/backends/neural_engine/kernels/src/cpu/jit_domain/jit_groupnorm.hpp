@@ -33,65 +33,85 @@ struct groupnorm_param_t {
   int groups;
   float eps;
   std::vector<postop_attr> postop_attrs;
+  bool use_avx512 = true;  // Ymm kernels of fp32 data otherwise
 };
 
-struct groupnorm_data_t {
-  void* src;
+// mean and m2 (sum of squared deviations) of `steps * STEP_ELTS` contiguous elements
+struct groupnorm_stats_data_t {
+  const void* src;
+  float* mean;
+  float* m2;
+  int64_t steps;
+};
+
+// dst = postop((src - mean) * rstd * gamma + beta) over `len` elements of each of `channels` channels, starting at the
+// same spatial offset in each
+struct groupnorm_norm_data_t {
+  const void* src;
   void* dst;
-  float* sum_x_ptr;
-  float* sum_powx_ptr;
-  float* gamma;
-  float* beta;
+  const float* gamma;
+  const float* beta;
+  float mean;
+  float rstd;
+  int64_t len;
+  int64_t channels;
 };
 
 class jit_groupnorm_t : public jit_generator {
  public:
-  explicit jit_groupnorm_t(const groupnorm_param_t& param) : jit_generator(), param_(param) {
-    // all of numeral-calc-postop data type will be fp32.
-    for (auto& i : param_.postop_attrs) {
-      if (i.op_alg != postop_alg::quantize && i.op_alg != postop_alg::dequantize &&
-          i.op_alg != postop_alg::eltop_int_lut) {
-        i.dt = data_type::fp32;
-      }
-    }
-    eltwise_injector_.eltwise_injector_init(this, param_.postop_attrs);
-  }
+  explicit jit_groupnorm_t(const groupnorm_param_t& param) : jit_generator(), param_(param) {}
   virtual ~jit_groupnorm_t() {}
 
-  void prepare_mask(Reg64 reg_tmp, Opmask sum_write_mask);
-  void sum_code_gen(regs_pool* rp, Reg64 reg_src, Reg64 reg_sum_x, Reg64 reg_sum_powx, Opmask sun_write_mask,
-                    const Xbyak::Label& data_label, size_t sum_dim);
-  void calc_scale_and_norm(regs_pool* rp, Reg64 reg_src, Reg64 reg_dst, Reg64 reg_sum_x, Reg64 reg_sum_powx,
-                           Reg64 reg_gamma, Reg64 reg_beta, const Xbyak::Label& div_const_label,
-                           const Xbyak::Label& eps_label, size_t channels_per_group = 1);
-
  protected:
-  groupnorm_param_t param_;
-  Opmask sum_write_mask;
-  jit_eltwise_injector eltwise_injector_;
-  int unroll;
-  int reg_tmp_idx;
+  // load 16 elements of the src data type as fp32
+  void load_fp32(const Zmm& dst, const Xbyak::Address& addr, const Opmask& mask = Opmask(0));
+  // load 8 fp32 elements, AVX2 kernels take no bf16
+  void load_fp32(const Ymm& dst, const Xbyak::Address& addr) { vmovups(dst, addr); }
 
- private:
-  void generate() override;
+  groupnorm_param_t param_;
 };
 
-class jit_channelwise_sum_t : public jit_groupnorm_t {
+// single pass of the statistics: one lane-wise Welford update per element, so a group is read only once and the
+// variance does not suffer from the cancellation of E[x^2] - E[x]^2
+class jit_groupnorm_stats_t : public jit_groupnorm_t {
  public:
-  explicit jit_channelwise_sum_t(const groupnorm_param_t& param) : jit_groupnorm_t(param) {}
-  virtual ~jit_channelwise_sum_t() {}
+  static constexpr int UNROLL = 8;
+  static constexpr int STEP_ELTS = UNROLL * 16;  // elements consumed by one Welford step of all the lanes
+
+  explicit jit_groupnorm_stats_t(const groupnorm_param_t& param) : jit_groupnorm_t(param) {}
+  virtual ~jit_groupnorm_stats_t() {}
 
  private:
   void generate() override;
+  template <bool USE_AVX512>
+  void generate_();
 };
 
-class jit_channelwise_norm_t : public jit_groupnorm_t {
+class jit_groupnorm_norm_t : public jit_groupnorm_t {
  public:
-  explicit jit_channelwise_norm_t(const groupnorm_param_t& param) : jit_groupnorm_t(param) {}
-  virtual ~jit_channelwise_norm_t() {}
+  explicit jit_groupnorm_norm_t(const groupnorm_param_t& param) : jit_groupnorm_t(param) {
+    // all of numeral-calc-postop data type will be fp32.
+    for (auto& i : param_.postop_attrs) {
+      if (i.op_alg != postop_alg::quantize && i.op_alg != postop_alg::dequantize &&
+          i.op_alg != postop_alg::eltop_int_lut) {
+        i.dt = data_type::fp32;
+      }
+    }
+    eltwise_injector_.init_tb_allocate_set(param_.postop_attrs);
+    // the AVX2 relu takes a vector mask for an opmask
+    injector_vmm_num_ = eltwise_injector_.max_zmm_allocate_num() + (param_.use_avx512 ? 0 : 1);
+    eltwise_injector_.eltwise_injector_init(this, param_.postop_attrs);
+  }
+  virtual ~jit_groupnorm_norm_t() {}
 
  private:
   void generate() override;
+  template <bool USE_AVX512>
+  void generate_();
+
+  int injector_vmm_num_;
+
+  jit_eltwise_injector eltwise_injector_;
 };
 
 }  // namespace jd
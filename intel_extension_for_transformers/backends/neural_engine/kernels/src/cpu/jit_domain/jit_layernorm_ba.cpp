@@ -29,15 +29,21 @@ void jit_layernorm_ba_t::generate() {
   }
   this->postamble();
   eltwise_injector.prepare_table();
+  if (!param_.use_avx512 && param_.spec_type == ssd::spec_translnorm_type::direct) {
+    align(32);
+    L(l_tail_mask);
+    for (int i = 0; i < 8; i++) dd(i < param_.col_num % 8 ? 0xffffffff : 0);
+  }
 }
 
 void jit_layernorm_ba_t::direct_gen() {
   direct_load_params();
-  // get unroll_degree
-  unroll_degree = 10;
-  int tail = param_.col_num % 16;
+  // get unroll_degree, AVX2 keeps three ymm for the beta broadcast, the int8 pack and the tail mask
+  const int vec = vec_len();
+  unroll_degree = param_.use_avx512 ? 10 : (13 - injector_vmm_num) / 3;
+  int tail = param_.col_num % vec;
   auto align_col = param_.col_num - tail;
-  while ((unroll_degree > 0) && ((align_col / (unroll_degree * 16) == 0) || (align_col % (unroll_degree * 16) != 0)))
+  while ((unroll_degree > 0) && ((align_col / (unroll_degree * vec) == 0) || (align_col % (unroll_degree * vec) != 0)))
     unroll_degree--;
   // reg alisa
   Reg64 reg_mean = reg_src_offset;
@@ -47,9 +53,11 @@ void jit_layernorm_ba_t::direct_gen() {
 
   // calculate norm loop nums
   int col_loop = 0;
-  if (unroll_degree != 0) col_loop = param_.col_num / (unroll_degree * 16);
+  if (unroll_degree != 0) col_loop = param_.col_num / (unroll_degree * vec);
   // set mask
-  if (tail > 0) {
+  if (tail > 0 && !param_.use_avx512) {
+    vmovups(ymm_tail_mask, ptr[rip + l_tail_mask]);
+  } else if (tail > 0) {
     unsigned int mask = 0;
     for (int i = 0; i < tail; i++) mask = (mask << 1) + 1;
     mov(reg_tmp.cvt32(), mask);
@@ -75,11 +83,11 @@ void jit_layernorm_ba_t::direct_gen() {
 
     // handle col_loop
     add(reg_col, 1);
-    add(src_addr, unroll_degree * 16 * get_data_size(param_.input_dt));
-    add(dst_addr, unroll_degree * 16 * get_data_size(param_.output_dt));
-    if (param_.split_output) add(dst2_addr, unroll_degree * 16 * get_data_size(param_.output2_dt));
-    add(reg_mean, unroll_degree * 16 * get_data_size(data_type::fp32));
-    add(reg_var, unroll_degree * 16 * get_data_size(data_type::fp32));
+    add(src_addr, unroll_degree * vec * get_data_size(param_.input_dt));
+    add(dst_addr, unroll_degree * vec * get_data_size(param_.output_dt));
+    if (param_.split_output) add(dst2_addr, unroll_degree * vec * get_data_size(param_.output2_dt));
+    add(reg_mean, unroll_degree * vec * get_data_size(data_type::fp32));
+    add(reg_var, unroll_degree * vec * get_data_size(data_type::fp32));
     cmp(Xbyak::Reg32(reg_col.getIdx()), col_loop);
     jl(col_loop_start, T_NEAR);
   }
@@ -102,16 +110,40 @@ void jit_layernorm_ba_t::direct_gen() {
 }
 
 void jit_layernorm_ba_t::direct_handel_var(int degree, Reg64 reg_var) {
+  const int vec_bytes = vec_len() * get_data_size(data_type::fp32);
+  if (!param_.use_avx512) vbroadcastss(zmm_beta, ptr[reg_param + LNBA_GET_OFF(eps)]);
   for (int i = 0; i < degree; i++) {
-    vmovups(Zmm(i), dword[reg_var + i * zmm_byte_size]);
-    vaddps(Zmm(i), Zmm(i), ptr_b[reg_param + LNBA_GET_OFF(eps)]);
-    vsqrtps(Zmm(i), Zmm(i));
+    vmovups(vreg(i), dword[reg_var + i * vec_bytes]);
+    if (param_.use_avx512)
+      vaddps(Zmm(i), Zmm(i), ptr_b[reg_param + LNBA_GET_OFF(eps)]);
+    else
+      vaddps(vreg(i), vreg(i), zmm_beta);
+    vsqrtps(vreg(i), vreg(i));
   }
 }
 
 void jit_layernorm_ba_t::direct_handel_norm(int degree, Reg64 src_addr, Reg64 dst_addr, Reg64 reg_mean, bool tail) {
-  vbroadcastss(Zmm(2 * degree), dword[reg_alpha + get_data_size(data_type::fp32) * reg_row]);
-  for (int i = 0; i < degree; i++) vdivps(Zmm(i + degree), Zmm(degree * 2), Zmm(i));
+  vbroadcastss(vreg(2 * degree), dword[reg_alpha + get_data_size(data_type::fp32) * reg_row]);
+  for (int i = 0; i < degree; i++) vdivps(vreg(i + degree), vreg(degree * 2), vreg(i));
+  if (!param_.use_avx512) {
+    vbroadcastss(zmm_beta, dword[reg_beta + get_data_size(data_type::fp32) * reg_row]);
+    for (int i = 0; i < degree; i++) {
+      const Ymm dst = Ymm(i + degree * 2);
+      vmovups(dst, dword[src_addr + i * ymm_byte_size]);
+      if (param_.input_dt == data_type::s32) vcvtdq2ps(dst, dst);
+      vsubps(dst, dst, dword[reg_mean + i * ymm_byte_size]);
+      vfmadd213ps(dst, Ymm(i + degree), zmm_beta);
+      if (param_.split_output) {
+        store_avx2(dst, dst_addr + i * ymm_byte_size, data_type::fp32, tail);
+        eltwise_injector.vector_compute(dst, param_.postop_attrs);
+        store_avx2(dst, dst2_addr_cp + i * 8, param_.output2_dt, tail);
+      } else {
+        if (!param_.postop_attrs.empty()) eltwise_injector.vector_compute(dst, param_.postop_attrs);
+        store_avx2(dst, dst_addr + i * 8 * get_data_size(param_.output_dt), param_.output_dt, tail);
+      }
+    }
+    return;
+  }
   for (int i = 0; i < degree; i++) {
     vmovups(Zmm(i + degree * 2), dword[src_addr + i * zmm_byte_size]);
     // dt convert when input is int32
@@ -164,6 +196,7 @@ void jit_layernorm_ba_t::direct_handel_norm(int degree, Reg64 src_addr, Reg64 ds
 void jit_layernorm_ba_t::normal_gen() {
   normal_gen_load_offset();
   normal_load_params();
+  const int vec_bytes = vec_len() * get_data_size(param_.input_dt);
   vbroadcastss(zmm_one, ptr[reg_param + LNBA_GET_OFF(one)]);
   mov(reg_batch, 0);
   L(batch_loop_start);
@@ -181,13 +214,13 @@ void jit_layernorm_ba_t::normal_gen() {
   L(mean_loop_start);
   // loop1:compute mean.
   // load unroll rows data.
-  for (int k = 0; k < unroll_degree; k++) vmovups(Zmm(k), dword[src_addr + reg_src_offset + src_load_offset[k]]);
+  for (int k = 0; k < unroll_degree; k++) vmovups(vreg(k), dword[src_addr + reg_src_offset + src_load_offset[k]]);
   // calculate the sum of x
   normal_binary_add(unroll_degree, zmm_mean);
   // calculate the sum of x^2 .
   for (int k = 0; k < unroll_degree; k++) {
-    vmovups(Zmm(k), dword[src_addr + reg_src_offset + src_load_offset[k]]);
-    vmulps(Zmm(k), Zmm(k), Zmm(k));
+    vmovups(vreg(k), dword[src_addr + reg_src_offset + src_load_offset[k]]);
+    vmulps(vreg(k), vreg(k), vreg(k));
   }
   normal_binary_add(unroll_degree, zmm_powx_mean);
   add(reg_src_offset, unroll_degree * param_.col_num * get_data_size(param_.input_dt));
@@ -197,13 +230,25 @@ void jit_layernorm_ba_t::normal_gen() {
   jg(mean_loop_start, T_NEAR);
 
   // then calculate the mean of x & mean of x^2.
-  vdivps(zmm_mean, zmm_mean, ptr_b[reg_param + LNBA_GET_OFF(n)]);
-  vdivps(zmm_powx_mean, zmm_powx_mean, ptr_b[reg_param + LNBA_GET_OFF(n)]);
+  if (param_.use_avx512) {
+    vdivps(zmm_mean, zmm_mean, ptr_b[reg_param + LNBA_GET_OFF(n)]);
+    vdivps(zmm_powx_mean, zmm_powx_mean, ptr_b[reg_param + LNBA_GET_OFF(n)]);
+  } else {
+    // no embedded broadcast, mean^2 is not computed yet so its register holds n
+    vbroadcastss(zmm_mean_pow, ptr[reg_param + LNBA_GET_OFF(n)]);
+    vdivps(zmm_mean, zmm_mean, zmm_mean_pow);
+    vdivps(zmm_powx_mean, zmm_powx_mean, zmm_mean_pow);
+  }
   vmulps(zmm_mean_pow, zmm_mean, zmm_mean);
   vsubps(zmm_var, zmm_powx_mean, zmm_mean_pow);
   sub(reg_src_offset, unroll_degree * param_.col_num * get_data_size(param_.input_dt));
   sub(reg_dst_offset, unroll_degree * param_.col_num * get_data_size(param_.output_dt));
-  vaddps(zmm_var, zmm_var, ptr_b[reg_param + LNBA_GET_OFF(eps)]);
+  if (param_.use_avx512) {
+    vaddps(zmm_var, zmm_var, ptr_b[reg_param + LNBA_GET_OFF(eps)]);
+  } else {
+    vbroadcastss(zmm_mean_pow, ptr[reg_param + LNBA_GET_OFF(eps)]);
+    vaddps(zmm_var, zmm_var, zmm_mean_pow);
+  }
   vsqrtps(zmm_var, zmm_var);
   vdivps(zmm_var, zmm_one, zmm_var);
 
@@ -212,18 +257,23 @@ void jit_layernorm_ba_t::normal_gen() {
   L(norm_loop_start);
   // positive sqeuence load rows data for cache performance.
   for (int k = 0; k < unroll_degree; k++) {
-    vmovups(Zmm(k), dword[src_addr + reg_src_offset + src_load_offset[k]]);
-    vsubps(Zmm(k), Zmm(k), zmm_mean);
-    vmulps(Zmm(k), Zmm(k), zmm_var);
+    vmovups(vreg(k), dword[src_addr + reg_src_offset + src_load_offset[k]]);
+    vsubps(vreg(k), vreg(k), zmm_mean);
+    vmulps(vreg(k), vreg(k), zmm_var);
     vbroadcastss(
         zmm_alpha,
         dword[reg_alpha + reg_affine_offset + k * get_data_size(data_type::fp32)]);  // dt(aplha)==dt(beta)==fp32
     vbroadcastss(zmm_beta, dword[reg_beta + reg_affine_offset + k * get_data_size(data_type::fp32)]);
-    vfmadd213ps(Zmm(k), zmm_alpha, zmm_beta);
+    vfmadd213ps(vreg(k), zmm_alpha, zmm_beta);
   }
   escape_regs(unroll_degree);
   // store the value.
   for (int k = 0; k < unroll_degree; k++) {
+    if (!param_.use_avx512) {
+      eltwise_injector.vector_compute(Ymm(k), param_.postop_attrs);
+      store_avx2(Ymm(k), dst_addr + reg_dst_offset + dst_load_offset[k], param_.output_dt);
+      continue;
+    }
     eltwise_injector.vector_compute(Zmm(k), param_.postop_attrs);
     RegExp binarop_offset;
     for (auto&& attr : param_.binaryop_attrs) {
@@ -248,7 +298,7 @@ void jit_layernorm_ba_t::normal_gen() {
   cmp(reg_row, param_.row_num);
   jl(norm_loop_start);
 
-  add(reg_col, zmm_byte_size / get_data_size(param_.input_dt));
+  add(reg_col, vec_bytes / get_data_size(param_.input_dt));
   cmp(reg_col, param_.process_col);
   jl(col_loop_start, T_NEAR);
 
@@ -260,7 +310,7 @@ void jit_layernorm_ba_t::normal_gen() {
 }
 
 // for pipline performance.
-void jit_layernorm_ba_t::normal_binary_add(int degree, Zmm dst) {
+void jit_layernorm_ba_t::normal_binary_add(int degree, Xmm dst) {
   normal_reset_unroll_reg_idxs(degree);
   int first_idx = 0, second_idx = 0, begin_idx = 0;
   while (!normal_check_unroll_add_done()) {
@@ -268,9 +318,26 @@ void jit_layernorm_ba_t::normal_binary_add(int degree, Zmm dst) {
     first_idx = idx_pair.first;
     second_idx = idx_pair.second;
     begin_idx = first_idx + 1;
-    vaddps(Zmm(first_idx), Zmm(first_idx), Zmm(second_idx));
+    vaddps(vreg(first_idx), vreg(first_idx), vreg(second_idx));
+  }
+  vaddps(dst, dst, vreg(first_idx));
+}
+
+void jit_layernorm_ba_t::store_avx2(Ymm src, RegExp dst, data_type dt, bool tail) {
+  if (dt == data_type::fp32) {
+    if (tail)
+      vmaskmovps(ptr[dst], ymm_tail_mask, src);
+    else
+      vmovups(ptr[dst], src);
+    return;
+  }
+  SPARSE_LOG_IF(FATAL, dt != data_type::s8 && dt != data_type::u8) << "unsupported output data type in translnorm.";
+  vpack_s32_8bit_avx2(src, Xmm(ymm_pack.getIdx()), dt == data_type::s8);
+  if (tail) {
+    for (int i = 0; i < param_.col_num % 8; i++) vpextrb(ptr[dst + i], Xmm(src.getIdx()), i);
+  } else {
+    vmovq(ptr[dst], Xmm(src.getIdx()));
   }
-  vaddps(dst, dst, Zmm(first_idx));
 }
 
 void jit_layernorm_ba_t::escape_regs(int degree) {
@@ -281,15 +348,34 @@ void jit_layernorm_ba_t::escape_regs(int degree) {
 }
 
 void jit_layernorm_ba_t::assign_regs() {
-  zmm_mean_pow = Zmm(25);
-  zmm_powx_mean = Zmm(26);
-  zmm_alpha = Zmm(27);
-  zmm_beta = Zmm(28);
-  zmm_one = Zmm(29);
-  zmm_mean = Zmm(30);
-  zmm_var = Zmm(31);
-  // when apply postop,all zmm can be free except zmm_one & zmm_eps.
-  reg_map.insert(std::pair<reg_type, std::set<int>>(reg_type::zmm, {zmm_one.getIdx()}));
+  if (param_.use_avx512) {
+    zmm_mean_pow = Zmm(25);
+    zmm_powx_mean = Zmm(26);
+    zmm_alpha = Zmm(27);
+    zmm_beta = Zmm(28);
+    zmm_one = Zmm(29);
+    zmm_mean = Zmm(30);
+    zmm_var = Zmm(31);
+    // when apply postop,all zmm can be free except zmm_one & zmm_eps.
+    reg_map.insert(std::pair<reg_type, std::set<int>>(reg_type::zmm, {zmm_one.getIdx()}));
+  } else if (param_.spec_type == ssd::spec_translnorm_type::normal) {
+    // 16 ymm: the sums of x^2 and mean^2 are dead once alpha and beta are loaded, so they share registers.
+    zmm_one = Ymm(15);
+    zmm_mean = Ymm(14);
+    zmm_var = Ymm(13);
+    zmm_alpha = zmm_powx_mean = Ymm(12);
+    zmm_beta = zmm_mean_pow = Ymm(11);
+    ymm_pack = Ymm(11);  // beta is reloaded for every row
+    reg_map.insert(std::pair<reg_type, std::set<int>>(reg_type::zmm,
+                                                      {zmm_one.getIdx(), zmm_mean.getIdx(), zmm_var.getIdx()}));
+  } else {
+    // direct: beta has no embedded broadcast, the tail needs a vector mask and beta stays live across the columns.
+    ymm_pack = Ymm(13);
+    zmm_beta = Ymm(14);
+    ymm_tail_mask = Ymm(15);
+    reg_map.insert(std::pair<reg_type, std::set<int>>(
+        reg_type::zmm, {ymm_pack.getIdx(), zmm_beta.getIdx(), ymm_tail_mask.getIdx()}));
+  }
 
 #ifdef _WIN32
   reg_param = rcx;
@@ -15,6 +15,7 @@
 #ifndef ENGINE_SPARSELIB_SRC_CPU_JIT_DOMAIN_JIT_LAYERNORM_BA_HPP_
 #define ENGINE_SPARSELIB_SRC_CPU_JIT_DOMAIN_JIT_LAYERNORM_BA_HPP_
 
+#include <algorithm>
 #include <utility>
 #include <vector>
 #include <map>
@@ -36,8 +37,10 @@ class jit_layernorm_ba_t : public jit_generator {
  public:
   explicit jit_layernorm_ba_t(const ssd::layernorm_ba_param_t& param) : jit_generator(), param_(param) {
     eltwise_injector.init_tb_allocate_set(param_.postop_attrs);
-    // xmm max num=16
-    unroll_degree = 16;
+    // the vector mask AVX2 takes for an opmask
+    injector_vmm_num = eltwise_injector.max_zmm_allocate_num() + (param_.use_avx512 ? 0 : 1);
+    // xmm max num=16; with AVX2 the rows, mean, var and 1 leave the rest of the 16 ymm to the postops
+    unroll_degree = param_.use_avx512 ? 16 : std::min(11, 13 - injector_vmm_num);
     while (param_.row_num % unroll_degree != 0) unroll_degree -= 1;
     assign_regs();
     eltwise_injector.eltwise_injector_init(this, param_.postop_attrs);
@@ -51,12 +54,17 @@ class jit_layernorm_ba_t : public jit_generator {
   void normal_reset_unroll_reg_idxs(int degree);
   std::pair<int, int> normal_get_unroll_add_idx(int begin);
   bool normal_check_unroll_add_done();
-  void normal_binary_add(int degree, Zmm dst);
+  void normal_binary_add(int degree, Xmm dst);
   void direct_handel_var(int degree, Reg64 reg_var);
   void direct_handel_norm(int degree, Reg64 src_addr, Reg64 dst_addr, Reg64 reg_mean, bool tail = false);
   void assign_regs();
   void escape_regs(int degree);
   void normal_gen_load_offset();
+  void store_avx2(Ymm src, RegExp dst, data_type dt, bool tail = false);
+
+  // Zmm, or Ymm without AVX512
+  Xmm vreg(int idx) const { return param_.use_avx512 ? Xmm(Zmm(idx)) : Xmm(Ymm(idx)); }
+  int vec_len() const { return param_.use_avx512 ? 16 : 8; }
 
   void normal_load_params() {
     mov(src_addr, ptr[reg_param + LNBA_GET_OFF(src)]);
@@ -84,20 +92,25 @@ class jit_layernorm_ba_t : public jit_generator {
   jit_eltwise_injector eltwise_injector;
   jit_binary_injector binary_injector;
   int unroll_degree;
+  int injector_vmm_num;
   const int zmm_byte_size = 64;
   const int xmm_byte_size = 16;
+  const int ymm_byte_size = 32;
   std::vector<bool> unroll_reg_idxs;
   std::map<int, int> src_load_offset;
   std::map<int, int> dst_load_offset;
   std::map<reg_type, std::set<int>> reg_map;
 
-  Zmm zmm_one;
-  Zmm zmm_mean;
-  Zmm zmm_mean_pow;
-  Zmm zmm_powx_mean;
-  Zmm zmm_var;
-  Zmm zmm_alpha;
-  Zmm zmm_beta;
+  // Zmm, or Ymm without AVX512
+  Xmm zmm_one;
+  Xmm zmm_mean;
+  Xmm zmm_mean_pow;
+  Xmm zmm_powx_mean;
+  Xmm zmm_var;
+  Xmm zmm_alpha;
+  Xmm zmm_beta;
+  Ymm ymm_tail_mask;  // AVX2 direct translnorm: lanes below col_num % 8
+  Ymm ymm_pack;       // AVX2: scratch of the s32 -> 8-bit pack
   Reg64 reg_param;
   Reg64 src_addr;
   Reg64 dst_addr;
@@ -119,6 +132,7 @@ class jit_layernorm_ba_t : public jit_generator {
   Xbyak::Label norm_loop_start;
   Xbyak::Label batch_loop_start;
   Xbyak::Label tail_loop_start;
+  Xbyak::Label l_tail_mask;
 };
 }  // namespace jd
 #endif  // ENGINE_SPARSELIB_SRC_CPU_JIT_DOMAIN_JIT_LAYERNORM_BA_HPP_
@@ -20,13 +20,21 @@ void jit_softmax_t::generate() {
 
   switch (param_.sepc_type) {
     case ssd::spec_softmax_type::lut:
-      lut_softmax_kernel_gen();
+      param_.use_avx512 ? lut_softmax_kernel_gen() : avx2_softmax_kernel_gen();
       break;
     default:
       break;
   }
 
   this->postamble();
+  if (!param_.use_avx512) {
+    align(32);
+    L(l_avx2_data);
+    const size_t tail_len = (param_.vec_align_len + param_.vec_tail_len) % avx2_vec_len;
+    for (size_t i = 0; i < avx2_vec_len; i++) dd(i < tail_len ? 0xffffffff : 0);
+    dd(bit_cast<uint32_t>(param_.get_lut_exp_attrs.front().scale));
+    dd(bit_cast<uint32_t>(1.f));
+  }
   if (param_.sepc_type == ssd::spec_softmax_type::lut) get_lut_exp_injector.prepare_table();
   eltwise_injector.prepare_table();
 }
@@ -153,6 +161,150 @@ void jit_softmax_t::lut_softmax_kernel_gen() {
   jl(process_vec_loop);
 }
 
+// AVX2 has no vbmi for the exp LUT: x-max is taken in s32, dequantized and exp'ed in fp32, 8 elements a vector.
+void jit_softmax_t::avx2_softmax_kernel_gen() {
+  for (auto&& i : reg_map) {
+    for (auto&& j : i.second) {
+      eltwise_injector.escape_regs(i.first, j);
+      get_lut_exp_injector.escape_regs(i.first, j);
+    }
+  }
+
+  const size_t vec_len = param_.vec_align_len + param_.vec_tail_len;
+  const size_t align_len = vec_len / avx2_vec_len * avx2_vec_len;
+  const bool tail = align_len != vec_len;
+  if (tail) vmovups(ymm_tail_mask, ptr[rip + l_avx2_data]);
+  vbroadcastss(ymm_scale, ptr[rip + l_avx2_data + static_cast<int>(BYTES_YMM)]);
+  mov(src_addr, ptr[reg_param + CUSTSM_GET_OFF(src)]);
+  mov(dst_addr, ptr[reg_param + CUSTSM_GET_OFF(dst)]);
+  mov(reg_tmp, ptr[reg_param + CUSTSM_GET_OFF(tmp)]);
+  mov(vec_num, 0);
+  L(process_vec_loop);
+  // loop one:max reduction, starting from the first element.
+  if (param_.input_dt == data_type::s8)
+    movsx(vec_offset.cvt32(), byte[src_addr]);
+  else
+    movzx(vec_offset.cvt32(), byte[src_addr]);
+  vmovd(Xmm(ymm_max.getIdx()), vec_offset.cvt32());
+  vpbroadcastd(ymm_max, Xmm(ymm_max.getIdx()));
+  mov(src_addr_volatile, src_addr);
+  if (align_len != 0) {
+    mov(vec_offset, 0);
+    L(max_reduction_loop);
+    avx2_load_int8(ymm_vec, src_addr_volatile);
+    vpmaxsd(ymm_max, ymm_max, ymm_vec);
+    add(src_addr_volatile, avx2_vec_len);
+    add(vec_offset, avx2_vec_len);
+    cmp(vec_offset, align_len);
+    jl(max_reduction_loop);
+  }
+  if (tail) {
+    avx2_load_int8(ymm_vec, src_addr_volatile, true);
+    vpmaxsd(ymm_max, ymm_max, ymm_vec);
+  }
+  reduce_dwords(ymm_max, ymm_tmp, &CodeGenerator::vpmaxsd);
+
+  // loop two:sum reduction & store fp32 exp value.
+  vxorps(ymm_denominator, ymm_denominator, ymm_denominator);
+  mov(src_addr_volatile, src_addr);
+  mov(dst_addr_volatile, reg_tmp);
+  if (align_len != 0) {
+    mov(vec_offset, 0);
+    L(sum_reduction_loop);
+    avx2_handle_exp();
+    add(src_addr_volatile, avx2_vec_len);
+    add(dst_addr_volatile, BYTES_YMM);
+    add(vec_offset, avx2_vec_len);
+    cmp(vec_offset, align_len);
+    jl(sum_reduction_loop, T_NEAR);
+  }
+  if (tail) avx2_handle_exp(true);
+  reduce_dwords(ymm_denominator, ymm_tmp, &CodeGenerator::vaddps);  // horizontal sum
+  vbroadcastss(ymm_tmp, ptr[rip + l_avx2_data + static_cast<int>(BYTES_YMM + sizeof(float))]);
+  vdivps(ymm_denominator, ymm_tmp, ymm_denominator);  // calculate denominator
+
+  // loop3: calculate softmax.
+  mov(src_addr_volatile, reg_tmp);
+  mov(dst_addr_volatile, dst_addr);
+  if (align_len != 0) {
+    mov(vec_offset, 0);
+    L(softmax_loop);
+    vmovups(ymm_vec, ptr[src_addr_volatile]);
+    vmulps(ymm_vec, ymm_vec, ymm_denominator);
+    if (param_.postop_attrs.size() != 0) eltwise_injector.vector_compute(ymm_vec, param_.postop_attrs);
+    avx2_store_data(ymm_vec, dst_addr_volatile);
+    add(src_addr_volatile, BYTES_YMM);
+    add(dst_addr_volatile, avx2_vec_len * get_data_size(param_.output_dt));
+    add(vec_offset, avx2_vec_len);
+    cmp(vec_offset, align_len);
+    jl(softmax_loop, T_NEAR);
+  }
+  if (tail) {
+    vmaskmovps(ymm_vec, ymm_tail_mask, ptr[src_addr_volatile]);
+    vmulps(ymm_vec, ymm_vec, ymm_denominator);
+    if (param_.postop_attrs.size() != 0) eltwise_injector.vector_compute(ymm_vec, param_.postop_attrs);
+    avx2_store_data(ymm_vec, dst_addr_volatile, true);
+  }
+
+  add(src_addr, vec_len);
+  add(dst_addr, get_data_size(param_.output_dt) * vec_len);
+  add(reg_tmp, get_data_size(data_type::fp32) * vec_len);
+  inc(vec_num);
+  cmp(vec_num, ptr[reg_param + CUSTSM_GET_OFF(process_vec_num)]);
+  jl(process_vec_loop, T_NEAR);
+}
+
+void jit_softmax_t::avx2_load_int8(Ymm dst, Reg64 src, bool tail) {
+  if (!tail) {
+    if (param_.input_dt == data_type::s8)
+      vpmovsxbd(dst, ptr[src]);  // s8->s32
+    else
+      vpmovzxbd(dst, ptr[src]);  // u8->s32
+    return;
+  }
+  // pad with the first element so that the padding leaves the max as it is
+  const Xmm xmm_dst(dst.getIdx());
+  vpbroadcastb(xmm_dst, ptr[src]);
+  const size_t tail_len = (param_.vec_align_len + param_.vec_tail_len) % avx2_vec_len;
+  for (size_t i = 1; i < tail_len; i++) vpinsrb(xmm_dst, xmm_dst, ptr[src + i], i);
+  if (param_.input_dt == data_type::s8)
+    vpmovsxbd(dst, xmm_dst);
+  else
+    vpmovzxbd(dst, xmm_dst);
+}
+
+void jit_softmax_t::avx2_handle_exp(bool tail) {
+  avx2_load_int8(ymm_vec, src_addr_volatile, tail);
+  vpsubd(ymm_vec, ymm_vec, ymm_max);  // x-max
+  vcvtdq2ps(ymm_vec, ymm_vec);
+  vmulps(ymm_vec, ymm_vec, ymm_scale);
+  get_lut_exp_injector.vector_compute(ymm_vec, param_.get_lut_exp_attrs, {1});  // e^(x-max), the dequantize is done
+  if (tail) {
+    vandps(ymm_vec, ymm_vec, ymm_tail_mask);
+    vmaskmovps(ptr[dst_addr_volatile], ymm_tail_mask, ymm_vec);
+  } else {
+    vmovups(ptr[dst_addr_volatile], ymm_vec);
+  }
+  vaddps(ymm_denominator, ymm_denominator, ymm_vec);
+}
+
+void jit_softmax_t::avx2_store_data(Ymm src, Reg64 dst, bool tail) {
+  if (param_.output_dt == data_type::fp32) {
+    if (tail)
+      vmaskmovps(ptr[dst], ymm_tail_mask, src);
+    else
+      vmovups(ptr[dst], src);
+    return;
+  }
+  vpack_s32_8bit_avx2(src, Xmm(ymm_tmp.getIdx()), param_.output_dt == data_type::s8);
+  if (tail) {
+    const size_t tail_len = (param_.vec_align_len + param_.vec_tail_len) % avx2_vec_len;
+    for (size_t i = 0; i < tail_len; i++) vpextrb(ptr[dst + i], Xmm(src.getIdx()), i);
+  } else {
+    vmovq(ptr[dst], Xmm(src.getIdx()));
+  }
+}
+
 void jit_softmax_t::lut_int8_cvt_int16(Zmm dst, Reg64 src) {
   if (param_.input_dt == data_type::s8)
     vpmovsxbw(dst, ptr[src]);  // s8->s16
@@ -239,6 +391,19 @@ void jit_softmax_t::assign_regs() {
       reg_type::reg64, {src_addr.getIdx(), dst_addr.getIdx(), vec_num.getIdx(), vec_offset.getIdx(), reg_tmp.getIdx(),
                         src_addr_volatile.getIdx(), dst_addr_volatile.getIdx()}));
 
+  if (!param_.use_avx512) {
+    ymm_vec = ymm0;
+    ymm_denominator = ymm1;
+    ymm_max = ymm2;
+    ymm_tmp = ymm3;
+    ymm_scale = ymm4;
+    ymm_tail_mask = ymm5;
+    reg_map.insert(std::pair<reg_type, std::set<int>>(
+        reg_type::zmm, {ymm_vec.getIdx(), ymm_denominator.getIdx(), ymm_max.getIdx(), ymm_tmp.getIdx(),
+                        ymm_scale.getIdx(), ymm_tail_mask.getIdx()}));
+    return;
+  }
+
   bit16_mask = Opmask(6);
   bit32_mask = Opmask(7);
   reg_map.insert(std::pair<reg_type, std::set<int>>(reg_type::mask, {bit16_mask.getIdx(), bit16_mask.getIdx()}));
@@ -47,6 +47,10 @@ class jit_softmax_t : public jit_generator {
   void lut_int8_cvt_int16(Zmm dst, Reg64 src);
   void lut_store_data(int simd_idx, Reg64 dst, int offset = 0, bool mask = false);
   void lut_handle_exp(bool tail = false);
+  void avx2_softmax_kernel_gen();
+  void avx2_load_int8(Ymm dst, Reg64 src, bool tail = false);
+  void avx2_handle_exp(bool tail = false);
+  void avx2_store_data(Ymm src, Reg64 dst, bool tail = false);
 
  private:
   ssd::softmax_param_t param_;
@@ -80,6 +84,15 @@ class jit_softmax_t : public jit_generator {
   Xmm xmm_exp_neg_max;
   Zmm zmm_denominator;  // broadcast sum to this zmm reg and then mul e^-M.
 
+  // AVX2 kernel, which has 8 lanes and no opmask
+  const size_t avx2_vec_len = 8;
+  Ymm ymm_denominator;
+  Ymm ymm_max;
+  Ymm ymm_tmp;
+  Ymm ymm_scale;      // dequantize scale
+  Ymm ymm_tail_mask;  // lanes below vec_len % 8
+  Xbyak::Label l_avx2_data;  // tail mask, dequantize scale and 1.f
+
   Xbyak::Label process_vec_loop;
   Xbyak::Label max_reduction_loop;
   Xbyak::Label max_reduction_end;
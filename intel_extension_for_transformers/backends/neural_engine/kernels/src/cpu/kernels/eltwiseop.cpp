@@ -17,12 +17,15 @@
 namespace jd {
 
 bool eltwiseop_kd_t::init() {
-  if (!isa_available(avx512_core)) return false;
+  params_.use_avx512 = isa_available(avx512_core);
+  if (!params_.use_avx512 && !isa_available(avx2)) return false;
   params_.postop_attrs = op_desc_.apply_postops_list();
   for (auto& postop_attr : params_.postop_attrs) {
+    // lut and bf16 postops are only implemented with AVX512 instructions
     if (postop_attr.op_alg == postop_alg::eltop_int_lut && !isa_available(avx512_core_vbmi)) return false;
     if (postop_attr.dt == data_type::bf16 && !isa_available(avx512_core_bf16)) return false;
   }
+  if (!params_.use_avx512 && (params_.in_dt == data_type::bf16 || params_.out_dt == data_type::bf16)) return false;
   int nthr = op_desc_.impl_nthr();
   params_.element_num_each_th = params_.element_num / nthr;
   params_.remain_element = params_.element_num - (nthr - 1) * params_.element_num_each_th;
@@ -13,6 +13,9 @@
 //  limitations under the License.
 #include "groupnorm.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 namespace jd {
 
 #define KERNEL_INIT_CHECK(f)                                         \
@@ -23,7 +26,8 @@ namespace jd {
 using idx = exposed_enum::groupnorm::io;
 
 bool groupnorm_kd_t::init() {
-  if (!isa_available(avx512_core)) return false;
+  param_.use_avx512 = isa_available(avx512_core);
+  if (!param_.use_avx512 && !isa_available(avx2)) return false;
   auto op_attrs = op_desc_.attrs();
   KERNEL_INIT_CHECK(op_attrs.count("groups") != 0);
   param_.groups = str_to_num<int>(op_attrs["groups"]);
@@ -35,101 +39,101 @@ bool groupnorm_kd_t::init() {
   param_.dt = src_desc.dtype();
   param_.HW = std::accumulate(src_shape.begin() + 2, src_shape.end(), 1, std::multiplies<int>());
   param_.postop_attrs = op_desc_.apply_postops_list();
+  if (!param_.use_avx512) {
+    // bf16 and the LUT postops are only implemented with AVX512 instructions
+    if (param_.dt == data_type::bf16) return false;
+    for (auto&& attr : param_.postop_attrs)
+      if (attr.op_alg == postop_alg::eltop_int_lut) return false;
+  }
   return true;
 }
 
 bool groupnorm_k_t::init() {
   auto param = derived_kd()->param();
   HW_ = param.HW;
-  mode_ = HW_ > 1024 ? parallelC : parallelG;
   channels_ = param.channels;
   groups_ = param.groups;
   channels_per_group_ = channels_ / groups_;
+  eps_ = param.eps;
   dt_bytewidth_ = get_data_size(param.dt);
   batchs_ = derived_kd()->shape()[0];
-  if (mode_ == parallelC) {
-    jit_sum_ker_ = new jit_channelwise_sum_t(param);
-    jit_norm_ker_ = new jit_channelwise_norm_t(param);
-    return jit_sum_ker_->create_kernel() && jit_norm_ker_->create_kernel();
-  }
-  jit_groupwise_ker_ = new jit_groupnorm_t(param);
-  return jit_groupwise_ker_->create_kernel();
+  group_size_ = channels_per_group_ * HW_;
+  stats_chunks_ = ceil_div(group_size_, STATS_CHUNK);
+  // a task normalizes a part of a channel, or whole channels if they are small
+  norm_len_ = std::min(HW_, NORM_CHUNK);
+  norm_channels_ = std::max<int64_t>(1, NORM_CHUNK / HW_);
+  hw_chunks_ = ceil_div(HW_, norm_len_);
+  norm_chunks_ = ceil_div(channels_per_group_, norm_channels_) * hw_chunks_;
+  static_assert(STATS_CHUNK % jit_groupnorm_stats_t::STEP_ELTS == 0, "a chunk must be whole Welford steps");
+  jit_stats_ker_ = new jit_groupnorm_stats_t(param);
+  jit_norm_ker_ = new jit_groupnorm_norm_t(param);
+  return jit_stats_ker_->create_kernel() && jit_norm_ker_->create_kernel();
 }
 
-size_t groupnorm_k_t::get_workspace_size() const {
-  size_t buf_size = 2 * batchs_ * groups_ * sizeof(float);
-  if (mode_ == parallelC) buf_size = 2 * channels_ * sizeof(float);
-  return buf_size;
-}
+size_t groupnorm_k_t::get_workspace_size() const { return batchs_ * groups_ * stats_chunks_ * sizeof(stats_t); }
 
-void groupnorm_k_t::parallelC_execute(const std::vector<const void*>& rt_data) const {
-  float* sum_x = static_cast<float*>(const_cast<void*>(rt_data[idx::WORKSPACE]));
-  float* sum_powx = static_cast<float*>(const_cast<void*>(rt_data[idx::WORKSPACE])) + channels_;
-  for (int batch = 0; batch < batchs_; batch++) {
-#pragma omp parallel for
-    for (int channel = 0; channel < channels_; channel++) {
-      groupnorm_data_t data;
-      auto offset = (batch * channels_ + channel) * HW_ * dt_bytewidth_;
-      data.src = static_cast<char*>(const_cast<void*>(rt_data[idx::SRC])) + offset;
-      data.sum_x_ptr = sum_x + channel;
-      data.sum_powx_ptr = sum_powx + channel;
-      (*jit_sum_ker_)(&data);
-    }
-#pragma omp parallel for
-    for (int group = 0; group < groups_; group++) {
-      auto base_idx = group * channels_per_group_;
-#pragma omp simd
-      for (int i = 1; i < channels_per_group_; i++) {
-        sum_x[base_idx] += sum_x[base_idx + i];
-        sum_powx[base_idx] += sum_powx[base_idx + i];
-      }
-    }
-#pragma omp parallel for
-    for (int channel = 0; channel < channels_; channel++) {
-      groupnorm_data_t data;
-      auto group = channel / channels_per_group_;
-      auto offset = (batch * channels_ + channel) * HW_ * dt_bytewidth_;
-      data.src = static_cast<char*>(const_cast<void*>(rt_data[idx::SRC])) + offset;
-      data.dst = static_cast<char*>(const_cast<void*>(rt_data[idx::DST])) + offset;
-      data.gamma = static_cast<float*>(const_cast<void*>(rt_data[idx::GAMMA])) + channel;
-      data.beta = static_cast<float*>(const_cast<void*>(rt_data[idx::BETA])) + channel;
-      data.sum_x_ptr = sum_x + group * channels_per_group_;
-      data.sum_powx_ptr = sum_powx + group * channels_per_group_;
-      (*jit_norm_ker_)(&data);
-    }
-  }
+void groupnorm_k_t::merge_stats(stats_t* a, const stats_t& b) {
+  // Chan et al. update for the union of two sets of samples
+  if (b.n == 0) return;
+  const int64_t n = a->n + b.n;
+  const float delta = b.mean - a->mean;
+  a->mean += delta * b.n / n;
+  a->m2 += b.m2 + delta * delta * (static_cast<float>(a->n) * b.n / n);
+  a->n = n;
 }
 
-void groupnorm_k_t::parallelG_execute(const std::vector<const void*>& rf_data) const {
-  float* sum_x = static_cast<float*>(const_cast<void*>(rf_data[idx::WORKSPACE]));
-  float* sum_powx = static_cast<float*>(const_cast<void*>(rf_data[idx::WORKSPACE])) + batchs_ * groups_;
-#pragma omp parallel for collapse(2)
-  for (int64_t batch = 0; batch < batchs_; batch++) {
-    for (int64_t group = 0; group < groups_; group++) {
-      groupnorm_data_t data;
-      auto offset = (batch * channels_ + group * channels_per_group_) * HW_ * dt_bytewidth_;
-      data.src = static_cast<char*>(const_cast<void*>(rf_data[idx::SRC])) + offset;
-      data.dst = static_cast<char*>(const_cast<void*>(rf_data[idx::DST])) + offset;
-      data.sum_x_ptr = sum_x + batch * groups_ + group;
-      data.sum_powx_ptr = sum_powx + batch * groups_ + group;
-      data.gamma = static_cast<float*>(const_cast<void*>(rf_data[idx::GAMMA])) + group * channels_per_group_;
-      data.beta = static_cast<float*>(const_cast<void*>(rf_data[idx::BETA])) + group * channels_per_group_;
-      (*jit_groupwise_ker_)(&data);
-    }
+groupnorm_k_t::stats_t groupnorm_k_t::chunk_stats(const char* src, int64_t len) const {
+  const int64_t steps = len / jit_groupnorm_stats_t::STEP_ELTS;
+  stats_t s = {steps * jit_groupnorm_stats_t::STEP_ELTS, 0.f, 0.f};
+  groupnorm_stats_data_t data = {src, &s.mean, &s.m2, steps};
+  (*jit_stats_ker_)(&data);
+  // leftovers of the last chunk of a group
+  for (int64_t i = s.n; i < len; i++) {
+    const float x = dt_bytewidth_ == 2 ? static_cast<float>(reinterpret_cast<const bfloat16_t*>(src)[i])
+                                       : reinterpret_cast<const float*>(src)[i];
+    s.n++;
+    const float delta = x - s.mean;
+    s.mean += delta / s.n;
+    s.m2 += delta * (x - s.mean);
   }
+  return s;
 }
 
 bool groupnorm_k_t::execute(const std::vector<const void*>& rt_data) const {
-  switch (mode_) {
-    case parallelC:
-      parallelC_execute(rt_data);
-      break;
-    case parallelG:
-      parallelG_execute(rt_data);
-      break;
-    default:
-      SPARSE_LOG(FATAL) << "unsupported parallel mode.";
-      break;
+  const auto src = static_cast<const char*>(rt_data[idx::SRC]);
+  const auto dst = static_cast<char*>(const_cast<void*>(rt_data[idx::DST]));
+  const auto gamma = static_cast<const float*>(rt_data[idx::GAMMA]);
+  const auto beta = static_cast<const float*>(rt_data[idx::BETA]);
+  const auto stats = static_cast<stats_t*>(const_cast<void*>(rt_data[idx::WORKSPACE]));
+
+  // both passes run over (batch, group, chunk of the group), the parallelism does not depend on the batch size
+#pragma omp parallel for
+  for (int64_t task = 0; task < batchs_ * groups_ * stats_chunks_; task++) {
+    const int64_t bg = task / stats_chunks_;
+    const int64_t begin = task % stats_chunks_ * STATS_CHUNK;
+    const int64_t len = std::min(STATS_CHUNK, group_size_ - begin);
+    stats[task] = chunk_stats(src + (bg * group_size_ + begin) * dt_bytewidth_, len);
+  }
+
+#pragma omp parallel for
+  for (int64_t task = 0; task < batchs_ * groups_ * norm_chunks_; task++) {
+    const int64_t bg = task / norm_chunks_;
+    const int64_t channel = task % norm_chunks_ / hw_chunks_ * norm_channels_;  // in the group
+    const int64_t begin = task % hw_chunks_ * norm_len_;
+    const stats_t* group_stats = stats + bg * stats_chunks_;
+    stats_t s = group_stats[0];
+    for (int64_t i = 1; i < stats_chunks_; i++) merge_stats(&s, group_stats[i]);
+    const auto offset = (bg * group_size_ + channel * HW_ + begin) * dt_bytewidth_;
+    const int64_t gamma_idx = bg % groups_ * channels_per_group_ + channel;
+    groupnorm_norm_data_t data = {src + offset,
+                                  dst + offset,
+                                  gamma + gamma_idx,
+                                  beta + gamma_idx,
+                                  s.mean,
+                                  1.f / std::sqrt(s.m2 / s.n + eps_),
+                                  std::min(norm_len_, HW_ - begin),
+                                  std::min(norm_channels_, channels_per_group_ - channel)};
+    (*jit_norm_ker_)(&data);
   }
   return true;
 }
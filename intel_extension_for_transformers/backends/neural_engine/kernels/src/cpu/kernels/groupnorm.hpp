@@ -50,15 +50,15 @@ class groupnorm_kd_t : public kernel_desc_t {
   groupnorm_param_t param_;
 };
 
+// Two passes over the activation, each a single parallel region over (batch, group, chunk): the Welford statistics
+// of the chunks, then the normalization with the affine transform and postops
 class groupnorm_k_t : public kernel_t {
  public:
   using kd_t = groupnorm_kd_t;
-  enum parallel_mode { parallelG, parallelC };
   explicit groupnorm_k_t(const std::shared_ptr<const kd_t>& kd) : kernel_t(kd) {}
   virtual ~groupnorm_k_t() {
-    safe_delete(jit_sum_ker_);
+    safe_delete(jit_stats_ker_);
     safe_delete(jit_norm_ker_);
-    safe_delete(jit_groupwise_ker_);
   }
   // Delete move constructor and move operator
   groupnorm_k_t(groupnorm_k_t&& other) = delete;
@@ -71,24 +71,39 @@ class groupnorm_k_t : public kernel_t {
   bool init() override;
 
   bool execute(const std::vector<const void*>& rt_data) const override;
-  void parallelC_execute(const std::vector<const void*>& rt_data) const;
-  void parallelG_execute(const std::vector<const void*>& rt_data) const;
 
  public:
   const std::shared_ptr<const kd_t> derived_kd() const { return std::static_pointer_cast<const kd_t>(kd_); }
   size_t get_workspace_size() const override;
 
  private:
-  jit_channelwise_sum_t* jit_sum_ker_ = nullptr;
-  jit_channelwise_norm_t* jit_norm_ker_ = nullptr;
-  jit_groupnorm_t* jit_groupwise_ker_ = nullptr;
+  // count, mean and sum of squared deviations of a chunk, stored in the workspace
+  struct stats_t {
+    int64_t n;
+    float mean;
+    float m2;
+  };
+  static constexpr int64_t STATS_CHUNK = 16 * 1024;  // elements per statistics task, a multiple of STEP_ELTS
+  static constexpr int64_t NORM_CHUNK = 4 * 1024;    // elements per normalization task
+
+  static void merge_stats(stats_t* a, const stats_t& b);
+  stats_t chunk_stats(const char* src, int64_t len) const;
+
+  jit_groupnorm_stats_t* jit_stats_ker_ = nullptr;
+  jit_groupnorm_norm_t* jit_norm_ker_ = nullptr;
   int64_t HW_;
-  parallel_mode mode_;
   int dt_bytewidth_;
   int batchs_;
   int channels_;
   int groups_;
   int channels_per_group_;
+  float eps_;
+  int64_t group_size_;     // elements of a (batch, group), contiguous in NCHW
+  int64_t stats_chunks_;   // statistics tasks per (batch, group)
+  int64_t norm_len_;       // elements per channel of a normalization task
+  int64_t norm_channels_;  // channels of a normalization task
+  int64_t hw_chunks_;      // normalization tasks per channel
+  int64_t norm_chunks_;    // normalization tasks per (batch, group)
 };
 
 }  // namespace jd
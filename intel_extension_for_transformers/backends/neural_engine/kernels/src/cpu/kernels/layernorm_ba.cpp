@@ -17,7 +17,14 @@
 namespace jd {
 
 bool layernorm_ba_kd_t::init() {
-  if (!isa_available(avx512_core)) return false;
+  if (!isa_available(avx512_core)) {
+    if (!isa_available(avx2)) return false;
+    // the AVX2 path keeps the fp32 and int8 postops of the eltwise injector
+    if (!op_desc_.get_binaryop_list().empty()) return false;
+    for (auto&& attr : op_desc_.apply_postops_list()) {
+      if (attr.dt == data_type::bf16 || attr.op_alg == postop_alg::eltop_int_lut) return false;
+    }
+  }
   auto op_attr = op_desc_.attrs();
   if (op_attr.count("spec_type") == 0) {
     op_attr["spec_type"] = "normal";
@@ -56,6 +63,7 @@ void layernorm_ba_kd_t::direct_translnorm_init() {
   // init param
   int max_thr = omp_get_max_threads();
   ssd::layernorm_ba_param_t param;
+  param.use_avx512 = isa_available(avx512_core);
   param.spec_type = ssd::spec_translnorm_type::direct;
   param.input_dt = input_dt;
   param.output_dt = output_dt;
@@ -94,6 +102,7 @@ void layernorm_ba_kd_t::normal_translnorm_init() {
   for (int i = 0; i < ker_num; i++) {
     int thread_elt_offset = col_per_thr * i;
     ssd::layernorm_ba_param_t param;
+    param.use_avx512 = isa_available(avx512_core);
     param.spec_type = ssd::spec_translnorm_type::normal;
     param.input_dt = input_dt;
     param.output_dt = output_dt;
@@ -19,10 +19,18 @@ namespace jd {
 bool softmax_kd_t::init() {
   auto op_attrs = op_desc_.attrs();
   if (op_attrs["spec_type"] == "lut") {
-    if (!isa_available(avx512_core_vbmi)) {
-      SPARSE_LOG(WARNING) << "vbmi ISA not available, dispatch to ref_impl.";
+    // without vbmi the exp is computed in fp32 on AVX2 instead of looked up
+    param_.use_avx512 = isa_available(avx512_core_vbmi);
+    if (!param_.use_avx512 && !isa_available(avx2)) {
+      SPARSE_LOG(WARNING) << "vbmi or AVX2 ISA not available, dispatch to ref_impl.";
       return false;
     }
+    if (!param_.use_avx512) {
+      // bf16 is only implemented with AVX512 instructions
+      if (op_desc_.tensor_descs()[1].dtype() == data_type::bf16) return false;
+      for (auto&& attr : op_desc_.apply_postops_list())
+        if (attr.dt == data_type::bf16) return false;
+    }
     prepare_lut_softmax_params();
   } else {
     SPARSE_LOG(ERROR) << "do not supported specialization softmax type";
@@ -37,7 +45,7 @@ bool softmax_k_t::init() {
   for (int i = 0; i < nthr_; i++) {
     td.push_back(new ssd::softmax_data_t());
     if (op_attrs["spec_type"] == "lut") {
-      if (isa_available(avx512_core_bf16)) {
+      if (param.use_avx512 && isa_available(avx512_core_bf16)) {
         td[i]->tmp = malloc(param.scalar_num * sizeof(bfloat16_t));
       } else {
         td[i]->tmp = malloc(param.scalar_num * sizeof(int32_t));
@@ -79,10 +87,16 @@ void softmax_kd_t::prepare_lut_softmax_params() {
   param_.postop_attrs.front().alpha = 0;  // (x-zp)*scale-(max-zp)*scale=(x-max)*scale,so we don't need zp
   param_.get_lut_exp_attrs.push_back(param_.postop_attrs.front());
   param_.postop_attrs.erase(param_.postop_attrs.begin());
-  postop_attr exp_attr{data_type::bf16, postop_type::eltwise, postop_alg::exp};
-  postop_attr etlop_lut_attr{input_dt, postop_type::eltwise, postop_alg::eltop_int_lut, 16, 256};
-  param_.get_lut_exp_attrs.push_back(exp_attr);
-  param_.get_lut_exp_attrs.insert(param_.get_lut_exp_attrs.begin(), etlop_lut_attr);
+  if (param_.use_avx512) {
+    postop_attr exp_attr{data_type::bf16, postop_type::eltwise, postop_alg::exp};
+    postop_attr etlop_lut_attr{input_dt, postop_type::eltwise, postop_alg::eltop_int_lut, 16, 256};
+    param_.get_lut_exp_attrs.push_back(exp_attr);
+    param_.get_lut_exp_attrs.insert(param_.get_lut_exp_attrs.begin(), etlop_lut_attr);
+  } else {
+    // AVX2 kernel: x-max is taken in s32 and scaled by the dequantize scale, then exp follows in fp32
+    postop_attr exp_attr{data_type::fp32, postop_type::eltwise, postop_alg::exp};
+    param_.get_lut_exp_attrs.push_back(exp_attr);
+  }
   param_.vec_align_len = vec_len / 32 * 32;
   param_.vec_num_per_thr = vec_num_per_thr;
   param_.vec_num_tail_thr = vec_num_tail_thr;
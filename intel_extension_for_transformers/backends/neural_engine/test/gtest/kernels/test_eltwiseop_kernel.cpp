@@ -15,6 +15,7 @@
 #include "gtest/gtest.h"
 #include "unit_test_utils.hpp"
 #include "interface.hpp"
+#include "src/cpu/cpu_isa.hpp"
 
 namespace test {
 struct op_args_t {
@@ -25,6 +26,7 @@ struct op_args_t {
 struct test_params_t {
   std::pair<op_args_t, op_args_t> args;
   bool expect_to_fail;
+  bool force_avx2 = false;  // hide AVX512 from dispatching to test the Ymm kernel
 };
 
 void get_true_data(const jd::operator_desc& op_desc, const std::vector<const void*>& rt_data) {
@@ -50,7 +52,7 @@ void get_true_data(const jd::operator_desc& op_desc, const std::vector<const voi
   }
   auto attr = op_desc.apply_postops_list();
   for (int i = 0; i < size; i++) {
-    src_fp32[i] = apply_postop_list(src_fp32[i], attr);
+    src_fp32[i] = test::apply_postop_list(src_fp32[i], attr);
   }
   if (dst_dt == jd::data_type::s8) {
     cast_from_float_array<int8_t>(src_fp32, dst, size);
@@ -72,10 +74,13 @@ bool check_result(const test_params_t& t) {
 
   try {
     const auto& op_desc = p.op_desc;
+    jd::max_isa() = t.force_avx2 ? jd::avx2 : jd::isa_any;
     jd::eltwiseop_desc eltwiseop_desc(op_desc);
     jd::eltwiseop eltwiseop_kern(eltwiseop_desc);
+    jd::max_isa() = jd::isa_any;
     eltwiseop_kern.execute(p.data);
   } catch (const std::exception& e) {
+    jd::max_isa() = jd::isa_any;
     if (t.expect_to_fail) {
       return true;
     } else {
@@ -263,6 +268,27 @@ static auto case_func = []() {
 
   cases.push_back({gen_case({data2_desc, data2_desc}, {{"postop_list", "fp32_swish"}}, {fp32_swish_attr}), false});
   cases.push_back({gen_case({data3_desc, data3_desc}, {{"postop_list", "bf16_swish"}}, {bf16_swish_attr}), false});
+
+  // AVX2 kernels, shapes differ from the cases above so that the kernel cache does not return an AVX512 kernel
+  jd::tensor_desc avx2_fp32_desc = {{333, 7}, jd::data_type::fp32, jd::format_type::undef};
+  jd::tensor_desc avx2_u8_desc = {{333, 7}, jd::data_type::u8, jd::format_type::undef};
+  jd::tensor_desc avx2_s8_desc = {{333, 7}, jd::data_type::s8, jd::format_type::undef};
+  cases.push_back(
+      {gen_case({avx2_fp32_desc, avx2_fp32_desc}, {{"postop_list", "fp32_exp"}}, {fp32_exp_attr}), false, true});
+  cases.push_back(
+      {gen_case({avx2_fp32_desc, avx2_fp32_desc}, {{"postop_list", "fp32_tanh"}}, {fp32_tanh_attr}), false, true});
+  cases.push_back(
+      {gen_case({avx2_fp32_desc, avx2_fp32_desc}, {{"postop_list", "fp32_relu"}}, {fp32_relu_attr}), false, true});
+  cases.push_back(
+      {gen_case({avx2_fp32_desc, avx2_fp32_desc}, {{"postop_list", "fp32_swish"}}, {fp32_swish_attr}), false, true});
+  cases.push_back({gen_case({avx2_fp32_desc, avx2_s8_desc}, {{"postop_list", "fp32_gelu+quantize"}},
+                            {fp32_gelu_attr, quantize_s8_attr}),
+                   false, true});
+  cases.push_back(
+      {gen_case({avx2_s8_desc, avx2_fp32_desc}, {{"postop_list", "s8dequantize"}}, {dequantize_s8_attr}), false, true});
+  cases.push_back({gen_case({avx2_u8_desc, avx2_u8_desc}, {{"postop_list", "dequantize+fp32_gelu+quantize"}},
+                            {dequantize_u8_attr, fp32_gelu_attr, quantize_u8_attr}),
+                   false, true});
   return ::testing::ValuesIn(cases);
 };
 
@@ -15,6 +15,7 @@
 #include "gtest/gtest.h"
 #include "unit_test_utils.hpp"
 #include "src/cpu/kernels/groupnorm_ref.hpp"
+#include "src/cpu/cpu_isa.hpp"
 #include "kernels/exposed_enum.hpp"
 #include "interface.hpp"
 
@@ -35,6 +36,7 @@ struct op_args_t {
 struct test_params_t {
   std::pair<op_args_t, op_args_t> args;
   bool expect_to_fail;
+  bool force_avx2 = false;  // hide AVX512 from dispatching to test the Ymm kernel
 };
 
 bool check_result(const test_params_t& t) {
@@ -46,8 +48,10 @@ bool check_result(const test_params_t& t) {
   std::vector<const void*> data1(idx::SIZE);
   std::vector<const void*> data2(idx::SIZE);
   try {
+    jd::max_isa() = t.force_avx2 ? jd::avx2 : jd::isa_any;
     jd::groupnorm_desc groupnorm_desc(op_desc);
     jd::groupnorm groupnorm_ker(groupnorm_desc);
+    jd::max_isa() = jd::isa_any;
 
     if (data_type == jd::data_type::bf16) {
       data1[idx::SRC] = p.bf16_src->data();
@@ -78,6 +82,7 @@ bool check_result(const test_params_t& t) {
     jd::kernel_t::create<jd::groupnorm_ref_k_t, jd::groupnorm_ref_kd_t>(groupnorm_ref_ker, groupnorm_ref_desc);
     groupnorm_ref_ker->execute(data2);
   } catch (const std::exception& e) {
+    jd::max_isa() = jd::isa_any;
     if (t.expect_to_fail) {
       return true;
     } else {
@@ -149,8 +154,9 @@ std::pair<op_args_t, op_args_t> gen_case(const std::vector<jd::tensor_desc>& ts_
 static auto case_func = []() {
   std::vector<test_params_t> cases;
   std::vector<jd::data_type> dt_types = {jd::data_type::bf16, jd::data_type::fp32};
-  std::vector<std::vector<dim_t>> problem_size = {{1, 8, 16, 16}, {1, 8, 64, 64}, {2, 8, 16, 16},
-                                                  {2, 8, 64, 64}, {2, 8, 7, 7},   {2, 8, 111, 101}};
+  std::vector<std::vector<dim_t>> problem_size = {{1, 8, 16, 16}, {1, 8, 64, 64},   {2, 8, 16, 16},  {2, 8, 64, 64},
+                                                  {2, 8, 7, 7},   {2, 8, 111, 101}, {1, 4, 5, 1},    {1, 8, 1, 1},
+                                                  {2, 64, 33, 35}, {1, 8, 160, 160}};
   jd::postop_attr swish_attr = {jd::data_type::fp32, jd::postop_type::eltwise, jd::postop_alg::swish, 2.f};
   for (auto&& dt : dt_types) {
     for (auto&& shape : problem_size) {
@@ -164,6 +170,17 @@ static auto case_func = []() {
                        false});
     }
   }
+
+  // AVX2 kernels, shapes differ from the cases above so that the kernel cache does not return an AVX512 kernel
+  std::vector<std::vector<dim_t>> avx2_problem_size = {{1, 8, 24, 24}, {2, 8, 13, 11}, {1, 4, 3, 1}, {2, 64, 33, 37}};
+  for (auto&& shape : avx2_problem_size) {
+    jd::tensor_desc src_desc = {shape, jd::data_type::fp32, jd::format_type::abcd};
+    jd::tensor_desc gamma_desc = {{shape[1]}, jd::data_type::fp32, jd::format_type::a};
+    jd::tensor_desc workspace_desc = {{}, jd::data_type::fp32, jd::format_type::a};
+    cases.push_back({gen_case({src_desc, src_desc, gamma_desc, gamma_desc, workspace_desc},
+                              {{"eps", "0.01"}, {"groups", "4"}}, {swish_attr}),
+                     false, true});
+  }
   return ::testing::ValuesIn(cases);
 };
 std::string test_suffix(testing::TestParamInfo<test_params_t> tpi) {
@@ -190,6 +207,7 @@ std::string test_suffix(testing::TestParamInfo<test_params_t> tpi) {
     default:
       break;
   }
+  if (tpi.param.force_avx2) params.push_back("avx2");
   return join_str(params, "_");
 }
 INSTANTIATE_TEST_SUITE_P(SparseLib, GroupNormKernelTest, case_func(), test_suffix);
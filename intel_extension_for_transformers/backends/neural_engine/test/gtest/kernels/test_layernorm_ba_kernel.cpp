@@ -16,6 +16,7 @@
 #include "unit_test_utils.hpp"
 #include "src/cpu/kernels/layernorm_ba_ref.hpp"
 #include "interface.hpp"
+#include "src/cpu/cpu_isa.hpp"
 namespace test {
 struct op_args_t {
   jd::operator_desc op_desc;
@@ -25,6 +26,7 @@ struct op_args_t {
 struct test_params_t {
   std::pair<op_args_t, op_args_t> args;
   bool expect_to_fail;
+  bool force_avx2 = false;  // hide AVX512 from dispatching to test the Ymm kernel
 };
 
 bool check_result(const test_params_t& t) {
@@ -34,8 +36,10 @@ bool check_result(const test_params_t& t) {
   auto op_attr = op_desc.attrs();
 
   try {
+    jd::max_isa() = t.force_avx2 ? jd::avx2 : jd::isa_any;
     jd::layernorm_ba_desc layernorm_ba_desc(op_desc);
     jd::layernorm_ba layernorm_ba_ker(layernorm_ba_desc);
+    jd::max_isa() = jd::isa_any;
     layernorm_ba_ker.execute(p.data);
 
     std::shared_ptr<const jd::kernel_desc_t> lnorm_ba_ref_desc;
@@ -44,6 +48,7 @@ bool check_result(const test_params_t& t) {
     jd::kernel_t::create<jd::layernorm_ba_ref_k_t, jd::layernorm_ba_ref_kd_t>(lnorm_ref_ker, lnorm_ba_ref_desc);
     lnorm_ref_ker->execute(q.data);
   } catch (const std::exception& e) {
+    jd::max_isa() = jd::isa_any;
     if (t.expect_to_fail) {
       return true;
     } else {
@@ -292,6 +297,36 @@ static auto case_func = []() {
 
   cases.push_back(
       {gen_case({data_desc0, data_desc0}, {{"matrix_shape", tensor_shape0}, {"spec_type", "direct"}}), false});
+
+  // AVX2 kernels, shapes differ from the cases above so that the kernel cache does not return an AVX512 kernel
+  jd::tensor_desc avx2_desc0 = {{96, 64}, jd::data_type::fp32, jd::format_type::ba};
+  jd::tensor_desc avx2_desc1 = {{4, 96, 32}, jd::data_type::fp32, jd::format_type::ba};
+  jd::tensor_desc avx2_desc2 = {{96, 64}, jd::data_type::s8, jd::format_type::ba};
+  jd::tensor_desc avx2_desc3 = {{96, 77}, jd::data_type::fp32, jd::format_type::ba};
+  jd::tensor_desc avx2_desc4 = {{96, 200}, jd::data_type::fp32, jd::format_type::ba};
+  jd::tensor_desc avx2_desc5 = {{96, 200}, jd::data_type::u8, jd::format_type::ba};
+  jd::tensor_desc avx2_desc6 = {{2, 96, 77}, jd::data_type::fp32, jd::format_type::ba};
+  cases.push_back(
+      {gen_case({avx2_desc0, avx2_desc0}, {{"matrix_shape", "96x64"}, {"spec_type", "normal"}}), false, true});
+  cases.push_back(
+      {gen_case({avx2_desc1, avx2_desc1}, {{"matrix_shape", "4x96x32"}, {"spec_type", "normal"}}), false, true});
+  cases.push_back(
+      {gen_case({avx2_desc0, avx2_desc2},
+                {{"matrix_shape", "96x64"}, {"postop_list", quantize_attrs8}, {"spec_type", "normal"}}, {s8_quantize}),
+       false, true});
+  cases.push_back(
+      {gen_case({avx2_desc3, avx2_desc3}, {{"matrix_shape", "96x77"}, {"spec_type", "direct"}}), false, true});
+  cases.push_back(
+      {gen_case({avx2_desc4, avx2_desc5},
+                {{"matrix_shape", "96x200"}, {"postop_list", quantize_attru8}, {"spec_type", "direct"}}, {u8_quantize}),
+       false, true});
+  cases.push_back({gen_case({avx2_desc6, avx2_desc6},
+                            {{"matrix_shape", "2x96x77"},
+                             {"postop_list", quantize_attru8},
+                             {"spec_type", "direct"},
+                             {"split_output", "true"}},
+                            {u8_quantize}),
+                   false, true});
   return ::testing::ValuesIn(cases);
 };
 
@@ -324,6 +359,7 @@ std::string test_suffix(testing::TestParamInfo<test_params_t> tpi) {
   params.push_back(attrs_map["spec_type"]);
   if (attrs_map["postop_list"] != "") params.push_back(attrs_map["postop_list"]);
   if (attrs_map["binaryop_list"] != "") params.push_back(attrs_map["binaryop_list"]);
+  if (tpi.param.force_avx2) params.push_back("avx2");
   return join_str(params, "_");
 }
 
@@ -15,6 +15,7 @@
 #include "gtest/gtest.h"
 #include "unit_test_utils.hpp"
 #include "interface.hpp"
+#include "src/cpu/cpu_isa.hpp"
 
 namespace test {
 struct op_args_t {
@@ -25,6 +26,7 @@ struct op_args_t {
 struct test_params_t {
   std::pair<op_args_t, op_args_t> args;
   bool expect_to_fail;
+  bool force_avx2 = false;  // hide AVX512 from dispatching to test the Ymm kernel
 };
 
 void get_true_data(const jd::operator_desc& op_desc, const std::vector<const void*>& rt_data) {
@@ -55,15 +57,15 @@ void get_true_data(const jd::operator_desc& op_desc, const std::vector<const voi
       }
     }
     // get e^M
-    max = apply_postop_list(max, dequant_list);
+    max = test::apply_postop_list(max, dequant_list);
     // step2. compute sum of exp
     float exp_sum = 0;
     for (int j = 0; j < col; j++) {
       float value = 0;
       if (src_dt == jd::data_type::s8) {
-        value = apply_postop_list(static_cast<float>(src_s8[i * col + j]), dequant_list);
+        value = test::apply_postop_list(static_cast<float>(src_s8[i * col + j]), dequant_list);
       } else {
-        value = apply_postop_list(static_cast<float>(src_u8[i * col + j]), dequant_list);
+        value = test::apply_postop_list(static_cast<float>(src_u8[i * col + j]), dequant_list);
       }
       value = get_exp(value - max);
       float_dst_data[i * col + j] = value;
@@ -78,12 +80,12 @@ void get_true_data(const jd::operator_desc& op_desc, const std::vector<const voi
     } else if (dst_dt == jd::data_type::u8) {
       for (int j = 0; j < col; j++) {
         reinterpret_cast<uint8_t*>(dst)[i * col + j] =
-            (uint8_t)apply_postop_list(float_dst_data[i * col + j] * scale, quant_list);
+            (uint8_t)test::apply_postop_list(float_dst_data[i * col + j] * scale, quant_list);
       }
     } else if (dst_dt == jd::data_type::s8) {
       for (int j = 0; j < col; j++)
         reinterpret_cast<int8_t*>(dst)[i * col + j] =
-            (int8_t)apply_postop_list(float_dst_data[i * col + j] * scale, quant_list);
+            (int8_t)test::apply_postop_list(float_dst_data[i * col + j] * scale, quant_list);
     } else {
       for (int j = 0; j < col; j++) reinterpret_cast<float*>(dst)[i * col + j] = float_dst_data[i * col + j] * scale;
     }
@@ -96,10 +98,13 @@ bool check_result(const test_params_t& t) {
 
   try {
     const auto& op_desc = p.op_desc;
+    jd::max_isa() = t.force_avx2 ? jd::avx2 : jd::isa_any;
     jd::softmax_desc softmax_desc(op_desc);
     jd::softmax softmax_ker(softmax_desc);
+    jd::max_isa() = jd::isa_any;
     softmax_ker.execute(p.data);
   } catch (const std::exception& e) {
+    jd::max_isa() = jd::isa_any;
     if (t.expect_to_fail) {
       return true;
     } else {
@@ -235,6 +240,25 @@ static auto case_func = []() {
                              {"spec_type", "lut"}},
                             {dequantize_s8_attr}),
                    false});
+
+  // AVX2 kernels, shapes differ from the cases above so that the kernel cache does not return an AVX512 kernel
+  jd::tensor_desc avx2_s8_desc = {{4, 3, 77}, jd::data_type::s8, jd::format_type::undef};
+  jd::tensor_desc avx2_u8_desc = {{4, 3, 77}, jd::data_type::u8, jd::format_type::undef};
+  jd::tensor_desc avx2_fp32_desc = {{4, 3, 77}, jd::data_type::fp32, jd::format_type::undef};
+  jd::tensor_desc avx2_s8_aligned_desc = {{128, 64}, jd::data_type::s8, jd::format_type::undef};
+  jd::tensor_desc avx2_fp32_aligned_desc = {{128, 64}, jd::data_type::fp32, jd::format_type::undef};
+  cases.push_back({gen_case({avx2_s8_desc, avx2_u8_desc},
+                            {{"postop_list", "dequantize+scale0.653695"}, {"vec_len", "77"}, {"spec_type", "lut"}},
+                            {dequantize_s8_attr, quant_u8_attr}),
+                   false, true});
+  cases.push_back({gen_case({avx2_s8_desc, avx2_fp32_desc},
+                            {{"postop_list", "dequantize+scale0.643695"}, {"vec_len", "77"}, {"spec_type", "lut"}},
+                            {dequantize_s8_attr}),
+                   false, true});
+  cases.push_back({gen_case({avx2_s8_aligned_desc, avx2_fp32_aligned_desc},
+                            {{"postop_list", "dequantize+scale0.643695"}, {"vec_len", "64"}, {"spec_type", "lut"}},
+                            {dequantize_s8_attr}),
+                   false, true});
   return ::testing::ValuesIn(cases);
 };
 
@@ -0,0 +1,151 @@
+//  Copyright (c) 2023 Intel Corporation
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../../executor/include/activation_dag.hpp"
+#include "../../executor/include/activation_mem_planner.hpp"
+#include "gtest/gtest.h"
+
+using executor::ActivationDAG;
+using executor::ActivationMemPlanner;
+using executor::ActivationOperator;
+using executor::ActivationTensor;
+using std::make_shared;
+using std::shared_ptr;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+namespace {
+
+// a bert-like chain: embedding [bs, seq, 768] fp32 -> qk [bs, 12, seq, seq] fp32 -> softmax (inplace)
+// -> context [bs, seq, 768] fp32 -> logits [bs, seq, 2] fp32, the embedding lives until the residual add
+unordered_map<string, size_t> TensorBytes(const vector<int64_t>& symbol_values) {
+  const size_t bs = symbol_values[0];
+  const size_t seq = symbol_values[1];
+  return {{"embedding", bs * seq * 768 * 4},
+          {"qk_inplace", bs * 12 * seq * seq * 4},
+          {"context", bs * seq * 768 * 4},
+          {"residual", bs * seq * 768 * 4},
+          {"logits", bs * seq * 2 * 4}};
+}
+
+ActivationDAG BuildDAG() {
+  auto embedding = make_shared<ActivationTensor>("embedding", 0);
+  auto qk = make_shared<ActivationTensor>("qk_inplace", 0, "fp32", vector<int64_t>{}, "qk");
+  auto softmax = make_shared<ActivationTensor>("qk_inplace", 0, "fp32", vector<int64_t>{}, "softmax");
+  auto context = make_shared<ActivationTensor>("context", 0);
+  auto residual = make_shared<ActivationTensor>("residual", 0);
+  auto logits = make_shared<ActivationTensor>("logits", 0);
+  vector<shared_ptr<ActivationOperator>> operators = {
+      make_shared<ActivationOperator>("embed", 0, vector<shared_ptr<ActivationTensor>>{},
+                                      vector<shared_ptr<ActivationTensor>>{embedding}),
+      make_shared<ActivationOperator>("matmul_qk", 1, vector<shared_ptr<ActivationTensor>>{embedding},
+                                      vector<shared_ptr<ActivationTensor>>{qk}),
+      make_shared<ActivationOperator>("softmax", 2, vector<shared_ptr<ActivationTensor>>{qk},
+                                      vector<shared_ptr<ActivationTensor>>{softmax}),
+      make_shared<ActivationOperator>("matmul_v", 3, vector<shared_ptr<ActivationTensor>>{softmax},
+                                      vector<shared_ptr<ActivationTensor>>{context}),
+      make_shared<ActivationOperator>("add", 4, vector<shared_ptr<ActivationTensor>>{context, embedding},
+                                      vector<shared_ptr<ActivationTensor>>{residual}),
+      make_shared<ActivationOperator>("classifier", 5, vector<shared_ptr<ActivationTensor>>{residual},
+                                      vector<shared_ptr<ActivationTensor>>{logits})};
+  return ActivationDAG(operators, {{"qk_inplace", {"qk", "softmax"}}});
+}
+
+std::unique_ptr<ActivationMemPlanner> BuildPlanner(const ActivationDAG& dag) {
+  std::unique_ptr<ActivationMemPlanner> planner(new ActivationMemPlanner(2));
+  for (const auto& point : planner->ProbePoints()) planner->AddProbe(point, TensorBytes(point));
+  planner->Build(dag);
+  return planner;
+}
+
+}  // namespace
+
+TEST(ActivationMemPlannerTest, SymbolicBytesAtUnseenShapes) {
+  ActivationDAG dag = BuildDAG();
+  auto planner = BuildPlanner(dag);
+  for (const auto& values : vector<vector<int64_t>>{{1, 384}, {7, 150}, {32, 1}}) {
+    for (const auto& item : TensorBytes(values)) {
+      EXPECT_EQ(planner->Bytes(item.first, values), item.second) << item.first;
+    }
+    EXPECT_EQ(planner->Bytes("softmax", values), TensorBytes(values)["qk_inplace"]);
+  }
+}
+
+TEST(ActivationMemPlannerTest, PlanKeepsLiveTensorsApart) {
+  ActivationDAG dag = BuildDAG();
+  auto planner = BuildPlanner(dag);
+  // tensor -> [life begin, life end]
+  unordered_map<string, vector<int64_t>> lifetimes = {{"embedding", {0, 4}}, {"qk_inplace", {1, 3}},
+                                                      {"context", {3, 4}},   {"residual", {4, 5}},
+                                                      {"logits", {5, 5}}};
+  for (const auto& values : vector<vector<int64_t>>{{1, 384}, {4, 128}, {1, 16}}) {
+    planner->Plan(values);
+    const auto& offsets = planner->offsets();
+    const auto& block_bytes = planner->block_bytes();
+    const auto bytes = TensorBytes(values);
+    size_t raw_bytes = 0;
+    for (const auto& a : lifetimes) {
+      raw_bytes += bytes.at(a.first);
+      EXPECT_GE(block_bytes.at(a.first), bytes.at(a.first));
+      EXPECT_LE(offsets.at(a.first) + bytes.at(a.first), planner->total_bytes());
+      for (const auto& b : lifetimes) {
+        if (a.first == b.first || a.second[1] < b.second[0] || b.second[1] < a.second[0]) continue;
+        const bool apart = offsets.at(a.first) + bytes.at(a.first) <= offsets.at(b.first) ||
+                           offsets.at(b.first) + bytes.at(b.first) <= offsets.at(a.first);
+        EXPECT_TRUE(apart) << a.first << " and " << b.first << " overlap";
+      }
+    }
+    EXPECT_EQ(offsets.at("softmax"), offsets.at("qk_inplace"));
+    // logits reuses the memory of the dead tensors
+    EXPECT_LT(planner->total_bytes(), raw_bytes);
+  }
+}
+
+TEST(ActivationMemPlannerTest, ObserveGrowsTensor) {
+  ActivationDAG dag = BuildDAG();
+  auto planner = BuildPlanner(dag);
+  const vector<int64_t> values = {2, 64};
+  const size_t observed = TensorBytes(values)["logits"] * 100;
+  planner->Observe("logits", observed);
+  planner->Plan(values);
+  EXPECT_GE(planner->block_bytes().at("logits"), observed);
+}
+
+TEST(ActivationMemPlannerTest, UnfittedTensorTakesRealBytes) {
+  ActivationDAG dag = BuildDAG();
+  // the logits bytes are cubic in seq_len, out of the quadratic fitting
+  auto tensor_bytes = [](const vector<int64_t>& values) {
+    auto bytes = TensorBytes(values);
+    bytes["logits"] = values[0] * values[1] * values[1] * values[1];
+    return bytes;
+  };
+  ActivationMemPlanner planner(2);
+  for (const auto& point : planner.ProbePoints()) planner.AddProbe(point, tensor_bytes(point));
+  planner.Build(dag);
+  EXPECT_EQ(planner.UnfittedNames(), vector<string>{"logits"});
+  // far beyond the probe shapes, the max probe bytes are too small
+  const vector<int64_t> values = {4, 512};
+  const size_t real_bytes = tensor_bytes(values)["logits"];
+  planner.Plan(values);
+  EXPECT_LT(planner.block_bytes().at("logits"), real_bytes);
+  planner.Plan(values, {{"logits", real_bytes}});
+  EXPECT_GE(planner.block_bytes().at("logits"), real_bytes);
+  EXPECT_LE(planner.offsets().at("logits") + real_bytes, planner.total_bytes());
+}
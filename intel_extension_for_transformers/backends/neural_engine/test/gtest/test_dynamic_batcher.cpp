@@ -0,0 +1,130 @@
+//  Copyright (c) 2023 Intel Corporation
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#include <chrono>  // NOLINT
+#include <vector>
+
+#include "../../executor/include/dynamic_batcher.hpp"
+#include "gtest/gtest.h"
+
+using executor::BatchingOptions;
+using executor::DynamicBatcher;
+using executor::ServingRequest;
+using executor::Tensor;
+
+namespace {
+
+// input_ids [1, seq_len] and input_mask [1, seq_len] (without data, generated by the batcher)
+std::vector<Tensor> MakeInputs(std::vector<int32_t>* ids) {
+  const int64_t seq_len = ids->size();
+  return {Tensor(ids->data(), {1, seq_len}, "int32"), Tensor(nullptr, {1, seq_len}, "int32")};
+}
+
+}  // namespace
+
+TEST(DynamicBatcherTest, Bucket) {
+  BatchingOptions options;
+  options.seq_len_buckets = {64, 128, 384};
+  DynamicBatcher batcher(options);
+  EXPECT_EQ(batcher.Bucket(1), 64);
+  EXPECT_EQ(batcher.Bucket(64), 64);
+  EXPECT_EQ(batcher.Bucket(65), 128);
+  EXPECT_EQ(batcher.Bucket(150), 384);
+  EXPECT_EQ(batcher.Bucket(500), 500);
+}
+
+TEST(DynamicBatcherTest, FullBucketIsReleased) {
+  BatchingOptions options;
+  options.max_batch_size = 2;
+  options.max_delay_us = 60 * 1000 * 1000;
+  options.seq_len_buckets = {64, 128};
+  DynamicBatcher batcher(options);
+  std::vector<int32_t> a(100, 1), b(20, 2), c(120, 3);
+  batcher.Push(MakeInputs(&a), nullptr);
+  batcher.Push(MakeInputs(&b), nullptr);
+  batcher.Push(MakeInputs(&c), nullptr);
+  // bucket 128 is full long before the deadline, the short request stays in bucket 64
+  std::vector<ServingRequest> batch;
+  ASSERT_TRUE(batcher.Pop(&batch));
+  ASSERT_EQ(batch.size(), 2);
+  EXPECT_EQ(batch[0].id, 0);
+  EXPECT_EQ(batch[1].id, 2);
+  batcher.Done(batch.size());
+  batcher.Stop();
+  ASSERT_TRUE(batcher.Pop(&batch));
+  ASSERT_EQ(batch.size(), 1);
+  EXPECT_EQ(batch[0].id, 1);
+  batcher.Done(batch.size());
+  EXPECT_FALSE(batcher.Pop(&batch));
+  batcher.Wait();
+}
+
+TEST(DynamicBatcherTest, DeadlineReleasesPartialBatch) {
+  BatchingOptions options;
+  options.max_batch_size = 8;
+  options.max_delay_us = 10 * 1000;
+  DynamicBatcher batcher(options);
+  std::vector<int32_t> a(16, 1);
+  const auto start = std::chrono::steady_clock::now();
+  batcher.Push(MakeInputs(&a), nullptr);
+  std::vector<ServingRequest> batch;
+  ASSERT_TRUE(batcher.Pop(&batch));
+  EXPECT_EQ(batch.size(), 1);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::microseconds(options.max_delay_us));
+  batcher.Done(batch.size());
+}
+
+TEST(DynamicBatcherTest, PackPadsToLongestSample) {
+  BatchingOptions options;
+  options.max_batch_size = 2;
+  options.pad_to_multiple = 4;
+  options.mask_input_index = 1;
+  options.output_seq_axes = {1, -1};
+  DynamicBatcher batcher(options);
+  std::vector<int32_t> a(5, 7), b(3, 9);
+  batcher.Push(MakeInputs(&a), nullptr);
+  batcher.Push(MakeInputs(&b), nullptr);
+  std::vector<ServingRequest> batch;
+  ASSERT_TRUE(batcher.Pop(&batch));
+  ASSERT_EQ(batch.size(), 2);
+  EXPECT_EQ(batcher.PaddedLen(batch), 8);
+
+  std::vector<std::vector<char>> buffers;
+  std::vector<Tensor> inputs = batcher.Pack(batch, &buffers);
+  ASSERT_EQ(inputs.size(), 2);
+  EXPECT_EQ(inputs[0].shape(), std::vector<int64_t>({2, 8}));
+  EXPECT_EQ(inputs[1].shape(), std::vector<int64_t>({2, 8}));
+  const int32_t* ids = static_cast<const int32_t*>(inputs[0].raw_data());
+  const int32_t* mask = static_cast<const int32_t*>(inputs[1].raw_data());
+  for (int s = 0; s < 8; ++s) {
+    EXPECT_EQ(ids[s], s < 5 ? 7 : 0);
+    EXPECT_EQ(ids[8 + s], s < 3 ? 9 : 0);
+    EXPECT_EQ(mask[s], s < 5 ? 1 : 0);
+    EXPECT_EQ(mask[8 + s], s < 3 ? 1 : 0);
+  }
+
+  // [2, 8, 2] output is split to [1, 5, 2] and [1, 3, 2] views, the [2, 8] pooled output has no
+  // sequence axis and keeps its 8 features
+  std::vector<float> logits(2 * 8 * 2), pooled(2 * 8);
+  std::vector<Tensor> outputs = {Tensor(logits.data(), {2, 8, 2}, "fp32"), Tensor(pooled.data(), {2, 8}, "fp32")};
+  std::vector<std::vector<Tensor>> samples = batcher.Unpack(batch, 8, &outputs);
+  ASSERT_EQ(samples.size(), 2);
+  EXPECT_EQ(samples[0][0].shape(), std::vector<int64_t>({1, 5, 2}));
+  EXPECT_EQ(samples[1][0].shape(), std::vector<int64_t>({1, 3, 2}));
+  EXPECT_EQ(samples[1][0].raw_data(), logits.data() + 16);
+  EXPECT_EQ(samples[0][1].shape(), std::vector<int64_t>({1, 8}));
+  EXPECT_EQ(samples[1][1].shape(), std::vector<int64_t>({1, 8}));
+  EXPECT_EQ(samples[1][1].raw_data(), pooled.data() + 8);
+  batcher.Done(batch.size());
+}
@@ -14,6 +14,7 @@
 
 #include <math.h>
 
+#include <algorithm>
 #include <map>
 #include <string>
 
@@ -243,3 +244,80 @@ static auto CasesFp32 = []() {
 };
 
 INSTANTIATE_TEST_SUITE_P(Prefix, LayerNormOpTest, CasesFp32());
+
+// LayerNorm with a fused Quantize: the int8 output dequantized with its scales should match the fp32 LayerNorm.
+bool CheckQuantizeFusion(const std::string& dst_dtype, bool per_token) {
+  const std::vector<int64_t> src_shape = {8, 64};
+  shared_ptr<TensorConfig> src_config = std::make_shared<TensorConfig>("src", src_shape);
+  shared_ptr<TensorConfig> gamma_config = std::make_shared<TensorConfig>("gamma", std::vector<int64_t>{1, 64});
+  shared_ptr<TensorConfig> beta_config = std::make_shared<TensorConfig>("beta", std::vector<int64_t>{1, 64});
+  shared_ptr<TensorConfig> min_config = std::make_shared<TensorConfig>("dst_min", std::vector<int64_t>{1});
+  shared_ptr<TensorConfig> max_config = std::make_shared<TensorConfig>("dst_max", std::vector<int64_t>{1});
+  shared_ptr<TensorConfig> dst_config = std::make_shared<TensorConfig>("dst", std::vector<int64_t>{}, dst_dtype);
+  shared_ptr<TensorConfig> dst_min_config = std::make_shared<TensorConfig>("dst_min", std::vector<int64_t>{});
+  shared_ptr<TensorConfig> dst_scale_config = std::make_shared<TensorConfig>("dst_scale", std::vector<int64_t>{});
+  shared_ptr<TensorConfig> ref_config = std::make_shared<TensorConfig>("ref", std::vector<int64_t>{});
+
+  std::map<std::string, std::string> attr_map = {{"epsilon", "0.0010000000474974513"}, {"output_dtype", dst_dtype}};
+  if (per_token) attr_map["per_token"] = "true";
+  shared_ptr<AttrConfig> op_attr = std::make_shared<AttrConfig>(attr_map);
+  std::vector<shared_ptr<TensorConfig>> input_configs = {src_config, gamma_config, beta_config};
+  std::vector<shared_ptr<TensorConfig>> output_configs = {dst_config};
+  if (per_token) {
+    output_configs.insert(output_configs.end(), {dst_min_config, dst_scale_config});
+  } else {
+    input_configs.insert(input_configs.end(), {min_config, max_config});
+  }
+  auto op_config =
+      std::make_shared<OperatorConfig>("layer_norm_quant", "LayerNorm", input_configs, output_configs, op_attr);
+
+  std::vector<Tensor*> input, output;
+  for (auto& config : input_configs) {
+    input.push_back(new Tensor(*config));
+    input.back()->add_tensor_life(1);
+    executor::InitVector<float>(static_cast<float*>(input.back()->mutable_data()), input.back()->size());
+  }
+  if (!per_token) {
+    *static_cast<float*>(input[3]->mutable_data()) = -4.f;
+    *static_cast<float*>(input[4]->mutable_data()) = 4.f;
+  }
+  for (auto& config : output_configs) {
+    output.push_back(new Tensor(*config));
+    output.back()->add_tensor_life(1);
+  }
+  Tensor ref(*ref_config);
+  ref.add_tensor_life(1);
+  GetTrueData(input, {&ref}, op_config);
+
+  executor::LayerNormOperator lnorm_op(op_config);
+  lnorm_op.Prepare(input, output);
+  lnorm_op.Reshape(input, output);
+  lnorm_op.Forward(input, output);
+
+  const float* ref_data = static_cast<const float*>(ref.data());
+  bool ok = true;
+  for (int64_t i = 0; i < src_shape[0]; ++i) {
+    float scale, zp = 0.f;
+    if (per_token) {
+      scale = 1.f / static_cast<const float*>(output[2]->data())[i];
+    } else {
+      scale = executor::GetScales(input[3]->data(), input[4]->data(), 1, dst_dtype)[0];
+      if (dst_dtype == "u8") zp = 4.f * scale;  // -min * scale
+    }
+    for (int64_t j = 0; j < src_shape[1]; ++j) {
+      const int64_t idx = i * src_shape[1] + j;
+      const float q = dst_dtype == "u8" ? static_cast<const uint8_t*>(output[0]->data())[idx]
+                                        : static_cast<const int8_t*>(output[0]->data())[idx];
+      const float ref_q = std::min(std::max(ref_data[idx] * scale + zp, dst_dtype == "u8" ? 0.f : -128.f),
+                                   dst_dtype == "u8" ? 255.f : 127.f);
+      ok = ok && std::abs(q - ref_q) <= 1.f;
+    }
+  }
+  return ok;
+}
+
+TEST(LayerNormQuantizeFusionTest, StaticU8) { EXPECT_TRUE(CheckQuantizeFusion("u8", false)); }
+
+TEST(LayerNormQuantizeFusionTest, StaticS8) { EXPECT_TRUE(CheckQuantizeFusion("s8", false)); }
+
+TEST(LayerNormQuantizeFusionTest, DynamicPerToken) { EXPECT_TRUE(CheckQuantizeFusion("s8", true)); }
@@ -0,0 +1,169 @@
+//  Copyright (c) 2023 Intel Corporation
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "../../executor/include/memory_allocator.hpp"
+#include "gtest/gtest.h"
+
+using executor::ActivationDAG;
+using executor::ActivationMemPlanner;
+using executor::ActivationOperator;
+using executor::ActivationTensor;
+using executor::MemoryAllocator;
+using executor::StaticCompressedBuffer;
+
+TEST(MemoryAllocatorTest, SizeClass) {
+  int last_class = -1;
+  for (size_t size = 1; size < (1 << 22); size = size * 9 / 8 + 1) {
+    const int size_class = MemoryAllocator::SizeClass(size);
+    const size_t class_bytes = MemoryAllocator::SizeClassBytes(size_class);
+    EXPECT_GE(size_class, last_class);
+    EXPECT_GE(class_bytes, size);
+    EXPECT_EQ(class_bytes % ALIGNMENT, 0);
+    // at most 25% waste beyond the first classes
+    if (size > 4 * MemoryAllocator::kSizeClassUnit) {
+      EXPECT_LE(class_bytes, size + size / 4);
+    }
+    // the largest size of a class is in the class
+    EXPECT_EQ(MemoryAllocator::SizeClass(class_bytes), size_class);
+    last_class = size_class;
+  }
+  EXPECT_LT(MemoryAllocator::SizeClass(SIZE_MAX), MemoryAllocator::kNumSizeClasses);
+}
+
+TEST(MemoryAllocatorTest, CycleBufferReuse) {
+  MemoryAllocator::SetStrategy("cycle_buffer");
+  void* a = MemoryAllocator::GetMemory(1000, 2);
+  void* b = MemoryAllocator::GetMemory(1000, 1);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(MemoryAllocator::UnrefMemory(a), 1);
+  EXPECT_EQ(MemoryAllocator::UnrefMemory(a), 0);
+  // an idle buffer of the same size class is handed out again
+  void* c = MemoryAllocator::GetMemory(990, 1);
+  EXPECT_EQ(c, a);
+  EXPECT_EQ(MemoryAllocator::CheckMemory(c), 1);
+
+  // a buffer revived by ResetMemory is not handed out
+  EXPECT_EQ(MemoryAllocator::UnrefMemory(b), 0);
+  MemoryAllocator::ResetMemory(b, 3);
+  void* d = MemoryAllocator::GetMemory(1000, 1);
+  EXPECT_NE(d, b);
+  EXPECT_EQ(MemoryAllocator::CheckMemory(b), 3);
+
+  int dummy = 0;
+  EXPECT_EQ(MemoryAllocator::CheckMemory(&dummy), -1);
+  EXPECT_EQ(MemoryAllocator::UnrefMemory(&dummy), -1);
+}
+
+TEST(MemoryAllocatorTest, ThreadsOwnTheirBuffers) {
+  MemoryAllocator::SetStrategy("cycle_buffer");
+  void* main_buffer = MemoryAllocator::GetMemory(256, 1);
+  std::vector<std::thread> threads;
+  std::vector<int> results(4, 0);
+  for (int t = 0; t < results.size(); ++t) {
+    threads.emplace_back([&, t] {
+      // the other thread's buffer is unknown to this arena
+      if (MemoryAllocator::CheckMemory(main_buffer) != -1) return;
+      for (int i = 0; i < 1000; ++i) {
+        void* buffer = MemoryAllocator::GetMemory(128 * (i % 7 + 1), 1);
+        if (MemoryAllocator::UnrefMemory(buffer) != 0) return;
+      }
+      results[t] = 1;
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  for (int result : results) EXPECT_EQ(result, 1);
+  EXPECT_EQ(MemoryAllocator::CheckMemory(main_buffer), 1);
+}
+
+TEST(MemoryAllocatorTest, IdleBuffersAreTrimmed) {
+  MemoryAllocator::SetStrategy("cycle_buffer");
+  // one pass of a model with 3 activations of a sequence length, at most 2 are alive at once
+  auto run_pass = [](size_t seq_len) {
+    MemoryAllocator::TrimIdleBuffers();
+    void* a = MemoryAllocator::GetMemory(seq_len * 3072, 1);
+    void* b = MemoryAllocator::GetMemory(seq_len * 1024, 1);
+    MemoryAllocator::UnrefMemory(a);
+    void* c = MemoryAllocator::GetMemory(seq_len * 1024, 1);
+    MemoryAllocator::UnrefMemory(b);
+    MemoryAllocator::UnrefMemory(c);
+  };
+  std::thread([&] {
+    // a fresh arena
+    ASSERT_EQ(MemoryAllocator::CycleBufferBytes(), 0);
+    const size_t max_seq_len = 384;
+    const size_t max_pass_bytes = 3 * MemoryAllocator::SizeClassBytes(MemoryAllocator::SizeClass(max_seq_len * 3072));
+    size_t peak_bytes = 0;
+    for (int pass = 0; pass < 500; ++pass) {
+      run_pass(1 + pass * 37 % max_seq_len);
+      // only the buffers of the last kMaxIdlePasses + 1 passes are kept
+      EXPECT_LE(MemoryAllocator::CycleBufferBytes(), (MemoryAllocator::kMaxIdlePasses + 1) * max_pass_bytes);
+      peak_bytes = std::max(peak_bytes, MemoryAllocator::CycleBufferBytes());
+    }
+    // a steady shape sheds the buffers of the other ones
+    for (int pass = 0; pass <= MemoryAllocator::kMaxIdlePasses + 1; ++pass) run_pass(16);
+    const size_t steady_bytes = MemoryAllocator::CycleBufferBytes();
+    EXPECT_LE(steady_bytes, 2 * MemoryAllocator::SizeClassBytes(MemoryAllocator::SizeClass(16 * 3072) +
+                                                                 MemoryAllocator::kMaxClassSkip));
+    EXPECT_LT(steady_bytes, peak_bytes);
+    for (int pass = 0; pass < 100; ++pass) run_pass(16);
+    EXPECT_EQ(MemoryAllocator::CycleBufferBytes(), steady_bytes);
+  }).join();
+}
+
+TEST(MemoryAllocatorTest, CompressedBufferPerModel) {
+  // two models with one activation of seq_len * 1024 bytes each
+  ActivationDAG dag({std::make_shared<ActivationOperator>(
+      "embed", 0, std::vector<std::shared_ptr<ActivationTensor>>{},
+      std::vector<std::shared_ptr<ActivationTensor>>{std::make_shared<ActivationTensor>("embedding", 0)})});
+  auto init_model = [&]() {
+    auto planner = std::make_shared<ActivationMemPlanner>(1);
+    for (const auto& point : planner->ProbePoints()) planner->AddProbe(point, {{"embedding", point[0] * 1024}});
+    planner->Build(dag);
+    std::shared_ptr<StaticCompressedBuffer> buffer = MemoryAllocator::InitSymbolicBufferManager(planner);
+    buffer->Replan({1});
+    return buffer;
+  };
+  MemoryAllocator::SetStrategy("static_compressed_buffer");
+  auto model_a = init_model();
+  auto model_b = init_model();
+  MemoryAllocator::BindCompressedBuffer(model_a);
+  char* a = static_cast<char*>(MemoryAllocator::GetMemory(1024, 1, "embedding"));
+  MemoryAllocator::BindCompressedBuffer(model_b);
+  char* b = static_cast<char*>(MemoryAllocator::GetMemory(1024, 1, "embedding"));
+  EXPECT_TRUE(a + 1024 <= b || b + 1024 <= a);
+  memset(b, 7, 1024);
+  MemoryAllocator::UnrefMemory(a);
+  MemoryAllocator::UnrefMemory(b);
+
+  // a new shape of model a grows its buffer only, model b keeps its layout and data
+  model_a->Replan({300});
+  MemoryAllocator::BindCompressedBuffer(model_a);
+  char* grown = static_cast<char*>(MemoryAllocator::GetMemory(300 * 1024, 1, "embedding"));
+  EXPECT_NE(grown, a);
+  memset(grown, 1, 300 * 1024);
+  MemoryAllocator::BindCompressedBuffer(model_b);
+  EXPECT_EQ(MemoryAllocator::GetMemory(1024, 1, "embedding"), b);
+  for (int i = 0; i < 1024; ++i) ASSERT_EQ(b[i], 7);
+  MemoryAllocator::UnrefMemory(grown);
+  MemoryAllocator::UnrefMemory(b);
+  MemoryAllocator::BindCompressedBuffer(nullptr);
+  MemoryAllocator::Strategy()["static_compressed_buffer"] = false;
+}
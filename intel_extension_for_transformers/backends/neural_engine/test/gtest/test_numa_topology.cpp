@@ -0,0 +1,50 @@
+//  Copyright (c) 2023 Intel Corporation
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../../executor/include/numa_topology.hpp"
+#include "gtest/gtest.h"
+
+using executor::NumaTopology;
+
+TEST(NumaTopologyTest, ParseCpuList) {
+  EXPECT_EQ(NumaTopology::ParseCpuList("0-3,8,10-11"), std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_EQ(NumaTopology::ParseCpuList("5"), std::vector<int>({5}));
+  EXPECT_EQ(NumaTopology::ParseCpuList(""), std::vector<int>());
+  EXPECT_EQ(NumaTopology::ParseCpuList("a-b"), std::vector<int>());
+}
+
+TEST(NumaTopologyTest, NodesCoverDistinctCpus) {
+  for (bool use_logical_cores : {false, true}) {
+    NumaTopology topology(use_logical_cores);
+    ASSERT_GT(topology.num_nodes(), 0);
+    std::set<int> seen;
+    for (int n = 0; n < topology.num_nodes(); ++n) {
+      EXPECT_FALSE(topology.cpus(n).empty());
+      for (int cpu : topology.cpus(n)) {
+        EXPECT_TRUE(seen.insert(cpu).second) << "cpu " << cpu << " belongs to more than one node";
+      }
+    }
+  }
+}
+
+TEST(NumaTopologyTest, BindOmpThreads) {
+  NumaTopology topology;
+  const std::vector<int>& cpus = topology.cpus(0);
+  EXPECT_TRUE(NumaTopology::BindOmpThreads({cpus[0]}));
+  EXPECT_FALSE(NumaTopology::BindThread({}));
+}